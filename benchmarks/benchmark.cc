@@ -1,10 +1,21 @@
 #include "../intgemm/aligned.h"
 #include "intgemm/intgemm_config.h"
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+#include "../intgemm/neon_gemm.h"
+#else
+#include "../intgemm/amx_gemm.h"
 #include "../intgemm/avx512_gemm.h"
 #include "../intgemm/sse2_gemm.h"
 #include "../intgemm/avx2_gemm.h"
+#include "../intgemm/avxvnni_gemm.h"
 #include "../intgemm/ssse3_gemm.h"
+#include "../intgemm/wasm_gemm.h"
+#endif
+#include "../intgemm/executor.h"
 #include "../intgemm/intgemm.h"
+#include "../intgemm/numa.h"
+#include "../intgemm/partition.h"
+#include "../intgemm/prefetch.h"
 #include "../intgemm/stats.h"
 #include "../intgemm/callbacks.h"
 
@@ -18,6 +29,8 @@
 #include <iomanip>
 #include <iostream>
 #include <random>
+#include <thread>
+#include <vector>
 
 namespace intgemm {
 namespace {
@@ -71,11 +84,18 @@ template <class Backend> void RunAll(RandomMatrices *matrices, RandomMatrices *m
 struct BackendStats {
   std::vector<std::vector<double>> ssse3_8bit;
   std::vector<std::vector<double>> avx2_8bit;
+  std::vector<std::vector<double>> avxvnni_8bit;
   std::vector<std::vector<double>> avx512_8bit;
   std::vector<std::vector<double>> avx512vnni_8bit;
+  std::vector<std::vector<double>> amx_8bit;
   std::vector<std::vector<double>> sse2_16bit;
   std::vector<std::vector<double>> avx2_16bit;
   std::vector<std::vector<double>> avx512_16bit;
+  std::vector<std::vector<double>> avx512vnni_16bit;
+  std::vector<std::vector<double>> neon_8bit;
+  std::vector<std::vector<double>> neondotprod_8bit;
+  std::vector<std::vector<double>> neon_16bit;
+  std::vector<std::vector<double>> wasm_8bit;
 };
 
 const float kOutlierThreshold = 0.75;
@@ -104,6 +124,100 @@ template <class Backend> void Print(std::vector<std::vector<double>> &stats, std
   std::cout << '\n';
 }
 
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+// Forces the number of rows of A the AVX512 8-bit kernels register block.
+template <class Kernels, Index kRows> struct RowBlocked : public Kernels {
+  template <typename Callback>
+  static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    Kernels::template MultiplyRows<kRows, Callback>(A, B, A_rows, width, B_cols, callback);
+  }
+};
+
+// Find where blocking more rows of A stops paying off, mostly relevant to the small batches in decoding.
+template <class Kernels> void RowBlockingSweep() {
+  if (Kernels::kUses > kCPU) return;
+  const int kSamples = 100;
+  const Index kRowCounts[] = {1, 2, 4, 8, 16, 32, 64};
+  for (Index rows : kRowCounts) {
+    RandomMatrices m(rows, 512, 512);
+    std::vector<std::vector<double>> stats[4];
+    for (int samples = 0; samples < kSamples; ++samples) {
+      RunAll<RowBlocked<Kernels, 1>>(&m, &m + 1, stats[0]);
+      RunAll<RowBlocked<Kernels, 2>>(&m, &m + 1, stats[1]);
+      RunAll<RowBlocked<Kernels, 3>>(&m, &m + 1, stats[2]);
+      RunAll<RowBlocked<Kernels, 4>>(&m, &m + 1, stats[3]);
+    }
+    for (std::size_t block = 0; block < 4; ++block) {
+      std::cout << "RowBlock " << Kernels::kName << '\t' << rows << '\t' << m.width << '\t' << m.B_cols << "\tkRows=" << (block + 1) << '\t';
+      Summarize(stats[block][0]);
+      std::cout << '\n';
+    }
+  }
+}
+#endif
+
+// Few rows of A times a B much larger than the caches, so the multiply waits
+// on memory, at each software prefetch distance.  Reports B read per second.
+template <class Backend> void PrefetchSweep(const char *name) {
+  const int kSamples = 10;
+  const Index kDistances[] = {0, 256, 512, 1024, 2048, 4096};
+  RandomMatrices m(4, 4096, 8192);
+  for (Index distance : kDistances) {
+    SetPrefetchDistance(distance);
+    std::vector<double> stats;
+    for (int samples = 0; samples < kSamples; ++samples) {
+      stats.push_back(Run<Backend>(m));
+    }
+    double fastest = *std::min_element(stats.begin(), stats.end());
+    double gigabytes = static_cast<double>(m.width) * m.B_cols * sizeof(typename Backend::Integer) / 1e9;
+    std::cout << "Prefetch " << name << '\t' << m.A_rows << '\t' << m.width << '\t' << m.B_cols << "\tdistance=" << distance << '\t';
+    Summarize(stats);
+    std::cout << '\t' << std::setw(8) << gigabytes / fastest << " GB/s\n";
+  }
+  ResetPrefetchDistance();
+}
+
+// A multiply big enough for every core on a ThreadPool pinned to each type of
+// core and to all of them, in each schedule.  On a hybrid CPU the static
+// schedule on all cores goes at the pace of the E-cores.
+void ScheduleSweep() {
+  const int kSamples = 20;
+  RandomMatrices m(64, 1024, 4096);
+  const float quant_mult = 127.0f / 2.0f;
+  AlignedVector<int8_t> A_prepared(m.A_rows * m.width), B_prepared(m.width * m.B_cols);
+  Int8::PrepareA(m.A.begin(), A_prepared.begin(), quant_mult, m.A_rows, m.width);
+  Int8::PrepareB(m.B.begin(), B_prepared.begin(), quant_mult, m.width, m.B_cols);
+  AlignedVector<float> output(m.A_rows * m.B_cols);
+  const auto callback = callbacks::UnquantizeAndWrite(1.0f / (quant_mult * quant_mult), output.begin());
+
+  const std::vector<int> performance = CoreTypeCPUs(CoreType::Performance), efficient = CoreTypeCPUs(CoreType::Efficient);
+  std::vector<int> all(performance);
+  all.insert(all.end(), efficient.begin(), efficient.end());
+  std::sort(all.begin(), all.end());
+  const std::pair<const char *, const std::vector<int> *> cores[] = {{"all", &all}, {"performance", &performance}, {"efficient", &efficient}};
+  const std::pair<const char *, Schedule> schedules[] = {{"static", Schedule::Static}, {"dynamic", Schedule::Dynamic}};
+  const Schedule before = GetSchedule();
+  for (const auto &core : cores) {
+    // Not hybrid: every core, unpinned.
+    if (core.second->empty() && core.second != &all) continue;
+    ThreadPool pool(core.second->empty() ? std::thread::hardware_concurrency() : core.second->size(), *core.second);
+    for (const auto &schedule : schedules) {
+      SetSchedule(schedule.second);
+      Int8::Multiply(A_prepared.begin(), B_prepared.begin(), m.A_rows, m.width, m.B_cols, callback, pool);
+      std::vector<double> stats;
+      for (int samples = 0; samples < kSamples; ++samples) {
+        auto start = std::chrono::steady_clock::now();
+        Int8::Multiply(A_prepared.begin(), B_prepared.begin(), m.A_rows, m.width, m.B_cols, callback, pool);
+        stats.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+      }
+      std::cout << "Schedule " << m.A_rows << '\t' << m.width << '\t' << m.B_cols << "\tcores=" << core.first << "\tthreads=" << pool.Threads() << '\t' << schedule.first << '\t';
+      Summarize(stats);
+      std::cout << '\n';
+    }
+  }
+  SetSchedule(before);
+}
+
 } // namespace intgemm
 } // namespace
 
@@ -142,12 +256,42 @@ int main(int, char ** argv) {
   const int kSamples = 100;
   // Realistically, we don't expect different architectures or different precisions to run in the
   // same run of an application. Benchmark per architecture and per precision level.
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+  std::cerr << "NEON 8bit, 100 samples..." << std::endl;
+  for (int samples = 0; samples < kSamples; ++samples) {
+    RandomMatrices *end = (samples < 4) ? matrices_end : full_sample;
+    RunAll<NEON::Kernels8>(matrices, end, stats.neon_8bit);
+  }
+
+  std::cerr << "NEON 16bit, 100 samples..." << std::endl;
+  for (int samples = 0; samples < kSamples; ++samples) {
+    RandomMatrices *end = (samples < 4) ? matrices_end : full_sample;
+    RunAll<NEON::Kernels16>(matrices, end, stats.neon_16bit);
+  }
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON_DOTPROD
+  std::cerr << "NEONDOTPROD 8bit, 100 samples..." << std::endl;
+  for (int samples = 0; samples < kSamples; ++samples) {
+    RandomMatrices *end = (samples < 4) ? matrices_end : full_sample;
+    RunAll<NEONDOTPROD::Kernels8>(matrices, end, stats.neondotprod_8bit);
+  }
+#endif
+  // Every aarch64 CPU has NEON, so it is always sampled.
+  std::vector<std::vector<double>> &baseline = stats.neon_16bit;
+#else
   std::cerr << "SSSE3 8bit, 100 samples..." << std::endl;
   for (int samples = 0; samples < kSamples; ++samples) {
     RandomMatrices *end = (samples < 4) ? matrices_end : full_sample;
     RunAll<SSSE3::Kernels8>(matrices, end, stats.ssse3_8bit);
   }
 
+#ifdef WASM
+  std::cerr << "SIMD128 8bit, 100 samples..." << std::endl;
+  for (int samples = 0; samples < kSamples; ++samples) {
+    RandomMatrices *end = (samples < 4) ? matrices_end : full_sample;
+    RunAll<SIMD128::Kernels8>(matrices, end, stats.wasm_8bit);
+  }
+#endif
+
   std::cerr << "SSE2 16bit, 100 samples..." << std::endl;
   for (int samples = 0; samples < kSamples; ++samples) {
     RandomMatrices *end = (samples < 4) ? matrices_end : full_sample;
@@ -167,6 +311,15 @@ int main(int, char ** argv) {
     RunAll<AVX2::Kernels16>(matrices, end, stats.avx2_16bit);
   }
 #endif
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVXVNNI
+  if (AVXVNNIAvailable()) {
+    std::cerr << "AVXVNNI 8bit, 100 samples..." << std::endl;
+    for (int samples = 0; samples < kSamples; ++samples) {
+      RandomMatrices *end = (samples < 4) ? matrices_end : full_sample;
+      RunAll<AVXVNNI::Kernels8>(matrices, end, stats.avxvnni_8bit);
+    }
+  }
+#endif
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
   std::cerr << "AVX512 8bit, 100 samples..." << std::endl;
   for (int samples = 0; samples < kSamples; ++samples) {
@@ -186,28 +339,76 @@ int main(int, char ** argv) {
     RandomMatrices *end = (samples < 4) ? matrices_end : full_sample;
     RunAll<AVX512VNNI::Kernels8>(matrices, end, stats.avx512vnni_8bit);
   }
+
+  std::cerr << "AVX512VNNI 16bit, 100 samples..." << std::endl;
+  for (int samples = 0; samples < kSamples; ++samples) {
+    RandomMatrices *end = (samples < 4) ? matrices_end : full_sample;
+    RunAll<AVX512VNNI::Kernels16>(matrices, end, stats.avx512vnni_16bit);
+  }
+#endif
+#ifdef INTGEMM_COMPILER_SUPPORTS_AMX
+  std::cerr << "AMX 8bit, 100 samples..." << std::endl;
+  for (int samples = 0; samples < kSamples; ++samples) {
+    RandomMatrices *end = (samples < 4) ? matrices_end : full_sample;
+    RunAll<AMX::Kernels8>(matrices, end, stats.amx_8bit);
+  }
+#endif
+  std::vector<std::vector<double>> &baseline = stats.sse2_16bit;
 #endif
 
-  if (stats.sse2_16bit.empty()) {
+  if (baseline.empty()) {
     std::cerr << "No CPU support." << std::endl;
     return 1;
   }
   for (std::size_t i = 0; i < sizeof(matrices) / sizeof(RandomMatrices); ++i) {
-    std::cout << "Multiply\t" << matrices[i].A_rows << '\t' << matrices[i].width << '\t' << matrices[i].B_cols << '\t' << "Samples=" << (kOutlierThreshold * stats.sse2_16bit[i].size()) << '\n';
+    std::cout << "Multiply\t" << matrices[i].A_rows << '\t' << matrices[i].width << '\t' << matrices[i].B_cols << '\t' << "Samples=" << (kOutlierThreshold * baseline[i].size()) << '\n';
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+    Print<NEON::Kernels8>(stats.neon_8bit, i);
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON_DOTPROD
+    Print<NEONDOTPROD::Kernels8>(stats.neondotprod_8bit, i);
+#endif
+    Print<NEON::Kernels16>(stats.neon_16bit, i);
+#else
     Print<SSSE3::Kernels8>(stats.ssse3_8bit, i);
+#ifdef WASM
+    Print<SIMD128::Kernels8>(stats.wasm_8bit, i);
+#endif
     Print<AVX2::Kernels8>(stats.avx2_8bit, i);
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVXVNNI
+    Print<AVXVNNI::Kernels8>(stats.avxvnni_8bit, i);
+#endif
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
     Print<AVX512BW::Kernels8>(stats.avx512_8bit, i);
 #endif
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX512VNNI
     Print<AVX512VNNI::Kernels8>(stats.avx512vnni_8bit, i);
+#endif
+#ifdef INTGEMM_COMPILER_SUPPORTS_AMX
+    Print<AMX::Kernels8>(stats.amx_8bit, i);
 #endif
     Print<SSE2::Kernels16>(stats.sse2_16bit, i);
     Print<AVX2::Kernels16>(stats.avx2_16bit, i);
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
     Print<AVX512BW::Kernels16>(stats.avx512_16bit, i);
+#endif
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512VNNI
+    Print<AVX512VNNI::Kernels16>(stats.avx512vnni_16bit, i);
+#endif
 #endif
   }
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+  std::cerr << "AVX512 8bit row blocking, 100 samples..." << std::endl;
+  RowBlockingSweep<AVX512BW::Kernels8>();
+#endif
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512VNNI
+  std::cerr << "AVX512VNNI 8bit row blocking, 100 samples..." << std::endl;
+  RowBlockingSweep<AVX512VNNI::Kernels8>();
+#endif
+  std::cerr << "Bandwidth bound prefetch distances, 10 samples..." << std::endl;
+  PrefetchSweep<Int8>("Int8");
+  PrefetchSweep<Int16>("Int16");
+  std::cerr << "Thread pool by core type and schedule, 20 samples..." << std::endl;
+  ScheduleSweep();
   return 0;
 }
 
@@ -0,0 +1,62 @@
+#include "../intgemm/aligned.h"
+#include "../intgemm/intgemm.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace {
+
+using intgemm::Index;
+
+// Throughput of preparing a rows x cols B, counting the float input read.
+template <class Integer, class Prepare> void Bench(const char *name, const intgemm::AlignedVector<float> &B, Index rows, Index cols, Prepare prepare) {
+  intgemm::AlignedVector<Integer> prepared(B.size());
+  // Burn in, which also faults in the output.
+  prepare(B.begin(), prepared.begin(), 64.0f, rows, cols);
+  const std::size_t kTries = 5;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t t = 0; t < kTries; ++t) {
+    prepare(B.begin(), prepared.begin(), 64.0f, rows, cols);
+  }
+  double took = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / kTries;
+  double gigabytes = static_cast<double>(B.size()) * sizeof(float) / 1e9;
+  std::cout << std::setw(6) << rows << 'x' << std::setw(6) << std::left << cols << std::right << ' '
+    << std::fixed << std::setprecision(4) << std::setw(8) << took << " s "
+    << std::setw(7) << std::setprecision(2) << gigabytes / took << " GB/s " << name << std::endl;
+}
+
+void BenchQuantizedTransposed(const intgemm::AlignedVector<float> &B, Index rows, Index cols) {
+  intgemm::AlignedVector<int8_t> quantized(B.size()), prepared(B.size());
+  intgemm::Int8::Quantize(B.begin(), quantized.begin(), 64.0f, static_cast<Index>(B.size()));
+  intgemm::Int8::PrepareBQuantizedTransposed(quantized.begin(), prepared.begin(), rows, cols);
+  const std::size_t kTries = 5;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t t = 0; t < kTries; ++t) {
+    intgemm::Int8::PrepareBQuantizedTransposed(quantized.begin(), prepared.begin(), rows, cols);
+  }
+  double took = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / kTries;
+  double gigabytes = static_cast<double>(B.size()) / 1e9;
+  std::cout << std::setw(6) << rows << 'x' << std::setw(6) << std::left << cols << std::right << ' '
+    << std::fixed << std::setprecision(4) << std::setw(8) << took << " s "
+    << std::setw(7) << std::setprecision(2) << gigabytes / took << " GB/s Int8::PrepareBQuantizedTransposed" << std::endl;
+}
+
+} // namespace
+
+int main() {
+  const Index shapes[][2] = {{512, 512}, {1024, 4096}, {4096, 4096}, {8192, 8192}};
+  for (const auto &shape : shapes) {
+    const Index rows = shape[0], cols = shape[1];
+    intgemm::AlignedVector<float> B(static_cast<std::size_t>(rows) * cols);
+    std::mt19937 gen;
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    for (float &value : B) value = dist(gen);
+    Bench<int8_t>("Int8::PrepareB", B, rows, cols, intgemm::Int8::PrepareB);
+    Bench<int8_t>("Int8::PrepareBTransposed", B, rows, cols, intgemm::Int8::PrepareBTransposed);
+    BenchQuantizedTransposed(B, rows, cols);
+    Bench<int16_t>("Int16::PrepareB", B, rows, cols, intgemm::Int16::PrepareB);
+    Bench<int16_t>("Int16::PrepareBTransposed", B, rows, cols, intgemm::Int16::PrepareBTransposed);
+  }
+}
@@ -0,0 +1,304 @@
+/* Sweep production shapes, thread counts and callbacks through the
+ * dispatched Int8 and Int16 Multiply, reporting latency percentiles, GOP/s
+ * and the bandwidth of touching A, B and C once, as text, CSV or JSON.
+ *
+ *   benchmark_shapes [--shapes FILE] [--threads 1,4,8] [--callbacks write,bias]
+ *                    [--backends int8,int16] [--samples 50] [--warmup 3]
+ *                    [--format text|csv|json] [--output FILE] [MxKxN ...]
+ *
+ * A shapes file has one M K N (or MxKxN) per line; # starts a comment.  K
+ * and N round up to the backend's tile, which the output reports.  Threads
+ * come from a ThreadPool of that size, so OpenMP settings do not matter.
+ * Pin the process with taskset or numactl for stable numbers.
+ */
+#include "../intgemm/aligned.h"
+#include "../intgemm/callbacks.h"
+#include "../intgemm/executor.h"
+#include "../intgemm/intgemm.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace intgemm {
+namespace {
+
+struct Shape {
+  Index M, K, N;
+};
+
+struct Result {
+  std::string backend, callback;
+  Shape requested, run;
+  std::size_t threads, samples;
+  double min, median, p99, mean;
+  double gops, gbps;
+};
+
+[[noreturn]] void Usage(const char *program, const std::string &problem) {
+  std::cerr << problem << "\nUsage: " << program << " [--shapes FILE] [--threads 1,4,8] [--callbacks write,bias,relu,quantize] [--backends int8,int16] [--samples N] [--warmup N] [--format text|csv|json] [--output FILE] [MxKxN ...]" << std::endl;
+  std::exit(1);
+}
+
+std::vector<std::string> SplitCommas(const std::string &list) {
+  std::vector<std::string> ret;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) ret.push_back(item);
+  }
+  return ret;
+}
+
+// M K N or MxKxN.  False for blank or comment lines.
+bool ParseShape(std::string line, Shape &shape) {
+  line = line.substr(0, line.find('#'));
+  std::replace(line.begin(), line.end(), 'x', ' ');
+  std::replace(line.begin(), line.end(), 'X', ' ');
+  std::stringstream stream(line);
+  unsigned long M, K, N;
+  if (!(stream >> M)) return false;
+  if (!(stream >> K >> N) || !M || !K || !N) {
+    throw std::invalid_argument("Bad shape " + line);
+  }
+  shape.M = static_cast<Index>(M);
+  shape.K = static_cast<Index>(K);
+  shape.N = static_cast<Index>(N);
+  return true;
+}
+
+Index RoundUp(Index value, Index multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+// Nearest rank, on sorted times.
+double Percentile(const std::vector<double> &sorted, double fraction) {
+  std::size_t rank = static_cast<std::size_t>(fraction * sorted.size() + 0.999999);
+  return sorted[std::min(sorted.size(), std::max<std::size_t>(rank, 1)) - 1];
+}
+
+struct Options {
+  std::vector<Shape> shapes;
+  std::vector<std::size_t> threads;
+  std::vector<std::string> callbacks, backends;
+  std::size_t samples = 50, warmup = 3;
+  std::string format = "text";
+};
+
+template <class Multiply> void Time(const Options &options, Multiply multiply, Executor &executor, Result &result) {
+  for (std::size_t i = 0; i < options.warmup; ++i) multiply(executor);
+  std::vector<double> times(options.samples);
+  for (double &t : times) {
+    auto start = std::chrono::steady_clock::now();
+    multiply(executor);
+    t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  std::sort(times.begin(), times.end());
+  result.samples = times.size();
+  result.min = times.front();
+  result.median = Percentile(times, 0.5);
+  result.p99 = Percentile(times, 0.99);
+  double sum = 0.0;
+  for (double t : times) sum += t;
+  result.mean = sum / times.size();
+}
+
+template <class Backend> void RunShape(const Options &options, const Shape &requested, std::vector<Result> &results) {
+  using Integer = typename Backend::Integer;
+  // Tiles from the Int8 and Int16 comments: 1x64 or 1x32 A and 64x8 or 32x8 B.
+  const Index kWidthTile = 64 / sizeof(Integer);
+  const Shape run{requested.M, RoundUp(requested.K, kWidthTile), RoundUp(requested.N, 8)};
+  std::mt19937 gen(45678);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  AlignedVector<float> A(static_cast<std::size_t>(run.M) * run.K), B(static_cast<std::size_t>(run.K) * run.N), bias(run.N);
+  for (auto &it : A) it = dist(gen);
+  for (auto &it : B) it = dist(gen);
+  for (auto &it : bias) it = dist(gen);
+  const float quant_mult = 127.0f / 2.0f;
+  const float unquant_mult = 1.0f / (quant_mult * quant_mult);
+  AlignedVector<Integer> A_prepared(A.size()), B_prepared(B.size());
+  Backend::PrepareA(A.begin(), A_prepared.begin(), quant_mult, run.M, run.K);
+  Backend::PrepareB(B.begin(), B_prepared.begin(), quant_mult, run.K, run.N);
+  AlignedVector<float> C(static_cast<std::size_t>(run.M) * run.N);
+  AlignedVector<int8_t> C_quantized(C.size());
+
+  const Integer *A_ptr = A_prepared.begin(), *B_ptr = B_prepared.begin();
+  for (std::size_t threads : options.threads) {
+    ThreadPool pool(threads);
+    for (const std::string &callback : options.callbacks) {
+      Result result;
+      result.backend = Backend::kName;
+      result.callback = callback;
+      result.requested = requested;
+      result.run = run;
+      result.threads = pool.Threads();
+      std::size_t output_bytes = C.size() * sizeof(float);
+      if (callback == "write") {
+        Time(options, [&](Executor &executor) {
+          Backend::Multiply(A_ptr, B_ptr, run.M, run.K, run.N, callbacks::UnquantizeAndWrite(unquant_mult, C.begin()), executor);
+        }, pool, result);
+      } else if (callback == "bias") {
+        Time(options, [&](Executor &executor) {
+          Backend::Multiply(A_ptr, B_ptr, run.M, run.K, run.N, callbacks::UnquantizeAndAddBiasAndWrite(unquant_mult, bias.begin(), C.begin()), executor);
+        }, pool, result);
+      } else if (callback == "relu") {
+        Time(options, [&](Executor &executor) {
+          Backend::Multiply(A_ptr, B_ptr, run.M, run.K, run.N, callbacks::UnquantizeAndAddBiasAndWriteRelu(unquant_mult, bias.begin(), C.begin()), executor);
+        }, pool, result);
+      } else if (callback == "quantize") {
+        output_bytes = C_quantized.size();
+        Time(options, [&](Executor &executor) {
+          Backend::Multiply(A_ptr, B_ptr, run.M, run.K, run.N, callbacks::UnquantizeAddBiasActivateAndQuantize<int8_t>(unquant_mult, bias.begin(), quant_mult, C_quantized.begin()), executor);
+        }, pool, result);
+      } else {
+        throw std::invalid_argument("Unknown callback " + callback);
+      }
+      // Work and traffic of the requested shape, so padding counts as overhead.
+      const double ops = 2.0 * requested.M * requested.K * requested.N;
+      const double bytes = static_cast<double>(A_prepared.size() + B_prepared.size()) * sizeof(Integer) + output_bytes + (callback == "write" ? 0 : bias.size() * sizeof(float));
+      result.gops = ops / result.median / 1e9;
+      result.gbps = bytes / result.median / 1e9;
+      results.push_back(result);
+    }
+  }
+}
+
+void WriteText(const std::vector<Result> &results, std::ostream &out) {
+  out << std::setw(20) << std::left << "backend" << std::setw(10) << "callback" << std::right
+    << std::setw(20) << "MxKxN" << std::setw(8) << "threads"
+    << std::setw(12) << "median ms" << std::setw(12) << "p99 ms" << std::setw(10) << "GOP/s" << std::setw(10) << "GB/s" << '\n';
+  for (const Result &r : results) {
+    std::stringstream shape;
+    shape << r.requested.M << 'x' << r.requested.K << 'x' << r.requested.N;
+    out << std::setw(20) << std::left << r.backend << std::setw(10) << r.callback << std::right
+      << std::setw(20) << shape.str() << std::setw(8) << r.threads << std::fixed
+      << std::setw(12) << std::setprecision(4) << r.median * 1e3 << std::setw(12) << r.p99 * 1e3
+      << std::setw(10) << std::setprecision(1) << r.gops << std::setw(10) << r.gbps << '\n';
+  }
+}
+
+void WriteCSV(const std::vector<Result> &results, std::ostream &out) {
+  out << "backend,callback,M,K,N,run_K,run_N,threads,samples,min_s,median_s,p99_s,mean_s,gops,gbps\n";
+  out << std::setprecision(9);
+  for (const Result &r : results) {
+    out << r.backend << ',' << r.callback << ','
+      << r.requested.M << ',' << r.requested.K << ',' << r.requested.N << ',' << r.run.K << ',' << r.run.N << ','
+      << r.threads << ',' << r.samples << ','
+      << r.min << ',' << r.median << ',' << r.p99 << ',' << r.mean << ',' << r.gops << ',' << r.gbps << '\n';
+  }
+}
+
+void WriteJSON(const std::vector<Result> &results, std::ostream &out) {
+  // Names are fixed strings without quotes or backslashes, so need no escaping.
+  out << std::setprecision(9) << "{\n  \"int8\": \"" << Int8::kName << "\",\n  \"int16\": \"" << Int16::kName
+    << "\",\n  \"hardware_concurrency\": " << std::thread::hardware_concurrency() << ",\n  \"results\": [";
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const Result &r = results[i];
+    out << (i ? ",\n" : "\n") << "    {\"backend\": \"" << r.backend << "\", \"callback\": \"" << r.callback
+      << "\", \"M\": " << r.requested.M << ", \"K\": " << r.requested.K << ", \"N\": " << r.requested.N
+      << ", \"run_K\": " << r.run.K << ", \"run_N\": " << r.run.N
+      << ", \"threads\": " << r.threads << ", \"samples\": " << r.samples
+      << ", \"min_s\": " << r.min << ", \"median_s\": " << r.median << ", \"p99_s\": " << r.p99 << ", \"mean_s\": " << r.mean
+      << ", \"gops\": " << r.gops << ", \"gbps\": " << r.gbps << '}';
+  }
+  out << "\n  ]\n}\n";
+}
+
+} // namespace
+} // namespace intgemm
+
+int main(int argc, char **argv) {
+  using namespace intgemm;
+  Options options;
+  std::string output;
+  try {
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg = argv[i];
+      if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+        if (i + 1 == argc) Usage(argv[0], "Missing value for " + arg);
+        const std::string value = argv[++i];
+        if (arg == "--shapes") {
+          std::ifstream file(value);
+          if (!file) Usage(argv[0], "Cannot read " + value);
+          std::string line;
+          Shape shape;
+          while (std::getline(file, line)) {
+            if (ParseShape(line, shape)) options.shapes.push_back(shape);
+          }
+        } else if (arg == "--threads") {
+          for (const std::string &t : SplitCommas(value)) options.threads.push_back(std::stoul(t));
+        } else if (arg == "--callbacks") {
+          options.callbacks = SplitCommas(value);
+        } else if (arg == "--backends") {
+          options.backends = SplitCommas(value);
+        } else if (arg == "--samples") {
+          options.samples = std::max<std::size_t>(1, std::stoul(value));
+        } else if (arg == "--warmup") {
+          options.warmup = std::stoul(value);
+        } else if (arg == "--format") {
+          options.format = value;
+        } else if (arg == "--output") {
+          output = value;
+        } else {
+          Usage(argv[0], "Unknown option " + arg);
+        }
+      } else {
+        Shape shape;
+        if (ParseShape(arg, shape)) options.shapes.push_back(shape);
+      }
+    }
+  } catch (const std::exception &e) {
+    Usage(argv[0], e.what());
+  }
+  if (options.format != "text" && options.format != "csv" && options.format != "json") Usage(argv[0], "Unknown format " + options.format);
+  if (options.shapes.empty()) {
+    // Decoder shapes from benchmark.cc.
+    options.shapes = {{8, 256, 256}, {8, 2048, 256}, {8, 256, 2048}, {320, 256, 256}, {472, 256, 256}, {248, 256, 256}, {200, 256, 256}, {256, 256, 256}, {512, 512, 512}, {1024, 1024, 1024}};
+  }
+  if (options.threads.empty()) options.threads.push_back(1);
+  if (options.callbacks.empty()) options.callbacks.push_back("write");
+  if (options.backends.empty()) options.backends = {"int8", "int16"};
+
+  std::vector<Result> results;
+  try {
+    for (const Shape &shape : options.shapes) {
+      for (const std::string &backend : options.backends) {
+        if (backend == "int8") {
+          RunShape<Int8>(options, shape, results);
+        } else if (backend == "int16") {
+          RunShape<Int16>(options, shape, results);
+        } else {
+          Usage(argv[0], "Unknown backend " + backend);
+        }
+      }
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  std::ofstream file;
+  if (!output.empty()) {
+    file.open(output);
+    if (!file) Usage(argv[0], "Cannot write " + output);
+  }
+  std::ostream &out = output.empty() ? std::cout : file;
+  if (options.format == "csv") {
+    WriteCSV(results, out);
+  } else if (options.format == "json") {
+    WriteJSON(results, out);
+  } else {
+    WriteText(results, out);
+  }
+  return 0;
+}
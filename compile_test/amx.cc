@@ -0,0 +1,26 @@
+// AMX-INT8 tile instructions arrived in gcc 11 and clang 12.
+#include <immintrin.h>
+
+#include <stdint.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#elif defined(__INTEL_COMPILER)
+__attribute__ ((target ("avx512f")))
+#else
+__attribute__ ((target ("avx512f,avx512bw,avx512dq,avx512vnni,amx-tile,amx-int8")))
+#endif
+int Foo(const void *config, const int8_t *a, const int8_t *b, int32_t *c) {
+  _tile_loadconfig(config);
+  _tile_zero(0);
+  _tile_loadd(1, a, 64);
+  _tile_loadd(2, b, 64);
+  _tile_dpbssd(0, 1, 2);
+  _tile_dpbusd(0, 1, 2);
+  _tile_stored(0, c, 64);
+  _tile_release();
+  return c[0];
+}
+
+int main() {
+  return 0;
+}
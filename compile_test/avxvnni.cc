@@ -0,0 +1,27 @@
+// AVX-VNNI (VEX-encoded vpdpbusd) arrived in gcc 11, clang 12 and MSVC 2019 16.10.
+#include <immintrin.h>
+
+// clang-cl bug doesn't include these headers when pretending to be MSVC
+// https://github.com/llvm/llvm-project/blob/e9a294449575a1e1a0daca470f64914695dc9adc/clang/lib/Headers/immintrin.h#L69-L72
+#if defined(_MSC_VER) && defined(__clang__)
+#include <avxintrin.h>
+#include <avx2intrin.h>
+#include <smmintrin.h>
+#include <avxvnniintrin.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#elif defined(__INTEL_COMPILER)
+__attribute__ ((target ("avx2")))
+#else
+__attribute__ ((target ("avx2,avxvnni")))
+#endif
+bool Foo() {
+  __m256i value = _mm256_set1_epi32(1);
+  value = _mm256_dpbusds_avx_epi32(value, value, value);
+  return *(int*)&value;
+}
+
+int main() {
+  return Foo();
+}
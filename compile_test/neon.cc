@@ -0,0 +1,16 @@
+// AArch64 Advanced SIMD.  vaddvq_s32 and vmull_high_s8 do not exist on 32-bit
+// ARM, so this also rejects armv7 builds.
+#include <arm_neon.h>
+
+int Foo(const int8_t *a, const int8_t *b) {
+  int8x16_t x = vld1q_s8(a);
+  int8x16_t y = vld1q_s8(b);
+  int16x8_t product = vmull_s8(vget_low_s8(x), vget_low_s8(y));
+  int32x4_t sum = vpaddlq_s16(product);
+  sum = vpadalq_s16(sum, vmull_high_s8(x, y));
+  return vaddvq_s32(sum);
+}
+
+int main() {
+  return 0;
+}
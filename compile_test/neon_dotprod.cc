@@ -0,0 +1,18 @@
+// Armv8.2 dot product (sdot), optional before Armv8.4.
+#include <arm_neon.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#elif defined(__clang__)
+__attribute__ ((target ("dotprod")))
+#else
+__attribute__ ((target ("+dotprod")))
+#endif
+int Foo(const int8_t *a, const int8_t *b) {
+  int32x4_t sum = vdupq_n_s32(0);
+  sum = vdotq_s32(sum, vld1q_s8(a), vld1q_s8(b));
+  return vaddvq_s32(sum);
+}
+
+int main() {
+  return 0;
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdlib>
 #include <new>
+#include <utility>
 #ifdef _MSC_VER
 // Ensure _HAS_EXCEPTIONS is defined
 #include <vcruntime.h>
@@ -15,12 +16,37 @@
 
 namespace intgemm {
 
+// Page size for AlignedVector memory from AllocatePages.  Huge2MB and
+// Huge1GB use reserved huge pages (MAP_HUGETLB) and fall back to
+// Transparent, which asks the kernel to back the memory with transparent
+// huge pages (madvise).  Big prepared B matrices take far fewer TLB entries.
+enum class Pages { Small, Transparent, Huge2MB, Huge1GB };
+
+// NUMA node the pages come from.  FirstTouch leaves it to the thread that
+// first writes each page, as PrepareB's threads do; Interleave spreads pages
+// over all nodes and Node binds them to one.
+enum class Placement { FirstTouch, Interleave, Node };
+
+struct MemoryPolicy {
+  Pages pages = Pages::Small;
+  Placement placement = Placement::FirstTouch;
+  // For Placement::Node.
+  int node = 0;
+};
+
+// Page aligned memory of at least bytes following policy, from numa.cc.
+// mapped is set to what to hand FreePages.  Outside Linux the policy is
+// ignored.  Huge pages and placement are hints: they may be unavailable and
+// the memory is still returned.
+void *AllocatePages(std::size_t bytes, const MemoryPolicy &policy, std::size_t &mapped);
+void FreePages(void *mem, std::size_t mapped);
+
 template <class T> class AlignedVector {
   public:
-    AlignedVector() : mem_(nullptr), size_(0) {}
+    AlignedVector() : mem_(nullptr), size_(0), mapped_(0) {}
 
     explicit AlignedVector(std::size_t size, std::size_t alignment = 64 /* CPU cares about this */)
-      : size_(size) {
+      : size_(size), mapped_(0) {
 #ifdef _MSC_VER
       mem_ = static_cast<T*>(_aligned_malloc(size * sizeof(T), alignment));
       if (!mem_) {
@@ -41,16 +67,23 @@ template <class T> class AlignedVector {
 #endif
     }
 
-    AlignedVector(AlignedVector &&from) : mem_(from.mem_), size_(from.size_) {
+    // Memory from AllocatePages, aligned to at least a page.
+    AlignedVector(std::size_t size, const MemoryPolicy &policy)
+      : mem_(nullptr), size_(size), mapped_(0) {
+      mem_ = static_cast<T*>(AllocatePages(size * sizeof(T), policy, mapped_));
+    }
+
+    AlignedVector(AlignedVector &&from) : mem_(from.mem_), size_(from.size_), mapped_(from.mapped_) {
       from.mem_ = nullptr;
       from.size_ = 0;
+      from.mapped_ = 0;
     }
 
+    // Swap so that from frees what this held.
     AlignedVector &operator=(AlignedVector &&from) {
-      mem_ = from.mem_;
-      size_ = from.size_;
-      from.mem_ = nullptr;
-      from.size_ = 0;
+      std::swap(mem_, from.mem_);
+      std::swap(size_, from.size_);
+      std::swap(mapped_, from.mapped_);
       return *this;
     }
 
@@ -58,6 +91,10 @@ template <class T> class AlignedVector {
     AlignedVector& operator=(const AlignedVector&) = delete;
 
     ~AlignedVector() {
+      if (mapped_) {
+        FreePages(mem_, mapped_);
+        return;
+      }
 #ifdef _MSC_VER
       _aligned_free(mem_);
 #else
@@ -81,6 +118,8 @@ template <class T> class AlignedVector {
   private:
     T *mem_;
     std::size_t size_;
+    // Bytes mapped by AllocatePages, 0 for posix_memalign.
+    std::size_t mapped_;
 };
 
 } // namespace intgemm
@@ -0,0 +1,409 @@
+#pragma once
+
+#include "intgemm/intgemm_config.h"
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AMX
+#include "aligned.h"
+#include "avx512vnni_gemm.h"
+#include "multiply.h"
+#include "partition.h"
+#include "types.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+namespace intgemm {
+namespace AMX {
+
+/* AMX has 8 tile registers of up to 16 rows x 64 bytes.  TDPBSSD/TDPBUSD
+ * multiply an M x 64 tile of A by a 16 x (4N) tile of B into an M x N tile of
+ * 32-bit sums, where each 4-byte group in a row of B holds 4 consecutive
+ * values of the shared dimension for one column.
+ *
+ * B is laid out in 8-column strips like the other backends, so column ranges
+ * from ChoosePartition and SelectColumnsB work without knowing B_cols.
+ * Within a strip, each group of 4 rows of B is stored as 8 columns x 4
+ * bytes:
+ *   strip s, rows [k, k + 4): B + s * 8 * width + k * 8, column c at + 4c.
+ * A 64-row slice of a strip is then exactly one tile (16 x 32 bytes).
+ *
+ * Each block of the output is 32 rows x 16 columns in four tiles:
+ *   tmm0 tmm1   C for rows [0, 16) and strips 0, 1
+ *   tmm2 tmm3   C for rows [16, 32)
+ *   tmm4 tmm5   A for rows [0, 16) and [16, 32)
+ *   tmm6 tmm7   B for strips 0 and 1
+ */
+struct TileConfig {
+  uint8_t palette;
+  uint8_t start_row;
+  uint8_t reserved[14];
+  uint16_t colsb[16];
+  uint8_t rows[16];
+
+  // rows0 rows of A in the first half of a block, rows1 in the second.
+  void Set(Index rows0, Index rows1) {
+    std::memset(this, 0, sizeof(TileConfig));
+    palette = 1;
+    for (int t = 0; t < 2; ++t) {
+      rows[t] = static_cast<uint8_t>(rows0);
+      colsb[t] = 32;
+      if (rows1) {
+        rows[2 + t] = static_cast<uint8_t>(rows1);
+        colsb[2 + t] = 32;
+      }
+    }
+    rows[4] = static_cast<uint8_t>(rows0);
+    colsb[4] = 64;
+    if (rows1) {
+      rows[5] = static_cast<uint8_t>(rows1);
+      colsb[5] = 64;
+    }
+    for (int t = 6; t < 8; ++t) {
+      rows[t] = 16;
+      colsb[t] = 32;
+    }
+  }
+};
+static_assert(sizeof(TileConfig) == 64, "AMX tile configuration is 64 bytes");
+
+struct Kernels8 : public AVX512VNNI::Kernels8 {
+  // Prepared B is in 8-column strips of width x 8 bytes.
+  static const Index kBTileRow = 64;
+  static const Index kBTileCol = 8;
+
+  // Strips [c_begin / 8, c_end / 8) of B from its transpose.
+  INTGEMM_AVX512BW static void PrepareBQuantizedTransposedRange(const int8_t *input, int8_t *output, Index inner, Index c_begin, Index c_end) {
+    output += static_cast<std::size_t>(c_begin) * inner;
+    for (Index c = c_begin; c < c_end; c += 8) {
+      for (Index k = 0; k < inner; k += 4) {
+        for (Index n = 0; n < 8; ++n, output += 4) {
+          std::memcpy(output, input + (c + n) * inner + k, 4);
+        }
+      }
+    }
+  }
+
+  INTGEMM_AVX512BW static void PrepareBQuantizedTransposedThread(const int8_t *input, int8_t *output, Index inner, Index B_untransposed_cols) {
+    INTGEMM_OMP_FOR
+    for (Index c = 0; c < B_untransposed_cols; c += kPrepareBPanelCols) {
+      PrepareBQuantizedTransposedRange(input, output, inner, c, std::min<Index>(c + kPrepareBPanelCols, B_untransposed_cols));
+    }
+  }
+
+  INTGEMM_AVX512BW static void PrepareBQuantizedTransposed(const int8_t *input, int8_t *output, Index inner, Index B_untransposed_cols) {
+    assert(inner % kBTileRow == 0);
+    assert(B_untransposed_cols % kBTileCol == 0);
+    INTGEMM_OMP_PARALLEL
+    {
+      PrepareBQuantizedTransposedThread(input, output, inner, B_untransposed_cols);
+    }
+  }
+
+  INTGEMM_AVX512BW static void PrepareBTransposed(const float *input, int8_t *output, float quant_mult, Index inner, Index B_untransposed_cols) {
+    AlignedVector<int8_t> quantized(inner * B_untransposed_cols);
+    Quantize(input, quantized.begin(), quant_mult, inner * B_untransposed_cols);
+    PrepareBQuantizedTransposed(quantized.begin(), output, inner, B_untransposed_cols);
+  }
+
+  // Lay out strips [c_begin / 8, c_end / 8) of quantized B a panel at a
+  // time, see kPrepareBPanelCols.
+  INTGEMM_AVX512BW static void RelayoutB(const int8_t *quantized, int8_t *output, Index rows, Index cols, Index c_begin, Index c_end) {
+    for (Index panel = c_begin; panel < c_end; panel += kPrepareBPanelCols) {
+      const Index panel_end = std::min<Index>(panel + kPrepareBPanelCols, c_end);
+      for (Index k = 0; k < rows; k += 4) {
+        const int8_t *row = quantized + static_cast<std::size_t>(k) * cols;
+        for (Index c = panel; c < panel_end; c += 8) {
+          // Rows k to k + 3 of columns c to c + 7, interleaved so each
+          // column's 4 bytes are together.
+          __m128i row0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + c));
+          __m128i row1 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + cols + c));
+          __m128i row2 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + 2 * cols + c));
+          __m128i row3 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + 3 * cols + c));
+          __m128i rows01 = _mm_unpacklo_epi8(row0, row1);
+          __m128i rows23 = _mm_unpacklo_epi8(row2, row3);
+          __m128i *out = reinterpret_cast<__m128i*>(output + static_cast<std::size_t>(c) * rows + k * 8);
+          _mm_storeu_si128(out, _mm_unpacklo_epi16(rows01, rows23));
+          _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(rows01, rows23));
+        }
+      }
+    }
+  }
+
+  INTGEMM_AVX512BW static void RelayoutBThread(const int8_t *quantized, int8_t *output, Index rows, Index cols) {
+    INTGEMM_OMP_FOR
+    for (Index c = 0; c < cols; c += kPrepareBPanelCols) {
+      RelayoutB(quantized, output, rows, cols, c, std::min<Index>(c + kPrepareBPanelCols, cols));
+    }
+  }
+
+  INTGEMM_AVX512BW static void PrepareB(const float *input, int8_t *output, float quant_mult, Index rows, Index cols) {
+    assert(rows % kBTileRow == 0);
+    assert(cols % kBTileCol == 0);
+    AlignedVector<int8_t> quantized(rows * cols);
+    Quantize(input, quantized.begin(), quant_mult, rows * cols);
+    INTGEMM_OMP_PARALLEL
+    {
+      RelayoutBThread(quantized.begin(), output, rows, cols);
+    }
+  }
+
+  // Selected columns [begin, end) of cols, each group of 8 one strip of output.
+  INTGEMM_AVX512BW static void SelectColumnsBRange(const int8_t *input, int8_t *output, Index rows, const Index *cols, Index begin, Index end) {
+    output += static_cast<std::size_t>(begin) * rows;
+    for (Index group = begin; group < end; group += 8) {
+      for (Index k = 0; k < rows; k += 4) {
+        for (Index n = 0; n < 8; ++n, output += 4) {
+          const Index col = cols[group + n];
+          std::memcpy(output, input + (col / 8) * 8 * rows + k * 8 + (col % 8) * 4, 4);
+        }
+      }
+    }
+  }
+
+  INTGEMM_AVX512BW static void SelectColumnsBThread(const int8_t *input, int8_t *output, Index rows, const Index *cols, Index count) {
+    INTGEMM_OMP_FOR
+    for (Index begin = 0; begin < count; begin += kSelectColumnsChunk) {
+      SelectColumnsBRange(input, output, rows, cols, begin, std::min<Index>(begin + kSelectColumnsChunk, count));
+    }
+  }
+
+  INTGEMM_AVX512BW static void SelectColumnsB(const int8_t *input, int8_t *output, Index rows, const Index *cols_begin, const Index *cols_end) {
+    assert((cols_end - cols_begin) % 8 == 0);
+    INTGEMM_OMP_PARALLEL
+    {
+      SelectColumnsBThread(input, output, rows, cols_begin, static_cast<Index>(cols_end - cols_begin));
+    }
+  }
+
+ private:
+  // Multiply a block of up to 32 rows of A, lda bytes apart, by one or two
+  // strips of B over [k_begin, k_end) of the shared dimension and run the
+  // callback on the result.  Tiles must be configured for the rows.
+  template <bool kUnsignedA, bool kTwoRows, bool kTwoStrips, class CallbackImpl>
+  INTGEMM_AMX static inline void MultiplyBlock(const int8_t *A, Index lda, Index width, Index k_begin, Index k_end, const int8_t *B0, Index block_begin, Index block_rows, Index B0_colidx, Index A_rows, Index B_cols, CallbackImpl &callback_impl) {
+    const int8_t *A1 = A + 16 * lda;
+    const int8_t *B1 = B0 + 8 * width;
+    _tile_zero(0);
+    if (kTwoStrips) _tile_zero(1);
+    if (kTwoRows) _tile_zero(2);
+    if (kTwoRows && kTwoStrips) _tile_zero(3);
+    for (Index k = k_begin; k < k_end; k += 64) {
+      _tile_loadd(4, A + k, lda);
+      _tile_loadd(6, B0 + k * 8, 32);
+      if (kTwoRows) _tile_loadd(5, A1 + k, lda);
+      if (kTwoStrips) _tile_loadd(7, B1 + k * 8, 32);
+      if (kUnsignedA) {
+        _tile_dpbusd(0, 4, 6);
+        if (kTwoStrips) _tile_dpbusd(1, 4, 7);
+        if (kTwoRows) _tile_dpbusd(2, 5, 6);
+        if (kTwoRows && kTwoStrips) _tile_dpbusd(3, 5, 7);
+      } else {
+        _tile_dpbssd(0, 4, 6);
+        if (kTwoStrips) _tile_dpbssd(1, 4, 7);
+        if (kTwoRows) _tile_dpbssd(2, 5, 6);
+        if (kTwoRows && kTwoStrips) _tile_dpbssd(3, 5, 7);
+      }
+    }
+    alignas(64) int32_t C[32][16];
+    _tile_stored(0, &C[0][0], sizeof(C[0]));
+    if (kTwoStrips) _tile_stored(1, &C[0][8], sizeof(C[0]));
+    if (kTwoRows) _tile_stored(2, &C[16][0], sizeof(C[0]));
+    if (kTwoRows && kTwoStrips) _tile_stored(3, &C[16][8], sizeof(C[0]));
+    for (Index r = 0; r < block_rows; ++r) {
+      callback_impl.Run(_mm256_load_si256(reinterpret_cast<const __m256i*>(&C[r][0])), callbacks::OutputBufferInfo(block_begin + r, B0_colidx, A_rows, B_cols));
+      if (kTwoStrips) {
+        callback_impl.Run(_mm256_load_si256(reinterpret_cast<const __m256i*>(&C[r][8])), callbacks::OutputBufferInfo(block_begin + r, B0_colidx + 8, A_rows, B_cols));
+      }
+    }
+  }
+
+  template <bool kUnsignedA, bool kTwoRows, class CallbackImpl>
+  INTGEMM_AMX static inline void MultiplyBlockRow(const int8_t *A, Index lda, Index width, Index k_begin, Index k_end, const int8_t *B, Index block_begin, Index block_rows, Index A_rows, Index B_cols, Index B_col_begin, Index B_col_end, CallbackImpl &callback_impl) {
+    Index col = B_col_begin;
+    for (; col + 16 <= B_col_end; col += 16) {
+      MultiplyBlock<kUnsignedA, kTwoRows, true>(A, lda, width, k_begin, k_end, B + col * width, block_begin, block_rows, col, A_rows, B_cols, callback_impl);
+    }
+    if (col < B_col_end) {
+      MultiplyBlock<kUnsignedA, kTwoRows, false>(A, lda, width, k_begin, k_end, B + col * width, block_begin, block_rows, col, A_rows, B_cols, callback_impl);
+    }
+  }
+
+  // Rows [A_row_begin, A_row_end) by columns [B_col_begin, B_col_end) on the
+  // calling thread, over [k_begin, k_end) of the shared dimension, multiples
+  // of 64.  Column bounds must be multiples of 8.  Row r of A starts at
+  // A_in + r * lda.
+  template <bool kUnsignedA, class AType, typename Callback>
+  INTGEMM_AMX static void MultiplyRange(const AType *A_in, Index lda, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end, Index k_begin, Index k_end) {
+    assert(width % 64 == 0);
+    assert(k_begin % 64 == 0 && k_end % 64 == 0 && k_end <= width);
+    assert(lda >= width && lda % 64 == 0);
+    assert(B_cols % 8 == 0);
+    assert(A_row_end <= A_rows);
+    assert(B_col_begin % 8 == 0 && B_col_end % 8 == 0 && B_col_end <= B_cols);
+    const int8_t *A = reinterpret_cast<const int8_t*>(A_in);
+    auto callback_impl = callbacks::CallbackImpl<CPUType::AVX2, Callback>(callback);
+    alignas(64) TileConfig config;
+    // Only the last block of rows can be short, so this reconfigures at most once.
+    Index configured_rows = 0;
+    for (Index block_begin = A_row_begin; block_begin < A_row_end; block_begin += 32) {
+      const Index block_rows = std::min<Index>(32, A_row_end - block_begin);
+      if (block_rows != configured_rows) {
+        config.Set(std::min<Index>(16, block_rows), block_rows > 16 ? block_rows - 16 : 0);
+        _tile_loadconfig(&config);
+        configured_rows = block_rows;
+      }
+      const int8_t *A_block = A + block_begin * lda;
+      if (block_rows > 16) {
+        MultiplyBlockRow<kUnsignedA, true>(A_block, lda, width, k_begin, k_end, B, block_begin, block_rows, A_rows, B_cols, B_col_begin, B_col_end, callback_impl);
+      } else {
+        MultiplyBlockRow<kUnsignedA, false>(A_block, lda, width, k_begin, k_end, B, block_begin, block_rows, A_rows, B_cols, B_col_begin, B_col_end, callback_impl);
+      }
+    }
+    // Leaving tiles configured makes every context switch save 8KB of state.
+    if (configured_rows) _tile_release();
+  }
+
+  // MultiplyRange with A in floats, quantized a block at a time into a
+  // per-thread buffer as in INTGEMM_MULTIPLY_FLOAT_A.
+  template <bool kUnsignedA, typename Callback>
+  INTGEMM_AMX static void MultiplyRangeFloatA(const float *A, float quant_mult, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) {
+    assert(width % 64 == 0);
+    assert(B_cols % 8 == 0);
+    assert(A_row_end <= A_rows);
+    assert(B_col_begin % 8 == 0 && B_col_end % 8 == 0 && B_col_end <= B_cols);
+    if (A_row_begin >= A_row_end || B_col_begin >= B_col_end) return;
+    auto callback_impl = callbacks::CallbackImpl<CPUType::AVX2, Callback>(callback);
+    int8_t *block = ThreadBlockBuffer<int8_t>(static_cast<std::size_t>(std::min<Index>(32, A_row_end - A_row_begin)) * width);
+    alignas(64) TileConfig config;
+    Index configured_rows = 0;
+    for (Index block_begin = A_row_begin; block_begin < A_row_end; block_begin += 32) {
+      const Index block_rows = std::min<Index>(32, A_row_end - block_begin);
+      const float *A_block = A + static_cast<std::size_t>(block_begin) * width;
+      // On this thread only: Quantize's parallel region would nest.
+      if (kUnsignedA) {
+        QuantizeSerial(A_block, reinterpret_cast<uint8_t*>(block), quant_mult, static_cast<std::size_t>(block_rows) * width);
+      } else {
+        QuantizeSerial(A_block, block, quant_mult, static_cast<std::size_t>(block_rows) * width);
+      }
+      if (block_rows != configured_rows) {
+        config.Set(std::min<Index>(16, block_rows), block_rows > 16 ? block_rows - 16 : 0);
+        _tile_loadconfig(&config);
+        configured_rows = block_rows;
+      }
+      if (block_rows > 16) {
+        MultiplyBlockRow<kUnsignedA, true>(block, width, width, 0, width, B, block_begin, block_rows, A_rows, B_cols, B_col_begin, B_col_end, callback_impl);
+      } else {
+        MultiplyBlockRow<kUnsignedA, false>(block, width, width, 0, width, B, block_begin, block_rows, A_rows, B_cols, B_col_begin, B_col_end, callback_impl);
+      }
+    }
+    _tile_release();
+  }
+
+ public:
+  template <typename Callback>
+  INTGEMM_AMX static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) {
+    MultiplyRange<false>(A, width, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end, 0, width);
+  }
+
+  template <typename Callback>
+  INTGEMM_AMX static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    Multiply<Callback>(A, width, B, A_rows, width, B_cols, callback);
+  }
+
+  template <typename Callback>
+  INTGEMM_AMX static void Multiply(const int8_t *A, Index lda, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) {
+    MultiplyRange<false>(A, lda, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end, 0, width);
+  }
+
+  template <typename Callback>
+  INTGEMM_AMX static void Multiply(const int8_t *A, Index lda, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    OMPWrapRanges(ChoosePartition(A_rows, B_cols, OMPTasks()), [&](Index row_begin, Index row_end, Index col_begin, Index col_end) {
+      MultiplyRange<false>(A, lda, B, A_rows, width, B_cols, callback, row_begin, row_end, col_begin, col_end, 0, width);
+    });
+  }
+
+  // See INTGEMM_MULTIPLY_FIXED.
+  template <Index kWidth, Index kBCols, typename Callback>
+  INTGEMM_FLATTEN INTGEMM_AMX static void MultiplyFixed(const int8_t *A, const int8_t *B, Index A_rows, Callback callback) {
+    static_assert(kWidth % 64 == 0 && kBCols % 8 == 0, "MultiplyFixed width must be a multiple of 64 and B_cols of 8");
+    MultiplyRange<false>(A, kWidth, B, A_rows, kWidth, kBCols, callback, 0, A_rows, 0, kBCols, 0, kWidth);
+  }
+
+  // See INTGEMM_MULTIPLY_SPLIT_K.  ReducePartials is AVX512VNNI's.
+  template <typename Callback>
+  INTGEMM_AMX static void MultiplySlice(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index k_begin, Index k_end, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) {
+    MultiplyRange<false>(A, width, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end, k_begin, k_end);
+  }
+
+  template <typename Callback>
+  INTGEMM_AMX static void MultiplyFloatA(const float *A, float quant_mult, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) {
+    MultiplyRangeFloatA<false>(A, quant_mult, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end);
+  }
+
+  template <typename Callback>
+  INTGEMM_AMX static void MultiplyFloatA(const float *A, float quant_mult, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    OMPWrapRanges(ChoosePartition(A_rows, B_cols, OMPTasks()), [&](Index row_begin, Index row_end, Index col_begin, Index col_end) {
+      MultiplyRangeFloatA<false>(A, quant_mult, B, A_rows, width, B_cols, callback, row_begin, row_end, col_begin, col_end);
+    });
+  }
+
+  template <typename Callback>
+  INTGEMM_AMX static void Multiply8Shift(const uint8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) {
+    MultiplyRange<true>(A, width, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end, 0, width);
+  }
+
+  template <typename Callback>
+  INTGEMM_AMX static void Multiply8Shift(const uint8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    OMPWrapRanges(ChoosePartition(A_rows, B_cols, OMPTasks()), [&](Index row_begin, Index row_end, Index col_begin, Index col_end) {
+      MultiplyRange<true>(A, width, B, A_rows, width, B_cols, callback, row_begin, row_end, col_begin, col_end, 0, width);
+    });
+  }
+
+  template <typename Callback>
+  INTGEMM_AMX static void Multiply8ShiftFloatA(const float *A, float quant_mult, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) {
+    MultiplyRangeFloatA<true>(A, quant_mult, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end);
+  }
+
+  template <typename Callback>
+  INTGEMM_AMX static void Multiply8ShiftFloatA(const float *A, float quant_mult, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    OMPWrapRanges(ChoosePartition(A_rows, B_cols, OMPTasks()), [&](Index row_begin, Index row_end, Index col_begin, Index col_end) {
+      MultiplyRangeFloatA<true>(A, quant_mult, B, A_rows, width, B_cols, callback, row_begin, row_end, col_begin, col_end);
+    });
+  }
+
+  // Column sums of B.  A register holds 4 rows by 8 columns twice, so
+  // vpdpbusd with ones sums each column in two lanes.
+  template <typename Callback>
+  INTGEMM_AVX512VNNI static void PrepareBias(const int8_t *B, Index width, Index B_cols, Callback callback) {
+    assert(width % 64 == 0);
+    assert(B_cols % 8 == 0);
+    assert(reinterpret_cast<uintptr_t>(B) % sizeof(Register) == 0);
+    auto callback_impl = callbacks::CallbackImpl<CPUType::AVX2, Callback>(callback);
+    const Register ones = set1_epi8<Register>(1);
+    const Index strip_registers = width * 8 / sizeof(Register);
+#pragma omp for
+    for (Index B0_colidx = 0; B0_colidx < B_cols; B0_colidx += 8) {
+      const Register *B_live = reinterpret_cast<const Register*>(B + B0_colidx * width);
+      const Register *B_end = B_live + strip_registers;
+      Register sum0 = setzero_si<Register>(), sum1 = setzero_si<Register>();
+      for (; B_live != B_end; B_live += 2) {
+        AVX512VNNI::VNNI8(sum0, ones, *B_live);
+        AVX512VNNI::VNNI8(sum1, ones, *(B_live + 1));
+      }
+      Register sum = add_epi32(sum0, sum1);
+      __m256i total = _mm256_add_epi32(_mm512_castsi512_si256(sum), _mm512_extracti64x4_epi64(sum, 1));
+      callback_impl.Run(total, callbacks::OutputBufferInfo(0, B0_colidx, 1, B_cols));
+    }
+  }
+
+  constexpr static const char *const kName = "8-bit AMX";
+
+  static const CPUType kUses = CPUType::AMX;
+};
+
+} // namespace AMX
+} // namespace intgemm
+
+#endif
@@ -0,0 +1,55 @@
+#pragma once
+/* Prepared B that grows by columns, for Int8::PrepareBAppendColumns.
+ *
+ * Keys in a decoder's cache gain a column of B each step.  Prepared B is a
+ * sequence of strips of 8 columns, each strip contiguous and holding all of
+ * the shared dimension, so a new column writes into the last strip and
+ * leaves the others alone.  AppendableB keeps room for capacity columns, a
+ * multiple of 8, with the columns past cols zero, so the last strip can be
+ * multiplied while it is partly full.  Running out of room doubles it.
+ */
+
+#include "aligned.h"
+#include "types.h"
+
+#include <cstring>
+#include <utility>
+
+namespace intgemm {
+
+struct AppendableB {
+  // Shape of B before preparing: rows is the shared dimension.  Only the
+  // first cols columns are valid.
+  Index rows = 0;
+  Index cols = 0;
+  Index capacity = 0;
+
+  // capacity columns in the layout of Int8::PrepareB, AVX512VNNI's on AMX.
+  AlignedVector<int8_t> data;
+
+  AppendableB() {}
+
+  AppendableB(Index rows, Index capacity) : rows(rows) {
+    Reserve(capacity);
+  }
+
+  // Room for at least capacity columns, keeping those already appended.
+  void Reserve(Index want) {
+    want = (want + 7) / 8 * 8;
+    if (want <= capacity) return;
+    AlignedVector<int8_t> grown(static_cast<std::size_t>(rows) * want);
+    const std::size_t used = static_cast<std::size_t>(rows) * capacity;
+    if (used) std::memcpy(grown.begin(), data.begin(), used);
+    std::memset(grown.begin() + used, 0, grown.size() - used);
+    data = std::move(grown);
+    capacity = want;
+  }
+
+  // Drop every column, for the next sequence.  Keeps the room.
+  void Clear() {
+    std::memset(data.begin(), 0, static_cast<std::size_t>(rows) * ((cols + 7) / 8 * 8));
+    cols = 0;
+  }
+};
+
+} // namespace intgemm
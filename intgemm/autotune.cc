@@ -0,0 +1,121 @@
+#include "autotune.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace intgemm {
+namespace {
+
+// Each line is: backend, the CPU tier it was tuned on, A_rows, width, B_cols,
+// then the choice's tier and rows.  Tiers are the numbers of CPUType.
+void WriteLine(std::ostream &out, const std::string &backend, Index A_rows, Index width, Index B_cols, const TuneChoice &choice) {
+  out << backend << ' ' << static_cast<int>(GetCPUID()) << ' ' << A_rows << ' ' << width << ' ' << B_cols << ' ' << static_cast<int>(choice.cpu) << ' ' << choice.rows << '\n';
+}
+
+std::string EnvironmentFile() {
+#if defined(_MSC_VER)
+  char env[1024];
+  size_t len = 0;
+  if (getenv_s(&len, env, sizeof(env), "INTGEMM_TUNING_FILE") || !len) return std::string();
+  return std::string(env);
+#else
+  const char *env = getenv("INTGEMM_TUNING_FILE");
+  return env ? std::string(env) : std::string();
+#endif
+}
+
+bool EnvironmentAcrossKernels() {
+#if defined(_MSC_VER)
+  char env[16];
+  size_t len = 0;
+  if (getenv_s(&len, env, sizeof(env), "INTGEMM_TUNE_ACROSS_KERNELS") || !len) return false;
+#else
+  const char *env = getenv("INTGEMM_TUNE_ACROSS_KERNELS");
+  if (!env) return false;
+#endif
+  return !std::strcmp(env, "1");
+}
+
+std::atomic<bool> &CurrentAcrossKernels() {
+  static std::atomic<bool> across(EnvironmentAcrossKernels());
+  return across;
+}
+
+} // namespace
+
+bool GetTuneAcrossKernels() {
+  return CurrentAcrossKernels().load(std::memory_order_relaxed);
+}
+
+void SetTuneAcrossKernels(bool across) {
+  CurrentAcrossKernels().store(across, std::memory_order_relaxed);
+}
+
+TuneCache::TuneCache(const std::string &file) : file_(file) {
+  if (!file_.empty()) Load(file_.c_str());
+}
+
+TuneCache &TuneCache::Global() {
+  static TuneCache cache(EnvironmentFile());
+  return cache;
+}
+
+bool TuneCache::Find(const char *backend, const TuneShape &shape, TuneChoice &choice) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = choices_.find(Key(backend, shape.A_rows, shape.width, shape.B_cols));
+  if (found == choices_.end()) return false;
+  choice = found->second;
+  return true;
+}
+
+void TuneCache::Insert(const char *backend, const TuneShape &shape, const TuneChoice &choice) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  choices_[Key(backend, shape.A_rows, shape.width, shape.B_cols)] = choice;
+  if (file_.empty()) return;
+  std::ofstream out(file_.c_str(), std::ios::app);
+  WriteLine(out, backend, shape.A_rows, shape.width, shape.B_cols, choice);
+}
+
+bool TuneCache::Load(const char *path) {
+  std::ifstream in(path);
+  if (!in) return false;
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string backend;
+    int tuned_on, cpu;
+    Index A_rows, width, B_cols, rows;
+    if (!(fields >> backend >> tuned_on >> A_rows >> width >> B_cols >> cpu >> rows)) continue;
+    if (tuned_on != static_cast<int>(GetCPUID())) continue;
+    TuneChoice choice = {static_cast<CPUType>(cpu), rows};
+    choices_[Key(backend, A_rows, width, B_cols)] = choice;
+  }
+  return true;
+}
+
+bool TuneCache::Save(const char *path) const {
+  std::ofstream out(path);
+  if (!out) return false;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto &it : choices_) {
+    WriteLine(out, std::get<0>(it.first), std::get<1>(it.first), std::get<2>(it.first), std::get<3>(it.first), it.second);
+  }
+  return static_cast<bool>(out);
+}
+
+void TuneCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  choices_.clear();
+}
+
+std::size_t TuneCache::Size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return choices_.size();
+}
+
+} // namespace intgemm
@@ -0,0 +1,92 @@
+#pragma once
+/* Which kernel to use for a multiply shape, found by timing the candidates.
+ *
+ * ChooseCPU picks one kernel per CPU, but the best register blocking of it
+ * varies with the shape.  Int8::Tune times each blocking of Int8::Multiply's
+ * kernel for an A_rows x width x B_cols multiply on first use and the
+ * TuneCache remembers the fastest.  Every blocking computes the same C.
+ *
+ * Where two kernels read the same prepared B (AVX512VNNI and AVX512BW,
+ * AVXVNNI and AVX2, NEON with and without dot products, SIMD128 and SSSE3),
+ * SetTuneAcrossKernels(true) or INTGEMM_TUNE_ACROSS_KERNELS=1 lets Tune time
+ * both.  They do not compute the same C: AVX512BW, AVX2 and SSSE3 add pairs
+ * of products in 16 bits and saturate, while the VNNI kernels sum exactly in
+ * 32 bits, so only opt in when A and B are quantized small enough that
+ * nothing saturates.
+ *
+ * Tuning takes a few multiplies of the shape per candidate, so tune the
+ * shapes of a model at load with Int8::TuneWarmup, or keep the results in a
+ * file: Save and Load write and read one line per shape, and when the
+ * INTGEMM_TUNING_FILE environment variable names a file the global cache
+ * loads it on first use and appends each shape it tunes.  Lines tuned on a
+ * different CPU tier are ignored, as are choices of another kernel unless
+ * tuning across kernels.
+ */
+
+#include "types.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+namespace intgemm {
+
+// Whether Int8::Tune may pick a kernel other than Int8::Multiply's, whose
+// results differ where products saturate.  False unless the
+// INTGEMM_TUNE_ACROSS_KERNELS environment variable is 1 or SetTuneAcrossKernels
+// says otherwise.
+bool GetTuneAcrossKernels();
+
+// Applies to shapes tuned from now on.
+void SetTuneAcrossKernels(bool across);
+
+struct TuneShape {
+  Index A_rows;
+  Index width;
+  Index B_cols;
+};
+
+struct TuneChoice {
+  // The kernels to use.
+  CPUType cpu;
+  // Rows of A register blocked, or 0 for those kernels' default.
+  Index rows;
+};
+
+class TuneCache {
+  public:
+    TuneCache() {}
+
+    // Load file, if it exists, and append to it what is tuned from now on.
+    explicit TuneCache(const std::string &file);
+
+    // The cache Int8::Tune uses, loaded from INTGEMM_TUNING_FILE if set.
+    static TuneCache &Global();
+
+    // The choice for shape with backend (e.g. "Int8"), if one was tuned.
+    bool Find(const char *backend, const TuneShape &shape, TuneChoice &choice) const;
+
+    // Remember choice, appending it to the tuning file if there is one.
+    void Insert(const char *backend, const TuneShape &shape, const TuneChoice &choice);
+
+    // Add the choices in path tuned on this CPU tier.  False if it can't be read.
+    bool Load(const char *path);
+
+    // Write every choice to path.  False if it can't be written.
+    bool Save(const char *path) const;
+
+    void Clear();
+
+    std::size_t Size() const;
+
+  private:
+    typedef std::tuple<std::string, Index, Index, Index> Key;
+
+    mutable std::mutex mutex_;
+    std::map<Key, TuneChoice> choices_;
+    // Where Insert appends, empty for none.
+    std::string file_;
+};
+
+} // namespace intgemm
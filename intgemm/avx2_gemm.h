@@ -49,6 +49,11 @@ class QuantizeTile16 {
     }
 };
 
+// 16 bytes of B sign extended to 16 bits for INTGEMM_MULTIPLY_MIXED.
+INTGEMM_AVX2 static inline __m256i ExtendInt8(const __m128i *b) {
+  return _mm256_cvtepi8_epi16(*b);
+}
+
 struct Kernels16 {
   typedef int16_t Integer;
 
@@ -84,6 +89,7 @@ struct Kernels16 {
   }
 
   INTGEMM_MULTIPLY16(__m256i, INTGEMM_AVX2, CPUType::AVX2)
+  INTGEMM_MULTIPLY_MIXED(__m256i, __m128i, INTGEMM_AVX2, CPUType::AVX2, 1, MultiplyStrip, ExtendInt8)
 
   constexpr static const char *const kName = "16-bit AVX2";
 
@@ -184,8 +190,13 @@ struct Kernels8 {
   }
  private:
   INTGEMM_QUANTIZE_THREAD(INTGEMM_AVX2)
+  INTGEMM_QUANTIZE_ROWS_THREAD(INTGEMM_AVX2)
+  INTGEMM_QUANTIZE_SCALED_THREAD(INTGEMM_AVX2)
  public:
   INTGEMM_QUANTIZE(INTGEMM_AVX2)
+  INTGEMM_QUANTIZE_ROWS(INTGEMM_AVX2)
+  INTGEMM_QUANTIZE_SCALED(INTGEMM_AVX2)
+  INTGEMM_QUANTIZE_SERIAL(INTGEMM_AVX2)
 
   // Currently A is prepared by quantization but this could theoretically change.
   INTGEMM_AVX2 static inline void PrepareA(const float *input, uint8_t *output, float quant_mult, Index rows, Index cols) {
@@ -86,6 +86,10 @@ class QuantizeTile16 {
 
 class QuantizeTile8 {
   public:
+    INTGEMM_AVX512BW static inline Register Consecutive(FRegister quant_mult, const float *input) {
+      return ConsecutiveWithWrapping(quant_mult, input, sizeof(Register), sizeof(Register), 1);
+    }
+
     INTGEMM_AVX512BW static inline Register ConsecutiveWithWrapping(FRegister quant_mult, const float *input, Index cols_left, Index cols, Index row_step) {
       static const __m512i neg127 = _mm512_set1_epi8(-127);
       static const __m512i shuffle_param = _mm512_set_epi32(15, 11, 7, 3, 14, 10, 6, 2, 13, 9, 5, 1, 12, 8, 4, 0);
@@ -136,6 +140,11 @@ class QuantizeTile8 {
     }
 };
 
+// 32 bytes of B sign extended to 16 bits for INTGEMM_MULTIPLY_MIXED.
+INTGEMM_AVX512BW static inline __m512i ExtendInt8(const __m256i *b) {
+  return _mm512_cvtepi8_epi16(*b);
+}
+
 struct Kernels16 {
   typedef int16_t Integer;
 
@@ -180,6 +189,7 @@ struct Kernels16 {
 
   /* Only INTGEMM_AVX512F is necessary but due to GCC 5.4 bug we have to set INTGEMM_AVX512BW */
   INTGEMM_MULTIPLY16(__m512i, INTGEMM_AVX512BW, CPUType::AVX2)
+  INTGEMM_MULTIPLY_MIXED(__m512i, __m256i, INTGEMM_AVX512BW, CPUType::AVX2, 1, MultiplyStrip, ExtendInt8)
 
   constexpr static const char *const kName = "16-bit AVX512";
 
@@ -218,7 +228,14 @@ struct Kernels8 {
     }
   }
 
+  INTGEMM_QUANTIZE_ROWS_THREAD(INTGEMM_AVX512BW)
+  INTGEMM_QUANTIZE_SCALED_THREAD(INTGEMM_AVX512BW)
+
  public:
+  INTGEMM_QUANTIZE_ROWS(INTGEMM_AVX512BW)
+  INTGEMM_QUANTIZE_SCALED(INTGEMM_AVX512BW)
+  INTGEMM_QUANTIZE_SERIAL(INTGEMM_AVX512BW)
+
   // Technically output can be unaligned in Quantize.
   // But then it will need to be aligned for Multiply.
   // Convert to 8-bit signed integers.
@@ -283,119 +300,83 @@ struct Kernels8 {
     SelectColumnsOfB((const __m512i*)input, (__m512i*)output, rows, cols_begin, cols_end);
   }
 
-  // Special AVX512 implementation due to having 32 registers (so I don't have to
-  // allocate registers manually) and no sign instruction.
-  template <typename Callback>
-  INTGEMM_AVX512BW static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
-    // This is copy-paste from Multiply8_SSE2OrAVX2.
-    assert(width % sizeof(Register) == 0);
-    assert(B_cols % 8 == 0);
-    assert(reinterpret_cast<uintptr_t>(A) % sizeof(Register) == 0);
-    assert(reinterpret_cast<uintptr_t>(B) % sizeof(Register) == 0);
-    // There's 8 results for INTGEMM_AVX2 to handle.
-    auto callback_impl = callbacks::CallbackImpl<CPUType::AVX2, Callback>(callback);
-    const Index simd_width = width / sizeof(Register);
+  // Number of rows of A to multiply against each 8-column strip of B at once.
+  // Two rows need 16 registers of sums, 8 for the columns of B, and |a| for
+  // each row, which fits in the 32 zmm registers.  More rows spill.
+  static const Index kMultiplyRows = 2;
+
+  // Multiply kRows consecutive rows of A (A_stride registers apart) by an
+  // 8-column strip of B over count registers of the shared dimension.
+  // Writes 8 32-bit sums per row to totals.
+  template <Index kRows>
+  INTGEMM_AVX512BW static inline void MultiplyStrip(const Register *A, Index A_stride, const Register *B, Index count, __m256i *totals) {
     // Added for AVX512.
     Register zeros = setzero_si<Register>();
-    // Go over 8 columns of B at a time.
-#pragma omp for
-    for (Index B0_colidx = 0; B0_colidx < B_cols; B0_colidx += 8) {
-      const Register *B0_col = reinterpret_cast<const Register*>(B) + B0_colidx * simd_width;
-      // Process one row of A at a time.  Doesn't seem to be faster to do multiple rows of A at once.
-      for (Index A_rowidx = 0; A_rowidx < A_rows; ++A_rowidx) {
-        // Iterate over shared (inner) dimension.
-        const Register *A_live = reinterpret_cast<const Register *>(A + A_rowidx * width);
-        const Register *A_end = A_live + simd_width;
-        const Register *B_live = B0_col;
-
-        // Do the first iteration to initialize the sums.
-        __m512i a = *A_live;
+    // These will be packed 16-bit integers containing sums for each column of B multiplied by the rows of A.
+    Register sums[kRows][8];
+    for (Index r = 0; r < kRows; ++r) {
+      for (Index c = 0; c < 8; ++c) {
+        sums[r][c] = zeros;
+      }
+    }
+    for (Index k = 0; k < count; ++k, B += 8) {
+      // Retrieve the conveniently consecutive values of B once for all rows.
+      Register b[8];
+      for (Index c = 0; c < 8; ++c) {
+        b[c] = B[c];
+      }
+      for (Index r = 0; r < kRows; ++r) {
+        Register a = A[r * A_stride + k];
+        // Get a mask where a is negative.
         __mmask64 neg_mask = _mm512_test_epi8_mask(a, _mm512_set1_epi8(-128));
-        __m512i a_positive = _mm512_abs_epi8(a);
-        // These will be packed 16-bit integers containing sums for each column of B multiplied by the row of A.
-        Register sum0 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[0], neg_mask, zeros, B_live[0]));
-        Register sum1 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[1], neg_mask, zeros, B_live[1]));
-        Register sum2 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[2], neg_mask, zeros, B_live[2]));
-        Register sum3 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[3], neg_mask, zeros, B_live[3]));
-        Register sum4 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[4], neg_mask, zeros, B_live[4]));
-        Register sum5 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[5], neg_mask, zeros, B_live[5]));
-        Register sum6 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[6], neg_mask, zeros, B_live[6]));
-        Register sum7 = maddubs_epi16(a_positive, _mm512_mask_sub_epi8(B_live[7], neg_mask, zeros, B_live[7]));
-
-        ++A_live;
-        B_live += 8;
-
-        // Use A as the loop variable so the add can be done where gcc likes it
-        // for branch prediction.
-        for (; A_live != A_end; ++A_live, B_live += 8) {
-          // Unique code here: can we do an inline function?
-          // Retrieve a.  We will use this as the unsigned part.
-          a = *A_live;
-          // Retrieve the conveniently consecutive values of B.
-          __m512i b0 = *B_live;
-          __m512i b1 = *(B_live + 1);
-          __m512i b2 = *(B_live + 2);
-          __m512i b3 = *(B_live + 3);
-          __m512i b4 = *(B_live + 4);
-          __m512i b5 = *(B_live + 5);
-          __m512i b6 = *(B_live + 6);
-          __m512i b7 = *(B_live + 7);
-
-          // Get a mask where a is negative.
-          // Didn't seem to make a difference definining sign bits here vs at top
-          neg_mask = _mm512_test_epi8_mask(a, _mm512_set1_epi8(-128));
-          a_positive = _mm512_abs_epi8(a);
-
-          // Negate by subtracting from zero with a mask.
-          b0 = _mm512_mask_sub_epi8(b0, neg_mask, zeros, b0);
-          b1 = _mm512_mask_sub_epi8(b1, neg_mask, zeros, b1);
-          b2 = _mm512_mask_sub_epi8(b2, neg_mask, zeros, b2);
-          b3 = _mm512_mask_sub_epi8(b3, neg_mask, zeros, b3);
-          b4 = _mm512_mask_sub_epi8(b4, neg_mask, zeros, b4);
-          b5 = _mm512_mask_sub_epi8(b5, neg_mask, zeros, b5);
-          b6 = _mm512_mask_sub_epi8(b6, neg_mask, zeros, b6);
-          b7 = _mm512_mask_sub_epi8(b7, neg_mask, zeros, b7);
-          // The magic 8-bit multiply then horizontal sum into 16-bit.
-          b0 = _mm512_maddubs_epi16(a_positive, b0);
-          b1 = _mm512_maddubs_epi16(a_positive, b1);
-          b2 = _mm512_maddubs_epi16(a_positive, b2);
-          b3 = _mm512_maddubs_epi16(a_positive, b3);
-          b4 = _mm512_maddubs_epi16(a_positive, b4);
-          b5 = _mm512_maddubs_epi16(a_positive, b5);
-          b6 = _mm512_maddubs_epi16(a_positive, b6);
-          b7 = _mm512_maddubs_epi16(a_positive, b7);
-          // Now we have 16-bit results that are the sum of two multiplies.
-          // Choosing to approximate and do adds.
-          // Perhaps every so often we could accumulate by upcasting.
-          sum0 = _mm512_adds_epi16(sum0, b0);
-          sum1 = _mm512_adds_epi16(sum1, b1);
-          sum2 = _mm512_adds_epi16(sum2, b2);
-          sum3 = _mm512_adds_epi16(sum3, b3);
-          sum4 = _mm512_adds_epi16(sum4, b4);
-          sum5 = _mm512_adds_epi16(sum5, b5);
-          sum6 = _mm512_adds_epi16(sum6, b6);
-          sum7 = _mm512_adds_epi16(sum7, b7);
-          // Unique code ends: can we do an inline function?
+        Register a_positive = _mm512_abs_epi8(a);
+        for (Index c = 0; c < 8; ++c) {
+          // Negate by subtracting from zero with a mask, then the magic 8-bit
+          // multiply and horizontal sum into 16-bit.  Choosing to approximate
+          // and do adds.
+          Register mult = _mm512_maddubs_epi16(a_positive, _mm512_mask_sub_epi8(b[c], neg_mask, zeros, b[c]));
+          sums[r][c] = _mm512_adds_epi16(sums[r][c], mult);
         }
-        // Upcast to 32-bit and horizontally add.
-        Register ones = set1_epi16<Register>(1);
-        sum0 = madd_epi16(sum0, ones);
-        sum1 = madd_epi16(sum1, ones);
-        sum2 = madd_epi16(sum2, ones);
-        sum3 = madd_epi16(sum3, ones);
-        sum4 = madd_epi16(sum4, ones);
-        sum5 = madd_epi16(sum5, ones);
-        sum6 = madd_epi16(sum6, ones);
-        sum7 = madd_epi16(sum7, ones);
-        Register pack0123 = Pack0123(sum0, sum1, sum2, sum3);
-        Register pack4567 = Pack0123(sum4, sum5, sum6, sum7);
-
-        auto total = PermuteSummer(pack0123, pack4567);
-        callback_impl.Run(total, callbacks::OutputBufferInfo(A_rowidx, B0_colidx, A_rows, B_cols));
       }
     }
+    // Upcast to 32-bit and horizontally add.
+    Register ones = set1_epi16<Register>(1);
+    for (Index r = 0; r < kRows; ++r) {
+      for (Index c = 0; c < 8; ++c) {
+        sums[r][c] = madd_epi16(sums[r][c], ones);
+      }
+      Register pack0123 = Pack0123(sums[r][0], sums[r][1], sums[r][2], sums[r][3]);
+      Register pack4567 = Pack0123(sums[r][4], sums[r][5], sums[r][6], sums[r][7]);
+      totals[r] = PermuteSummer(pack0123, pack4567);
+    }
   }
 
+  // Special AVX512 implementation due to having 32 registers (so I don't have to
+  // allocate registers manually) and no sign instruction.
+  INTGEMM_MULTIPLY_BLOCKED_SATURATING(int8_t, int8_t, __m512i, INTGEMM_AVX512BW, CPUType::AVX2, MultiplyRows, MultiplyStrip)
+
+  template <typename Callback>
+  INTGEMM_AVX512BW static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    MultiplyRows<kMultiplyRows, Callback>(A, B, A_rows, width, B_cols, callback);
+  }
+
+  template <typename Callback>
+  INTGEMM_AVX512BW static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) {
+    MultiplyRows<kMultiplyRows, Callback>(A, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end);
+  }
+
+  INTGEMM_MULTIPLY_STRIDED(int8_t, int8_t, INTGEMM_AVX512BW, MultiplyRows, kMultiplyRows)
+  INTGEMM_MULTIPLY_FIXED(int8_t, int8_t, INTGEMM_AVX512BW, MultiplyRows, kMultiplyRows)
+
+  INTGEMM_MULTIPLY_FLOAT_A(int8_t, int8_t, __m512i, INTGEMM_AVX512BW, CPUType::AVX2, MultiplyFloatA, MultiplyRows, kMultiplyRows)
+  INTGEMM_MULTIPLY_NT(__m512i, INTGEMM_AVX512BW, CPUType::AVX2, MultiplyNT, MultiplyRows, kMultiplyRows)
+
+  INTGEMM_UNPACK_INT4(INTGEMM_AVX512BW, __m512i)
+  INTGEMM_MULTIPLY4(__m512i, INTGEMM_AVX512BW, CPUType::AVX2, kMultiplyRows, MultiplyStrip, UnpackInt4)
+  INTGEMM_MULTIPLY_SPARSE(__m512i, INTGEMM_AVX512BW, CPUType::AVX2, kMultiplyRows, MultiplyStrip)
+  INTGEMM_MULTIPLY_COLUMNS(__m512i, INTGEMM_AVX512BW, CPUType::AVX2, kMultiplyRows, MultiplyStrip)
+  INTGEMM_MULTIPLY_SPLIT_K(__m512i, INTGEMM_AVX512BW, CPUType::AVX2, MultiplyRows, kMultiplyRows)
+
   INTGEMM_MULTIPLY8SHIFT(__m512i, INTGEMM_AVX512BW, CPUType::AVX2)
 
   INTGEMM_PREPAREBIASFOR8(__m512i, INTGEMM_AVX512BW, CPUType::AVX2)
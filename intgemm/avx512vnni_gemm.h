@@ -10,8 +10,10 @@ namespace intgemm {
 namespace AVX512VNNI {
 
 // Workaround extra vmovdqa64 https://gcc.gnu.org/bugzilla/show_bug.cgi?id=94663
+// The asm pins c to memory when it is an element of an array, which defeats
+// register blocking, so only use it on compilers that still have the bug.
 INTGEMM_AVX512VNNI static inline void VNNI8(__m512i &c, __m512i a, __m512i b) {
-#if defined(__GNUC__) && !defined(__clang__) && !defined(__INTEL_COMPILER)
+#if defined(__GNUC__) && !defined(__clang__) && !defined(__INTEL_COMPILER) && __GNUC__ < 10
     asm ("vpdpbusds %2, %1, %0" : "+x"(c) : "x"(a), "mx"(b));
 #else
     c = _mm512_dpbusds_epi32(c, a, b);
@@ -19,108 +21,109 @@ INTGEMM_AVX512VNNI static inline void VNNI8(__m512i &c, __m512i a, __m512i b) {
 }
 
 struct Kernels8 : public AVX512BW::Kernels8 {
-  template <typename Callback>
-  INTGEMM_AVX512VNNI static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
-    assert(width % sizeof(Register) == 0);
-    assert(B_cols % 8 == 0);
-    assert(reinterpret_cast<uintptr_t>(A) % sizeof(Register) == 0);
-    assert(reinterpret_cast<uintptr_t>(B) % sizeof(Register) == 0);
-    auto callback_impl = callbacks::CallbackImpl<CPUType::AVX2, Callback>(callback);
-    const Index simd_width = width / sizeof(Register);
+  // Number of rows of A to multiply against each 8-column strip of B at once.
+  static const Index kMultiplyRows = 2;
+  static const Index kMultiply8ShiftRows = 2;
+
+  // Multiply kRows consecutive rows of A (A_stride registers apart) by an
+  // 8-column strip of B over count registers of the shared dimension.
+  // Writes 8 32-bit sums per row to totals.
+  template <Index kRows>
+  INTGEMM_AVX512VNNI static inline void MultiplyStrip(const Register *A, Index A_stride, const Register *B, Index count, __m256i *totals) {
     Register zeros = setzero_si<Register>();
-    // Go over 8 columns of B at a time.
-#pragma omp for
-    for (Index B0_colidx = 0; B0_colidx < B_cols; B0_colidx += 8) {
-      const Register *B0_col = reinterpret_cast<const Register*>(B) + B0_colidx * simd_width;
-      // Process one row of A at a time.  Doesn't seem to be faster to do multiple rows of A at once.
-      for (Index A_rowidx = 0; A_rowidx < A_rows; ++A_rowidx) {
-        // Iterate over shared (inner) dimension.
-        const Register *A_live = reinterpret_cast<const Register *>(A + A_rowidx * width);
-        const Register *A_end = A_live + simd_width;
-        const Register *B_live = B0_col;
-        // TODO: separate first step.
-        Register sum0 = zeros, sum1 = zeros, sum2 = zeros, sum3 = zeros, sum4 = zeros, sum5 = zeros, sum6 = zeros, sum7 = zeros;
-        for (; A_live != A_end; ++A_live, B_live += 8) {
-          Register a = *A_live;
-          // Retrieve the conveniently consecutive values of B.
-          Register b0 = *B_live;
-          Register b1 = *(B_live + 1);
-          Register b2 = *(B_live + 2);
-          Register b3 = *(B_live + 3);
-          Register b4 = *(B_live + 4);
-          Register b5 = *(B_live + 5);
-          Register b6 = *(B_live + 6);
-          Register b7 = *(B_live + 7);
-          // Get a mask where a is negative.
-          __mmask64 neg_mask = _mm512_test_epi8_mask(a, _mm512_set1_epi8(-128));
-          Register a_positive = _mm512_abs_epi8(a);
+    Register sums[kRows][8];
+    for (Index r = 0; r < kRows; ++r) {
+      for (Index c = 0; c < 8; ++c) {
+        sums[r][c] = zeros;
+      }
+    }
+    for (Index k = 0; k < count; ++k, B += 8) {
+      // Retrieve the conveniently consecutive values of B once for all rows.
+      Register b[8];
+      for (Index c = 0; c < 8; ++c) {
+        b[c] = B[c];
+      }
+      for (Index r = 0; r < kRows; ++r) {
+        Register a = A[r * A_stride + k];
+        // Get a mask where a is negative.
+        __mmask64 neg_mask = _mm512_test_epi8_mask(a, _mm512_set1_epi8(-128));
+        Register a_positive = _mm512_abs_epi8(a);
+        for (Index c = 0; c < 8; ++c) {
           // Negate by subtracting from zero with a mask.
-          b0 = _mm512_mask_sub_epi8(b0, neg_mask, zeros, b0);
-          b1 = _mm512_mask_sub_epi8(b1, neg_mask, zeros, b1);
-          b2 = _mm512_mask_sub_epi8(b2, neg_mask, zeros, b2);
-          b3 = _mm512_mask_sub_epi8(b3, neg_mask, zeros, b3);
-          b4 = _mm512_mask_sub_epi8(b4, neg_mask, zeros, b4);
-          b5 = _mm512_mask_sub_epi8(b5, neg_mask, zeros, b5);
-          b6 = _mm512_mask_sub_epi8(b6, neg_mask, zeros, b6);
-          b7 = _mm512_mask_sub_epi8(b7, neg_mask, zeros, b7);
-          VNNI8(sum0, a_positive, b0);
-          VNNI8(sum1, a_positive, b1);
-          VNNI8(sum2, a_positive, b2);
-          VNNI8(sum3, a_positive, b3);
-          VNNI8(sum4, a_positive, b4);
-          VNNI8(sum5, a_positive, b5);
-          VNNI8(sum6, a_positive, b6);
-          VNNI8(sum7, a_positive, b7);
+          VNNI8(sums[r][c], a_positive, _mm512_mask_sub_epi8(b[c], neg_mask, zeros, b[c]));
         }
-        Register pack0123 = Pack0123(sum0, sum1, sum2, sum3);
-        Register pack4567 = Pack0123(sum4, sum5, sum6, sum7);
-        auto total = PermuteSummer(pack0123, pack4567);
-        callback_impl.Run(total, callbacks::OutputBufferInfo(A_rowidx, B0_colidx, A_rows, B_cols));
       }
     }
+    for (Index r = 0; r < kRows; ++r) {
+      Register pack0123 = Pack0123(sums[r][0], sums[r][1], sums[r][2], sums[r][3]);
+      Register pack4567 = Pack0123(sums[r][4], sums[r][5], sums[r][6], sums[r][7]);
+      totals[r] = PermuteSummer(pack0123, pack4567);
+    }
   }
 
-  template <typename Callback>
-  INTGEMM_AVX512VNNI static void Multiply8Shift(const uint8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
-    assert(width % sizeof(Register) == 0);
-    assert(B_cols % 8 == 0);
-    assert(reinterpret_cast<uintptr_t>(A) % sizeof(Register) == 0);
-    assert(reinterpret_cast<uintptr_t>(B) % sizeof(Register) == 0);
-    auto callback_impl = callbacks::CallbackImpl<CPUType::AVX2, Callback>(callback);
-    const Index simd_width = width / sizeof(Register);
+  // Same as MultiplyStrip but A is unsigned so no sign juggling is needed.
+  template <Index kRows>
+  INTGEMM_AVX512VNNI static inline void Multiply8ShiftStrip(const Register *A, Index A_stride, const Register *B, Index count, __m256i *totals) {
     Register zeros = setzero_si<Register>();
-    // Go over 8 columns of B at a time.
-#pragma omp for
-    for (Index B0_colidx = 0; B0_colidx < B_cols; B0_colidx += 8) {
-      const Register *B0_col = reinterpret_cast<const Register*>(B) + B0_colidx * simd_width;
-      // Process one row of A at a time.  Doesn't seem to be faster to do multiple rows of A at once.
-      for (Index A_rowidx = 0; A_rowidx < A_rows; ++A_rowidx) {
-        // Iterate over shared (inner) dimension.
-        const Register *A_live = reinterpret_cast<const Register *>(A + A_rowidx * width);
-        const Register *A_end = A_live + simd_width;
-        const Register *B_live = B0_col;
-        // TODO: separate first step.
-        Register sum0 = zeros, sum1 = zeros, sum2 = zeros, sum3 = zeros, sum4 = zeros, sum5 = zeros, sum6 = zeros, sum7 = zeros;
-        for (; A_live != A_end; ++A_live, B_live += 8) {
-          Register a = *A_live;
-          //MultiplyAdd
-          VNNI8(sum0, a, *B_live);
-          VNNI8(sum1, a, *(B_live + 1));
-          VNNI8(sum2, a, *(B_live + 2));
-          VNNI8(sum3, a, *(B_live + 3));
-          VNNI8(sum4, a, *(B_live + 4));
-          VNNI8(sum5, a, *(B_live + 5));
-          VNNI8(sum6, a, *(B_live + 6));
-          VNNI8(sum7, a, *(B_live + 7));
+    Register sums[kRows][8];
+    for (Index r = 0; r < kRows; ++r) {
+      for (Index c = 0; c < 8; ++c) {
+        sums[r][c] = zeros;
+      }
+    }
+    for (Index k = 0; k < count; ++k, B += 8) {
+      for (Index r = 0; r < kRows; ++r) {
+        Register a = A[r * A_stride + k];
+        //MultiplyAdd
+        for (Index c = 0; c < 8; ++c) {
+          VNNI8(sums[r][c], a, B[c]);
         }
-        Register pack0123 = Pack0123(sum0, sum1, sum2, sum3);
-        Register pack4567 = Pack0123(sum4, sum5, sum6, sum7);
-        auto total = PermuteSummer(pack0123, pack4567);
-        callback_impl.Run(total, callbacks::OutputBufferInfo(A_rowidx, B0_colidx, A_rows, B_cols));
       }
     }
+    for (Index r = 0; r < kRows; ++r) {
+      Register pack0123 = Pack0123(sums[r][0], sums[r][1], sums[r][2], sums[r][3]);
+      Register pack4567 = Pack0123(sums[r][4], sums[r][5], sums[r][6], sums[r][7]);
+      totals[r] = PermuteSummer(pack0123, pack4567);
+    }
+  }
+
+  INTGEMM_MULTIPLY_BLOCKED(int8_t, int8_t, __m512i, INTGEMM_AVX512VNNI, CPUType::AVX2, MultiplyRows, MultiplyStrip)
+
+  template <typename Callback>
+  INTGEMM_AVX512VNNI static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    MultiplyRows<kMultiplyRows, Callback>(A, B, A_rows, width, B_cols, callback);
+  }
+
+  template <typename Callback>
+  INTGEMM_AVX512VNNI static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) {
+    MultiplyRows<kMultiplyRows, Callback>(A, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end);
   }
 
+  INTGEMM_MULTIPLY_STRIDED(int8_t, int8_t, INTGEMM_AVX512VNNI, MultiplyRows, kMultiplyRows)
+  INTGEMM_MULTIPLY_FIXED(int8_t, int8_t, INTGEMM_AVX512VNNI, MultiplyRows, kMultiplyRows)
+
+  INTGEMM_MULTIPLY_FLOAT_A(int8_t, int8_t, __m512i, INTGEMM_AVX512VNNI, CPUType::AVX2, MultiplyFloatA, MultiplyRows, kMultiplyRows)
+  INTGEMM_MULTIPLY_NT(__m512i, INTGEMM_AVX512VNNI, CPUType::AVX2, MultiplyNT, MultiplyRows, kMultiplyRows)
+
+  INTGEMM_MULTIPLY4(__m512i, INTGEMM_AVX512VNNI, CPUType::AVX2, kMultiplyRows, MultiplyStrip, UnpackInt4)
+  INTGEMM_MULTIPLY_SPARSE(__m512i, INTGEMM_AVX512VNNI, CPUType::AVX2, kMultiplyRows, MultiplyStrip)
+  INTGEMM_MULTIPLY_COLUMNS(__m512i, INTGEMM_AVX512VNNI, CPUType::AVX2, kMultiplyRows, MultiplyStrip)
+  INTGEMM_MULTIPLY_SPLIT_K(__m512i, INTGEMM_AVX512VNNI, CPUType::AVX2, MultiplyRows, kMultiplyRows)
+
+  INTGEMM_MULTIPLY_BLOCKED(uint8_t, int8_t, __m512i, INTGEMM_AVX512VNNI, CPUType::AVX2, Multiply8ShiftRows, Multiply8ShiftStrip)
+
+  template <typename Callback>
+  INTGEMM_AVX512VNNI static void Multiply8Shift(const uint8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    Multiply8ShiftRows<kMultiply8ShiftRows, Callback>(A, B, A_rows, width, B_cols, callback);
+  }
+
+  template <typename Callback>
+  INTGEMM_AVX512VNNI static void Multiply8Shift(const uint8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) {
+    Multiply8ShiftRows<kMultiply8ShiftRows, Callback>(A, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end);
+  }
+
+  INTGEMM_MULTIPLY_FLOAT_A(uint8_t, int8_t, __m512i, INTGEMM_AVX512VNNI, CPUType::AVX2, Multiply8ShiftFloatA, Multiply8ShiftRows, kMultiply8ShiftRows)
+
   template <typename Callback>
   INTGEMM_AVX512VNNI static void PrepareBias(const int8_t *B, Index width, Index B_cols, Callback callback) {
     assert(width % sizeof(Register) == 0);
@@ -162,6 +165,62 @@ struct Kernels8 : public AVX512BW::Kernels8 {
   static const CPUType kUses = CPUType::AVX512VNNI;
 };
 
+struct Kernels16 : public AVX512BW::Kernels16 {
+  // Number of rows of A to multiply against each 8-column strip of B at once.
+  static const Index kMultiplyRows = 2;
+
+  // vpdpwssd does the madd_epi16 and add_epi32 of INTGEMM_MULTIPLY16 in one
+  // instruction.  It wraps on overflow just like add_epi32 so results match
+  // AVX512BW::Kernels16 exactly.
+  template <Index kRows>
+  INTGEMM_AVX512VNNI static inline void MultiplyStrip(const Register *A, Index A_stride, const Register *B, Index count, __m256i *totals) {
+    Register zeros = setzero_si<Register>();
+    Register sums[kRows][8];
+    for (Index r = 0; r < kRows; ++r) {
+      for (Index c = 0; c < 8; ++c) {
+        sums[r][c] = zeros;
+      }
+    }
+    for (Index k = 0; k < count; ++k, B += 8) {
+      Register b[8];
+      for (Index c = 0; c < 8; ++c) {
+        b[c] = B[c];
+      }
+      for (Index r = 0; r < kRows; ++r) {
+        Register a = A[r * A_stride + k];
+        for (Index c = 0; c < 8; ++c) {
+          sums[r][c] = _mm512_dpwssd_epi32(sums[r][c], a, b[c]);
+        }
+      }
+    }
+    for (Index r = 0; r < kRows; ++r) {
+      Register pack0123 = Pack0123(sums[r][0], sums[r][1], sums[r][2], sums[r][3]);
+      Register pack4567 = Pack0123(sums[r][4], sums[r][5], sums[r][6], sums[r][7]);
+      totals[r] = PermuteSummer(pack0123, pack4567);
+    }
+  }
+
+  INTGEMM_MULTIPLY_BLOCKED(int16_t, int16_t, __m512i, INTGEMM_AVX512VNNI, CPUType::AVX2, MultiplyRows, MultiplyStrip)
+
+  template <typename Callback>
+  INTGEMM_AVX512VNNI static void Multiply(const int16_t *A, const int16_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    MultiplyRows<kMultiplyRows, Callback>(A, B, A_rows, width, B_cols, callback);
+  }
+
+  template <typename Callback>
+  INTGEMM_AVX512VNNI static void Multiply(const int16_t *A, const int16_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) {
+    MultiplyRows<kMultiplyRows, Callback>(A, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end);
+  }
+
+  INTGEMM_MULTIPLY_STRIDED(int16_t, int16_t, INTGEMM_AVX512VNNI, MultiplyRows, kMultiplyRows)
+
+  INTGEMM_MULTIPLY_MIXED(__m512i, __m256i, INTGEMM_AVX512VNNI, CPUType::AVX2, kMultiplyRows, MultiplyStrip, AVX512BW::ExtendInt8)
+
+  constexpr static const char *const kName = "16-bit AVX512VNNI";
+
+  static const CPUType kUses = CPUType::AVX512VNNI;
+};
+
 } // namespace AVX512VNNI
 } // namespace intgemm
 
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "intgemm/intgemm_config.h"
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVXVNNI
+#include "avx2_gemm.h"
+#include "types.h"
+
+namespace intgemm {
+namespace AVXVNNI {
+
+/* VEX-encoded vpdpbusd on 256-bit registers, for CPUs that have VNNI but not
+ * AVX512.  B is prepared exactly as for AVX2, so only the multiplies change:
+ * vpdpbusds replaces the maddubs_epi16, madd_epi16 and add_epi32 sequence,
+ * which also removes the 16-bit saturation in maddubs.
+ */
+struct Kernels8 : public AVX2::Kernels8 {
+  // Only 16 ymm registers, which the 8 sums and b already fill.
+  static const Index kMultiplyRows = 1;
+  static const Index kMultiply8ShiftRows = 1;
+
+  // Multiply kRows consecutive rows of A (A_stride registers apart) by an
+  // 8-column strip of B over count registers of the shared dimension.
+  // Writes 8 32-bit sums per row to totals.
+  template <Index kRows>
+  INTGEMM_AVXVNNI static inline void MultiplyStrip(const Register *A, Index A_stride, const Register *B, Index count, __m256i *totals) {
+    Register zeros = setzero_si<Register>();
+    Register sums[kRows][8];
+    for (Index r = 0; r < kRows; ++r) {
+      for (Index c = 0; c < 8; ++c) {
+        sums[r][c] = zeros;
+      }
+    }
+    for (Index k = 0; k < count; ++k, B += 8) {
+      for (Index r = 0; r < kRows; ++r) {
+        Register a = A[r * A_stride + k];
+        // vpdpbusds wants unsigned a, so move the sign of a onto b.
+        Register a_positive = abs_epi8(a);
+        for (Index c = 0; c < 8; ++c) {
+          sums[r][c] = _mm256_dpbusds_avx_epi32(sums[r][c], a_positive, sign_epi8(B[c], a));
+        }
+      }
+    }
+    for (Index r = 0; r < kRows; ++r) {
+      Register pack0123 = Pack0123(sums[r][0], sums[r][1], sums[r][2], sums[r][3]);
+      Register pack4567 = Pack0123(sums[r][4], sums[r][5], sums[r][6], sums[r][7]);
+      totals[r] = PermuteSummer(pack0123, pack4567);
+    }
+  }
+
+  // Same as MultiplyStrip but A is unsigned so no sign juggling is needed.
+  template <Index kRows>
+  INTGEMM_AVXVNNI static inline void Multiply8ShiftStrip(const Register *A, Index A_stride, const Register *B, Index count, __m256i *totals) {
+    Register zeros = setzero_si<Register>();
+    Register sums[kRows][8];
+    for (Index r = 0; r < kRows; ++r) {
+      for (Index c = 0; c < 8; ++c) {
+        sums[r][c] = zeros;
+      }
+    }
+    for (Index k = 0; k < count; ++k, B += 8) {
+      for (Index r = 0; r < kRows; ++r) {
+        Register a = A[r * A_stride + k];
+        for (Index c = 0; c < 8; ++c) {
+          sums[r][c] = _mm256_dpbusds_avx_epi32(sums[r][c], a, B[c]);
+        }
+      }
+    }
+    for (Index r = 0; r < kRows; ++r) {
+      Register pack0123 = Pack0123(sums[r][0], sums[r][1], sums[r][2], sums[r][3]);
+      Register pack4567 = Pack0123(sums[r][4], sums[r][5], sums[r][6], sums[r][7]);
+      totals[r] = PermuteSummer(pack0123, pack4567);
+    }
+  }
+
+  INTGEMM_MULTIPLY_BLOCKED(int8_t, int8_t, __m256i, INTGEMM_AVXVNNI, CPUType::AVX2, MultiplyRows, MultiplyStrip)
+
+  template <typename Callback>
+  INTGEMM_AVXVNNI static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    MultiplyRows<kMultiplyRows, Callback>(A, B, A_rows, width, B_cols, callback);
+  }
+
+  template <typename Callback>
+  INTGEMM_AVXVNNI static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) {
+    MultiplyRows<kMultiplyRows, Callback>(A, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end);
+  }
+
+  INTGEMM_MULTIPLY_STRIDED(int8_t, int8_t, INTGEMM_AVXVNNI, MultiplyRows, kMultiplyRows)
+  INTGEMM_MULTIPLY_FIXED(int8_t, int8_t, INTGEMM_AVXVNNI, MultiplyRows, kMultiplyRows)
+
+  INTGEMM_MULTIPLY_FLOAT_A(int8_t, int8_t, __m256i, INTGEMM_AVXVNNI, CPUType::AVX2, MultiplyFloatA, MultiplyRows, kMultiplyRows)
+  INTGEMM_MULTIPLY_NT(__m256i, INTGEMM_AVXVNNI, CPUType::AVX2, MultiplyNT, MultiplyRows, kMultiplyRows)
+
+  INTGEMM_MULTIPLY4(__m256i, INTGEMM_AVXVNNI, CPUType::AVX2, kMultiplyRows, MultiplyStrip, UnpackInt4)
+  INTGEMM_MULTIPLY_SPARSE(__m256i, INTGEMM_AVXVNNI, CPUType::AVX2, kMultiplyRows, MultiplyStrip)
+  INTGEMM_MULTIPLY_COLUMNS(__m256i, INTGEMM_AVXVNNI, CPUType::AVX2, kMultiplyRows, MultiplyStrip)
+  INTGEMM_MULTIPLY_SPLIT_K(__m256i, INTGEMM_AVXVNNI, CPUType::AVX2, MultiplyRows, kMultiplyRows)
+
+  INTGEMM_MULTIPLY_BLOCKED(uint8_t, int8_t, __m256i, INTGEMM_AVXVNNI, CPUType::AVX2, Multiply8ShiftRows, Multiply8ShiftStrip)
+
+  template <typename Callback>
+  INTGEMM_AVXVNNI static void Multiply8Shift(const uint8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    Multiply8ShiftRows<kMultiply8ShiftRows, Callback>(A, B, A_rows, width, B_cols, callback);
+  }
+
+  template <typename Callback>
+  INTGEMM_AVXVNNI static void Multiply8Shift(const uint8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) {
+    Multiply8ShiftRows<kMultiply8ShiftRows, Callback>(A, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end);
+  }
+
+  INTGEMM_MULTIPLY_FLOAT_A(uint8_t, int8_t, __m256i, INTGEMM_AVXVNNI, CPUType::AVX2, Multiply8ShiftFloatA, Multiply8ShiftRows, kMultiply8ShiftRows)
+
+  template <typename Callback>
+  INTGEMM_AVXVNNI static void PrepareBias(const int8_t *B, Index width, Index B_cols, Callback callback) {
+    assert(width % sizeof(Register) == 0);
+    assert(B_cols % 8 == 0);
+    assert(reinterpret_cast<uintptr_t>(B) % sizeof(Register) == 0);
+    auto callback_impl = callbacks::CallbackImpl<CPUType::AVX2, Callback>(callback);
+    Index simd_width = width / sizeof(Register);
+    Register zeros = setzero_si<Register>();
+    const Register a = set1_epi8<Register>(1);
+    // Go over 8 columns of B at a time.
+#pragma omp for
+    for (Index B0_colidx = 0; B0_colidx < B_cols; B0_colidx += 8) {
+      const Register *B_live = reinterpret_cast<const Register*>(B) + B0_colidx * simd_width;
+      const Register *B_end = B_live + simd_width * 8;
+      Register sum0 = zeros, sum1 = zeros, sum2 = zeros, sum3 = zeros, sum4 = zeros, sum5 = zeros, sum6 = zeros, sum7 = zeros;
+      for (; B_live != B_end; B_live += 8) {
+        sum0 = _mm256_dpbusds_avx_epi32(sum0, a, *B_live);
+        sum1 = _mm256_dpbusds_avx_epi32(sum1, a, *(B_live + 1));
+        sum2 = _mm256_dpbusds_avx_epi32(sum2, a, *(B_live + 2));
+        sum3 = _mm256_dpbusds_avx_epi32(sum3, a, *(B_live + 3));
+        sum4 = _mm256_dpbusds_avx_epi32(sum4, a, *(B_live + 4));
+        sum5 = _mm256_dpbusds_avx_epi32(sum5, a, *(B_live + 5));
+        sum6 = _mm256_dpbusds_avx_epi32(sum6, a, *(B_live + 6));
+        sum7 = _mm256_dpbusds_avx_epi32(sum7, a, *(B_live + 7));
+      }
+      Register pack0123 = Pack0123(sum0, sum1, sum2, sum3);
+      Register pack4567 = Pack0123(sum4, sum5, sum6, sum7);
+      auto total = PermuteSummer(pack0123, pack4567);
+      callback_impl.Run(total, callbacks::OutputBufferInfo(0, B0_colidx, 1, B_cols));
+    }
+  }
+
+  constexpr static const char *const kName = "8-bit AVXVNNI";
+
+  static const CPUType kUses = CPUType::AVXVNNI;
+};
+
+} // namespace AVXVNNI
+} // namespace intgemm
+
+#endif
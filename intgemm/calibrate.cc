@@ -0,0 +1,173 @@
+#include "calibrate.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace intgemm {
+
+namespace {
+
+// Upper edge of bin.  The last bin reaches infinity, so treat its values as
+// being at its lower edge.
+float Upper(Index bin) {
+  return bin + 1 < kHistogramBins ? AbsHistogram::Edge(bin + 1) : AbsHistogram::Edge(bin);
+}
+
+// Bins [*first, *last] hold every count.  False if there are none.
+bool Occupied(const std::vector<uint64_t> &counts, Index *first, Index *last) {
+  Index b = 0;
+  while (b < counts.size() && !counts[b]) ++b;
+  if (b == counts.size()) return false;
+  *first = b;
+  for (b = static_cast<Index>(counts.size()) - 1; !counts[b]; --b) {}
+  *last = b;
+  return true;
+}
+
+} // namespace
+
+AbsHistogram::AbsHistogram() : counts_(kHistogramBins), total_(0) {}
+
+void AbsHistogram::Add(const float *begin, const float *end) {
+  HistogramAbsolute(begin, end, counts_.data());
+  total_ += end - begin;
+}
+
+AbsHistogram &AbsHistogram::operator+=(const AbsHistogram &other) {
+  for (Index b = 0; b < kHistogramBins; ++b) {
+    counts_[b] += other.counts_[b];
+  }
+  total_ += other.total_;
+  return *this;
+}
+
+float AbsHistogram::Edge(Index bin) {
+  if (bin == 0) return 0.0f;
+  if (bin >= kHistogramBins) return std::numeric_limits<float>::infinity();
+  const int32_t bits = (static_cast<int32_t>(bin) + kHistogramBias) << (23 - kHistogramMantissaBits);
+  float ret;
+  std::memcpy(&ret, &bits, sizeof(float));
+  return ret;
+}
+
+float AbsHistogram::Percentile(double fraction) const {
+  Index first, last;
+  if (!Occupied(counts_, &first, &last)) return 0.0f;
+  const double target = std::min(std::max(fraction, 0.0), 1.0) * total_;
+  double below = 0.0;
+  for (Index b = first; b <= last; ++b) {
+    const uint64_t count = counts_[b];
+    if (count && below + count >= target) {
+      const double lower = Edge(b);
+      return static_cast<float>(lower + (target - below) / count * (Upper(b) - lower));
+    }
+    below += count;
+  }
+  return Upper(last);
+}
+
+float AbsHistogram::KLThreshold(Index levels) const {
+  Index first, last;
+  if (!Occupied(counts_, &first, &last)) return 0.0f;
+  // Recut [0, the top of the last bin) evenly, spreading each bin over the
+  // even bins it overlaps.
+  const Index kBins = 2048;
+  const double top = Upper(last);
+  if (levels >= kBins) return static_cast<float>(top);
+  const double width = top / kBins;
+  std::vector<double> even(kBins);
+  for (Index b = first; b <= last; ++b) {
+    if (!counts_[b]) continue;
+    const double lower = Edge(b), upper = Upper(b);
+    Index j = std::min<Index>(kBins - 1, static_cast<Index>(lower / width));
+    if (upper == lower) {
+      even[j] += counts_[b];
+      continue;
+    }
+    for (; j < kBins && j * width < upper; ++j) {
+      const double overlap = std::min(upper, (j + 1) * width) - std::max(lower, j * width);
+      even[j] += counts_[b] * overlap / (upper - lower);
+    }
+  }
+  std::vector<double> above(kBins + 1);
+  for (Index j = kBins; j > 0; --j) {
+    above[j - 1] = above[j] + even[j - 1];
+  }
+
+  // For each threshold i bins up, P is the histogram clipped there and Q is
+  // the same with every run of i / levels bins merged to one level then spread
+  // back over the run's nonempty bins.
+  std::vector<double> q(kBins);
+  double best_divergence = std::numeric_limits<double>::infinity();
+  Index best = kBins;
+  for (Index i = levels; i <= kBins; ++i) {
+    const Index merged = i / levels;
+    for (Index level = 0; level < levels; ++level) {
+      const Index start = level * merged;
+      const Index stop = level + 1 == levels ? i : start + merged;
+      double sum = 0.0;
+      Index nonempty = 0;
+      for (Index j = start; j < stop; ++j) {
+        sum += even[j];
+        // P's last bin also holds everything clipped.
+        nonempty += (even[j] != 0.0 || (j == i - 1 && above[i] != 0.0));
+      }
+      for (Index j = start; j < stop; ++j) {
+        const bool in_p = even[j] != 0.0 || (j == i - 1 && above[i] != 0.0);
+        q[j] = in_p ? sum / nonempty : 0.0;
+      }
+    }
+    const double p_total = above[0];
+    const double q_total = above[0] - above[i];
+    if (q_total == 0.0) continue;
+    double divergence = 0.0;
+    for (Index j = 0; j < i; ++j) {
+      const double p = (j == i - 1 ? even[j] + above[i] : even[j]) / p_total;
+      if (p == 0.0) continue;
+      // Smooth bins that Q leaves empty.
+      const double qj = std::max(q[j] / q_total, 1e-10);
+      divergence += p * std::log(p / qj);
+    }
+    if (divergence < best_divergence) {
+      best_divergence = divergence;
+      best = i;
+    }
+  }
+  return static_cast<float>(best * width);
+}
+
+float AbsHistogram::MSEThreshold(float quantized_max) const {
+  Index first, last;
+  if (!Occupied(counts_, &first, &last)) return 0.0f;
+  double best_error = std::numeric_limits<double>::infinity();
+  float best = Upper(last);
+  for (Index t = first; t <= last; ++t) {
+    const double threshold = Upper(t);
+    const double step = threshold / quantized_max;
+    double error = 0.0;
+    for (Index b = first; b <= last; ++b) {
+      if (!counts_[b]) continue;
+      const double lower = Edge(b), upper = Upper(b);
+      double expected;
+      if (b <= t) {
+        // Rounding to a multiple of step costs step^2 / 12 unless everything
+        // rounds to 0.
+        expected = std::min((lower * lower + lower * upper + upper * upper) / 3.0, step * step / 12.0);
+      } else {
+        // Clipping to threshold.
+        const double l = lower - threshold, u = upper - threshold;
+        expected = (l * l + l * u + u * u) / 3.0;
+      }
+      error += counts_[b] * expected;
+    }
+    if (error < best_error) {
+      best_error = error;
+      best = static_cast<float>(threshold);
+    }
+  }
+  return best;
+}
+
+} // namespace intgemm
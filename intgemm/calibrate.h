@@ -0,0 +1,70 @@
+#pragma once
+/* Calibrate quant_mult from activations seen offline.
+ *
+ * 127 / MaxAbsolute lets one outlier waste most of the 8-bit range.  Instead
+ * count |x| of many batches into an AbsHistogram, from as many threads or
+ * machines as you like, merge them and pick a clipping threshold:
+ *   Percentile   the value below which a fraction of |x| lies;
+ *   KLThreshold  TensorRT's entropy calibration, minimizing the KL divergence
+ *                between the clipped distribution and its quantized version;
+ *   MSEThreshold minimizing the expected squared error of clipping plus
+ *                rounding.
+ * Then pass QuantMult(threshold) to PrepareA and friends.
+ *
+ * Bins are logarithmic, see kHistogramBins in stats.h, so histograms need no
+ * range and always merge.  Thresholds are exact to within a bin, which
+ * assumes the values in a bin are spread evenly.
+ */
+
+#include "intgemm.h"
+#include "types.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace intgemm {
+
+class AbsHistogram {
+  public:
+    AbsHistogram();
+
+    // Count |x| of [begin, end), including 0.  Any alignment.  Multithreaded
+    // with OpenMP for large arrays.
+    void Add(const float *begin, const float *end);
+
+    // Add the counts of other, as from another thread or shard.
+    AbsHistogram &operator+=(const AbsHistogram &other);
+
+    // Values counted.
+    uint64_t Total() const { return total_; }
+
+    // Count in each of kHistogramBins bins.
+    const std::vector<uint64_t> &Counts() const { return counts_; }
+
+    // Lower edge of bin: 0 for the first bin and infinity for kHistogramBins.
+    static float Edge(Index bin);
+
+    // The value that fraction of |x| is at or below, interpolating within the
+    // bin.  0 for an empty histogram.
+    float Percentile(double fraction) const;
+
+    // Threshold minimizing the KL divergence from the distribution of |x|
+    // clipped there to the same quantized to levels values.  The range up to
+    // the largest bin is recut into 2048 even bins first, as TensorRT does.
+    float KLThreshold(Index levels = 128) const;
+
+    // Threshold minimizing the expected squared error of clipping to it and
+    // rounding to multiples of threshold / quantized_max.
+    float MSEThreshold(float quantized_max = 127.0f) const;
+
+    // quant_mult that maps threshold to quantized_max.
+    static float QuantMult(float threshold, float quantized_max = 127.0f) {
+      return quantized_max / threshold;
+    }
+
+  private:
+    std::vector<uint64_t> counts_;
+    uint64_t total_;
+};
+
+} // namespace intgemm
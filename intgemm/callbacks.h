@@ -2,17 +2,32 @@
 
 #include "callbacks/configs.h"
 #include "callbacks/output_buffer_info.h"
+#include "callbacks/row_stats.h"
+#include "callbacks/top_k.h"
 
 #include "intgemm/intgemm_config.h"
 #include "intrinsics.h"
 #include "kernels.h"
+#include "stats.h"
 #include "types.h"
 #include "utils.h"
 #include "vec_traits.h"
 
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+#define CALLBACKS_THIS_IS_NEON
+#include "callbacks/implementations.inl"
+#undef CALLBACKS_THIS_IS_NEON
+#else
 #define CALLBACKS_THIS_IS_SSE2
 #include "callbacks/implementations.inl"
 #undef CALLBACKS_THIS_IS_SSE2
+#endif
 
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 #define CALLBACKS_THIS_IS_AVX2
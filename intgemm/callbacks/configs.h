@@ -1,5 +1,10 @@
 #pragma once
 
+#include "../types.h"
+#include "recurrent.h"
+
+#include <algorithm>
+#include <limits>
 #include <tuple>
 
 namespace intgemm {
@@ -19,11 +24,19 @@ std::tuple<Configs...> Sequence(const Configs&... configs) {
 struct Dummy {
 };
 
+// How the Write callbacks store C.  Stream uses non-temporal stores that
+// bypass the cache, so a large C that won't be read again soon, such as
+// vocabulary logits, doesn't evict B and A during the multiply.  Each thread
+// fences its streamed stores when it finishes.  Tiles that aren't aligned to
+// a vector, at the end of a row or because of ldc, use normal stores.
+enum class Store { Normal, Stream };
+
 template <typename Type>
 struct Write {
   Type* output_addr;
+  Store store;
 
-  Write(Type* output_addr) : output_addr(output_addr) {}
+  Write(Type* output_addr, Store store = Store::Normal) : output_addr(output_addr), store(store) {}
 };
 
 struct Unquantize {
@@ -35,15 +48,37 @@ struct Unquantize {
 struct UnquantizeAndWrite {
   float unquant_mult;
   float* output_addr;
+  Store store;
+
+  UnquantizeAndWrite(float unquant_mult, float* output_addr, Store store = Store::Normal) : unquant_mult(unquant_mult), output_addr(output_addr), store(store) {}
+};
+
+// For A from Int8::PrepareARows: C[r][c] = value * A_row_scales[r] * B_scale
+// where B_scale is 1 / B's quant_mult.
+struct UnquantizeRowsAndWrite {
+  const float* A_row_scales;
+  float B_scale;
+  float* output_addr;
+
+  UnquantizeRowsAndWrite(const float* A_row_scales, float B_scale, float* output_addr) : A_row_scales(A_row_scales), B_scale(B_scale), output_addr(output_addr) {}
+};
+
+// For B from PrepareBColumns: C[r][c] = value * unquant_mult * column_mults[c].
+// column_mults is aligned like a bias.
+struct UnquantizeColumnsAndWrite {
+  float unquant_mult;
+  const float* column_mults;
+  float* output_addr;
 
-  UnquantizeAndWrite(float unquant_mult, float* output_addr) : unquant_mult(unquant_mult), output_addr(output_addr) {}
+  UnquantizeColumnsAndWrite(float unquant_mult, const float* column_mults, float* output_addr) : unquant_mult(unquant_mult), column_mults(column_mults), output_addr(output_addr) {}
 };
 
 struct UnquantizeAndWriteRelu {
   float unquant_mult;
   float* output_addr;
+  Store store;
 
-  UnquantizeAndWriteRelu(float unquant_mult, float* output_addr) : unquant_mult(unquant_mult), output_addr(output_addr) {}
+  UnquantizeAndWriteRelu(float unquant_mult, float* output_addr, Store store = Store::Normal) : unquant_mult(unquant_mult), output_addr(output_addr), store(store) {}
 };
 
 struct AddBiasAndWrite {
@@ -53,20 +88,295 @@ struct AddBiasAndWrite {
   AddBiasAndWrite(const int* bias_addr, int* output_addr) :  bias_addr(bias_addr), output_addr(output_addr) {}
 };
 
+// C += value, adding this multiply's int32 results to those already in C,
+// for example another part of the shared dimension.
+struct AddAndWrite {
+  int* output_addr;
+
+  AddAndWrite(int* output_addr) : output_addr(output_addr) {}
+};
+
+// C = value * unquant_mult + beta * C, so several multiplies, such as of the
+// parts of a concatenated input, add up into one float C.  With beta 0, C
+// isn't read and can start uninitialized.
+struct UnquantizeAndAccumulate {
+  float unquant_mult;
+  float beta;
+  float* output_addr;
+
+  UnquantizeAndAccumulate(float unquant_mult, float beta, float* output_addr) : unquant_mult(unquant_mult), beta(beta), output_addr(output_addr) {}
+};
+
+// UnquantizeAndWrite and UnquantizeAndAddBiasAndWrite that store C as
+// BFloat16 or Half, rounding to nearest even, for layers that take 16-bit
+// activations.  See float16.h.
+template <typename Type>
+struct UnquantizeAndWriteFloat16 {
+  float unquant_mult;
+  Type* output_addr;
+
+  UnquantizeAndWriteFloat16(float unquant_mult, Type* output_addr) : unquant_mult(unquant_mult), output_addr(output_addr) {}
+};
+
+template <typename Type>
+struct UnquantizeAndAddBiasAndWriteFloat16 {
+  float unquant_mult;
+  const float* bias_addr;
+  Type* output_addr;
+
+  UnquantizeAndAddBiasAndWriteFloat16(float unquant_mult, const float* bias_addr, Type* output_addr) : unquant_mult(unquant_mult), bias_addr(bias_addr), output_addr(output_addr) {}
+};
+
 struct UnquantizeAndAddBiasAndWrite {
   float unquant_mult;
   const float* bias_addr;
   float* output_addr;
+  Store store;
+
+  UnquantizeAndAddBiasAndWrite(float unquant_mult, const float* bias_addr, float* output_addr, Store store = Store::Normal) : unquant_mult(unquant_mult), bias_addr(bias_addr), output_addr(output_addr), store(store) {}
+};
+
+struct UnquantizeColumnsAndAddBiasAndWrite {
+  float unquant_mult;
+  const float* column_mults;
+  const float* bias_addr;
+  float* output_addr;
+
+  UnquantizeColumnsAndAddBiasAndWrite(float unquant_mult, const float* column_mults, const float* bias_addr, float* output_addr) : unquant_mult(unquant_mult), column_mults(column_mults), bias_addr(bias_addr), output_addr(output_addr) {}
+};
+
+// Softmax of each row of C = value * unquant_mult + bias without a separate
+// pass to find the max and sum.  Each 8-column tile of a row is written as
+// exp(logit - the tile's max) and tile_stats gets the tile's max then sum of
+// those exps: 2 * rows * cols / 8 floats.  FinishSoftmax then scales each
+// tile in place in one pass over C.
+struct UnquantizeAndAddBiasAndSoftmax {
+  float unquant_mult;
+  const float* bias_addr;
+  float* output_addr;
+  float* tile_stats;
+
+  UnquantizeAndAddBiasAndSoftmax(float unquant_mult, const float* bias_addr, float* output_addr, float* tile_stats) : unquant_mult(unquant_mult), bias_addr(bias_addr), output_addr(output_addr), tile_stats(tile_stats) {}
+};
+
+// The same for log softmax: C gets the logits and FinishLogSoftmax
+// subtracts each row's log sum exp.
+struct UnquantizeAndAddBiasAndLogSoftmax {
+  float unquant_mult;
+  const float* bias_addr;
+  float* output_addr;
+  float* tile_stats;
+
+  UnquantizeAndAddBiasAndLogSoftmax(float unquant_mult, const float* bias_addr, float* output_addr, float* tile_stats) : unquant_mult(unquant_mult), bias_addr(bias_addr), output_addr(output_addr), tile_stats(tile_stats) {}
+};
+
+// C = value * unquant_mult + bias + residual, where residual is a float
+// matrix shaped like C and may be C itself.  Also adds up each row's sum then
+// sum of squares into row_stats, 2 * rows doubles, so LayerNorm can
+// normalize C afterwards in one pass.  Each thread sums the part of the rows
+// it multiplies and merges when done.  The constructor zeroes row_stats.
+struct UnquantizeAndAddBiasAndResidualAndWrite {
+  float unquant_mult;
+  const float* bias_addr;
+  const float* residual_addr;
+  float* output_addr;
+  double* row_stats;
+
+  UnquantizeAndAddBiasAndResidualAndWrite(float unquant_mult, const float* bias_addr, const float* residual_addr, float* output_addr, double* row_stats, Index rows) : unquant_mult(unquant_mult), bias_addr(bias_addr), residual_addr(residual_addr), output_addr(output_addr), row_stats(row_stats) {
+    std::fill(row_stats, row_stats + 2 * rows, 0.0);
+  }
+};
+
+// Activation applied by UnquantizeAddBiasActivateAndQuantize.
+enum class Activation { None, Relu, Gelu, Silu, Sigmoid, Tanh };
+
+// Writes activation(value * unquant_mult + bias) quantized with quant_mult
+// straight into the prepared A of the next 8-bit layer, so int8 layers chain
+// without materializing floats.  Type is int8_t to match Int8::PrepareA or
+// uint8_t to match Int8Shift::PrepareA, which writes the same bytes through
+// an int8_t pointer.  The next layer's width is this layer's B_cols.
+template <class Type, Activation kActivation = Activation::None>
+struct UnquantizeAddBiasActivateAndQuantize {
+  float unquant_mult;
+  const float* bias_addr;
+  float quant_mult;
+  Type* output_addr;
+
+  UnquantizeAddBiasActivateAndQuantize(float unquant_mult, const float* bias_addr, float quant_mult, Type* output_addr) : unquant_mult(unquant_mult), bias_addr(bias_addr), quant_mult(quant_mult), output_addr(output_addr) {}
+};
+
+// The k largest values of each row of C = value * unquant_mult + bias,
+// without writing C.  Each thread keeps the top k of the rows it multiplies
+// and merges them in when its part is done.  Afterwards scores_addr and
+// indices_addr, rows * k each, hold every row's top k in descending order
+// with their columns.  The constructor resets them, so make a new config for
+// each multiply.
+struct UnquantizeAndAddBiasAndTopK {
+  float unquant_mult;
+  const float* bias_addr;
+  Index k;
+  float* scores_addr;
+  Index* indices_addr;
 
-  UnquantizeAndAddBiasAndWrite(float unquant_mult, const float* bias_addr, float* output_addr) : unquant_mult(unquant_mult), bias_addr(bias_addr), output_addr(output_addr) {}
+  UnquantizeAndAddBiasAndTopK(float unquant_mult, const float* bias_addr, Index k, float* scores_addr, Index* indices_addr, Index rows) : unquant_mult(unquant_mult), bias_addr(bias_addr), k(k), scores_addr(scores_addr), indices_addr(indices_addr) {
+    std::fill(scores_addr, scores_addr + rows * k, -std::numeric_limits<float>::infinity());
+    std::fill(indices_addr, indices_addr + rows * k, 0);
+  }
 };
 
 struct UnquantizeAndAddBiasAndWriteRelu {
   float unquant_mult;
   const float* bias_addr;
   float* output_addr;
+  Store store;
+
+  UnquantizeAndAddBiasAndWriteRelu(float unquant_mult, const float* bias_addr, float* output_addr, Store store = Store::Normal) : unquant_mult(unquant_mult), bias_addr(bias_addr), output_addr(output_addr), store(store) {}
+};
+
+// Writes the GELU (tanh approximation) of value * unquant_mult + bias.
+struct UnquantizeAndAddBiasAndWriteGelu {
+  float unquant_mult;
+  const float* bias_addr;
+  float* output_addr;
+
+  UnquantizeAndAddBiasAndWriteGelu(float unquant_mult, const float* bias_addr, float* output_addr) : unquant_mult(unquant_mult), bias_addr(bias_addr), output_addr(output_addr) {}
+};
+
+// Writes the SiLU (Swish), x * sigmoid(x) of value * unquant_mult + bias.
+struct UnquantizeAndAddBiasAndWriteSilu {
+  float unquant_mult;
+  const float* bias_addr;
+  float* output_addr;
+
+  UnquantizeAndAddBiasAndWriteSilu(float unquant_mult, const float* bias_addr, float* output_addr) : unquant_mult(unquant_mult), bias_addr(bias_addr), output_addr(output_addr) {}
+};
+
+// The up projection of a SiLU gated feed forward layer in one
+// Int8::MultiplyMulti: writes (value * unquant_mult + bias) * silu(gate),
+// where gate is a float matrix shaped like C.  Give the gate projection an
+// earlier B with the same B_cols and gate_addr null, which writes
+// value * unquant_mult + bias, and each tile of gate is there when needed.
+// output_addr may be gate_addr.
+struct UnquantizeAndAddBiasAndMultiplySilu {
+  float unquant_mult;
+  const float* bias_addr;
+  const float* gate_addr;
+  float* output_addr;
+
+  UnquantizeAndAddBiasAndMultiplySilu(float unquant_mult, const float* bias_addr, const float* gate_addr, float* output_addr) : unquant_mult(unquant_mult), bias_addr(bias_addr), gate_addr(gate_addr), output_addr(output_addr) {}
+};
+
+// Writes the sigmoid of value * unquant_mult + bias.
+struct UnquantizeAndAddBiasAndWriteSigmoid {
+  float unquant_mult;
+  const float* bias_addr;
+  float* output_addr;
+
+  UnquantizeAndAddBiasAndWriteSigmoid(float unquant_mult, const float* bias_addr, float* output_addr) : unquant_mult(unquant_mult), bias_addr(bias_addr), output_addr(output_addr) {}
+};
+
+// Writes the tanh of value * unquant_mult + bias.
+struct UnquantizeAndAddBiasAndWriteTanh {
+  float unquant_mult;
+  const float* bias_addr;
+  float* output_addr;
+
+  UnquantizeAndAddBiasAndWriteTanh(float unquant_mult, const float* bias_addr, float* output_addr) : unquant_mult(unquant_mult), bias_addr(bias_addr), output_addr(output_addr) {}
+};
+
+// One step of an LSTM cell from an Int8 multiply of h by the 4 gates'
+// weights, columns placed by RecurrentGateColumn(4, ...) so C would be
+// rows * 4 hidden.  Each gate is value * unquant_mult + bias, plus input if
+// not null, which holds x's projection shaped like C.  Then
+//   c = sigmoid(f) * cell + sigmoid(i) * tanh(g)
+//   h = sigmoid(o) * tanh(c)
+// go to cell_output_addr and hidden_output_addr, rows * hidden each.
+// cell_output_addr may be cell_addr.  hidden must be a multiple of 8 and
+// scratch sized for C.  The constructor resets scratch, so make a new config
+// for each multiply.
+struct UnquantizeAndLSTMCell {
+  float unquant_mult;
+  const float* bias_addr;
+  const float* input_addr;
+  const float* cell_addr;
+  float* cell_output_addr;
+  float* hidden_output_addr;
+  float* gates_addr;
+  std::atomic<uint32_t>* arrived_addr;
+
+  UnquantizeAndLSTMCell(float unquant_mult, const float* bias_addr, const float* input_addr, const float* cell_addr, float* cell_output_addr, float* hidden_output_addr, RecurrentScratch& scratch) : unquant_mult(unquant_mult), bias_addr(bias_addr), input_addr(input_addr), cell_addr(cell_addr), cell_output_addr(cell_output_addr), hidden_output_addr(hidden_output_addr), gates_addr(scratch.Gates()), arrived_addr(scratch.Arrived()) {
+    scratch.Reset();
+  }
+};
+
+// One step of a GRU cell from an Int8 multiply of hidden by the 3 gates'
+// recurrent weights, columns placed by RecurrentGateColumn(3, ...).  input,
+// shaped like C, holds x's projection with its bias; bias is the recurrent
+// one.  With each gate's h part value * unquant_mult + bias,
+//   r = sigmoid(x_r + h_r), z = sigmoid(x_z + h_z)
+//   n = tanh(x_n + r * h_n)
+//   h = n + z * (hidden - n)
+// goes to hidden_output_addr, which may be hidden_addr.  Otherwise as
+// UnquantizeAndLSTMCell.
+struct UnquantizeAndGRUCell {
+  float unquant_mult;
+  const float* bias_addr;
+  const float* input_addr;
+  const float* hidden_addr;
+  float* hidden_output_addr;
+  float* gates_addr;
+  std::atomic<uint32_t>* arrived_addr;
+
+  UnquantizeAndGRUCell(float unquant_mult, const float* bias_addr, const float* input_addr, const float* hidden_addr, float* hidden_output_addr, RecurrentScratch& scratch) : unquant_mult(unquant_mult), bias_addr(bias_addr), input_addr(input_addr), hidden_addr(hidden_addr), hidden_output_addr(hidden_output_addr), gates_addr(scratch.Gates()), arrived_addr(scratch.Arrived()) {
+    scratch.Reset();
+  }
+};
+
+// Runs callback as if C's rows were ldc elements apart, so C can be a block of
+// columns of a wider matrix.  Rows start at output_addr + row * ldc.  For the
+// callbacks that write C; softmax, residual and top k keep their own layout
+// since their finishing passes take C whole.
+template <class Callback>
+struct StridedOutput {
+  Index ldc;
+  Callback callback;
+
+  StridedOutput(Index ldc, const Callback& callback) : ldc(ldc), callback(callback) {}
+};
+
+template <class Callback>
+StridedOutput<Callback> Strided(Index ldc, const Callback& callback) {
+  return StridedOutput<Callback>(ldc, callback);
+}
+
+// Runs callback on a multiply of a block of B's columns starting at col_begin
+// as if it were that block of the full multiply with cols columns: the
+// callback sees the full C's column indices, so output, bias and per-column
+// arrays are the full ones.  For the callbacks that write C, as with Strided.
+template <class Callback>
+struct ColumnOffsetOutput {
+  Index col_begin;
+  Index cols;
+  Callback callback;
+
+  ColumnOffsetOutput(Index col_begin, Index cols, const Callback& callback) : col_begin(col_begin), cols(cols), callback(callback) {}
+};
+
+template <class Callback>
+ColumnOffsetOutput<Callback> ColumnOffset(Index col_begin, Index cols, const Callback& callback) {
+  return ColumnOffsetOutput<Callback>(col_begin, cols, callback);
+}
+
+// Runs callback on a multiply whose B was padded to a multiple of 8 columns,
+// as Int8::MultiplyPadded does, so that C has only the first cols columns.
+// The write callbacks and top k drop the padding; softmax and residual need
+// whole tiles.
+template <class Callback>
+struct ColumnTail {
+  Index cols;
+  Callback callback;
 
-  UnquantizeAndAddBiasAndWriteRelu(float unquant_mult, const float* bias_addr, float* output_addr) : unquant_mult(unquant_mult), bias_addr(bias_addr), output_addr(output_addr) {}
+  ColumnTail(Index cols, const Callback& callback) : cols(cols), callback(callback) {}
 };
 
 }
@@ -8,14 +8,21 @@
 #elif defined(CALLBACKS_THIS_IS_AVX512BW)
   #define CPU_NAME AVX512BW
   #define INTGEMM_TARGET INTGEMM_AVX512BW
+#elif defined(CALLBACKS_THIS_IS_NEON)
+  #define CPU_NAME NEON
+  #define INTGEMM_TARGET INTGEMM_NEON
 #else
-  #error "Only SSE2, AVX2 and AVX512BW are supported"
+  #error "Only SSE2, AVX2, AVX512BW and NEON are supported"
 #endif
 
 #if defined(CALLBACKS_THIS_IS_SSE2)
   #define vi vector_t<CPUType::SSE2, int>
   #define vf vector_t<CPUType::SSE2, float>
   #define vd vector_t<CPUType::SSE2, double>
+#elif defined(CALLBACKS_THIS_IS_NEON)
+  #define vi vector_t<CPUType::NEON, int>
+  #define vf vector_t<CPUType::NEON, float>
+  #define vd vector_t<CPUType::NEON, double>
 #else
   #define vi vector_t<CPUType::AVX2, int>
   #define vf vector_t<CPUType::AVX2, float>
@@ -35,6 +42,9 @@ namespace callbacks {
 template <CPUType CpuType, typename CallbackConfig>
 class CallbackImpl;
 
+template <CPUType CpuType>
+struct OutputTile;
+
 }}
 
 /*
@@ -43,6 +53,92 @@ class CallbackImpl;
 namespace intgemm {
 namespace callbacks {
 
+/*
+ * Stores for the callbacks that write C.  A tile is written to row
+ * info.row_idx of output from column info.col_idx.  When C ends inside the
+ * tile (see ColumnTail) or its rows don't keep tiles aligned, the tile goes
+ * through the stack and only the columns before info.cols are copied out.
+ */
+template <> struct OutputTile<CPUType::CPU_NAME> {
+  template <class Vector, class Type>
+  INTGEMM_TARGET static inline void Write(Vector input, Type* output, const OutputBufferInfo& info) {
+    const Index lanes = sizeof(Vector) / sizeof(Type);
+    const Index offset = info.row_idx * info.ldc + info.col_idx;
+    if (info.col_idx + lanes <= info.cols && offset % lanes == 0) {
+      kernels::write(input, output, offset);
+    } else if (info.col_idx < info.cols) {
+      alignas(sizeof(Vector)) Type values[lanes];
+      kernels::write(input, values, 0);
+      std::memcpy(output + offset, values, std::min(lanes, info.cols - info.col_idx) * sizeof(Type));
+    }
+  }
+
+  // The tile Write would write, read back from input.  Columns from
+  // info.cols on are zero.
+  template <class Vector, class Type>
+  INTGEMM_TARGET static inline Vector Read(const Type* input, const OutputBufferInfo& info) {
+    const Index lanes = sizeof(Vector) / sizeof(Type);
+    const Index offset = info.row_idx * info.ldc + info.col_idx;
+    if (info.col_idx + lanes <= info.cols && offset % lanes == 0) {
+      return *reinterpret_cast<const Vector*>(input + offset);
+    }
+    alignas(sizeof(Vector)) Type values[lanes] = {};
+    if (info.col_idx < info.cols) {
+      std::memcpy(values, input + offset, std::min(lanes, info.cols - info.col_idx) * sizeof(Type));
+    }
+    Vector result;
+    std::memcpy(&result, values, sizeof(Vector));
+    return result;
+  }
+
+  // Write, with non-temporal stores for Store::Stream.
+  template <class Vector, class Type>
+  INTGEMM_TARGET static inline void Write(Vector input, Type* output, const OutputBufferInfo& info, Store store) {
+    const Index lanes = sizeof(Vector) / sizeof(Type);
+    const Index offset = info.row_idx * info.ldc + info.col_idx;
+    if (store == Store::Stream && info.col_idx + lanes <= info.cols && offset % lanes == 0) {
+      kernels::write_stream(input, output, offset);
+    } else {
+      Write(input, output, info);
+    }
+  }
+
+  // Orders a thread's streamed stores before what it does next, such as
+  // leaving the parallel region.
+  INTGEMM_TARGET static inline void Fence() {
+#if !defined(CALLBACKS_THIS_IS_NEON)
+    _mm_sfence();
+#endif
+  }
+
+  template <class Type>
+  INTGEMM_TARGET static inline void WriteQuantized(vi input, Type* output, const OutputBufferInfo& info) {
+    const Index lanes = sizeof(vi) / sizeof(int);
+    const Index offset = info.row_idx * info.ldc + info.col_idx;
+    if (info.col_idx + lanes <= info.cols) {
+      kernels::write_quantized(input, output, offset);
+    } else if (info.col_idx < info.cols) {
+      Type values[lanes];
+      kernels::write_quantized(input, values, 0);
+      std::memcpy(output + offset, values, (info.cols - info.col_idx) * sizeof(Type));
+    }
+  }
+
+  // Write as BFloat16 or Half, which have half the bytes of the floats.
+  template <class Type>
+  INTGEMM_TARGET static inline void WriteFloat16(vf input, Type* output, const OutputBufferInfo& info) {
+    const Index lanes = sizeof(vf) / sizeof(float);
+    const Index offset = info.row_idx * info.ldc + info.col_idx;
+    if (info.col_idx + lanes <= info.cols) {
+      kernels::write_float16(input, output, offset);
+    } else if (info.col_idx < info.cols) {
+      Type values[lanes];
+      kernels::write_float16(input, values, 0);
+      std::memcpy(output + offset, values, (info.cols - info.col_idx) * sizeof(Type));
+    }
+  }
+};
+
 /*
  * Sequence
  */
@@ -100,8 +196,12 @@ class CallbackImpl<CPUType::CPU_NAME, Write<Type>> {
 public:
   explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const Write<Type>& config) : config(config) {}
 
+  ~CallbackImpl() {
+    if (config.store == Store::Stream) OutputTile<CPUType::CPU_NAME>::Fence();
+  }
+
   INTGEMM_TARGET void Run(vector_t<CPUType::CPU_NAME, Type> input, const OutputBufferInfo& info) {
-    kernels::write(input, config.output_addr, info.row_idx * info.cols + info.col_idx);
+    OutputTile<CPUType::CPU_NAME>::Write(input, config.output_addr, info, config.store);
   }
 
 private:
@@ -135,16 +235,20 @@ public:
     unquant_mult = set1_ps<vf>(config.unquant_mult);
   }
 
+  ~CallbackImpl() {
+    if (config.store == Store::Stream) OutputTile<CPUType::CPU_NAME>::Fence();
+  }
+
   INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
     // Workaround gcc 5 internal compiler error that can't read register members in debug.
     vf mult_reg;
-#if !defined(__OPTIMIZE__) && (__GNUC__ == 5) && !defined(__clang__) && !defined(__INTEL_COMPILER)
+#if !defined(__OPTIMIZE__) && (__GNUC__ == 5) && !defined(__clang__) && !defined(__INTEL_COMPILER) && !defined(CALLBACKS_THIS_IS_NEON)
     asm ("vmovdqa %1, %0" : "=x" (mult_reg) : "m" (unquant_mult));
 #else
     mult_reg = unquant_mult;
 #endif
     auto result = kernels::unquantize(input, mult_reg);
-    kernels::write(result, config.output_addr, info.row_idx * info.cols + info.col_idx);
+    OutputTile<CPUType::CPU_NAME>::Write(result, config.output_addr, info, config.store);
   }
 
 private:
@@ -152,6 +256,42 @@ private:
   UnquantizeAndWrite config;
 };
 
+/*
+ * UnquantizeRowsAndWrite
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeRowsAndWrite> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const UnquantizeRowsAndWrite& config) : config(config) {}
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    auto result = kernels::unquantize(input, set1_ps<vf>(config.A_row_scales[info.row_idx] * config.B_scale));
+    OutputTile<CPUType::CPU_NAME>::Write(result, config.output_addr, info);
+  }
+
+private:
+  UnquantizeRowsAndWrite config;
+};
+
+/*
+ * UnquantizeColumnsAndWrite
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeColumnsAndWrite> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const UnquantizeColumnsAndWrite& config) : config(config) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+  }
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    auto column_mults = *reinterpret_cast<const vf*>(config.column_mults + info.col_idx);
+    auto result = kernels::unquantize(input, mul_ps(unquant_mult, column_mults));
+    OutputTile<CPUType::CPU_NAME>::Write(result, config.output_addr, info);
+  }
+
+private:
+  vf unquant_mult;
+  UnquantizeColumnsAndWrite config;
+};
+
 /*
  * UnquantizeAndWriteRelu
  */
@@ -161,16 +301,20 @@ public:
     unquant_mult = set1_ps<vf>(config.unquant_mult);
   }
 
+  ~CallbackImpl() {
+    if (config.store == Store::Stream) OutputTile<CPUType::CPU_NAME>::Fence();
+  }
+
   INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
     // Workaround gcc 5 internal compiler error that can't read register members in debug.
     vf mult_reg;
-#if !defined(__OPTIMIZE__) && (__GNUC__ == 5) && !defined(__clang__) && !defined(__INTEL_COMPILER)
+#if !defined(__OPTIMIZE__) && (__GNUC__ == 5) && !defined(__clang__) && !defined(__INTEL_COMPILER) && !defined(CALLBACKS_THIS_IS_NEON)
     asm ("vmovdqa %1, %0" : "=x" (mult_reg) : "m" (unquant_mult));
 #else
     mult_reg = unquant_mult;
 #endif
     auto result = kernels::relu<float>(kernels::unquantize(input, mult_reg));
-    kernels::write(result, config.output_addr, info.row_idx * info.cols + info.col_idx);
+    OutputTile<CPUType::CPU_NAME>::Write(result, config.output_addr, info, config.store);
   }
 
 private:
@@ -188,13 +332,92 @@ public:
 
   INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
     auto result = kernels::add_bias(input, config.bias_addr, info.col_idx);
-    kernels::write(result, config.output_addr, info.row_idx * info.cols + info.col_idx);
+    OutputTile<CPUType::CPU_NAME>::Write(result, config.output_addr, info);
   }
 
 private:
   AddBiasAndWrite config;
 };
 
+/*
+ * AddAndWrite
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, AddAndWrite> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const AddAndWrite& config) : config(config) {}
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    auto result = add_epi32(input, OutputTile<CPUType::CPU_NAME>::Read<vi>(config.output_addr, info));
+    OutputTile<CPUType::CPU_NAME>::Write(result, config.output_addr, info);
+  }
+
+private:
+  AddAndWrite config;
+};
+
+/*
+ * UnquantizeAndAccumulate
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeAndAccumulate> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const UnquantizeAndAccumulate& config) : config(config) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+    beta = set1_ps<vf>(config.beta);
+  }
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    auto result = kernels::unquantize(input, unquant_mult);
+    if (config.beta != 0.0f) {
+      result = add_ps(result, mul_ps(beta, OutputTile<CPUType::CPU_NAME>::Read<vf>(config.output_addr, info)));
+    }
+    OutputTile<CPUType::CPU_NAME>::Write(result, config.output_addr, info);
+  }
+
+private:
+  vf unquant_mult;
+  vf beta;
+  UnquantizeAndAccumulate config;
+};
+
+/*
+ * UnquantizeAndWriteFloat16
+ */
+template <class Type> class CallbackImpl<CPUType::CPU_NAME, UnquantizeAndWriteFloat16<Type>> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const UnquantizeAndWriteFloat16<Type>& config) : config(config) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+  }
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    auto result = kernels::unquantize(input, unquant_mult);
+    OutputTile<CPUType::CPU_NAME>::WriteFloat16(result, config.output_addr, info);
+  }
+
+private:
+  vf unquant_mult;
+  UnquantizeAndWriteFloat16<Type> config;
+};
+
+/*
+ * UnquantizeAndAddBiasAndWriteFloat16
+ */
+template <class Type> class CallbackImpl<CPUType::CPU_NAME, UnquantizeAndAddBiasAndWriteFloat16<Type>> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const UnquantizeAndAddBiasAndWriteFloat16<Type>& config) : config(config) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+  }
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    auto result = kernels::unquantize(input, unquant_mult);
+    result = kernels::add_bias(result, config.bias_addr, info.col_idx);
+    OutputTile<CPUType::CPU_NAME>::WriteFloat16(result, config.output_addr, info);
+  }
+
+private:
+  vf unquant_mult;
+  UnquantizeAndAddBiasAndWriteFloat16<Type> config;
+};
+
 /*
  * UnquantizeAndAddBiasAndWrite
  */
@@ -204,23 +427,47 @@ public:
     unquant_mult = set1_ps<vf>(config.unquant_mult);
   }
 
+  ~CallbackImpl() {
+    if (config.store == Store::Stream) OutputTile<CPUType::CPU_NAME>::Fence();
+  }
+
   INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
     // Workaround gcc 5 internal compiler error that can't read register members in debug.
     vf mult_reg;
-#if !defined(__OPTIMIZE__) && (__GNUC__ == 5) && !defined(__clang__) && !defined(__INTEL_COMPILER)
+#if !defined(__OPTIMIZE__) && (__GNUC__ == 5) && !defined(__clang__) && !defined(__INTEL_COMPILER) && !defined(CALLBACKS_THIS_IS_NEON)
     asm ("vmovdqa %1, %0" : "=x" (mult_reg) : "m" (unquant_mult));
 #else
     mult_reg = unquant_mult;
 #endif
     auto result = kernels::unquantize(input, mult_reg);
     result = kernels::add_bias(result, config.bias_addr, info.col_idx);
-    kernels::write(result, config.output_addr, info.row_idx * info.cols + info.col_idx);
+    OutputTile<CPUType::CPU_NAME>::Write(result, config.output_addr, info, config.store);
   }
 private:
   vf unquant_mult;
   UnquantizeAndAddBiasAndWrite config;
 };
 
+/*
+ * UnquantizeColumnsAndAddBiasAndWrite
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeColumnsAndAddBiasAndWrite> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const UnquantizeColumnsAndAddBiasAndWrite& config) : config(config) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+  }
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    auto column_mults = *reinterpret_cast<const vf*>(config.column_mults + info.col_idx);
+    auto result = kernels::unquantize(input, mul_ps(unquant_mult, column_mults));
+    result = kernels::add_bias(result, config.bias_addr, info.col_idx);
+    OutputTile<CPUType::CPU_NAME>::Write(result, config.output_addr, info);
+  }
+private:
+  vf unquant_mult;
+  UnquantizeColumnsAndAddBiasAndWrite config;
+};
+
 /*
  * UnquantizeAndAddBiasAndWrite
  */
@@ -230,10 +477,14 @@ public:
     unquant_mult = set1_ps<vf>(config.unquant_mult);
   }
 
+  ~CallbackImpl() {
+    if (config.store == Store::Stream) OutputTile<CPUType::CPU_NAME>::Fence();
+  }
+
   INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
     // Workaround gcc 5 internal compiler error that can't read register members in debug.
     vf mult_reg;
-#if !defined(__OPTIMIZE__) && (__GNUC__ == 5) && !defined(__clang__) && !defined(__INTEL_COMPILER)
+#if !defined(__OPTIMIZE__) && (__GNUC__ == 5) && !defined(__clang__) && !defined(__INTEL_COMPILER) && !defined(CALLBACKS_THIS_IS_NEON)
     asm ("vmovdqa %1, %0" : "=x" (mult_reg) : "m" (unquant_mult));
 #else
     mult_reg = unquant_mult;
@@ -241,13 +492,440 @@ public:
     auto result = kernels::unquantize(input, mult_reg);
     result = kernels::add_bias(result, config.bias_addr, info.col_idx);
     result = kernels::relu<float>(result);
-    kernels::write(result, config.output_addr, info.row_idx * info.cols + info.col_idx);
+    OutputTile<CPUType::CPU_NAME>::Write(result, config.output_addr, info, config.store);
   }
 private:
   vf unquant_mult;
   UnquantizeAndAddBiasAndWriteRelu config;
 };
 
+/*
+ * UnquantizeAndAddBiasAndWriteGelu
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeAndAddBiasAndWriteGelu> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const UnquantizeAndAddBiasAndWriteGelu& config) : config(config) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+  }
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    auto result = kernels::unquantize(input, unquant_mult);
+    result = kernels::add_bias(result, config.bias_addr, info.col_idx);
+    result = kernels::gelu(result);
+    OutputTile<CPUType::CPU_NAME>::Write(result, config.output_addr, info);
+  }
+private:
+  vf unquant_mult;
+  UnquantizeAndAddBiasAndWriteGelu config;
+};
+
+/*
+ * UnquantizeAndAddBiasAndWriteSilu
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeAndAddBiasAndWriteSilu> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const UnquantizeAndAddBiasAndWriteSilu& config) : config(config) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+  }
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    auto result = kernels::unquantize(input, unquant_mult);
+    result = kernels::add_bias(result, config.bias_addr, info.col_idx);
+    result = kernels::silu(result);
+    OutputTile<CPUType::CPU_NAME>::Write(result, config.output_addr, info);
+  }
+private:
+  vf unquant_mult;
+  UnquantizeAndAddBiasAndWriteSilu config;
+};
+
+/*
+ * UnquantizeAndAddBiasAndMultiplySilu
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeAndAddBiasAndMultiplySilu> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const UnquantizeAndAddBiasAndMultiplySilu& config) : config(config) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+  }
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    auto result = kernels::unquantize(input, unquant_mult);
+    result = kernels::add_bias(result, config.bias_addr, info.col_idx);
+    if (config.gate_addr) {
+      result = mul_ps(result, kernels::silu(OutputTile<CPUType::CPU_NAME>::Read<vf>(config.gate_addr, info)));
+    }
+    OutputTile<CPUType::CPU_NAME>::Write(result, config.output_addr, info);
+  }
+private:
+  vf unquant_mult;
+  UnquantizeAndAddBiasAndMultiplySilu config;
+};
+
+/*
+ * UnquantizeAndAddBiasAndWriteSigmoid
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeAndAddBiasAndWriteSigmoid> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const UnquantizeAndAddBiasAndWriteSigmoid& config) : config(config) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+  }
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    auto result = kernels::unquantize(input, unquant_mult);
+    result = kernels::add_bias(result, config.bias_addr, info.col_idx);
+    result = kernels::sigmoid(result);
+    OutputTile<CPUType::CPU_NAME>::Write(result, config.output_addr, info);
+  }
+private:
+  vf unquant_mult;
+  UnquantizeAndAddBiasAndWriteSigmoid config;
+};
+
+/*
+ * UnquantizeAndAddBiasAndWriteTanh
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeAndAddBiasAndWriteTanh> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const UnquantizeAndAddBiasAndWriteTanh& config) : config(config) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+  }
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    auto result = kernels::unquantize(input, unquant_mult);
+    result = kernels::add_bias(result, config.bias_addr, info.col_idx);
+    result = kernels::tanh(result);
+    OutputTile<CPUType::CPU_NAME>::Write(result, config.output_addr, info);
+  }
+private:
+  vf unquant_mult;
+  UnquantizeAndAddBiasAndWriteTanh config;
+};
+
+/*
+ * UnquantizeAndAddBiasAndResidualAndWrite
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeAndAddBiasAndResidualAndWrite> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const UnquantizeAndAddBiasAndResidualAndWrite& config) : config(config), row_begin(0), row_end(0) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+  }
+
+  // As for UnquantizeAndAddBiasAndTopK, this object's rows are the thread's.
+  ~CallbackImpl() {
+    MergeRowStats(config.row_stats, stats.data(), row_begin, row_end);
+  }
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    const Index offset = info.row_idx * info.cols + info.col_idx;
+    auto result = kernels::unquantize(input, unquant_mult);
+    result = kernels::add_bias(result, config.bias_addr, info.col_idx);
+    result = kernels::add_bias(result, config.residual_addr, offset);
+    kernels::write(result, config.output_addr, offset);
+    if (stats.empty()) {
+      stats.assign(2 * info.rows, 0.0);
+      row_begin = info.row_idx;
+      row_end = info.row_idx + 1;
+    }
+    row_begin = std::min(row_begin, info.row_idx);
+    row_end = std::max(row_end, info.row_idx + 1);
+    stats[2 * info.row_idx] += AddFloat32(result);
+    stats[2 * info.row_idx + 1] += AddFloat32(mul_ps(result, result));
+  }
+
+private:
+  vf unquant_mult;
+  UnquantizeAndAddBiasAndResidualAndWrite config;
+  std::vector<double> stats;
+  Index row_begin, row_end;
+};
+
+/*
+ * UnquantizeAndLSTMCell
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeAndLSTMCell> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const UnquantizeAndLSTMCell& config) : config(config) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+  }
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    const Index lanes = sizeof(vf) / sizeof(float);
+    const Index offset = info.row_idx * info.cols + info.col_idx;
+    auto result = kernels::unquantize(input, unquant_mult);
+    result = kernels::add_bias(result, config.bias_addr, info.col_idx);
+    if (config.input_addr) result = kernels::add_bias(result, config.input_addr, offset);
+    // The cell gate is the third 8 columns of each block.
+    result = (info.col_idx / 8) % 4 == 2 ? kernels::tanh(result) : kernels::sigmoid(result);
+    kernels::write(result, config.gates_addr, offset);
+
+    // The last of the block's tiles to arrive updates its 8 units.
+    const Index block = offset - info.col_idx % 32;
+    if (config.arrived_addr[block / 8].fetch_add(1, std::memory_order_acq_rel) + 1 != 32 / lanes) return;
+    const float *gates = config.gates_addr + block;
+    const Index unit = block / 4;
+    for (Index u = 0; u < 8; u += lanes) {
+      const vf i = *reinterpret_cast<const vf*>(gates + u);
+      const vf f = *reinterpret_cast<const vf*>(gates + 8 + u);
+      const vf g = *reinterpret_cast<const vf*>(gates + 16 + u);
+      const vf o = *reinterpret_cast<const vf*>(gates + 24 + u);
+      const vf cell = add_ps(mul_ps(f, loadu_ps<vf>(config.cell_addr + unit + u)), mul_ps(i, g));
+      storeu_ps(config.cell_output_addr + unit + u, cell);
+      storeu_ps(config.hidden_output_addr + unit + u, mul_ps(o, kernels::tanh(cell)));
+    }
+  }
+
+private:
+  vf unquant_mult;
+  UnquantizeAndLSTMCell config;
+};
+
+/*
+ * UnquantizeAndGRUCell
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeAndGRUCell> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const UnquantizeAndGRUCell& config) : config(config) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+  }
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    const Index lanes = sizeof(vf) / sizeof(float);
+    const Index offset = info.row_idx * info.cols + info.col_idx;
+    auto result = kernels::unquantize(input, unquant_mult);
+    result = kernels::add_bias(result, config.bias_addr, info.col_idx);
+    // Keep h_n as is: the reset gate scales it before x_n is added.
+    if ((info.col_idx / 8) % 3 != 2) {
+      result = kernels::sigmoid(kernels::add_bias(result, config.input_addr, offset));
+    }
+    kernels::write(result, config.gates_addr, offset);
+
+    const Index block = offset - info.col_idx % 24;
+    if (config.arrived_addr[block / 8].fetch_add(1, std::memory_order_acq_rel) + 1 != 24 / lanes) return;
+    const float *gates = config.gates_addr + block;
+    const Index unit = block / 3;
+    for (Index u = 0; u < 8; u += lanes) {
+      const vf r = *reinterpret_cast<const vf*>(gates + u);
+      const vf z = *reinterpret_cast<const vf*>(gates + 8 + u);
+      const vf h_n = *reinterpret_cast<const vf*>(gates + 16 + u);
+      const vf x_n = *reinterpret_cast<const vf*>(config.input_addr + block + 16 + u);
+      const vf n = kernels::tanh(add_ps(x_n, mul_ps(r, h_n)));
+      const vf hidden = loadu_ps<vf>(config.hidden_addr + unit + u);
+      storeu_ps(config.hidden_output_addr + unit + u, add_ps(n, mul_ps(z, sub_ps(hidden, n))));
+    }
+  }
+
+private:
+  vf unquant_mult;
+  UnquantizeAndGRUCell config;
+};
+
+/*
+ * UnquantizeAddBiasActivateAndQuantize
+ */
+template <class Type, Activation kActivation> class CallbackImpl<CPUType::CPU_NAME, UnquantizeAddBiasActivateAndQuantize<Type, kActivation>> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const UnquantizeAddBiasActivateAndQuantize<Type, kActivation>& config) : config(config) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+    quant_mult = set1_ps<vf>(config.quant_mult);
+  }
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    auto result = kernels::unquantize(input, unquant_mult);
+    result = kernels::add_bias(result, config.bias_addr, info.col_idx);
+    result = Activate(result, std::integral_constant<Activation, kActivation>());
+    OutputTile<CPUType::CPU_NAME>::WriteQuantized(kernels::quantize(result, quant_mult), config.output_addr, info);
+  }
+
+private:
+  INTGEMM_TARGET static vf Activate(vf input, std::integral_constant<Activation, Activation::None>) { return input; }
+  INTGEMM_TARGET static vf Activate(vf input, std::integral_constant<Activation, Activation::Relu>) { return kernels::relu<float>(input); }
+  INTGEMM_TARGET static vf Activate(vf input, std::integral_constant<Activation, Activation::Gelu>) { return kernels::gelu(input); }
+  INTGEMM_TARGET static vf Activate(vf input, std::integral_constant<Activation, Activation::Silu>) { return kernels::silu(input); }
+  INTGEMM_TARGET static vf Activate(vf input, std::integral_constant<Activation, Activation::Sigmoid>) { return kernels::sigmoid(input); }
+  INTGEMM_TARGET static vf Activate(vf input, std::integral_constant<Activation, Activation::Tanh>) { return kernels::tanh(input); }
+
+  vf unquant_mult;
+  vf quant_mult;
+  UnquantizeAddBiasActivateAndQuantize<Type, kActivation> config;
+};
+
+/*
+ * UnquantizeAndAddBiasAndSoftmax
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeAndAddBiasAndSoftmax> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const UnquantizeAndAddBiasAndSoftmax& config) : config(config) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+  }
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    auto logits = kernels::add_bias(kernels::unquantize(input, unquant_mult), config.bias_addr, info.col_idx);
+    float* stats = config.tile_stats + (info.row_idx * (info.cols / 8) + info.col_idx / 8) * 2;
+    const Index offset = info.row_idx * info.cols + info.col_idx;
+    float max = MaxFloat32(logits);
+#if defined(CALLBACKS_THIS_IS_SSE2) || defined(CALLBACKS_THIS_IS_NEON)
+    // Registers hold half a tile.  The first half is already written relative
+    // to its max, so rescale it if this half has a larger one.
+    if (info.col_idx % 8) {
+      if (max > stats[0]) {
+        const float rescale = std::exp(stats[0] - max);
+        for (Index i = 1; i <= 4; ++i) config.output_addr[offset - i] *= rescale;
+        stats[1] *= rescale;
+      } else {
+        max = stats[0];
+      }
+      auto exps = kernels::exp_approx_taylor(sub_ps(logits, set1_ps<vf>(max)));
+      kernels::write(exps, config.output_addr, offset);
+      stats[0] = max;
+      stats[1] += AddFloat32(exps);
+      return;
+    }
+#endif
+    auto exps = kernels::exp_approx_taylor(sub_ps(logits, set1_ps<vf>(max)));
+    kernels::write(exps, config.output_addr, offset);
+    stats[0] = max;
+    stats[1] = AddFloat32(exps);
+  }
+
+private:
+  vf unquant_mult;
+  UnquantizeAndAddBiasAndSoftmax config;
+};
+
+/*
+ * UnquantizeAndAddBiasAndLogSoftmax
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeAndAddBiasAndLogSoftmax> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const UnquantizeAndAddBiasAndLogSoftmax& config) : config(config) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+  }
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    auto logits = kernels::add_bias(kernels::unquantize(input, unquant_mult), config.bias_addr, info.col_idx);
+    kernels::write(logits, config.output_addr, info.row_idx * info.cols + info.col_idx);
+    float* stats = config.tile_stats + (info.row_idx * (info.cols / 8) + info.col_idx / 8) * 2;
+    float max = MaxFloat32(logits);
+#if defined(CALLBACKS_THIS_IS_SSE2) || defined(CALLBACKS_THIS_IS_NEON)
+    // Registers hold half a tile: fold this half into the first.
+    if (info.col_idx % 8) {
+      if (max > stats[0]) {
+        stats[1] *= std::exp(stats[0] - max);
+      } else {
+        max = stats[0];
+      }
+      stats[0] = max;
+      stats[1] += AddFloat32(kernels::exp_approx_taylor(sub_ps(logits, set1_ps<vf>(max))));
+      return;
+    }
+#endif
+    stats[0] = max;
+    stats[1] = AddFloat32(kernels::exp_approx_taylor(sub_ps(logits, set1_ps<vf>(max))));
+  }
+
+private:
+  vf unquant_mult;
+  UnquantizeAndAddBiasAndLogSoftmax config;
+};
+
+/*
+ * UnquantizeAndAddBiasAndTopK
+ */
+template <> class CallbackImpl<CPUType::CPU_NAME, UnquantizeAndAddBiasAndTopK> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const UnquantizeAndAddBiasAndTopK& config) : config(config), row_begin(0), row_end(0) {
+    unquant_mult = set1_ps<vf>(config.unquant_mult);
+  }
+
+  // Each call of the multiply on a range makes its own CallbackImpl, so this
+  // is the thread's part.  Copies made before running have no rows.
+  ~CallbackImpl() {
+    MergeTopK(config.scores_addr, config.indices_addr, scores.data(), indices.data(), config.k, row_begin, row_end);
+  }
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    auto logits = kernels::add_bias(kernels::unquantize(input, unquant_mult), config.bias_addr, info.col_idx);
+    if (scores.empty()) {
+      scores.assign(info.rows * config.k, -std::numeric_limits<float>::infinity());
+      indices.assign(info.rows * config.k, 0);
+      row_begin = info.row_idx;
+      row_end = info.row_idx + 1;
+    }
+    row_begin = std::min(row_begin, info.row_idx);
+    row_end = std::max(row_end, info.row_idx + 1);
+    float* row_scores = scores.data() + info.row_idx * config.k;
+    // Columns come in increasing order, so a tie never displaces a kept value.
+    if (!(MaxFloat32(logits) > row_scores[config.k - 1])) return;
+    Index* row_indices = indices.data() + info.row_idx * config.k;
+    alignas(sizeof(vf)) float values[sizeof(vf) / sizeof(float)];
+    kernels::write(logits, values, 0);
+    // Lanes past a ColumnTail's last column are padding.
+    const Index lanes = std::min<Index>(sizeof(vf) / sizeof(float), info.cols > info.col_idx ? info.cols - info.col_idx : 0);
+    for (Index i = 0; i < lanes; ++i) {
+      InsertTopK(row_scores, row_indices, config.k, values[i], info.col_idx + i);
+    }
+  }
+
+private:
+  vf unquant_mult;
+  UnquantizeAndAddBiasAndTopK config;
+  std::vector<float> scores;
+  std::vector<Index> indices;
+  Index row_begin, row_end;
+};
+
+/*
+ * ColumnTail
+ */
+template <class Callback>
+class CallbackImpl<CPUType::CPU_NAME, ColumnTail<Callback>> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const ColumnTail<Callback>& config) : cols(config.cols), callback(config.callback) {}
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    callback.Run(input, OutputBufferInfo(info.row_idx, info.col_idx, info.rows, cols, cols));
+  }
+
+private:
+  Index cols;
+  CallbackImpl<CPUType::CPU_NAME, Callback> callback;
+};
+
+/*
+ * StridedOutput
+ */
+template <class Callback>
+class CallbackImpl<CPUType::CPU_NAME, StridedOutput<Callback>> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const StridedOutput<Callback>& config) : ldc(config.ldc), callback(config.callback) {}
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    callback.Run(input, OutputBufferInfo(info.row_idx, info.col_idx, info.rows, info.cols, ldc));
+  }
+
+private:
+  Index ldc;
+  CallbackImpl<CPUType::CPU_NAME, Callback> callback;
+};
+
+/*
+ * ColumnOffsetOutput
+ */
+template <class Callback>
+class CallbackImpl<CPUType::CPU_NAME, ColumnOffsetOutput<Callback>> {
+public:
+  explicit INTGEMM_TARGET_CONSTRUCTOR CallbackImpl(const ColumnOffsetOutput<Callback>& config) : col_begin(config.col_begin), cols(config.cols), callback(config.callback) {}
+
+  INTGEMM_TARGET void Run(vi input, const OutputBufferInfo& info) {
+    callback.Run(input, OutputBufferInfo(info.row_idx, info.col_idx + col_begin, info.rows, cols, cols));
+  }
+
+private:
+  Index col_begin;
+  Index cols;
+  CallbackImpl<CPUType::CPU_NAME, Callback> callback;
+};
+
 }
 }
 
@@ -12,8 +12,13 @@ struct OutputBufferInfo {
   Index rows; // = A_rows
   Index cols; // = B_cols
 
+  Index ldc; // Distance between rows of C, = cols unless from StridedOutput
+
   OutputBufferInfo(Index row_idx, Index col_idx, Index rows, Index cols)
-    : row_idx(row_idx), col_idx(col_idx), rows(rows), cols(cols) {}
+    : row_idx(row_idx), col_idx(col_idx), rows(rows), cols(cols), ldc(cols) {}
+
+  OutputBufferInfo(Index row_idx, Index col_idx, Index rows, Index cols, Index ldc)
+    : row_idx(row_idx), col_idx(col_idx), rows(rows), cols(cols), ldc(ldc) {}
 };
 
 }
@@ -0,0 +1,54 @@
+#pragma once
+/* Scalar helpers for callbacks::UnquantizeAndLSTMCell and
+ * UnquantizeAndGRUCell.
+ *
+ * A cell's B holds every gate's weights side by side, interleaved so that
+ * each block of 8 units has its 8 columns of every gate in turn.  Then the
+ * gates of a unit land in columns one multiply task usually covers, and the
+ * cell update never has to wait for another pass over C.
+ */
+
+#include "../aligned.h"
+#include "../types.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace intgemm {
+namespace callbacks {
+
+// Column of B, and of the bias, holding gate of unit for a cell with gates
+// gates: 4 for LSTM in the order input, forget, cell, output and 3 for GRU in
+// the order reset, update, new.
+inline Index RecurrentGateColumn(Index gates, Index gate, Index unit) {
+  return (unit / 8) * 8 * gates + gate * 8 + unit % 8;
+}
+
+// Activated gates and, for each 8 columns of them, how many tiles have
+// arrived.  Threads may split a block's gates, so the tile that completes a
+// block updates its cell.  Reuse for every step of the same shape; the
+// configs reset it.
+class RecurrentScratch {
+  public:
+    // For A_rows rows and gates * hidden columns.
+    RecurrentScratch(Index rows, Index gate_cols)
+      : gates_(rows * gate_cols), arrived_(new std::atomic<uint32_t>[rows * gate_cols / 8]), tiles_(rows * gate_cols / 8) {
+      Reset();
+    }
+
+    float *Gates() { return gates_.begin(); }
+    std::atomic<uint32_t> *Arrived() { return arrived_.get(); }
+
+    void Reset() {
+      for (Index i = 0; i < tiles_; ++i) arrived_[i].store(0, std::memory_order_relaxed);
+    }
+
+  private:
+    AlignedVector<float> gates_;
+    std::unique_ptr<std::atomic<uint32_t>[]> arrived_;
+    Index tiles_;
+};
+
+} // namespace callbacks
+} // namespace intgemm
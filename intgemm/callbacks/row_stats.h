@@ -0,0 +1,28 @@
+#pragma once
+/* Scalar helpers for callbacks::UnquantizeAndAddBiasAndResidualAndWrite. */
+
+#include "../types.h"
+
+#include <mutex>
+
+namespace intgemm {
+namespace callbacks {
+
+// Serializes merges from threads that saw different columns of the same rows.
+inline std::mutex &RowStatsMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+// Add rows [row_begin, row_end) of a thread's sums and sums of squares, two
+// per row, into the output.
+inline void MergeRowStats(double *out, const double *stats, Index row_begin, Index row_end) {
+  if (row_begin >= row_end) return;
+  std::lock_guard<std::mutex> lock(RowStatsMutex());
+  for (Index i = row_begin * 2; i < row_end * 2; ++i) {
+    out[i] += stats[i];
+  }
+}
+
+} // namespace callbacks
+} // namespace intgemm
@@ -0,0 +1,53 @@
+#pragma once
+/* Scalar helpers for callbacks::UnquantizeAndAddBiasAndTopK.
+ *
+ * A row's top k is kept as k scores in descending order with their column
+ * indices.  Equal scores rank by lower column so the result doesn't depend
+ * on how the multiply was split between threads.
+ */
+
+#include "../types.h"
+
+#include <mutex>
+
+namespace intgemm {
+namespace callbacks {
+
+// Whether score at column index ranks above other at other_index.
+inline bool TopKBefore(float score, Index index, float other, Index other_index) {
+  return score > other || (score == other && index < other_index);
+}
+
+// Insert score at column index into a row's top k, dropping the last.
+// Returns false when it doesn't make the top k.
+inline bool InsertTopK(float *scores, Index *indices, Index k, float score, Index index) {
+  if (!TopKBefore(score, index, scores[k - 1], indices[k - 1])) return false;
+  Index i = k - 1;
+  for (; i && TopKBefore(score, index, scores[i - 1], indices[i - 1]); --i) {
+    scores[i] = scores[i - 1];
+    indices[i] = indices[i - 1];
+  }
+  scores[i] = score;
+  indices[i] = index;
+  return true;
+}
+
+// Serializes merges from threads that saw different columns of the same rows.
+inline std::mutex &TopKMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+// Merge rows [row_begin, row_end) of a thread's top k, k per row, into the output.
+inline void MergeTopK(float *out_scores, Index *out_indices, const float *scores, const Index *indices, Index k, Index row_begin, Index row_end) {
+  if (row_begin >= row_end) return;
+  std::lock_guard<std::mutex> lock(TopKMutex());
+  for (Index r = row_begin; r < row_end; ++r) {
+    for (Index j = r * k; j < (r + 1) * k; ++j) {
+      if (!InsertTopK(out_scores + r * k, out_indices + r * k, k, scores[j], indices[j])) break;
+    }
+  }
+}
+
+} // namespace callbacks
+} // namespace intgemm
@@ -0,0 +1,68 @@
+#pragma once
+/* Elementwise functions over arrays, dispatched to the running CPU like
+ * MaxAbsolute.  They use the same kernels as the callbacks, so Sigmoid here
+ * matches Activation::Sigmoid of UnquantizeAddBiasActivateAndQuantize, and
+ * are as approximate: Exp clamps to [-20, 20] and Sigmoid, Tanh, Silu and
+ * Gelu build on it.
+ *
+ * Arrays need no alignment and output may be input.  Arrays longer than
+ * kElementwiseGrain are split over OpenMP threads.
+ */
+
+#include "kernels.h"
+#include "types.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace intgemm {
+
+// Elements each thread gets at least.
+constexpr Index kElementwiseGrain = 16384;
+
+// output[i] = f(input[i]) for i in [0, size).
+extern void (*Exp)(const float *input, float *output, Index size);
+extern void (*Sigmoid)(const float *input, float *output, Index size);
+extern void (*Tanh)(const float *input, float *output, Index size);
+extern void (*Relu)(const float *input, float *output, Index size);
+// x * sigmoid(x)
+extern void (*Silu)(const float *input, float *output, Index size);
+// The tanh approximation of GELU.
+extern void (*Gelu)(const float *input, float *output, Index size);
+
+// Sign extend bytes to int16_t.
+extern void (*Upcast8to16)(const int8_t *input, int16_t *output, Index size);
+// Narrow int16_t to bytes, saturating to [-128, 127].
+extern void (*Downcast16to8)(const int16_t *input, int8_t *output, Index size);
+
+} // namespace intgemm
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+#define INTGEMM_THIS_IS_NEON
+#include "elementwise.inl"
+#undef INTGEMM_THIS_IS_NEON
+#else
+#define INTGEMM_THIS_IS_SSE2
+#include "elementwise.inl"
+#undef INTGEMM_THIS_IS_SSE2
+#endif
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
+#define INTGEMM_THIS_IS_AVX2
+#include "elementwise.inl"
+#undef INTGEMM_THIS_IS_AVX2
+#endif
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+#define INTGEMM_THIS_IS_AVX512DQ
+#include "elementwise.inl"
+#undef INTGEMM_THIS_IS_AVX512DQ
+#endif
@@ -0,0 +1,241 @@
+/* This file is included multiple times, once per architecture. */
+#if defined(INTGEMM_THIS_IS_AVX512DQ)
+#define INTGEMM_ARCH AVX512BW
+#define INTGEMM_TARGET INTGEMM_AVX512DQ
+#elif defined(INTGEMM_THIS_IS_AVX2)
+#define INTGEMM_ARCH AVX2
+#define INTGEMM_TARGET INTGEMM_AVX2
+#elif defined(INTGEMM_THIS_IS_SSE2)
+#define INTGEMM_ARCH SSE2
+#define INTGEMM_TARGET INTGEMM_SSE2
+#elif defined(INTGEMM_THIS_IS_NEON)
+#define INTGEMM_ARCH NEON
+#define INTGEMM_TARGET INTGEMM_NEON
+#else
+#error Included with unexpected architecture
+#endif
+
+namespace intgemm {
+namespace INTGEMM_ARCH {
+
+/* Apply Kernel to size floats a register at a time, in threads for long
+ * arrays.  The last partial register goes through a copy so it rounds like
+ * the rest.  Do not call this function directly; it's a subroutine of
+ * Sigmoid and friends.
+ */
+template <FRegister (*Kernel)(FRegister)> INTGEMM_TARGET static inline void MapFloat(const float *input, float *output, Index size) {
+  const std::ptrdiff_t lanes = sizeof(FRegister) / sizeof(float);
+  const std::ptrdiff_t registers = size / lanes;
+#pragma omp parallel for num_threads(std::max<int>(1, std::min<int>(omp_get_max_threads(), size / kElementwiseGrain)))
+  for (std::ptrdiff_t r = 0; r < registers; ++r) {
+    storeu_ps(output + r * lanes, Kernel(loadu_ps<FRegister>(input + r * lanes)));
+  }
+  const Index done = static_cast<Index>(registers * lanes);
+  if (done != size) {
+    float tail[sizeof(FRegister) / sizeof(float)] = {0};
+    std::copy(input + done, input + size, tail);
+    storeu_ps(tail, Kernel(loadu_ps<FRegister>(tail)));
+    std::copy(tail, tail + (size - done), output + done);
+  }
+}
+
+INTGEMM_TARGET static inline void Exp(const float *input, float *output, Index size) {
+  MapFloat<kernels::exp_approx_taylor>(input, output, size);
+}
+
+INTGEMM_TARGET static inline void Sigmoid(const float *input, float *output, Index size) {
+  MapFloat<kernels::sigmoid>(input, output, size);
+}
+
+INTGEMM_TARGET static inline void Tanh(const float *input, float *output, Index size) {
+  MapFloat<kernels::tanh>(input, output, size);
+}
+
+INTGEMM_TARGET static inline void Relu(const float *input, float *output, Index size) {
+  MapFloat<kernels::relu<float> >(input, output, size);
+}
+
+INTGEMM_TARGET static inline void Silu(const float *input, float *output, Index size) {
+  MapFloat<kernels::silu>(input, output, size);
+}
+
+INTGEMM_TARGET static inline void Gelu(const float *input, float *output, Index size) {
+  MapFloat<kernels::gelu>(input, output, size);
+}
+
+/* Sign extend size bytes to 16 bits. */
+INTGEMM_TARGET static inline void Upcast8to16(const int8_t *input, int16_t *output, Index size) {
+  const std::ptrdiff_t lanes = sizeof(Register);
+  const std::ptrdiff_t registers = size / lanes;
+#pragma omp parallel for num_threads(std::max<int>(1, std::min<int>(omp_get_max_threads(), size / kElementwiseGrain)))
+  for (std::ptrdiff_t r = 0; r < registers; ++r) {
+#if defined(INTGEMM_THIS_IS_NEON)
+    int8x16_t bytes = vld1q_s8(input + r * lanes);
+    vst1q_s16(output + r * lanes, vmovl_s8(vget_low_s8(bytes)));
+    vst1q_s16(output + r * lanes + 8, vmovl_s8(vget_high_s8(bytes)));
+#else
+    Register bytes;
+    std::memcpy(&bytes, input + r * lanes, sizeof(Register));
+    auto words = kernels::upcast8to16(bytes);
+    std::memcpy(output + r * lanes, &words.first, sizeof(Register));
+    std::memcpy(output + r * lanes + lanes / 2, &words.second, sizeof(Register));
+#endif
+  }
+  for (Index i = static_cast<Index>(registers * lanes); i < size; ++i) {
+    output[i] = input[i];
+  }
+}
+
+/* Narrow size 16-bit values to bytes, saturating to [-128, 127]. */
+INTGEMM_TARGET static inline void Downcast16to8(const int16_t *input, int8_t *output, Index size) {
+  const std::ptrdiff_t lanes = sizeof(Register);
+  const std::ptrdiff_t registers = size / lanes;
+#pragma omp parallel for num_threads(std::max<int>(1, std::min<int>(omp_get_max_threads(), size / kElementwiseGrain)))
+  for (std::ptrdiff_t r = 0; r < registers; ++r) {
+#if defined(INTGEMM_THIS_IS_NEON)
+    vst1q_s8(output + r * lanes, vcombine_s8(vqmovn_s16(vld1q_s16(input + r * lanes)), vqmovn_s16(vld1q_s16(input + r * lanes + 8))));
+#else
+    Register low, high;
+    std::memcpy(&low, input + r * lanes, sizeof(Register));
+    std::memcpy(&high, input + r * lanes + lanes / 2, sizeof(Register));
+    Register bytes = kernels::downcast16to8(low, high);
+    std::memcpy(output + r * lanes, &bytes, sizeof(Register));
+#endif
+  }
+  for (Index i = static_cast<Index>(registers * lanes); i < size; ++i) {
+    output[i] = static_cast<int8_t>(std::min<int16_t>(127, std::max<int16_t>(-128, input[i])));
+  }
+}
+
+/* Sign extend a register of bytes at input to four registers of int32. */
+INTGEMM_TARGET static inline void UpcastBytes(const int8_t *input, Register *output) {
+#if defined(INTGEMM_THIS_IS_NEON)
+  int8x16_t bytes = vld1q_s8(input);
+  int16x8_t low = vmovl_s8(vget_low_s8(bytes)), high = vmovl_s8(vget_high_s8(bytes));
+  output[0] = vmovl_s16(vget_low_s16(low));
+  output[1] = vmovl_s16(vget_high_s16(low));
+  output[2] = vmovl_s16(vget_low_s16(high));
+  output[3] = vmovl_s16(vget_high_s16(high));
+#else
+  Register bytes;
+  std::memcpy(&bytes, input, sizeof(Register));
+  auto ints = kernels::upcast8to32(bytes);
+  output[0] = ints.first;
+  output[1] = ints.second;
+  output[2] = ints.third;
+  output[3] = ints.fourth;
+#endif
+}
+
+/* size bytes times scale, as floats or rounded and saturated to [-127, 127]
+ * like PrepareA.  Do not call these functions directly; they're subroutines
+ * of Int8::GatherRowsUnquantize and friends.
+ */
+INTGEMM_TARGET static inline void ConvertBytes(const int8_t *input, float *output, Index size, float scale) {
+  const Index lanes = sizeof(FRegister) / sizeof(float);
+  const FRegister mult = set1_ps<FRegister>(scale);
+  Index i = 0;
+  for (; i + sizeof(Register) <= size; i += sizeof(Register)) {
+    Register ints[4];
+    UpcastBytes(input + i, ints);
+    for (Index j = 0; j < 4; ++j) {
+      storeu_ps(output + i + j * lanes, mul_ps(cvtepi32_ps(ints[j]), mult));
+    }
+  }
+  for (; i < size; ++i) {
+    output[i] = input[i] * scale;
+  }
+}
+
+INTGEMM_TARGET static inline void ConvertBytes(const int8_t *input, int8_t *output, Index size, float scale) {
+  const Index lanes = sizeof(FRegister) / sizeof(float);
+  const FRegister mult = set1_ps<FRegister>(scale);
+  Index i = 0;
+  for (; i + sizeof(Register) <= size; i += sizeof(Register)) {
+    Register ints[4];
+    UpcastBytes(input + i, ints);
+    for (Index j = 0; j < 4; ++j) {
+      kernels::write_quantized(kernels::quantize(cvtepi32_ps(ints[j]), mult), output, i + j * lanes);
+    }
+  }
+  for (; i < size; ++i) {
+    output[i] = static_cast<int8_t>(std::max(-127.0f, std::min(127.0f, std::nearbyint(input[i] * scale))));
+  }
+}
+
+/* Convert rows *ids of table, width bytes each, to output, scaling row id by
+ * scales[id * scale_stride] * mult.  With group, table is B prepared for a
+ * CPU with that group (see prepared_b.h) and its columns are the rows.
+ */
+template <class Output> INTGEMM_TARGET static inline void GatherRows(const int8_t *table, Index width, Index group, const Index *ids_begin, const Index *ids_end, const float *scales, Index scale_stride, float mult, Output *output) {
+  const std::ptrdiff_t count = ids_end - ids_begin;
+#pragma omp parallel num_threads(std::max<int>(1, std::min<int>(omp_get_max_threads(), count * width / kElementwiseGrain)))
+  {
+    std::vector<int8_t> column(group ? width : 0);
+#pragma omp for
+    for (std::ptrdiff_t r = 0; r < count; ++r) {
+      const Index id = ids_begin[r];
+      const int8_t *row = table + static_cast<std::size_t>(id) * width;
+      if (group) {
+        // Strips of 8 columns, each column taking group values of a row in turn.
+        const int8_t *strip = table + static_cast<std::size_t>(id / 8) * 8 * width + (id % 8) * group;
+        for (Index k = 0; k < width; k += group) {
+          std::memcpy(column.data() + k, strip + static_cast<std::size_t>(k) * 8, group);
+        }
+        row = column.data();
+      }
+      ConvertBytes(row, output + static_cast<std::size_t>(r) * width, width, scales[static_cast<std::size_t>(id) * scale_stride] * mult);
+    }
+  }
+}
+
+/* Rows [row_begin, row_end) of FinishSoftmax or, with log_softmax,
+ * FinishLogSoftmax on C, which has cols columns.  Each row merges its tile
+ * stats into the max and the sum of exp(logit - max), then scales each
+ * 8-column tile by its share of the sum or subtracts the log sum exp.  Do not
+ * call this function directly; it's a subroutine of FinishSoftmax.
+ */
+INTGEMM_TARGET static inline void FinishSoftmaxRows(float *C, const float *tile_stats, Index cols, Index row_begin, Index row_end, bool log_softmax) {
+  const Index lanes = sizeof(FRegister) / sizeof(float);
+  const Index tiles = cols / 8;
+  for (Index r = row_begin; r < row_end; ++r) {
+    const float *stats = tile_stats + static_cast<std::size_t>(r) * tiles * 2;
+    float *row = C + static_cast<std::size_t>(r) * cols;
+    float max = stats[0];
+    for (Index t = 1; t < tiles; ++t) max = std::max(max, stats[2 * t]);
+    float sum = 0.0f;
+    for (Index t = 0; t < tiles; ++t) sum += stats[2 * t + 1] * std::exp(stats[2 * t] - max);
+    if (log_softmax) {
+      const float log_sum = max + std::log(sum);
+      const FRegister shift = set1_ps<FRegister>(log_sum);
+      Index c = 0;
+      for (; c + lanes <= cols; c += lanes) storeu_ps(row + c, sub_ps(loadu_ps<FRegister>(row + c), shift));
+      for (; c < cols; ++c) row[c] -= log_sum;
+      continue;
+    }
+    Index t = 0;
+#if defined(INTGEMM_THIS_IS_AVX512DQ)
+    // A register holds two tiles.
+    for (; t + 2 <= tiles; t += 2) {
+      const FRegister mult = _mm512_insertf32x8(set1_ps<FRegister>(std::exp(stats[2 * t] - max) / sum), _mm256_set1_ps(std::exp(stats[2 * t + 2] - max) / sum), 1);
+      storeu_ps(row + t * 8, mul_ps(loadu_ps<FRegister>(row + t * 8), mult));
+    }
+#endif
+    for (; t < tiles; ++t) {
+      const float scale = std::exp(stats[2 * t] - max) / sum;
+      float *tile = row + t * 8;
+      if (lanes <= 8) {
+        const FRegister mult = set1_ps<FRegister>(scale);
+        for (Index c = 0; c < 8; c += lanes) storeu_ps(tile + c, mul_ps(loadu_ps<FRegister>(tile + c), mult));
+      } else {
+        for (Index c = 0; c < 8; ++c) tile[c] *= scale;
+      }
+    }
+  }
+}
+
+} // namespace INTGEMM_ARCH
+} // namespace intgemm
+
+#undef INTGEMM_ARCH
+#undef INTGEMM_TARGET
@@ -0,0 +1,243 @@
+#include "executor.h"
+#include "partition.h"
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace intgemm {
+
+namespace {
+
+// How many times a waiting thread polls before sleeping.  Polling is a plain
+// load so this is a few microseconds, enough to cover back-to-back calls
+// without burning a timeslice on an oversubscribed machine.
+const int kSpinCount = 1 << 12;
+
+void PinThread(std::thread &thread, int cpu) {
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  // Pinning is a hint; an invalid CPU leaves the thread where it was.
+  pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+  (void)thread;
+  (void)cpu;
+#endif
+}
+
+} // namespace
+
+Executor::~Executor() {}
+
+ThreadPool::ThreadPool(std::size_t threads, const std::vector<int> &cpus)
+  : generation_(0), pending_(0), stop_(false), task_(nullptr), count_(0), dynamic_(false), chunk_(1), next_(0) {
+  // hardware_concurrency can return 0.
+  if (threads == 0) threads = 1;
+  workers_.reserve(threads - 1);
+  for (std::size_t i = 0; i + 1 < threads; ++i) {
+    workers_.emplace_back(&ThreadPool::Work, this, i + 1);
+    if (!cpus.empty()) {
+      PinThread(workers_.back(), cpus[i % cpus.size()]);
+    }
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread &worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::ParallelFor(Index count, const Task &task) {
+  if (workers_.empty() || count <= 1) {
+    if (count) task(0, count);
+    return;
+  }
+  task_ = &task;
+  count_ = count;
+  dynamic_ = GetSchedule() == Schedule::Dynamic;
+  chunk_ = std::max<Index>(1, static_cast<Index>(count / (Threads() * kDynamicTasksPerThread)));
+  next_.store(0, std::memory_order_relaxed);
+  pending_.store(workers_.size(), std::memory_order_relaxed);
+  {
+    // Increment under the lock so a worker going to sleep can't miss it.
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation_.fetch_add(1, std::memory_order_release);
+  }
+  wake_.notify_all();
+  RunShare(0);
+  for (int spin = 0; spin < kSpinCount; ++spin) {
+    if (!pending_.load(std::memory_order_acquire)) return;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return !pending_.load(std::memory_order_acquire); });
+}
+
+void ThreadPool::RunShare(std::size_t thread) {
+  if (dynamic_) {
+    Index begin;
+    while ((begin = next_.fetch_add(chunk_, std::memory_order_relaxed)) < count_) {
+      (*task_)(begin, std::min(begin + chunk_, count_));
+    }
+    return;
+  }
+  // Contiguous shares keep neighbouring strips of B on the same thread.
+  const std::size_t threads = Threads();
+  Index begin = static_cast<Index>(count_ * thread / threads);
+  Index end = static_cast<Index>(count_ * (thread + 1) / threads);
+  if (begin != end) (*task_)(begin, end);
+}
+
+void ThreadPool::Work(std::size_t thread) {
+  uint64_t seen = 0;
+  while (true) {
+    uint64_t generation = generation_.load(std::memory_order_acquire);
+    for (int spin = 0; spin < kSpinCount && generation == seen; ++spin) {
+      generation = generation_.load(std::memory_order_acquire);
+    }
+    if (generation == seen) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [&] {
+        generation = generation_.load(std::memory_order_acquire);
+        return generation != seen || stop_;
+      });
+      if (stop_) return;
+    }
+    seen = generation;
+    RunShare(thread);
+    if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_.notify_one();
+    }
+  }
+}
+
+struct AsyncPool::Job {
+  Index count;
+  Task task;
+  Done done;
+  // Guarded by the pool's mutex_.
+  Index next;
+  Index remaining;
+  bool finished;
+};
+
+AsyncPool::AsyncPool(std::size_t threads, const std::vector<int> &cpus) : stop_(false) {
+  if (threads == 0) threads = 1;
+  workers_.reserve(threads);
+  for (std::size_t i = 0; i < threads; ++i) {
+    workers_.emplace_back(&AsyncPool::Work, this);
+    if (!cpus.empty()) {
+      PinThread(workers_.back(), cpus[i % cpus.size()]);
+    }
+  }
+}
+
+AsyncPool::~AsyncPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_.notify_all();
+  for (std::thread &worker : workers_) {
+    worker.join();
+  }
+}
+
+AsyncPool::Handle AsyncPool::Submit(Index count, Task task, Done done) {
+  std::shared_ptr<Job> job(new Job{count, std::move(task), std::move(done), 0, count, false});
+  if (!count) {
+    if (job->done) job->done();
+    job->finished = true;
+    return Handle(job, this);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(job);
+  }
+  if (count == 1) {
+    work_.notify_one();
+  } else {
+    work_.notify_all();
+  }
+  return Handle(job, this);
+}
+
+AsyncPool::Handle AsyncPool::Submit(std::function<void()> work, Done done) {
+  return Submit(1, [work](Index, Index) { work(); }, std::move(done));
+}
+
+void AsyncPool::ParallelFor(Index count, const Task &task) {
+  Submit(count, [&task](Index begin, Index end) { task(begin, end); }).Wait();
+}
+
+bool AsyncPool::Claim(std::shared_ptr<Job> &job, Index &index) {
+  // Jobs whose tasks were all claimed by their waiters linger at the front.
+  while (!queue_.empty() && queue_.front()->next == queue_.front()->count) {
+    queue_.pop_front();
+  }
+  if (queue_.empty()) return false;
+  job = queue_.front();
+  index = job->next++;
+  if (job->next == job->count) queue_.pop_front();
+  return true;
+}
+
+void AsyncPool::Run(std::unique_lock<std::mutex> &lock, const std::shared_ptr<Job> &job, Index index) {
+  lock.unlock();
+  job->task(index, index + 1);
+  lock.lock();
+  if (--job->remaining) return;
+  if (job->done) {
+    lock.unlock();
+    job->done();
+    lock.lock();
+  }
+  job->finished = true;
+  finished_.notify_all();
+}
+
+void AsyncPool::Work() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    std::shared_ptr<Job> job;
+    Index index;
+    if (Claim(job, index)) {
+      Run(lock, job, index);
+    } else if (stop_) {
+      return;
+    } else {
+      work_.wait(lock);
+    }
+  }
+}
+
+bool AsyncPool::Handle::Ready() const {
+  if (!pool_) return true;
+  std::lock_guard<std::mutex> lock(pool_->mutex_);
+  return job_->finished;
+}
+
+void AsyncPool::Handle::Wait() const {
+  if (!pool_) return;
+  std::unique_lock<std::mutex> lock(pool_->mutex_);
+  while (!job_->finished) {
+    if (job_->next < job_->count) {
+      pool_->Run(lock, job_, job_->next++);
+    } else {
+      pool_->finished_.wait(lock);
+    }
+  }
+}
+
+} // namespace intgemm
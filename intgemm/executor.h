@@ -0,0 +1,181 @@
+#pragma once
+/* Run the multiply on threads supplied by the caller instead of OpenMP.
+ *
+ * The OpenMP path forks a team for every call, which is expensive for the
+ * small matrices seen in decoding and oversubscribes cores in applications
+ * that already have their own workers.  An Executor receives the same
+ * decomposition into 8-column strips of B and runs ranges of strips wherever
+ * it likes.
+ */
+
+#include "types.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace intgemm {
+
+class Executor {
+  public:
+    typedef std::function<void(Index begin, Index end)> Task;
+
+    virtual ~Executor();
+
+    // Call task on disjoint ranges [begin, end) that together cover
+    // [0, count), possibly concurrently.  Return once every call has
+    // finished.  task must not throw.
+    virtual void ParallelFor(Index count, const Task &task) = 0;
+
+    // Number of threads ParallelFor can run at once, used to decide how the
+    // multiply is split (see ChoosePartition).
+    virtual std::size_t Threads() const = 0;
+};
+
+// Adapts an application's own parallel_for over threads threads.
+class FunctionExecutor : public Executor {
+  public:
+    typedef std::function<void(Index count, const Task &task)> Function;
+
+    FunctionExecutor(Function parallel_for, std::size_t threads) : parallel_for_(std::move(parallel_for)), threads_(threads) {}
+
+    void ParallelFor(Index count, const Task &task) override {
+      parallel_for_(count, task);
+    }
+
+    std::size_t Threads() const override { return threads_; }
+
+  private:
+    Function parallel_for_;
+    std::size_t threads_;
+};
+
+/* Persistent pool of threads.  The calling thread does one share of the work
+ * and threads - 1 workers do the rest.  Idle workers spin for a short while
+ * so back-to-back multiplies do not pay to wake them, then sleep.
+ *
+ * Shares are contiguous and fixed, unless GetSchedule() is Schedule::Dynamic
+ * (see partition.h): then threads take chunks of the range as they come free
+ * so that, on a hybrid CPU, P-cores don't wait for E-cores.
+ *
+ * If cpus is not empty, worker i is pinned to cpus[i % cpus.size()] where
+ * the platform supports it (Linux).  The calling thread is never pinned.
+ *
+ * ParallelFor may be called by one thread at a time.
+ */
+class ThreadPool : public Executor {
+  public:
+    explicit ThreadPool(std::size_t threads = std::thread::hardware_concurrency(), const std::vector<int> &cpus = std::vector<int>());
+
+    ~ThreadPool() override;
+
+    void ParallelFor(Index count, const Task &task) override;
+
+    // Number of threads including the caller.
+    std::size_t Threads() const override { return workers_.size() + 1; }
+
+  private:
+    void Work(std::size_t thread);
+
+    void RunShare(std::size_t thread);
+
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_, done_;
+
+    // Incremented to hand out a new task.
+    std::atomic<uint64_t> generation_;
+    // Workers that have yet to finish the current task.
+    std::atomic<std::size_t> pending_;
+    bool stop_;
+
+    const Task *task_;
+    Index count_;
+    // With Schedule::Dynamic, the start of the next chunk to hand out.
+    bool dynamic_;
+    Index chunk_;
+    std::atomic<Index> next_;
+};
+
+/* Pool of threads taking work from a queue, so callers can submit a
+ * multiply and carry on, e.g. preparing the next request's A, while it runs.
+ * Work from different submissions interleaves: threads take tasks from the
+ * oldest submission with any left, then the next.
+ *
+ * As an Executor, ParallelFor may be called from any number of threads at
+ * once, including from work running on the pool; the caller runs tasks of
+ * its own call while it waits.  Tasks must not throw.
+ *
+ * Pointers given to asynchronous work must stay valid until it completes.
+ * The destructor finishes everything submitted.
+ */
+class AsyncPool : public Executor {
+  private:
+    struct Job;
+
+  public:
+    typedef std::function<void()> Done;
+
+    // Completion of something submitted.  Copies refer to the same work.
+    class Handle {
+      public:
+        // Refers to nothing and is ready.
+        Handle() : pool_(nullptr) {}
+
+        // Whether the work and its done callback have finished.
+        bool Ready() const;
+
+        // Block until Ready, running the work's remaining tasks meanwhile.
+        void Wait() const;
+
+      private:
+        friend class AsyncPool;
+        Handle(const std::shared_ptr<Job> &job, AsyncPool *pool) : job_(job), pool_(pool) {}
+
+        std::shared_ptr<Job> job_;
+        AsyncPool *pool_;
+    };
+
+    // threads workers, pinned to cpus as ThreadPool does.
+    explicit AsyncPool(std::size_t threads = std::thread::hardware_concurrency(), const std::vector<int> &cpus = std::vector<int>());
+
+    ~AsyncPool() override;
+
+    // Call task on disjoint ranges covering [0, count) on the pool, then done
+    // on whichever thread finished the last range, and return at once.
+    Handle Submit(Index count, Task task, Done done = Done());
+
+    // Run work on a thread of the pool, then done.
+    Handle Submit(std::function<void()> work, Done done = Done());
+
+    void ParallelFor(Index count, const Task &task) override;
+
+    std::size_t Threads() const override { return workers_.size(); }
+
+  private:
+    void Work();
+
+    // Take the next task of the oldest job with any left.  Call with mutex_.
+    bool Claim(std::shared_ptr<Job> &job, Index &index);
+
+    // Run a claimed task, unlocking for it, and finish the job if it was the
+    // last.
+    void Run(std::unique_lock<std::mutex> &lock, const std::shared_ptr<Job> &job, Index index);
+
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable work_, finished_;
+    std::deque<std::shared_ptr<Job> > queue_;
+    bool stop_;
+};
+
+} // namespace intgemm
@@ -0,0 +1,79 @@
+#pragma once
+/* A run-time shape lookup in front of Int8::MultiplyFixed.
+ *
+ * Int8::MultiplyFixed takes the shape as template arguments.  A model's shapes
+ * are usually known when it is built but arrive at run time, so list them once:
+ *
+ *   typedef FixedShapes<callbacks::UnquantizeAndAddBiasAndWrite,
+ *     FixedShape<512, 512>, FixedShape<512, 2048>, FixedShape<2048, 512> > ModelShapes;
+ *   ModelShapes::Multiply(A, B, A_rows, width, B_cols, callback);
+ *
+ * On first use the MultiplyFixed kernel this CPU dispatches to is kept for each
+ * listed shape, one table per callback type, and Multiply searches it.
+ * Multiplies under kThreadedWork multiply-adds run on the calling thread;
+ * larger ones and other shapes go to Int8::Multiply, which splits them over
+ * OpenMP threads.
+ */
+
+#include "intgemm.h"
+#include "types.h"
+
+#include <cstddef>
+
+namespace intgemm {
+
+// A width x B_cols shape for FixedShapes; see Int8::MultiplyFixed for the
+// constraints.
+template <Index kWidth, Index kBCols> struct FixedShape {
+  static constexpr Index width = kWidth;
+  static constexpr Index B_cols = kBCols;
+};
+
+template <class Callback, class... Shapes> class FixedShapes {
+  public:
+    static_assert(sizeof...(Shapes) > 0, "FixedShapes needs at least one FixedShape");
+
+    typedef void (*Function)(const int8_t *A, const int8_t *B, Index A_rows, Callback callback);
+
+    // The kernel for width x B_cols on this CPU, or nullptr if not listed.
+    static Function Find(Index width, Index B_cols) {
+      const Entry *table = Table();
+      for (std::size_t i = 0; i < sizeof...(Shapes); ++i) {
+        if (table[i].width == width && table[i].B_cols == B_cols) return table[i].function;
+      }
+      return nullptr;
+    }
+
+    // From this many multiply-adds a parallel region costs less than it saves,
+    // so Multiply leaves listed shapes to Int8::Multiply too.
+    static constexpr std::size_t kThreadedWork = static_cast<std::size_t>(1) << 22;
+
+    // The listed kernel on the calling thread for multiplies under
+    // kThreadedWork, otherwise Int8::Multiply.
+    static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+      Function function = Find(width, B_cols);
+      if (function && static_cast<std::size_t>(A_rows) * width * B_cols < kThreadedWork) {
+        function(A, B, A_rows, callback);
+      } else {
+        Int8::Multiply(A, B, A_rows, width, B_cols, callback);
+      }
+    }
+
+  private:
+    struct Entry {
+      Index width, B_cols;
+      Function function;
+    };
+
+    // Built on first use from the kernels MultiplyFixedFunction resolves.
+    static const Entry *Table() {
+      static const Entry table[] = {{Shapes::width, Shapes::B_cols, Int8::MultiplyFixedFunction<Shapes::width, Shapes::B_cols, Callback>()}...};
+      return table;
+    }
+};
+
+template <Index kWidth, Index kBCols> constexpr Index FixedShape<kWidth, kBCols>::width;
+template <Index kWidth, Index kBCols> constexpr Index FixedShape<kWidth, kBCols>::B_cols;
+template <class Callback, class... Shapes> constexpr std::size_t FixedShapes<Callback, Shapes...>::kThreadedWork;
+
+} // namespace intgemm
@@ -0,0 +1,112 @@
+#pragma once
+/* Conversions between float and the 16-bit floats BFloat16 and Half of
+ * types.h.  Conversion to 16 bits rounds to nearest even and keeps
+ * denormals; NaN stays NaN.  The kernels convert a register at a time the
+ * same way, so results don't depend on the CPU.
+ *
+ * Int8::QuantizeFloat16 and friends take 16-bit input, and the callbacks
+ * UnquantizeAndWriteFloat16 and UnquantizeAndAddBiasAndWriteFloat16 write
+ * 16-bit output, so activations can stay 16-bit around a multiply.
+ */
+
+#include "kernels.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace intgemm {
+
+inline float ToFloat(BFloat16 value) {
+  const uint32_t bits = static_cast<uint32_t>(value.bits) << 16;
+  float ret;
+  std::memcpy(&ret, &bits, sizeof(float));
+  return ret;
+}
+
+inline float ToFloat(Half value) {
+  const uint32_t shifted_exponent = 0x7c00 << 13;
+  uint32_t bits = static_cast<uint32_t>(value.bits & 0x7fff) << 13;
+  const uint32_t exponent = bits & shifted_exponent;
+  bits += (127 - 15) << 23;
+  float ret;
+  if (exponent == shifted_exponent) {
+    // Infinity and NaN.
+    bits += (128 - 16) << 23;
+    std::memcpy(&ret, &bits, sizeof(float));
+  } else if (exponent == 0) {
+    // Zero and denormals: renormalize by subtracting 2^-14.
+    bits += 1 << 23;
+    std::memcpy(&ret, &bits, sizeof(float));
+    ret -= 6.103515625e-05f;
+  } else {
+    std::memcpy(&ret, &bits, sizeof(float));
+  }
+  return (value.bits & 0x8000) ? -ret : ret;
+}
+
+inline BFloat16 ToBFloat16(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(float));
+  if ((bits & 0x7fffffff) > 0x7f800000) {
+    return BFloat16{static_cast<uint16_t>((bits >> 16) | 0x40)};
+  }
+  return BFloat16{static_cast<uint16_t>((bits + 0x7fff + ((bits >> 16) & 1)) >> 16)};
+}
+
+inline Half ToHalf(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(float));
+  const uint32_t sign = bits & 0x80000000u;
+  bits ^= sign;
+  uint32_t ret;
+  if (bits >= (143u << 23)) {
+    // Too large for a half, infinity or NaN.
+    ret = bits > 0x7f800000 ? 0x7e00 : 0x7c00;
+  } else if (bits < (113u << 23)) {
+    // Denormal halves: adding 0.5 makes the float unit round in the right place.
+    float magnitude;
+    std::memcpy(&magnitude, &bits, sizeof(float));
+    magnitude += 0.5f;
+    std::memcpy(&ret, &magnitude, sizeof(float));
+    ret -= 126u << 23;
+  } else {
+    // Rebias the exponent and round the mantissa to 10 bits.
+    ret = (bits + (static_cast<uint32_t>(15 - 127) << 23) + 0xfff + ((bits >> 13) & 1)) >> 13;
+  }
+  return Half{static_cast<uint16_t>(ret | (sign >> 16))};
+}
+
+// MaxAbsolute of 16-bit floats.  Without the sign their bits order like
+// their values, so this is a max over integers.
+template <class Float16> inline float MaxAbsoluteFloat16(const Float16 *begin, const Float16 *end) {
+  uint16_t highest = 0;
+  for (const Float16 *i = begin; i != end; ++i) {
+    highest = std::max<uint16_t>(highest, i->bits & 0x7fff);
+  }
+  return ToFloat(Float16{highest});
+}
+
+} // namespace intgemm
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+#define INTGEMM_THIS_IS_NEON
+#include "float16.inl"
+#undef INTGEMM_THIS_IS_NEON
+#else
+#define INTGEMM_THIS_IS_SSE2
+#include "float16.inl"
+#undef INTGEMM_THIS_IS_SSE2
+#endif
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
+#define INTGEMM_THIS_IS_AVX2
+#include "float16.inl"
+#undef INTGEMM_THIS_IS_AVX2
+#endif
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+#define INTGEMM_THIS_IS_AVX512DQ
+#include "float16.inl"
+#undef INTGEMM_THIS_IS_AVX512DQ
+#endif
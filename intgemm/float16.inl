@@ -0,0 +1,40 @@
+/* This file is included multiple times, once per architecture. */
+#if defined(INTGEMM_THIS_IS_AVX512DQ)
+#define INTGEMM_ARCH AVX512BW
+#define INTGEMM_TARGET INTGEMM_AVX512DQ
+#elif defined(INTGEMM_THIS_IS_AVX2)
+#define INTGEMM_ARCH AVX2
+#define INTGEMM_TARGET INTGEMM_AVX2
+#elif defined(INTGEMM_THIS_IS_SSE2)
+#define INTGEMM_ARCH SSE2
+#define INTGEMM_TARGET INTGEMM_SSE2
+#elif defined(INTGEMM_THIS_IS_NEON)
+#define INTGEMM_ARCH NEON
+#define INTGEMM_TARGET INTGEMM_NEON
+#else
+#error Included with unexpected architecture
+#endif
+
+namespace intgemm {
+namespace INTGEMM_ARCH {
+
+/* Convert size 16-bit floats to float.  output must be aligned to register
+ * size.  Do not call this function directly; it's a subroutine of
+ * Int8::QuantizeFloat16 and friends.
+ */
+template <class Float16> INTGEMM_TARGET static inline void ConvertToFloat(const Float16 *input, float *output, Index size) {
+  const Index lanes = sizeof(FRegister) / sizeof(float);
+  Index i = 0;
+  for (; i + lanes <= size; i += lanes) {
+    kernels::write(kernels::load_float16<FRegister>(input, i), output, i);
+  }
+  for (; i < size; ++i) {
+    output[i] = intgemm::ToFloat(input[i]);
+  }
+}
+
+} // namespace INTGEMM_ARCH
+} // namespace intgemm
+
+#undef INTGEMM_ARCH
+#undef INTGEMM_TARGET
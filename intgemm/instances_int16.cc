@@ -0,0 +1,9 @@
+// See INTGEMM_INT16_INSTANCES in intgemm.h.
+#include "intgemm.h"
+
+namespace intgemm {
+
+INTGEMM_INT16_INSTANCES(, callbacks::UnquantizeAndWrite)
+INTGEMM_INT16_INSTANCES(, callbacks::UnquantizeAndAddBiasAndWrite)
+
+} // namespace intgemm
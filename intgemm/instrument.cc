@@ -0,0 +1,241 @@
+#include "instrument.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace intgemm {
+namespace {
+
+bool EnvironmentPerfCounters() {
+#if defined(_MSC_VER)
+  char env[8];
+  size_t len = 0;
+  if (getenv_s(&len, env, sizeof(env), "INTGEMM_PERF_COUNTERS") || !len) return false;
+#else
+  const char *env = getenv("INTGEMM_PERF_COUNTERS");
+  if (!env) return false;
+#endif
+  return !strcmp(env, "1");
+}
+
+std::atomic<bool> &PerfCounters() {
+  static std::atomic<bool> enable(EnvironmentPerfCounters());
+  return enable;
+}
+
+uint64_t Now() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// One thread writes, anybody reads.  Record i is in records[i % size] until
+// claimed passes i + size, like a seqlock.
+struct Ring {
+  CallRecord records[kInstrumentRingSize];
+  // Records [0, written) are complete and [written, claimed) being written.
+  std::atomic<uint64_t> written, claimed;
+  // Records before this were cleared.
+  std::atomic<uint64_t> begin;
+  uint32_t thread;
+};
+
+struct Registry {
+  std::mutex mutex;
+  // Kept after their threads exit so their records can still be read.
+  std::vector<std::shared_ptr<Ring>> rings;
+};
+
+Registry &GetRegistry() {
+  static Registry *registry = new Registry();
+  return *registry;
+}
+
+std::shared_ptr<Ring> NewRing() {
+  std::shared_ptr<Ring> ring(new Ring());
+  ring->written.store(0, std::memory_order_relaxed);
+  ring->claimed.store(0, std::memory_order_relaxed);
+  ring->begin.store(0, std::memory_order_relaxed);
+  Registry &registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  ring->thread = static_cast<uint32_t>(registry.rings.size());
+  registry.rings.push_back(ring);
+  return ring;
+}
+
+Ring &ThreadRing() {
+  static thread_local std::shared_ptr<Ring> ring = NewRing();
+  return *ring;
+}
+
+// A group of cycles, instructions and last level cache misses on this thread.
+class PerfGroup {
+  public:
+    PerfGroup() : opened_(false) {
+#if defined(__linux__)
+      const uint64_t configs[3] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+      int leader = -1;
+      for (int i = 0; i < 3; ++i) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fds_[i] = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0));
+        if (fds_[i] < 0) {
+          Close(i);
+          return;
+        }
+        if (i == 0) leader = fds_[0];
+      }
+      opened_ = true;
+#endif
+    }
+
+    ~PerfGroup() {
+      if (opened_) Close(3);
+    }
+
+    // Totals so far, or zeros.
+    void Read(uint64_t *counters) {
+      std::fill(counters, counters + 3, 0);
+#if defined(__linux__)
+      uint64_t values[4];
+      if (opened_ && read(fds_[0], values, sizeof(values)) == sizeof(values) && values[0] == 3) {
+        std::copy(values + 1, values + 4, counters);
+      }
+#endif
+    }
+
+  private:
+    // Close the first count.
+    void Close(int count) {
+#if defined(__linux__)
+      for (int i = 0; i < count; ++i) close(fds_[i]);
+#endif
+      (void)count;
+    }
+
+    int fds_[3];
+    bool opened_;
+};
+
+void ReadCounters(uint64_t *counters) {
+  // Opened on the first counted record of each thread.
+  static thread_local PerfGroup group;
+  group.Read(counters);
+}
+
+} // namespace
+
+bool InstrumentCompiled() {
+#ifdef INTGEMM_INSTRUMENT
+  return true;
+#else
+  return false;
+#endif
+}
+
+void SetPerfCounters(bool enable) {
+  PerfCounters().store(enable, std::memory_order_relaxed);
+}
+
+bool GetPerfCounters() {
+  return PerfCounters().load(std::memory_order_relaxed);
+}
+
+std::vector<CallRecord> InstrumentRecords() {
+  std::vector<std::shared_ptr<Ring>> rings;
+  {
+    Registry &registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    rings = registry.rings;
+  }
+  std::vector<CallRecord> ret;
+  for (const std::shared_ptr<Ring> &ring : rings) {
+    const uint64_t end = ring->written.load(std::memory_order_acquire);
+    uint64_t first = std::max<uint64_t>(ring->begin.load(std::memory_order_relaxed), end > kInstrumentRingSize ? end - kInstrumentRingSize : 0);
+    const std::size_t old_size = ret.size();
+    for (uint64_t i = first; i < end; ++i) {
+      ret.push_back(ring->records[i % kInstrumentRingSize]);
+    }
+    // Drop what the thread may have overwritten meanwhile.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t claimed = ring->claimed.load(std::memory_order_relaxed);
+    if (claimed > first + kInstrumentRingSize) {
+      const uint64_t lost = std::min(end, claimed - kInstrumentRingSize) - first;
+      ret.erase(ret.begin() + old_size, ret.begin() + old_size + lost);
+    }
+  }
+  return ret;
+}
+
+void ClearInstrumentRecords() {
+  Registry &registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (const std::shared_ptr<Ring> &ring : registry.rings) {
+    ring->begin.store(ring->written.load(std::memory_order_acquire), std::memory_order_relaxed);
+  }
+}
+
+void WriteInstrumentCSV(std::ostream &out) {
+  static const char *const kEvents[] = {"Multiply", "Quantize", "PrepareB"};
+  out << "event,name,backend,dim0,dim1,dim2,call,thread,begin_ns,duration_ns,cycles,instructions,llc_misses\n";
+  for (const CallRecord &r : InstrumentRecords()) {
+    out << kEvents[static_cast<int>(r.event)] << ',' << r.name << ',' << r.backend << ','
+      << r.dims[0] << ',' << r.dims[1] << ',' << r.dims[2] << ','
+      << r.call << ',' << r.thread << ',' << r.begin_ns << ',' << r.duration_ns << ','
+      << r.cycles << ',' << r.instructions << ',' << r.llc_misses << '\n';
+  }
+}
+
+uint64_t NextInstrumentCall() {
+  static std::atomic<uint64_t> calls(0);
+  return calls.fetch_add(1, std::memory_order_relaxed);
+}
+
+InstrumentScope::InstrumentScope(Event event, const char *name, const char *backend, Index dim0, Index dim1, Index dim2, uint64_t call) {
+  record_.event = event;
+  record_.name = name;
+  record_.backend = backend;
+  record_.dims[0] = dim0;
+  record_.dims[1] = dim1;
+  record_.dims[2] = dim2;
+  record_.call = call;
+  counted_ = GetPerfCounters();
+  if (counted_) ReadCounters(counters_);
+  record_.begin_ns = Now();
+}
+
+InstrumentScope::~InstrumentScope() {
+  record_.duration_ns = Now() - record_.begin_ns;
+  record_.cycles = record_.instructions = record_.llc_misses = 0;
+  if (counted_) {
+    uint64_t counters[3];
+    ReadCounters(counters);
+    record_.cycles = counters[0] - counters_[0];
+    record_.instructions = counters[1] - counters_[1];
+    record_.llc_misses = counters[2] - counters_[2];
+  }
+  Ring &ring = ThreadRing();
+  record_.thread = ring.thread;
+  const uint64_t index = ring.written.load(std::memory_order_relaxed);
+  ring.claimed.store(index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  ring.records[index % kInstrumentRingSize] = record_;
+  ring.written.store(index + 1, std::memory_order_release);
+}
+
+} // namespace intgemm
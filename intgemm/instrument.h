@@ -0,0 +1,148 @@
+#pragma once
+/* Per-call records of multiplies and prepares, to tell whether a call is
+ * compute or bandwidth bound without attaching perf by hand.
+ *
+ * Configure with -DINTGEMM_INSTRUMENT=ON to compile the hooks in; they cost
+ * nothing otherwise.  Hooked are the Multiply drivers for OpenMP and for an
+ * Executor (one record per thread or per task range, sharing a call number)
+ * and the dispatched Quantize and PrepareB entry points, which PrepareA goes
+ * through.  Each thread appends to its own ring of the last
+ * kInstrumentRingSize records, without locks; InstrumentRecords copies them
+ * out.
+ *
+ * With INTGEMM_PERF_COUNTERS=1 in the environment or SetPerfCounters(true)
+ * each record also counts cycles, instructions and last level cache misses
+ * of its thread with perf_event_open on Linux.  There is no portable L2
+ * event; llc_misses * 64 / duration approximates DRAM bandwidth.  Counters
+ * read 0 where perf is unavailable, for example with perf_event_paranoid
+ * above 2.
+ */
+
+#include "intgemm/intgemm_config.h"
+#include "types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace intgemm {
+
+enum class Event : uint8_t { Multiply, Quantize, PrepareB };
+
+struct CallRecord {
+  Event event;
+  // Entry point, such as "Multiply" or "Int8::PrepareB".
+  const char *name;
+  // kName of the backend that ran.
+  const char *backend;
+  // The Index arguments in order: A_rows, width, B_cols for multiplies,
+  // rows and cols or size for prepares.  0 past the last.
+  Index dims[3];
+  // Records of one call share its number.
+  uint64_t call;
+  // Numbered in the order threads first record.
+  uint32_t thread;
+  // From std::chrono::steady_clock.
+  uint64_t begin_ns, duration_ns;
+  // 0 unless perf counters are on and available.
+  uint64_t cycles, instructions, llc_misses;
+};
+
+const std::size_t kInstrumentRingSize = 4096;
+
+// Whether the library was built with INTGEMM_INSTRUMENT, and so records.
+bool InstrumentCompiled();
+
+// Count perf events in records.  Defaults to INTGEMM_PERF_COUNTERS.
+void SetPerfCounters(bool enable);
+bool GetPerfCounters();
+
+// The records of every thread that has recorded, including exited ones,
+// each thread's oldest first.  Records being overwritten while this copies
+// are left out, so it is safe to call while multiplying.
+std::vector<CallRecord> InstrumentRecords();
+
+// Forget the records so far.
+void ClearInstrumentRecords();
+
+// InstrumentRecords as CSV with a header line.
+void WriteInstrumentCSV(std::ostream &out);
+
+// A fresh call number.
+uint64_t NextInstrumentCall();
+
+// Records the time, and counters, from construction to destruction in this
+// thread's ring.
+class InstrumentScope {
+  public:
+    InstrumentScope(Event event, const char *name, const char *backend, Index dim0, Index dim1, Index dim2, uint64_t call);
+
+    ~InstrumentScope();
+
+  private:
+    // Deliberately not copyable.
+    InstrumentScope(const InstrumentScope &) = delete;
+    InstrumentScope &operator=(const InstrumentScope &) = delete;
+
+    CallRecord record_;
+    // Whether counters_ were read, since SetPerfCounters may change meanwhile.
+    bool counted_;
+    uint64_t counters_[3];
+};
+
+// Wraps a dispatched entry point chosen by ChooseCPU in a function that
+// records its calls.  kId tells apart entry points of the same signature.
+template <unsigned kId, class Function> struct InstrumentedDispatch;
+
+template <unsigned kId, class... Args> struct InstrumentedDispatch<kId, void (*)(Args...)> {
+  static void (*Wrap(Event event, const char *name, const char *const *backend, void (*chosen)(Args...)))(Args...) {
+    event_ = event;
+    name_ = name;
+    backend_ = backend;
+    target_ = chosen;
+    return &Run;
+  }
+
+  static void Run(Args... args) {
+    Index dims[3] = {0, 0, 0};
+    Collect(dims, 0, args...);
+    InstrumentScope scope(event_, name_, *backend_, dims[0], dims[1], dims[2], NextInstrumentCall());
+    target_(args...);
+  }
+
+  private:
+    static void Collect(Index *, std::size_t) {}
+    template <class... Rest> static void Collect(Index *dims, std::size_t n, Index value, Rest... rest) {
+      if (n < 3) dims[n] = value;
+      Collect(dims, n + 1, rest...);
+    }
+    template <class T, class... Rest> static void Collect(Index *dims, std::size_t n, T, Rest... rest) {
+      Collect(dims, n, rest...);
+    }
+
+    static Event event_;
+    static const char *name_;
+    // The backend's kName may be initialized after the entry point.
+    static const char *const *backend_;
+    static void (*target_)(Args...);
+};
+
+template <unsigned kId, class... Args> Event InstrumentedDispatch<kId, void (*)(Args...)>::event_ = Event::Quantize;
+template <unsigned kId, class... Args> const char *InstrumentedDispatch<kId, void (*)(Args...)>::name_ = nullptr;
+template <unsigned kId, class... Args> const char *const *InstrumentedDispatch<kId, void (*)(Args...)>::backend_ = nullptr;
+template <unsigned kId, class... Args> void (*InstrumentedDispatch<kId, void (*)(Args...)>::target_)(Args...) = nullptr;
+
+} // namespace intgemm
+
+#ifdef INTGEMM_INSTRUMENT
+// Number the call before a parallel region then record each thread's part.
+#define INTGEMM_INSTRUMENT_CALL const uint64_t instrument_call = ::intgemm::NextInstrumentCall();
+#define INTGEMM_INSTRUMENT_MULTIPLY(name, backend, A_rows, width, B_cols) ::intgemm::InstrumentScope instrument_scope(::intgemm::Event::Multiply, name, backend, A_rows, width, B_cols, instrument_call);
+// Record calls to chosen, a ChooseCPU result, as name.
+#define INTGEMM_INSTRUMENT_DISPATCH(event, name, backend, chosen) ::intgemm::InstrumentedDispatch<__LINE__, decltype(chosen)>::Wrap(event, name, backend, chosen)
+#else
+#define INTGEMM_INSTRUMENT_CALL
+#define INTGEMM_INSTRUMENT_MULTIPLY(name, backend, A_rows, width, B_cols)
+#define INTGEMM_INSTRUMENT_DISPATCH(event, name, backend, chosen) chosen
+#endif
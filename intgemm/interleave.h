@@ -25,7 +25,9 @@ INTGEMM_INTERLEAVE_N(target, type, 16) \
 INTGEMM_INTERLEAVE_N(target, type, 32) \
 INTGEMM_INTERLEAVE_N(target, type, 64)
 
+#ifndef INTGEMM_COMPILER_SUPPORTS_NEON
 INTGEMM_INTERLEAVE(INTGEMM_SSE2, __m128i)
+#endif
 
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 INTGEMM_INTERLEAVE(INTGEMM_AVX2, __m256i)
@@ -44,7 +46,9 @@ target static inline void Swap(Register &a, Register &b) { \
   b = tmp; \
 } \
 
+#ifndef INTGEMM_COMPILER_SUPPORTS_NEON
 INTGEMM_SWAP(INTGEMM_SSE2, __m128i)
+#endif
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 INTGEMM_SWAP(INTGEMM_AVX2, __m256i)
 #endif
@@ -99,7 +103,9 @@ target static inline void Transpose16InLane(Register &r0, Register &r1, Register
   Swap(r3, r6); \
 } \
 
+#ifndef INTGEMM_COMPILER_SUPPORTS_NEON
 INTGEMM_TRANSPOSE16(INTGEMM_SSE2, __m128i)
+#endif
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 INTGEMM_TRANSPOSE16(INTGEMM_AVX2, __m256i)
 #endif
@@ -150,6 +156,35 @@ template <class Register> static inline void Transpose8InLane(
   r11 = tmp;
 }
 
+// Columns of B prepared together.  B is row major so reading one strip of 8
+// columns down all its rows takes a cache line and TLB entry per row for 32
+// bytes; a panel reads whole lines, each row once.  Panels are also the unit
+// shared out between threads.
+static const Index kPrepareBPanelCols = 64;
+
+/* PrepareB over panels of columns split between OpenMP threads, on top of
+ * PrepareBRange.  A PrepareBRange call writes only its own columns, which
+ * are strips [col_begin / 8, col_end / 8) of the output, so panels are
+ * independent.
+ */
+#define INTGEMM_PREPARE_B_THREADS(target, Integer) \
+target static void PrepareBThread(const float *input, Integer *output, float quant_mult, Index rows, Index cols) { \
+  INTGEMM_OMP_FOR \
+  for (Index c = 0; c < cols; c += kPrepareBPanelCols) { \
+    PrepareBRange(input, output, quant_mult, rows, cols, c, std::min<Index>(c + kPrepareBPanelCols, cols)); \
+  } \
+} \
+target static inline void PrepareB(const float *input, Integer *output, float quant_mult, Index rows, Index cols) { \
+  assert(cols % 8 == 0); \
+  assert(rows % (sizeof(Register) / sizeof(Integer)) == 0); \
+  assert(reinterpret_cast<uintptr_t>(input) % sizeof(Register) == 0); \
+  assert(reinterpret_cast<uintptr_t>(output) % sizeof(Register) == 0); \
+  INTGEMM_OMP_PARALLEL \
+  { \
+    PrepareBThread(input, output, quant_mult, rows, cols); \
+  } \
+}
+
 // PREPARE B: quantize and rearrange.  B is presumed to be constantparameters
 // so we can take our time rearranging it in order to save during the multiply.
 //
@@ -185,79 +220,89 @@ template <class Register> static inline void Transpose8InLane(
 // 257 273
 // ... ...
 #define INTGEMM_PREPARE_B_8(target, QuantClass) \
-target static inline void PrepareB(const float *input, int8_t *output_shadow, float quant_mult, Index rows, Index cols) { \
+target static inline void PrepareBRange(const float *input, int8_t *output_shadow, float quant_mult, Index rows, Index cols, Index col_begin, Index col_end) { \
   FRegister q = set1_ps<FRegister>(quant_mult); \
-  /* Currently all multipliers have a stride of 8 columns.*/ \
-  const Index kColStride = 8; \
-  assert(cols % kColStride == 0); \
-  assert(rows % sizeof(Register) == 0); \
-  assert(reinterpret_cast<uintptr_t>(input) % sizeof(Register) == 0); \
-  Register *output = reinterpret_cast<Register*>(output_shadow); \
-  assert(reinterpret_cast<uintptr_t>(output) % sizeof(Register) == 0); \
-  for (Index c = 0; c < cols; c += kColStride) { \
-    for (Index r = 0; r < rows; r += sizeof(Register), output += 8) { \
-      /* Quantize and perform a transpose with height sizeof(Register) and width 8. \
-         This isn't quite Transpose8InLane because it's half the number of columns, \
-         so each register starts with two rows instead of being one row. \
-         The quantizers know to skip a row.*/ \
-      output[0] = QuantClass::ForReshape(q, input + cols * (r    ) + c, cols); \
-      output[1] = QuantClass::ForReshape(q, input + cols * (r + 1) + c, cols); \
-      output[2] = QuantClass::ForReshape(q, input + cols * (r + 4) + c, cols); \
-      output[3] = QuantClass::ForReshape(q, input + cols * (r + 5) + c, cols); \
-      output[4] = QuantClass::ForReshape(q, input + cols * (r + 8) + c, cols); \
-      output[5] = QuantClass::ForReshape(q, input + cols * (r + 9) + c, cols); \
-      output[6] = QuantClass::ForReshape(q, input + cols * (r + 12) + c, cols); \
-      output[7] = QuantClass::ForReshape(q, input + cols * (r + 13) + c, cols); \
-      Interleave8(output[0], output[1]); \
-      Interleave8(output[2], output[3]); \
-      Interleave8(output[4], output[5]); \
-      Interleave8(output[6], output[7]); \
-      Transpose16InLane(output[0], output[1], output[2], output[3], output[4], output[5], output[6], output[7]); \
+  Register *output_base = reinterpret_cast<Register*>(output_shadow); \
+  for (Index panel = col_begin; panel < col_end; panel += kPrepareBPanelCols) { \
+    const Index panel_end = std::min<Index>(panel + kPrepareBPanelCols, col_end); \
+    for (Index r = 0; r < rows; r += sizeof(Register)) { \
+      for (Index c = panel; c < panel_end; c += 8) { \
+        Register *output = output_base + (static_cast<std::size_t>(c) * rows + r * 8) / sizeof(Register); \
+        /* Quantize and perform a transpose with height sizeof(Register) and width 8. \
+           This isn't quite Transpose8InLane because it's half the number of columns, \
+           so each register starts with two rows instead of being one row. \
+           The quantizers know to skip a row.*/ \
+        output[0] = QuantClass::ForReshape(q, input + cols * (r    ) + c, cols); \
+        output[1] = QuantClass::ForReshape(q, input + cols * (r + 1) + c, cols); \
+        output[2] = QuantClass::ForReshape(q, input + cols * (r + 4) + c, cols); \
+        output[3] = QuantClass::ForReshape(q, input + cols * (r + 5) + c, cols); \
+        output[4] = QuantClass::ForReshape(q, input + cols * (r + 8) + c, cols); \
+        output[5] = QuantClass::ForReshape(q, input + cols * (r + 9) + c, cols); \
+        output[6] = QuantClass::ForReshape(q, input + cols * (r + 12) + c, cols); \
+        output[7] = QuantClass::ForReshape(q, input + cols * (r + 13) + c, cols); \
+        Interleave8(output[0], output[1]); \
+        Interleave8(output[2], output[3]); \
+        Interleave8(output[4], output[5]); \
+        Interleave8(output[6], output[7]); \
+        Transpose16InLane(output[0], output[1], output[2], output[3], output[4], output[5], output[6], output[7]); \
+      } \
     } \
   } \
 } \
+INTGEMM_PREPARE_B_THREADS(target, int8_t) \
 
 #define INTGEMM_PREPARE_B_16(target, QuantClass) \
-target static inline void PrepareB(const float *input, int16_t *output_shadow, float quant_mult, Index rows, Index cols) { \
+target static inline void PrepareBRange(const float *input, int16_t *output_shadow, float quant_mult, Index rows, Index cols, Index col_begin, Index col_end) { \
   FRegister q = set1_ps<FRegister>(quant_mult); \
-  assert(cols % 8 == 0); \
-  assert(rows % (sizeof(Register) / sizeof(int16_t)) == 0); \
-  assert(reinterpret_cast<uintptr_t>(input) % sizeof(Register) == 0); \
-  Register *output = reinterpret_cast<Register*>(output_shadow); \
-  assert(reinterpret_cast<uintptr_t>(output) % sizeof(Register) == 0); \
-  for (Index c = 0; c < cols; c += 8) { \
-    for (Index r = 0; r < rows; r += (sizeof(Register) / sizeof(int16_t)), output += 8) { \
-      /* gcc unrolls this loop and uses registers for output[k]*/ \
-      for (Index k = 0; k < 8; ++k) { \
-        output[k] = QuantClass::ForReshape(q, input + cols * (r + k) + c, cols); \
+  Register *output_base = reinterpret_cast<Register*>(output_shadow); \
+  for (Index panel = col_begin; panel < col_end; panel += kPrepareBPanelCols) { \
+    const Index panel_end = std::min<Index>(panel + kPrepareBPanelCols, col_end); \
+    for (Index r = 0; r < rows; r += (sizeof(Register) / sizeof(int16_t))) { \
+      for (Index c = panel; c < panel_end; c += 8) { \
+        Register *output = output_base + (static_cast<std::size_t>(c) * rows + r * 8) / (sizeof(Register) / sizeof(int16_t)); \
+        /* gcc unrolls this loop and uses registers for output[k]*/ \
+        for (Index k = 0; k < 8; ++k) { \
+          output[k] = QuantClass::ForReshape(q, input + cols * (r + k) + c, cols); \
+        } \
+        Transpose16InLane(output[0], output[1], output[2], output[3], output[4], output[5], output[6], output[7]); \
       } \
-      Transpose16InLane(output[0], output[1], output[2], output[3], output[4], output[5], output[6], output[7]); \
     } \
   } \
-}
+} \
+INTGEMM_PREPARE_B_THREADS(target, int16_t)
 
 /*
  * Prepare B matrix.
  * B matrix has to be transposed and quantized.
  * Cols has to be a multiple of sizeof(Register) / sizeof(Integer).
  *
- * cols and rows describe size of transposed B.
+ * cols and rows describe size of transposed B.  Rows [row_begin, row_end) of
+ * the transposed B are columns of B so land in their own strips of output.
  */
 #define INTGEMM_PREPARE_B_QUANTIZED_TRANSPOSED(target, Integer) \
-target static inline void PrepareBQuantizedTransposed(const Integer* input, Integer* output, Index cols, Index rows) { \
+target static inline void PrepareBQuantizedTransposedRange(const Integer* input, Integer* output, Index cols, Index row_begin, Index row_end) { \
   const Index RegisterElems = sizeof(Register) / sizeof(Integer); \
-  const Index kColStride = 8; \
-  \
-  assert(cols % RegisterElems == 0); \
-  assert(rows % kColStride == 0); \
-  assert(reinterpret_cast<uintptr_t>(input) % sizeof(Register) == 0); \
-  assert(reinterpret_cast<uintptr_t>(output) % sizeof(Register) == 0); \
-  \
-  Register* output_it = reinterpret_cast<Register*>(output); \
-  for (Index r = 0; r < rows; r += kColStride) \
+  Register* output_it = reinterpret_cast<Register*>(output + static_cast<std::size_t>(row_begin) * cols); \
+  for (Index r = row_begin; r < row_end; r += 8) \
     for (Index c = 0; c < cols; c += RegisterElems) \
       for (Index ri = 0; ri < 8; ++ri) \
         *output_it++ = *reinterpret_cast<const Register*>(input + (r + ri) * cols + c); \
+} \
+target static void PrepareBQuantizedTransposedThread(const Integer* input, Integer* output, Index cols, Index rows) { \
+  INTGEMM_OMP_FOR \
+  for (Index r = 0; r < rows; r += kPrepareBPanelCols) { \
+    PrepareBQuantizedTransposedRange(input, output, cols, r, std::min<Index>(r + kPrepareBPanelCols, rows)); \
+  } \
+} \
+target static inline void PrepareBQuantizedTransposed(const Integer* input, Integer* output, Index cols, Index rows) { \
+  assert(cols % (sizeof(Register) / sizeof(Integer)) == 0); \
+  assert(rows % 8 == 0); \
+  assert(reinterpret_cast<uintptr_t>(input) % sizeof(Register) == 0); \
+  assert(reinterpret_cast<uintptr_t>(output) % sizeof(Register) == 0); \
+  INTGEMM_OMP_PARALLEL \
+  { \
+    PrepareBQuantizedTransposedThread(input, output, cols, rows); \
+  } \
 }
 
 /*
@@ -265,23 +310,21 @@ target static inline void PrepareBQuantizedTransposed(const Integer* input, Inte
  * B matrix has to be transposed.
  * Cols has to be a multiple of sizeof(Register) / sizeof(float).
  *
- * cols and rows describe size of transposed B.
+ * cols and rows describe size of transposed B.  When cols is a multiple of
+ * the integer register, each strip of 8 rows starts a register of output so
+ * strips are shared out between threads; otherwise registers wrap from one
+ * strip to the next and it runs on one thread.
  */
 #define INTGEMM_PREPARE_B_TRANSPOSED(target, Quantizer, Integer) \
-target static inline void PrepareBTransposed(const float* input, Integer* output, float quant_mult, Index cols, Index rows) { \
+target static inline void PrepareBTransposedRange(const float* input, Integer* output, float quant_mult, Index cols, Index row_begin, Index row_end) { \
   const Index RegisterElemsInt = sizeof(Register) / sizeof(Integer); \
   const Index kColStride = 8; \
   \
-  assert(cols % (sizeof(Register) / sizeof(float)) == 0); \
-  assert(rows % kColStride == 0); \
-  assert(reinterpret_cast<uintptr_t>(input) % sizeof(Register) == 0); \
-  assert(reinterpret_cast<uintptr_t>(output) % sizeof(Register) == 0); \
-  \
   FRegister q = set1_ps<FRegister>(quant_mult); \
-  Register* output_it = reinterpret_cast<Register*>(output); \
-  Index r = 0; \
+  Register* output_it = reinterpret_cast<Register*>(output + static_cast<std::size_t>(row_begin) * cols); \
+  Index r = row_begin; \
   Index c = 0; \
-  while (r < rows) { \
+  while (r < row_end) { \
     for (Index ri = 0; ri < 8; ++ri) \
       *output_it++ = Quantizer::ConsecutiveWithWrapping(q, input + (r + ri) * cols + c, cols - c, cols, 8); \
     c += RegisterElemsInt; \
@@ -290,20 +333,48 @@ target static inline void PrepareBTransposed(const float* input, Integer* output
       c -= cols; \
     } \
   } \
+} \
+target static void PrepareBTransposedThread(const float* input, Integer* output, float quant_mult, Index cols, Index rows) { \
+  INTGEMM_OMP_FOR \
+  for (Index r = 0; r < rows; r += kPrepareBPanelCols) { \
+    PrepareBTransposedRange(input, output, quant_mult, cols, r, std::min<Index>(r + kPrepareBPanelCols, rows)); \
+  } \
+} \
+target static inline void PrepareBTransposed(const float* input, Integer* output, float quant_mult, Index cols, Index rows) { \
+  assert(cols % (sizeof(Register) / sizeof(float)) == 0); \
+  assert(rows % 8 == 0); \
+  assert(reinterpret_cast<uintptr_t>(input) % sizeof(Register) == 0); \
+  assert(reinterpret_cast<uintptr_t>(output) % sizeof(Register) == 0); \
+  if (cols % (sizeof(Register) / sizeof(Integer))) { \
+    PrepareBTransposedRange(input, output, quant_mult, cols, 0, rows); \
+    return; \
+  } \
+  INTGEMM_OMP_PARALLEL \
+  { \
+    PrepareBTransposedThread(input, output, quant_mult, cols, rows); \
+  } \
 }
 
-/* Select columns of B from PrepareB format to PrepareB format.
+/* Select columns of B from PrepareB format to PrepareB format.  Each group of 8
+ * selected columns is one strip of output, so groups are shared out between
+ * OpenMP threads kSelectColumnsChunk columns at a time.  The selected columns
+ * are scattered over B, so the start of the next group is prefetched while a
+ * group is copied.
  */
+static const Index kSelectColumnsChunk = 64;
+
 #define INTGEMM_SELECT_COL_B(target, Register) \
-target static inline void SelectColumnsOfB(const Register *input, Register *output, Index rows_bytes /* number of bytes in a row */, const Index *cols_begin, const Index *cols_end) { \
-  assert(rows_bytes % sizeof(Register) == 0); \
-  assert((cols_end - cols_begin) % 8 == 0);  \
-  /* Do columns for multiples of 8.*/ \
-  Index register_rows = rows_bytes / sizeof(Register); \
+target static inline void SelectColumnsOfBRange(const Register *input, Register *output, Index register_rows, const Index *cols, Index begin, Index end) { \
+  output += static_cast<std::size_t>(begin) * register_rows; \
   const Register *starts[8]; \
-  for (; cols_begin != cols_end; cols_begin += 8) { \
+  for (Index group = begin; group < end; group += 8) { \
     for (Index k = 0; k < 8; ++k) { \
-      starts[k] = input + (cols_begin[k] & 7) + (cols_begin[k] & ~7) * register_rows; \
+      starts[k] = input + (cols[group + k] & 7) + (cols[group + k] & ~7) * register_rows; \
+    } \
+    if (group + 8 < end) { \
+      for (Index k = 8; k < 16; ++k) { \
+        INTGEMM_PREFETCH(input + (cols[group + k] & 7) + (cols[group + k] & ~7) * register_rows); \
+      } \
     } \
     for (Index r = 0; r < register_rows; ++r) { \
       for (Index k = 0; k < 8; ++k) { \
@@ -312,6 +383,22 @@ target static inline void SelectColumnsOfB(const Register *input, Register *outp
       } \
     } \
   } \
+} \
+target static void SelectColumnsOfBThread(const Register *input, Register *output, Index register_rows, const Index *cols, Index count) { \
+  INTGEMM_OMP_FOR \
+  for (Index begin = 0; begin < count; begin += kSelectColumnsChunk) { \
+    SelectColumnsOfBRange(input, output, register_rows, cols, begin, std::min<Index>(begin + kSelectColumnsChunk, count)); \
+  } \
+} \
+target static inline void SelectColumnsOfB(const Register *input, Register *output, Index rows_bytes /* number of bytes in a row */, const Index *cols_begin, const Index *cols_end) { \
+  assert(rows_bytes % sizeof(Register) == 0); \
+  assert((cols_end - cols_begin) % 8 == 0);  \
+  const Index register_rows = rows_bytes / sizeof(Register); \
+  const Index count = static_cast<Index>(cols_end - cols_begin); \
+  INTGEMM_OMP_PARALLEL \
+  { \
+    SelectColumnsOfBThread(input, output, register_rows, cols_begin, count); \
+  } \
 }
 
 } // namespace intgemm
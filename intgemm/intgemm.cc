@@ -1,4 +1,13 @@
-#if defined(WASM)
+#include "intgemm/intgemm_config.h"
+
+#if defined(INTGEMM_COMPILER_SUPPORTS_NEON)
+// No CPUID on ARM: the operating system reports features.
+#  if defined(__linux__)
+#    include <sys/auxv.h>
+#  elif defined(__APPLE__)
+#    include <sys/sysctl.h>
+#  endif
+#elif defined(WASM)
 // No header for CPUID since it's hard-coded.
 #elif defined(__INTEL_COMPILER)
 #include <immintrin.h>
@@ -9,22 +18,89 @@
 #include <cpuid.h>
 #endif
 
+#include "aligned.h"
 #include "intgemm.h"
+#include "prepared_b.h"
 #include "stats.h"
 
 #include <stdlib.h>
+#if defined(INTGEMM_COMPILER_SUPPORTS_AMX) && defined(__linux__) && defined(__x86_64__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <vector>
 
 namespace intgemm {
 
 namespace {
 
+// AVX-VNNI is CPUID leaf 7 subleaf 1 eax bit 4.  It is separate from the
+// ladder in RealCPUID because AVX512 CPUs may or may not have it.
+bool RealAVXVNNI() {
+#if !defined(INTGEMM_COMPILER_SUPPORTS_AVXVNNI) || defined(WASM) || defined(__INTEL_COMPILER)
+  return false;
+#else
+#  if defined(_MSC_VER)
+  int regs[4];
+  int &eax = regs[0];
+  __cpuid(regs, 0);
+  if (eax < 7) return false;
+  __cpuidex(regs, 7, 0);
+  if (eax < 1) return false;
+  __cpuidex(regs, 7, 1);
+#  else
+  unsigned int eax, ebx, ecx, edx;
+  if (__get_cpuid_max(0, 0) < 7) return false;
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  if (eax < 1) return false;
+  __cpuid_count(7, 1, eax, ebx, ecx, edx);
+#  endif
+  return (eax & (1 << 4)) != 0;
+#endif
+}
+
+// Linux does not let a process use the AMX tile data registers until it asks
+// for them, because they add 8 KB to every signal frame and context switch.
+bool AMXPermitted() {
+#if defined(INTGEMM_COMPILER_SUPPORTS_AMX) && defined(__linux__) && defined(__x86_64__)
+  const int kArchReqXCompPerm = 0x1023;
+  const int kXFeatureXTileData = 18;
+  return syscall(SYS_arch_prctl, kArchReqXCompPerm, kXFeatureXTileData) == 0;
+#else
+  return false;
+#endif
+}
+
 // Return the maximum CPU model that's found and supported at compile time.
 CPUType RealCPUID() {
-#if defined(WASM)
-  // emscripten does SSE4.1 but we only use up to SSSE3.
-  return CPUType::SSSE3;
+#if defined(INTGEMM_COMPILER_SUPPORTS_NEON)
+  // Advanced SIMD is mandatory on aarch64; only the dot product is optional.
+#  if !defined(INTGEMM_COMPILER_SUPPORTS_NEON_DOTPROD)
+  return CPUType::NEON;
+#  elif defined(__linux__)
+#    ifndef HWCAP_ASIMDDP
+#      define HWCAP_ASIMDDP (1 << 20)
+#    endif
+  return (getauxval(AT_HWCAP) & HWCAP_ASIMDDP) ? CPUType::NEONDOTPROD : CPUType::NEON;
+#  elif defined(__APPLE__)
+  // Every Apple arm64 CPU has it but ask anyway.
+  int value = 0;
+  size_t size = sizeof(value);
+  if (sysctlbyname("hw.optional.arm.FEAT_DotProd", &value, &size, NULL, 0) == 0 && value) return CPUType::NEONDOTPROD;
+  return CPUType::NEON;
+#  else
+  return CPUType::NEON;
+#  endif
+#elif defined(WASM)
+  // A module using SIMD128 does not load without it, so there is nothing to
+  // detect.  The SSE2 and SSSE3 kernels also run through emscripten's emulation.
+  return CPUType::SIMD128;
 #elif defined(__INTEL_COMPILER)
 #  ifdef INTGEMM_COMPILER_SUPPORTS_AVX512VNNI
   if (_may_i_use_cpu_feature(_FEATURE_AVX512_VNNI)) return CPUType::AVX512VNNI;
@@ -65,12 +141,17 @@ CPUType RealCPUID() {
 #  else
     __cpuid_count(7, 0, eax, ebx, ecx, edx);
 #  endif
+#  ifdef INTGEMM_COMPILER_SUPPORTS_AMX
+    // AMX-TILE and AMX-INT8.  Every such CPU also has AVX512VNNI.
+    if ((edx & (1 << 24)) && (edx & (1 << 25)) && (ecx & (1 << 11)) && AMXPermitted()) return CPUType::AMX;
+#  endif
 #  ifdef INTGEMM_COMPILER_SUPPORTS_AVX512VNNI
     if (ecx & (1 << 11)) return CPUType::AVX512VNNI;
 #  endif
 #  ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
     if (ebx & (1 << 30)) return CPUType::AVX512BW;
 #  endif
+    if (RealAVXVNNI()) return CPUType::AVXVNNI;
 #  ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
     if (ebx & (1 << 5)) return CPUType::AVX2;
 #   endif
@@ -88,32 +169,109 @@ CPUType RealCPUID() {
 #endif
 }
 
+// Most capable type this build knows, which the environment can lower.
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+const CPUType kMaxCPU = CPUType::NEONDOTPROD;
+#elif defined(WASM)
+const CPUType kMaxCPU = CPUType::SIMD128;
+#else
+const CPUType kMaxCPU = CPUType::AMX;
+#endif
+
 CPUType EnvironmentCPUID() {
 #if defined(_MSC_VER)
-  char env_override[11];
+  char env_override[12];
   size_t len = 0;
-  if (getenv_s(&len, env_override, sizeof(env_override), "INTGEMM_CPUID")) return CPUType::AVX512VNNI;
-  if (!len) return CPUType::AVX512VNNI;
+  if (getenv_s(&len, env_override, sizeof(env_override), "INTGEMM_CPUID")) return kMaxCPU;
+  if (!len) return kMaxCPU;
 #else
   const char *env_override = getenv("INTGEMM_CPUID");
-  if (!env_override) return CPUType::AVX512VNNI; /* This will be capped to actual ID */
+  if (!env_override) return kMaxCPU; /* This will be capped to actual ID */
 #endif
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+  if (!strcmp(env_override, "NEONDOTPROD")) return CPUType::NEONDOTPROD;
+  if (!strcmp(env_override, "NEON")) return CPUType::NEON;
+#elif defined(WASM)
+  // Only the emulated SSE kernels are below WASM.
+  if (!strcmp(env_override, "SIMD128")) return CPUType::SIMD128;
+  if (!strcmp(env_override, "SSSE3")) return CPUType::SSSE3;
+  if (!strcmp(env_override, "SSE2")) return CPUType::SSE2;
+#else
+  if (!strcmp(env_override, "AMX")) return CPUType::AMX;
   if (!strcmp(env_override, "AVX512VNNI")) return CPUType::AVX512VNNI;
   if (!strcmp(env_override, "AVX512BW")) return CPUType::AVX512BW;
+  if (!strcmp(env_override, "AVXVNNI")) return CPUType::AVXVNNI;
   if (!strcmp(env_override, "AVX2")) return CPUType::AVX2;
   if (!strcmp(env_override, "SSSE3")) return CPUType::SSSE3;
   if (!strcmp(env_override, "SSE2")) return CPUType::SSE2;
+#endif
   std::cerr << "Unrecognized INTGEMM_CPUID " << env_override << std::endl;
-  return CPUType::AVX512VNNI;
+  return kMaxCPU;
+}
+
+CPUType CapCPUID(CPUType real, CPUType cap) {
+  CPUType ret = std::min(real, cap);
+  // Capping an AVX512 CPU at AVXVNNI only works if it has AVX-VNNI too.
+  if (ret == CPUType::AVXVNNI && !RealAVXVNNI()) ret = CPUType::AVX2;
+  return ret;
+}
+
+// Copy of B with column c multiplied by quant_mults[c], for PrepareB to
+// quantize with multiplier 1.  Transposed B has a row per column.
+AlignedVector<float> ScaleColumns(const float *input, const float *quant_mults, Index rows, Index cols, bool transposed) {
+  AlignedVector<float> scaled(static_cast<std::size_t>(rows) * cols);
+  for (Index r = 0; r < rows; ++r) {
+    for (Index c = 0; c < cols; ++c) {
+      const std::size_t i = static_cast<std::size_t>(r) * cols + c;
+      scaled[i] = input[i] * quant_mults[transposed ? r : c];
+    }
+  }
+  return scaled;
+}
+
+// Copy of B, rows x cols, zero padded to padded_rows x padded_cols.
+AlignedVector<float> PadB(const float *input, Index rows, Index cols, Index padded_rows, Index padded_cols) {
+  AlignedVector<float> padded(static_cast<std::size_t>(padded_rows) * padded_cols);
+  std::fill(padded.begin(), padded.end(), 0.0f);
+  for (Index r = 0; r < rows; ++r) {
+    std::copy(input + static_cast<std::size_t>(r) * cols, input + static_cast<std::size_t>(r + 1) * cols, padded.begin() + static_cast<std::size_t>(r) * padded_cols);
+  }
+  return padded;
+}
+
+// Copy rows [row_begin, row_end) of B, prepared on their own, where preparing
+// all of B would put them.
+template <class Integer> void CopyPreparedRows(const Integer *prepared, Integer *output, Index rows, Index cols, Index row_begin, Index row_end) {
+  const Index chunk = row_end - row_begin;
+  for (Index strip = 0; strip < cols / 8; ++strip) {
+    std::memcpy(output + static_cast<std::size_t>(strip) * 8 * rows + static_cast<std::size_t>(row_begin) * 8, prepared + static_cast<std::size_t>(strip) * 8 * chunk, static_cast<std::size_t>(chunk) * 8 * sizeof(Integer));
+  }
+}
+
+// Prepare rows [row_begin, row_end) of B, given from row row_begin, where
+// prepare would put them for all of B.  Every layout keeps a strip's rows in
+// order (see prepared_b.h), so the rows prepared on their own are, strip by
+// strip, a contiguous block of each strip of the whole.
+template <class Integer> void PrepareBRowsWith(void (*prepare)(const float *, Integer *, float, Index, Index), const float *input, Integer *output, float quant_mult, Index rows, Index cols, Index row_begin, Index row_end) {
+  const Index chunk = row_end - row_begin;
+  if (!chunk) return;
+  Integer *prepared = ThreadBlockBuffer<Integer>(static_cast<std::size_t>(chunk) * cols);
+  prepare(input, prepared, quant_mult, chunk, cols);
+  CopyPreparedRows(prepared, output, rows, cols, row_begin, row_end);
 }
 
 } // namespace
 
 CPUType GetCPUID() {
-  static const CPUType kLocalCPU = std::min(RealCPUID(), EnvironmentCPUID());
+  static const CPUType kLocalCPU = CapCPUID(RealCPUID(), EnvironmentCPUID());
   return kLocalCPU;
 }
 
+bool AVXVNNIAvailable() {
+  static const bool kAvailable = GetCPUID() >= CPUType::AVXVNNI && RealAVXVNNI();
+  return kAvailable;
+}
+
 const CPUType kCPU = GetCPUID();
 
 void UnsupportedCPUError() {
@@ -125,6 +283,14 @@ void UnsupportedCPUError() {
 #endif
 }
 
+#define INTGEMM_JOIN2(a, b) a##b
+#define INTGEMM_JOIN(a, b) INTGEMM_JOIN2(a, b)
+// Define dispatch pointer, already declared, to resolve to the kernel chosen
+// by the expression that follows on its first call; see LazyDispatch.
+#define INTGEMM_LAZY_DISPATCH(pointer, ...) \
+  namespace { decltype(pointer) INTGEMM_JOIN(ChooseLine, __LINE__)() { return __VA_ARGS__; } } \
+  decltype(pointer) pointer = LazyDispatch<decltype(pointer)>::Resolve<INTGEMM_JOIN(ChooseLine, __LINE__)>
+
 float Unsupported_MaxAbsolute(const float * /*begin*/, const float * /*end*/) {
   UnsupportedCPUError();
   return 0.0f;
@@ -135,67 +301,678 @@ MeanStd Unsupported_VectorMeanStd(const float * /*begin*/, const float * /*end*/
   return MeanStd();
 }
 
-void (*Int16::Quantize)(const float *input, int16_t *output, float quant_mult, Index size) = ChooseCPU(AVX512BW::Kernels16::Quantize, AVX512BW::Kernels16::Quantize, AVX2::Kernels16::Quantize, SSE2::Kernels16::Quantize, SSE2::Kernels16::Quantize, Unsupported_16bit::Quantize);
+void Unsupported_HistogramAbsolute(const float * /*begin*/, const float * /*end*/, uint64_t * /*counts*/) {
+  UnsupportedCPUError();
+}
 
-void (*Int16::PrepareB)(const float *input, int16_t *output, float quant_mult, Index rows, Index cols) = ChooseCPU(AVX512BW::Kernels16::PrepareB, AVX512BW::Kernels16::PrepareB, AVX2::Kernels16::PrepareB, SSE2::Kernels16::PrepareB, SSE2::Kernels16::PrepareB, Unsupported_16bit::PrepareB);
+template <class From, class To> void Unsupported_Elementwise(const From * /*input*/, To * /*output*/, Index /*size*/) {
+  UnsupportedCPUError();
+}
 
-void (*Int16::PrepareBQuantizedTransposed)(const int16_t *input, int16_t *output, Index inner, Index B_untransposed_cols) = ChooseCPU(AVX512BW::Kernels16::PrepareBQuantizedTransposed, AVX512BW::Kernels16::PrepareBQuantizedTransposed, AVX2::Kernels16::PrepareBQuantizedTransposed, SSE2::Kernels16::PrepareBQuantizedTransposed, SSE2::Kernels16::PrepareBQuantizedTransposed, Unsupported_16bit::PrepareBQuantizedTransposed);
+INTGEMM_LAZY_DISPATCH(Int16::Quantize, INTGEMM_INSTRUMENT_DISPATCH(Event::Quantize, "Int16::Quantize", &Int16::kName, ChooseCPU(SSE2::Kernels16::Quantize, NEON::Kernels16::Quantize, NEON::Kernels16::Quantize, AVX512VNNI::Kernels16::Quantize, AVX512VNNI::Kernels16::Quantize, AVX512BW::Kernels16::Quantize, AVX2::Kernels16::Quantize, AVX2::Kernels16::Quantize, SSE2::Kernels16::Quantize, SSE2::Kernels16::Quantize, Unsupported_16bit::Quantize)));
 
-void (*Int16::PrepareBTransposed)(const float *input, int16_t *output, float quant_mult, Index inner, Index B_untransposed_cols) = ChooseCPU(AVX512BW::Kernels16::PrepareBTransposed, AVX512BW::Kernels16::PrepareBTransposed, AVX2::Kernels16::PrepareBTransposed, SSE2::Kernels16::PrepareBTransposed, SSE2::Kernels16::PrepareBTransposed, Unsupported_16bit::PrepareBTransposed);
+INTGEMM_LAZY_DISPATCH(Int16::PrepareB, INTGEMM_INSTRUMENT_DISPATCH(Event::PrepareB, "Int16::PrepareB", &Int16::kName, ChooseCPU(SSE2::Kernels16::PrepareB, NEON::Kernels16::PrepareB, NEON::Kernels16::PrepareB, AVX512VNNI::Kernels16::PrepareB, AVX512VNNI::Kernels16::PrepareB, AVX512BW::Kernels16::PrepareB, AVX2::Kernels16::PrepareB, AVX2::Kernels16::PrepareB, SSE2::Kernels16::PrepareB, SSE2::Kernels16::PrepareB, Unsupported_16bit::PrepareB)));
 
-void (*Int16::SelectColumnsB)(const int16_t *input, int16_t *output, Index rows, const Index *cols_begin, const Index *cols_end) = ChooseCPU(AVX512BW::Kernels16::SelectColumnsB, AVX512BW::Kernels16::SelectColumnsB, AVX2::Kernels16::SelectColumnsB, SSE2::Kernels16::SelectColumnsB, SSE2::Kernels16::SelectColumnsB, Unsupported_16bit::SelectColumnsB);
+void Int16::PrepareBColumns(const float *input, int16_t *output, const float *quant_mults, Index rows, Index cols) {
+  PrepareB(ScaleColumns(input, quant_mults, rows, cols, false).begin(), output, 1.0f, rows, cols);
+}
 
-const char *const Int16::kName = ChooseCPU(AVX512BW::Kernels16::kName, AVX512BW::Kernels16::kName, AVX2::Kernels16::kName, SSE2::Kernels16::kName, SSE2::Kernels16::kName, Unsupported_16bit::kName);
+void Int16::PrepareBTransposedColumns(const float *input, int16_t *output, const float *quant_mults, Index inner, Index B_untransposed_cols) {
+  PrepareBTransposed(ScaleColumns(input, quant_mults, B_untransposed_cols, inner, true).begin(), output, 1.0f, inner, B_untransposed_cols);
+}
 
-void (*Int8::Quantize)(const float *input, int8_t *output, float quant_mult, Index size) = ChooseCPU(AVX512VNNI::Kernels8::Quantize, AVX512BW::Kernels8::Quantize, AVX2::Kernels8::Quantize, SSSE3::Kernels8::Quantize, Unsupported_8bit::Quantize, Unsupported_8bit::Quantize);
+void Int16::PrepareBRows(const float *input, int16_t *output, float quant_mult, Index rows, Index cols, Index row_begin, Index row_end) {
+  assert(row_begin % tile_info.b_rows == 0 && row_end % tile_info.b_rows == 0 && row_end <= rows);
+  PrepareBRowsWith(PrepareB, input, output, quant_mult, rows, cols, row_begin, row_end);
+}
+
+INTGEMM_LAZY_DISPATCH(Int16::PrepareBQuantizedTransposed, INTGEMM_INSTRUMENT_DISPATCH(Event::PrepareB, "Int16::PrepareBQuantizedTransposed", &Int16::kName, ChooseCPU(SSE2::Kernels16::PrepareBQuantizedTransposed, NEON::Kernels16::PrepareBQuantizedTransposed, NEON::Kernels16::PrepareBQuantizedTransposed, AVX512VNNI::Kernels16::PrepareBQuantizedTransposed, AVX512VNNI::Kernels16::PrepareBQuantizedTransposed, AVX512BW::Kernels16::PrepareBQuantizedTransposed, AVX2::Kernels16::PrepareBQuantizedTransposed, AVX2::Kernels16::PrepareBQuantizedTransposed, SSE2::Kernels16::PrepareBQuantizedTransposed, SSE2::Kernels16::PrepareBQuantizedTransposed, Unsupported_16bit::PrepareBQuantizedTransposed)));
+
+INTGEMM_LAZY_DISPATCH(Int16::PrepareBTransposed, INTGEMM_INSTRUMENT_DISPATCH(Event::PrepareB, "Int16::PrepareBTransposed", &Int16::kName, ChooseCPU(SSE2::Kernels16::PrepareBTransposed, NEON::Kernels16::PrepareBTransposed, NEON::Kernels16::PrepareBTransposed, AVX512VNNI::Kernels16::PrepareBTransposed, AVX512VNNI::Kernels16::PrepareBTransposed, AVX512BW::Kernels16::PrepareBTransposed, AVX2::Kernels16::PrepareBTransposed, AVX2::Kernels16::PrepareBTransposed, SSE2::Kernels16::PrepareBTransposed, SSE2::Kernels16::PrepareBTransposed, Unsupported_16bit::PrepareBTransposed)));
+
+INTGEMM_LAZY_DISPATCH(Int16::SelectColumnsB, ChooseCPU(SSE2::Kernels16::SelectColumnsB, NEON::Kernels16::SelectColumnsB, NEON::Kernels16::SelectColumnsB, AVX512VNNI::Kernels16::SelectColumnsB, AVX512VNNI::Kernels16::SelectColumnsB, AVX512BW::Kernels16::SelectColumnsB, AVX2::Kernels16::SelectColumnsB, AVX2::Kernels16::SelectColumnsB, SSE2::Kernels16::SelectColumnsB, SSE2::Kernels16::SelectColumnsB, Unsupported_16bit::SelectColumnsB));
+
+const char *const Int16::kName = ChooseCPU(SSE2::Kernels16::kName, NEON::Kernels16::kName, NEON::Kernels16::kName, AVX512VNNI::Kernels16::kName, AVX512VNNI::Kernels16::kName, AVX512BW::Kernels16::kName, AVX2::Kernels16::kName, AVX2::Kernels16::kName, SSE2::Kernels16::kName, SSE2::Kernels16::kName, Unsupported_16bit::kName);
+
+namespace {
+// Bytes of B in each register of A's 16-bit values for Int16By8.
+const Index kMixedGroup = ChooseCPU(8, 8, 8, 32, 32, 32, 16, 16, 8, 8, 0);
+} // namespace
+
+void Int16By8::PrepareB(const float *input, int8_t *output, float quant_mult, Index rows, Index cols) {
+  const Index group = kMixedGroup;
+  if (!group) UnsupportedCPUError();
+  assert(rows % group == 0 && cols % 8 == 0);
+  // Int16 quantizes the same as Int8 before Int8 clamps to [-127, 127].
+  AlignedVector<int16_t> quantized(static_cast<std::size_t>(rows) * cols);
+  Int16::Quantize(input, quantized.begin(), quant_mult, rows * cols);
+  // Column c of strip s has rows [k, k + group) at s * 8 * rows + k * 8 + c * group.
+  for (Index r = 0; r < rows; ++r) {
+    const int16_t *from = quantized.begin() + static_cast<std::size_t>(r) * cols;
+    int8_t *to = output + static_cast<std::size_t>(r - r % group) * 8 + r % group;
+    for (Index c = 0; c < cols; ++c) {
+      to[static_cast<std::size_t>(c / 8) * 8 * rows + (c % 8) * group] = static_cast<int8_t>(std::max<int16_t>(-127, std::min<int16_t>(127, from[c])));
+    }
+  }
+}
+
+const char *const Int16By8::kName = ChooseCPU("16x8-bit SSE2", "16x8-bit NEON", "16x8-bit NEON", "16x8-bit AVX512VNNI", "16x8-bit AVX512VNNI", "16x8-bit AVX512BW", "16x8-bit AVX2", "16x8-bit AVX2", "16x8-bit SSE2", "16x8-bit SSE2", "16x8-bit Unsupported");
+
+INTGEMM_LAZY_DISPATCH(Int8::Quantize, INTGEMM_INSTRUMENT_DISPATCH(Event::Quantize, "Int8::Quantize", &Int8::kName, ChooseCPU(SSSE3::Kernels8::Quantize, NEON::Kernels8::Quantize, NEON::Kernels8::Quantize, AVX512VNNI::Kernels8::Quantize, AVX512VNNI::Kernels8::Quantize, AVX512BW::Kernels8::Quantize, AVX2::Kernels8::Quantize, AVX2::Kernels8::Quantize, SSSE3::Kernels8::Quantize, Unsupported_8bit::Quantize, Unsupported_8bit::Quantize)));
+
+INTGEMM_LAZY_DISPATCH(Int8::QuantizeU, INTGEMM_INSTRUMENT_DISPATCH(Event::Quantize, "Int8::QuantizeU", &Int8::kName, ChooseCPU(SSSE3::Kernels8::QuantizeU, NEON::Kernels8::QuantizeU, NEON::Kernels8::QuantizeU, AVX512VNNI::Kernels8::QuantizeU, AVX512VNNI::Kernels8::QuantizeU, AVX512BW::Kernels8::QuantizeU, AVX2::Kernels8::QuantizeU, AVX2::Kernels8::QuantizeU, SSSE3::Kernels8::QuantizeU, Unsupported_8bit::QuantizeU, Unsupported_8bit::QuantizeU)));
+
+INTGEMM_LAZY_DISPATCH(Int8::QuantizeRows, ChooseCPU(SSSE3::Kernels8::QuantizeRows, NEON::Kernels8::QuantizeRows, NEON::Kernels8::QuantizeRows, AVX512VNNI::Kernels8::QuantizeRows, AVX512VNNI::Kernels8::QuantizeRows, AVX512BW::Kernels8::QuantizeRows, AVX2::Kernels8::QuantizeRows, AVX2::Kernels8::QuantizeRows, SSSE3::Kernels8::QuantizeRows, Unsupported_8bit::QuantizeRows, Unsupported_8bit::QuantizeRows));
+
+INTGEMM_LAZY_DISPATCH(Int8::QuantizeRowsScaled, ChooseCPU(SSSE3::Kernels8::QuantizeRowsScaled, NEON::Kernels8::QuantizeRowsScaled, NEON::Kernels8::QuantizeRowsScaled, AVX512VNNI::Kernels8::QuantizeRowsScaled, AVX512VNNI::Kernels8::QuantizeRowsScaled, AVX512BW::Kernels8::QuantizeRowsScaled, AVX2::Kernels8::QuantizeRowsScaled, AVX2::Kernels8::QuantizeRowsScaled, SSSE3::Kernels8::QuantizeRowsScaled, Unsupported_8bit::QuantizeRowsScaled, Unsupported_8bit::QuantizeRowsScaled));
+
+INTGEMM_LAZY_DISPATCH(Int8::QuantizeScaled, ChooseCPU(SSSE3::Kernels8::QuantizeScaled, NEON::Kernels8::QuantizeScaled, NEON::Kernels8::QuantizeScaled, AVX512VNNI::Kernels8::QuantizeScaled, AVX512VNNI::Kernels8::QuantizeScaled, AVX512BW::Kernels8::QuantizeScaled, AVX2::Kernels8::QuantizeScaled, AVX2::Kernels8::QuantizeScaled, SSSE3::Kernels8::QuantizeScaled, Unsupported_8bit::QuantizeScaled, Unsupported_8bit::QuantizeScaled));
+
+INTGEMM_LAZY_DISPATCH(Int8::QuantizeUScaled, ChooseCPU(SSSE3::Kernels8::QuantizeUScaled, NEON::Kernels8::QuantizeUScaled, NEON::Kernels8::QuantizeUScaled, AVX512VNNI::Kernels8::QuantizeUScaled, AVX512VNNI::Kernels8::QuantizeUScaled, AVX512BW::Kernels8::QuantizeUScaled, AVX2::Kernels8::QuantizeUScaled, AVX2::Kernels8::QuantizeUScaled, SSSE3::Kernels8::QuantizeUScaled, Unsupported_8bit::QuantizeUScaled, Unsupported_8bit::QuantizeUScaled));
+
+INTGEMM_LAZY_DISPATCH(Int8::PrepareB, INTGEMM_INSTRUMENT_DISPATCH(Event::PrepareB, "Int8::PrepareB", &Int8::kName, ChooseCPU(SSSE3::Kernels8::PrepareB, NEON::Kernels8::PrepareB, NEON::Kernels8::PrepareB, AMX::Kernels8::PrepareB, AVX512VNNI::Kernels8::PrepareB, AVX512BW::Kernels8::PrepareB, AVX2::Kernels8::PrepareB, AVX2::Kernels8::PrepareB, SSSE3::Kernels8::PrepareB, Unsupported_8bit::PrepareB, Unsupported_8bit::PrepareB)));
+
+void Int8::PrepareAPadded(const float *input, int8_t *output, float quant_mult, Index rows, Index cols) {
+  const Index padded = PaddedWidth(cols);
+  Quantize(input, output, quant_mult, rows * cols);
+  if (padded == cols) return;
+  // Spread the rows out from the last so none is overwritten before it moves.
+  for (Index r = rows; r-- > 0;) {
+    std::memmove(output + static_cast<std::size_t>(r) * padded, output + static_cast<std::size_t>(r) * cols, cols);
+    std::memset(output + static_cast<std::size_t>(r) * padded + cols, 0, padded - cols);
+  }
+}
+
+void Int8::PrepareBPadded(const float *input, int8_t *output, float quant_mult, Index rows, Index cols) {
+  const Index padded_rows = PaddedWidth(rows), padded_cols = PaddedCols(cols);
+  if (padded_rows == rows && padded_cols == cols) {
+    PrepareB(input, output, quant_mult, rows, cols);
+  } else {
+    PrepareB(PadB(input, rows, cols, padded_rows, padded_cols).begin(), output, quant_mult, padded_rows, padded_cols);
+  }
+}
+
+void Int8::PrepareBColumns(const float *input, int8_t *output, const float *quant_mults, Index rows, Index cols) {
+  PrepareB(ScaleColumns(input, quant_mults, rows, cols, false).begin(), output, 1.0f, rows, cols);
+}
+
+void Int8::PrepareBTransposedColumns(const float *input, int8_t *output, const float *quant_mults, Index inner, Index B_untransposed_cols) {
+  PrepareBTransposed(ScaleColumns(input, quant_mults, B_untransposed_cols, inner, true).begin(), output, 1.0f, inner, B_untransposed_cols);
+}
+
+void Int8::PrepareBRows(const float *input, int8_t *output, float quant_mult, Index rows, Index cols, Index row_begin, Index row_end) {
+  assert(row_begin % tile_info.b_rows == 0 && row_end % tile_info.b_rows == 0 && row_end <= rows);
+  PrepareBRowsWith(PrepareB, input, output, quant_mult, rows, cols, row_begin, row_end);
+}
+
+void Int8::PrepareBQuantizedTransposedInPlace(int8_t *matrix, Index inner, Index B_untransposed_cols) {
+  // Columns of B are rows of the input, and prepared strips take the same
+  // bytes as their 8 rows did, so prepare a group of columns at a time from
+  // a copy straight back over them.
+  const Index kGroupCols = 256;
+  AlignedVector<int8_t> group(static_cast<std::size_t>(std::min(kGroupCols, B_untransposed_cols)) * inner);
+  for (Index c = 0; c < B_untransposed_cols; c += kGroupCols) {
+    const Index cols = std::min(kGroupCols, B_untransposed_cols - c);
+    int8_t *at = matrix + static_cast<std::size_t>(c) * inner;
+    std::memcpy(group.begin(), at, static_cast<std::size_t>(cols) * inner);
+    PrepareBQuantizedTransposed(group.begin(), at, inner, cols);
+  }
+}
+
+Index Int8::CountSaturated(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, CPUType cpu) {
+  // Register width in bytes of the kernels that saturate.
+  Index lane_bytes;
+  switch (cpu) {
+    case CPUType::AVX512BW:
+      lane_bytes = 64;
+      break;
+    case CPUType::AVX2:
+      lane_bytes = 32;
+      break;
+    case CPUType::SSSE3:
+      lane_bytes = 16;
+      break;
+    default:
+      return 0;
+  }
+  const Index group = PreparedBGroup(GetCPUID(), 1);
+  if (!group) UnsupportedCPUError();
+  // The kernels sum each 16-bit lane, a pair of bytes at the same place in
+  // every register, over a panel of the shared dimension at a time, then
+  // widen.  Compare that with the exact sum.
+  std::vector<int8_t> column(width);
+  Index saturated = 0;
+  for (Index col = 0; col < B_cols; ++col) {
+    const int8_t *strip = B + static_cast<std::size_t>(col / 8) * 8 * width + (col % 8) * group;
+    for (Index k = 0; k < width; k += group) {
+      std::memcpy(column.data() + k, strip + static_cast<std::size_t>(k) * 8, group);
+    }
+    for (Index r = 0; r < A_rows; ++r) {
+      const int8_t *row = A + static_cast<std::size_t>(r) * width;
+      int64_t exact = 0, got = 0;
+      for (Index panel = 0; panel < width; panel += kMultiplyPanelBytes) {
+        const Index panel_end = std::min(width, panel + kMultiplyPanelBytes);
+        for (Index lane = 0; lane < lane_bytes; lane += 2) {
+          int32_t sum = 0;
+          for (Index i = panel + lane; i < panel_end; i += lane_bytes) {
+            // maddubs_epi16 of |a| and b with a's sign, saturated.
+            int32_t pair = 0;
+            for (Index j = i; j < i + 2; ++j) {
+              const int8_t b = row[j] < 0 ? static_cast<int8_t>(-column[j]) : column[j];
+              pair += std::abs(static_cast<int32_t>(row[j])) * b;
+              exact += static_cast<int32_t>(row[j]) * column[j];
+            }
+            pair = std::max(-32768, std::min(32767, pair));
+            sum = std::max(-32768, std::min(32767, sum + pair));
+          }
+          got += sum;
+        }
+      }
+      if (got != exact) ++saturated;
+    }
+  }
+  return saturated;
+}
+
+INTGEMM_LAZY_DISPATCH(Int8::PrepareBQuantizedTransposed, INTGEMM_INSTRUMENT_DISPATCH(Event::PrepareB, "Int8::PrepareBQuantizedTransposed", &Int8::kName, ChooseCPU(SSSE3::Kernels8::PrepareBQuantizedTransposed, NEON::Kernels8::PrepareBQuantizedTransposed, NEON::Kernels8::PrepareBQuantizedTransposed, AMX::Kernels8::PrepareBQuantizedTransposed, AVX512BW::Kernels8::PrepareBQuantizedTransposed, AVX512BW::Kernels8::PrepareBQuantizedTransposed, AVX2::Kernels8::PrepareBQuantizedTransposed, AVX2::Kernels8::PrepareBQuantizedTransposed, SSSE3::Kernels8::PrepareBQuantizedTransposed, Unsupported_8bit::PrepareBQuantizedTransposed, Unsupported_8bit::PrepareBQuantizedTransposed)));
+
+INTGEMM_LAZY_DISPATCH(Int8::PrepareBTransposed, INTGEMM_INSTRUMENT_DISPATCH(Event::PrepareB, "Int8::PrepareBTransposed", &Int8::kName, ChooseCPU(SSSE3::Kernels8::PrepareBTransposed, NEON::Kernels8::PrepareBTransposed, NEON::Kernels8::PrepareBTransposed, AMX::Kernels8::PrepareBTransposed, AVX512BW::Kernels8::PrepareBTransposed, AVX512BW::Kernels8::PrepareBTransposed, AVX2::Kernels8::PrepareBTransposed, AVX2::Kernels8::PrepareBTransposed, SSSE3::Kernels8::PrepareBTransposed, Unsupported_8bit::PrepareBTransposed, Unsupported_8bit::PrepareBTransposed)));
+
+INTGEMM_LAZY_DISPATCH(Int8::SelectColumnsB, ChooseCPU(SSSE3::Kernels8::SelectColumnsB, NEON::Kernels8::SelectColumnsB, NEON::Kernels8::SelectColumnsB, AMX::Kernels8::SelectColumnsB, AVX512VNNI::Kernels8::SelectColumnsB, AVX512BW::Kernels8::SelectColumnsB, AVX2::Kernels8::SelectColumnsB, AVX2::Kernels8::SelectColumnsB, SSSE3::Kernels8::SelectColumnsB, Unsupported_8bit::SelectColumnsB, Unsupported_8bit::SelectColumnsB));
+
+const char *const Int8::kName = ChooseCPU(SIMD128::Kernels8::kName, NEONDOTPROD::Kernels8::kName, NEON::Kernels8::kName, AMX::Kernels8::kName, AVX512VNNI::Kernels8::kName, AVX512BW::Kernels8::kName, AVXVNNI::Kernels8::kName, AVX2::Kernels8::kName, SSSE3::Kernels8::kName, Unsupported_8bit::kName, Unsupported_8bit::kName);
+
+INTGEMM_LAZY_DISPATCH(Int8Shift::QuantizeU, INTGEMM_INSTRUMENT_DISPATCH(Event::Quantize, "Int8Shift::QuantizeU", &Int8Shift::kName, ChooseCPU(SSSE3::Kernels8::QuantizeU, NEON::Kernels8::QuantizeU, NEON::Kernels8::QuantizeU, AVX512VNNI::Kernels8::QuantizeU, AVX512VNNI::Kernels8::QuantizeU, AVX512BW::Kernels8::QuantizeU, AVX2::Kernels8::QuantizeU, AVX2::Kernels8::QuantizeU, SSSE3::Kernels8::QuantizeU, Unsupported_8bit::QuantizeU, Unsupported_8bit::QuantizeU)));
+
+void Int8Shift::PrepareB(const float *input, int8_t *output, float quant_mult, Index rows, Index cols, ShiftedBias &bias) {
+  // PrepareBias adds each column's sum into totals.  Floats hold the sums
+  // exactly while rows is under 2^24 / 127.
+  AlignedVector<float> totals(cols);
+  std::fill(totals.begin(), totals.end(), 0.0f);
+  auto add_sums = callbacks::UnquantizeAndAddBiasAndWrite(1.0f, totals.begin(), totals.begin());
+  // A multiple of tile_info.b_rows.  256 rows of 4096 columns fit in L2.
+  const Index kBlockRows = 256;
+  if (rows <= kBlockRows) {
+    Int8::PrepareB(input, output, quant_mult, rows, cols);
+    PrepareBias(output, rows, cols, add_sums);
+  } else {
+    // Sum each block of rows prepared on its own, see PrepareBRowsWith,
+    // before copying it into place.
+    for (Index begin = 0; begin < rows; begin += kBlockRows) {
+      const Index chunk = std::min(rows - begin, kBlockRows);
+      int8_t *prepared = ThreadBlockBuffer<int8_t>(static_cast<std::size_t>(kBlockRows) * cols);
+      Int8::PrepareB(input + static_cast<std::size_t>(begin) * cols, prepared, quant_mult, chunk, cols);
+      PrepareBias(prepared, chunk, cols, add_sums);
+      CopyPreparedRows(prepared, output, rows, cols, begin, begin + chunk);
+    }
+  }
+  bias.sums.assign(totals.begin(), totals.end());
+}
+
+const char *const Int8Shift::kName = ChooseCPU(SIMD128::Kernels8::kName, NEONDOTPROD::Kernels8::kName, NEON::Kernels8::kName, AMX::Kernels8::kName, AVX512VNNI::Kernels8::kName, AVX512BW::Kernels8::kName, AVXVNNI::Kernels8::kName, AVX2::Kernels8::kName, SSSE3::Kernels8::kName, Unsupported_8bit::kName, Unsupported_8bit::kName);
+
+namespace {
+// 8-bit PrepareB for the MultiplyStrip kernels, which AMX does not use, and
+// their register width in bytes.  Int4 and SparseB start from this layout.
+extern void (*PrepareBRegisters)(const float *input, int8_t *output, float quant_mult, Index rows, Index cols);
+INTGEMM_LAZY_DISPATCH(PrepareBRegisters, ChooseCPU(SSSE3::Kernels8::PrepareB, NEON::Kernels8::PrepareB, NEON::Kernels8::PrepareB, AVX512VNNI::Kernels8::PrepareB, AVX512VNNI::Kernels8::PrepareB, AVX512BW::Kernels8::PrepareB, AVX2::Kernels8::PrepareB, AVX2::Kernels8::PrepareB, SSSE3::Kernels8::PrepareB, Unsupported_8bit::PrepareB, Unsupported_8bit::PrepareB));
+const Index kRegisterBytes = ChooseCPU(16, 16, 16, 64, 64, 64, 32, 32, 16, 0, 0);
+} // namespace
+
+void Int4::PrepareB(const float *input, int8_t *output, float quant_mult, Index rows, Index cols) {
+  const std::size_t size = static_cast<std::size_t>(rows) * cols;
+  AlignedVector<float> clamped(size);
+  for (std::size_t i = 0; i < size; ++i) {
+    clamped[i] = std::max(-7.0f, std::min(7.0f, input[i] * quant_mult));
+  }
+  AlignedVector<int8_t> prepared(size);
+  PrepareBRegisters(clamped.begin(), prepared.begin(), 1.0f, rows, cols);
+  // Each step of a strip is 8 registers.  Registers 2j and 2j + 1 become the
+  // low and high nibbles of packed register j, see INTGEMM_MULTIPLY_BLOCKED_INT4.
+  const Index bytes = kRegisterBytes;
+  for (std::size_t step = 0; step < size; step += 8 * bytes) {
+    const int8_t *from = prepared.begin() + step;
+    int8_t *to = output + step / 2;
+    for (Index j = 0; j < 4; ++j) {
+      for (Index b = 0; b < bytes; ++b) {
+        const uint8_t low = static_cast<uint8_t>(from[2 * j * bytes + b]) & 0xf;
+        const uint8_t high = static_cast<uint8_t>(from[(2 * j + 1) * bytes + b]) << 4;
+        to[j * bytes + b] = static_cast<int8_t>(low | high);
+      }
+    }
+  }
+}
 
-void (*Int8::QuantizeU)(const float *input, uint8_t *output, float quant_mult, Index size) = ChooseCPU(AVX512VNNI::Kernels8::QuantizeU, AVX512BW::Kernels8::QuantizeU, AVX2::Kernels8::QuantizeU, SSSE3::Kernels8::QuantizeU, Unsupported_8bit::QuantizeU, Unsupported_8bit::QuantizeU);
+void Int8::PrepareBSparse(const float *input, SparseB &output, float quant_mult, Index rows, Index cols) {
+  const Index tile_rows = kRegisterBytes;
+  if (!tile_rows) UnsupportedCPUError();
+  AlignedVector<int8_t> prepared(static_cast<std::size_t>(rows) * cols);
+  PrepareBRegisters(input, prepared.begin(), quant_mult, rows, cols);
+  const std::size_t tile_bytes = 8 * tile_rows;
+  const Index steps = rows / tile_rows;
+  std::vector<int> keep(static_cast<std::size_t>(steps) * (cols / 8));
+  std::size_t kept = 0;
+  for (std::size_t t = 0; t < keep.size(); ++t) {
+    const int8_t *tile = prepared.begin() + t * tile_bytes;
+    keep[t] = std::any_of(tile, tile + tile_bytes, [](int8_t value) { return value != 0; });
+    kept += keep[t];
+  }
 
-void (*Int8::PrepareB)(const float *input, int8_t *output, float quant_mult, Index rows, Index cols) = ChooseCPU(AVX512VNNI::Kernels8::PrepareB, AVX512BW::Kernels8::PrepareB, AVX2::Kernels8::PrepareB, SSSE3::Kernels8::PrepareB, Unsupported_8bit::PrepareB, Unsupported_8bit::PrepareB);
+  output.rows = rows;
+  output.cols = cols;
+  output.tile_rows = tile_rows;
+  output.tiles = AlignedVector<int8_t>(kept * tile_bytes);
+  output.strip_runs.assign(1, 0);
+  output.strip_tiles.assign(1, 0);
+  output.run_begin.clear();
+  output.run_length.clear();
+  int8_t *to = output.tiles.begin();
+  for (Index strip = 0; strip < cols / 8; ++strip) {
+    const int *keep_strip = keep.data() + static_cast<std::size_t>(strip) * steps;
+    Index tiles = 0;
+    for (Index k = 0; k < steps; ++k) {
+      if (!keep_strip[k]) continue;
+      if (k && keep_strip[k - 1]) {
+        ++output.run_length.back();
+      } else {
+        output.run_begin.push_back(k);
+        output.run_length.push_back(1);
+      }
+      std::memcpy(to, prepared.begin() + (static_cast<std::size_t>(strip) * steps + k) * tile_bytes, tile_bytes);
+      to += tile_bytes;
+      ++tiles;
+    }
+    output.strip_runs.push_back(static_cast<Index>(output.run_begin.size()));
+    output.strip_tiles.push_back(output.strip_tiles.back() + tiles);
+  }
+}
 
-void (*Int8::PrepareBQuantizedTransposed)(const int8_t *input, int8_t *output, Index inner, Index B_untransposed_cols) = ChooseCPU(AVX512BW::Kernels8::PrepareBQuantizedTransposed, AVX512BW::Kernels8::PrepareBQuantizedTransposed, AVX2::Kernels8::PrepareBQuantizedTransposed, SSSE3::Kernels8::PrepareBQuantizedTransposed, Unsupported_8bit::PrepareBQuantizedTransposed, Unsupported_8bit::PrepareBQuantizedTransposed);
+void Int8::PrepareBAppendColumns(const float *input, AppendableB &B, float quant_mult, Index count) {
+  const Index bytes = kRegisterBytes;
+  if (!bytes) UnsupportedCPUError();
+  if (B.cols + count > B.capacity) B.Reserve(std::max(B.cols + count, 2 * B.capacity));
+  AlignedVector<int8_t> quantized(static_cast<std::size_t>(count) * B.rows);
+  Quantize(input, quantized.begin(), quant_mult, count * B.rows);
+  // In a strip, step k holds register k of each of its 8 columns in turn;
+  // see PrepareBQuantizedTransposed.
+  for (Index i = 0; i < count; ++i, ++B.cols) {
+    int8_t *strip = B.data.begin() + static_cast<std::size_t>(B.cols / 8) * 8 * B.rows;
+    const int8_t *from = quantized.begin() + static_cast<std::size_t>(i) * B.rows;
+    for (Index k = 0; k < B.rows / bytes; ++k) {
+      std::memcpy(strip + (k * 8 + B.cols % 8) * bytes, from + k * bytes, bytes);
+    }
+  }
+}
 
-void (*Int8::PrepareBTransposed)(const float *input, int8_t *output, float quant_mult, Index inner, Index B_untransposed_cols) = ChooseCPU(AVX512BW::Kernels8::PrepareBTransposed, AVX512BW::Kernels8::PrepareBTransposed, AVX2::Kernels8::PrepareBTransposed, SSSE3::Kernels8::PrepareBTransposed, Unsupported_8bit::PrepareBTransposed, Unsupported_8bit::PrepareBTransposed);
+namespace {
 
-void (*Int8::SelectColumnsB)(const int8_t *input, int8_t *output, Index rows, const Index *cols_begin, const Index *cols_end) = ChooseCPU(AVX512VNNI::Kernels8::SelectColumnsB, AVX512BW::Kernels8::SelectColumnsB, AVX2::Kernels8::SelectColumnsB, SSSE3::Kernels8::SelectColumnsB, Unsupported_8bit::SelectColumnsB, Unsupported_8bit::SelectColumnsB);
+// Int8::Multiply's kernel with the register blockings to try, which all
+// compute the same C.  With GetTuneAcrossKernels, also the other kernels that
+// read B as Int8::PrepareB lays it out on this CPU; those that sum in 16 bits
+// saturate where the VNNI and dot product kernels do not.  AMX has its own
+// blocking.
+std::vector<TuneChoice> TuneCandidates() {
+  const bool across = GetTuneAcrossKernels();
+  const CPUType cpu = GetCPUID();
+  std::vector<CPUType> tiers;
+#if defined(INTGEMM_COMPILER_SUPPORTS_NEON)
+  if (cpu == CPUType::NEONDOTPROD) tiers.push_back(CPUType::NEONDOTPROD);
+  if (cpu == CPUType::NEON || across) tiers.push_back(CPUType::NEON);
+#elif defined(WASM)
+  if (cpu == CPUType::SIMD128) tiers.push_back(CPUType::SIMD128);
+  if (cpu == CPUType::SSSE3 || across) tiers.push_back(CPUType::SSSE3);
+#else
+  if (cpu == CPUType::AMX) return std::vector<TuneChoice>(1, TuneChoice{CPUType::AMX, 0});
+  if (cpu >= CPUType::SSSE3) tiers.push_back(cpu);
+  if (across) {
+    if (cpu == CPUType::AVX512VNNI) {
+      tiers.push_back(CPUType::AVX512BW);
+    } else if (cpu == CPUType::AVX2 && AVXVNNIAvailable()) {
+      tiers.push_back(CPUType::AVXVNNI);
+    } else if (cpu == CPUType::AVXVNNI) {
+      tiers.push_back(CPUType::AVX2);
+    }
+  }
+#endif
+  const Index kRows[] = {1, 2, 4};
+  std::vector<TuneChoice> ret;
+  for (CPUType tier : tiers) {
+    for (Index rows : kRows) ret.push_back(TuneChoice{tier, rows});
+  }
+  return ret;
+}
 
-const char *const Int8::kName = ChooseCPU(AVX512VNNI::Kernels8::kName, AVX512BW::Kernels8::kName, AVX2::Kernels8::kName, SSSE3::Kernels8::kName, Unsupported_8bit::kName, Unsupported_8bit::kName);
+} // namespace
 
-void (*Int8Shift::QuantizeU)(const float *input, uint8_t *output, float quant_mult, Index size) = ChooseCPU(AVX512VNNI::Kernels8::QuantizeU, AVX512BW::Kernels8::QuantizeU, AVX2::Kernels8::QuantizeU, SSSE3::Kernels8::QuantizeU, Unsupported_8bit::QuantizeU, Unsupported_8bit::QuantizeU);
+TuneChoice Int8::Tune(Index A_rows, Index width, Index B_cols) {
+  const TuneShape shape = {A_rows, width, B_cols};
+  TuneChoice best;
+  // A file tuned with GetTuneAcrossKernels may name another kernel.
+  if (TuneCache::Global().Find("Int8", shape, best) && (best.cpu == GetCPUID() || GetTuneAcrossKernels())) return best;
+  const std::vector<TuneChoice> candidates = TuneCandidates();
+  if (candidates.empty()) UnsupportedCPUError();
+  best = candidates.front();
+  if (candidates.size() > 1) {
+    // Time a scratch multiply so the caller's callback never runs twice.
+    AlignedVector<int8_t> A(A_rows * width), B(width * B_cols);
+    for (std::size_t i = 0; i < A.size(); ++i) A[i] = static_cast<int8_t>(i % 255 - 127);
+    for (std::size_t i = 0; i < B.size(); ++i) B[i] = static_cast<int8_t>(i * 7 % 255 - 127);
+    AlignedVector<int32_t> C(A_rows * B_cols);
+    const int kTries = 3;
+    double best_time = 0.0;
+    for (const TuneChoice &candidate : candidates) {
+      auto multiply = MultiplyTunedImpl<callbacks::Write<int32_t>>::Get(candidate);
+      // Burn in, then keep the fastest of a few runs.
+      multiply(A.begin(), B.begin(), A_rows, width, B_cols, callbacks::Write<int32_t>(C.begin()));
+      double fastest = 0.0;
+      for (int t = 0; t < kTries; ++t) {
+        auto start = std::chrono::steady_clock::now();
+        multiply(A.begin(), B.begin(), A_rows, width, B_cols, callbacks::Write<int32_t>(C.begin()));
+        double took = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (!t || took < fastest) fastest = took;
+      }
+      if (&candidate == &candidates.front() || fastest < best_time) {
+        best_time = fastest;
+        best = candidate;
+      }
+    }
+  }
+  TuneCache::Global().Insert("Int8", shape, best);
+  return best;
+}
 
-const char *const Int8Shift::kName = ChooseCPU(AVX512VNNI::Kernels8::kName, AVX512BW::Kernels8::kName, AVX2::Kernels8::kName, SSSE3::Kernels8::kName, Unsupported_8bit::kName, Unsupported_8bit::kName);
+void Int8::TuneWarmup(const std::vector<TuneShape> &shapes) {
+  for (const TuneShape &shape : shapes) Tune(shape.A_rows, shape.width, shape.B_cols);
+}
 
+const char *const Int4::kName = ChooseCPU(SIMD128::Kernels8::kName, NEONDOTPROD::Kernels8::kName, NEON::Kernels8::kName, AVX512VNNI::Kernels8::kName, AVX512VNNI::Kernels8::kName, AVX512BW::Kernels8::kName, AVXVNNI::Kernels8::kName, AVX2::Kernels8::kName, SSSE3::Kernels8::kName, Unsupported_8bit::kName, Unsupported_8bit::kName);
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+namespace SSE2 {
+using NEON::MaxAbsolute;
+using NEON::VectorMeanStd;
+using NEON::HistogramAbsolute;
+using NEON::Exp;
+using NEON::Sigmoid;
+using NEON::Tanh;
+using NEON::Relu;
+using NEON::Silu;
+using NEON::Gelu;
+using NEON::Upcast8to16;
+using NEON::Downcast16to8;
+using NEON::FinishSoftmaxRows;
+using NEON::GatherRows;
+using NEON::ConvertToFloat;
+} // namespace SSE2
+#else
+namespace NEON {
+using SSE2::MaxAbsolute;
+using SSE2::VectorMeanStd;
+using SSE2::HistogramAbsolute;
+using SSE2::Exp;
+using SSE2::Sigmoid;
+using SSE2::Tanh;
+using SSE2::Relu;
+using SSE2::Silu;
+using SSE2::Gelu;
+using SSE2::Upcast8to16;
+using SSE2::Downcast16to8;
+using SSE2::FinishSoftmaxRows;
+using SSE2::GatherRows;
+using SSE2::ConvertToFloat;
+} // namespace NEON
+#endif
 #if !defined(INTGEMM_COMPILER_SUPPORTS_AVX2)
 namespace AVX2{
 using SSE2::MaxAbsolute;
 using SSE2::VectorMeanStd;
+using SSE2::HistogramAbsolute;
+using SSE2::Exp;
+using SSE2::Sigmoid;
+using SSE2::Tanh;
+using SSE2::Relu;
+using SSE2::Silu;
+using SSE2::Gelu;
+using SSE2::Upcast8to16;
+using SSE2::Downcast16to8;
+using SSE2::FinishSoftmaxRows;
+using SSE2::GatherRows;
+using SSE2::ConvertToFloat;
 } // namespace AVX2
 #endif
 #if !defined(INTGEMM_COMPILER_SUPPORTS_AVX512BW)
 namespace AVX512BW {
 using AVX2::MaxAbsolute;
 using AVX2::VectorMeanStd;
+using AVX2::HistogramAbsolute;
+using AVX2::Exp;
+using AVX2::Sigmoid;
+using AVX2::Tanh;
+using AVX2::Relu;
+using AVX2::Silu;
+using AVX2::Gelu;
+using AVX2::Upcast8to16;
+using AVX2::Downcast16to8;
+using AVX2::FinishSoftmaxRows;
+using AVX2::GatherRows;
+using AVX2::ConvertToFloat;
 } // namespace AVX512BW
 #endif
 
-float (*MaxAbsolute)(const float *begin, const float *end) = ChooseCPU(AVX512BW::MaxAbsolute, AVX512BW::MaxAbsolute, AVX2::MaxAbsolute, SSE2::MaxAbsolute, SSE2::MaxAbsolute, Unsupported_MaxAbsolute);
+INTGEMM_LAZY_DISPATCH(MaxAbsolute, ChooseCPU(SSE2::MaxAbsolute, NEON::MaxAbsolute, NEON::MaxAbsolute, AVX512BW::MaxAbsolute, AVX512BW::MaxAbsolute, AVX512BW::MaxAbsolute, AVX2::MaxAbsolute, AVX2::MaxAbsolute, SSE2::MaxAbsolute, SSE2::MaxAbsolute, Unsupported_MaxAbsolute));
+
+INTGEMM_LAZY_DISPATCH(VectorMeanStd, ChooseCPU(SSE2::VectorMeanStd, NEON::VectorMeanStd, NEON::VectorMeanStd, AVX512BW::VectorMeanStd, AVX512BW::VectorMeanStd, AVX512BW::VectorMeanStd, AVX2::VectorMeanStd, AVX2::VectorMeanStd, SSE2::VectorMeanStd, SSE2::VectorMeanStd, Unsupported_VectorMeanStd));
+
+INTGEMM_LAZY_DISPATCH(HistogramAbsolute, ChooseCPU(SSE2::HistogramAbsolute, NEON::HistogramAbsolute, NEON::HistogramAbsolute, AVX512BW::HistogramAbsolute, AVX512BW::HistogramAbsolute, AVX512BW::HistogramAbsolute, AVX2::HistogramAbsolute, AVX2::HistogramAbsolute, SSE2::HistogramAbsolute, SSE2::HistogramAbsolute, Unsupported_HistogramAbsolute));
+
+INTGEMM_LAZY_DISPATCH(Exp, ChooseCPU(SSE2::Exp, NEON::Exp, NEON::Exp, AVX512BW::Exp, AVX512BW::Exp, AVX512BW::Exp, AVX2::Exp, AVX2::Exp, SSE2::Exp, SSE2::Exp, Unsupported_Elementwise<float, float>));
+
+INTGEMM_LAZY_DISPATCH(Sigmoid, ChooseCPU(SSE2::Sigmoid, NEON::Sigmoid, NEON::Sigmoid, AVX512BW::Sigmoid, AVX512BW::Sigmoid, AVX512BW::Sigmoid, AVX2::Sigmoid, AVX2::Sigmoid, SSE2::Sigmoid, SSE2::Sigmoid, Unsupported_Elementwise<float, float>));
+
+INTGEMM_LAZY_DISPATCH(Tanh, ChooseCPU(SSE2::Tanh, NEON::Tanh, NEON::Tanh, AVX512BW::Tanh, AVX512BW::Tanh, AVX512BW::Tanh, AVX2::Tanh, AVX2::Tanh, SSE2::Tanh, SSE2::Tanh, Unsupported_Elementwise<float, float>));
+
+INTGEMM_LAZY_DISPATCH(Relu, ChooseCPU(SSE2::Relu, NEON::Relu, NEON::Relu, AVX512BW::Relu, AVX512BW::Relu, AVX512BW::Relu, AVX2::Relu, AVX2::Relu, SSE2::Relu, SSE2::Relu, Unsupported_Elementwise<float, float>));
 
-MeanStd (*VectorMeanStd)(const float *begin, const float *end, bool absolute) = ChooseCPU(AVX512BW::VectorMeanStd, AVX512BW::VectorMeanStd, AVX2::VectorMeanStd, SSE2::VectorMeanStd, SSE2::VectorMeanStd, Unsupported_VectorMeanStd);
+INTGEMM_LAZY_DISPATCH(Silu, ChooseCPU(SSE2::Silu, NEON::Silu, NEON::Silu, AVX512BW::Silu, AVX512BW::Silu, AVX512BW::Silu, AVX2::Silu, AVX2::Silu, SSE2::Silu, SSE2::Silu, Unsupported_Elementwise<float, float>));
+
+INTGEMM_LAZY_DISPATCH(Gelu, ChooseCPU(SSE2::Gelu, NEON::Gelu, NEON::Gelu, AVX512BW::Gelu, AVX512BW::Gelu, AVX512BW::Gelu, AVX2::Gelu, AVX2::Gelu, SSE2::Gelu, SSE2::Gelu, Unsupported_Elementwise<float, float>));
+
+INTGEMM_LAZY_DISPATCH(Upcast8to16, ChooseCPU(SSE2::Upcast8to16, NEON::Upcast8to16, NEON::Upcast8to16, AVX512BW::Upcast8to16, AVX512BW::Upcast8to16, AVX512BW::Upcast8to16, AVX2::Upcast8to16, AVX2::Upcast8to16, SSE2::Upcast8to16, SSE2::Upcast8to16, Unsupported_Elementwise<int8_t, int16_t>));
+
+INTGEMM_LAZY_DISPATCH(Downcast16to8, ChooseCPU(SSE2::Downcast16to8, NEON::Downcast16to8, NEON::Downcast16to8, AVX512BW::Downcast16to8, AVX512BW::Downcast16to8, AVX512BW::Downcast16to8, AVX2::Downcast16to8, AVX2::Downcast16to8, SSE2::Downcast16to8, SSE2::Downcast16to8, Unsupported_Elementwise<int16_t, int8_t>));
+
+namespace {
+template <class Float16> void Unsupported_ConvertToFloat(const Float16 * /*input*/, float * /*output*/, Index /*size*/) {
+  UnsupportedCPUError();
+}
+
+extern void (*ConvertBFloat16)(const BFloat16 *input, float *output, Index size);
+INTGEMM_LAZY_DISPATCH(ConvertBFloat16, ChooseCPU(SSE2::ConvertToFloat<BFloat16>, NEON::ConvertToFloat<BFloat16>, NEON::ConvertToFloat<BFloat16>, AVX512BW::ConvertToFloat<BFloat16>, AVX512BW::ConvertToFloat<BFloat16>, AVX512BW::ConvertToFloat<BFloat16>, AVX2::ConvertToFloat<BFloat16>, AVX2::ConvertToFloat<BFloat16>, SSE2::ConvertToFloat<BFloat16>, SSE2::ConvertToFloat<BFloat16>, Unsupported_ConvertToFloat<BFloat16>));
+
+extern void (*ConvertHalf)(const Half *input, float *output, Index size);
+INTGEMM_LAZY_DISPATCH(ConvertHalf, ChooseCPU(SSE2::ConvertToFloat<Half>, NEON::ConvertToFloat<Half>, NEON::ConvertToFloat<Half>, AVX512BW::ConvertToFloat<Half>, AVX512BW::ConvertToFloat<Half>, AVX512BW::ConvertToFloat<Half>, AVX2::ConvertToFloat<Half>, AVX2::ConvertToFloat<Half>, SSE2::ConvertToFloat<Half>, SSE2::ConvertToFloat<Half>, Unsupported_ConvertToFloat<Half>));
+
+// Quantize a block at a time through floats that stay in cache.  Blocks
+// keep output aligned and all but the last have a multiple of any
+// quantizer's registers.
+template <class Float16, class Integer> void QuantizeFloat16With(void (*convert)(const Float16 *, float *, Index), void (*quantize)(const float *, Integer *, float, Index), const Float16 *input, Integer *output, float quant_mult, Index size) {
+  const Index kBlock = 2048;
+  alignas(64) float buffer[kBlock];
+  for (Index i = 0; i < size; i += kBlock) {
+    const Index block = std::min(kBlock, size - i);
+    convert(input + i, buffer, block);
+    quantize(buffer, output + i, quant_mult, block);
+  }
+}
+
+template <class Float16> void PrepareBFloat16With(void (*convert)(const Float16 *, float *, Index), const Float16 *input, int8_t *output, float quant_mult, Index rows, Index cols) {
+  Int8::PrepareBStream([convert, input, cols](float *to, Index row_begin, Index row_end) {
+    convert(input + static_cast<std::size_t>(row_begin) * cols, to, (row_end - row_begin) * cols);
+  }, output, quant_mult, rows, cols, Int8::tile_info.b_rows);
+}
+} // namespace
+
+void Int8::QuantizeFloat16(const BFloat16 *input, int8_t *output, float quant_mult, Index size) {
+  QuantizeFloat16With(ConvertBFloat16, Quantize, input, output, quant_mult, size);
+}
+
+void Int8::QuantizeFloat16(const Half *input, int8_t *output, float quant_mult, Index size) {
+  QuantizeFloat16With(ConvertHalf, Quantize, input, output, quant_mult, size);
+}
+
+void Int8::QuantizeUFloat16(const BFloat16 *input, uint8_t *output, float quant_mult, Index size) {
+  QuantizeFloat16With(ConvertBFloat16, QuantizeU, input, output, quant_mult, size);
+}
+
+void Int8::QuantizeUFloat16(const Half *input, uint8_t *output, float quant_mult, Index size) {
+  QuantizeFloat16With(ConvertHalf, QuantizeU, input, output, quant_mult, size);
+}
+
+void Int8::PrepareBFloat16(const BFloat16 *input, int8_t *output, float quant_mult, Index rows, Index cols) {
+  PrepareBFloat16With(ConvertBFloat16, input, output, quant_mult, rows, cols);
+}
+
+void Int8::PrepareBFloat16(const Half *input, int8_t *output, float quant_mult, Index rows, Index cols) {
+  PrepareBFloat16With(ConvertHalf, input, output, quant_mult, rows, cols);
+}
+
+namespace {
+template <class Output> void Unsupported_GatherRows(const int8_t * /*table*/, Index /*width*/, Index /*group*/, const Index * /*ids_begin*/, const Index * /*ids_end*/, const float * /*scales*/, Index /*scale_stride*/, float /*mult*/, Output * /*output*/) {
+  UnsupportedCPUError();
+}
+
+extern void (*GatherRowsFloat)(const int8_t *table, Index width, Index group, const Index *ids_begin, const Index *ids_end, const float *scales, Index scale_stride, float mult, float *output);
+INTGEMM_LAZY_DISPATCH(GatherRowsFloat, ChooseCPU(SSE2::GatherRows<float>, NEON::GatherRows<float>, NEON::GatherRows<float>, AVX512BW::GatherRows<float>, AVX512BW::GatherRows<float>, AVX512BW::GatherRows<float>, AVX2::GatherRows<float>, AVX2::GatherRows<float>, SSE2::GatherRows<float>, SSE2::GatherRows<float>, Unsupported_GatherRows<float>));
+extern void (*GatherRowsInt8)(const int8_t *table, Index width, Index group, const Index *ids_begin, const Index *ids_end, const float *scales, Index scale_stride, float mult, int8_t *output);
+INTGEMM_LAZY_DISPATCH(GatherRowsInt8, ChooseCPU(SSE2::GatherRows<int8_t>, NEON::GatherRows<int8_t>, NEON::GatherRows<int8_t>, AVX512BW::GatherRows<int8_t>, AVX512BW::GatherRows<int8_t>, AVX512BW::GatherRows<int8_t>, AVX2::GatherRows<int8_t>, AVX2::GatherRows<int8_t>, SSE2::GatherRows<int8_t>, SSE2::GatherRows<int8_t>, Unsupported_GatherRows<int8_t>));
+
+// Group of B prepared on this CPU for Int8.
+Index Int8Group() {
+  const Index group = PreparedBGroup(GetCPUID(), 1);
+  if (!group) UnsupportedCPUError();
+  return group;
+}
+} // namespace
+
+void Int8::GatherRowsUnquantize(const int8_t *table, Index width, const Index *ids_begin, const Index *ids_end, float unquant_mult, float *output) {
+  GatherRowsFloat(table, width, 0, ids_begin, ids_end, &unquant_mult, 0, 1.0f, output);
+}
+
+void Int8::GatherRowsUnquantize(const int8_t *table, Index width, const Index *ids_begin, const Index *ids_end, const float *row_unquant_mult, float *output) {
+  GatherRowsFloat(table, width, 0, ids_begin, ids_end, row_unquant_mult, 1, 1.0f, output);
+}
+
+void Int8::GatherRowsQuantize(const int8_t *table, Index width, const Index *ids_begin, const Index *ids_end, float unquant_mult, float quant_mult, int8_t *output) {
+  GatherRowsInt8(table, width, 0, ids_begin, ids_end, &unquant_mult, 0, quant_mult, output);
+}
+
+void Int8::GatherPreparedBUnquantize(const int8_t *prepared_B, Index rows, const Index *cols_begin, const Index *cols_end, float unquant_mult, float *output) {
+  GatherRowsFloat(prepared_B, rows, Int8Group(), cols_begin, cols_end, &unquant_mult, 0, 1.0f, output);
+}
+
+void Int8::GatherPreparedBUnquantize(const int8_t *prepared_B, Index rows, const Index *cols_begin, const Index *cols_end, const float *col_unquant_mult, float *output) {
+  GatherRowsFloat(prepared_B, rows, Int8Group(), cols_begin, cols_end, col_unquant_mult, 1, 1.0f, output);
+}
+
+void Int8::GatherPreparedBQuantize(const int8_t *prepared_B, Index rows, const Index *cols_begin, const Index *cols_end, float unquant_mult, float quant_mult, int8_t *output) {
+  GatherRowsInt8(prepared_B, rows, Int8Group(), cols_begin, cols_end, &unquant_mult, 0, quant_mult, output);
+}
+
+namespace {
+void Unsupported_FinishSoftmaxRows(float * /*C*/, const float * /*tile_stats*/, Index /*cols*/, Index /*row_begin*/, Index /*row_end*/, bool /*log_softmax*/) {
+  UnsupportedCPUError();
+}
+
+extern void (*FinishSoftmaxRows)(float *C, const float *tile_stats, Index cols, Index row_begin, Index row_end, bool log_softmax);
+INTGEMM_LAZY_DISPATCH(FinishSoftmaxRows, ChooseCPU(SSE2::FinishSoftmaxRows, NEON::FinishSoftmaxRows, NEON::FinishSoftmaxRows, AVX512BW::FinishSoftmaxRows, AVX512BW::FinishSoftmaxRows, AVX512BW::FinishSoftmaxRows, AVX2::FinishSoftmaxRows, AVX2::FinishSoftmaxRows, SSE2::FinishSoftmaxRows, SSE2::FinishSoftmaxRows, Unsupported_FinishSoftmaxRows));
+
+// Rows in OpenMP threads once C is long enough, like the elementwise functions.
+void FinishSoftmaxThreads(float *C, const float *tile_stats, Index rows, Index cols, bool log_softmax) {
+  const std::ptrdiff_t count = rows;
+#pragma omp parallel for num_threads(std::max<int>(1, std::min<int>(omp_get_max_threads(), static_cast<std::size_t>(rows) * cols / kElementwiseGrain)))
+  for (std::ptrdiff_t r = 0; r < count; ++r) {
+    FinishSoftmaxRows(C, tile_stats, cols, static_cast<Index>(r), static_cast<Index>(r + 1), log_softmax);
+  }
+}
+} // namespace
+
+void FinishSoftmax(float *C, const float *tile_stats, Index rows, Index cols) {
+  FinishSoftmaxThreads(C, tile_stats, rows, cols, false);
+}
+
+void FinishSoftmax(float *C, const float *tile_stats, Index rows, Index cols, Executor &executor) {
+  executor.ParallelFor(rows, [C, tile_stats, cols](Index begin, Index end) {
+    FinishSoftmaxRows(C, tile_stats, cols, begin, end, false);
+  });
+}
+
+void FinishLogSoftmax(float *C, const float *tile_stats, Index rows, Index cols) {
+  FinishSoftmaxThreads(C, tile_stats, rows, cols, true);
+}
+
+void FinishLogSoftmax(float *C, const float *tile_stats, Index rows, Index cols, Executor &executor) {
+  executor.ParallelFor(rows, [C, tile_stats, cols](Index begin, Index end) {
+    FinishSoftmaxRows(C, tile_stats, cols, begin, end, true);
+  });
+}
+
+void LayerNorm(float *C, const double *row_stats, const float *gamma, const float *beta, Index rows, Index cols, float epsilon) {
+  for (Index r = 0; r < rows; ++r) {
+    const double mean = row_stats[2 * r] / cols;
+    const double variance = std::max(0.0, row_stats[2 * r + 1] / cols - mean * mean);
+    const float scale = static_cast<float>(1.0 / std::sqrt(variance + epsilon));
+    const float shift = static_cast<float>(-mean) * scale;
+    float *row = C + r * cols;
+    if (gamma && beta) {
+      for (Index c = 0; c < cols; ++c) row[c] = (row[c] * scale + shift) * gamma[c] + beta[c];
+    } else if (gamma) {
+      for (Index c = 0; c < cols; ++c) row[c] = (row[c] * scale + shift) * gamma[c];
+    } else if (beta) {
+      for (Index c = 0; c < cols; ++c) row[c] = row[c] * scale + shift + beta[c];
+    } else {
+      for (Index c = 0; c < cols; ++c) row[c] = row[c] * scale + shift;
+    }
+  }
+}
+
+constexpr TileInfo Int8::tile_info;
+constexpr TileInfo Int8Shift::tile_info;
+constexpr TileInfo Int4::tile_info;
+constexpr TileInfo Int16::tile_info;
+constexpr TileInfo Int16By8::tile_info;
 
 constexpr const char *const Unsupported_16bit::kName;
 constexpr const char *const Unsupported_8bit::kName;
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+constexpr const char *const NEON::Kernels8::kName;
+constexpr const char *const NEON::Kernels16::kName;
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON_DOTPROD
+constexpr const char *const NEONDOTPROD::Kernels8::kName;
+#endif
+#else
 constexpr const char *const SSE2::Kernels16::kName;
 constexpr const char *const SSSE3::Kernels8::kName;
+#ifdef WASM
+constexpr const char *const SIMD128::Kernels8::kName;
+#endif
+#endif
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 constexpr const char *const AVX2::Kernels8::kName;
 constexpr const char *const AVX2::Kernels16::kName;
 #endif
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVXVNNI
+constexpr const char *const AVXVNNI::Kernels8::kName;
+#endif
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
 constexpr const char *const AVX512BW::Kernels8::kName;
 constexpr const char *const AVX512BW::Kernels16::kName;
 #endif
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX512VNNI
 constexpr const char *const AVX512VNNI::Kernels8::kName;
+constexpr const char *const AVX512VNNI::Kernels16::kName;
+#endif
+#ifdef INTGEMM_COMPILER_SUPPORTS_AMX
+constexpr const char *const AMX::Kernels8::kName;
 #endif
 
 }
@@ -39,14 +39,32 @@
  * passing unquant_mult = \lambda / (A_quant_mult * B_quant_mult).
  */
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <vector>
 
 #include "types.h"
+#include "executor.h"
+#include "sparse_b.h"
+#include "appendable_b.h"
+#include "shifted_bias.h"
+#include "autotune.h"
+#include "workspace.h"
+#include "float16.h"
+#include "elementwise.h"
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+#include "neon_gemm.h"
+#else
 #include "sse2_gemm.h"
 #include "ssse3_gemm.h"
 #include "avx2_gemm.h"
+#include "avxvnni_gemm.h"
 #include "avx512_gemm.h"
 #include "avx512vnni_gemm.h"
+#include "amx_gemm.h"
+#include "wasm_gemm.h"
+#endif
 
 /* Dispatch to functions based on runtime CPUID.  This adds one call-by-variable to each call. */
 
@@ -55,6 +73,8 @@ namespace intgemm {
 void UnsupportedCPUError();
 
 struct Unsupported_16bit {
+  typedef int16_t Integer;
+
   static void Quantize(const float *, int16_t *, float, Index) {
     UnsupportedCPUError();
   }
@@ -74,16 +94,64 @@ struct Unsupported_16bit {
   static void Multiply(const int16_t *, const int16_t *, Index, Index, Index, Callback) {
     UnsupportedCPUError();
   }
+  template <typename Callback>
+  static void Multiply(const int16_t *, const int16_t *, Index, Index, Index, Callback, Executor &) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void Multiply(const int16_t *, const int16_t *, Index, Index, Index, Callback, Index, Index, Index, Index) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void Multiply(const int16_t *, Index, const int16_t *, Index, Index, Index, Callback) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void Multiply(const int16_t *, Index, const int16_t *, Index, Index, Index, Callback, Executor &) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void Multiply(const int16_t *, Index, const int16_t *, Index, Index, Index, Callback, Index, Index, Index, Index) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplyMixed(const int16_t *, const int8_t *, Index, Index, Index, Callback) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplyMixed(const int16_t *, const int8_t *, Index, Index, Index, Callback, Executor &) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplyMixed(const int16_t *, const int8_t *, Index, Index, Index, Callback, Index, Index, Index, Index) {
+    UnsupportedCPUError();
+  }
   constexpr static const char *const kName = "16-bit Unsupported";
 };
 
 struct Unsupported_8bit {
+  typedef int8_t Integer;
+
   static void Quantize(const float *, int8_t *, float, Index) {
     UnsupportedCPUError();
   }
   static void QuantizeU(const float *, uint8_t *, float, Index) {
     UnsupportedCPUError();
   }
+  static void QuantizeRows(const float *, int8_t *, float *, Index, Index) {
+    UnsupportedCPUError();
+  }
+  static void QuantizeRowsScaled(const float *, int8_t *, float *, Index, Index, ScaleStatistic, float) {
+    UnsupportedCPUError();
+  }
+  static float QuantizeScaled(const float *, int8_t *, Index, ScaleStatistic, float) {
+    UnsupportedCPUError();
+    return 0.0f;
+  }
+  static float QuantizeUScaled(const float *, uint8_t *, Index, ScaleStatistic, float) {
+    UnsupportedCPUError();
+    return 0.0f;
+  }
   static void PrepareA(const float *, int8_t *, float, Index, Index) {
     UnsupportedCPUError();
   }
@@ -107,20 +175,197 @@ struct Unsupported_8bit {
   static void Multiply(const int8_t *, const int8_t *, Index, Index, Index, Callback) {
     UnsupportedCPUError();
   }
+  template <typename Callback>
+  static void Multiply(const int8_t *, const int8_t *, Index, Index, Index, Callback, Executor &) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void Multiply(const int8_t *, const int8_t *, Index, Index, Index, Callback, Index, Index, Index, Index) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void Multiply(const int8_t *, Index, const int8_t *, Index, Index, Index, Callback) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void Multiply(const int8_t *, Index, const int8_t *, Index, Index, Index, Callback, Executor &) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void Multiply(const int8_t *, Index, const int8_t *, Index, Index, Index, Callback, Index, Index, Index, Index) {
+    UnsupportedCPUError();
+  }
+  template <Index kWidth, Index kBCols, typename Callback>
+  static void MultiplyFixed(const int8_t *, const int8_t *, Index, Callback) {
+    UnsupportedCPUError();
+  }
+  template <Index kRows, typename Callback>
+  static void MultiplyRows(const int8_t *, const int8_t *, Index, Index, Index, Callback) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplyBatched(const int8_t *const *, const int8_t *const *, Index, Index, Index, const Callback *, Index) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplyBatched(const int8_t *const *, const int8_t *const *, Index, Index, Index, const Callback *, Index, Executor &) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplyMulti(const int8_t *, const int8_t *const *, const Index *, Index, Index, const Callback *, Index) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplyMulti(const int8_t *, const int8_t *const *, const Index *, Index, Index, const Callback *, Index, Executor &) {
+    UnsupportedCPUError();
+  }
   template<class Callback>
   static void Multiply8Shift(const uint8_t *, const int8_t *, Index, Index, Index, Callback) {
     UnsupportedCPUError();
   }
+  template<class Callback>
+  static void Multiply8Shift(const uint8_t *, const int8_t *, Index, Index, Index, Callback, Executor &) {
+    UnsupportedCPUError();
+  }
+  template<class Callback>
+  static void Multiply8Shift(const uint8_t *, const int8_t *, Index, Index, Index, Callback, Index, Index, Index, Index) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplyFloatA(const float *, float, const int8_t *, Index, Index, Index, Callback) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplyFloatA(const float *, float, const int8_t *, Index, Index, Index, Callback, Executor &) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplyFloatA(const float *, float, const int8_t *, Index, Index, Index, Callback, Index, Index, Index, Index) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplyNT(const int8_t *, const int8_t *, Index, Index, Index, Callback) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplyNT(const int8_t *, const int8_t *, Index, Index, Index, Callback, Executor &) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplyNT(const int8_t *, const int8_t *, Index, Index, Index, Callback, Index, Index, Index, Index) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplySplitK(const int8_t *, const int8_t *, Index, Index, Index, Callback) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplySplitK(const int8_t *, const int8_t *, Index, Index, Index, Callback, Executor &) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplySlice(const int8_t *, const int8_t *, Index, Index, Index, Callback, Index, Index, Index, Index, Index, Index) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void ReducePartials(const int32_t *, Index, Index, Index, Callback, Index, Index, Index, Index) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplySparse(const int8_t *, const SparseB &, Index, Callback) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplySparse(const int8_t *, const SparseB &, Index, Callback, Executor &) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplySparse(const int8_t *, const SparseB &, Index, Callback, Index, Index, Index, Index) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplyColumns(const int8_t *, const int8_t *, Index, Index, const Index *, const Index *, Callback) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplyColumns(const int8_t *, const int8_t *, Index, Index, const Index *, const Index *, Callback, Executor &) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void MultiplyColumns(const int8_t *, const int8_t *, Index, Index, const Index *, const Index *, Callback, Index, Index, Index, Index) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void Multiply4(const int8_t *, const int8_t *, Index, Index, Index, Callback) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void Multiply4(const int8_t *, const int8_t *, Index, Index, Index, Callback, Executor &) {
+    UnsupportedCPUError();
+  }
+  template <typename Callback>
+  static void Multiply4(const int8_t *, const int8_t *, Index, Index, Index, Callback, Index, Index, Index, Index) {
+    UnsupportedCPUError();
+  }
+  template<class Callback>
+  static void Multiply8ShiftFloatA(const float *, float, const int8_t *, Index, Index, Index, Callback) {
+    UnsupportedCPUError();
+  }
+  template<class Callback>
+  static void Multiply8ShiftFloatA(const float *, float, const int8_t *, Index, Index, Index, Callback, Executor &) {
+    UnsupportedCPUError();
+  }
+  template<class Callback>
+  static void Multiply8ShiftFloatA(const float *, float, const int8_t *, Index, Index, Index, Callback, Index, Index, Index, Index) {
+    UnsupportedCPUError();
+  }
 
   constexpr static const char *const kName = "8-bit Unsupported";
 };
 
-#ifndef INTGEMM_COMPILER_SUPPORTS_AVX512VNNI
 // These won't ever be called in this capacity, but it does let the code below compile.
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+namespace SSSE3 {
+typedef Unsupported_8bit Kernels8;
+} // namespace SSSE3
+namespace SSE2 {
+typedef Unsupported_16bit Kernels16;
+} // namespace SSE2
+#ifndef INTGEMM_COMPILER_SUPPORTS_NEON_DOTPROD
+namespace NEONDOTPROD {
+typedef NEON::Kernels8 Kernels8;
+} // namespace NEONDOTPROD
+#endif
+#else
+namespace NEON {
+typedef Unsupported_8bit Kernels8;
+typedef Unsupported_16bit Kernels16;
+} // namespace NEON
+namespace NEONDOTPROD {
+typedef Unsupported_8bit Kernels8;
+} // namespace NEONDOTPROD
+#endif
+#ifndef WASM
+namespace SIMD128 {
+typedef Unsupported_8bit Kernels8;
+} // namespace SIMD128
+#endif
+#ifndef INTGEMM_COMPILER_SUPPORTS_AMX
+namespace AMX {
+typedef Unsupported_8bit Kernels8;
+} // namespace AMX
+#endif
+#ifndef INTGEMM_COMPILER_SUPPORTS_AVX512VNNI
 namespace AVX512VNNI {
 typedef Unsupported_8bit Kernels8;
+typedef Unsupported_16bit Kernels16;
 } // namespace AVX512VNNI
 #endif
+#ifndef INTGEMM_COMPILER_SUPPORTS_AVXVNNI
+namespace AVXVNNI {
+typedef Unsupported_8bit Kernels8;
+} // namespace AVXVNNI
+#endif
 #ifndef INTGEMM_COMPILER_SUPPORTS_AVX512BW
 namespace AVX512BW {
 typedef Unsupported_8bit Kernels8;
@@ -134,13 +379,25 @@ typedef Unsupported_16bit Kernels16;
 } // namespace AVX2
 #endif
 
-CPUType GetCPUID();
+// Whether AVXVNNI kernels can run here.  GetCPUID() reports AVX512 before
+// AVXVNNI, and plenty of AVX512 CPUs lack AVX-VNNI.
+bool AVXVNNIAvailable();
 
 /* Returns:
+ * wasm if this is a WebAssembly build (SIMD128 is required to load it)
+ *
+ * neondotprod if the CPU is aarch64 with the dot product instructions
+ *
+ * neon if the CPU is aarch64 without them
+ *
+ * amx if the CPU supports AMX-INT8 and the OS let us use it
+ *
  * axx512vnni if the CPU supports AVX512VNNI
  *
  * avx512bw if the CPU supports AVX512BW
  *
+ * avxvnni if the CPU supports AVX-VNNI but not AVX512BW
+ *
  * avx2 if the CPU supports AVX2
  *
  * ssse3 if the CPU supports SSSE3 (this distinction from SSE2 matters for 8-bit)
@@ -149,11 +406,65 @@ CPUType GetCPUID();
  *
  * unsupported otherwise
  */
-template <class T> T ChooseCPU(T avx512vnni, T avx512bw, T avx2, T ssse3, T sse2, T unsupported) {
-  const T ret[] = {unsupported, sse2, ssse3, avx2, avx512bw, avx512vnni};
+template <class T> T ChooseCPU(T wasm, T neondotprod, T neon, T amx, T avx512vnni, T avx512bw, T avxvnni, T avx2, T ssse3, T sse2, T unsupported) {
+  const T ret[] = {unsupported, sse2, ssse3, avx2, avxvnni, avx512bw, avx512vnni, amx, neon, neondotprod, wasm};
   return ret[(int)GetCPUID()];
 }
 
+// For functions without a WASM version: WebAssembly uses the emulated ssse3.
+template <class T> T ChooseCPU(T neondotprod, T neon, T amx, T avx512vnni, T avx512bw, T avxvnni, T avx2, T ssse3, T sse2, T unsupported) {
+  return ChooseCPU(ssse3, neondotprod, neon, amx, avx512vnni, avx512bw, avxvnni, avx2, ssse3, sse2, unsupported);
+}
+
+// x86 only: ARM CPUs are unsupported.
+template <class T> T ChooseCPU(T amx, T avx512vnni, T avx512bw, T avxvnni, T avx2, T ssse3, T sse2, T unsupported) {
+  return ChooseCPU(unsupported, unsupported, amx, avx512vnni, avx512bw, avxvnni, avx2, ssse3, sse2, unsupported);
+}
+// For functions without an AMX version: AMX CPUs use avx512vnni.
+template <class T> T ChooseCPU(T avx512vnni, T avx512bw, T avxvnni, T avx2, T ssse3, T sse2, T unsupported) {
+  return ChooseCPU(avx512vnni, avx512vnni, avx512bw, avxvnni, avx2, ssse3, sse2, unsupported);
+}
+
+// For functions without an AVXVNNI version: AVXVNNI CPUs use avx2.
+template <class T> T ChooseCPU(T avx512vnni, T avx512bw, T avx2, T ssse3, T sse2, T unsupported) {
+  return ChooseCPU(avx512vnni, avx512bw, avx2, avx2, ssse3, sse2, unsupported);
+}
+
+/* Each dispatch pointer is constant-initialized to a Resolve stub of its own
+ * type, so it can be called before any dynamic initialization, e.g. from
+ * another file's static initializer.  The stub keeps the kernel choose picks
+ * in a function-local static, which C++11 initializes once even when threads
+ * race on the first call, and forwards to it.  The pointer itself is never
+ * written, so calls through it never race; each costs a check of the
+ * static's guard.
+ */
+template <class Function> struct LazyDispatch;
+template <class Ret, class... Args> struct LazyDispatch<Ret (*)(Args...)> {
+  typedef Ret (*Function)(Args...);
+
+  template <Function (*choose)()> static Function Chosen() {
+    static const Function chosen = choose();
+    return chosen;
+  }
+
+  template <Function (*choose)()> static Ret Resolve(Args... args) {
+    return Chosen<choose>()(args...);
+  }
+
+  template <Function... candidates> static Function Choose() {
+    return ChooseCPU(candidates...);
+  }
+
+  // Resolve to ChooseCPU(candidates...).
+  template <Function... candidates> static Ret ResolveCPU(Args... args) {
+    return Resolve<Choose<candidates...> >(args...);
+  }
+};
+
+// Initializer of dispatch pointer for ChooseCPU of the kernels that follow,
+// picked on the first call.
+#define INTGEMM_LAZY_CHOOSE_CPU(pointer, ...) LazyDispatch<decltype(pointer)>::template ResolveCPU<__VA_ARGS__>
+
 struct TileInfo {
   const Index a_rows;
   const Index a_cols;
@@ -177,6 +488,13 @@ struct Int8 {
     Quantize(input, output, quant_mult, rows * cols);
   }
 
+  // PrepareA into space from workspace, valid until it is Reset.
+  static inline int8_t *PrepareA(const float *input, float quant_mult, Index rows, Index cols, Workspace &workspace) {
+    int8_t *output = workspace.Allocate<int8_t>(static_cast<std::size_t>(rows) * cols);
+    PrepareA(input, output, quant_mult, rows, cols);
+    return output;
+  }
+
   // Multiply floats by quant_mult then convert to 8-bit integers with saturation.
   static void (*Quantize)(const float *input, int8_t *output, float quant_mult, Index size);
 
@@ -184,41 +502,553 @@ struct Int8 {
   // A version that adds 127 to each number, making sure that all numbers are positive
   static void (*QuantizeU)(const float *input, uint8_t *output, float quant_mult, Index size);
 
+  // Quantize and QuantizeU of 16-bit floats, see float16.h, with the same
+  // requirements.  Each block of input is converted to float in cache and
+  // then quantized, so there's no float copy of the input.
+  static void QuantizeFloat16(const BFloat16 *input, int8_t *output, float quant_mult, Index size);
+  static void QuantizeFloat16(const Half *input, int8_t *output, float quant_mult, Index size);
+  static void QuantizeUFloat16(const BFloat16 *input, uint8_t *output, float quant_mult, Index size);
+  static void QuantizeUFloat16(const Half *input, uint8_t *output, float quant_mult, Index size);
+
+  static inline void PrepareA(const BFloat16 *input, int8_t *output, float quant_mult, Index rows, Index cols) {
+    QuantizeFloat16(input, output, quant_mult, rows * cols);
+  }
+  static inline void PrepareA(const Half *input, int8_t *output, float quant_mult, Index rows, Index cols) {
+    QuantizeFloat16(input, output, quant_mult, rows * cols);
+  }
+
+  // PrepareA with a quant_mult for each row: 127 / the row's MaxAbsolute,
+  // found in the same sweep.  row_scales[r] gets 1 / that quant_mult, which
+  // callbacks::UnquantizeRowsAndWrite takes along with 1 / B's quant_mult.
+  // cols must be a multiple of 64.
+  static inline void PrepareARows(const float *input, int8_t *output, float *row_scales, Index rows, Index cols) {
+    QuantizeRows(input, output, row_scales, rows, cols);
+  }
+
+  static void (*QuantizeRows)(const float *input, int8_t *output, float *row_scales, Index rows, Index cols);
+
+  // PrepareARows with each row's scale taken from statistic, see
+  // ScaleStatistic; stddevs is for ScaleStatistic::MeanStd.
+  static void (*QuantizeRowsScaled)(const float *input, int8_t *output, float *row_scales, Index rows, Index cols, ScaleStatistic statistic, float stddevs);
+
+  // Quantize and QuantizeU choosing quant_mult = 127 / statistic of the whole
+  // input in the same parallel region, so input is read from memory once
+  // where MaxAbsolute or GetVectorMeanStd then Quantize read it twice and
+  // fork twice.  Returns 1 / quant_mult, 0 for all zeros, to unquantize with.
+  // Each thread reads its share of input twice, the second time from its
+  // cache if the share fits, so this works best when size / threads floats
+  // fit in L2.  Any size; input and output aligned like Quantize.
+  static float (*QuantizeScaled)(const float *input, int8_t *output, Index size, ScaleStatistic statistic, float stddevs);
+  static float (*QuantizeUScaled)(const float *input, uint8_t *output, Index size, ScaleStatistic statistic, float stddevs);
+
+  // PrepareA with QuantizeScaled, returning 1 / quant_mult.
+  static inline float PrepareAScaled(const float *input, int8_t *output, Index rows, Index cols, ScaleStatistic statistic = ScaleStatistic::MaxAbsolute, float stddevs = 0.0f) {
+    return QuantizeScaled(input, output, rows * cols, statistic, stddevs);
+  }
+
+  // For shapes that aren't a multiple of tile_info.  The Padded functions
+  // round the shared dimension up to PaddedWidth and B's columns up to
+  // PaddedCols with zeros, so A takes rows * PaddedWidth(cols) bytes and B
+  // PaddedWidth(rows) * PaddedCols(cols).  MultiplyPadded takes the real
+  // width and B_cols and writes only the real columns of C.  Bias and column
+  // multipliers are read a tile at a time so give them PaddedCols entries.
+  static constexpr Index PaddedWidth(Index width) { return (width + 63) / 64 * 64; }
+  static constexpr Index PaddedCols(Index cols) { return (cols + 7) / 8 * 8; }
+
+  static void PrepareAPadded(const float *input, int8_t *output, float quant_mult, Index rows, Index cols);
+
   // Warning: the output of PrepareB depends on the CPU.
   // It will match the Multiply function on the same CPU though.
   static void (*PrepareB)(const float *input, int8_t *output, float quant_mult, Index rows, Index cols);
 
+  // PrepareB for any rows and cols, see PaddedWidth.  This pads a copy of B
+  // when needed so it is meant for offline preparation.
+  static void PrepareBPadded(const float *input, int8_t *output, float quant_mult, Index rows, Index cols);
+
+  // Prepare B a block of rows at a time as it is read, so the whole float B
+  // is never in memory.  input holds rows [row_begin, row_end) of B, which
+  // land where PrepareB of all rows x cols would put them.  row_begin and
+  // row_end are multiples of 64, except that row_end may be rows.
+  static void PrepareBRows(const float *input, int8_t *output, float quant_mult, Index rows, Index cols, Index row_begin, Index row_end);
+
+  // PrepareBRows over all of B, read chunk_rows rows at a time by calling
+  // read(float *rows, Index row_begin, Index row_end) to fill a buffer,
+  // e.g. from a file.  Peak memory is output plus about two chunks.
+  template <class Reader>
+  static void PrepareBStream(Reader read, int8_t *output, float quant_mult, Index rows, Index cols, Index chunk_rows = 256) {
+    AlignedVector<float> buffer(static_cast<std::size_t>(std::min(chunk_rows, rows)) * cols);
+    for (Index begin = 0; begin < rows; begin += chunk_rows) {
+      const Index end = std::min(begin + chunk_rows, rows);
+      read(buffer.begin(), begin, end);
+      PrepareBRows(buffer.begin(), output, quant_mult, rows, cols, begin, end);
+    }
+  }
+
+  // PrepareB of 16-bit floats, converted 64 rows at a time with
+  // PrepareBStream.  The output is the same as PrepareB of the floats.
+  static void PrepareBFloat16(const BFloat16 *input, int8_t *output, float quant_mult, Index rows, Index cols);
+  static void PrepareBFloat16(const Half *input, int8_t *output, float quant_mult, Index rows, Index cols);
+
   // Convert from a B that was already transposed (routine not provided) and
   // quantized (e.g. with Quantize) to the CPU-dependent format used for
   // Multiply.  This is useful for storing a quantized model on disk then in a
   // CPU-independent fashion.
   static void (*PrepareBQuantizedTransposed)(const int8_t *input, int8_t *output, Index inner, Index B_untransposed_cols);
 
+  // PrepareBQuantizedTransposed over matrix itself, so an int8 model loads
+  // with no second copy.
+  static void PrepareBQuantizedTransposedInPlace(int8_t *matrix, Index inner, Index B_untransposed_cols);
+
   // Convert from a B that was already transposed (routine not provided) to
   // the CPU-dependent format used for Multiply.  This is useful for storing
   // a quantized model on disk then in a CPU-independent fashion.
   static void (*PrepareBTransposed)(const float *input, int8_t *output, float quant_mul, Index inner, Index B_untransposed_cols);
 
+  // PrepareB and PrepareBTransposed with quant_mults[c] for column c of B, to
+  // be undone with callbacks::UnquantizeColumnsAndWrite.  These make a scaled
+  // copy of B so they are meant for offline preparation.
+  static void PrepareBColumns(const float *input, int8_t *output, const float *quant_mults, Index rows, Index cols);
+  static void PrepareBTransposedColumns(const float *input, int8_t *output, const float *quant_mults, Index inner, Index B_untransposed_cols);
+
   // Select columns from a prepared B matrix.  The number of selected columns must be a multiple of 8.
   static void (*SelectColumnsB)(const int8_t *input, int8_t *output, Index rows, const Index *cols_begin, const Index *cols_end);
 
+  // Gather rows of a quantized row-major table, such as an int8 embedding,
+  // and unquantize them: output row i is table row ids_begin[i] times
+  // unquant_mult, or times row_unquant_mult[ids_begin[i]].  output holds
+  // (ids_end - ids_begin) * width floats, any alignment.  Long gathers are
+  // split over OpenMP threads.
+  static void GatherRowsUnquantize(const int8_t *table, Index width, const Index *ids_begin, const Index *ids_end, float unquant_mult, float *output);
+  static void GatherRowsUnquantize(const int8_t *table, Index width, const Index *ids_begin, const Index *ids_end, const float *row_unquant_mult, float *output);
+  // Gather straight into PrepareA's output for the next layer: each value
+  // times unquant_mult * quant_mult, rounded and saturated like PrepareA.
+  static void GatherRowsQuantize(const int8_t *table, Index width, const Index *ids_begin, const Index *ids_end, float unquant_mult, float quant_mult, int8_t *output);
+
+  // The same from the columns of B, rows x B_cols, as prepared on this CPU by
+  // PrepareB, PrepareBTransposed or PrepareBColumns (then pass 1 / each
+  // column's multiplier as col_unquant_mult).  With the output vocabulary
+  // projection prepared, a tied input embedding needs no other copy.
+  static void GatherPreparedBUnquantize(const int8_t *prepared_B, Index rows, const Index *cols_begin, const Index *cols_end, float unquant_mult, float *output);
+  static void GatherPreparedBUnquantize(const int8_t *prepared_B, Index rows, const Index *cols_begin, const Index *cols_end, const float *col_unquant_mult, float *output);
+  static void GatherPreparedBQuantize(const int8_t *prepared_B, Index rows, const Index *cols_begin, const Index *cols_end, float unquant_mult, float quant_mult, int8_t *output);
+
+  // PrepareB then keep only the tiles of B with a nonzero value, see
+  // sparse_b.h.  For pruned B, whose zeros come in blocks at least a
+  // register of the shared dimension tall and 8 columns wide.
+  static void PrepareBSparse(const float *input, SparseB &output, float quant_mult, Index rows, Index cols);
+
+  // Append count columns to B, given transposed as count rows of B.rows
+  // floats each, such as a step's keys.  Only the strips holding the new
+  // columns are written.  See appendable_b.h.
+  static void PrepareBAppendColumns(const float *input, AppendableB &B, float quant_mult, Index count);
+
   // Multiply C = A * B, presuming A and B have been prepared.
   template <typename Callback>
   static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
     MultiplyImpl<Callback>::run(A, B, A_rows, width, B_cols, callback);
   }
 
+  // Multiply using threads from executor instead of OpenMP.
+  template <typename Callback>
+  static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) {
+    MultiplyImpl<Callback>::run_executor(A, B, A_rows, width, B_cols, callback, executor);
+  }
+
+  // Multiply on pool without waiting: returns at once and runs done, if
+  // given, once the callback has seen all of C.  A, B and whatever the
+  // callback writes must stay valid until then.  Multiplies submitted
+  // together share the pool's threads.
+  template <typename Callback>
+  static AsyncPool::Handle MultiplyAsync(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, AsyncPool &pool, AsyncPool::Done done = AsyncPool::Done()) {
+    return pool.Submit([=, &pool] { Multiply(A, B, A_rows, width, B_cols, callback, pool); }, std::move(done));
+  }
+
+  // Multiply with row r of A at A + r * lda, for A that is a block of columns
+  // of a wider prepared matrix.  lda must be a multiple of 64.  For C, wrap
+  // the callback with callbacks::Strided(ldc, callback).
+  template <typename Callback>
+  static void Multiply(const int8_t *A, Index lda, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    MultiplyImpl<Callback>::run_strided(A, lda, B, A_rows, width, B_cols, callback);
+  }
+
+  // Strided Multiply using threads from executor instead of OpenMP.
+  template <typename Callback>
+  static void Multiply(const int8_t *A, Index lda, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) {
+    MultiplyImpl<Callback>::run_strided_executor(A, lda, B, A_rows, width, B_cols, callback, executor);
+  }
+
+  // Multiply with width and B_cols fixed at compile time, on the calling
+  // thread without OpenMP or an executor.  Meant for small multiplies such as
+  // batch-1 decoding, where the shapes are known when the model is built.
+  template <Index kWidth, Index kBCols, typename Callback>
+  static void MultiplyFixed(const int8_t *A, const int8_t *B, Index A_rows, Callback callback) {
+    MultiplyFixedImpl<kWidth, kBCols, Callback>::run(A, B, A_rows, callback);
+  }
+
+  // The kernel MultiplyFixed dispatches to on this CPU.  Keep it at model
+  // load and call it to skip dispatch on each multiply.
+  template <Index kWidth, Index kBCols, typename Callback>
+  static void (*MultiplyFixedFunction())(const int8_t *A, const int8_t *B, Index A_rows, Callback callback) {
+    typedef MultiplyFixedImpl<kWidth, kBCols, Callback> Impl;
+    return LazyDispatch<typename Impl::Function>::template Chosen<Impl::Choose>();
+  }
+
+  // Time Multiply's kernel at each register blocking, and with
+  // GetTuneAcrossKernels the other kernels that can multiply B prepared on
+  // this CPU, for an A_rows x width x B_cols multiply and remember the fastest
+  // in TuneCache::Global().  Later calls return the cached choice.
+  static TuneChoice Tune(Index A_rows, Index width, Index B_cols);
+
+  // Tune shapes ahead of time, e.g. those of a model's layers at load.
+  static void TuneWarmup(const std::vector<TuneShape> &shapes);
+
+  // Multiply with the kernel Tune chose for this shape, tuning on first use.
+  template <typename Callback>
+  static void MultiplyTuned(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    MultiplyTunedImpl<Callback>::Get(Tune(A_rows, width, B_cols))(A, B, A_rows, width, B_cols, callback);
+  }
+
+  // The kernel MultiplyTuned uses for this shape.  Keep it to skip the cache
+  // lookup on each multiply.
+  template <typename Callback>
+  static void (*MultiplyTunedFunction(Index A_rows, Index width, Index B_cols))(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    return MultiplyTunedImpl<Callback>::Get(Tune(A_rows, width, B_cols));
+  }
+
+  // Multiply A[i] by B[i] with callbacks[i] for each i < batch, e.g. the heads
+  // of an attention layer.  The batch is dispatched once and shared out over
+  // threads in one parallel region, each multiply taking an equal share of
+  // the threads.  All have the same shape.
+  template <typename Callback>
+  static void MultiplyBatched(const int8_t *const *A, const int8_t *const *B, Index A_rows, Index width, Index B_cols, const Callback *callbacks, Index batch) {
+    MultiplyImpl<Callback>::run_batched(A, B, A_rows, width, B_cols, callbacks, batch);
+  }
+
+  // MultiplyBatched using threads from executor instead of OpenMP.
+  template <typename Callback>
+  static void MultiplyBatched(const int8_t *const *A, const int8_t *const *B, Index A_rows, Index width, Index B_cols, const Callback *callbacks, Index batch, Executor &executor) {
+    MultiplyImpl<Callback>::run_batched_executor(A, B, A_rows, width, B_cols, callbacks, batch, executor);
+  }
+
+  // MultiplyBatched with multiply i's A at A + i * A_batch_stride and B at
+  // B + i * B_batch_stride.  Strides must keep every A and B 64-byte aligned.
+  template <typename Callback>
+  static void MultiplyBatched(const int8_t *A, std::size_t A_batch_stride, const int8_t *B, std::size_t B_batch_stride, Index A_rows, Index width, Index B_cols, const Callback *callbacks, Index batch) {
+    std::vector<const int8_t*> A_items, B_items;
+    BatchPointers(A, A_batch_stride, B, B_batch_stride, batch, A_items, B_items);
+    MultiplyBatched(A_items.data(), B_items.data(), A_rows, width, B_cols, callbacks, batch);
+  }
+
+  // Strided MultiplyBatched using threads from executor instead of OpenMP.
+  template <typename Callback>
+  static void MultiplyBatched(const int8_t *A, std::size_t A_batch_stride, const int8_t *B, std::size_t B_batch_stride, Index A_rows, Index width, Index B_cols, const Callback *callbacks, Index batch, Executor &executor) {
+    std::vector<const int8_t*> A_items, B_items;
+    BatchPointers(A, A_batch_stride, B, B_batch_stride, batch, A_items, B_items);
+    MultiplyBatched(A_items.data(), B_items.data(), A_rows, width, B_cols, callbacks, batch, executor);
+  }
+
+  // Multiply one A by count Bs, B[i] with B_cols[i] columns and callbacks[i],
+  // e.g. the query, key and value projections of a layer.  One parallel
+  // region covers them all and each block of A's rows is used for every B
+  // while it is in cache.  Bs with equal B_cols are split the same way, so
+  // B[i]'s tile of C is written before B[i + 1]'s by the same thread and a
+  // callback like UnquantizeAndAddBiasAndMultiplySilu may read it.
+  template <typename Callback>
+  static void MultiplyMulti(const int8_t *A, const int8_t *const *B, const Index *B_cols, Index A_rows, Index width, const Callback *callbacks, Index count) {
+    MultiplyImpl<Callback>::run_multi(A, B, B_cols, A_rows, width, callbacks, count);
+  }
+
+  // MultiplyMulti using threads from executor instead of OpenMP.
+  template <typename Callback>
+  static void MultiplyMulti(const int8_t *A, const int8_t *const *B, const Index *B_cols, Index A_rows, Index width, const Callback *callbacks, Index count, Executor &executor) {
+    MultiplyImpl<Callback>::run_multi_executor(A, B, B_cols, A_rows, width, callbacks, count, executor);
+  }
+
+  // Multiply A from PrepareAPadded by B from PrepareBPadded for any width and
+  // B_cols.  C is A_rows * B_cols.
+  template <typename Callback>
+  static void MultiplyPadded(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    const Index padded_width = PaddedWidth(width);
+    Multiply(A, padded_width, B, A_rows, padded_width, PaddedCols(B_cols), callbacks::ColumnTail<Callback>(B_cols, callback));
+  }
+
+  // MultiplyPadded using threads from executor instead of OpenMP.
+  template <typename Callback>
+  static void MultiplyPadded(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) {
+    const Index padded_width = PaddedWidth(width);
+    Multiply(A, padded_width, B, A_rows, padded_width, PaddedCols(B_cols), callbacks::ColumnTail<Callback>(B_cols, callback), executor);
+  }
+
+  // Multiply by B from PrepareBSparse, skipping the tiles that are zero.
+  // The result is the same as Multiply with dense B.  width is B.rows.
+  template <typename Callback>
+  static void MultiplySparse(const int8_t *A, const SparseB &B, Index A_rows, Callback callback) {
+    MultiplySparseImpl<Callback>::run(A, B, A_rows, callback);
+  }
+
+  // MultiplySparse using threads from executor instead of OpenMP.
+  template <typename Callback>
+  static void MultiplySparse(const int8_t *A, const SparseB &B, Index A_rows, Callback callback, Executor &executor) {
+    MultiplySparseImpl<Callback>::run_executor(A, B, A_rows, callback, executor);
+  }
+
+  // Multiply by the B.cols columns appended to B so far.  C is
+  // A_rows * B.cols and width is B.rows.  The same result as PrepareB on
+  // those columns then MultiplyPadded.
+  template <typename Callback>
+  static void MultiplyAppendable(const int8_t *A, const AppendableB &B, Index A_rows, Callback callback) {
+    if (!B.cols) return;
+    MultiplyAppendableImpl<callbacks::ColumnTail<Callback> >::run(A, B.data.begin(), A_rows, B.rows, PaddedCols(B.cols), callbacks::ColumnTail<Callback>(B.cols, callback));
+  }
+
+  // MultiplyAppendable using threads from executor instead of OpenMP.
+  template <typename Callback>
+  static void MultiplyAppendable(const int8_t *A, const AppendableB &B, Index A_rows, Callback callback, Executor &executor) {
+    if (!B.cols) return;
+    MultiplyAppendableImpl<callbacks::ColumnTail<Callback> >::run_executor(A, B.data.begin(), A_rows, B.rows, PaddedCols(B.cols), callbacks::ColumnTail<Callback>(B.cols, callback), executor);
+  }
+
+  // Multiply by the columns [cols_begin, cols_end) of B from PrepareB, the
+  // same result as SelectColumnsB then Multiply without writing the selected
+  // B out.  C has cols_end - cols_begin columns, a multiple of 8.
+  template <typename Callback>
+  static void MultiplyColumns(const int8_t *A, const int8_t *B, Index A_rows, Index width, const Index *cols_begin, const Index *cols_end, Callback callback) {
+    MultiplyColumnsImpl<Callback>::run(A, B, A_rows, width, cols_begin, cols_end, callback);
+  }
+
+  // MultiplyColumns using threads from executor instead of OpenMP.
+  template <typename Callback>
+  static void MultiplyColumns(const int8_t *A, const int8_t *B, Index A_rows, Index width, const Index *cols_begin, const Index *cols_end, Callback callback, Executor &executor) {
+    MultiplyColumnsImpl<Callback>::run_executor(A, B, A_rows, width, cols_begin, cols_end, callback, executor);
+  }
+
+  // Same result as PrepareA then Multiply, but A is quantized a block of rows
+  // at a time into a per-thread buffer that stays in cache instead of being
+  // written out in full first.
+  template <typename Callback>
+  static void MultiplyFloatA(const float *A, float quant_mult, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    MultiplyFloatAImpl<Callback>::run(A, quant_mult, B, A_rows, width, B_cols, callback);
+  }
+
+  // MultiplyFloatA using threads from executor instead of OpenMP.
+  template <typename Callback>
+  static void MultiplyFloatA(const float *A, float quant_mult, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) {
+    MultiplyFloatAImpl<Callback>::run_executor(A, quant_mult, B, A_rows, width, B_cols, callback, executor);
+  }
+
+  // C = A * B^T where B is quantized but not prepared: B_rows rows of width
+  // in row major order, such as the keys when scoring attention or anything
+  // else made at run time.  A is from PrepareA.  Saves the
+  // PrepareBQuantizedTransposed pass over B and has the same result.  width
+  // is a multiple of 64 and B is 64-byte aligned.  C is A_rows * B_rows; when
+  // B_rows isn't a multiple of 8 the padding is dropped as by ColumnTail.
+  template <typename Callback>
+  static void MultiplyNT(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_rows, Callback callback) {
+    MultiplyNTImpl<callbacks::ColumnTail<Callback> >::run(A, B, A_rows, width, B_rows, callbacks::ColumnTail<Callback>(B_rows, callback));
+  }
+
+  // MultiplyNT using threads from executor instead of OpenMP.
+  template <typename Callback>
+  static void MultiplyNT(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_rows, Callback callback, Executor &executor) {
+    MultiplyNTImpl<callbacks::ColumnTail<Callback> >::run_executor(A, B, A_rows, width, B_rows, callbacks::ColumnTail<Callback>(B_rows, callback), executor);
+  }
+
+  // Multiply for a long shared dimension and a small output, e.g. a few rows
+  // of A by a narrow B, which leaves threads idle when only the output is
+  // split.  width is split between the threads too, at multiples of 2048,
+  // and each slice goes into its own int32 copy of C; the copies are added
+  // and the callback runs once on the sums.  The result is the same as
+  // Multiply.  Shapes whose output keeps the threads busy just run Multiply.
+  template <typename Callback>
+  static void MultiplySplitK(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    MultiplySplitKImpl<Callback>::run(A, B, A_rows, width, B_cols, callback);
+  }
+
+  // MultiplySplitK using threads from executor instead of OpenMP.
+  template <typename Callback>
+  static void MultiplySplitK(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) {
+    MultiplySplitKImpl<Callback>::run_executor(A, B, A_rows, width, B_cols, callback, executor);
+  }
+
+  // The SSSE3, AVX2 and AVX512BW kernels add products in saturating 16 bits
+  // before widening.  This counts the outputs of Multiply(A, B, ...) that
+  // saturation would change on cpu, 0 for CPUs whose kernels accumulate in
+  // 32 bits.  It redoes the multiply in scalar code, so use it to check a
+  // quant_mult on real data, not on every call.  B is prepared on this CPU;
+  // pass another cpu for the kernels Tune may pick across kernels.
+  static Index CountSaturated(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, CPUType cpu = GetCPUID());
+
   static const char *const kName;
 
 private:
+  static void BatchPointers(const int8_t *A, std::size_t A_batch_stride, const int8_t *B, std::size_t B_batch_stride, Index batch, std::vector<const int8_t*> &A_items, std::vector<const int8_t*> &B_items) {
+    A_items.resize(batch);
+    B_items.resize(batch);
+    for (Index i = 0; i < batch; ++i) {
+      A_items[i] = A + i * A_batch_stride;
+      B_items[i] = B + i * B_batch_stride;
+    }
+  }
+
   template <typename Callback>
   struct MultiplyImpl {
     static void (*run)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback);
+    static void (*run_executor)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor);
+    static void (*run_strided)(const int8_t *A, Index lda, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback);
+    static void (*run_strided_executor)(const int8_t *A, Index lda, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor);
+    static void (*run_batched)(const int8_t *const *A, const int8_t *const *B, Index A_rows, Index width, Index B_cols, const Callback *callbacks, Index batch);
+    static void (*run_batched_executor)(const int8_t *const *A, const int8_t *const *B, Index A_rows, Index width, Index B_cols, const Callback *callbacks, Index batch, Executor &executor);
+    static void (*run_multi)(const int8_t *A, const int8_t *const *B, const Index *B_cols, Index A_rows, Index width, const Callback *callbacks, Index count);
+    static void (*run_multi_executor)(const int8_t *A, const int8_t *const *B, const Index *B_cols, Index A_rows, Index width, const Callback *callbacks, Index count, Executor &executor);
+  };
+
+  template <Index kWidth, Index kBCols, typename Callback>
+  struct MultiplyFixedImpl {
+    typedef void (*Function)(const int8_t *A, const int8_t *B, Index A_rows, Callback callback);
+    // Named so MultiplyFixedFunction can return the kernel run resolves to.
+    static Function Choose();
+    static Function run;
+  };
+
+  template <typename Callback>
+  struct MultiplyAppendableImpl {
+    static void (*run)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback);
+    static void (*run_executor)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor);
+  };
+
+  template <typename Callback>
+  struct MultiplySparseImpl {
+    static void (*run)(const int8_t *A, const SparseB &B, Index A_rows, Callback callback);
+    static void (*run_executor)(const int8_t *A, const SparseB &B, Index A_rows, Callback callback, Executor &executor);
+  };
+
+  template <typename Callback>
+  struct MultiplyColumnsImpl {
+    static void (*run)(const int8_t *A, const int8_t *B, Index A_rows, Index width, const Index *cols_begin, const Index *cols_end, Callback callback);
+    static void (*run_executor)(const int8_t *A, const int8_t *B, Index A_rows, Index width, const Index *cols_begin, const Index *cols_end, Callback callback, Executor &executor);
+  };
+
+  template <typename Callback>
+  struct MultiplyFloatAImpl {
+    static void (*run)(const float *A, float quant_mult, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback);
+    static void (*run_executor)(const float *A, float quant_mult, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor);
+  };
+
+  template <typename Callback>
+  struct MultiplyNTImpl {
+    static void (*run)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_rows, Callback callback);
+    static void (*run_executor)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_rows, Callback callback, Executor &executor);
+  };
+
+  template <typename Callback>
+  struct MultiplySplitKImpl {
+    static void (*run)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback);
+    static void (*run_executor)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor);
+  };
+
+  template <typename Callback>
+  struct MultiplyTunedImpl {
+    typedef void (*Function)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback);
+    static Function Get(const TuneChoice &choice);
+
+    template <class Kernels> static Function Rows(Index rows) {
+      switch (rows) {
+        case 1: return OMPParallelWrapRows<Callback, Kernels, 1>;
+        case 2: return OMPParallelWrapRows<Callback, Kernels, 2>;
+        case 4: return OMPParallelWrapRows<Callback, Kernels, 4>;
+        default: return OMPParallelWrap<Callback, Kernels>;
+      }
+    }
   };
 };
 
 template <typename Callback>
-void (*Int8::MultiplyImpl<Callback>::run)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) = ChooseCPU(OMPParallelWrap<Callback, AVX512VNNI::Kernels8>, OMPParallelWrap<Callback, AVX512BW::Kernels8>, OMPParallelWrap<Callback, AVX2::Kernels8>, OMPParallelWrap<Callback, SSSE3::Kernels8>, Unsupported_8bit::Multiply<Callback>, Unsupported_8bit::Multiply<Callback>);
+void (*Int8::MultiplyImpl<Callback>::run)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) = INTGEMM_LAZY_CHOOSE_CPU(run, OMPParallelWrap<Callback, SIMD128::Kernels8>, OMPParallelWrap<Callback, NEONDOTPROD::Kernels8>, OMPParallelWrap<Callback, NEON::Kernels8>, OMPParallelWrap<Callback, AMX::Kernels8>, OMPParallelWrap<Callback, AVX512VNNI::Kernels8>, OMPParallelWrap<Callback, AVX512BW::Kernels8>, OMPParallelWrap<Callback, AVXVNNI::Kernels8>, OMPParallelWrap<Callback, AVX2::Kernels8>, OMPParallelWrap<Callback, SSSE3::Kernels8>, Unsupported_8bit::Multiply<Callback>, Unsupported_8bit::Multiply<Callback>);
+
+template <typename Callback>
+void (*Int8::MultiplyImpl<Callback>::run_executor)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) = INTGEMM_LAZY_CHOOSE_CPU(run_executor, ExecutorWrap<Callback, SIMD128::Kernels8>, ExecutorWrap<Callback, NEONDOTPROD::Kernels8>, ExecutorWrap<Callback, NEON::Kernels8>, ExecutorWrap<Callback, AMX::Kernels8>, ExecutorWrap<Callback, AVX512VNNI::Kernels8>, ExecutorWrap<Callback, AVX512BW::Kernels8>, ExecutorWrap<Callback, AVXVNNI::Kernels8>, ExecutorWrap<Callback, AVX2::Kernels8>, ExecutorWrap<Callback, SSSE3::Kernels8>, Unsupported_8bit::Multiply<Callback>, Unsupported_8bit::Multiply<Callback>);
+
+template <typename Callback>
+void (*Int8::MultiplyImpl<Callback>::run_strided)(const int8_t *A, Index lda, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) = INTGEMM_LAZY_CHOOSE_CPU(run_strided, OMPParallelWrapStrided<Callback, SIMD128::Kernels8>, OMPParallelWrapStrided<Callback, NEONDOTPROD::Kernels8>, OMPParallelWrapStrided<Callback, NEON::Kernels8>, OMPParallelWrapStrided<Callback, AMX::Kernels8>, OMPParallelWrapStrided<Callback, AVX512VNNI::Kernels8>, OMPParallelWrapStrided<Callback, AVX512BW::Kernels8>, OMPParallelWrapStrided<Callback, AVXVNNI::Kernels8>, OMPParallelWrapStrided<Callback, AVX2::Kernels8>, OMPParallelWrapStrided<Callback, SSSE3::Kernels8>, Unsupported_8bit::Multiply<Callback>, Unsupported_8bit::Multiply<Callback>);
+
+template <typename Callback>
+void (*Int8::MultiplyImpl<Callback>::run_strided_executor)(const int8_t *A, Index lda, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) = INTGEMM_LAZY_CHOOSE_CPU(run_strided_executor, ExecutorWrapStrided<Callback, SIMD128::Kernels8>, ExecutorWrapStrided<Callback, NEONDOTPROD::Kernels8>, ExecutorWrapStrided<Callback, NEON::Kernels8>, ExecutorWrapStrided<Callback, AMX::Kernels8>, ExecutorWrapStrided<Callback, AVX512VNNI::Kernels8>, ExecutorWrapStrided<Callback, AVX512BW::Kernels8>, ExecutorWrapStrided<Callback, AVXVNNI::Kernels8>, ExecutorWrapStrided<Callback, AVX2::Kernels8>, ExecutorWrapStrided<Callback, SSSE3::Kernels8>, Unsupported_8bit::Multiply<Callback>, Unsupported_8bit::Multiply<Callback>);
+
+template <typename Callback>
+void (*Int8::MultiplyImpl<Callback>::run_batched)(const int8_t *const *A, const int8_t *const *B, Index A_rows, Index width, Index B_cols, const Callback *callbacks, Index batch) = INTGEMM_LAZY_CHOOSE_CPU(run_batched, OMPParallelWrapBatched<Callback, SIMD128::Kernels8>, OMPParallelWrapBatched<Callback, NEONDOTPROD::Kernels8>, OMPParallelWrapBatched<Callback, NEON::Kernels8>, OMPParallelWrapBatched<Callback, AMX::Kernels8>, OMPParallelWrapBatched<Callback, AVX512VNNI::Kernels8>, OMPParallelWrapBatched<Callback, AVX512BW::Kernels8>, OMPParallelWrapBatched<Callback, AVXVNNI::Kernels8>, OMPParallelWrapBatched<Callback, AVX2::Kernels8>, OMPParallelWrapBatched<Callback, SSSE3::Kernels8>, Unsupported_8bit::MultiplyBatched<Callback>, Unsupported_8bit::MultiplyBatched<Callback>);
+
+template <typename Callback>
+void (*Int8::MultiplyImpl<Callback>::run_batched_executor)(const int8_t *const *A, const int8_t *const *B, Index A_rows, Index width, Index B_cols, const Callback *callbacks, Index batch, Executor &executor) = INTGEMM_LAZY_CHOOSE_CPU(run_batched_executor, ExecutorWrapBatched<Callback, SIMD128::Kernels8>, ExecutorWrapBatched<Callback, NEONDOTPROD::Kernels8>, ExecutorWrapBatched<Callback, NEON::Kernels8>, ExecutorWrapBatched<Callback, AMX::Kernels8>, ExecutorWrapBatched<Callback, AVX512VNNI::Kernels8>, ExecutorWrapBatched<Callback, AVX512BW::Kernels8>, ExecutorWrapBatched<Callback, AVXVNNI::Kernels8>, ExecutorWrapBatched<Callback, AVX2::Kernels8>, ExecutorWrapBatched<Callback, SSSE3::Kernels8>, Unsupported_8bit::MultiplyBatched<Callback>, Unsupported_8bit::MultiplyBatched<Callback>);
+
+template <typename Callback>
+void (*Int8::MultiplyImpl<Callback>::run_multi)(const int8_t *A, const int8_t *const *B, const Index *B_cols, Index A_rows, Index width, const Callback *callbacks, Index count) = INTGEMM_LAZY_CHOOSE_CPU(run_multi, OMPParallelWrapMulti<Callback, SIMD128::Kernels8>, OMPParallelWrapMulti<Callback, NEONDOTPROD::Kernels8>, OMPParallelWrapMulti<Callback, NEON::Kernels8>, OMPParallelWrapMulti<Callback, AMX::Kernels8>, OMPParallelWrapMulti<Callback, AVX512VNNI::Kernels8>, OMPParallelWrapMulti<Callback, AVX512BW::Kernels8>, OMPParallelWrapMulti<Callback, AVXVNNI::Kernels8>, OMPParallelWrapMulti<Callback, AVX2::Kernels8>, OMPParallelWrapMulti<Callback, SSSE3::Kernels8>, Unsupported_8bit::MultiplyMulti<Callback>, Unsupported_8bit::MultiplyMulti<Callback>);
+
+template <typename Callback>
+void (*Int8::MultiplyImpl<Callback>::run_multi_executor)(const int8_t *A, const int8_t *const *B, const Index *B_cols, Index A_rows, Index width, const Callback *callbacks, Index count, Executor &executor) = INTGEMM_LAZY_CHOOSE_CPU(run_multi_executor, ExecutorWrapMulti<Callback, SIMD128::Kernels8>, ExecutorWrapMulti<Callback, NEONDOTPROD::Kernels8>, ExecutorWrapMulti<Callback, NEON::Kernels8>, ExecutorWrapMulti<Callback, AMX::Kernels8>, ExecutorWrapMulti<Callback, AVX512VNNI::Kernels8>, ExecutorWrapMulti<Callback, AVX512BW::Kernels8>, ExecutorWrapMulti<Callback, AVXVNNI::Kernels8>, ExecutorWrapMulti<Callback, AVX2::Kernels8>, ExecutorWrapMulti<Callback, SSSE3::Kernels8>, Unsupported_8bit::MultiplyMulti<Callback>, Unsupported_8bit::MultiplyMulti<Callback>);
+
+template <Index kWidth, Index kBCols, typename Callback>
+typename Int8::MultiplyFixedImpl<kWidth, kBCols, Callback>::Function Int8::MultiplyFixedImpl<kWidth, kBCols, Callback>::Choose() {
+  return ChooseCPU(SIMD128::Kernels8::MultiplyFixed<kWidth, kBCols, Callback>, NEONDOTPROD::Kernels8::MultiplyFixed<kWidth, kBCols, Callback>, NEON::Kernels8::MultiplyFixed<kWidth, kBCols, Callback>, AMX::Kernels8::MultiplyFixed<kWidth, kBCols, Callback>, AVX512VNNI::Kernels8::MultiplyFixed<kWidth, kBCols, Callback>, AVX512BW::Kernels8::MultiplyFixed<kWidth, kBCols, Callback>, AVXVNNI::Kernels8::MultiplyFixed<kWidth, kBCols, Callback>, AVX2::Kernels8::MultiplyFixed<kWidth, kBCols, Callback>, SSSE3::Kernels8::MultiplyFixed<kWidth, kBCols, Callback>, Unsupported_8bit::MultiplyFixed<kWidth, kBCols, Callback>, Unsupported_8bit::MultiplyFixed<kWidth, kBCols, Callback>);
+}
+
+template <Index kWidth, Index kBCols, typename Callback>
+typename Int8::MultiplyFixedImpl<kWidth, kBCols, Callback>::Function Int8::MultiplyFixedImpl<kWidth, kBCols, Callback>::run = LazyDispatch<Function>::template Resolve<Choose>;
+
+template <typename Callback>
+void (*Int8::MultiplyFloatAImpl<Callback>::run)(const float *A, float quant_mult, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) = INTGEMM_LAZY_CHOOSE_CPU(run, OMPParallelWrapFloatA<Callback, SIMD128::Kernels8>, OMPParallelWrapFloatA<Callback, NEONDOTPROD::Kernels8>, OMPParallelWrapFloatA<Callback, NEON::Kernels8>, OMPParallelWrapFloatA<Callback, AMX::Kernels8>, OMPParallelWrapFloatA<Callback, AVX512VNNI::Kernels8>, OMPParallelWrapFloatA<Callback, AVX512BW::Kernels8>, OMPParallelWrapFloatA<Callback, AVXVNNI::Kernels8>, OMPParallelWrapFloatA<Callback, AVX2::Kernels8>, OMPParallelWrapFloatA<Callback, SSSE3::Kernels8>, Unsupported_8bit::MultiplyFloatA<Callback>, Unsupported_8bit::MultiplyFloatA<Callback>);
+
+template <typename Callback>
+void (*Int8::MultiplyFloatAImpl<Callback>::run_executor)(const float *A, float quant_mult, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) = INTGEMM_LAZY_CHOOSE_CPU(run_executor, ExecutorWrapFloatA<Callback, SIMD128::Kernels8>, ExecutorWrapFloatA<Callback, NEONDOTPROD::Kernels8>, ExecutorWrapFloatA<Callback, NEON::Kernels8>, ExecutorWrapFloatA<Callback, AMX::Kernels8>, ExecutorWrapFloatA<Callback, AVX512VNNI::Kernels8>, ExecutorWrapFloatA<Callback, AVX512BW::Kernels8>, ExecutorWrapFloatA<Callback, AVXVNNI::Kernels8>, ExecutorWrapFloatA<Callback, AVX2::Kernels8>, ExecutorWrapFloatA<Callback, SSSE3::Kernels8>, Unsupported_8bit::MultiplyFloatA<Callback>, Unsupported_8bit::MultiplyFloatA<Callback>);
+
+template <typename Callback>
+void (*Int8::MultiplyNTImpl<Callback>::run)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_rows, Callback callback) = INTGEMM_LAZY_CHOOSE_CPU(run, OMPParallelWrapNT<Callback, SIMD128::Kernels8>, OMPParallelWrapNT<Callback, NEONDOTPROD::Kernels8>, OMPParallelWrapNT<Callback, NEON::Kernels8>, OMPParallelWrapNT<Callback, AMX::Kernels8>, OMPParallelWrapNT<Callback, AVX512VNNI::Kernels8>, OMPParallelWrapNT<Callback, AVX512BW::Kernels8>, OMPParallelWrapNT<Callback, AVXVNNI::Kernels8>, OMPParallelWrapNT<Callback, AVX2::Kernels8>, OMPParallelWrapNT<Callback, SSSE3::Kernels8>, Unsupported_8bit::MultiplyNT<Callback>, Unsupported_8bit::MultiplyNT<Callback>);
+
+template <typename Callback>
+void (*Int8::MultiplyNTImpl<Callback>::run_executor)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_rows, Callback callback, Executor &executor) = INTGEMM_LAZY_CHOOSE_CPU(run_executor, ExecutorWrapNT<Callback, SIMD128::Kernels8>, ExecutorWrapNT<Callback, NEONDOTPROD::Kernels8>, ExecutorWrapNT<Callback, NEON::Kernels8>, ExecutorWrapNT<Callback, AMX::Kernels8>, ExecutorWrapNT<Callback, AVX512VNNI::Kernels8>, ExecutorWrapNT<Callback, AVX512BW::Kernels8>, ExecutorWrapNT<Callback, AVXVNNI::Kernels8>, ExecutorWrapNT<Callback, AVX2::Kernels8>, ExecutorWrapNT<Callback, SSSE3::Kernels8>, Unsupported_8bit::MultiplyNT<Callback>, Unsupported_8bit::MultiplyNT<Callback>);
+
+// AppendableB is in the AVX512VNNI layout on AMX too.
+template <typename Callback>
+void (*Int8::MultiplyAppendableImpl<Callback>::run)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) = INTGEMM_LAZY_CHOOSE_CPU(run, OMPParallelWrap<Callback, SIMD128::Kernels8>, OMPParallelWrap<Callback, NEONDOTPROD::Kernels8>, OMPParallelWrap<Callback, NEON::Kernels8>, OMPParallelWrap<Callback, AVX512VNNI::Kernels8>, OMPParallelWrap<Callback, AVX512VNNI::Kernels8>, OMPParallelWrap<Callback, AVX512BW::Kernels8>, OMPParallelWrap<Callback, AVXVNNI::Kernels8>, OMPParallelWrap<Callback, AVX2::Kernels8>, OMPParallelWrap<Callback, SSSE3::Kernels8>, Unsupported_8bit::Multiply<Callback>, Unsupported_8bit::Multiply<Callback>);
+
+template <typename Callback>
+void (*Int8::MultiplyAppendableImpl<Callback>::run_executor)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) = INTGEMM_LAZY_CHOOSE_CPU(run_executor, ExecutorWrap<Callback, SIMD128::Kernels8>, ExecutorWrap<Callback, NEONDOTPROD::Kernels8>, ExecutorWrap<Callback, NEON::Kernels8>, ExecutorWrap<Callback, AVX512VNNI::Kernels8>, ExecutorWrap<Callback, AVX512VNNI::Kernels8>, ExecutorWrap<Callback, AVX512BW::Kernels8>, ExecutorWrap<Callback, AVXVNNI::Kernels8>, ExecutorWrap<Callback, AVX2::Kernels8>, ExecutorWrap<Callback, SSSE3::Kernels8>, Unsupported_8bit::Multiply<Callback>, Unsupported_8bit::Multiply<Callback>);
+
+// Like Int4, SparseB uses the AVX512VNNI layout on AMX.
+template <typename Callback>
+void (*Int8::MultiplySparseImpl<Callback>::run)(const int8_t *A, const SparseB &B, Index A_rows, Callback callback) = INTGEMM_LAZY_CHOOSE_CPU(run, OMPParallelWrapSparse<Callback, SIMD128::Kernels8>, OMPParallelWrapSparse<Callback, NEONDOTPROD::Kernels8>, OMPParallelWrapSparse<Callback, NEON::Kernels8>, OMPParallelWrapSparse<Callback, AVX512VNNI::Kernels8>, OMPParallelWrapSparse<Callback, AVX512VNNI::Kernels8>, OMPParallelWrapSparse<Callback, AVX512BW::Kernels8>, OMPParallelWrapSparse<Callback, AVXVNNI::Kernels8>, OMPParallelWrapSparse<Callback, AVX2::Kernels8>, OMPParallelWrapSparse<Callback, SSSE3::Kernels8>, Unsupported_8bit::MultiplySparse<Callback>, Unsupported_8bit::MultiplySparse<Callback>);
+
+template <typename Callback>
+void (*Int8::MultiplySparseImpl<Callback>::run_executor)(const int8_t *A, const SparseB &B, Index A_rows, Callback callback, Executor &executor) = INTGEMM_LAZY_CHOOSE_CPU(run_executor, ExecutorWrapSparse<Callback, SIMD128::Kernels8>, ExecutorWrapSparse<Callback, NEONDOTPROD::Kernels8>, ExecutorWrapSparse<Callback, NEON::Kernels8>, ExecutorWrapSparse<Callback, AVX512VNNI::Kernels8>, ExecutorWrapSparse<Callback, AVX512VNNI::Kernels8>, ExecutorWrapSparse<Callback, AVX512BW::Kernels8>, ExecutorWrapSparse<Callback, AVXVNNI::Kernels8>, ExecutorWrapSparse<Callback, AVX2::Kernels8>, ExecutorWrapSparse<Callback, SSSE3::Kernels8>, Unsupported_8bit::MultiplySparse<Callback>, Unsupported_8bit::MultiplySparse<Callback>);
+
+// AMX tiles B in groups of 4 rows, so AMX selects the columns into a buffer first.
+template <typename Callback>
+void (*Int8::MultiplyColumnsImpl<Callback>::run)(const int8_t *A, const int8_t *B, Index A_rows, Index width, const Index *cols_begin, const Index *cols_end, Callback callback) = INTGEMM_LAZY_CHOOSE_CPU(run, OMPParallelWrapColumns<Callback, SIMD128::Kernels8>, OMPParallelWrapColumns<Callback, NEONDOTPROD::Kernels8>, OMPParallelWrapColumns<Callback, NEON::Kernels8>, OMPParallelWrapColumnsCopy<Callback, AMX::Kernels8>, OMPParallelWrapColumns<Callback, AVX512VNNI::Kernels8>, OMPParallelWrapColumns<Callback, AVX512BW::Kernels8>, OMPParallelWrapColumns<Callback, AVXVNNI::Kernels8>, OMPParallelWrapColumns<Callback, AVX2::Kernels8>, OMPParallelWrapColumns<Callback, SSSE3::Kernels8>, Unsupported_8bit::MultiplyColumns<Callback>, Unsupported_8bit::MultiplyColumns<Callback>);
+
+template <typename Callback>
+void (*Int8::MultiplyColumnsImpl<Callback>::run_executor)(const int8_t *A, const int8_t *B, Index A_rows, Index width, const Index *cols_begin, const Index *cols_end, Callback callback, Executor &executor) = INTGEMM_LAZY_CHOOSE_CPU(run_executor, ExecutorWrapColumns<Callback, SIMD128::Kernels8>, ExecutorWrapColumns<Callback, NEONDOTPROD::Kernels8>, ExecutorWrapColumns<Callback, NEON::Kernels8>, ExecutorWrapColumnsCopy<Callback, AMX::Kernels8>, ExecutorWrapColumns<Callback, AVX512VNNI::Kernels8>, ExecutorWrapColumns<Callback, AVX512BW::Kernels8>, ExecutorWrapColumns<Callback, AVXVNNI::Kernels8>, ExecutorWrapColumns<Callback, AVX2::Kernels8>, ExecutorWrapColumns<Callback, SSSE3::Kernels8>, Unsupported_8bit::MultiplyColumns<Callback>, Unsupported_8bit::MultiplyColumns<Callback>);
+
+template <typename Callback>
+void (*Int8::MultiplySplitKImpl<Callback>::run)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) = INTGEMM_LAZY_CHOOSE_CPU(run, OMPParallelWrapSplitK<Callback, SIMD128::Kernels8>, OMPParallelWrapSplitK<Callback, NEONDOTPROD::Kernels8>, OMPParallelWrapSplitK<Callback, NEON::Kernels8>, OMPParallelWrapSplitK<Callback, AMX::Kernels8>, OMPParallelWrapSplitK<Callback, AVX512VNNI::Kernels8>, OMPParallelWrapSplitK<Callback, AVX512BW::Kernels8>, OMPParallelWrapSplitK<Callback, AVXVNNI::Kernels8>, OMPParallelWrapSplitK<Callback, AVX2::Kernels8>, OMPParallelWrapSplitK<Callback, SSSE3::Kernels8>, Unsupported_8bit::MultiplySplitK<Callback>, Unsupported_8bit::MultiplySplitK<Callback>);
+
+template <typename Callback>
+void (*Int8::MultiplySplitKImpl<Callback>::run_executor)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) = INTGEMM_LAZY_CHOOSE_CPU(run_executor, ExecutorWrapSplitK<Callback, SIMD128::Kernels8>, ExecutorWrapSplitK<Callback, NEONDOTPROD::Kernels8>, ExecutorWrapSplitK<Callback, NEON::Kernels8>, ExecutorWrapSplitK<Callback, AMX::Kernels8>, ExecutorWrapSplitK<Callback, AVX512VNNI::Kernels8>, ExecutorWrapSplitK<Callback, AVX512BW::Kernels8>, ExecutorWrapSplitK<Callback, AVXVNNI::Kernels8>, ExecutorWrapSplitK<Callback, AVX2::Kernels8>, ExecutorWrapSplitK<Callback, SSSE3::Kernels8>, Unsupported_8bit::MultiplySplitK<Callback>, Unsupported_8bit::MultiplySplitK<Callback>);
+
+// Choices come from Tune, which only offers kernels this CPU and build have.
+template <typename Callback>
+typename Int8::MultiplyTunedImpl<Callback>::Function Int8::MultiplyTunedImpl<Callback>::Get(const TuneChoice &choice) {
+  switch (choice.cpu) {
+    case CPUType::SIMD128: return Rows<SIMD128::Kernels8>(choice.rows);
+    case CPUType::NEONDOTPROD: return Rows<NEONDOTPROD::Kernels8>(choice.rows);
+    case CPUType::NEON: return Rows<NEON::Kernels8>(choice.rows);
+    case CPUType::AMX: return OMPParallelWrap<Callback, AMX::Kernels8>;
+    case CPUType::AVX512VNNI: return Rows<AVX512VNNI::Kernels8>(choice.rows);
+    case CPUType::AVX512BW: return Rows<AVX512BW::Kernels8>(choice.rows);
+    case CPUType::AVXVNNI: return Rows<AVXVNNI::Kernels8>(choice.rows);
+    case CPUType::AVX2: return Rows<AVX2::Kernels8>(choice.rows);
+    case CPUType::SSSE3: return Rows<SSSE3::Kernels8>(choice.rows);
+    default: return MultiplyImpl<Callback>::run;
+  }
+}
 
 /*
  * 8-bit matrix multiplication with shifting A by 127
@@ -234,9 +1064,30 @@ struct Int8Shift {
     QuantizeU(input, reinterpret_cast<uint8_t *>(output), quant_mult, rows * cols);
   }
 
+  // PrepareA into space from workspace, see Int8::PrepareA.
+  static inline int8_t *PrepareA(const float *input, float quant_mult, Index rows, Index cols, Workspace &workspace) {
+    int8_t *output = workspace.Allocate<int8_t>(static_cast<std::size_t>(rows) * cols);
+    PrepareA(input, output, quant_mult, rows, cols);
+    return output;
+  }
+
   // Multiply floats by quant_mult then convert to 8-bit integers with saturation.
   // A version that adds 127 to each number, making sure that all numbers are positive
   static void (*QuantizeU)(const float *input, uint8_t *output, float quant_mult, Index size);
+
+  // PrepareA choosing quant_mult from A, see Int8::QuantizeScaled.  Returns
+  // 1 / quant_mult for PrepareBias and the multiply's unquant_mult.
+  static inline float PrepareAScaled(const float *input, int8_t *output, Index rows, Index cols, ScaleStatistic statistic = ScaleStatistic::MaxAbsolute, float stddevs = 0.0f) {
+    return Int8::QuantizeUScaled(input, reinterpret_cast<uint8_t *>(output), rows * cols, statistic, stddevs);
+  }
+
+  // PrepareA of 16-bit floats, see Int8::QuantizeUFloat16.
+  static inline void PrepareA(const BFloat16 *input, int8_t *output, float quant_mult, Index rows, Index cols) {
+    Int8::QuantizeUFloat16(input, reinterpret_cast<uint8_t *>(output), quant_mult, rows * cols);
+  }
+  static inline void PrepareA(const Half *input, int8_t *output, float quant_mult, Index rows, Index cols) {
+    Int8::QuantizeUFloat16(input, reinterpret_cast<uint8_t *>(output), quant_mult, rows * cols);
+  }
   
   // Warning: the output of PrepareB depends on the CPU.
   // It will match the Multiply function on the same CPU though.
@@ -244,11 +1095,29 @@ struct Int8Shift {
     Int8::PrepareB(input, output, quant_mult, rows, cols);
   }
 
+  // PrepareB that also adds up each column of the quantized B into bias, a
+  // block of rows at a time while the block is still in cache.  Then
+  // bias.Write(bias_in, unquant_mult, bias_out) does what PrepareBias would.
+  static void PrepareB(const float *input, int8_t *output, float quant_mult, Index rows, Index cols, ShiftedBias &bias);
+
+  // See Int8::PrepareBColumns.  For PrepareBias, pass
+  // callbacks::UnquantizeColumnsAndAddBiasAndWrite(-127.0f / A_quant_mult, column_mults, bias, bias)
+  // where column_mults[c] = 1 / quant_mults[c].
+  static void PrepareBColumns(const float *input, int8_t *output, const float *quant_mults, Index rows, Index cols) {
+    Int8::PrepareBColumns(input, output, quant_mults, rows, cols);
+  }
+
   // Select columns from a prepared B matrix.  The number of selected columns must be a multiple of 8. 
   static void SelectColumnsB(const int8_t *input, int8_t *output, Index rows, const Index *cols_begin, const Index *cols_end) {
     Int8::SelectColumnsB(input, output, rows, cols_begin, cols_end);
   }
 
+  // SelectColumnsB that also selects the column sums from PrepareB.
+  static void SelectColumnsB(const int8_t *input, int8_t *output, Index rows, const Index *cols_begin, const Index *cols_end, const ShiftedBias &bias, ShiftedBias &selected) {
+    Int8::SelectColumnsB(input, output, rows, cols_begin, cols_end);
+    selected = bias.Select(cols_begin, cols_end);
+  }
+
   // A slightly faster version compared to the Int8 one (assuming a bias is used) because of better handling of the sign bit
   // Multiply C = A * B + Bias, presuming A, B and Bias have all been prepared (for A, PrepareAnew should be used
   template<class Callback>
@@ -256,6 +1125,24 @@ struct Int8Shift {
     MultiplyImpl<Callback>::run((const uint8_t *)A, B, A_rows, width, B_cols, callback);
   }
 
+  // Multiply using threads from executor instead of OpenMP.
+  template<class Callback>
+  static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) {
+    MultiplyImpl<Callback>::run_executor((const uint8_t *)A, B, A_rows, width, B_cols, callback, executor);
+  }
+
+  // PrepareA then Multiply without writing out the prepared A, see Int8::MultiplyFloatA.
+  template<class Callback>
+  static void MultiplyFloatA(const float *A, float quant_mult, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    MultiplyFloatAImpl<Callback>::run(A, quant_mult, B, A_rows, width, B_cols, callback);
+  }
+
+  // MultiplyFloatA using threads from executor instead of OpenMP.
+  template<class Callback>
+  static void MultiplyFloatA(const float *A, float quant_mult, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) {
+    MultiplyFloatAImpl<Callback>::run_executor(A, quant_mult, B, A_rows, width, B_cols, callback, executor);
+  }
+
   // This function prepares the bias for the Multiply routine that does unsigned * signed multiplication.
   // The function takes:
   // a preparedB matrix, width, B_cols and
@@ -272,6 +1159,19 @@ private:
   template <typename Callback>
   struct MultiplyImpl {
     static void (*run)(const uint8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback);
+    static void (*run_executor)(const uint8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor);
+  };
+
+  template <typename Callback>
+  struct MultiplyColumnsImpl {
+    static void (*run)(const int8_t *A, const int8_t *B, Index A_rows, Index width, const Index *cols_begin, const Index *cols_end, Callback callback);
+    static void (*run_executor)(const int8_t *A, const int8_t *B, Index A_rows, Index width, const Index *cols_begin, const Index *cols_end, Callback callback, Executor &executor);
+  };
+
+  template <typename Callback>
+  struct MultiplyFloatAImpl {
+    static void (*run)(const float *A, float quant_mult, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback);
+    static void (*run_executor)(const float *A, float quant_mult, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor);
   };
 
   template <typename Callback>
@@ -281,15 +1181,113 @@ private:
 };
 
 template <class Callback>
-void (*Int8Shift::MultiplyImpl<Callback>::run)(const uint8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) = ChooseCPU(
+void (*Int8Shift::MultiplyImpl<Callback>::run)(const uint8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) = INTGEMM_LAZY_CHOOSE_CPU(run, 
+    OMPParallelWrap8Shift<Callback, SIMD128::Kernels8>,
+    OMPParallelWrap8Shift<Callback, NEONDOTPROD::Kernels8>,
+    OMPParallelWrap8Shift<Callback, NEON::Kernels8>,
+    OMPParallelWrap8Shift<Callback, AMX::Kernels8>,
     OMPParallelWrap8Shift<Callback, AVX512VNNI::Kernels8>,
     OMPParallelWrap8Shift<Callback, AVX512BW::Kernels8>,
+    OMPParallelWrap8Shift<Callback, AVXVNNI::Kernels8>,
     OMPParallelWrap8Shift<Callback, AVX2::Kernels8>,
-    OMPParallelWrap8Shift<Callback, SSSE3::Kernels8>, 
-    Unsupported_8bit::Multiply8Shift<Callback>, Unsupported_8bit::Multiply8Shift<Callback>);
+    OMPParallelWrap8Shift<Callback, SSSE3::Kernels8>,
+    Unsupported_8bit::Multiply8Shift<Callback>,
+    Unsupported_8bit::Multiply8Shift<Callback>);
+
+template <class Callback>
+void (*Int8Shift::MultiplyImpl<Callback>::run_executor)(const uint8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) = INTGEMM_LAZY_CHOOSE_CPU(run_executor, 
+    ExecutorWrap8Shift<Callback, SIMD128::Kernels8>,
+    ExecutorWrap8Shift<Callback, NEONDOTPROD::Kernels8>,
+    ExecutorWrap8Shift<Callback, NEON::Kernels8>,
+    ExecutorWrap8Shift<Callback, AMX::Kernels8>,
+    ExecutorWrap8Shift<Callback, AVX512VNNI::Kernels8>,
+    ExecutorWrap8Shift<Callback, AVX512BW::Kernels8>,
+    ExecutorWrap8Shift<Callback, AVXVNNI::Kernels8>,
+    ExecutorWrap8Shift<Callback, AVX2::Kernels8>,
+    ExecutorWrap8Shift<Callback, SSSE3::Kernels8>,
+    Unsupported_8bit::Multiply8Shift<Callback>,
+    Unsupported_8bit::Multiply8Shift<Callback>);
+
+template <class Callback>
+void (*Int8Shift::MultiplyFloatAImpl<Callback>::run)(const float *A, float quant_mult, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) = INTGEMM_LAZY_CHOOSE_CPU(run, 
+    OMPParallelWrap8ShiftFloatA<Callback, SIMD128::Kernels8>,
+    OMPParallelWrap8ShiftFloatA<Callback, NEONDOTPROD::Kernels8>,
+    OMPParallelWrap8ShiftFloatA<Callback, NEON::Kernels8>,
+    OMPParallelWrap8ShiftFloatA<Callback, AMX::Kernels8>,
+    OMPParallelWrap8ShiftFloatA<Callback, AVX512VNNI::Kernels8>,
+    OMPParallelWrap8ShiftFloatA<Callback, AVX512BW::Kernels8>,
+    OMPParallelWrap8ShiftFloatA<Callback, AVXVNNI::Kernels8>,
+    OMPParallelWrap8ShiftFloatA<Callback, AVX2::Kernels8>,
+    OMPParallelWrap8ShiftFloatA<Callback, SSSE3::Kernels8>,
+    Unsupported_8bit::Multiply8ShiftFloatA<Callback>,
+    Unsupported_8bit::Multiply8ShiftFloatA<Callback>);
 
 template <class Callback>
-void (*Int8Shift::PrepareBiasImpl<Callback>::run)(const int8_t *B, Index width, Index B_cols, Callback callback) = ChooseCPU(AVX512VNNI::Kernels8::PrepareBias<Callback>, AVX512BW::Kernels8::PrepareBias<Callback>, AVX2::Kernels8::PrepareBias<Callback>, SSSE3::Kernels8::PrepareBias<Callback>, SSSE3::Kernels8::PrepareBias<Callback>, Unsupported_8bit::PrepareBias);
+void (*Int8Shift::MultiplyFloatAImpl<Callback>::run_executor)(const float *A, float quant_mult, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) = INTGEMM_LAZY_CHOOSE_CPU(run_executor, 
+    ExecutorWrap8ShiftFloatA<Callback, SIMD128::Kernels8>,
+    ExecutorWrap8ShiftFloatA<Callback, NEONDOTPROD::Kernels8>,
+    ExecutorWrap8ShiftFloatA<Callback, NEON::Kernels8>,
+    ExecutorWrap8ShiftFloatA<Callback, AMX::Kernels8>,
+    ExecutorWrap8ShiftFloatA<Callback, AVX512VNNI::Kernels8>,
+    ExecutorWrap8ShiftFloatA<Callback, AVX512BW::Kernels8>,
+    ExecutorWrap8ShiftFloatA<Callback, AVXVNNI::Kernels8>,
+    ExecutorWrap8ShiftFloatA<Callback, AVX2::Kernels8>,
+    ExecutorWrap8ShiftFloatA<Callback, SSSE3::Kernels8>,
+    Unsupported_8bit::Multiply8ShiftFloatA<Callback>,
+    Unsupported_8bit::Multiply8ShiftFloatA<Callback>);
+
+template <class Callback>
+void (*Int8Shift::PrepareBiasImpl<Callback>::run)(const int8_t *B, Index width, Index B_cols, Callback callback) = INTGEMM_LAZY_CHOOSE_CPU(run, SIMD128::Kernels8::PrepareBias<Callback>, NEONDOTPROD::Kernels8::PrepareBias<Callback>, NEON::Kernels8::PrepareBias<Callback>, AMX::Kernels8::PrepareBias<Callback>, AVX512VNNI::Kernels8::PrepareBias<Callback>, AVX512BW::Kernels8::PrepareBias<Callback>, AVXVNNI::Kernels8::PrepareBias<Callback>, AVX2::Kernels8::PrepareBias<Callback>, SSSE3::Kernels8::PrepareBias<Callback>, SSSE3::Kernels8::PrepareBias<Callback>, Unsupported_8bit::PrepareBias);
+
+/*
+ * 8-bit matrix multiplication with B stored in 4 bits
+ */
+struct Int4 {
+  using Integer = int8_t;
+
+  // Same shapes as Int8.
+  static constexpr TileInfo tile_info{1, 64, 64, 8};
+
+  // A is the same as for Int8.
+  static inline void PrepareA(const float *input, int8_t *output, float quant_mult, Index rows, Index cols) {
+    Int8::PrepareA(input, output, quant_mult, rows, cols);
+  }
+
+  // PrepareB for Int8 with values clamped to [-7, 7] then two to a byte, so
+  // output is rows * cols / 2 bytes.  Pick quant_mult like 7 / MaxAbsolute.
+  // Like Int8 the output depends on the CPU.
+  static void PrepareB(const float *input, int8_t *output, float quant_mult, Index rows, Index cols);
+
+  // Multiply C = A * B.  Each panel of B is unpacked into 8-bit registers in
+  // L1 and multiplied with the same kernels as Int8, so results match Int8
+  // with B clamped to [-7, 7].
+  template <typename Callback>
+  static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    MultiplyImpl<Callback>::run(A, B, A_rows, width, B_cols, callback);
+  }
+
+  // Multiply using threads from executor instead of OpenMP.
+  template <typename Callback>
+  static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) {
+    MultiplyImpl<Callback>::run_executor(A, B, A_rows, width, B_cols, callback, executor);
+  }
+
+  static const char *const kName;
+
+private:
+  template <typename Callback>
+  struct MultiplyImpl {
+    static void (*run)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback);
+    static void (*run_executor)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor);
+  };
+};
+
+// AMX prepares B for its tiles so 4-bit B uses the AVX512VNNI layout.
+template <typename Callback>
+void (*Int4::MultiplyImpl<Callback>::run)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) = INTGEMM_LAZY_CHOOSE_CPU(run, OMPParallelWrap4<Callback, SIMD128::Kernels8>, OMPParallelWrap4<Callback, NEONDOTPROD::Kernels8>, OMPParallelWrap4<Callback, NEON::Kernels8>, OMPParallelWrap4<Callback, AVX512VNNI::Kernels8>, OMPParallelWrap4<Callback, AVX512VNNI::Kernels8>, OMPParallelWrap4<Callback, AVX512BW::Kernels8>, OMPParallelWrap4<Callback, AVXVNNI::Kernels8>, OMPParallelWrap4<Callback, AVX2::Kernels8>, OMPParallelWrap4<Callback, SSSE3::Kernels8>, Unsupported_8bit::Multiply4<Callback>, Unsupported_8bit::Multiply4<Callback>);
+
+template <typename Callback>
+void (*Int4::MultiplyImpl<Callback>::run_executor)(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) = INTGEMM_LAZY_CHOOSE_CPU(run_executor, ExecutorWrap4<Callback, SIMD128::Kernels8>, ExecutorWrap4<Callback, NEONDOTPROD::Kernels8>, ExecutorWrap4<Callback, NEON::Kernels8>, ExecutorWrap4<Callback, AVX512VNNI::Kernels8>, ExecutorWrap4<Callback, AVX512VNNI::Kernels8>, ExecutorWrap4<Callback, AVX512BW::Kernels8>, ExecutorWrap4<Callback, AVXVNNI::Kernels8>, ExecutorWrap4<Callback, AVX2::Kernels8>, ExecutorWrap4<Callback, SSSE3::Kernels8>, Unsupported_8bit::Multiply4<Callback>, Unsupported_8bit::Multiply4<Callback>);
 
 /*
  * 16-bit matrix multiplication
@@ -307,6 +1305,13 @@ struct Int16 {
     Quantize(input, output, quant_mult, rows * cols);
   }
 
+  // PrepareA into space from workspace, see Int8::PrepareA.
+  static inline int16_t *PrepareA(const float *input, float quant_mult, Index rows, Index cols, Workspace &workspace) {
+    int16_t *output = workspace.Allocate<int16_t>(static_cast<std::size_t>(rows) * cols);
+    PrepareA(input, output, quant_mult, rows, cols);
+    return output;
+  }
+
   // Multiply floats by quant_mult then convert to 16-bit integers with saturation.
   // input
   static void (*Quantize)(const float *input, int16_t *output, float quant_mult, Index size);
@@ -315,6 +1320,20 @@ struct Int16 {
   // It will match the Multiply function on the same CPU though.
   static void (*PrepareB)(const float *input, int16_t *output, float quant_mult, Index rows, Index cols);
 
+  // Int8::PrepareBRows and PrepareBStream for 16-bit; row_begin and row_end
+  // are multiples of 32.
+  static void PrepareBRows(const float *input, int16_t *output, float quant_mult, Index rows, Index cols, Index row_begin, Index row_end);
+
+  template <class Reader>
+  static void PrepareBStream(Reader read, int16_t *output, float quant_mult, Index rows, Index cols, Index chunk_rows = 256) {
+    AlignedVector<float> buffer(static_cast<std::size_t>(std::min(chunk_rows, rows)) * cols);
+    for (Index begin = 0; begin < rows; begin += chunk_rows) {
+      const Index end = std::min(begin + chunk_rows, rows);
+      read(buffer.begin(), begin, end);
+      PrepareBRows(buffer.begin(), output, quant_mult, rows, cols, begin, end);
+    }
+  }
+
   // Convert from a B that was already transposed (routine not provided) and
   // quantized (e.g. with Quantize) to the CPU-dependent format used for
   // Multiply.  This is useful for storing a quantized model on disk then in a
@@ -326,6 +1345,10 @@ struct Int16 {
   // a quantized model on disk then in a CPU-independent fashion.
   static void (*PrepareBTransposed)(const float *input, int16_t *output, float quant_mul, Index inner, Index B_untransposed_cols);
 
+  // PrepareB and PrepareBTransposed with a quant_mult per column, see Int8::PrepareBColumns.
+  static void PrepareBColumns(const float *input, int16_t *output, const float *quant_mults, Index rows, Index cols);
+  static void PrepareBTransposedColumns(const float *input, int16_t *output, const float *quant_mults, Index inner, Index B_untransposed_cols);
+
   // Select columns from a prepared B matrix.  The number of selected columns must be a multiple of 8. 
   static void (*SelectColumnsB)(const int16_t *input, int16_t *output, Index rows, const Index *cols_begin, const Index *cols_end);
 
@@ -335,31 +1358,162 @@ struct Int16 {
     MultiplyImpl<Callback>::run(A, B, A_rows, width, B_cols, callback);
   }
 
+  // Multiply using threads from executor instead of OpenMP.
+  template <typename Callback>
+  static void Multiply(const int16_t *A, const int16_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) {
+    MultiplyImpl<Callback>::run_executor(A, B, A_rows, width, B_cols, callback, executor);
+  }
+
+  // Multiply with row r of A at A + r * lda, for A that is a block of columns
+  // of a wider prepared matrix.  lda must be a multiple of 32.  For C, wrap
+  // the callback with callbacks::Strided(ldc, callback).
+  template <typename Callback>
+  static void Multiply(const int16_t *A, Index lda, const int16_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    MultiplyImpl<Callback>::run_strided(A, lda, B, A_rows, width, B_cols, callback);
+  }
+
+  // Strided Multiply using threads from executor instead of OpenMP.
+  template <typename Callback>
+  static void Multiply(const int16_t *A, Index lda, const int16_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) {
+    MultiplyImpl<Callback>::run_strided_executor(A, lda, B, A_rows, width, B_cols, callback, executor);
+  }
+
   static const char *const kName;
 
 private:
   template <typename Callback>
   struct MultiplyImpl {
     static void (*run)(const int16_t *A, const int16_t *B, Index A_rows, Index width, Index B_cols, Callback callback);
+    static void (*run_executor)(const int16_t *A, const int16_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor);
+    static void (*run_strided)(const int16_t *A, Index lda, const int16_t *B, Index A_rows, Index width, Index B_cols, Callback callback);
+    static void (*run_strided_executor)(const int16_t *A, Index lda, const int16_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor);
+  };
+};
+
+template <typename Callback>
+void (*Int16::MultiplyImpl<Callback>::run)(const int16_t *A, const int16_t *B, Index A_rows, Index width, Index B_cols, Callback callback) = INTGEMM_LAZY_CHOOSE_CPU(run, OMPParallelWrap<Callback, SSE2::Kernels16>, OMPParallelWrap<Callback, NEON::Kernels16>, OMPParallelWrap<Callback, NEON::Kernels16>, OMPParallelWrap<Callback, AVX512VNNI::Kernels16>, OMPParallelWrap<Callback, AVX512VNNI::Kernels16>, OMPParallelWrap<Callback, AVX512BW::Kernels16>, OMPParallelWrap<Callback, AVX2::Kernels16>, OMPParallelWrap<Callback, AVX2::Kernels16>, OMPParallelWrap<Callback, SSE2::Kernels16>, OMPParallelWrap<Callback, SSE2::Kernels16>, Unsupported_16bit::Multiply<Callback>);
+
+template <typename Callback>
+void (*Int16::MultiplyImpl<Callback>::run_executor)(const int16_t *A, const int16_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) = INTGEMM_LAZY_CHOOSE_CPU(run_executor, ExecutorWrap<Callback, SSE2::Kernels16>, ExecutorWrap<Callback, NEON::Kernels16>, ExecutorWrap<Callback, NEON::Kernels16>, ExecutorWrap<Callback, AVX512VNNI::Kernels16>, ExecutorWrap<Callback, AVX512VNNI::Kernels16>, ExecutorWrap<Callback, AVX512BW::Kernels16>, ExecutorWrap<Callback, AVX2::Kernels16>, ExecutorWrap<Callback, AVX2::Kernels16>, ExecutorWrap<Callback, SSE2::Kernels16>, ExecutorWrap<Callback, SSE2::Kernels16>, Unsupported_16bit::Multiply<Callback>);
+
+template <typename Callback>
+void (*Int16::MultiplyImpl<Callback>::run_strided)(const int16_t *A, Index lda, const int16_t *B, Index A_rows, Index width, Index B_cols, Callback callback) = INTGEMM_LAZY_CHOOSE_CPU(run_strided, OMPParallelWrapStrided<Callback, SSE2::Kernels16>, OMPParallelWrapStrided<Callback, NEON::Kernels16>, OMPParallelWrapStrided<Callback, NEON::Kernels16>, OMPParallelWrapStrided<Callback, AVX512VNNI::Kernels16>, OMPParallelWrapStrided<Callback, AVX512VNNI::Kernels16>, OMPParallelWrapStrided<Callback, AVX512BW::Kernels16>, OMPParallelWrapStrided<Callback, AVX2::Kernels16>, OMPParallelWrapStrided<Callback, AVX2::Kernels16>, OMPParallelWrapStrided<Callback, SSE2::Kernels16>, OMPParallelWrapStrided<Callback, SSE2::Kernels16>, Unsupported_16bit::Multiply<Callback>);
+
+template <typename Callback>
+void (*Int16::MultiplyImpl<Callback>::run_strided_executor)(const int16_t *A, Index lda, const int16_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) = INTGEMM_LAZY_CHOOSE_CPU(run_strided_executor, ExecutorWrapStrided<Callback, SSE2::Kernels16>, ExecutorWrapStrided<Callback, NEON::Kernels16>, ExecutorWrapStrided<Callback, NEON::Kernels16>, ExecutorWrapStrided<Callback, AVX512VNNI::Kernels16>, ExecutorWrapStrided<Callback, AVX512VNNI::Kernels16>, ExecutorWrapStrided<Callback, AVX512BW::Kernels16>, ExecutorWrapStrided<Callback, AVX2::Kernels16>, ExecutorWrapStrided<Callback, AVX2::Kernels16>, ExecutorWrapStrided<Callback, SSE2::Kernels16>, ExecutorWrapStrided<Callback, SSE2::Kernels16>, Unsupported_16bit::Multiply<Callback>);
+
+/*
+ * 16-bit A times 8-bit B, for layers that need 16-bit activations but whose
+ * weights are fine in 8 bits.  B takes half the memory and bandwidth of
+ * Int16's and is sign extended to 16 bits in registers.
+ */
+struct Int16By8 {
+  // Same shapes as Int16.
+  static constexpr TileInfo tile_info{1, 32, 32, 8};
+
+  // A is the same as for Int16.
+  static inline void PrepareA(const float *input, int16_t *output, float quant_mult, Index rows, Index cols) {
+    Int16::PrepareA(input, output, quant_mult, rows, cols);
+  }
+
+  // Quantize B to 8 bits as Int8 does and lay it out for Multiply.  Like
+  // Int8 the output depends on the CPU.
+  static void PrepareB(const float *input, int8_t *output, float quant_mult, Index rows, Index cols);
+
+  // Multiply C = A * B, presuming A and B have been prepared.  Sums are 32-bit
+  // like Int16's; unquantize by 1 / (A's quant_mult * B's quant_mult).
+  template <typename Callback>
+  static void Multiply(const int16_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    MultiplyImpl<Callback>::run(A, B, A_rows, width, B_cols, callback);
+  }
+
+  // Multiply using threads from executor instead of OpenMP.
+  template <typename Callback>
+  static void Multiply(const int16_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) {
+    MultiplyImpl<Callback>::run_executor(A, B, A_rows, width, B_cols, callback, executor);
+  }
+
+  static const char *const kName;
+
+private:
+  template <typename Callback>
+  struct MultiplyImpl {
+    static void (*run)(const int16_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback);
+    static void (*run_executor)(const int16_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor);
   };
 };
 
 template <typename Callback>
-void (*Int16::MultiplyImpl<Callback>::run)(const int16_t *A, const int16_t *B, Index A_rows, Index width, Index B_cols, Callback callback) = ChooseCPU(OMPParallelWrap<Callback, AVX512BW::Kernels16> /*TODO VNNI 16-bit. */, OMPParallelWrap<Callback, AVX512BW::Kernels16>, OMPParallelWrap<Callback, AVX2::Kernels16>, OMPParallelWrap<Callback, SSE2::Kernels16>, OMPParallelWrap<Callback, SSE2::Kernels16>, Unsupported_16bit::Multiply<Callback>);
+void (*Int16By8::MultiplyImpl<Callback>::run)(const int16_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) = INTGEMM_LAZY_CHOOSE_CPU(run, OMPParallelWrapMixed<Callback, SSE2::Kernels16>, OMPParallelWrapMixed<Callback, NEON::Kernels16>, OMPParallelWrapMixed<Callback, NEON::Kernels16>, OMPParallelWrapMixed<Callback, AVX512VNNI::Kernels16>, OMPParallelWrapMixed<Callback, AVX512VNNI::Kernels16>, OMPParallelWrapMixed<Callback, AVX512BW::Kernels16>, OMPParallelWrapMixed<Callback, AVX2::Kernels16>, OMPParallelWrapMixed<Callback, AVX2::Kernels16>, OMPParallelWrapMixed<Callback, SSE2::Kernels16>, OMPParallelWrapMixed<Callback, SSE2::Kernels16>, Unsupported_16bit::MultiplyMixed<Callback>);
+
+template <typename Callback>
+void (*Int16By8::MultiplyImpl<Callback>::run_executor)(const int16_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) = INTGEMM_LAZY_CHOOSE_CPU(run_executor, ExecutorWrapMixed<Callback, SSE2::Kernels16>, ExecutorWrapMixed<Callback, NEON::Kernels16>, ExecutorWrapMixed<Callback, NEON::Kernels16>, ExecutorWrapMixed<Callback, AVX512VNNI::Kernels16>, ExecutorWrapMixed<Callback, AVX512VNNI::Kernels16>, ExecutorWrapMixed<Callback, AVX512BW::Kernels16>, ExecutorWrapMixed<Callback, AVX2::Kernels16>, ExecutorWrapMixed<Callback, AVX2::Kernels16>, ExecutorWrapMixed<Callback, SSE2::Kernels16>, ExecutorWrapMixed<Callback, SSE2::Kernels16>, Unsupported_16bit::MultiplyMixed<Callback>);
+
+/* The dispatch pointers of the commonest callbacks are instantiated once in
+ * the library, instances_int8.cc and instances_int16.cc, rather than in every
+ * file that multiplies, which would compile every ISA's kernels again.  Other
+ * callbacks are instantiated where they are used.  Define
+ * INTGEMM_NO_EXTERN_TEMPLATES to instantiate these locally too, for example
+ * when building the headers without the library.
+ */
+#define INTGEMM_INT8_INSTANCES(prefix, Callback) \
+prefix template struct Int8::MultiplyImpl<Callback>; \
+prefix template struct Int8::MultiplyAppendableImpl<Callback>; \
+prefix template struct Int8::MultiplySparseImpl<Callback>; \
+prefix template struct Int8::MultiplyColumnsImpl<Callback>; \
+prefix template struct Int8::MultiplyFloatAImpl<Callback>; \
+prefix template struct Int8::MultiplyNTImpl<Callback>; \
+prefix template struct Int8::MultiplySplitKImpl<Callback>; \
+prefix template struct Int8Shift::MultiplyImpl<Callback>; \
+prefix template struct Int8Shift::PrepareBiasImpl<Callback>; \
+prefix template struct Int8Shift::MultiplyFloatAImpl<Callback>; \
+prefix template struct Int4::MultiplyImpl<Callback>;
+
+#define INTGEMM_INT16_INSTANCES(prefix, Callback) \
+prefix template struct Int16::MultiplyImpl<Callback>; \
+prefix template struct Int16By8::MultiplyImpl<Callback>;
+
+#ifndef INTGEMM_NO_EXTERN_TEMPLATES
+INTGEMM_INT8_INSTANCES(extern, callbacks::UnquantizeAndWrite)
+INTGEMM_INT8_INSTANCES(extern, callbacks::UnquantizeAndAddBiasAndWrite)
+INTGEMM_INT16_INSTANCES(extern, callbacks::UnquantizeAndWrite)
+INTGEMM_INT16_INSTANCES(extern, callbacks::UnquantizeAndAddBiasAndWrite)
+#endif
 
 extern const CPUType kCPU;
 
-// Get the maximum absolute value of an array of floats. The number of floats must be a multiple of 16 and 64-byte aligned.
+// Get the maximum absolute value of an array of floats. The array must be 64-byte aligned; any number of floats.
 extern float (*MaxAbsolute)(const float *begin, const float *end);
 
 // Get a Quantization value that is equant to the mean of the data +N standard deviations. Use 2 by default
 extern MeanStd (*VectorMeanStd)(const float *begin, const float *end, bool);
 
+// Add the count of each HistogramBin of [begin, end) to counts, which has
+// kHistogramBins entries.  Any alignment.  See AbsHistogram in calibrate.h.
+extern void (*HistogramAbsolute)(const float *begin, const float *end, uint64_t *counts);
+
 /* Returns the Mean and the Standard deviation of a vector. 
  * If "absolute" is set to true, it computes the mean and the standard deviation of the absolute values of the vector */
 static inline MeanStd GetVectorMeanStd(const float * begin, const float * end, bool absolute=false) {
   return VectorMeanStd(begin, end, absolute);
 }
 
+/* Finish callbacks::UnquantizeAndAddBiasAndSoftmax: scale each tile of C,
+ * rows x cols, by its share of the row's sum.  tile_stats is what the callback
+ * wrote.  Run after the multiply returns.  Rows are split over OpenMP threads
+ * once C is longer than kElementwiseGrain, or over executor. */
+void FinishSoftmax(float *C, const float *tile_stats, Index rows, Index cols);
+void FinishSoftmax(float *C, const float *tile_stats, Index rows, Index cols, Executor &executor);
+
+// Finish callbacks::UnquantizeAndAddBiasAndLogSoftmax: subtract each row's log sum exp.
+void FinishLogSoftmax(float *C, const float *tile_stats, Index rows, Index cols);
+void FinishLogSoftmax(float *C, const float *tile_stats, Index rows, Index cols, Executor &executor);
+
+/* Layer norm of C, rows x cols, in place using the row_stats written by
+ * callbacks::UnquantizeAndAddBiasAndResidualAndWrite:
+ * (C - mean) / sqrt(variance + epsilon) * gamma + beta.  gamma and beta have
+ * cols values and either may be nullptr to skip it. */
+void LayerNorm(float *C, const double *row_stats, const float *gamma, const float *beta, Index rows, Index cols, float epsilon = 1e-5f);
+
 
 } // namespace intgemm
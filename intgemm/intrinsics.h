@@ -3,12 +3,16 @@
 #include "intgemm/intgemm_config.h"
 #include "types.h"
 
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+#include <arm_neon.h>
+#else
 #include <tmmintrin.h>
 #include <emmintrin.h>
 #include <xmmintrin.h>
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 #include <immintrin.h>
 #endif
+#endif
 #ifdef INTGEMM_WORMHOLE
 #include <wasm_simd128.h>
 #endif
@@ -35,6 +39,69 @@ template <class Register> static inline Register setzero_pd();
 template <class Register> static inline Register setzero_ps();
 template <class Register> static inline Register setzero_si();
 
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+/*
+ *
+ * NEON
+ *
+ * Only what the shared statistics and callback code needs.  The NEON backends otherwise
+ * call the ACLE intrinsics directly because those are typed per element.
+ *
+ */
+INTGEMM_NEON static inline int32x4_t add_epi32(int32x4_t a, int32x4_t b) {
+  return vaddq_s32(a, b);
+}
+INTGEMM_NEON static inline float32x4_t add_ps(float32x4_t a, float32x4_t b) {
+  return vaddq_f32(a, b);
+}
+INTGEMM_NEON static inline float32x4_t and_ps(float32x4_t first, float32x4_t second) {
+  return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(first), vreinterpretq_u32_f32(second)));
+}
+INTGEMM_NEON static inline float32x4_t cast_ps(int32x4_t a) {
+  return vreinterpretq_f32_s32(a);
+}
+INTGEMM_NEON static inline int32x4_t cast_si(float32x4_t a) {
+  return vreinterpretq_s32_f32(a);
+}
+INTGEMM_NEON static inline float32x4_t cvtepi32_ps(int32x4_t arg) {
+  return vcvtq_f32_s32(arg);
+}
+template <> INTGEMM_NEON inline float32x4_t loadu_ps(const float* mem_addr) {
+  return vld1q_f32(mem_addr);
+}
+INTGEMM_NEON static inline float32x4_t max_ps(float32x4_t a, float32x4_t b) {
+  return vmaxq_f32(a, b);
+}
+// Like x86, return b where a is NaN.
+INTGEMM_NEON static inline float32x4_t min_ps(float32x4_t a, float32x4_t b) {
+  return vminnmq_f32(a, b);
+}
+INTGEMM_NEON static inline float32x4_t mul_ps(float32x4_t a, float32x4_t b) {
+  return vmulq_f32(a, b);
+}
+template <> INTGEMM_NEON inline int32x4_t set1_epi32<int32x4_t>(int32_t to) {
+  return vdupq_n_s32(to);
+}
+template <> INTGEMM_NEON inline float32x4_t set1_ps<float32x4_t>(float to) {
+  return vdupq_n_f32(to);
+}
+template <> INTGEMM_NEON inline float32x4_t setzero_ps<float32x4_t>() {
+  return vdupq_n_f32(0.0f);
+}
+template <int imm8> INTGEMM_NEON static inline int32x4_t srli_epi32(int32x4_t a) {
+  return vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(a), imm8));
+}
+INTGEMM_NEON static inline void storeu_ps(float* mem_addr, float32x4_t a) {
+  vst1q_f32(mem_addr, a);
+}
+INTGEMM_NEON static inline int32x4_t sub_epi32(int32x4_t a, int32x4_t b) {
+  return vsubq_s32(a, b);
+}
+INTGEMM_NEON static inline float32x4_t sub_ps(float32x4_t a, float32x4_t b) {
+  return vsubq_f32(a, b);
+}
+
+#else
 /*
  *
  * SSE2
@@ -70,9 +137,21 @@ INTGEMM_SSE2 static inline __m128 andnot_ps(__m128 a, __m128 b) {
 INTGEMM_SSE2 static inline __m128i and_si(__m128i a, __m128i b) {
   return _mm_and_si128(a, b);
 }
+INTGEMM_SSE2 static inline __m128i andnot_si(__m128i a, __m128i b) {
+  return _mm_andnot_si128(a, b);
+}
 INTGEMM_SSE2 static inline __m128 cast_ps(__m128i a) {
   return _mm_castsi128_ps(a);
 }
+INTGEMM_SSE2 static inline __m128i cast_si(__m128 a) {
+  return _mm_castps_si128(a);
+}
+INTGEMM_SSE2 static inline __m128i cmpeq_epi32(__m128i a, __m128i b) {
+  return _mm_cmpeq_epi32(a, b);
+}
+INTGEMM_SSE2 static inline __m128i cmpgt_epi32(__m128i a, __m128i b) {
+  return _mm_cmpgt_epi32(a, b);
+}
 INTGEMM_SSE2 static inline __m128 cvtepi32_ps(__m128i arg) {
   return _mm_cvtepi32_ps(arg);
 }
@@ -86,8 +165,19 @@ INTGEMM_SSE2 static inline __m128 div_ps(__m128 a, __m128 b) {
   return _mm_div_ps(a, b);
 }
 /*
- * Missing i32gather_ps for SSE2
+ * SSE2 has no gather so load the lanes one at a time.
  */
+template <unsigned Scale>
+INTGEMM_SSE2 static inline __m128 i32gather_ps(float const *base_addr, __m128i vindex) {
+  alignas(16) int32_t index[4];
+  _mm_store_si128(reinterpret_cast<__m128i*>(index), vindex);
+  const char *base = reinterpret_cast<const char*>(base_addr);
+  return _mm_setr_ps(
+      *reinterpret_cast<const float*>(base + index[0] * static_cast<int32_t>(Scale)),
+      *reinterpret_cast<const float*>(base + index[1] * static_cast<int32_t>(Scale)),
+      *reinterpret_cast<const float*>(base + index[2] * static_cast<int32_t>(Scale)),
+      *reinterpret_cast<const float*>(base + index[3] * static_cast<int32_t>(Scale)));
+}
 template <> INTGEMM_SSE2 inline __m128 load_ps<__m128>(const float* from) {
   return _mm_load_ps(from);
 }
@@ -179,6 +269,9 @@ INTGEMM_SSSE3 static inline __m128i sign_epi8(__m128i first, __m128i second) {
 template <int imm8> INTGEMM_SSE2 static inline __m128i slli_epi16(__m128i a) {
   return _mm_slli_epi16(a, imm8);
 }
+template <int imm8> INTGEMM_SSE2 static inline __m128i slli_epi32(__m128i a) {
+  return _mm_slli_epi32(a, imm8);
+}
 template <int imm8> INTGEMM_SSE2 static inline __m128i srai_epi16(__m128i a) {
   return _mm_srai_epi16(a, imm8);
 }
@@ -188,9 +281,15 @@ template <int imm8> INTGEMM_SSE2 static inline __m128i srai_epi32(__m128i a) {
 template <int imm8> INTGEMM_SSE2 static inline __m128i srli_epi16(__m128i a) {
   return _mm_srli_epi16(a, imm8);
 }
+template <int imm8> INTGEMM_SSE2 static inline __m128i srli_epi32(__m128i a) {
+  return _mm_srli_epi32(a, imm8);
+}
 INTGEMM_SSE2 static inline void storeu_ps(float* mem_addr, __m128 a) {
   _mm_storeu_ps(mem_addr, a);
 }
+INTGEMM_SSE2 static inline __m128i sub_epi32(__m128i a, __m128i b) {
+  return _mm_sub_epi32(a, b);
+}
 INTGEMM_SSE2 static inline __m128d sub_pd(__m128d a, __m128d b) {
   return _mm_sub_pd(a, b);
 }
@@ -262,9 +361,21 @@ INTGEMM_AVX2 static inline __m256 andnot_ps(__m256 a, __m256 b) {
 INTGEMM_AVX2 static inline __m256i and_si(__m256i a, __m256i b) {
   return _mm256_and_si256(a, b);
 }
+INTGEMM_AVX2 static inline __m256i andnot_si(__m256i a, __m256i b) {
+  return _mm256_andnot_si256(a, b);
+}
 INTGEMM_AVX2 static inline __m256 cast_ps(__m256i a) {
   return _mm256_castsi256_ps(a);
 }
+INTGEMM_AVX2 static inline __m256i cast_si(__m256 a) {
+  return _mm256_castps_si256(a);
+}
+INTGEMM_AVX2 static inline __m256i cmpeq_epi32(__m256i a, __m256i b) {
+  return _mm256_cmpeq_epi32(a, b);
+}
+INTGEMM_AVX2 static inline __m256i cmpgt_epi32(__m256i a, __m256i b) {
+  return _mm256_cmpgt_epi32(a, b);
+}
 INTGEMM_AVX2 static inline __m256 cvtepi32_ps(__m256i arg) {
   return _mm256_cvtepi32_ps(arg);
 }
@@ -362,6 +473,9 @@ INTGEMM_AVX2 static inline __m256i sign_epi8(__m256i first, __m256i second) {
 template <int imm8> INTGEMM_AVX2 static inline __m256i slli_epi16(__m256i a) {
   return _mm256_slli_epi16(a, imm8);
 }
+template <int imm8> INTGEMM_AVX2 static inline __m256i slli_epi32(__m256i a) {
+  return _mm256_slli_epi32(a, imm8);
+}
 template <int imm8> INTGEMM_AVX2 static inline __m256i srai_epi16(__m256i a) {
   return _mm256_srai_epi16(a, imm8);
 }
@@ -371,9 +485,15 @@ template <int imm8> INTGEMM_AVX2 static inline __m256i srai_epi32(__m256i a) {
 template <int imm8> INTGEMM_AVX2 static inline __m256i srli_epi16(__m256i a) {
   return _mm256_srli_epi16(a, imm8);
 }
+template <int imm8> INTGEMM_AVX2 static inline __m256i srli_epi32(__m256i a) {
+  return _mm256_srli_epi32(a, imm8);
+}
 INTGEMM_AVX2 static inline void storeu_ps(float* mem_addr, __m256 a) {
   _mm256_storeu_ps(mem_addr, a);
 }
+INTGEMM_AVX2 static inline __m256i sub_epi32(__m256i a, __m256i b) {
+  return _mm256_sub_epi32(a, b);
+}
 INTGEMM_AVX2 static inline __m256d sub_pd(__m256d a, __m256d b) {
   return _mm256_sub_pd(a, b);
 }
@@ -446,9 +566,22 @@ INTGEMM_AVX512DQ static inline __m512 andnot_ps(__m512 a, __m512 b) {
 INTGEMM_AVX512BW static inline __m512i and_si(__m512i a, __m512i b) {
   return _mm512_and_si512(a, b);
 }
+INTGEMM_AVX512BW static inline __m512i andnot_si(__m512i a, __m512i b) {
+  return _mm512_andnot_si512(a, b);
+}
 INTGEMM_AVX512F static inline __m512 cast_ps(__m512i a) {
   return _mm512_castsi512_ps(a);
 }
+INTGEMM_AVX512BW static inline __m512i cast_si(__m512 a) {
+  return _mm512_castps_si512(a);
+}
+// Compares make a mask on AVX512 so widen it to a register like the others.
+INTGEMM_AVX512DQ static inline __m512i cmpeq_epi32(__m512i a, __m512i b) {
+  return _mm512_movm_epi32(_mm512_cmpeq_epi32_mask(a, b));
+}
+INTGEMM_AVX512DQ static inline __m512i cmpgt_epi32(__m512i a, __m512i b) {
+  return _mm512_movm_epi32(_mm512_cmpgt_epi32_mask(a, b));
+}
 INTGEMM_AVX512BW static inline __m512 cvtepi32_ps(__m512i arg) {
   return _mm512_cvtepi32_ps(arg);
 }
@@ -560,6 +693,9 @@ template <> INTGEMM_AVX512BW inline __m512 load_ps<__m512>(const float* from) {
 template <int imm8> INTGEMM_AVX512BW static inline __m512i slli_epi16(__m512i a) {
   return _mm512_slli_epi16(a, imm8);
 }
+template <int imm8> INTGEMM_AVX512BW static inline __m512i slli_epi32(__m512i a) {
+  return _mm512_slli_epi32(a, imm8);
+}
 template <int imm8> INTGEMM_AVX512BW static inline __m512i srai_epi16(__m512i a) {
   return _mm512_srai_epi16(a, imm8);
 }
@@ -569,9 +705,15 @@ template <int imm8> INTGEMM_AVX512BW static inline __m512i srai_epi32(__m512i a)
 template <int imm8> INTGEMM_AVX512BW static inline __m512i srli_epi16(__m512i a) {
   return _mm512_srli_epi16(a, imm8);
 }
+template <int imm8> INTGEMM_AVX512BW static inline __m512i srli_epi32(__m512i a) {
+  return _mm512_srli_epi32(a, imm8);
+}
 INTGEMM_AVX512BW static inline void storeu_ps(float* mem_addr, __m512 a) {
   _mm512_storeu_ps(mem_addr, a);
 }
+INTGEMM_AVX512BW static inline __m512i sub_epi32(__m512i a, __m512i b) {
+  return _mm512_sub_epi32(a, b);
+}
 INTGEMM_AVX512BW static inline __m512d sub_pd(__m512d a, __m512d b) {
   return _mm512_sub_pd(a, b);
 }
@@ -608,4 +750,6 @@ INTGEMM_AVX512BW static inline __m512i xor_si(__m512i a, __m512i b) {
 
 #endif
 
+#endif // INTGEMM_COMPILER_SUPPORTS_NEON
+
 }
@@ -7,10 +7,25 @@
 #include "vec_traits.h"
 
 #include <cstdlib>
+#include <cstring>
 
+namespace intgemm {
+namespace kernels {
+
+// A register of floats converted from the 16-bit floats at input + offset.
+template <class Register> static inline Register load_float16(const BFloat16* input, Index offset);
+template <class Register> static inline Register load_float16(const Half* input, Index offset);
+
+} // namespace kernels
+} // namespace intgemm
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+#include "kernels/neon.inl"
+#else
 #define KERNELS_THIS_IS_SSE2
 #include "kernels/implementations.inl"
 #undef KERNELS_THIS_IS_SSE2
+#endif
 
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 #define KERNELS_THIS_IS_AVX2
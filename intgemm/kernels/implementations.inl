@@ -46,6 +46,169 @@ CPU_ATTR static inline void write(vd input, double* output, Index offset) {
   *reinterpret_cast<vd*>(output + offset) = input;
 }
 
+/*
+ * Write with a non-temporal store that bypasses the cache, for output that
+ * won't be read again soon.  output + offset must be aligned to the vector.
+ * The stores are weakly ordered: sfence before another thread reads them.
+ */
+#if defined(KERNELS_THIS_IS_SSE2)
+  #define INTGEMM_STREAM_SI(address, input) _mm_stream_si128(reinterpret_cast<__m128i*>(address), input)
+  #define INTGEMM_STREAM_PS _mm_stream_ps
+  #define INTGEMM_STREAM_PD _mm_stream_pd
+#elif defined(KERNELS_THIS_IS_AVX2)
+  #define INTGEMM_STREAM_SI(address, input) _mm256_stream_si256(reinterpret_cast<__m256i*>(address), input)
+  #define INTGEMM_STREAM_PS _mm256_stream_ps
+  #define INTGEMM_STREAM_PD _mm256_stream_pd
+#else
+  #define INTGEMM_STREAM_SI(address, input) _mm512_stream_si512(reinterpret_cast<__m512i*>(address), input)
+  #define INTGEMM_STREAM_PS _mm512_stream_ps
+  #define INTGEMM_STREAM_PD _mm512_stream_pd
+#endif
+
+CPU_ATTR static inline void write_stream(vi input, int8_t* output, Index offset) {
+  INTGEMM_STREAM_SI(output + offset, input);
+}
+
+CPU_ATTR static inline void write_stream(vi input, int16_t* output, Index offset) {
+  INTGEMM_STREAM_SI(output + offset, input);
+}
+
+CPU_ATTR static inline void write_stream(vi input, int* output, Index offset) {
+  INTGEMM_STREAM_SI(output + offset, input);
+}
+
+CPU_ATTR static inline void write_stream(vf input, float* output, Index offset) {
+  INTGEMM_STREAM_PS(output + offset, input);
+}
+
+CPU_ATTR static inline void write_stream(vd input, double* output, Index offset) {
+  INTGEMM_STREAM_PD(output + offset, input);
+}
+
+#undef INTGEMM_STREAM_SI
+#undef INTGEMM_STREAM_PS
+#undef INTGEMM_STREAM_PD
+
+/*
+ * Write each 32-bit lane as a byte saturated to [-127, 127], as Quantize
+ * does, so the output is the prepared A of an 8-bit multiply.  The uint8_t
+ * version adds 127 as QuantizeU does for Int8Shift.
+ */
+CPU_ATTR static inline __m128i saturate32to8(vi input) {
+#if defined(KERNELS_THIS_IS_SSE2)
+  // No _mm_max_epi8 in SSE2, so clamp as 16-bit.
+  auto words = _mm_max_epi16(_mm_packs_epi32(input, input), _mm_set1_epi16(-127));
+  return _mm_packs_epi16(words, words);
+#elif defined(KERNELS_THIS_IS_AVX2)
+  auto words = _mm_packs_epi32(_mm256_castsi256_si128(input), _mm256_extracti128_si256(input, 1));
+  words = _mm_max_epi16(words, _mm_set1_epi16(-127));
+  return _mm_packs_epi16(words, words);
+#else
+  return _mm_max_epi8(_mm512_cvtsepi32_epi8(input), _mm_set1_epi8(-127));
+#endif
+}
+
+CPU_ATTR static inline void write_quantized(vi input, int8_t* output, Index offset) {
+  auto bytes = saturate32to8(input);
+  std::memcpy(output + offset, &bytes, sizeof(vi) / sizeof(int));
+}
+
+CPU_ATTR static inline void write_quantized(vi input, uint8_t* output, Index offset) {
+  auto bytes = _mm_add_epi8(saturate32to8(input), _mm_set1_epi8(127));
+  std::memcpy(output + offset, &bytes, sizeof(vi) / sizeof(int));
+}
+
+/*
+ * Convert 16-bit floats.  These round to nearest even and quiet NaNs like
+ * the F16C and AVX512-BF16 instructions but keep denormals, so every CPU
+ * gives the same bits as ToBFloat16 and ToHalf in float16.h.
+ */
+CPU_ATTR static inline vi select_si(vi mask, vi if_set, vi otherwise) {
+  return or_si(and_si(mask, if_set), andnot_si(mask, otherwise));
+}
+
+CPU_ATTR static inline vf bfloat16_to_float(vi bits) {
+  return cast_ps(slli_epi32<16>(bits));
+}
+
+CPU_ATTR static inline vf half_to_float(vi bits) {
+  const vi shifted_exponent = set1_epi32<vi>(0x7c00 << 13);
+  vi result = slli_epi32<13>(and_si(bits, set1_epi32<vi>(0x7fff)));
+  const vi exponent = and_si(result, shifted_exponent);
+  result = add_epi32(result, set1_epi32<vi>((127 - 15) << 23));
+  // Infinity and NaN keep the largest exponent.
+  result = add_epi32(result, and_si(cmpeq_epi32(exponent, shifted_exponent), set1_epi32<vi>((128 - 16) << 23)));
+  // Zero and denormals: renormalize by subtracting 2^-14.
+  const vi denormal = cast_si(sub_ps(cast_ps(add_epi32(result, set1_epi32<vi>(1 << 23))), set1_ps<vf>(6.103515625e-05f)));
+  result = select_si(cmpeq_epi32(exponent, setzero_si<vi>()), denormal, result);
+  return cast_ps(or_si(result, slli_epi32<16>(and_si(bits, set1_epi32<vi>(0x8000)))));
+}
+
+CPU_ATTR static inline vi float_to_bfloat16(vf input) {
+  const vi bits = cast_si(input);
+  const vi odd = and_si(srli_epi32<16>(bits), set1_epi32<vi>(1));
+  const vi rounded = srli_epi32<16>(add_epi32(bits, add_epi32(set1_epi32<vi>(0x7fff), odd)));
+  const vi nan = cmpgt_epi32(and_si(bits, set1_epi32<vi>(0x7fffffff)), set1_epi32<vi>(0x7f800000));
+  return select_si(nan, or_si(srli_epi32<16>(bits), set1_epi32<vi>(0x40)), rounded);
+}
+
+CPU_ATTR static inline vi float_to_half(vf input) {
+  const vi sign = and_si(cast_si(input), set1_epi32<vi>(static_cast<int32_t>(0x80000000u)));
+  const vi magnitude = xor_si(cast_si(input), sign);
+  // Normal halves: rebias the exponent and round the mantissa to 10 bits.
+  const vi odd = and_si(srli_epi32<13>(magnitude), set1_epi32<vi>(1));
+  const vi normal = srli_epi32<13>(add_epi32(add_epi32(magnitude, set1_epi32<vi>(0xfff - (112 << 23))), odd));
+  // Denormal halves: adding 0.5 makes the float unit round in the right place.
+  const vi denormal = sub_epi32(cast_si(add_ps(cast_ps(magnitude), set1_ps<vf>(0.5f))), set1_epi32<vi>(126 << 23));
+  const vi huge = select_si(cmpgt_epi32(magnitude, set1_epi32<vi>(0x7f800000)), set1_epi32<vi>(0x7e00), set1_epi32<vi>(0x7c00));
+  vi result = select_si(cmpgt_epi32(magnitude, set1_epi32<vi>((113 << 23) - 1)), normal, denormal);
+  result = select_si(cmpgt_epi32(magnitude, set1_epi32<vi>((143 << 23) - 1)), huge, result);
+  return or_si(result, srli_epi32<16>(sign));
+}
+
+// The low 16 bits of each 32-bit lane stored to output.
+CPU_ATTR static inline void write_words(vi input, void* output) {
+#if defined(KERNELS_THIS_IS_SSE2)
+  // packs_epi32 saturates so sign extend the low halves first.
+  input = srai_epi32<16>(slli_epi32<16>(input));
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(output), _mm_packs_epi32(input, input));
+#elif defined(KERNELS_THIS_IS_AVX2)
+  input = srai_epi32<16>(slli_epi32<16>(input));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(output), _mm_packs_epi32(_mm256_castsi256_si128(input), _mm256_extracti128_si256(input, 1)));
+#else
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(output), _mm512_cvtepi32_epi16(input));
+#endif
+}
+
+// A register of 16-bit values from address, zero extended to 32 bits.
+#if defined(KERNELS_THIS_IS_SSE2)
+  #define INTGEMM_LOAD_WORDS(address) _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(address)), _mm_setzero_si128())
+#elif defined(KERNELS_THIS_IS_AVX2)
+  #define INTGEMM_LOAD_WORDS(address) _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(address)))
+#else
+  #define INTGEMM_LOAD_WORDS(address) _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(address)))
+#endif
+
+template <>
+CPU_ATTR inline vf load_float16<vf>(const BFloat16* input, Index offset) {
+  return bfloat16_to_float(INTGEMM_LOAD_WORDS(input + offset));
+}
+
+template <>
+CPU_ATTR inline vf load_float16<vf>(const Half* input, Index offset) {
+  return half_to_float(INTGEMM_LOAD_WORDS(input + offset));
+}
+
+#undef INTGEMM_LOAD_WORDS
+
+CPU_ATTR static inline void write_float16(vf input, BFloat16* output, Index offset) {
+  write_words(float_to_bfloat16(input), output + offset);
+}
+
+CPU_ATTR static inline void write_float16(vf input, Half* output, Index offset) {
+  write_words(float_to_half(input), output + offset);
+}
+
 /*
  * Quantize
  */
@@ -328,11 +491,6 @@ CPU_ATTR static inline vf floor(vf input) {
 /*
  * Calculate approximation of e^x using Taylor series and lookup table
  */
-#if defined(KERNELS_THIS_IS_SSE2)
-CPU_ATTR static inline vf exp_approx_taylor(vf) {
-  std::abort();
-}
-#else
 CPU_ATTR static inline vf exp_approx_taylor(vf x) {
   static constexpr int EXP_MIN = -20;
   static constexpr int EXP_MAX = 20;
@@ -385,18 +543,17 @@ CPU_ATTR static inline vf exp_approx_taylor(vf x) {
   auto ea = i32gather_ps<4>(EXP_LOOKUP + EXP_MAX, cvtps_epi32(a));
   return mul_ps(ea, result);
 }
-#endif
 
 /*
  * Sigmoid
  */
-CPU_ATTR static inline vf sigmoid(vf
-#ifndef KERNELS_THIS_IS_SSE2
-    input
-#endif
-    ) {
+CPU_ATTR static inline vf sigmoid(vf input) {
 #if defined(KERNELS_THIS_IS_SSE2)
-  std::abort(); // TODO: missing exp_approx_taylor for SSE2
+  static const auto vconst_zero = setzero_ps<vf>();
+  static const auto vconst_one = set1_ps<vf>(1.f);
+
+  // exp_approx_taylor clamps to [-20, 20] so this doesn't overflow.
+  return div_ps(vconst_one, add_ps(vconst_one, exp_approx_taylor(sub_ps(vconst_zero, input))));
 #elif defined(KERNELS_THIS_IS_AVX2)
   static const auto vconst_zero = setzero_ps<vf>();
   static const auto vconst_one = set1_ps<vf>(1.f);
@@ -431,11 +588,6 @@ CPU_ATTR static inline vf sigmoid(vf
 /*
  * Tanh
  */
-#if defined(KERNELS_THIS_IS_SSE2)
-CPU_ATTR static inline vf tanh(vf) {
-  std::abort(); // TODO: missing exp_approx_taylor for SSE2
-}
-#else
 CPU_ATTR static inline vf tanh(vf input) {
   const static auto vconst_zero = setzero_ps<vf>();
 
@@ -444,7 +596,28 @@ CPU_ATTR static inline vf tanh(vf input) {
 
   return div_ps(sub_ps(e_x, e_minus_x), add_ps(e_x, e_minus_x));
 }
-#endif
+
+/*
+ * SiLU (Swish): x * sigmoid(x)
+ */
+CPU_ATTR static inline vf silu(vf input) {
+  static const auto vconst_zero = setzero_ps<vf>();
+  static const auto vconst_one = set1_ps<vf>(1.f);
+
+  return div_ps(input, add_ps(vconst_one, exp_approx_taylor(sub_ps(vconst_zero, input))));
+}
+
+/*
+ * GELU, tanh approximation: x * sigmoid(2 * sqrt(2 / pi) * (x + 0.044715 * x^3))
+ */
+CPU_ATTR static inline vf gelu(vf input) {
+  static const auto vconst_one = set1_ps<vf>(1.f);
+  static const auto vconst_cube = set1_ps<vf>(0.044715f);
+  static const auto vconst_minus_scale = set1_ps<vf>(-1.5957691216057308f);
+
+  auto inner = mul_ps(input, add_ps(vconst_one, mul_ps(vconst_cube, mul_ps(input, input))));
+  return div_ps(input, add_ps(vconst_one, exp_approx_taylor(mul_ps(vconst_minus_scale, inner))));
+}
 
 }
 }
@@ -0,0 +1,227 @@
+/* The kernels used by callbacks for NEON.  Unlike x86, NEON registers are
+ * typed by element, so each overload takes the vector type of its element.
+ */
+
+#define vi vector_t<CPUType::NEON, int>
+#define vf vector_t<CPUType::NEON, float>
+#define vd vector_t<CPUType::NEON, double>
+
+namespace intgemm {
+namespace kernels {
+
+/*
+ * Write
+ */
+INTGEMM_NEON static inline void write(vector_t<CPUType::NEON, int8_t> input, int8_t* output, Index offset) {
+  vst1q_s8(output + offset, input);
+}
+
+INTGEMM_NEON static inline void write(vector_t<CPUType::NEON, int16_t> input, int16_t* output, Index offset) {
+  vst1q_s16(output + offset, input);
+}
+
+INTGEMM_NEON static inline void write(vi input, int* output, Index offset) {
+  vst1q_s32(output + offset, input);
+}
+
+INTGEMM_NEON static inline void write(vf input, float* output, Index offset) {
+  vst1q_f32(output + offset, input);
+}
+
+INTGEMM_NEON static inline void write(vd input, double* output, Index offset) {
+  vst1q_f64(output + offset, input);
+}
+
+/*
+ * NEON has no non-temporal store intrinsic, so streaming writes are plain.
+ */
+template <class Vector, class Type>
+INTGEMM_NEON static inline void write_stream(Vector input, Type* output, Index offset) {
+  write(input, output, offset);
+}
+
+/*
+ * Write each 32-bit lane as a byte saturated to [-127, 127] as on x86
+ */
+INTGEMM_NEON static inline int8x8_t saturate32to8(vi input) {
+  int16x4_t words = vqmovn_s32(input);
+  return vmax_s8(vqmovn_s16(vcombine_s16(words, words)), vdup_n_s8(-127));
+}
+
+INTGEMM_NEON static inline void write_quantized(vi input, int8_t* output, Index offset) {
+  int8x8_t bytes = saturate32to8(input);
+  std::memcpy(output + offset, &bytes, 4);
+}
+
+INTGEMM_NEON static inline void write_quantized(vi input, uint8_t* output, Index offset) {
+  int8x8_t bytes = vadd_s8(saturate32to8(input), vdup_n_s8(127));
+  std::memcpy(output + offset, &bytes, 4);
+}
+
+/*
+ * Convert 16-bit floats, rounding to nearest even as on x86.  NEON converts
+ * halves natively.
+ */
+template <>
+INTGEMM_NEON inline vf load_float16<vf>(const BFloat16* input, Index offset) {
+  return vreinterpretq_f32_u32(vshll_n_u16(vld1_u16(reinterpret_cast<const uint16_t*>(input + offset)), 16));
+}
+
+template <>
+INTGEMM_NEON inline vf load_float16<vf>(const Half* input, Index offset) {
+  return vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(reinterpret_cast<const uint16_t*>(input + offset))));
+}
+
+INTGEMM_NEON static inline void write_float16(vf input, BFloat16* output, Index offset) {
+  uint32x4_t bits = vreinterpretq_u32_f32(input);
+  uint32x4_t odd = vandq_u32(vshrq_n_u32(bits, 16), vdupq_n_u32(1));
+  uint32x4_t rounded = vshrq_n_u32(vaddq_u32(bits, vaddq_u32(vdupq_n_u32(0x7fff), odd)), 16);
+  uint32x4_t nan = vcgtq_u32(vandq_u32(bits, vdupq_n_u32(0x7fffffff)), vdupq_n_u32(0x7f800000));
+  uint32x4_t result = vbslq_u32(nan, vorrq_u32(vshrq_n_u32(bits, 16), vdupq_n_u32(0x40)), rounded);
+  vst1_u16(reinterpret_cast<uint16_t*>(output + offset), vmovn_u32(result));
+}
+
+INTGEMM_NEON static inline void write_float16(vf input, Half* output, Index offset) {
+  vst1_u16(reinterpret_cast<uint16_t*>(output + offset), vreinterpret_u16_f16(vcvt_f16_f32(input)));
+}
+
+/*
+ * Quantize
+ */
+INTGEMM_NEON static inline vi quantize(vf input, vf quant_mult) {
+  // Round to nearest even like cvtps_epi32 does on x86.
+  return vcvtnq_s32_f32(vmulq_f32(input, quant_mult));
+}
+
+/*
+ * Unquantize
+ */
+INTGEMM_NEON static inline vf unquantize(vi input, vf unquant_mult) {
+  return vmulq_f32(vcvtq_f32_s32(input), unquant_mult);
+}
+
+/*
+ * Add a bias term
+ */
+INTGEMM_NEON static inline vi add_bias(vi input, const int* bias_addr, Index bias_offset) {
+  return vaddq_s32(input, vld1q_s32(bias_addr + bias_offset));
+}
+
+INTGEMM_NEON static inline vf add_bias(vf input, const float* bias_addr, Index bias_offset) {
+  return vaddq_f32(input, vld1q_f32(bias_addr + bias_offset));
+}
+
+INTGEMM_NEON static inline vd add_bias(vd input, const double* bias_addr, Index bias_offset) {
+  return vaddq_f64(input, vld1q_f64(bias_addr + bias_offset));
+}
+
+/*
+ * ReLU
+ */
+template <typename Type>
+INTGEMM_NEON static inline vector_t<CPUType::NEON, Type> relu(vector_t<CPUType::NEON, Type> input);
+
+template <>
+INTGEMM_NEON inline vi relu<int>(vi input) {
+  return vmaxq_s32(input, vdupq_n_s32(0));
+}
+
+template <>
+INTGEMM_NEON inline vf relu<float>(vf input) {
+  return vmaxq_f32(input, vdupq_n_f32(0.0f));
+}
+
+template <>
+INTGEMM_NEON inline vd relu<double>(vd input) {
+  return vmaxq_f64(input, vdupq_n_f64(0.0));
+}
+
+/*
+ * Multiply (elemwise)
+ */
+template <typename Type>
+INTGEMM_NEON static inline vector_t<CPUType::NEON, Type> multiply(vector_t<CPUType::NEON, Type> a, vector_t<CPUType::NEON, Type> b);
+
+template <>
+INTGEMM_NEON inline vi multiply<int>(vi a, vi b) {
+  return vmulq_s32(a, b);
+}
+
+template <>
+INTGEMM_NEON inline vf multiply<float>(vf a, vf b) {
+  return vmulq_f32(a, b);
+}
+
+template <>
+INTGEMM_NEON inline vd multiply<double>(vd a, vd b) {
+  return vmulq_f64(a, b);
+}
+
+/*
+ * Calculate approximation of e^x using Taylor series and lookup table, as on x86
+ */
+INTGEMM_NEON static inline vf exp_approx_taylor(vf x) {
+  static constexpr int EXP_MIN = -20;
+  static constexpr int EXP_MAX = 20;
+  static constexpr float EXP_LOOKUP[EXP_MAX - EXP_MIN + 1] = {
+    expif(-20), expif(-19), expif(-18), expif(-17), expif(-16), expif(-15),
+    expif(-14), expif(-13), expif(-12), expif(-11), expif(-10), expif(-9),
+    expif(-8), expif(-7), expif(-6), expif(-5), expif(-4), expif(-3), expif(-2),
+    expif(-1), expif(0), expif(1), expif(2), expif(3), expif(4), expif(5),
+    expif(6), expif(7), expif(8), expif(9), expif(10), expif(11), expif(12),
+    expif(13), expif(14), expif(15), expif(16), expif(17), expif(18), expif(19),
+    expif(20),
+  };
+
+  x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(EXP_MIN)), vdupq_n_f32(EXP_MAX));
+  vf a = vrndmq_f32(x);
+  vf xa = vsubq_f32(x, a);
+
+  vf result = vdupq_n_f32(1.f / factorial(7));
+  result = vfmaq_f32(vdupq_n_f32(1.f / factorial(6)), result, xa);
+  result = vfmaq_f32(vdupq_n_f32(1.f / factorial(5)), result, xa);
+  result = vfmaq_f32(vdupq_n_f32(1.f / factorial(4)), result, xa);
+  result = vfmaq_f32(vdupq_n_f32(1.f / factorial(3)), result, xa);
+  result = vfmaq_f32(vdupq_n_f32(1.f / factorial(2)), result, xa);
+  result = vfmaq_f32(vdupq_n_f32(1.f / factorial(1)), result, xa);
+  result = vfmaq_f32(vdupq_n_f32(1.f), result, xa);
+
+  // No gather: look up each lane.
+  vi index = vaddq_s32(vcvtq_s32_f32(a), vdupq_n_s32(EXP_MAX));
+  const float ea[4] = {
+    EXP_LOOKUP[vgetq_lane_s32(index, 0)], EXP_LOOKUP[vgetq_lane_s32(index, 1)],
+    EXP_LOOKUP[vgetq_lane_s32(index, 2)], EXP_LOOKUP[vgetq_lane_s32(index, 3)],
+  };
+  return vmulq_f32(vld1q_f32(ea), result);
+}
+
+/*
+ * Sigmoid, tanh, SiLU and GELU as on x86
+ */
+INTGEMM_NEON static inline vf sigmoid(vf input) {
+  const vf one = vdupq_n_f32(1.f);
+  return vdivq_f32(one, vaddq_f32(one, exp_approx_taylor(vnegq_f32(input))));
+}
+
+INTGEMM_NEON static inline vf tanh(vf input) {
+  vf e_x = exp_approx_taylor(input);
+  vf e_minus_x = exp_approx_taylor(vnegq_f32(input));
+  return vdivq_f32(vsubq_f32(e_x, e_minus_x), vaddq_f32(e_x, e_minus_x));
+}
+
+INTGEMM_NEON static inline vf silu(vf input) {
+  return vdivq_f32(input, vaddq_f32(vdupq_n_f32(1.f), exp_approx_taylor(vnegq_f32(input))));
+}
+
+INTGEMM_NEON static inline vf gelu(vf input) {
+  const vf one = vdupq_n_f32(1.f);
+  vf inner = vmulq_f32(input, vfmaq_f32(one, vdupq_n_f32(0.044715f), vmulq_f32(input, input)));
+  return vdivq_f32(input, vaddq_f32(one, exp_approx_taylor(vmulq_f32(vdupq_n_f32(-1.5957691216057308f), inner))));
+}
+
+}
+}
+
+#undef vi
+#undef vf
+#undef vd
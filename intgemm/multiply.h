@@ -1,17 +1,41 @@
 #pragma once
 
 #include "intgemm/intgemm_config.h"
+#include "aligned.h"
 #include "interleave.h"
 #include "intrinsics.h"
 #include "vec_traits.h"
 #include "callbacks.h"
+#include "executor.h"
+#include "instrument.h"
+#include "partition.h"
+#include "prefetch.h"
+#include "sparse_b.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace intgemm {
 
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+INTGEMM_NEON static inline dvector_t<CPUType::NEON, int> PermuteSummer(int32x4_t pack0123, int32x4_t pack4567) {
+  // No op for 128 bits: already reduced fully.
+  return { pack0123, pack4567 };
+}
+#else
 INTGEMM_SSE2 static inline dvector_t<CPUType::SSE2, int> PermuteSummer(__m128i pack0123, __m128i pack4567) {
   // No op for 128 bits: already reduced fully.
   return { pack0123, pack4567 };
 }
+#endif
 
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 INTGEMM_AVX2 static inline __m256i PermuteSummer(__m256i pack0123, __m256i pack4567) {
@@ -39,12 +63,67 @@ INTGEMM_AVX512BW static inline __m256i PermuteSummer(__m512i pack0123, __m512i p
 
 #ifdef _MSC_VER
 #define INTGEMM_OMP_FOR __pragma(omp for)
+#define INTGEMM_OMP_FOR_DYNAMIC __pragma(omp for schedule(dynamic, 1))
 #define INTGEMM_OMP_PARALLEL __pragma(omp parallel)
+#define INTGEMM_OMP_SINGLE __pragma(omp single)
+#define INTGEMM_OMP_BARRIER __pragma(omp barrier)
 #else
 #define INTGEMM_OMP_FOR _Pragma("omp for")
+#define INTGEMM_OMP_FOR_DYNAMIC _Pragma("omp for schedule(dynamic, 1)")
 #define INTGEMM_OMP_PARALLEL _Pragma("omp parallel")
+#define INTGEMM_OMP_SINGLE _Pragma("omp single")
+#define INTGEMM_OMP_BARRIER _Pragma("omp barrier")
 #endif
 
+/* for (Index task = 0; task < tasks; ++task) { body } shared by the OpenMP
+ * team: statically or, with Schedule::Dynamic, one task at a time to
+ * whichever thread is free.  The body is the rest of the arguments.
+ */
+#define INTGEMM_OMP_FOR_TASKS(tasks, ...) \
+  if (GetSchedule() == Schedule::Dynamic) { \
+    INTGEMM_OMP_FOR_DYNAMIC \
+    for (Index task = 0; task < (tasks); ++task) { __VA_ARGS__ } \
+  } else { \
+    INTGEMM_OMP_FOR \
+    for (Index task = 0; task < (tasks); ++task) { __VA_ARGS__ } \
+  }
+
+// Threads in the current OpenMP team, or 1 without OpenMP.
+static inline std::size_t OMPThreads() {
+#ifdef _OPENMP
+  return static_cast<std::size_t>(omp_get_num_threads());
+#else
+  return 1;
+#endif
+}
+
+// This thread's number in the current OpenMP team, or 0 without OpenMP.
+static inline std::size_t OMPThread() {
+#ifdef _OPENMP
+  return static_cast<std::size_t>(omp_get_thread_num());
+#else
+  return 0;
+#endif
+}
+
+// Tasks to split a multiply into for the current OpenMP team.
+static inline std::size_t OMPTasks() {
+  return ScheduleTasks(OMPThreads());
+}
+
+/* Share the tasks of partition out over the current OpenMP team with
+ * INTGEMM_OMP_FOR_TASKS, calling f(row_begin, row_end, col_begin, col_end)
+ * on each.  Call it inside a parallel region.  ExecutorWrapRanges is the
+ * same for an Executor.
+ */
+template <class RangeFunction> static inline void OMPWrapRanges(const Partition &partition, const RangeFunction &f) {
+  INTGEMM_OMP_FOR_TASKS(partition.Tasks(),
+    Index row_begin, row_end, col_begin, col_end;
+    partition.Task(task, row_begin, row_end, col_begin, col_end);
+    f(row_begin, row_end, col_begin, col_end);
+  )
+}
+
 // Quantize function used for SSSE3 and AVX2.
 // Separate function for thread to work around gcc 7 bug that doesn't imbue
 // target attributes across #pragma omp parallel.
@@ -85,6 +164,172 @@ target static void Quantize(const float *const input, int8_t *const output, floa
   std::memcpy(output + (size & ~(kBatch - 1)), &result, overhang); \
 }
 
+// The value a quantize with a fused scale maps to 127, from the largest |x|
+// and the sum and sum of squares of |x| over count values.
+static inline float ScaledThreshold(ScaleStatistic statistic, float stddevs, float max_abs, float sum, float squares, std::size_t count) {
+  if (statistic == ScaleStatistic::MaxAbsolute || !count) return max_abs;
+  const float mean = sum / count;
+  return mean + stddevs * std::sqrt(std::max(0.0f, squares / count - mean * mean));
+}
+
+// One float of an overhang, saturating like QuantizeTile8 and ConsecutiveU.
+static inline void QuantizeFloat(float value, float quant_mult, int8_t *out) {
+  *out = static_cast<int8_t>(std::max(-127.0f, std::min(127.0f, std::nearbyint(value * quant_mult))));
+}
+static inline void QuantizeFloat(float value, float quant_mult, uint8_t *out) {
+  *out = static_cast<uint8_t>(127.0f + std::max(-127.0f, std::min(127.0f, std::nearbyint(value * quant_mult))));
+}
+
+/* Quantize each row of A with its own multiplier, 127 / the row's statistic,
+ * by default its largest absolute value, and write 1 / multiplier to
+ * row_scales to unquantize it.  The row is still in cache when it's read
+ * again to quantize, so this is one pass over memory where MaxAbsolute then
+ * Quantize is two.  A row of zeros gets scale 0.
+ */
+#define INTGEMM_QUANTIZE_ROWS_THREAD(target) \
+target static void QuantizeRowsThread(const float *input, int8_t *output, float *row_scales, Index rows, Index cols, ScaleStatistic statistic, float stddevs) { \
+  const FRegister abs_mask = cast_ps(set1_epi32<Register>(kFloatAbsoluteMask)); \
+  INTGEMM_OMP_FOR \
+  for (Index r = 0; r < rows; ++r) { \
+    const float *row = input + static_cast<std::size_t>(r) * cols; \
+    FRegister highest = setzero_ps<FRegister>(); \
+    float threshold; \
+    if (statistic == ScaleStatistic::MaxAbsolute) { \
+      for (Index c = 0; c < cols; c += sizeof(FRegister) / sizeof(float)) { \
+        highest = max_ps(highest, and_ps(abs_mask, *reinterpret_cast<const FRegister*>(row + c))); \
+      } \
+      threshold = MaxFloat32(highest); \
+    } else { \
+      FRegister sums = setzero_ps<FRegister>(), squares = setzero_ps<FRegister>(); \
+      for (Index c = 0; c < cols; c += sizeof(FRegister) / sizeof(float)) { \
+        FRegister value = and_ps(abs_mask, *reinterpret_cast<const FRegister*>(row + c)); \
+        sums = add_ps(sums, value); \
+        squares = add_ps(squares, mul_ps(value, value)); \
+      } \
+      threshold = ScaledThreshold(statistic, stddevs, 0.0f, AddFloat32(sums), AddFloat32(squares), cols); \
+    } \
+    row_scales[r] = threshold / 127.0f; \
+    FRegister q = set1_ps<FRegister>(threshold > 0.0f ? 127.0f / threshold : 1.0f); \
+    int8_t *out = output + static_cast<std::size_t>(r) * cols; \
+    for (Index c = 0; c < cols; c += sizeof(Register)) { \
+      *reinterpret_cast<Register*>(out + c) = QuantizeTile8::Consecutive(q, row + c); \
+    } \
+  } \
+}
+
+#define INTGEMM_QUANTIZE_ROWS(target) \
+target static void QuantizeRows(const float *input, int8_t *output, float *row_scales, Index rows, Index cols) { \
+  QuantizeRowsScaled(input, output, row_scales, rows, cols, ScaleStatistic::MaxAbsolute, 0.0f); \
+} \
+target static void QuantizeRowsScaled(const float *input, int8_t *output, float *row_scales, Index rows, Index cols, ScaleStatistic statistic, float stddevs) { \
+  assert(cols % sizeof(Register) == 0); \
+  assert(reinterpret_cast<uintptr_t>(input) % sizeof(Register) == 0); \
+  assert(reinterpret_cast<uintptr_t>(output) % sizeof(Register) == 0); \
+  INTGEMM_OMP_PARALLEL \
+  { \
+    QuantizeRowsThread(input, output, row_scales, rows, cols, statistic, stddevs); \
+  } \
+}
+
+/* Quantize and QuantizeU on the calling thread only, for code that is
+ * already running on one thread of a team or an Executor, where Quantize's
+ * own parallel region would nest.  count is a multiple of sizeof(Register);
+ * input and output are register aligned.
+ */
+#define INTGEMM_QUANTIZE_SERIAL(target) \
+target static void QuantizeSerial(const float *input, int8_t *output, float quant_mult, std::size_t count) { \
+  FRegister q = set1_ps<FRegister>(quant_mult); \
+  for (std::size_t i = 0; i < count; i += sizeof(Register)) { \
+    *reinterpret_cast<Register*>(output + i) = QuantizeTile8::Consecutive(q, input + i); \
+  } \
+} \
+target static void QuantizeSerial(const float *input, uint8_t *output, float quant_mult, std::size_t count) { \
+  QuantizeU(input, output, quant_mult, count); \
+}
+
+/* Quantize with quant_mult = 127 / the statistic of all of input, found in
+ * the same parallel region.  Each thread takes an equal consecutive share
+ * and finds its largest |x| and sums, the threads combine them in order
+ * after a barrier, then each quantizes its share, which is still in its
+ * cache if it fits: 64K floats per thread for a 256 KiB L2.  Returns
+ * 1 / quant_mult, 0 for all zeros.  Any size; the overhang past the last
+ * whole register goes to the last thread, as floats.
+ */
+#define INTGEMM_QUANTIZE_SCALED_THREAD(target) \
+target static void ScaledStatistic(const float *input, std::size_t count, bool sums_too, float *stats) { \
+  const FRegister abs_mask = cast_ps(set1_epi32<Register>(kFloatAbsoluteMask)); \
+  FRegister highest = setzero_ps<FRegister>(); \
+  stats[1] = stats[2] = 0.0f; \
+  if (sums_too) { \
+    FRegister sums = setzero_ps<FRegister>(), squares = setzero_ps<FRegister>(); \
+    for (std::size_t i = 0; i < count; i += sizeof(FRegister) / sizeof(float)) { \
+      FRegister value = and_ps(abs_mask, *reinterpret_cast<const FRegister*>(input + i)); \
+      highest = max_ps(highest, value); \
+      sums = add_ps(sums, value); \
+      squares = add_ps(squares, mul_ps(value, value)); \
+    } \
+    stats[1] = AddFloat32(sums); \
+    stats[2] = AddFloat32(squares); \
+  } else { \
+    for (std::size_t i = 0; i < count; i += sizeof(FRegister) / sizeof(float)) { \
+      highest = max_ps(highest, and_ps(abs_mask, *reinterpret_cast<const FRegister*>(input + i))); \
+    } \
+  } \
+  stats[0] = MaxFloat32(highest); \
+} \
+template <class Out> static float QuantizeScaledImpl(const float *input, Out *output, Index size, ScaleStatistic statistic, float stddevs) { \
+  assert(reinterpret_cast<uintptr_t>(input) % sizeof(Register) == 0); \
+  assert(reinterpret_cast<uintptr_t>(output) % sizeof(Register) == 0); \
+  const std::size_t kBatch = sizeof(Register); \
+  const std::size_t blocks = size / kBatch; \
+  const bool sums_too = statistic != ScaleStatistic::MaxAbsolute; \
+  std::vector<float> stats; \
+  float scale = 0.0f; \
+  INTGEMM_OMP_PARALLEL \
+  { \
+    INTGEMM_OMP_SINGLE \
+    stats.resize(3 * OMPThreads()); \
+    const std::size_t threads = OMPThreads(), thread = OMPThread(); \
+    const std::size_t begin = blocks * thread / threads * kBatch; \
+    const std::size_t end = blocks * (thread + 1) / threads * kBatch; \
+    float *mine = &stats[3 * thread]; \
+    ScaledStatistic(input + begin, end - begin, sums_too, mine); \
+    if (thread + 1 == threads) { \
+      for (std::size_t i = end; i < size; ++i) { \
+        const float value = std::fabs(input[i]); \
+        mine[0] = std::max(mine[0], value); \
+        mine[1] += value; \
+        mine[2] += value * value; \
+      } \
+    } \
+    INTGEMM_OMP_BARRIER \
+    float max_abs = 0.0f, sum = 0.0f, squares = 0.0f; \
+    for (std::size_t t = 0; t < threads; ++t) { \
+      max_abs = std::max(max_abs, stats[3 * t]); \
+      sum += stats[3 * t + 1]; \
+      squares += stats[3 * t + 2]; \
+    } \
+    const float threshold = ScaledThreshold(statistic, stddevs, max_abs, sum, squares, size); \
+    const float quant_mult = threshold > 0.0f ? 127.0f / threshold : 1.0f; \
+    QuantizeSerial(input + begin, output + begin, quant_mult, end - begin); \
+    if (thread + 1 == threads) { \
+      scale = threshold / 127.0f; \
+      for (std::size_t i = end; i < size; ++i) { \
+        QuantizeFloat(input[i], quant_mult, output + i); \
+      } \
+    } \
+  } \
+  return scale; \
+}
+
+#define INTGEMM_QUANTIZE_SCALED(target) \
+target static float QuantizeScaled(const float *input, int8_t *output, Index size, ScaleStatistic statistic, float stddevs) { \
+  return QuantizeScaledImpl(input, output, size, statistic, stddevs); \
+} \
+target static float QuantizeUScaled(const float *input, uint8_t *output, Index size, ScaleStatistic statistic, float stddevs) { \
+  return QuantizeScaledImpl(input, output, size, statistic, stddevs); \
+}
+
 /* Take 4 registers with 32-bit values to be horizontally added.  Reduce them
  * to one register with 32-bit values in the pattern 1 2 3 4 1 2 3 4, leaving
  * the final addition (which crosses 128-bit lanes) to the caller. 
@@ -99,7 +344,14 @@ target inline Register Pack0123(Register sum0, Register sum1, Register sum2, Reg
   return add_epi32(pack01, pack23); \
 } \
 
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+// Pairwise adds do the horizontal sums without the interleaving.
+INTGEMM_NEON inline int32x4_t Pack0123(int32x4_t sum0, int32x4_t sum1, int32x4_t sum2, int32x4_t sum3) {
+  return vpaddq_s32(vpaddq_s32(sum0, sum1), vpaddq_s32(sum2, sum3));
+}
+#else
 INTGEMM_PACK0123(INTGEMM_SSE2, __m128i)
+#endif
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 INTGEMM_PACK0123(INTGEMM_AVX2, __m256i)
 #endif
@@ -108,11 +360,19 @@ INTGEMM_PACK0123(INTGEMM_AVX2, __m256i)
 INTGEMM_PACK0123(INTGEMM_AVX512BW, __m512i)
 #endif
 
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+template <typename Callback>
+INTGEMM_NEON static inline void RunCallback(Callback& callback_impl, dvector_t<CPUType::NEON, int> total, Index row_idx, Index col_idx, Index rows, Index cols) {
+  callback_impl.Run(total.first, callbacks::OutputBufferInfo(row_idx, col_idx, rows, cols));
+  callback_impl.Run(total.second, callbacks::OutputBufferInfo(row_idx, col_idx + 4, rows, cols));
+}
+#else
 template <typename Callback>
 INTGEMM_SSE2 static inline void RunCallback(Callback& callback_impl, dvector_t<CPUType::SSE2, int> total, Index row_idx, Index col_idx, Index rows, Index cols) {
   callback_impl.Run(total.first, callbacks::OutputBufferInfo(row_idx, col_idx, rows, cols));
   callback_impl.Run(total.second, callbacks::OutputBufferInfo(row_idx, col_idx + 4, rows, cols));
 }
+#endif
 
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 template <typename Callback>
@@ -121,6 +381,527 @@ INTGEMM_AVX2 static inline void RunCallback(Callback& callback_impl, vector_t<CP
 }
 #endif
 
+// Add partial sums from PermuteSummer computed over different parts of width.
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+INTGEMM_NEON static inline dvector_t<CPUType::NEON, int> AddTotals(dvector_t<CPUType::NEON, int> a, dvector_t<CPUType::NEON, int> b) {
+  return { vaddq_s32(a.first, b.first), vaddq_s32(a.second, b.second) };
+}
+#else
+INTGEMM_SSE2 static inline dvector_t<CPUType::SSE2, int> AddTotals(dvector_t<CPUType::SSE2, int> a, dvector_t<CPUType::SSE2, int> b) {
+  return { add_epi32(a.first, b.first), add_epi32(a.second, b.second) };
+}
+#endif
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
+INTGEMM_AVX2 static inline __m256i AddTotals(__m256i a, __m256i b) {
+  return add_epi32(a, b);
+}
+#endif
+
+/* Cache blocking for the Multiply drivers.  A is taken kMultiplyBlockRows rows
+ * at a time so the block stays in L2 while the threads split the 8-column
+ * strips of B between them.  The shared dimension is cut into panels of
+ * kMultiplyPanelBytes so the strip's panel of B (8 * kMultiplyPanelBytes)
+ * stays in L1 while it is reused for every row in the block.  32-bit partial
+ * sums for the block are kept until the last panel, then the callback sees
+ * each fully reduced tile once.
+ */
+static const Index kMultiplyPanelBytes = 2048;
+static const Index kMultiplyBlockRows = 32;
+
+/* Type of the fully reduced sums of 8 columns, as returned by PermuteSummer. */
+#define INTGEMM_MULTIPLY_TOTAL(Register) decltype(PermuteSummer(Register(), Register()))
+
+/* Generates a blocked driver Name<kRows, Callback> over a strip kernel
+ *   template <Index kRows> Strip(const Register *A, Index A_stride, const Register *B, Index count, Total *totals)
+ * that multiplies kRows rows of A (A_stride registers apart) by count
+ * registers of an 8-column strip of B.  Rows left over from kRows are done
+ * with Strip<1>.
+ *
+ * Name(..., callback, A_row_begin, A_row_end, B_col_begin, B_col_end) does
+ * only that tile of the output on the calling thread; column bounds must be
+ * multiples of 8.  Name(A, B, A_rows, width, B_cols, callback) shares the
+ * tasks from ChoosePartition with INTGEMM_OMP_FOR_TASKS.
+ *
+ * A block of one row (A_rows == 1 for decoding) is a GEMV: nothing reuses a
+ * panel of B, so Strip runs down the whole strip at once and reduces once
+ * per 8 columns instead of once per panel.  Strips that add in saturating
+ * 16 bits give sums that depend on where the panels split them, so those use
+ * INTGEMM_MULTIPLY_BLOCKED_SATURATING, which keeps the panels for one row.
+ */
+#define INTGEMM_MULTIPLY_BLOCKED(AType, BType, Register, target, cpu_type, Name, Strip) \
+INTGEMM_MULTIPLY_BLOCKED_GEMV(AType, BType, Register, target, cpu_type, Name, Strip, true)
+#define INTGEMM_MULTIPLY_BLOCKED_SATURATING(AType, BType, Register, target, cpu_type, Name, Strip) \
+INTGEMM_MULTIPLY_BLOCKED_GEMV(AType, BType, Register, target, cpu_type, Name, Strip, false)
+#define INTGEMM_MULTIPLY_BLOCKED_GEMV(AType, BType, Register, target, cpu_type, Name, Strip, gemv) \
+template <Index kRows, class CallbackImpl> target static inline void Name##StripTile(const Register *A_block, Index A_stride, Index block_begin, Index block_rows, const Register *B0_col, Index A_rows, Index simd_width, Index B_cols, Index B0_colidx, CallbackImpl &callback_impl) { \
+  typedef INTGEMM_MULTIPLY_TOTAL(Register) Total; \
+  const Index panel_width = kMultiplyPanelBytes / sizeof(Register); \
+  const Index blocked_rows = block_rows - block_rows % kRows; \
+  const Index prefetch = PrefetchDistance(sizeof(Register)); \
+  Total totals[kMultiplyBlockRows]; \
+  if (gemv && block_rows == 1) { \
+    if (B0_colidx + 8 < B_cols) PrefetchBytes(B0_col + simd_width * 8, prefetch); \
+    Strip<1>(A_block, A_stride, B0_col, simd_width, totals); \
+    RunCallback(callback_impl, totals[0], block_begin, B0_colidx, A_rows, B_cols); \
+    return; \
+  } \
+  for (Index k = 0; k < simd_width; k += panel_width) { \
+    const Index count = std::min(panel_width, simd_width - k); \
+    /* The next panel, or after the last the next strip, follows this one. */ \
+    if (k + count < simd_width || B0_colidx + 8 < B_cols) PrefetchBytes(B0_col + (k + count) * 8, prefetch); \
+    INTGEMM_MULTIPLY_PANEL(Strip, B0_col + k * 8) \
+  } \
+  for (Index r = 0; r < block_rows; ++r) { \
+    RunCallback(callback_impl, totals[r], block_begin + r, B0_colidx, A_rows, B_cols); \
+  } \
+} \
+template <Index kRows, class CallbackImpl> target static inline void Name##Tile(const Register *A_block, Index A_stride, Index block_begin, Index block_rows, const Register *B, Index A_rows, Index simd_width, Index B_cols, Index B0_colidx, CallbackImpl &callback_impl) { \
+  Name##StripTile<kRows>(A_block, A_stride, block_begin, block_rows, B + simd_width * B0_colidx, A_rows, simd_width, B_cols, B0_colidx, callback_impl); \
+} \
+INTGEMM_MULTIPLY_DRIVERS(AType, BType, Register, target, cpu_type, Name)
+
+/* All rows of the block times one panel of count registers of the strip, from
+ * B_panel.  Rows of A_block are A_stride registers apart.  The body of the
+ * Tile loops over panels and defines prefetch, the bytes of the next rows'
+ * panel of A to prefetch before each Strip.
+ */
+#define INTGEMM_MULTIPLY_PANEL(Strip, B_panel) \
+    Total part[kRows]; \
+    const Index A_prefetch = std::min<Index>(prefetch, count * sizeof(Register)); \
+    Index r = 0; \
+    for (; r < blocked_rows; r += kRows) { \
+      for (Index i = r + kRows; i < std::min(r + 2 * kRows, block_rows); ++i) { \
+        PrefetchBytes(A_block + i * A_stride + k, A_prefetch); \
+      } \
+      Strip<kRows>(A_block + r * A_stride + k, A_stride, B_panel, count, part); \
+      for (Index i = 0; i < kRows; ++i) { \
+        totals[r + i] = k ? AddTotals(totals[r + i], part[i]) : part[i]; \
+      } \
+    } \
+    for (; r < block_rows; ++r) { \
+      if (r + 1 < block_rows) PrefetchBytes(A_block + (r + 1) * A_stride + k, A_prefetch); \
+      Strip<1>(A_block + r * A_stride + k, A_stride, B_panel, count, part); \
+      totals[r] = k ? AddTotals(totals[r], part[0]) : part[0]; \
+    }
+
+/* The range and OpenMP entry points over Name##Tile.  The overloads taking
+ * lda read row r of A from A + r * lda, so A can be a block of columns of a
+ * wider matrix; lda must keep rows register aligned.
+ */
+#define INTGEMM_MULTIPLY_DRIVERS(AType, BType, Register, target, cpu_type, Name) \
+template <Index kRows, typename Callback> target static void Name(const AType *A, Index lda, const BType *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) { \
+  assert(width % (sizeof(Register) / sizeof(AType)) == 0); \
+  assert(lda >= width && lda % (sizeof(Register) / sizeof(AType)) == 0); \
+  assert(B_cols % 8 == 0); \
+  assert(A_row_end <= A_rows); \
+  assert(B_col_begin % 8 == 0 && B_col_end % 8 == 0 && B_col_end <= B_cols); \
+  assert(reinterpret_cast<uintptr_t>(A) % sizeof(Register) == 0); \
+  assert(reinterpret_cast<uintptr_t>(B) % sizeof(Register) == 0); \
+  const Index simd_width = width / (sizeof(Register) / sizeof(AType)); \
+  const Index A_stride = lda / (sizeof(Register) / sizeof(AType)); \
+  const Register *A_reg = reinterpret_cast<const Register *>(A); \
+  const Register *B_reg = reinterpret_cast<const Register *>(B); \
+  auto callback_impl = callbacks::CallbackImpl<cpu_type, Callback>(callback); \
+  for (Index block_begin = A_row_begin; block_begin < A_row_end; block_begin += kMultiplyBlockRows) { \
+    const Index block_rows = std::min(kMultiplyBlockRows, A_row_end - block_begin); \
+    for (Index B0_colidx = B_col_begin; B0_colidx < B_col_end; B0_colidx += 8) { \
+      Name##Tile<kRows>(A_reg + block_begin * A_stride, A_stride, block_begin, block_rows, B_reg, A_rows, simd_width, B_cols, B0_colidx, callback_impl); \
+    } \
+  } \
+} \
+template <Index kRows, typename Callback> target static void Name(const AType *A, const BType *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) { \
+  Name<kRows, Callback>(A, width, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end); \
+} \
+template <Index kRows, typename Callback> target static void Name(const AType *A, Index lda, const BType *B, Index A_rows, Index width, Index B_cols, Callback callback) { \
+  OMPWrapRanges(ChoosePartition(A_rows, B_cols, OMPTasks()), [&](Index row_begin, Index row_end, Index col_begin, Index col_end) { \
+    Name<kRows, Callback>(A, lda, B, A_rows, width, B_cols, callback, row_begin, row_end, col_begin, col_end); \
+  }); \
+} \
+template <Index kRows, typename Callback> target static void Name(const AType *A, const BType *B, Index A_rows, Index width, Index B_cols, Callback callback) { \
+  Name<kRows, Callback>(A, width, B, A_rows, width, B_cols, callback); \
+}
+
+/* Multiply overloads whose row r of A starts at A + r * lda, on top of the
+ * Rows driver from INTGEMM_MULTIPLY_BLOCKED.
+ */
+#define INTGEMM_MULTIPLY_STRIDED(AType, BType, target, Rows, kRows) \
+template <typename Callback> target static void Multiply(const AType *A, Index lda, const BType *B, Index A_rows, Index width, Index B_cols, Callback callback) { \
+  Rows<kRows, Callback>(A, lda, B, A_rows, width, B_cols, callback); \
+} \
+template <typename Callback> target static void Multiply(const AType *A, Index lda, const BType *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) { \
+  Rows<kRows, Callback>(A, lda, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end); \
+}
+
+/* Multiply with width and B_cols fixed at compile time, on the calling thread.
+ * The usual Rows driver, flattened with the shape passed as constants; the
+ * kernels are not specialized per shape.  For small multiplies like
+ * batch-1 decoding where a parallel region costs more than it saves.
+ */
+#define INTGEMM_MULTIPLY_FIXED(AType, BType, target, Rows, kRows) \
+template <Index kWidth, Index kBCols, typename Callback> INTGEMM_FLATTEN target static void MultiplyFixed(const AType *A, const BType *B, Index A_rows, Callback callback) { \
+  static_assert(kWidth % (64 / sizeof(AType)) == 0 && kBCols % 8 == 0, "MultiplyFixed width must be a multiple of 64 bytes and B_cols of 8"); \
+  Rows<kRows, Callback>(A, kWidth, B, A_rows, kWidth, kBCols, callback, 0, A_rows, 0, kBCols); \
+}
+
+/* 4-bit B: Int4::PrepareB packs each pair of registers of prepared 8-bit B into one
+ * register, the first in the low nibbles and the second in the high nibbles,
+ * so a strip takes 4 registers per step of the shared dimension.  The Tile
+ * unpacks each panel of its strip with Unpack into an 8-bit panel on the
+ * stack, which stays in L1 while every row in the block runs the 8-bit Strip
+ * over it.  B is read from memory at half the size and the 8-bit kernels are
+ * used unchanged.
+ */
+#define INTGEMM_MULTIPLY_BLOCKED_INT4(AType, Register, target, cpu_type, Name, Strip, Unpack) \
+template <Index kRows, class CallbackImpl> target static inline void Name##Tile(const Register *A_block, Index A_stride, Index block_begin, Index block_rows, const Register *B, Index A_rows, Index simd_width, Index B_cols, Index B0_colidx, CallbackImpl &callback_impl) { \
+  typedef INTGEMM_MULTIPLY_TOTAL(Register) Total; \
+  const Index panel_width = kMultiplyPanelBytes / sizeof(Register); \
+  const Index blocked_rows = block_rows - block_rows % kRows; \
+  const Register *B0_col = B + simd_width * B0_colidx / 2; \
+  const Index prefetch = PrefetchDistance(sizeof(Register)); \
+  Register panel[8 * (kMultiplyPanelBytes / sizeof(Register))]; \
+  Total totals[kMultiplyBlockRows]; \
+  for (Index k = 0; k < simd_width; k += panel_width) { \
+    const Index count = std::min(panel_width, simd_width - k); \
+    if (k + count < simd_width || B0_colidx + 8 < B_cols) PrefetchBytes(B0_col + (k + count) * 4, prefetch / 2); \
+    Unpack(B0_col + k * 4, panel, count * 4); \
+    INTGEMM_MULTIPLY_PANEL(Strip, panel) \
+  } \
+  for (Index r = 0; r < block_rows; ++r) { \
+    RunCallback(callback_impl, totals[r], block_begin + r, B0_colidx, A_rows, B_cols); \
+  } \
+} \
+INTGEMM_MULTIPLY_DRIVERS(AType, int8_t, Register, target, cpu_type, Name)
+
+/* Multiply4 for B from Int4::PrepareB, kRows rows of A at a time with Strip. */
+#define INTGEMM_MULTIPLY4(Register, target, cpu_type, kRows, Strip, Unpack) \
+INTGEMM_MULTIPLY_BLOCKED_INT4(int8_t, Register, target, cpu_type, Multiply4Rows, Strip, Unpack) \
+template <typename Callback> target static void Multiply4(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) { \
+  Multiply4Rows<kRows, Callback>(A, B, A_rows, width, B_cols, callback); \
+} \
+template <typename Callback> target static void Multiply4(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) { \
+  Multiply4Rows<kRows, Callback>(A, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end); \
+}
+
+/* 16-bit A times 8-bit B for Int16By8.  A BRegister holds as many bytes of
+ * B as a Register holds 16-bit values of A, so B is prepared with the layout
+ * of 8-bit B in BRegisters (see Int16By8::PrepareB) and a strip takes 8
+ * BRegisters per register of A.  Like INTGEMM_MULTIPLY_BLOCKED_INT4, the
+ * Tile sign extends each panel of its strip with Extend into a 16-bit panel
+ * on the stack and runs the 16-bit Strip over it for every row in the block,
+ * so B is read from memory at half the size and widened once per block.
+ */
+#define INTGEMM_MULTIPLY_BLOCKED_MIXED(Register, BRegister, target, cpu_type, Name, Strip, Extend) \
+template <Index kRows, class CallbackImpl> target static inline void Name##Tile(const Register *A_block, Index A_stride, Index block_begin, Index block_rows, const Register *B, Index A_rows, Index simd_width, Index B_cols, Index B0_colidx, CallbackImpl &callback_impl) { \
+  typedef INTGEMM_MULTIPLY_TOTAL(Register) Total; \
+  const Index panel_width = kMultiplyPanelBytes / sizeof(Register); \
+  const Index blocked_rows = block_rows - block_rows % kRows; \
+  const BRegister *B0_col = reinterpret_cast<const BRegister*>(B) + simd_width * B0_colidx; \
+  const Index prefetch = PrefetchDistance(sizeof(Register)); \
+  Register panel[8 * (kMultiplyPanelBytes / sizeof(Register))]; \
+  Total totals[kMultiplyBlockRows]; \
+  for (Index k = 0; k < simd_width; k += panel_width) { \
+    const Index count = std::min(panel_width, simd_width - k); \
+    if (k + count < simd_width || B0_colidx + 8 < B_cols) PrefetchBytes(B0_col + (k + count) * 8, prefetch / 2); \
+    for (Index i = 0; i < count * 8; ++i) { \
+      panel[i] = Extend(B0_col + k * 8 + i); \
+    } \
+    INTGEMM_MULTIPLY_PANEL(Strip, panel) \
+  } \
+  for (Index r = 0; r < block_rows; ++r) { \
+    RunCallback(callback_impl, totals[r], block_begin + r, B0_colidx, A_rows, B_cols); \
+  } \
+} \
+INTGEMM_MULTIPLY_DRIVERS(int16_t, int8_t, Register, target, cpu_type, Name)
+
+/* MultiplyMixed for B from Int16By8::PrepareB, kRows rows of A at a time with
+ * the 16-bit Strip.
+ */
+#define INTGEMM_MULTIPLY_MIXED(Register, BRegister, target, cpu_type, kRows, Strip, Extend) \
+INTGEMM_MULTIPLY_BLOCKED_MIXED(Register, BRegister, target, cpu_type, MultiplyMixedRows, Strip, Extend) \
+template <typename Callback> target static void MultiplyMixed(const int16_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) { \
+  MultiplyMixedRows<kRows, Callback>(A, B, A_rows, width, B_cols, callback); \
+} \
+template <typename Callback> target static void MultiplyMixed(const int16_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) { \
+  MultiplyMixedRows<kRows, Callback>(A, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end); \
+}
+
+/* MultiplySparse for SparseB, kRows rows of A at a time with Strip.  The Tile
+ * runs Strip over each run of kept tiles, at most a panel at a time so the
+ * cache blocking matches Multiply, with A offset to where the run starts.
+ * Tiles that were not kept are never read.
+ */
+#define INTGEMM_MULTIPLY_SPARSE(Register, target, cpu_type, kRows, Strip) \
+template <class CallbackImpl> target static inline void MultiplySparseTile(const Register *A_block, Index block_begin, Index block_rows, const SparseB &B, Index A_rows, Index simd_width, Index B0_colidx, CallbackImpl &callback_impl) { \
+  typedef INTGEMM_MULTIPLY_TOTAL(Register) Total; \
+  const Index panel_width = kMultiplyPanelBytes / sizeof(Register); \
+  const Index blocked_rows = block_rows - block_rows % kRows; \
+  const Index strip = B0_colidx / 8; \
+  const Register *B_tile = reinterpret_cast<const Register*>(B.tiles.begin()) + B.strip_tiles[strip] * 8; \
+  Total totals[kMultiplyBlockRows]; \
+  for (Index r = 0; r < block_rows; ++r) { \
+    totals[r] = Total(); \
+  } \
+  for (Index run = B.strip_runs[strip]; run < B.strip_runs[strip + 1]; ++run) { \
+    const Index run_end = B.run_begin[run] + B.run_length[run]; \
+    for (Index k = B.run_begin[run]; k < run_end; k += panel_width) { \
+      const Index count = std::min(panel_width, run_end - k); \
+      Total part[kRows]; \
+      Index r = 0; \
+      for (; r < blocked_rows; r += kRows) { \
+        Strip<kRows>(A_block + r * simd_width + k, simd_width, B_tile, count, part); \
+        for (Index i = 0; i < kRows; ++i) { \
+          totals[r + i] = AddTotals(totals[r + i], part[i]); \
+        } \
+      } \
+      for (; r < block_rows; ++r) { \
+        Strip<1>(A_block + r * simd_width + k, simd_width, B_tile, count, part); \
+        totals[r] = AddTotals(totals[r], part[0]); \
+      } \
+      B_tile += count * 8; \
+    } \
+  } \
+  for (Index r = 0; r < block_rows; ++r) { \
+    RunCallback(callback_impl, totals[r], block_begin + r, B0_colidx, A_rows, B.cols); \
+  } \
+} \
+template <typename Callback> target static void MultiplySparse(const int8_t *A, const SparseB &B, Index A_rows, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) { \
+  assert(B.tile_rows == sizeof(Register)); \
+  assert(A_row_end <= A_rows); \
+  assert(B_col_begin % 8 == 0 && B_col_end % 8 == 0 && B_col_end <= B.cols); \
+  assert(reinterpret_cast<uintptr_t>(A) % sizeof(Register) == 0); \
+  const Index simd_width = B.rows / sizeof(Register); \
+  const Register *A_reg = reinterpret_cast<const Register *>(A); \
+  auto callback_impl = callbacks::CallbackImpl<cpu_type, Callback>(callback); \
+  for (Index block_begin = A_row_begin; block_begin < A_row_end; block_begin += kMultiplyBlockRows) { \
+    const Index block_rows = std::min(kMultiplyBlockRows, A_row_end - block_begin); \
+    for (Index B0_colidx = B_col_begin; B0_colidx < B_col_end; B0_colidx += 8) { \
+      MultiplySparseTile(A_reg + block_begin * simd_width, block_begin, block_rows, B, A_rows, simd_width, B0_colidx, callback_impl); \
+    } \
+  } \
+} \
+template <typename Callback> target static void MultiplySparse(const int8_t *A, const SparseB &B, Index A_rows, Callback callback) { \
+  OMPWrapRanges(ChoosePartition(A_rows, B.cols, OMPTasks()), [&](Index row_begin, Index row_end, Index col_begin, Index col_end) { \
+    MultiplySparse<Callback>(A, B, A_rows, callback, row_begin, row_end, col_begin, col_end); \
+  }); \
+}
+
+/* MultiplyColumns for the columns [cols_begin, cols_end) of B from PrepareB,
+ * kRows rows of A at a time with Strip.  The result is the same as
+ * SelectColumnsB followed by Multiply, but the Tile gathers each panel of its
+ * 8 selected columns onto the stack as it goes so the selected B is never
+ * written out.  This suits a vocabulary shortlist that changes every batch.
+ */
+#define INTGEMM_MULTIPLY_COLUMNS(Register, target, cpu_type, kStripRows, Strip) \
+template <Index kRows, class CallbackImpl> target static inline void MultiplyColumnsTile(const Register *A_block, Index A_stride, Index block_begin, Index block_rows, const Register *B, const Index *cols, Index A_rows, Index simd_width, Index B_cols, Index B0_colidx, CallbackImpl &callback_impl) { \
+  typedef INTGEMM_MULTIPLY_TOTAL(Register) Total; \
+  const Index panel_width = kMultiplyPanelBytes / sizeof(Register); \
+  const Index blocked_rows = block_rows - block_rows % kRows; \
+  const Register *starts[8]; \
+  for (Index c = 0; c < 8; ++c) { \
+    starts[c] = B + (cols[B0_colidx + c] & 7) + (cols[B0_colidx + c] & ~7) * simd_width; \
+  } \
+  const Index prefetch = PrefetchDistance(sizeof(Register)); \
+  Register panel[8 * (kMultiplyPanelBytes / sizeof(Register))]; \
+  Total totals[kMultiplyBlockRows]; \
+  for (Index k = 0; k < simd_width; k += panel_width) { \
+    const Index count = std::min(panel_width, simd_width - k); \
+    for (Index i = 0; i < count; ++i) { \
+      for (Index c = 0; c < 8; ++c) { \
+        panel[i * 8 + c] = starts[c][(k + i) * 8]; \
+      } \
+    } \
+    INTGEMM_MULTIPLY_PANEL(Strip, panel) \
+  } \
+  for (Index r = 0; r < block_rows; ++r) { \
+    RunCallback(callback_impl, totals[r], block_begin + r, B0_colidx, A_rows, B_cols); \
+  } \
+} \
+template <typename Callback> target static void MultiplyColumns(const int8_t *A, const int8_t *B, Index A_rows, Index width, const Index *cols_begin, const Index *cols_end, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) { \
+  const Index B_cols = static_cast<Index>(cols_end - cols_begin); \
+  assert(width % sizeof(Register) == 0); \
+  assert(B_cols % 8 == 0); \
+  assert(A_row_end <= A_rows); \
+  assert(B_col_begin % 8 == 0 && B_col_end % 8 == 0 && B_col_end <= B_cols); \
+  assert(reinterpret_cast<uintptr_t>(A) % sizeof(Register) == 0); \
+  assert(reinterpret_cast<uintptr_t>(B) % sizeof(Register) == 0); \
+  const Index simd_width = width / sizeof(Register); \
+  const Register *A_reg = reinterpret_cast<const Register *>(A); \
+  const Register *B_reg = reinterpret_cast<const Register *>(B); \
+  auto callback_impl = callbacks::CallbackImpl<cpu_type, Callback>(callback); \
+  for (Index block_begin = A_row_begin; block_begin < A_row_end; block_begin += kMultiplyBlockRows) { \
+    const Index block_rows = std::min(kMultiplyBlockRows, A_row_end - block_begin); \
+    for (Index B0_colidx = B_col_begin; B0_colidx < B_col_end; B0_colidx += 8) { \
+      MultiplyColumnsTile<kStripRows>(A_reg + block_begin * simd_width, simd_width, block_begin, block_rows, B_reg, cols_begin, A_rows, simd_width, B_cols, B0_colidx, callback_impl); \
+    } \
+  } \
+} \
+template <typename Callback> target static void MultiplyColumns(const int8_t *A, const int8_t *B, Index A_rows, Index width, const Index *cols_begin, const Index *cols_end, Callback callback) { \
+  OMPWrapRanges(ChoosePartition(A_rows, static_cast<Index>(cols_end - cols_begin), OMPTasks()), [&](Index row_begin, Index row_end, Index col_begin, Index col_end) { \
+    MultiplyColumns<Callback>(A, B, A_rows, width, cols_begin, cols_end, callback, row_begin, row_end, col_begin, col_end); \
+  }); \
+}
+
+/* Unpack for INTGEMM_MULTIPLY_BLOCKED_INT4 from the generic intrinsics: count
+ * packed registers become 2 * count registers of bytes in [-8, 7].  A nibble
+ * is sign extended as (n ^ 8) - 8.
+ */
+#define INTGEMM_UNPACK_INT4(target, Register) \
+target static inline void UnpackInt4(const Register *packed, Register *out, Index count) { \
+  const Register low4 = set1_epi8<Register>(0x0f); \
+  const Register eight = set1_epi8<Register>(8); \
+  const Register minus_eight = set1_epi8<Register>(-8); \
+  for (Index i = 0; i < count; ++i) { \
+    out[2 * i] = add_epi8(xor_si(and_si(packed[i], low4), eight), minus_eight); \
+    out[2 * i + 1] = add_epi8(xor_si(and_si(srli_epi16<4>(packed[i]), low4), eight), minus_eight); \
+  } \
+}
+
+/* Per-thread buffer of at least size elements for quantizing blocks of A.  It
+ * grows to the largest block seen and is reused by later calls.
+ */
+template <class Integer> static inline Integer *ThreadBlockBuffer(std::size_t size) {
+  static thread_local AlignedVector<Integer> buffer;
+  if (buffer.size() < size) buffer = AlignedVector<Integer>(size);
+  return buffer.begin();
+}
+
+/* Generates Name<Callback> taking A as floats, on top of the Rows##Tile
+ * driver from INTGEMM_MULTIPLY_BLOCKED.  Instead of PrepareA writing all of
+ * A out and Multiply reading it back, each thread quantizes one block of
+ * kMultiplyBlockRows rows with QuantizeSerial, so no parallel region nests
+ * inside the OpenMP team or an Executor's threads, into its
+ * ThreadBlockBuffer then multiplies the block by its strips of B while it is
+ * still in cache.  The results are the same as Quantize or QuantizeU
+ * followed by the Rows driver.
+ */
+#define INTGEMM_MULTIPLY_FLOAT_A(AType, BType, Register, target, cpu_type, Name, Rows, kRows) \
+template <typename Callback> target static void Name(const float *A, float quant_mult, const BType *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) { \
+  assert(width % (sizeof(Register) / sizeof(AType)) == 0); \
+  assert(B_cols % 8 == 0); \
+  assert(A_row_end <= A_rows); \
+  assert(B_col_begin % 8 == 0 && B_col_end % 8 == 0 && B_col_end <= B_cols); \
+  assert(reinterpret_cast<uintptr_t>(A) % sizeof(Register) == 0); \
+  assert(reinterpret_cast<uintptr_t>(B) % sizeof(Register) == 0); \
+  if (A_row_begin >= A_row_end || B_col_begin >= B_col_end) return; \
+  const Index simd_width = width / (sizeof(Register) / sizeof(AType)); \
+  const Register *B_reg = reinterpret_cast<const Register *>(B); \
+  auto callback_impl = callbacks::CallbackImpl<cpu_type, Callback>(callback); \
+  AType *block = ThreadBlockBuffer<AType>(static_cast<std::size_t>(std::min(kMultiplyBlockRows, A_row_end - A_row_begin)) * width); \
+  for (Index block_begin = A_row_begin; block_begin < A_row_end; block_begin += kMultiplyBlockRows) { \
+    const Index block_rows = std::min(kMultiplyBlockRows, A_row_end - block_begin); \
+    QuantizeSerial(A + static_cast<std::size_t>(block_begin) * width, block, quant_mult, static_cast<std::size_t>(block_rows) * width); \
+    for (Index B0_colidx = B_col_begin; B0_colidx < B_col_end; B0_colidx += 8) { \
+      Rows##Tile<kRows>(reinterpret_cast<const Register *>(block), simd_width, block_begin, block_rows, B_reg, A_rows, simd_width, B_cols, B0_colidx, callback_impl); \
+    } \
+  } \
+} \
+template <typename Callback> target static void Name(const float *A, float quant_mult, const BType *B, Index A_rows, Index width, Index B_cols, Callback callback) { \
+  OMPWrapRanges(ChoosePartition(A_rows, B_cols, OMPTasks()), [&](Index row_begin, Index row_end, Index col_begin, Index col_end) { \
+    Name<Callback>(A, quant_mult, B, A_rows, width, B_cols, callback, row_begin, row_end, col_begin, col_end); \
+  }); \
+} \
+
+/* Generates Name<Callback> multiplying A by the transpose of a quantized but
+ * unprepared B, B_rows rows of width in row major order, on top of
+ * Rows##StripTile from INTGEMM_MULTIPLY_BLOCKED, the Tile given its strip of
+ * B.  Prepared B is the registers of 8 rows of B interleaved, as
+ * PrepareBQuantizedTransposed copies them, so nothing is transposed: each
+ * thread gathers a strip of 8 rows into its ThreadBlockBuffer, zero past
+ * B_rows, and runs the Tile on it while it is in L1.  Columns of C go up to B_rows rounded up to 8, so the
+ * callback should drop the padding with ColumnTail.  The results are the
+ * same as PrepareBQuantizedTransposed of B padded with zero rows followed by
+ * the Rows driver.
+ */
+#define INTGEMM_MULTIPLY_NT(Register, target, cpu_type, Name, Rows, kRows) \
+template <typename Callback> target static void Name(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_rows, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) { \
+  const Index B_cols = (B_rows + 7) / 8 * 8; \
+  assert(width % sizeof(Register) == 0); \
+  assert(A_row_end <= A_rows); \
+  assert(B_col_begin % 8 == 0 && B_col_end % 8 == 0 && B_col_end <= B_cols); \
+  assert(reinterpret_cast<uintptr_t>(A) % sizeof(Register) == 0); \
+  assert(reinterpret_cast<uintptr_t>(B) % sizeof(Register) == 0); \
+  if (A_row_begin >= A_row_end || B_col_begin >= B_col_end) return; \
+  const Index simd_width = width / sizeof(Register); \
+  const Register *A_reg = reinterpret_cast<const Register *>(A); \
+  const Register *B_reg = reinterpret_cast<const Register *>(B); \
+  auto callback_impl = callbacks::CallbackImpl<cpu_type, Callback>(callback); \
+  Register *strip = ThreadBlockBuffer<Register>(8 * static_cast<std::size_t>(simd_width)); \
+  for (Index block_begin = A_row_begin; block_begin < A_row_end; block_begin += kMultiplyBlockRows) { \
+    const Index block_rows = std::min(kMultiplyBlockRows, A_row_end - block_begin); \
+    for (Index B0_colidx = B_col_begin; B0_colidx < B_col_end; B0_colidx += 8) { \
+      for (Index c = 0; c < 8; ++c) { \
+        if (B0_colidx + c < B_rows) { \
+          const Register *row = B_reg + (B0_colidx + c) * simd_width; \
+          for (Index k = 0; k < simd_width; ++k) strip[k * 8 + c] = row[k]; \
+        } else { \
+          for (Index k = 0; k < simd_width; ++k) std::memset(strip + k * 8 + c, 0, sizeof(Register)); \
+        } \
+      } \
+      Rows##StripTile<kRows>(A_reg + block_begin * simd_width, simd_width, block_begin, block_rows, strip, A_rows, simd_width, B_cols, B0_colidx, callback_impl); \
+    } \
+  } \
+} \
+template <typename Callback> target static void Name(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_rows, Callback callback) { \
+  OMPWrapRanges(ChoosePartition(A_rows, (B_rows + 7) / 8 * 8, OMPTasks()), [&](Index row_begin, Index row_end, Index col_begin, Index col_end) { \
+    Name<Callback>(A, B, A_rows, width, B_rows, callback, row_begin, row_end, col_begin, col_end); \
+  }); \
+}
+
+/* The kernels for MultiplySplitK, on top of Rows##StripTile from
+ * INTGEMM_MULTIPLY_BLOCKED.  MultiplySlice multiplies a tile of the output
+ * over only [k_begin, k_end) of the shared dimension, on the calling thread.
+ * A slice of a strip of prepared B is contiguous, so this is the Tile with A
+ * and B offset to k_begin.  Slices cut at multiples of kMultiplyPanelBytes
+ * keep the panels where Multiply has them, so saturating kernels saturate
+ * the same way and the slices add up to Multiply's result exactly.
+ *
+ * ReducePartials adds parts int32 A_rows x B_cols matrices, each
+ * A_rows * B_cols after the last, and runs the callback on a tile of the
+ * sums.  partials is aligned like prepared B.
+ */
+#define INTGEMM_MULTIPLY_SPLIT_K(Register, target, cpu_type, Rows, kRows) \
+template <typename Callback> target static void MultiplySlice(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index k_begin, Index k_end, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) { \
+  assert(width % sizeof(Register) == 0); \
+  assert(k_begin % sizeof(Register) == 0 && k_end % sizeof(Register) == 0); \
+  assert(k_begin < k_end && k_end <= width); \
+  assert(B_cols % 8 == 0); \
+  assert(A_row_end <= A_rows); \
+  assert(B_col_begin % 8 == 0 && B_col_end % 8 == 0 && B_col_end <= B_cols); \
+  assert(reinterpret_cast<uintptr_t>(A) % sizeof(Register) == 0); \
+  assert(reinterpret_cast<uintptr_t>(B) % sizeof(Register) == 0); \
+  const Index simd_width = width / sizeof(Register); \
+  const Index k_offset = k_begin / sizeof(Register); \
+  const Index count = (k_end - k_begin) / sizeof(Register); \
+  const Register *A_reg = reinterpret_cast<const Register *>(A) + k_offset; \
+  const Register *B_reg = reinterpret_cast<const Register *>(B) + k_offset * 8; \
+  auto callback_impl = callbacks::CallbackImpl<cpu_type, Callback>(callback); \
+  for (Index block_begin = A_row_begin; block_begin < A_row_end; block_begin += kMultiplyBlockRows) { \
+    const Index block_rows = std::min(kMultiplyBlockRows, A_row_end - block_begin); \
+    for (Index B0_colidx = B_col_begin; B0_colidx < B_col_end; B0_colidx += 8) { \
+      Rows##StripTile<kRows>(A_reg + block_begin * simd_width, simd_width, block_begin, block_rows, B_reg + simd_width * B0_colidx, A_rows, count, B_cols, B0_colidx, callback_impl); \
+    } \
+  } \
+} \
+INTGEMM_REDUCE_PARTIALS(Register, target, cpu_type)
+
+#define INTGEMM_REDUCE_PARTIALS(Register, target, cpu_type) \
+template <typename Callback> target static void ReducePartials(const int32_t *partials, Index parts, Index A_rows, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) { \
+  typedef INTGEMM_MULTIPLY_TOTAL(Register) Total; \
+  const std::size_t size = static_cast<std::size_t>(A_rows) * B_cols; \
+  auto callback_impl = callbacks::CallbackImpl<cpu_type, Callback>(callback); \
+  for (Index r = A_row_begin; r < A_row_end; ++r) { \
+    for (Index c = B_col_begin; c < B_col_end; c += 8) { \
+      const int32_t *tile = partials + static_cast<std::size_t>(r) * B_cols + c; \
+      Total total = *reinterpret_cast<const Total*>(tile); \
+      for (Index p = 1; p < parts; ++p) { \
+        total = AddTotals(total, *reinterpret_cast<const Total*>(tile + p * size)); \
+      } \
+      RunCallback(callback_impl, total, r, c, A_rows, B_cols); \
+    } \
+  } \
+}
+
 // 16-bit multiplier for INTGEMM_SSE2, INTGEMM_AVX2, and AVX512.
 // C = A * B * unquant_mult
 //
@@ -159,61 +940,58 @@ INTGEMM_AVX2 static inline void RunCallback(Callback& callback_impl, vector_t<CP
 // B_cols must be a multiple of 8.
 // Multiply16
 #define INTGEMM_MULTIPLY16(Register, target, cpu_type) \
-template <typename Callback> target static void Multiply(const int16_t *A, const int16_t *B, Index A_rows, Index width, Index B_cols, Callback callback) { \
-  assert(width % (sizeof(Register) / sizeof(int16_t)) == 0); \
-  assert(B_cols % 8 == 0); \
-  assert(reinterpret_cast<uintptr_t>(A) % sizeof(Register) == 0); \
-  assert(reinterpret_cast<uintptr_t>(B) % sizeof(Register) == 0); \
-  const Index simd_width = width / (sizeof(Register) / sizeof(int16_t)); \
-  auto callback_impl = callbacks::CallbackImpl<cpu_type, Callback>(callback); \
-  INTGEMM_OMP_FOR \
-  for (Index B0_colidx = 0; B0_colidx < B_cols; B0_colidx += 8) { \
-    const Register *B0_col = reinterpret_cast<const Register *>(B) + simd_width * B0_colidx; \
-    /* Process one row of A at a time.  Doesn't seem to be faster to do multiple rows of A at once.*/ \
-    for (Index A_rowidx = 0; A_rowidx < A_rows; ++A_rowidx) { \
-      const Register *A_row = reinterpret_cast<const Register*>(A + A_rowidx * width); \
-      /* These will be packed 32-bit integers containing sums for each row of B multiplied by the row of A. \
-         Iterate over shared (inner) dimension.*/ \
-      Index k = 0; \
-      Register a = *(A_row + k); \
-      Register sum0 = madd_epi16(a, *(B0_col + k * 8)); \
-      Register sum1 = madd_epi16(a, *(B0_col + k * 8 + 1)); \
-      Register sum2 = madd_epi16(a, *(B0_col + k * 8 + 2)); \
-      Register sum3 = madd_epi16(a, *(B0_col + k * 8 + 3)); \
-      Register sum4 = madd_epi16(a, *(B0_col + k * 8 + 4)); \
-      Register sum5 = madd_epi16(a, *(B0_col + k * 8 + 5)); \
-      Register sum6 = madd_epi16(a, *(B0_col + k * 8 + 6)); \
-      Register sum7 = madd_epi16(a, *(B0_col + k * 8 + 7)); \
-      for (k = 1; k < simd_width; ++k) { \
-        a = *(A_row + k); \
-        /* Multiply 16-bit, horizontally add to packed 32-bit integers.*/ \
-        Register mult0 = madd_epi16(a, *(B0_col + k * 8)); \
-        Register mult1 = madd_epi16(a, *(B0_col + k * 8 + 1)); \
-        Register mult2 = madd_epi16(a, *(B0_col + k * 8 + 2)); \
-        Register mult3 = madd_epi16(a, *(B0_col + k * 8 + 3)); \
-        Register mult4 = madd_epi16(a, *(B0_col + k * 8 + 4)); \
-        Register mult5 = madd_epi16(a, *(B0_col + k * 8 + 5)); \
-        Register mult6 = madd_epi16(a, *(B0_col + k * 8 + 6)); \
-        Register mult7 = madd_epi16(a, *(B0_col + k * 8 + 7)); \
-        /* Sum packed 32-bit integers with danger of overflow.  TODO: accumulate in 64-bit every so often.*/ \
-        sum0 = add_epi32(sum0, mult0); \
-        sum1 = add_epi32(sum1, mult1); \
-        sum2 = add_epi32(sum2, mult2); \
-        sum3 = add_epi32(sum3, mult3); \
-        sum4 = add_epi32(sum4, mult4); \
-        sum5 = add_epi32(sum5, mult5); \
-        sum6 = add_epi32(sum6, mult6); \
-        sum7 = add_epi32(sum7, mult7); \
-      } \
-      /* Reduce sums within 128-bit lanes.*/ \
-      Register pack0123 = Pack0123(sum0, sum1, sum2, sum3); \
-      Register pack4567 = Pack0123(sum4, sum5, sum6, sum7); \
-      /*The specific implementation may need to reduce further.*/ \
-      auto total = PermuteSummer(pack0123, pack4567); \
-      RunCallback(callback_impl, total, A_rowidx, B0_colidx, A_rows, B_cols); \
+template <Index kRows> target static inline void MultiplyStrip(const Register *A, Index A_stride, const Register *B0_col, Index count, INTGEMM_MULTIPLY_TOTAL(Register) *totals) { \
+  /* The kRows rows of A of the block in turn, reusing this panel of B from L1. */ \
+  for (Index r = 0; r < kRows; ++r) { \
+    const Register *A_row = A + r * A_stride; \
+    /* These will be packed 32-bit integers containing sums for each row of B multiplied by the row of A. \
+       Iterate over shared (inner) dimension.*/ \
+    Index k = 0; \
+    Register a = *(A_row + k); \
+    Register sum0 = madd_epi16(a, *(B0_col + k * 8)); \
+    Register sum1 = madd_epi16(a, *(B0_col + k * 8 + 1)); \
+    Register sum2 = madd_epi16(a, *(B0_col + k * 8 + 2)); \
+    Register sum3 = madd_epi16(a, *(B0_col + k * 8 + 3)); \
+    Register sum4 = madd_epi16(a, *(B0_col + k * 8 + 4)); \
+    Register sum5 = madd_epi16(a, *(B0_col + k * 8 + 5)); \
+    Register sum6 = madd_epi16(a, *(B0_col + k * 8 + 6)); \
+    Register sum7 = madd_epi16(a, *(B0_col + k * 8 + 7)); \
+    for (k = 1; k < count; ++k) { \
+      a = *(A_row + k); \
+      /* Multiply 16-bit, horizontally add to packed 32-bit integers.*/ \
+      Register mult0 = madd_epi16(a, *(B0_col + k * 8)); \
+      Register mult1 = madd_epi16(a, *(B0_col + k * 8 + 1)); \
+      Register mult2 = madd_epi16(a, *(B0_col + k * 8 + 2)); \
+      Register mult3 = madd_epi16(a, *(B0_col + k * 8 + 3)); \
+      Register mult4 = madd_epi16(a, *(B0_col + k * 8 + 4)); \
+      Register mult5 = madd_epi16(a, *(B0_col + k * 8 + 5)); \
+      Register mult6 = madd_epi16(a, *(B0_col + k * 8 + 6)); \
+      Register mult7 = madd_epi16(a, *(B0_col + k * 8 + 7)); \
+      /* Sum packed 32-bit integers with danger of overflow.  TODO: accumulate in 64-bit every so often.*/ \
+      sum0 = add_epi32(sum0, mult0); \
+      sum1 = add_epi32(sum1, mult1); \
+      sum2 = add_epi32(sum2, mult2); \
+      sum3 = add_epi32(sum3, mult3); \
+      sum4 = add_epi32(sum4, mult4); \
+      sum5 = add_epi32(sum5, mult5); \
+      sum6 = add_epi32(sum6, mult6); \
+      sum7 = add_epi32(sum7, mult7); \
     } \
+    /* Reduce sums within 128-bit lanes.*/ \
+    Register pack0123 = Pack0123(sum0, sum1, sum2, sum3); \
+    Register pack4567 = Pack0123(sum4, sum5, sum6, sum7); \
+    /*The specific implementation may need to reduce further.*/ \
+    totals[r] = PermuteSummer(pack0123, pack4567); \
   } \
 } \
+INTGEMM_MULTIPLY_BLOCKED(int16_t, int16_t, Register, target, cpu_type, MultiplyRows, MultiplyStrip) \
+template <typename Callback> target static void Multiply(const int16_t *A, const int16_t *B, Index A_rows, Index width, Index B_cols, Callback callback) { \
+  MultiplyRows<1, Callback>(A, B, A_rows, width, B_cols, callback); \
+} \
+template <typename Callback> target static void Multiply(const int16_t *A, const int16_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) { \
+  MultiplyRows<1, Callback>(A, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end); \
+} \
+INTGEMM_MULTIPLY_STRIDED(int16_t, int16_t, target, MultiplyRows, 1)
 
 //An int8_prepbias version of the above code, using the add 127 technique
 #define INTGEMM_PREPAREBIASFOR8(Register, target, cpu_type) \
@@ -291,81 +1069,77 @@ template <typename Callback> target static void Multiply(const int16_t *A, const
 
 //An int8 version of the above code, using the add 127 technique
 #define INTGEMM_MULTIPLY8SHIFT(Register, target, cpu_type) \
-  template <class Callback> target static void Multiply8Shift(const uint8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) { \
-  assert(width % (sizeof(Register) / sizeof(int8_t)) == 0); \
-  assert(B_cols % 8 == 0); \
-  assert(reinterpret_cast<uintptr_t>(A) % sizeof(Register) == 0); \
-  assert(reinterpret_cast<uintptr_t>(B) % sizeof(Register) == 0); \
-  const Index simd_width = width / (sizeof(Register) / sizeof(int8_t)); \
-  auto callback_impl = callbacks::CallbackImpl<cpu_type, Callback>(callback); \
-  INTGEMM_OMP_FOR \
-  for (Index B0_colidx = 0; B0_colidx < B_cols; B0_colidx += 8) { \
-    const Register *B0_col = reinterpret_cast<const Register *>(B) + simd_width * B0_colidx; \
-    /* Process one row of A at a time.  Doesn't seem to be faster to do multiple rows of A at once.*/ \
-    for (Index A_rowidx = 0; A_rowidx < A_rows; ++A_rowidx) { \
-      const Register *A_row = reinterpret_cast<const Register*>(A + A_rowidx * width); \
-      /* These will be packed 16-bit integers containing sums for each row of B multiplied by the row of A. \
-         Iterate over shared (inner) dimension.*/ \
-      Index k = 0; \
-      Register a = *(A_row + k); \
-      Register sum0 = maddubs_epi16(a, *(B0_col + k * 8)); \
-      Register sum1 = maddubs_epi16(a, *(B0_col + k * 8 + 1)); \
-      Register sum2 = maddubs_epi16(a, *(B0_col + k * 8 + 2)); \
-      Register sum3 = maddubs_epi16(a, *(B0_col + k * 8 + 3)); \
-      Register sum4 = maddubs_epi16(a, *(B0_col + k * 8 + 4)); \
-      Register sum5 = maddubs_epi16(a, *(B0_col + k * 8 + 5)); \
-      Register sum6 = maddubs_epi16(a, *(B0_col + k * 8 + 6)); \
-      Register sum7 = maddubs_epi16(a, *(B0_col + k * 8 + 7)); \
-      /* Upcast to 32-bit and horizontally add. Seems a bit faster if this is declared here.*/ \
-      Register ones = set1_epi16<Register>(1); \
-      sum0 = madd_epi16(sum0, ones); \
-      sum1 = madd_epi16(sum1, ones); \
-      sum2 = madd_epi16(sum2, ones); \
-      sum3 = madd_epi16(sum3, ones); \
-      sum4 = madd_epi16(sum4, ones); \
-      sum5 = madd_epi16(sum5, ones); \
-      sum6 = madd_epi16(sum6, ones); \
-      sum7 = madd_epi16(sum7, ones); \
-      for (k = 1; k < simd_width; ++k) { \
-        a = *(A_row + k); \
-        /* Multiply 8-bit, horizontally add to packed 16-bit integers.*/ \
-        Register mult0 = maddubs_epi16(a, *(B0_col + k * 8)); \
-        Register mult1 = maddubs_epi16(a, *(B0_col + k * 8 + 1)); \
-        Register mult2 = maddubs_epi16(a, *(B0_col + k * 8 + 2)); \
-        Register mult3 = maddubs_epi16(a, *(B0_col + k * 8 + 3)); \
-        Register mult4 = maddubs_epi16(a, *(B0_col + k * 8 + 4)); \
-        Register mult5 = maddubs_epi16(a, *(B0_col + k * 8 + 5)); \
-        Register mult6 = maddubs_epi16(a, *(B0_col + k * 8 + 6)); \
-        Register mult7 = maddubs_epi16(a, *(B0_col + k * 8 + 7)); \
-        /* Upcast to 32-bit and horizontally add.*/ \
-        mult0 = madd_epi16(mult0, ones); \
-        mult1 = madd_epi16(mult1, ones); \
-        mult2 = madd_epi16(mult2, ones); \
-        mult3 = madd_epi16(mult3, ones); \
-        mult4 = madd_epi16(mult4, ones); \
-        mult5 = madd_epi16(mult5, ones); \
-        mult6 = madd_epi16(mult6, ones); \
-        mult7 = madd_epi16(mult7, ones); \
-        /*Add in 32bit*/ \
-        sum0 = add_epi32(sum0, mult0); \
-        sum1 = add_epi32(sum1, mult1); \
-        sum2 = add_epi32(sum2, mult2); \
-        sum3 = add_epi32(sum3, mult3); \
-        sum4 = add_epi32(sum4, mult4); \
-        sum5 = add_epi32(sum5, mult5); \
-        sum6 = add_epi32(sum6, mult6); \
-        sum7 = add_epi32(sum7, mult7); \
-         \
-      } \
-      /* Reduce sums within 128-bit lanes.*/ \
-      Register pack0123 = Pack0123(sum0, sum1, sum2, sum3); \
-      Register pack4567 = Pack0123(sum4, sum5, sum6, sum7); \
-      /*The specific implementation may need to reduce further.*/ \
-      auto total = PermuteSummer(pack0123, pack4567); \
-      RunCallback(callback_impl, total, A_rowidx, B0_colidx, A_rows, B_cols); \
+template <Index kRows> target static inline void Multiply8ShiftStrip(const Register *A, Index A_stride, const Register *B0_col, Index count, INTGEMM_MULTIPLY_TOTAL(Register) *totals) { \
+  /* The kRows rows of A of the block in turn, reusing this panel of B from L1. */ \
+  for (Index r = 0; r < kRows; ++r) { \
+    const Register *A_row = A + r * A_stride; \
+    /* These will be packed 16-bit integers containing sums for each row of B multiplied by the row of A. \
+       Iterate over shared (inner) dimension.*/ \
+    Index k = 0; \
+    Register a = *(A_row + k); \
+    Register sum0 = maddubs_epi16(a, *(B0_col + k * 8)); \
+    Register sum1 = maddubs_epi16(a, *(B0_col + k * 8 + 1)); \
+    Register sum2 = maddubs_epi16(a, *(B0_col + k * 8 + 2)); \
+    Register sum3 = maddubs_epi16(a, *(B0_col + k * 8 + 3)); \
+    Register sum4 = maddubs_epi16(a, *(B0_col + k * 8 + 4)); \
+    Register sum5 = maddubs_epi16(a, *(B0_col + k * 8 + 5)); \
+    Register sum6 = maddubs_epi16(a, *(B0_col + k * 8 + 6)); \
+    Register sum7 = maddubs_epi16(a, *(B0_col + k * 8 + 7)); \
+    /* Upcast to 32-bit and horizontally add. Seems a bit faster if this is declared here.*/ \
+    Register ones = set1_epi16<Register>(1); \
+    sum0 = madd_epi16(sum0, ones); \
+    sum1 = madd_epi16(sum1, ones); \
+    sum2 = madd_epi16(sum2, ones); \
+    sum3 = madd_epi16(sum3, ones); \
+    sum4 = madd_epi16(sum4, ones); \
+    sum5 = madd_epi16(sum5, ones); \
+    sum6 = madd_epi16(sum6, ones); \
+    sum7 = madd_epi16(sum7, ones); \
+    for (k = 1; k < count; ++k) { \
+      a = *(A_row + k); \
+      /* Multiply 8-bit, horizontally add to packed 16-bit integers.*/ \
+      Register mult0 = maddubs_epi16(a, *(B0_col + k * 8)); \
+      Register mult1 = maddubs_epi16(a, *(B0_col + k * 8 + 1)); \
+      Register mult2 = maddubs_epi16(a, *(B0_col + k * 8 + 2)); \
+      Register mult3 = maddubs_epi16(a, *(B0_col + k * 8 + 3)); \
+      Register mult4 = maddubs_epi16(a, *(B0_col + k * 8 + 4)); \
+      Register mult5 = maddubs_epi16(a, *(B0_col + k * 8 + 5)); \
+      Register mult6 = maddubs_epi16(a, *(B0_col + k * 8 + 6)); \
+      Register mult7 = maddubs_epi16(a, *(B0_col + k * 8 + 7)); \
+      /* Upcast to 32-bit and horizontally add.*/ \
+      mult0 = madd_epi16(mult0, ones); \
+      mult1 = madd_epi16(mult1, ones); \
+      mult2 = madd_epi16(mult2, ones); \
+      mult3 = madd_epi16(mult3, ones); \
+      mult4 = madd_epi16(mult4, ones); \
+      mult5 = madd_epi16(mult5, ones); \
+      mult6 = madd_epi16(mult6, ones); \
+      mult7 = madd_epi16(mult7, ones); \
+      /*Add in 32bit*/ \
+      sum0 = add_epi32(sum0, mult0); \
+      sum1 = add_epi32(sum1, mult1); \
+      sum2 = add_epi32(sum2, mult2); \
+      sum3 = add_epi32(sum3, mult3); \
+      sum4 = add_epi32(sum4, mult4); \
+      sum5 = add_epi32(sum5, mult5); \
+      sum6 = add_epi32(sum6, mult6); \
+      sum7 = add_epi32(sum7, mult7); \
     } \
+    /* Reduce sums within 128-bit lanes.*/ \
+    Register pack0123 = Pack0123(sum0, sum1, sum2, sum3); \
+    Register pack4567 = Pack0123(sum4, sum5, sum6, sum7); \
+    /*The specific implementation may need to reduce further.*/ \
+    totals[r] = PermuteSummer(pack0123, pack4567); \
   } \
 } \
+INTGEMM_MULTIPLY_BLOCKED(uint8_t, int8_t, Register, target, cpu_type, Multiply8ShiftRows, Multiply8ShiftStrip) \
+template <class Callback> target static void Multiply8Shift(const uint8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) { \
+  Multiply8ShiftRows<1, Callback>(A, B, A_rows, width, B_cols, callback); \
+} \
+template <class Callback> target static void Multiply8Shift(const uint8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) { \
+  Multiply8ShiftRows<1, Callback>(A, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end); \
+} \
+INTGEMM_MULTIPLY_FLOAT_A(uint8_t, int8_t, Register, target, cpu_type, Multiply8ShiftFloatA, Multiply8ShiftRows, 1) \
 
 /* 8-bit matrix multiply used by AVX and AVX2.
  * These have two peculiar properties:
@@ -521,6 +1295,7 @@ INTGEMM_AVX2 inline static void InnerINTGEMM_AVX2(
 }
 #endif
 
+#ifndef INTGEMM_COMPILER_SUPPORTS_NEON
 // For INTGEMM_SSSE3 without AVX
 INTGEMM_SSSE3 inline static void InnerINTGEMM_SSSE3(
     __m128i a, const __m128i *b,
@@ -536,74 +1311,80 @@ INTGEMM_SSSE3 inline static void InnerINTGEMM_SSSE3(
   sum6 = adds_epi16(sum6, maddubs_epi16(a_positive, sign_epi8(b[6], a)));
   sum7 = adds_epi16(sum7, maddubs_epi16(a_positive, sign_epi8(b[7], a)));
 }
+#endif
 //INTGEMM_AVX2 or INTGEMM_SSSE3 multiply
 #define INTGEMM_MULTIPLY8(Register, target, cpu_type) \
-  template <typename Callback> target static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) { \
-  assert(width % sizeof(Register) == 0); \
-  assert(B_cols % 8 == 0); \
-  assert(reinterpret_cast<uintptr_t>(A) % sizeof(Register) == 0); \
-  assert(reinterpret_cast<uintptr_t>(B) % sizeof(Register) == 0); \
-  const Index simd_width = width / sizeof(Register); \
-  auto callback_impl = callbacks::CallbackImpl<cpu_type, Callback>(callback); \
-  INTGEMM_OMP_FOR \
-  for (Index B0_colidx = 0; B0_colidx < B_cols; B0_colidx += 8) { \
-    const Register *B0_col = reinterpret_cast<const Register *>(B) + simd_width * B0_colidx; \
-    /*Process one row of A at a time.  Doesn't seem to be faster to do multiple rows of A at once.*/ \
-    for (Index A_rowidx = 0; A_rowidx < A_rows; ++A_rowidx) { \
-      /*Iterate over shared (inner) dimension.*/ \
-      const Register *A_live = reinterpret_cast<const Register *>(A + A_rowidx * width); \
-      const Register *A_end = A_live + simd_width; \
-      const Register *B_live = B0_col; \
-      /* Rather than initializing as zeros and adding, just initialize the first.*/ \
-      Register a = *(A_live++); \
-      Register a_positive = abs_epi8(a); \
-      /* These will be packed 16-bit integers containing sums for each column of B multiplied by the row of A.*/ \
-      Register sum0 = maddubs_epi16(a_positive, sign_epi8(B_live[0], a)); \
-      Register sum1 = maddubs_epi16(a_positive, sign_epi8(B_live[1], a)); \
-      Register sum2 = maddubs_epi16(a_positive, sign_epi8(B_live[2], a)); \
-      Register sum3 = maddubs_epi16(a_positive, sign_epi8(B_live[3], a)); \
-      Register sum4 = maddubs_epi16(a_positive, sign_epi8(B_live[4], a)); \
-      Register sum5 = maddubs_epi16(a_positive, sign_epi8(B_live[5], a)); \
-      Register sum6 = maddubs_epi16(a_positive, sign_epi8(B_live[6], a)); \
-      Register sum7 = maddubs_epi16(a_positive, sign_epi8(B_live[7], a)); \
-      B_live += 8; \
-      /* Use A as the loop variable so the add can be done where gcc likes it for branch prediction.*/ \
-      for (; A_live != A_end; ++A_live, B_live += 8) { \
-        Inner##target(*A_live, B_live, sum0, sum1, sum2, sum3, sum4, sum5, sum6, sum7); \
-      } \
-      /* Convert 16-bit to 32-bit and add, not caring what parts are added.
-       * Implementations:
-       * 1. https://github.com/tesseract-ocr/tesseract/blob/master/src/arch/intsimdmatrixavx2.cpp#L67 under Apache license:
-       *   This does a multiply by 1 and horizontal add:
-       *    _mm512_madd_epi16(sum, _mm512_set1_epi16(1))
-       *   Current fastest.
-       *
-       * 2. Signed extension and fold halves:
-       *    sum = _mm512_add_epi32(
-       *      _mm512_cvtepi16_epi32(_mm512_castsi512_si256(sum)),
-       *      _mm512_cvtepi16_epi32(_mm512_extracti64x4_epi64(sum, 1)));
-       *
-       * 3. Sign extend by abuse of bitshift, then add.
-       * sum = _mm512_add_epi32(
-       *      _mm512_srai_epi32(_mm512_slli_epi32(sum, 16), 16),
-       *      _mm512_srai_epi32(sum, 16));
-       */ \
-      Register ones = set1_epi16<Register>(1); \
-      sum0 = madd_epi16(sum0, ones); \
-      sum1 = madd_epi16(sum1, ones); \
-      sum2 = madd_epi16(sum2, ones); \
-      sum3 = madd_epi16(sum3, ones); \
-      sum4 = madd_epi16(sum4, ones); \
-      sum5 = madd_epi16(sum5, ones); \
-      sum6 = madd_epi16(sum6, ones); \
-      sum7 = madd_epi16(sum7, ones); \
-      Register pack0123 = Pack0123(sum0, sum1, sum2, sum3); \
-      Register pack4567 = Pack0123(sum4, sum5, sum6, sum7); \
-      auto total = PermuteSummer(pack0123, pack4567); \
-      RunCallback(callback_impl, total, A_rowidx, B0_colidx, A_rows, B_cols); \
+template <Index kRows> target static inline void MultiplyStrip(const Register *A, Index A_stride, const Register *B0_col, Index count, INTGEMM_MULTIPLY_TOTAL(Register) *totals) { \
+  /* The kRows rows of A of the block in turn, reusing this panel of B from L1. */ \
+  for (Index r = 0; r < kRows; ++r) { \
+    /*Iterate over shared (inner) dimension.*/ \
+    const Register *A_live = A + r * A_stride; \
+    const Register *A_end = A_live + count; \
+    const Register *B_live = B0_col; \
+    /* Rather than initializing as zeros and adding, just initialize the first.*/ \
+    Register a = *(A_live++); \
+    Register a_positive = abs_epi8(a); \
+    /* These will be packed 16-bit integers containing sums for each column of B multiplied by the row of A.*/ \
+    Register sum0 = maddubs_epi16(a_positive, sign_epi8(B_live[0], a)); \
+    Register sum1 = maddubs_epi16(a_positive, sign_epi8(B_live[1], a)); \
+    Register sum2 = maddubs_epi16(a_positive, sign_epi8(B_live[2], a)); \
+    Register sum3 = maddubs_epi16(a_positive, sign_epi8(B_live[3], a)); \
+    Register sum4 = maddubs_epi16(a_positive, sign_epi8(B_live[4], a)); \
+    Register sum5 = maddubs_epi16(a_positive, sign_epi8(B_live[5], a)); \
+    Register sum6 = maddubs_epi16(a_positive, sign_epi8(B_live[6], a)); \
+    Register sum7 = maddubs_epi16(a_positive, sign_epi8(B_live[7], a)); \
+    B_live += 8; \
+    /* Use A as the loop variable so the add can be done where gcc likes it for branch prediction.*/ \
+    for (; A_live != A_end; ++A_live, B_live += 8) { \
+      Inner##target(*A_live, B_live, sum0, sum1, sum2, sum3, sum4, sum5, sum6, sum7); \
     } \
+    /* Convert 16-bit to 32-bit and add, not caring what parts are added.
+     * Implementations:
+     * 1. https://github.com/tesseract-ocr/tesseract/blob/master/src/arch/intsimdmatrixavx2.cpp#L67 under Apache license:
+     *   This does a multiply by 1 and horizontal add:
+     *    _mm512_madd_epi16(sum, _mm512_set1_epi16(1))
+     *   Current fastest.
+     *
+     * 2. Signed extension and fold halves:
+     *    sum = _mm512_add_epi32(
+     *      _mm512_cvtepi16_epi32(_mm512_castsi512_si256(sum)),
+     *      _mm512_cvtepi16_epi32(_mm512_extracti64x4_epi64(sum, 1)));
+     *
+     * 3. Sign extend by abuse of bitshift, then add.
+     * sum = _mm512_add_epi32(
+     *      _mm512_srai_epi32(_mm512_slli_epi32(sum, 16), 16),
+     *      _mm512_srai_epi32(sum, 16));
+     */ \
+    Register ones = set1_epi16<Register>(1); \
+    sum0 = madd_epi16(sum0, ones); \
+    sum1 = madd_epi16(sum1, ones); \
+    sum2 = madd_epi16(sum2, ones); \
+    sum3 = madd_epi16(sum3, ones); \
+    sum4 = madd_epi16(sum4, ones); \
+    sum5 = madd_epi16(sum5, ones); \
+    sum6 = madd_epi16(sum6, ones); \
+    sum7 = madd_epi16(sum7, ones); \
+    Register pack0123 = Pack0123(sum0, sum1, sum2, sum3); \
+    Register pack4567 = Pack0123(sum4, sum5, sum6, sum7); \
+    totals[r] = PermuteSummer(pack0123, pack4567); \
   } \
-}
+} \
+INTGEMM_MULTIPLY_BLOCKED_SATURATING(int8_t, int8_t, Register, target, cpu_type, MultiplyRows, MultiplyStrip) \
+template <typename Callback> target static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) { \
+  MultiplyRows<1, Callback>(A, B, A_rows, width, B_cols, callback); \
+} \
+template <typename Callback> target static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) { \
+  MultiplyRows<1, Callback>(A, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end); \
+} \
+INTGEMM_MULTIPLY_STRIDED(int8_t, int8_t, target, MultiplyRows, 1) \
+INTGEMM_MULTIPLY_FIXED(int8_t, int8_t, target, MultiplyRows, 1) \
+INTGEMM_MULTIPLY_FLOAT_A(int8_t, int8_t, Register, target, cpu_type, MultiplyFloatA, MultiplyRows, 1) \
+INTGEMM_MULTIPLY_NT(Register, target, cpu_type, MultiplyNT, MultiplyRows, 1) \
+INTGEMM_UNPACK_INT4(target, Register) \
+INTGEMM_MULTIPLY4(Register, target, cpu_type, 1, MultiplyStrip, UnpackInt4) \
+INTGEMM_MULTIPLY_SPARSE(Register, target, cpu_type, 1, MultiplyStrip) \
+INTGEMM_MULTIPLY_COLUMNS(Register, target, cpu_type, 1, MultiplyStrip) \
+INTGEMM_MULTIPLY_SPLIT_K(Register, target, cpu_type, MultiplyRows, 1)
 
 /* Wrap a multiply call in OMP parallelism.  Here it launches threads then
  * inside the implementation there is a pragma omp for.  In gcc >= 8 these
@@ -615,12 +1396,277 @@ INTGEMM_SSSE3 inline static void InnerINTGEMM_SSSE3(
  * have a default template argument Integer then use that so it's resolved.
  */
 template <class Callback, class Backend, class Integer = typename Backend::Integer> static inline void OMPParallelWrap(const Integer *A, const Integer *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+  INTGEMM_INSTRUMENT_CALL
+#pragma omp parallel
+  {
+    INTGEMM_INSTRUMENT_MULTIPLY("Multiply", Backend::kName, A_rows, width, B_cols)
+    Backend::template Multiply<Callback>(A, B, A_rows, width, B_cols, callback);
+  }
+}
+// Multiply with kRows rows of A register blocked, for the autotuner.
+template <class Callback, class Backend, Index kRows, class Integer = typename Backend::Integer> static inline void OMPParallelWrapRows(const Integer *A, const Integer *B, Index A_rows, Index width, Index B_cols, Callback callback) {
 #pragma omp parallel
-  Backend::template Multiply<Callback>(A, B, A_rows, width, B_cols, callback);
+  Backend::template MultiplyRows<kRows, Callback>(A, B, A_rows, width, B_cols, callback);
+}
+template <class Callback, class Backend, class Integer = typename Backend::Integer> static inline void OMPParallelWrapStrided(const Integer *A, Index lda, const Integer *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+  INTGEMM_INSTRUMENT_CALL
+#pragma omp parallel
+  {
+    INTGEMM_INSTRUMENT_MULTIPLY("Multiply", Backend::kName, A_rows, width, B_cols)
+    Backend::template Multiply<Callback>(A, lda, B, A_rows, width, B_cols, callback);
+  }
+}
+/* A batch of independent multiplies of the same shape in one parallel region.
+ * Task t runs part t % parts of multiply t / parts, where parts comes from
+ * ChooseBatchPartition.
+ */
+template <class Callback, class Backend, class Integer> static inline void RunBatchedTask(const Integer *const *A, const Integer *const *B, Index A_rows, Index width, Index B_cols, const Callback *callbacks, const Partition &partition, Index task) {
+  const Index item = task / partition.Tasks();
+  Index row_begin, row_end, col_begin, col_end;
+  partition.Task(task % partition.Tasks(), row_begin, row_end, col_begin, col_end);
+  Backend::template Multiply<Callback>(A[item], B[item], A_rows, width, B_cols, callbacks[item], row_begin, row_end, col_begin, col_end);
+}
+/* One task of a multiply of A by several Bs.  The partition is chosen for the
+ * widest B and every B's columns are split in the same proportion, so Bs of
+ * equal width give a task the same columns of each.  Each block of A's rows
+ * is multiplied by every B in turn while it is still in cache, and B[i]'s
+ * tile is done before B[i + 1]'s.
+ */
+template <class Callback, class Backend, class Integer> static inline void RunMultiTask(const Integer *A, const Integer *const *B, const Index *B_cols, Index A_rows, Index width, const Callback *callbacks, Index count, const Partition &partition, Index task) {
+  Index row_begin, row_end, col_begin, col_end;
+  partition.Task(task, row_begin, row_end, col_begin, col_end);
+  for (Index block_begin = row_begin; block_begin < row_end; block_begin += kMultiplyBlockRows) {
+    const Index block_end = std::min(row_end, block_begin + kMultiplyBlockRows);
+    for (Index i = 0; i < count; ++i) {
+      // Same rows as the task, so only the columns are used.
+      Index rows_begin, rows_end, cols_begin, cols_end;
+      const Partition part{A_rows, B_cols[i], partition.row_parts, partition.col_parts};
+      part.Task(task, rows_begin, rows_end, cols_begin, cols_end);
+      if (cols_begin == cols_end) continue;
+      Backend::template Multiply<Callback>(A, B[i], A_rows, width, B_cols[i], callbacks[i], block_begin, block_end, cols_begin, cols_end);
+    }
+  }
+}
+static inline Index MaxCols(const Index *B_cols, Index count) {
+  Index widest = 0;
+  for (Index i = 0; i < count; ++i) widest = std::max(widest, B_cols[i]);
+  return widest;
+}
+template <class Callback, class Backend, class Integer = typename Backend::Integer> static inline void OMPParallelWrapMulti(const Integer *A, const Integer *const *B, const Index *B_cols, Index A_rows, Index width, const Callback *callbacks, Index count) {
+#pragma omp parallel
+  {
+    const Partition partition = ChoosePartition(A_rows, MaxCols(B_cols, count), OMPTasks());
+    INTGEMM_OMP_FOR_TASKS(partition.Tasks(),
+      RunMultiTask<Callback, Backend>(A, B, B_cols, A_rows, width, callbacks, count, partition, task);
+    )
+  }
+}
+template <class Callback, class Backend, class Integer = typename Backend::Integer> static inline void OMPParallelWrapBatched(const Integer *const *A, const Integer *const *B, Index A_rows, Index width, Index B_cols, const Callback *callbacks, Index batch) {
+#pragma omp parallel
+  {
+    const Partition partition = ChooseBatchPartition(batch, A_rows, B_cols, OMPTasks());
+    INTGEMM_OMP_FOR_TASKS(batch * partition.Tasks(),
+      RunBatchedTask<Callback, Backend>(A, B, A_rows, width, B_cols, callbacks, partition, task);
+    )
+  }
 }
 template <class Callback, class Backend> static inline void OMPParallelWrap8Shift(const uint8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+  INTGEMM_INSTRUMENT_CALL
+#pragma omp parallel
+  {
+    INTGEMM_INSTRUMENT_MULTIPLY("Multiply8Shift", Backend::kName, A_rows, width, B_cols)
+    Backend::template Multiply8Shift<Callback>(A, B, A_rows, width, B_cols, callback);
+  }
+}
+template <class Callback, class Backend> static inline void OMPParallelWrapFloatA(const float *A, float quant_mult, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
 #pragma omp parallel
-  Backend::template Multiply8Shift<Callback>(A, B, A_rows, width, B_cols, callback);
+  Backend::template MultiplyFloatA<Callback>(A, quant_mult, B, A_rows, width, B_cols, callback);
+}
+template <class Callback, class Backend> static inline void OMPParallelWrapNT(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_rows, Callback callback) {
+#pragma omp parallel
+  Backend::template MultiplyNT<Callback>(A, B, A_rows, width, B_rows, callback);
+}
+template <class Callback, class Backend> static inline void OMPParallelWrapMixed(const int16_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+#pragma omp parallel
+  Backend::template MultiplyMixed<Callback>(A, B, A_rows, width, B_cols, callback);
+}
+template <class Callback, class Backend> static inline void OMPParallelWrap4(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+#pragma omp parallel
+  Backend::template Multiply4<Callback>(A, B, A_rows, width, B_cols, callback);
+}
+template <class Callback, class Backend> static inline void OMPParallelWrapSparse(const int8_t *A, const SparseB &B, Index A_rows, Callback callback) {
+#pragma omp parallel
+  Backend::template MultiplySparse<Callback>(A, B, A_rows, callback);
+}
+template <class Callback, class Backend> static inline void OMPParallelWrapColumns(const int8_t *A, const int8_t *B, Index A_rows, Index width, const Index *cols_begin, const Index *cols_end, Callback callback) {
+#pragma omp parallel
+  Backend::template MultiplyColumns<Callback>(A, B, A_rows, width, cols_begin, cols_end, callback);
+}
+template <class Callback, class Backend> static inline void OMPParallelWrap8ShiftFloatA(const float *A, float quant_mult, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+#pragma omp parallel
+  Backend::template Multiply8ShiftFloatA<Callback>(A, quant_mult, B, A_rows, width, B_cols, callback);
+}
+
+/* Same as the above but threads come from an Executor, which is handed the
+ * tasks from ChoosePartition to share out.  ExecutorWrapRanges calls
+ * f(row_begin, row_end, col_begin, col_end) on each task of partition, like
+ * OMPWrapRanges, and the wrappers run a backend's tile on each range.
+ */
+template <class RangeFunction> static inline void ExecutorWrapRanges(const Partition &partition, Executor &executor, const RangeFunction &f) {
+  executor.ParallelFor(partition.Tasks(), [&](Index begin, Index end) {
+    for (Index task = begin; task < end; ++task) {
+      Index row_begin, row_end, col_begin, col_end;
+      partition.Task(task, row_begin, row_end, col_begin, col_end);
+      f(row_begin, row_end, col_begin, col_end);
+    }
+  });
+}
+template <class Callback, class Backend, class Integer = typename Backend::Integer> static inline void ExecutorWrap(const Integer *A, const Integer *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) {
+  INTGEMM_INSTRUMENT_CALL
+  ExecutorWrapRanges(ChoosePartition(A_rows, B_cols, ScheduleTasks(executor.Threads())), executor, [&](Index row_begin, Index row_end, Index col_begin, Index col_end) {
+    INTGEMM_INSTRUMENT_MULTIPLY("Multiply", Backend::kName, A_rows, width, B_cols)
+    Backend::template Multiply<Callback>(A, B, A_rows, width, B_cols, callback, row_begin, row_end, col_begin, col_end);
+  });
+}
+template <class Callback, class Backend, class Integer = typename Backend::Integer> static inline void ExecutorWrapStrided(const Integer *A, Index lda, const Integer *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) {
+  INTGEMM_INSTRUMENT_CALL
+  ExecutorWrapRanges(ChoosePartition(A_rows, B_cols, ScheduleTasks(executor.Threads())), executor, [&](Index row_begin, Index row_end, Index col_begin, Index col_end) {
+    INTGEMM_INSTRUMENT_MULTIPLY("Multiply", Backend::kName, A_rows, width, B_cols)
+    Backend::template Multiply<Callback>(A, lda, B, A_rows, width, B_cols, callback, row_begin, row_end, col_begin, col_end);
+  });
+}
+template <class Callback, class Backend, class Integer = typename Backend::Integer> static inline void ExecutorWrapBatched(const Integer *const *A, const Integer *const *B, Index A_rows, Index width, Index B_cols, const Callback *callbacks, Index batch, Executor &executor) {
+  const Partition partition = ChooseBatchPartition(batch, A_rows, B_cols, ScheduleTasks(executor.Threads()));
+  executor.ParallelFor(batch * partition.Tasks(), [&](Index begin, Index end) {
+    for (Index task = begin; task < end; ++task) {
+      RunBatchedTask<Callback, Backend>(A, B, A_rows, width, B_cols, callbacks, partition, task);
+    }
+  });
+}
+template <class Callback, class Backend, class Integer = typename Backend::Integer> static inline void ExecutorWrapMulti(const Integer *A, const Integer *const *B, const Index *B_cols, Index A_rows, Index width, const Callback *callbacks, Index count, Executor &executor) {
+  const Partition partition = ChoosePartition(A_rows, MaxCols(B_cols, count), ScheduleTasks(executor.Threads()));
+  executor.ParallelFor(partition.Tasks(), [&](Index begin, Index end) {
+    for (Index task = begin; task < end; ++task) {
+      RunMultiTask<Callback, Backend>(A, B, B_cols, A_rows, width, callbacks, count, partition, task);
+    }
+  });
+}
+template <class Callback, class Backend> static inline void ExecutorWrap8Shift(const uint8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) {
+  ExecutorWrapRanges(ChoosePartition(A_rows, B_cols, ScheduleTasks(executor.Threads())), executor, [&](Index row_begin, Index row_end, Index col_begin, Index col_end) {
+    Backend::template Multiply8Shift<Callback>(A, B, A_rows, width, B_cols, callback, row_begin, row_end, col_begin, col_end);
+  });
+}
+template <class Callback, class Backend> static inline void ExecutorWrapFloatA(const float *A, float quant_mult, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) {
+  ExecutorWrapRanges(ChoosePartition(A_rows, B_cols, ScheduleTasks(executor.Threads())), executor, [&](Index row_begin, Index row_end, Index col_begin, Index col_end) {
+    Backend::template MultiplyFloatA<Callback>(A, quant_mult, B, A_rows, width, B_cols, callback, row_begin, row_end, col_begin, col_end);
+  });
+}
+template <class Callback, class Backend> static inline void ExecutorWrapMixed(const int16_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) {
+  ExecutorWrapRanges(ChoosePartition(A_rows, B_cols, ScheduleTasks(executor.Threads())), executor, [&](Index row_begin, Index row_end, Index col_begin, Index col_end) {
+    Backend::template MultiplyMixed<Callback>(A, B, A_rows, width, B_cols, callback, row_begin, row_end, col_begin, col_end);
+  });
+}
+template <class Callback, class Backend> static inline void ExecutorWrapNT(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_rows, Callback callback, Executor &executor) {
+  ExecutorWrapRanges(ChoosePartition(A_rows, (B_rows + 7) / 8 * 8, ScheduleTasks(executor.Threads())), executor, [&](Index row_begin, Index row_end, Index col_begin, Index col_end) {
+    Backend::template MultiplyNT<Callback>(A, B, A_rows, width, B_rows, callback, row_begin, row_end, col_begin, col_end);
+  });
+}
+template <class Callback, class Backend> static inline void ExecutorWrap4(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) {
+  ExecutorWrapRanges(ChoosePartition(A_rows, B_cols, ScheduleTasks(executor.Threads())), executor, [&](Index row_begin, Index row_end, Index col_begin, Index col_end) {
+    Backend::template Multiply4<Callback>(A, B, A_rows, width, B_cols, callback, row_begin, row_end, col_begin, col_end);
+  });
+}
+template <class Callback, class Backend> static inline void ExecutorWrapSparse(const int8_t *A, const SparseB &B, Index A_rows, Callback callback, Executor &executor) {
+  ExecutorWrapRanges(ChoosePartition(A_rows, B.cols, ScheduleTasks(executor.Threads())), executor, [&](Index row_begin, Index row_end, Index col_begin, Index col_end) {
+    Backend::template MultiplySparse<Callback>(A, B, A_rows, callback, row_begin, row_end, col_begin, col_end);
+  });
+}
+template <class Callback, class Backend> static inline void ExecutorWrapColumns(const int8_t *A, const int8_t *B, Index A_rows, Index width, const Index *cols_begin, const Index *cols_end, Callback callback, Executor &executor) {
+  ExecutorWrapRanges(ChoosePartition(A_rows, static_cast<Index>(cols_end - cols_begin), ScheduleTasks(executor.Threads())), executor, [&](Index row_begin, Index row_end, Index col_begin, Index col_end) {
+    Backend::template MultiplyColumns<Callback>(A, B, A_rows, width, cols_begin, cols_end, callback, row_begin, row_end, col_begin, col_end);
+  });
+}
+template <class Callback, class Backend> static inline void ExecutorWrap8ShiftFloatA(const float *A, float quant_mult, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) {
+  ExecutorWrapRanges(ChoosePartition(A_rows, B_cols, ScheduleTasks(executor.Threads())), executor, [&](Index row_begin, Index row_end, Index col_begin, Index col_end) {
+    Backend::template Multiply8ShiftFloatA<Callback>(A, quant_mult, B, A_rows, width, B_cols, callback, row_begin, row_end, col_begin, col_end);
+  });
+}
+
+/* MultiplySplitK: when the output is too small to keep the threads busy,
+ * ChooseSplitK splits width as well.  Each slice is multiplied into its own
+ * int32 copy of C, then ReducePartials adds the copies and runs the callback
+ * on the sums.  The copies are in the calling thread's SplitKBuffer, reused
+ * across calls.  With one slice this is just Multiply.
+ */
+static inline int32_t *SplitKBuffer(std::size_t size) {
+  static thread_local AlignedVector<int32_t> buffer;
+  if (buffer.size() < size) buffer = AlignedVector<int32_t>(size);
+  return buffer.begin();
+}
+template <class Backend> static inline void RunSplitKTask(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, int32_t *partials, const SplitKPartition &split, Index task) {
+  Index k_begin, k_end, row_begin, row_end, col_begin, col_end;
+  split.Task(task, k_begin, k_end, row_begin, row_end, col_begin, col_end);
+  int32_t *partial = partials + static_cast<std::size_t>(task / split.partition.Tasks()) * A_rows * B_cols;
+  Backend::template MultiplySlice<callbacks::Write<int32_t> >(A, B, A_rows, width, B_cols, callbacks::Write<int32_t>(partial), k_begin, k_end, row_begin, row_end, col_begin, col_end);
+}
+template <class Callback, class Backend> static inline void OMPParallelWrapSplitK(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+  int32_t *partials = nullptr;
+#pragma omp parallel
+  {
+    const SplitKPartition split = ChooseSplitK(A_rows, width, B_cols, kMultiplyPanelBytes, OMPThreads());
+    if (split.k_parts == 1) {
+      Backend::template Multiply<Callback>(A, B, A_rows, width, B_cols, callback);
+    } else {
+#pragma omp single
+      partials = SplitKBuffer(static_cast<std::size_t>(split.k_parts) * A_rows * B_cols);
+      INTGEMM_OMP_FOR
+      for (Index task = 0; task < split.Tasks(); ++task) {
+        RunSplitKTask<Backend>(A, B, A_rows, width, B_cols, partials, split, task);
+      }
+      OMPWrapRanges(ChoosePartition(A_rows, B_cols, OMPTasks()), [&](Index row_begin, Index row_end, Index col_begin, Index col_end) {
+        Backend::template ReducePartials<Callback>(partials, split.k_parts, A_rows, B_cols, callback, row_begin, row_end, col_begin, col_end);
+      });
+    }
+  }
+}
+template <class Callback, class Backend> static inline void ExecutorWrapSplitK(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Executor &executor) {
+  const SplitKPartition split = ChooseSplitK(A_rows, width, B_cols, kMultiplyPanelBytes, executor.Threads());
+  if (split.k_parts == 1) {
+    ExecutorWrap<Callback, Backend, int8_t>(A, B, A_rows, width, B_cols, callback, executor);
+    return;
+  }
+  int32_t *partials = SplitKBuffer(static_cast<std::size_t>(split.k_parts) * A_rows * B_cols);
+  executor.ParallelFor(split.Tasks(), [&](Index begin, Index end) {
+    for (Index task = begin; task < end; ++task) {
+      RunSplitKTask<Backend>(A, B, A_rows, width, B_cols, partials, split, task);
+    }
+  });
+  ExecutorWrapRanges(ChoosePartition(A_rows, B_cols, ScheduleTasks(executor.Threads())), executor, [&](Index row_begin, Index row_end, Index col_begin, Index col_end) {
+    Backend::template ReducePartials<Callback>(partials, split.k_parts, A_rows, B_cols, callback, row_begin, row_end, col_begin, col_end);
+  });
+}
+
+/* MultiplyColumns for backends whose prepared B can't be gathered a panel at
+ * a time, such as AMX tiles: select the columns into a buffer then multiply.
+ * The buffer is the calling thread's SelectedColumnsBuffer, reused across
+ * calls; Multiply itself doesn't touch it.
+ */
+static inline int8_t *SelectedColumnsBuffer(std::size_t size) {
+  static thread_local AlignedVector<int8_t> buffer;
+  if (buffer.size() < size) buffer = AlignedVector<int8_t>(size);
+  return buffer.begin();
+}
+template <class Callback, class Backend> static inline void OMPParallelWrapColumnsCopy(const int8_t *A, const int8_t *B, Index A_rows, Index width, const Index *cols_begin, const Index *cols_end, Callback callback) {
+  const Index B_cols = static_cast<Index>(cols_end - cols_begin);
+  int8_t *selected = SelectedColumnsBuffer(static_cast<std::size_t>(width) * B_cols);
+  Backend::SelectColumnsB(B, selected, width, cols_begin, cols_end);
+  OMPParallelWrap<Callback, Backend>(A, selected, A_rows, width, B_cols, callback);
+}
+template <class Callback, class Backend> static inline void ExecutorWrapColumnsCopy(const int8_t *A, const int8_t *B, Index A_rows, Index width, const Index *cols_begin, const Index *cols_end, Callback callback, Executor &executor) {
+  const Index B_cols = static_cast<Index>(cols_end - cols_begin);
+  int8_t *selected = SelectedColumnsBuffer(static_cast<std::size_t>(width) * B_cols);
+  Backend::SelectColumnsB(B, selected, width, cols_begin, cols_end);
+  ExecutorWrap<Callback, Backend>(A, selected, A_rows, width, B_cols, callback, executor);
 }
 
 } // namespace intgemm
@@ -0,0 +1,429 @@
+#pragma once
+
+#include "intgemm/intgemm_config.h"
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+#include "interleave.h"
+#include "kernels.h"
+#include "multiply.h"
+#include "types.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+namespace intgemm {
+namespace NEON {
+
+/* AArch64 Advanced SIMD.  B is prepared in the same layout as SSSE3 (8-bit)
+ * and SSE2 (16-bit): in each 8-column strip, every block of 16 rows (8 rows
+ * for 16-bit) is 8 registers, one per column, holding that column's rows in
+ * order.  So B prepared by the 128-bit x86 backends loads unchanged.
+ *
+ * Register is int32x4_t so the shared blocked driver and callbacks apply;
+ * the kernels reinterpret it to the element type they need.
+ */
+
+INTGEMM_SELECT_COL_B(INTGEMM_NEON, Register)
+
+// a . b in groups of 4 bytes, added to acc.  Without sdot: widen to 16-bit
+// products (at most 128 * 127 in magnitude) then add adjacent pairs.
+INTGEMM_NEON static inline int32x4_t Dot8(int32x4_t acc, int8x16_t a, int8x16_t b) {
+  acc = vpadalq_s16(acc, vmull_s8(vget_low_s8(a), vget_low_s8(b)));
+  return vpadalq_s16(acc, vmull_high_s8(a, b));
+}
+
+class QuantizeTile8 {
+  public:
+    INTGEMM_NEON static inline Register Consecutive(FRegister mult_reg, const float *input) {
+      return Tile(mult_reg, input, input + 4, input + 8, input + 12);
+    }
+
+    INTGEMM_NEON static inline Register ConsecutiveU(FRegister mult_reg, const float *input) {
+      const uint8x16_t pos127 = vdupq_n_u8(127);
+      return vreinterpretq_s32_u8(vaddq_u8(vreinterpretq_u8_s8(Pack(mult_reg, input, input + 4, input + 8, input + 12)), pos127));
+    }
+
+    INTGEMM_NEON static inline Register ConsecutiveWithWrapping(FRegister mult_reg, const float *input, Index cols_left, Index cols, Index row_step) {
+      const float* inputs[4];
+      for (Index i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+        while (cols_left < sizeof(Register) / sizeof(float)) {
+          input += cols * (row_step - 1);
+          cols_left += cols;
+        }
+        inputs[i] = input;
+        input += sizeof(Register) / sizeof(float);
+        cols_left -= sizeof(Register) / sizeof(float);
+      }
+      return Tile(mult_reg, inputs[0], inputs[1], inputs[2], inputs[3]);
+    }
+
+    // Two rows of 8 columns each.
+    INTGEMM_NEON static inline int8x16_t ForReshape(FRegister mult_reg, const float *input, Index cols) {
+      return Pack(mult_reg, input, input + 4, input + cols, input + cols + 4);
+    }
+
+    INTGEMM_NEON static inline Register Tile(FRegister mult_reg, const float *input0, const float *input1, const float *input2, const float *input3) {
+      return vreinterpretq_s32_s8(Pack(mult_reg, input0, input1, input2, input3));
+    }
+
+  private:
+    INTGEMM_NEON static inline int8x16_t Pack(FRegister mult_reg, const float *input0, const float *input1, const float *input2, const float *input3) {
+      int16x8_t packed0 = vcombine_s16(
+          vqmovn_s32(kernels::quantize(vld1q_f32(input0), mult_reg)),
+          vqmovn_s32(kernels::quantize(vld1q_f32(input1), mult_reg)));
+      int16x8_t packed1 = vcombine_s16(
+          vqmovn_s32(kernels::quantize(vld1q_f32(input2), mult_reg)),
+          vqmovn_s32(kernels::quantize(vld1q_f32(input3), mult_reg)));
+      // Ban -128.
+      return vmaxq_s8(vcombine_s8(vqmovn_s16(packed0), vqmovn_s16(packed1)), vdupq_n_s8(-127));
+    }
+};
+
+class QuantizeTile16 {
+  public:
+    INTGEMM_NEON static inline Register Consecutive(FRegister mult_reg, const float *input) {
+      return vreinterpretq_s32_s16(Tile(mult_reg, input, input + 4));
+    }
+
+    INTGEMM_NEON static inline Register ConsecutiveWithWrapping(FRegister mult_reg, const float *input, Index cols_left, Index cols, Index row_step) {
+      return vreinterpretq_s32_s16(Tile(mult_reg,
+        input,
+        input + 4 + (cols_left <= 4 ? cols * (row_step - 1) : 0)));
+    }
+
+    INTGEMM_NEON static inline int16x8_t Tile(FRegister mult_reg, const float *input0, const float *input1) {
+      return vcombine_s16(
+          vqmovn_s32(kernels::quantize(vld1q_f32(input0), mult_reg)),
+          vqmovn_s32(kernels::quantize(vld1q_f32(input1), mult_reg)));
+    }
+};
+
+/* Multiply kRows rows of A by an 8-column strip of B with one int32x4_t of
+ * partial sums per row and column, reduced by Pack0123 at the end.
+ *
+ * Multiply8Shift has unsigned A.  a ^ 0x80 read as signed is a - 128, so it
+ * computes (a - 128) . b + 128 * sum(b) with the same signed dot product.
+ * The column sums are taken once per call and shared by the kRows rows.
+ */
+#define INTGEMM_NEON_MULTIPLY8(target, Dot) \
+template <Index kRows> target static inline void MultiplyStrip(const Register *A, Index A_stride, const Register *B, Index count, INTGEMM_MULTIPLY_TOTAL(Register) *totals) { \
+  int32x4_t sums[kRows][8]; \
+  for (Index r = 0; r < kRows; ++r) { \
+    for (Index c = 0; c < 8; ++c) { \
+      sums[r][c] = vdupq_n_s32(0); \
+    } \
+  } \
+  for (Index k = 0; k < count; ++k, B += 8) { \
+    for (Index r = 0; r < kRows; ++r) { \
+      int8x16_t a = vreinterpretq_s8_s32(A[r * A_stride + k]); \
+      for (Index c = 0; c < 8; ++c) { \
+        sums[r][c] = Dot(sums[r][c], a, vreinterpretq_s8_s32(B[c])); \
+      } \
+    } \
+  } \
+  for (Index r = 0; r < kRows; ++r) { \
+    Register pack0123 = Pack0123(sums[r][0], sums[r][1], sums[r][2], sums[r][3]); \
+    Register pack4567 = Pack0123(sums[r][4], sums[r][5], sums[r][6], sums[r][7]); \
+    totals[r] = PermuteSummer(pack0123, pack4567); \
+  } \
+} \
+template <Index kRows> target static inline void Multiply8ShiftStrip(const Register *A, Index A_stride, const Register *B, Index count, INTGEMM_MULTIPLY_TOTAL(Register) *totals) { \
+  const int8x16_t ones = vdupq_n_s8(1); \
+  const int8x16_t flip = vdupq_n_s8(-128); \
+  int32x4_t column_sums[8]; \
+  for (Index c = 0; c < 8; ++c) { \
+    column_sums[c] = vdupq_n_s32(0); \
+  } \
+  for (Index k = 0; k < count; ++k) { \
+    for (Index c = 0; c < 8; ++c) { \
+      column_sums[c] = Dot(column_sums[c], ones, vreinterpretq_s8_s32(B[k * 8 + c])); \
+    } \
+  } \
+  int32x4_t sums[kRows][8]; \
+  for (Index r = 0; r < kRows; ++r) { \
+    for (Index c = 0; c < 8; ++c) { \
+      sums[r][c] = vshlq_n_s32(column_sums[c], 7); \
+    } \
+  } \
+  for (Index k = 0; k < count; ++k, B += 8) { \
+    for (Index r = 0; r < kRows; ++r) { \
+      int8x16_t a = veorq_s8(vreinterpretq_s8_s32(A[r * A_stride + k]), flip); \
+      for (Index c = 0; c < 8; ++c) { \
+        sums[r][c] = Dot(sums[r][c], a, vreinterpretq_s8_s32(B[c])); \
+      } \
+    } \
+  } \
+  for (Index r = 0; r < kRows; ++r) { \
+    Register pack0123 = Pack0123(sums[r][0], sums[r][1], sums[r][2], sums[r][3]); \
+    Register pack4567 = Pack0123(sums[r][4], sums[r][5], sums[r][6], sums[r][7]); \
+    totals[r] = PermuteSummer(pack0123, pack4567); \
+  } \
+} \
+INTGEMM_MULTIPLY_BLOCKED(int8_t, int8_t, Register, target, CPUType::NEON, MultiplyRows, MultiplyStrip) \
+template <typename Callback> target static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) { \
+  MultiplyRows<kMultiplyRows, Callback>(A, B, A_rows, width, B_cols, callback); \
+} \
+template <typename Callback> target static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) { \
+  MultiplyRows<kMultiplyRows, Callback>(A, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end); \
+} \
+INTGEMM_MULTIPLY_STRIDED(int8_t, int8_t, target, MultiplyRows, kMultiplyRows) \
+INTGEMM_MULTIPLY_FIXED(int8_t, int8_t, target, MultiplyRows, kMultiplyRows) \
+INTGEMM_MULTIPLY_FLOAT_A(int8_t, int8_t, Register, target, CPUType::NEON, MultiplyFloatA, MultiplyRows, kMultiplyRows) \
+INTGEMM_MULTIPLY_NT(Register, target, CPUType::NEON, MultiplyNT, MultiplyRows, kMultiplyRows) \
+/* Arithmetic shifts sign extend the nibbles from Int4::PrepareB. */ \
+target static inline void UnpackInt4(const Register *packed, Register *out, Index count) { \
+  for (Index i = 0; i < count; ++i) { \
+    int8x16_t p = vreinterpretq_s8_s32(packed[i]); \
+    out[2 * i] = vreinterpretq_s32_s8(vshrq_n_s8(vshlq_n_s8(p, 4), 4)); \
+    out[2 * i + 1] = vreinterpretq_s32_s8(vshrq_n_s8(p, 4)); \
+  } \
+} \
+INTGEMM_MULTIPLY4(Register, target, CPUType::NEON, kMultiplyRows, MultiplyStrip, UnpackInt4) \
+INTGEMM_MULTIPLY_SPARSE(Register, target, CPUType::NEON, kMultiplyRows, MultiplyStrip) \
+INTGEMM_MULTIPLY_COLUMNS(Register, target, CPUType::NEON, kMultiplyRows, MultiplyStrip) \
+INTGEMM_MULTIPLY_SPLIT_K(Register, target, CPUType::NEON, MultiplyRows, kMultiplyRows) \
+INTGEMM_MULTIPLY_BLOCKED(uint8_t, int8_t, Register, target, CPUType::NEON, Multiply8ShiftRows, Multiply8ShiftStrip) \
+template <typename Callback> target static void Multiply8Shift(const uint8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) { \
+  Multiply8ShiftRows<kMultiplyRows, Callback>(A, B, A_rows, width, B_cols, callback); \
+} \
+template <typename Callback> target static void Multiply8Shift(const uint8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) { \
+  Multiply8ShiftRows<kMultiplyRows, Callback>(A, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end); \
+} \
+INTGEMM_MULTIPLY_FLOAT_A(uint8_t, int8_t, Register, target, CPUType::NEON, Multiply8ShiftFloatA, Multiply8ShiftRows, kMultiplyRows) \
+template <typename Callback> target static void PrepareBias(const int8_t *B, Index width, Index B_cols, Callback callback) { \
+  assert(width % sizeof(Register) == 0); \
+  assert(B_cols % 8 == 0); \
+  assert(reinterpret_cast<uintptr_t>(B) % sizeof(Register) == 0); \
+  const Index simd_width = width / sizeof(Register); \
+  auto callback_impl = callbacks::CallbackImpl<CPUType::NEON, Callback>(callback); \
+  const int8x16_t ones = vdupq_n_s8(1); \
+  INTGEMM_OMP_FOR \
+  for (Index B0_colidx = 0; B0_colidx < B_cols; B0_colidx += 8) { \
+    const Register *B_live = reinterpret_cast<const Register*>(B) + B0_colidx * simd_width; \
+    int32x4_t sums[8]; \
+    for (Index c = 0; c < 8; ++c) { \
+      sums[c] = vdupq_n_s32(0); \
+    } \
+    for (Index k = 0; k < simd_width; ++k, B_live += 8) { \
+      for (Index c = 0; c < 8; ++c) { \
+        sums[c] = Dot(sums[c], ones, vreinterpretq_s8_s32(B_live[c])); \
+      } \
+    } \
+    Register pack0123 = Pack0123(sums[0], sums[1], sums[2], sums[3]); \
+    Register pack4567 = Pack0123(sums[4], sums[5], sums[6], sums[7]); \
+    RunCallback(callback_impl, PermuteSummer(pack0123, pack4567), 0, B0_colidx, 1, B_cols); \
+  } \
+}
+
+// 8 bytes of B sign extended to 16 bits for INTGEMM_MULTIPLY_MIXED.
+INTGEMM_NEON static inline Register ExtendInt8(const int8x8_t *b) {
+  return vreinterpretq_s32_s16(vmovl_s8(*b));
+}
+
+struct Kernels16 {
+  typedef int16_t Integer;
+
+  // 2 rows of 8 sums, 8 registers of B and 2 of A fit in the 32 registers.
+  static const Index kMultiplyRows = 2;
+
+  INTGEMM_NEON static inline void PrepareA(const float *input, int16_t *output, float quant_mult, Index rows, Index cols) {
+    Quantize(input, output, quant_mult, rows * cols);
+  }
+
+  INTGEMM_NEON static void Quantize(const float *input, int16_t *output, float quant_mult, Index size) {
+    assert(size % 8 == 0);
+    assert(reinterpret_cast<uintptr_t>(input) % 16 == 0);
+    assert(reinterpret_cast<uintptr_t>(output) % 16 == 0);
+    FRegister q = vdupq_n_f32(quant_mult);
+    const float *end = input + size;
+    for (; input != end; input += 8, output += 8) {
+      *reinterpret_cast<Register*>(output) = QuantizeTile16::Consecutive(q, input);
+    }
+  }
+
+  static const Index kBTileRow = 8;
+  static const Index kBTileCol = 8;
+
+  // Columns [col_begin, col_end) a panel at a time, see kPrepareBPanelCols.
+  INTGEMM_NEON static void PrepareBRange(const float *input, int16_t *output_base, float quant_mult, Index rows, Index cols, Index col_begin, Index col_end) {
+    FRegister q = vdupq_n_f32(quant_mult);
+    for (Index panel = col_begin; panel < col_end; panel += kPrepareBPanelCols) {
+      const Index panel_end = std::min<Index>(panel + kPrepareBPanelCols, col_end);
+      for (Index r = 0; r < rows; r += 8) {
+        for (Index c = panel; c < panel_end; c += 8) {
+          int16_t *output = output_base + static_cast<std::size_t>(c) * rows + r * 8;
+          // Quantize 8 rows of the strip then transpose so each column's rows are consecutive.
+          int16_t tile[8][8];
+          for (Index i = 0; i < 8; ++i) {
+            const float *row = input + (r + i) * cols + c;
+            vst1q_s16(tile[i], QuantizeTile16::Tile(q, row, row + 4));
+          }
+          for (Index j = 0; j < 8; ++j) {
+            for (Index i = 0; i < 8; ++i) {
+              output[j * 8 + i] = tile[i][j];
+            }
+          }
+        }
+      }
+    }
+  }
+
+  INTGEMM_PREPARE_B_THREADS(INTGEMM_NEON, int16_t)
+
+  INTGEMM_PREPARE_B_QUANTIZED_TRANSPOSED(INTGEMM_NEON, int16_t)
+  INTGEMM_PREPARE_B_TRANSPOSED(INTGEMM_NEON, QuantizeTile16, int16_t)
+
+  INTGEMM_NEON static void SelectColumnsB(const int16_t *input, int16_t *output, Index rows, const Index *cols_begin, const Index *cols_end) {
+    SelectColumnsOfB((const Register*)input, (Register*)output, rows * 2, cols_begin, cols_end);
+  }
+
+  template <Index kRows> INTGEMM_NEON static inline void MultiplyStrip(const Register *A, Index A_stride, const Register *B, Index count, INTGEMM_MULTIPLY_TOTAL(Register) *totals) {
+    int32x4_t sums[kRows][8];
+    for (Index r = 0; r < kRows; ++r) {
+      for (Index c = 0; c < 8; ++c) {
+        sums[r][c] = vdupq_n_s32(0);
+      }
+    }
+    for (Index k = 0; k < count; ++k, B += 8) {
+      for (Index r = 0; r < kRows; ++r) {
+        int16x8_t a = vreinterpretq_s16_s32(A[r * A_stride + k]);
+        for (Index c = 0; c < 8; ++c) {
+          int16x8_t b = vreinterpretq_s16_s32(B[c]);
+          sums[r][c] = vmlal_s16(sums[r][c], vget_low_s16(a), vget_low_s16(b));
+          sums[r][c] = vmlal_high_s16(sums[r][c], a, b);
+        }
+      }
+    }
+    for (Index r = 0; r < kRows; ++r) {
+      Register pack0123 = Pack0123(sums[r][0], sums[r][1], sums[r][2], sums[r][3]);
+      Register pack4567 = Pack0123(sums[r][4], sums[r][5], sums[r][6], sums[r][7]);
+      totals[r] = PermuteSummer(pack0123, pack4567);
+    }
+  }
+
+  INTGEMM_MULTIPLY_BLOCKED(int16_t, int16_t, Register, INTGEMM_NEON, CPUType::NEON, MultiplyRows, MultiplyStrip)
+
+  template <typename Callback>
+  INTGEMM_NEON static void Multiply(const int16_t *A, const int16_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    MultiplyRows<kMultiplyRows, Callback>(A, B, A_rows, width, B_cols, callback);
+  }
+
+  template <typename Callback>
+  INTGEMM_NEON static void Multiply(const int16_t *A, const int16_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) {
+    MultiplyRows<kMultiplyRows, Callback>(A, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end);
+  }
+
+  INTGEMM_MULTIPLY_STRIDED(int16_t, int16_t, INTGEMM_NEON, MultiplyRows, kMultiplyRows)
+
+  INTGEMM_MULTIPLY_MIXED(Register, int8x8_t, INTGEMM_NEON, CPUType::NEON, kMultiplyRows, MultiplyStrip, ExtendInt8)
+
+  constexpr static const char *const kName = "16-bit NEON";
+
+  static const CPUType kUses = CPUType::NEON;
+};
+
+struct Kernels8 {
+  typedef int8_t Integer;
+
+  // 16 sums, 8 registers of B and 2 of A leave room for the temporaries.
+  static const Index kMultiplyRows = 2;
+
+  INTGEMM_NEON static inline void PrepareA(const float *input, int8_t *output, float quant_mult, Index rows, Index cols) {
+    Quantize(input, output, quant_mult, rows * cols);
+  }
+
+ private:
+  INTGEMM_QUANTIZE_THREAD(INTGEMM_NEON)
+  INTGEMM_QUANTIZE_ROWS_THREAD(INTGEMM_NEON)
+  INTGEMM_QUANTIZE_SCALED_THREAD(INTGEMM_NEON)
+ public:
+  INTGEMM_QUANTIZE(INTGEMM_NEON)
+  INTGEMM_QUANTIZE_ROWS(INTGEMM_NEON)
+  INTGEMM_QUANTIZE_SCALED(INTGEMM_NEON)
+  INTGEMM_QUANTIZE_SERIAL(INTGEMM_NEON)
+
+  INTGEMM_NEON static inline void PrepareA(const float *input, uint8_t *output, float quant_mult, Index rows, Index cols) {
+    QuantizeU(input, output, quant_mult, rows * cols);
+  }
+
+  INTGEMM_NEON static void QuantizeU(const float *input, uint8_t *output, float quant_mult, Index size) {
+    assert(size % 16 == 0);
+    assert(reinterpret_cast<uintptr_t>(input) % 16 == 0);
+    assert(reinterpret_cast<uintptr_t>(output) % 16 == 0);
+    FRegister q = vdupq_n_f32(quant_mult);
+    const float *end = input + size;
+    for (; input != end; input += 16, output += 16) {
+      *reinterpret_cast<Register*>(output) = QuantizeTile8::ConsecutiveU(q, input);
+    }
+  }
+
+  static const Index kBTileRow = 16;
+  static const Index kBTileCol = 8;
+
+  // Columns [col_begin, col_end) a panel at a time, see kPrepareBPanelCols.
+  INTGEMM_NEON static void PrepareBRange(const float *input, int8_t *output_base, float quant_mult, Index rows, Index cols, Index col_begin, Index col_end) {
+    FRegister q = vdupq_n_f32(quant_mult);
+    for (Index panel = col_begin; panel < col_end; panel += kPrepareBPanelCols) {
+      const Index panel_end = std::min<Index>(panel + kPrepareBPanelCols, col_end);
+      for (Index r = 0; r < rows; r += 16) {
+        for (Index c = panel; c < panel_end; c += 8) {
+          int8_t *output = output_base + static_cast<std::size_t>(c) * rows + r * 8;
+          // Quantize 16 rows of the strip then transpose so each column's rows are consecutive.
+          int8_t tile[16][8];
+          for (Index i = 0; i < 16; i += 2) {
+            vst1q_s8(tile[i], QuantizeTile8::ForReshape(q, input + (r + i) * cols + c, cols));
+          }
+          for (Index j = 0; j < 8; ++j) {
+            for (Index i = 0; i < 16; ++i) {
+              output[j * 16 + i] = tile[i][j];
+            }
+          }
+        }
+      }
+    }
+  }
+
+  INTGEMM_PREPARE_B_THREADS(INTGEMM_NEON, int8_t)
+
+  INTGEMM_PREPARE_B_QUANTIZED_TRANSPOSED(INTGEMM_NEON, int8_t)
+  INTGEMM_PREPARE_B_TRANSPOSED(INTGEMM_NEON, QuantizeTile8, int8_t)
+
+  INTGEMM_NEON static void SelectColumnsB(const int8_t *input, int8_t *output, Index rows, const Index *cols_begin, const Index *cols_end) {
+    SelectColumnsOfB((const Register*)input, (Register*)output, rows, cols_begin, cols_end);
+  }
+
+  INTGEMM_NEON_MULTIPLY8(INTGEMM_NEON, Dot8)
+
+  constexpr static const char *const kName = "8-bit NEON";
+
+  static const CPUType kUses = CPUType::NEON;
+};
+
+} // namespace NEON
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON_DOTPROD
+namespace NEONDOTPROD {
+
+// sdot does the 4-byte groups of Dot8 in one instruction.
+INTGEMM_NEON_DOTPROD static inline int32x4_t Dot8(int32x4_t acc, int8x16_t a, int8x16_t b) {
+  return vdotq_s32(acc, a, b);
+}
+
+/* Armv8.2 dot product.  Everything but the multiplies is NEON::Kernels8,
+ * including the layout of B.
+ */
+struct Kernels8 : public NEON::Kernels8 {
+  INTGEMM_NEON_MULTIPLY8(INTGEMM_NEON_DOTPROD, Dot8)
+
+  constexpr static const char *const kName = "8-bit NEON dotprod";
+
+  static const CPUType kUses = CPUType::NEONDOTPROD;
+};
+
+} // namespace NEONDOTPROD
+#endif
+
+} // namespace intgemm
+
+#endif
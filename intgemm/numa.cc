@@ -0,0 +1,199 @@
+#include "numa.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace intgemm {
+
+namespace {
+
+void AllocationFailure() {
+#if (defined(_MSC_VER) && !defined(__clang__)) ? (_HAS_EXCEPTIONS) : (__EXCEPTIONS)
+  throw std::bad_alloc();
+#else
+  std::abort();
+#endif
+}
+
+#if defined(__linux__)
+// Parse a sysfs list such as "0-3,8,10-11".  Empty if the file is missing.
+std::vector<int> ReadList(const std::string &file) {
+  std::vector<int> ret;
+  std::FILE *f = std::fopen(file.c_str(), "r");
+  if (!f) return ret;
+  int begin, end;
+  while (std::fscanf(f, "%d", &begin) == 1) {
+    end = begin;
+    int next = std::fgetc(f);
+    if (next == '-') {
+      if (std::fscanf(f, "%d", &end) != 1) break;
+      next = std::fgetc(f);
+    }
+    for (int i = begin; i <= end; ++i) ret.push_back(i);
+    if (next != ',') break;
+  }
+  std::fclose(f);
+  return ret;
+}
+
+// The single number in file, or -1 if it is missing.
+long ReadNumber(const std::string &file) {
+  long ret = -1;
+  std::FILE *f = std::fopen(file.c_str(), "r");
+  if (!f) return ret;
+  if (std::fscanf(f, "%ld", &ret) != 1) ret = -1;
+  std::fclose(f);
+  return ret;
+}
+
+// From linux/mempolicy.h, which not every libc installs.
+const int kMPolBind = 2;
+const int kMPolInterleave = 3;
+
+// Apply placement with mbind.  Failure, e.g. no NUMA support in the kernel,
+// leaves first touch.
+void Place(void *mem, std::size_t bytes, const MemoryPolicy &policy) {
+  std::vector<int> nodes;
+  if (policy.placement == Placement::Interleave) {
+    nodes = NumaNodes();
+  } else {
+    nodes.push_back(policy.node);
+  }
+  const std::size_t kBits = 8 * sizeof(unsigned long);
+  std::vector<unsigned long> mask(1);
+  for (int node : nodes) {
+    if (node < 0) continue;
+    if (static_cast<std::size_t>(node) / kBits >= mask.size()) mask.resize(node / kBits + 1);
+    mask[node / kBits] |= 1UL << (node % kBits);
+  }
+  const int mode = policy.placement == Placement::Interleave ? kMPolInterleave : kMPolBind;
+  syscall(SYS_mbind, mem, bytes, mode, mask.data(), mask.size() * kBits + 1, 0);
+}
+#endif
+
+} // namespace
+
+void *AllocatePages(std::size_t bytes, const MemoryPolicy &policy, std::size_t &mapped) {
+  if (!bytes) bytes = 1;
+#if defined(__linux__)
+  std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  if (policy.pages == Pages::Huge1GB) {
+    page = std::size_t(1) << 30;
+  } else if (policy.pages != Pages::Small) {
+    page = std::size_t(2) << 20;
+  }
+  mapped = (bytes + page - 1) / page * page;
+  void *mem = MAP_FAILED;
+#  if defined(MAP_HUGETLB)
+  if (policy.pages == Pages::Huge2MB || policy.pages == Pages::Huge1GB) {
+    // MAP_HUGE_SHIFT is 26 where the headers are too old to say.
+    const int log2_page = policy.pages == Pages::Huge1GB ? 30 : 21;
+    mem = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (log2_page << 26), -1, 0);
+  }
+#  endif
+  if (mem == MAP_FAILED) {
+    const std::size_t huge = std::size_t(2) << 20;
+    if (policy.pages == Pages::Huge1GB) mapped = (bytes + huge - 1) / huge * huge;
+    // Transparent huge pages only back whole aligned 2 MB ranges, so map a
+    // huge page extra, start at a boundary and return the head and tail.
+    const std::size_t slack = policy.pages == Pages::Small ? 0 : huge;
+    mem = mmap(nullptr, mapped + slack, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) AllocationFailure();
+    if (slack) {
+      char *const begin = static_cast<char*>(mem);
+      char *const aligned = begin + (huge - reinterpret_cast<std::uintptr_t>(begin) % huge) % huge;
+      if (aligned != begin) munmap(begin, aligned - begin);
+      if (aligned + mapped != begin + mapped + slack) munmap(aligned + mapped, begin + slack - aligned);
+      mem = aligned;
+    }
+#  if defined(MADV_HUGEPAGE)
+    if (policy.pages != Pages::Small) madvise(mem, mapped, MADV_HUGEPAGE);
+#  endif
+  }
+  if (policy.placement != Placement::FirstTouch) Place(mem, mapped, policy);
+  return mem;
+#else
+  (void)policy;
+  mapped = 0;
+  void *mem;
+#  ifdef _MSC_VER
+  mem = _aligned_malloc(bytes, 4096);
+  if (!mem) AllocationFailure();
+#  else
+  if (posix_memalign(&mem, 4096, bytes)) AllocationFailure();
+#  endif
+  return mem;
+#endif
+}
+
+void FreePages(void *mem, std::size_t mapped) {
+#if defined(__linux__)
+  munmap(mem, mapped);
+#else
+  (void)mem;
+  (void)mapped;
+#endif
+}
+
+std::vector<int> NumaNodes() {
+#if defined(__linux__)
+  std::vector<int> nodes = ReadList("/sys/devices/system/node/online");
+  if (!nodes.empty()) return nodes;
+#endif
+  return std::vector<int>(1, 0);
+}
+
+std::vector<int> NodeCPUs(int node) {
+#if defined(__linux__)
+  return ReadList("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+#else
+  (void)node;
+  return std::vector<int>();
+#endif
+}
+
+std::vector<int> CoreTypeCPUs(CoreType type) {
+  std::vector<int> ret;
+#if defined(__linux__)
+  // Intel hybrid parts have a PMU for each type of core.
+  ret = ReadList(type == CoreType::Performance ? "/sys/devices/cpu_core/cpus" : "/sys/devices/cpu_atom/cpus");
+  if (!ret.empty()) return ret;
+  // ARM big.LITTLE gives each CPU a relative capacity, highest for big cores.
+  const std::vector<int> online = ReadList("/sys/devices/system/cpu/online");
+  std::vector<long> capacity;
+  for (int cpu : online) {
+    capacity.push_back(ReadNumber("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cpu_capacity"));
+    if (capacity.back() < 0) return ret;
+  }
+  if (capacity.empty()) return ret;
+  const long highest = *std::max_element(capacity.begin(), capacity.end());
+  if (*std::min_element(capacity.begin(), capacity.end()) == highest) return ret;
+  for (std::size_t i = 0; i < online.size(); ++i) {
+    if ((capacity[i] == highest) == (type == CoreType::Performance)) ret.push_back(online[i]);
+  }
+#else
+  (void)type;
+#endif
+  return ret;
+}
+
+int CurrentNode() {
+#if defined(__linux__) && defined(SYS_getcpu)
+  unsigned cpu, node;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) return static_cast<int>(node);
+#endif
+  return NumaNodes().front();
+}
+
+} // namespace intgemm
@@ -0,0 +1,78 @@
+#pragma once
+/* NUMA topology and copies of a prepared B on every node.
+ *
+ * On a multi-socket machine a B allocated on one node is read across the
+ * interconnect by the threads on the others.  Replicated keeps a copy bound
+ * to each node; run a ThreadPool per node pinned to NodeCPUs and give each
+ * the copy from ForNode, or call Local from a thread to find its own.
+ *
+ * Hybrid CPUs, with P-cores and E-cores or big and LITTLE cores, are found
+ * the same way: CoreTypeCPUs lists the cores of a type, so a ThreadPool can
+ * keep to the fast ones.  With OpenMP, set OMP_PLACES to the same list.
+ *
+ * Outside Linux there is one node, 0, and no CPU list.
+ */
+
+#include "aligned.h"
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+namespace intgemm {
+
+// Online NUMA nodes in increasing order, at least one.
+std::vector<int> NumaNodes();
+
+// CPUs of node, for ThreadPool's cpus argument.  Empty when unknown.
+std::vector<int> NodeCPUs(int node);
+
+// Node of the CPU the calling thread is running on.
+int CurrentNode();
+
+enum class CoreType {
+  // P-cores or big cores.
+  Performance,
+  // E-cores or LITTLE cores.
+  Efficient
+};
+
+// Online CPUs of type, for ThreadPool's cpus argument.  Empty when the CPU
+// isn't hybrid, so every core is equally fast, or the kernel doesn't say.
+std::vector<int> CoreTypeCPUs(CoreType type);
+
+template <class T> class Replicated {
+  public:
+    // Copy size elements of from onto each of nodes with pages bound there.
+    Replicated(const T *from, std::size_t size, Pages pages = Pages::Transparent, const std::vector<int> &nodes = NumaNodes())
+      : nodes_(nodes) {
+      copies_.reserve(nodes_.size());
+      for (int node : nodes_) {
+        MemoryPolicy policy;
+        policy.pages = pages;
+        policy.placement = Placement::Node;
+        policy.node = node;
+        copies_.emplace_back(size, policy);
+        std::memcpy(copies_.back().begin(), from, size * sizeof(T));
+      }
+    }
+
+    // The copy on node, or the first for a node without one.
+    const T *ForNode(int node) const {
+      for (std::size_t i = 0; i < nodes_.size(); ++i) {
+        if (nodes_[i] == node) return copies_[i].begin();
+      }
+      return copies_.front().begin();
+    }
+
+    // The copy for the node the calling thread is running on.
+    const T *Local() const { return ForNode(CurrentNode()); }
+
+    const std::vector<int> &Nodes() const { return nodes_; }
+
+  private:
+    std::vector<int> nodes_;
+    std::vector<AlignedVector<T> > copies_;
+};
+
+} // namespace intgemm
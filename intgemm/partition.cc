@@ -0,0 +1,78 @@
+#include "partition.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+namespace intgemm {
+
+namespace {
+
+Schedule EnvironmentSchedule() {
+#if defined(_MSC_VER)
+  char env[16];
+  size_t len = 0;
+  if (getenv_s(&len, env, sizeof(env), "INTGEMM_SCHEDULE") || !len) return Schedule::Static;
+#else
+  const char *env = getenv("INTGEMM_SCHEDULE");
+  if (!env) return Schedule::Static;
+#endif
+  return std::strcmp(env, "dynamic") ? Schedule::Static : Schedule::Dynamic;
+}
+
+std::atomic<Schedule> &CurrentSchedule() {
+  static std::atomic<Schedule> schedule(EnvironmentSchedule());
+  return schedule;
+}
+
+} // namespace
+
+Schedule GetSchedule() {
+  return CurrentSchedule().load(std::memory_order_relaxed);
+}
+
+void SetSchedule(Schedule schedule) {
+  CurrentSchedule().store(schedule, std::memory_order_relaxed);
+}
+
+std::size_t ScheduleTasks(std::size_t threads) {
+  return GetSchedule() == Schedule::Dynamic ? threads * kDynamicTasksPerThread : threads;
+}
+
+Partition ChoosePartition(Index A_rows, Index B_cols, std::size_t threads) {
+  const Index row_units = (A_rows + kPartitionRows - 1) / kPartitionRows;
+  const Index strips = B_cols / 8;
+  Partition best = {A_rows, B_cols, 1, 1};
+  if (threads <= 1 || !row_units || !strips) return best;
+  uint64_t best_work = static_cast<uint64_t>(row_units) * strips;
+  const Index max_cols = threads < strips ? static_cast<Index>(threads) : strips;
+  for (Index col_parts = 1; col_parts <= max_cols; ++col_parts) {
+    Index row_parts = static_cast<Index>(threads / col_parts);
+    if (row_parts > row_units) row_parts = row_units;
+    // Work of the largest task, counted in row units times strips.
+    uint64_t work = static_cast<uint64_t>((row_units + row_parts - 1) / row_parts) * ((strips + col_parts - 1) / col_parts);
+    // Later iterations have more column parts so win ties.
+    if (work <= best_work) {
+      best_work = work;
+      best.row_parts = row_parts;
+      best.col_parts = col_parts;
+    }
+  }
+  return best;
+}
+
+Partition ChooseBatchPartition(Index batch, Index A_rows, Index B_cols, std::size_t threads) {
+  const std::size_t share = batch ? threads / batch : threads;
+  return ChoosePartition(A_rows, B_cols, share ? share : 1);
+}
+
+SplitKPartition ChooseSplitK(Index A_rows, Index width, Index B_cols, Index k_unit, std::size_t threads) {
+  const std::size_t tasks = ChoosePartition(A_rows, B_cols, threads).Tasks();
+  std::size_t k_parts = threads / tasks;
+  const Index units = width / k_unit;
+  if (k_parts > units) k_parts = units;
+  if (!k_parts) k_parts = 1;
+  return SplitKPartition{width, k_unit, static_cast<Index>(k_parts), ChoosePartition(A_rows, B_cols, threads / k_parts)};
+}
+
+} // namespace intgemm
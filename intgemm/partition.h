@@ -0,0 +1,125 @@
+#pragma once
+/* How a multiply is split into tasks for threads.
+ *
+ * B's columns come in strips of 8 and A's rows in units of kPartitionRows.
+ * When there are at least as many strips as threads, each task takes a range
+ * of strips and all of A, as before.  Narrow B (e.g. output projections or
+ * attention heads) leaves threads idle, so A's rows are split too.
+ *
+ * ChoosePartition is the decision the parallel drivers make; call it with
+ * your shapes and ScheduleTasks(threads) to see how they are scheduled.
+ *
+ * By default there is one task per thread and thread i always takes task i,
+ * so its part of B stays in its cache from one call to the next.  On hybrid
+ * CPUs (P-cores and E-cores) that makes every multiply as slow as the slowest
+ * core, which the rest wait for.  Schedule::Dynamic splits the multiply into
+ * kDynamicTasksPerThread tasks per thread instead and threads take the next
+ * task as they finish one, so faster cores do more of them.
+ */
+
+#include "types.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace intgemm {
+
+// Granularity of splitting A's rows.  A multiple of the kernels' register
+// blocking so splitting rows doesn't leave extra single-row tails.
+static const Index kPartitionRows = 8;
+
+struct Partition {
+  Index A_rows;
+  Index B_cols;
+  // A's rows are split into row_parts pieces and B's columns into col_parts.
+  Index row_parts;
+  Index col_parts;
+
+  Index Tasks() const { return row_parts * col_parts; }
+
+  // Rows [row_begin, row_end) of A and columns [col_begin, col_end) of B
+  // covered by task, which is in [0, Tasks()).  Column bounds are multiples
+  // of 8.
+  void Task(Index task, Index &row_begin, Index &row_end, Index &col_begin, Index &col_end) const {
+    const Index row_part = task / col_parts, col_part = task % col_parts;
+    const Index row_units = (A_rows + kPartitionRows - 1) / kPartitionRows;
+    const Index strips = B_cols / 8;
+    row_begin = Split(row_units, row_parts, row_part) * kPartitionRows;
+    row_end = Split(row_units, row_parts, row_part + 1) * kPartitionRows;
+    if (row_end > A_rows) row_end = A_rows;
+    if (row_begin > A_rows) row_begin = A_rows;
+    col_begin = Split(strips, col_parts, col_part) * 8;
+    col_end = Split(strips, col_parts, col_part + 1) * 8;
+  }
+
+  private:
+    static Index Split(Index units, Index parts, Index part) {
+      return static_cast<Index>(static_cast<uint64_t>(units) * part / parts);
+    }
+};
+
+// A multiply whose shared dimension is split as well, for MultiplySplitK.
+// width is cut into k_parts slices at multiples of k_unit, the last taking
+// any remainder, and the output of each slice is split by partition.  Task t
+// is part t % partition.Tasks() of slice t / partition.Tasks().
+struct SplitKPartition {
+  Index width;
+  Index k_unit;
+  Index k_parts;
+  Partition partition;
+
+  Index Tasks() const { return k_parts * partition.Tasks(); }
+
+  // Slice [k_begin, k_end) of the shared dimension and the tile of the
+  // output covered by task.
+  void Task(Index task, Index &k_begin, Index &k_end, Index &row_begin, Index &row_end, Index &col_begin, Index &col_end) const {
+    const Index k_part = task / partition.Tasks();
+    const Index units = width / k_unit;
+    k_begin = static_cast<Index>(static_cast<uint64_t>(units) * k_part / k_parts) * k_unit;
+    k_end = k_part + 1 == k_parts ? width : static_cast<Index>(static_cast<uint64_t>(units) * (k_part + 1) / k_parts) * k_unit;
+    partition.Task(task % partition.Tasks(), row_begin, row_end, col_begin, col_end);
+  }
+};
+
+// How the parallel drivers, OpenMP and ThreadPool, hand tasks to threads.
+enum class Schedule {
+  // One task per thread, each thread taking the same one every call.
+  Static,
+  // kDynamicTasksPerThread tasks per thread, taken as threads come free.
+  Dynamic
+};
+
+// Tasks per thread with Schedule::Dynamic.  More balance the load better but
+// read each row of A from more threads.
+static const std::size_t kDynamicTasksPerThread = 4;
+
+// The schedule in use.  Static unless the INTGEMM_SCHEDULE environment
+// variable is "dynamic" or SetSchedule says otherwise.
+Schedule GetSchedule();
+
+// Change the schedule.  Every thread of a multiply reads it, so don't change
+// it while one is running.
+void SetSchedule(Schedule schedule);
+
+// Tasks to split a multiply into for threads threads under the schedule in
+// use; the drivers pass this to ChoosePartition.
+std::size_t ScheduleTasks(std::size_t threads);
+
+// Choose how to split an A_rows x B_cols multiply among threads.  Minimizes
+// the largest task, preferring to split columns when that ties.  Never
+// returns more tasks than threads.
+Partition ChoosePartition(Index A_rows, Index B_cols, std::size_t threads);
+
+// How each multiply of a batch of batch equally shaped multiplies is split.
+// Each gets an equal share of the threads, at least one, so a batch at least
+// as large as the team runs each multiply whole as a single task.
+Partition ChooseBatchPartition(Index batch, Index A_rows, Index B_cols, std::size_t threads);
+
+// Split the shared dimension only as far as the output can't keep threads
+// busy: into as many slices as there are threads per task of
+// ChoosePartition(A_rows, B_cols, threads), at most width / k_unit.  Each
+// slice's output is then split among its share of the threads.  One slice
+// means the multiply is better left unsplit.
+SplitKPartition ChooseSplitK(Index A_rows, Index width, Index B_cols, Index k_unit, std::size_t threads);
+
+} // namespace intgemm
@@ -0,0 +1,51 @@
+#include "prefetch.h"
+
+#include <atomic>
+#include <cstdlib>
+
+namespace intgemm {
+namespace {
+
+// Distance no environment or SetPrefetchDistance asked for.
+const long kDefault = -1;
+
+long EnvironmentDistance() {
+#if defined(_MSC_VER)
+  char env[24];
+  size_t len = 0;
+  if (getenv_s(&len, env, sizeof(env), "INTGEMM_PREFETCH_DISTANCE") || !len) return kDefault;
+#else
+  const char *env = getenv("INTGEMM_PREFETCH_DISTANCE");
+  if (!env) return kDefault;
+#endif
+  char *end;
+  long bytes = strtol(env, &end, 10);
+  if (end == env || bytes < 0) return kDefault;
+  return bytes;
+}
+
+std::atomic<long> &Distance() {
+  static std::atomic<long> distance(EnvironmentDistance());
+  return distance;
+}
+
+} // namespace
+
+Index PrefetchDistance(Index register_bytes) {
+  const long distance = Distance().load(std::memory_order_relaxed);
+  if (distance != kDefault) return static_cast<Index>(distance);
+  // Measured streaming a 32 MB B with 4 rows of A: the 128-bit kernels are
+  // slow enough that hardware prefetch keeps up, wider ones gain from a few
+  // lines and lose from more than about a kilobyte.
+  return register_bytes <= 16 ? 0 : register_bytes * 8;
+}
+
+void SetPrefetchDistance(Index bytes) {
+  Distance().store(static_cast<long>(bytes), std::memory_order_relaxed);
+}
+
+void ResetPrefetchDistance() {
+  Distance().store(kDefault, std::memory_order_relaxed);
+}
+
+} // namespace intgemm
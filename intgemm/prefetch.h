@@ -0,0 +1,38 @@
+#pragma once
+/* Software prefetch in the Multiply kernels.
+ *
+ * Hardware prefetchers follow the stream down a strip of B but lose track
+ * where a thread starts a new task, and A is read as many short streams, one
+ * per row of the block.  So while a panel is multiplied the kernels prefetch
+ * the head of the next panel of B (the next strip after the last panel) and,
+ * before each group of rows, the head of the next group's rows of A.
+ *
+ * The distance is how many bytes of each are prefetched.  It defaults by
+ * register width, since wider kernels consume a stream faster; 128-bit
+ * kernels don't prefetch by default.  Set it with the
+ * INTGEMM_PREFETCH_DISTANCE environment variable or SetPrefetchDistance.  0
+ * turns prefetching off.
+ */
+
+#include "types.h"
+
+namespace intgemm {
+
+// Bytes prefetched ahead by kernels with register_bytes wide registers.
+Index PrefetchDistance(Index register_bytes);
+
+// Use bytes for every kernel, overriding the defaults and the environment.
+void SetPrefetchDistance(Index bytes);
+
+// Back to the defaults by register width.
+void ResetPrefetchDistance();
+
+// Prefetch the cache lines covering bytes from address.
+static inline void PrefetchBytes(const void *address, Index bytes) {
+  const char *from = reinterpret_cast<const char *>(address);
+  for (Index i = 0; i < bytes; i += 64) {
+    INTGEMM_PREFETCH(from + i);
+  }
+}
+
+} // namespace intgemm
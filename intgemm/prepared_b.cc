@@ -0,0 +1,228 @@
+#include "prepared_b.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace intgemm {
+
+namespace {
+
+const char kMagic[8] = {'i', 'n', 't', 'g', 'e', 'm', 'm', 'B'};
+const uint32_t kVersion = 1;
+
+static_assert(sizeof(PreparedBHeader) == 72, "PreparedBHeader has no padding");
+
+void PreparedBFailure(const std::string &message) {
+#if (defined(_MSC_VER) && !defined(__clang__)) ? (_HAS_EXCEPTIONS) : (__EXCEPTIONS)
+  throw PreparedBError(message);
+#else
+  std::cerr << message << std::endl;
+  abort();
+#endif
+}
+
+uint64_t RoundUp(uint64_t bytes) {
+  return (bytes + kPreparedBAlign - 1) / kPreparedBAlign * kPreparedBAlign;
+}
+
+void WriteRecord(std::ostream &out, const std::string &name, const void *B, Index element_bytes, const TileInfo &tile, Index rows, Index cols, float quant_mult, CPUType cpu) {
+  const Index group = PreparedBGroup(cpu, element_bytes);
+  if (!group) UnsupportedCPUError();
+  if (rows % group || cols % 8) PreparedBFailure("Prepared B " + name + " does not have whole strips");
+  std::streamoff position = out.tellp();
+  if (position != -1 && position % kPreparedBAlign) PreparedBFailure("Prepared B can only be written at a multiple of kPreparedBAlign");
+
+  PreparedBHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.data_bytes = static_cast<uint64_t>(rows) * cols * element_bytes;
+  header.version = kVersion;
+  header.header_bytes = static_cast<uint32_t>(RoundUp(sizeof(PreparedBHeader) + name.size()));
+  header.name_bytes = static_cast<uint32_t>(name.size());
+  header.cpu = static_cast<uint32_t>(cpu);
+  header.element_bytes = element_bytes;
+  header.group = group;
+  header.tile_a_rows = tile.a_rows;
+  header.tile_a_cols = tile.a_cols;
+  header.tile_b_rows = tile.b_rows;
+  header.tile_b_cols = tile.b_cols;
+  header.rows = rows;
+  header.cols = cols;
+  header.quant_mult = quant_mult;
+
+  const char padding[kPreparedBAlign] = {0};
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(name.data(), name.size());
+  out.write(padding, header.header_bytes - sizeof(header) - name.size());
+  out.write(static_cast<const char*>(B), header.data_bytes);
+  out.write(padding, RoundUp(header.data_bytes) - header.data_bytes);
+  if (!out) PreparedBFailure("Failed to write prepared B " + name);
+}
+
+} // namespace
+
+Index PreparedBGroup(CPUType cpu, Index element_bytes) {
+  // Register width in bytes of the kernels Int8 and Int16 dispatch to.
+  Index bytes = 0;
+  switch (cpu) {
+    case CPUType::AMX:
+      // AMX multiplies 4 bytes at a time but Int16 uses AVX512VNNI.
+      if (element_bytes == 1) return 4;
+      bytes = 64;
+      break;
+    case CPUType::AVX512VNNI:
+    case CPUType::AVX512BW:
+      bytes = 64;
+      break;
+    case CPUType::AVXVNNI:
+    case CPUType::AVX2:
+      bytes = 32;
+      break;
+    case CPUType::SIMD128:
+    case CPUType::NEONDOTPROD:
+    case CPUType::NEON:
+    case CPUType::SSSE3:
+      bytes = 16;
+      break;
+    case CPUType::SSE2:
+      // No 8-bit kernels.
+      if (element_bytes == 2) bytes = 16;
+      break;
+    case CPUType::UNSUPPORTED:
+      break;
+  }
+  return bytes / element_bytes;
+}
+
+void RelayoutPreparedB(const void *input, Index input_group, void *output, Index output_group, Index element_bytes, Index rows, Index cols) {
+  assert(rows % input_group == 0);
+  assert(rows % output_group == 0);
+  assert(cols % 8 == 0);
+  const Index chunk = std::min(input_group, output_group);
+  assert(std::max(input_group, output_group) % chunk == 0);
+  const std::size_t chunk_bytes = chunk * element_bytes;
+  const char *in = static_cast<const char*>(input);
+  char *out = static_cast<char*>(output);
+  for (Index strip = 0; strip < cols / 8; ++strip) {
+    const std::size_t strip_begin = static_cast<std::size_t>(strip) * 8 * rows;
+    for (Index k = 0; k < rows; k += chunk) {
+      const std::size_t in_k = strip_begin + (k / input_group) * input_group * 8 + k % input_group;
+      const std::size_t out_k = strip_begin + (k / output_group) * output_group * 8 + k % output_group;
+      for (Index c = 0; c < 8; ++c) {
+        std::memcpy(out + (out_k + c * output_group) * element_bytes, in + (in_k + c * input_group) * element_bytes, chunk_bytes);
+      }
+    }
+  }
+}
+
+void WritePreparedB(std::ostream &out, const std::string &name, const int8_t *B, Index rows, Index cols, float quant_mult, CPUType cpu) {
+  WriteRecord(out, name, B, 1, Int8::tile_info, rows, cols, quant_mult, cpu);
+}
+
+void WritePreparedB(std::ostream &out, const std::string &name, const int16_t *B, Index rows, Index cols, float quant_mult, CPUType cpu) {
+  WriteRecord(out, name, B, 2, Int16::tile_info, rows, cols, quant_mult, cpu);
+}
+
+PreparedBFile::Mapping::Mapping(const std::string &file) : mem_(nullptr), size_(0) {
+#if defined(_WIN32)
+  std::ifstream in(file.c_str(), std::ios::binary | std::ios::ate);
+  if (!in) PreparedBFailure("Could not open " + file);
+  size_ = static_cast<std::size_t>(in.tellg());
+  read_ = AlignedVector<char>(size_);
+  in.seekg(0);
+  if (!in.read(read_.begin(), size_)) PreparedBFailure("Could not read " + file);
+  mem_ = read_.begin();
+#else
+  int fd = open(file.c_str(), O_RDONLY);
+  if (fd == -1) PreparedBFailure("Could not open " + file);
+  struct stat info;
+  if (fstat(fd, &info)) {
+    close(fd);
+    PreparedBFailure("Could not stat " + file);
+  }
+  size_ = static_cast<std::size_t>(info.st_size);
+  if (size_) {
+    void *mem = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mem == MAP_FAILED) {
+      close(fd);
+      PreparedBFailure("Could not mmap " + file);
+    }
+    mem_ = static_cast<const char*>(mem);
+  }
+  close(fd);
+#endif
+}
+
+PreparedBFile::Mapping::~Mapping() {
+#if !defined(_WIN32)
+  if (mem_) munmap(const_cast<char*>(mem_), size_);
+#endif
+}
+
+PreparedBFile::PreparedBFile(const std::string &file) : mapping_(file) {
+  Parse(file);
+}
+
+const PreparedB *PreparedBFile::Find(const std::string &name) const {
+  for (const PreparedB &matrix : matrices_) {
+    if (matrix.name == name) return &matrix;
+  }
+  return nullptr;
+}
+
+void PreparedBFile::Parse(const std::string &file) {
+  const char *const mem = mapping_.begin();
+  const uint64_t size = mapping_.size();
+  uint64_t offset = 0;
+  while (offset < size) {
+    std::ostringstream where;
+    where << file << " at byte " << offset << ": ";
+    PreparedBHeader header;
+    if (size - offset < sizeof(header)) PreparedBFailure(where.str() + "truncated header");
+    std::memcpy(&header, mem + offset, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic))) PreparedBFailure(where.str() + "not prepared B");
+    if (header.version != kVersion) PreparedBFailure(where.str() + "unknown version");
+    if (header.header_bytes % kPreparedBAlign || header.header_bytes < sizeof(header) + static_cast<uint64_t>(header.name_bytes)) PreparedBFailure(where.str() + "bad header size");
+    if (header.element_bytes != 1 && header.element_bytes != 2) PreparedBFailure(where.str() + "bad element size");
+    if (header.data_bytes != static_cast<uint64_t>(header.rows) * header.cols * header.element_bytes) PreparedBFailure(where.str() + "size does not match shape");
+    if (size - offset < header.header_bytes + header.data_bytes) PreparedBFailure(where.str() + "truncated matrix");
+    if (!header.group || header.rows % header.group || header.cols % 8) PreparedBFailure(where.str() + "bad layout");
+
+    PreparedB matrix;
+    matrix.name.assign(mem + offset + sizeof(header), header.name_bytes);
+    matrix.cpu = static_cast<CPUType>(header.cpu);
+    matrix.element_bytes = header.element_bytes;
+    matrix.rows = header.rows;
+    matrix.cols = header.cols;
+    matrix.quant_mult = header.quant_mult;
+    matrix.data = mem + offset + header.header_bytes;
+    matrix.mapped = true;
+
+    const Index group = PreparedBGroup(GetCPUID(), header.element_bytes);
+    if (!group) UnsupportedCPUError();
+    if (group != header.group) {
+      if (header.rows % group || std::max(group, header.group) % std::min(group, header.group)) PreparedBFailure(where.str() + "can't convert to this CPU's layout");
+      AlignedVector<char> relayout(header.data_bytes);
+      RelayoutPreparedB(matrix.data, header.group, relayout.begin(), group, header.element_bytes, header.rows, header.cols);
+      matrix.data = relayout.begin();
+      matrix.mapped = false;
+      relayout_.push_back(std::move(relayout));
+    }
+    matrices_.push_back(matrix);
+    offset += header.header_bytes + RoundUp(header.data_bytes);
+  }
+}
+
+} // namespace intgemm
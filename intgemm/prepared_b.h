@@ -0,0 +1,140 @@
+#pragma once
+/* Save prepared B to disk and map it back without preparing again.
+ *
+ * PrepareB's output depends on the CPU, but every layout is the same shape:
+ * B is cut into strips of 8 columns and, within a strip, each column
+ * contributes group consecutive values of the shared dimension in turn:
+ *   strip s, rows [k, k + group): B + s * 8 * rows + k * 8, column c at + c * group.
+ * group is the register width in elements (16, 32 or 64 bytes) or 4 bytes
+ * for AMX.  A file records group, so loading on a CPU with the same group
+ * hands back pointers into the mapping and anything else is re-laid out once
+ * in memory.
+ *
+ * A file is a sequence of records, each a PreparedBHeader, the matrix name,
+ * then the matrix starting at the next multiple of kPreparedBAlign bytes.
+ * All fields are little endian like every platform intgemm supports.
+ */
+
+#include "aligned.h"
+#include "intgemm.h"
+#include "types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace intgemm {
+
+// Thrown for files that can't be read or are not prepared B.
+class PreparedBError : public std::exception {
+  public:
+    explicit PreparedBError(const std::string &message) : message_(message) {}
+
+    ~PreparedBError() throw() {}
+
+    const char *what() const throw() override { return message_.c_str(); }
+
+  private:
+    std::string message_;
+};
+
+// Records and the matrices in them are aligned to this many bytes.
+static const std::size_t kPreparedBAlign = 64;
+
+struct PreparedBHeader {
+  char magic[8];
+  // Bytes of matrix after the record's header and name.
+  uint64_t data_bytes;
+  uint32_t version;
+  // From the start of the record to the matrix, a multiple of kPreparedBAlign.
+  uint32_t header_bytes;
+  uint32_t name_bytes;
+  // The CPUType that prepared B.  Only group matters to loading.
+  uint32_t cpu;
+  // 1 for Int8 and Int8Shift, 2 for Int16.
+  uint32_t element_bytes;
+  // Consecutive values of a column, see the top of this file.
+  uint32_t group;
+  // tile_info of the interface that prepared B.
+  uint32_t tile_a_rows, tile_a_cols, tile_b_rows, tile_b_cols;
+  // Shape of B before preparing: rows is the shared dimension.
+  uint32_t rows;
+  uint32_t cols;
+  float quant_mult;
+};
+
+// Layout of B as prepared on cpu, in elements of element_bytes.  Zero if the
+// CPU has no kernels of that width.
+Index PreparedBGroup(CPUType cpu, Index element_bytes);
+
+// Convert prepared B between groups.  rows must be a multiple of both.
+void RelayoutPreparedB(const void *input, Index input_group, void *output, Index output_group, Index element_bytes, Index rows, Index cols);
+
+// Append B prepared on cpu (by Int8::PrepareB, Int8Shift::PrepareB or
+// their transposed variants) to out, which should be binary and positioned
+// at a multiple of kPreparedBAlign, such as the start of a file.
+void WritePreparedB(std::ostream &out, const std::string &name, const int8_t *B, Index rows, Index cols, float quant_mult, CPUType cpu = GetCPUID());
+// Int16::PrepareB output.
+void WritePreparedB(std::ostream &out, const std::string &name, const int16_t *B, Index rows, Index cols, float quant_mult, CPUType cpu = GetCPUID());
+
+// One matrix in a PreparedBFile, ready for Multiply on this CPU.
+struct PreparedB {
+  std::string name;
+  // CPU that wrote the matrix.
+  CPUType cpu;
+  Index element_bytes;
+  Index rows;
+  Index cols;
+  float quant_mult;
+  // Whether data points into the file or into a re-laid out copy.
+  bool mapped;
+  const void *data;
+
+  template <typename Integer>
+  const Integer *as() const { return static_cast<const Integer*>(data); }
+};
+
+// Memory maps a file of prepared B.  Matrices in this CPU's layout are used
+// in place, and so stay valid only as long as the PreparedBFile.
+class PreparedBFile {
+  public:
+    explicit PreparedBFile(const std::string &file);
+
+    PreparedBFile(const PreparedBFile&) = delete;
+    PreparedBFile& operator=(const PreparedBFile&) = delete;
+
+    std::size_t size() const { return matrices_.size(); }
+
+    const PreparedB &operator[](std::size_t index) const { return matrices_[index]; }
+
+    // nullptr if there is no matrix called name.
+    const PreparedB *Find(const std::string &name) const;
+
+  private:
+    void Parse(const std::string &file);
+
+    class Mapping {
+      public:
+        explicit Mapping(const std::string &file);
+        ~Mapping();
+
+        const char *begin() const { return mem_; }
+        std::size_t size() const { return size_; }
+
+      private:
+        const char *mem_;
+        std::size_t size_;
+        // Without mmap the file is read into here.
+        AlignedVector<char> read_;
+    };
+
+    Mapping mapping_;
+
+    std::vector<PreparedB> matrices_;
+    std::vector<AlignedVector<char> > relayout_;
+};
+
+} // namespace intgemm
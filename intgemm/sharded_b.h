@@ -0,0 +1,142 @@
+#pragma once
+/* Prepared B split by columns across NUMA nodes.
+ *
+ * Replicated keeps all of B on every node, so each socket still streams the
+ * whole of B and one multiply is bound by one memory controller.  For B too
+ * big for that, such as a vocabulary projection or a large feed-forward
+ * layer, ShardedB gives each node a consecutive range of B's 8-column strips
+ * in its own memory.  MultiplySharded runs every shard at once on a
+ * NodePools pool pinned to its node, so each socket reads only its share of
+ * B, and writes each shard's columns of the full C through
+ * callbacks::ColumnOffset.
+ *
+ * For sharding across processes instead, ShardColumns gives the same split:
+ * each process prepares and multiplies its columns and wraps its callback in
+ * callbacks::ColumnOffset, leaving the transport of C to the caller.
+ */
+
+#include "aligned.h"
+#include "callbacks.h"
+#include "executor.h"
+#include "numa.h"
+#include "types.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace intgemm {
+
+// Columns [begin, end) of shard out of shards over cols columns, a multiple
+// of 8.  Shards are consecutive, in order, whole strips, and differ in size
+// by at most a strip.
+inline void ShardColumns(Index cols, std::size_t shards, std::size_t shard, Index &begin, Index &end) {
+  assert(cols % 8 == 0 && shard < shards);
+  const std::size_t strips = cols / 8;
+  begin = static_cast<Index>(strips * shard / shards * 8);
+  end = static_cast<Index>(strips * (shard + 1) / shards * 8);
+}
+
+// An AsyncPool per node, its workers pinned to the node's CPUs.  Where the
+// CPUs are unknown each pool gets an equal share of the hardware threads.
+class NodePools {
+  public:
+    explicit NodePools(const std::vector<int> &nodes = NumaNodes()) : nodes_(nodes) {
+      const std::size_t share = std::max<std::size_t>(1, std::thread::hardware_concurrency() / std::max<std::size_t>(1, nodes_.size()));
+      for (int node : nodes_) {
+        const std::vector<int> cpus = NodeCPUs(node);
+        pools_.emplace_back(new AsyncPool(cpus.empty() ? share : cpus.size(), cpus));
+      }
+    }
+
+    // The pool of node, or the first for a node without one.
+    AsyncPool &ForNode(int node) {
+      for (std::size_t i = 0; i < nodes_.size(); ++i) {
+        if (nodes_[i] == node) return *pools_[i];
+      }
+      return *pools_.front();
+    }
+
+    const std::vector<int> &Nodes() const { return nodes_; }
+
+  private:
+    std::vector<int> nodes_;
+    std::vector<std::unique_ptr<AsyncPool> > pools_;
+};
+
+// B prepared by PrepareB of Int8, Int8Shift or Int16, whose 8-column strips
+// are each consecutive, with shard i of ShardColumns bound to nodes[i].
+template <class T> class ShardedB {
+  public:
+    // Copy rows x cols prepared B from from.  cols must be a multiple of 8.
+    ShardedB(const T *from, Index rows, Index cols, Pages pages = Pages::Transparent, const std::vector<int> &nodes = NumaNodes())
+      : rows_(rows), cols_(cols), nodes_(nodes) {
+      shards_.reserve(nodes_.size());
+      for (std::size_t i = 0; i < nodes_.size(); ++i) {
+        Index begin, end;
+        ShardColumns(cols, nodes_.size(), i, begin, end);
+        MemoryPolicy policy;
+        policy.pages = pages;
+        policy.placement = Placement::Node;
+        policy.node = nodes_[i];
+        shards_.emplace_back(static_cast<std::size_t>(rows) * (end - begin), policy);
+        std::memcpy(shards_.back().begin(), from + static_cast<std::size_t>(rows) * begin, shards_.back().size() * sizeof(T));
+      }
+    }
+
+    Index Rows() const { return rows_; }
+    Index Cols() const { return cols_; }
+
+    std::size_t Shards() const { return shards_.size(); }
+
+    // Node shard i is on.
+    int Node(std::size_t i) const { return nodes_[i]; }
+
+    // Shard i, prepared B of rows x (ColumnEnd(i) - ColumnBegin(i)).
+    const T *Shard(std::size_t i) const { return shards_[i].begin(); }
+
+    // Columns of the full B that shard i holds.
+    Index ColumnBegin(std::size_t i) const {
+      Index begin, end;
+      ShardColumns(cols_, shards_.size(), i, begin, end);
+      return begin;
+    }
+    Index ColumnEnd(std::size_t i) const {
+      Index begin, end;
+      ShardColumns(cols_, shards_.size(), i, begin, end);
+      return end;
+    }
+
+  private:
+    Index rows_, cols_;
+    std::vector<int> nodes_;
+    std::vector<AlignedVector<T> > shards_;
+};
+
+// Backend::Multiply of A by B with each shard on the pool of its node, all
+// at once, returning when C is complete.  callback is for the full
+// A_rows x B.Cols() multiply, as with Backend::Multiply of the whole B.  A
+// is read by every node, so it should be small next to B.
+template <class Backend, class Callback>
+void MultiplySharded(const typename Backend::Integer *A, const ShardedB<typename Backend::Integer> &B, Index A_rows, Callback callback, NodePools &pools) {
+  typedef typename Backend::Integer Integer;
+  std::vector<AsyncPool::Handle> handles;
+  handles.reserve(B.Shards());
+  for (std::size_t i = 0; i < B.Shards(); ++i) {
+    const Index begin = B.ColumnBegin(i), end = B.ColumnEnd(i);
+    if (begin == end) continue;
+    AsyncPool &pool = pools.ForNode(B.Node(i));
+    const Integer *shard = B.Shard(i);
+    const Index width = B.Rows(), cols = B.Cols();
+    handles.push_back(pool.Submit([=, &pool] {
+      Backend::Multiply(A, shard, A_rows, width, end - begin, callbacks::ColumnOffset(begin, cols, callback), pool);
+    }));
+  }
+  for (const AsyncPool::Handle &handle : handles) handle.Wait();
+}
+
+} // namespace intgemm
@@ -0,0 +1,42 @@
+#pragma once
+/* Column sums of a prepared B for Int8Shift, kept alongside B.
+ *
+ * Int8Shift multiplies A + 127 by B, so its bias has to take off 127 times
+ * each column sum of B.  Int8Shift::PrepareB can add the sums up while it
+ * prepares B, and SelectColumnsB picks them with the columns, so the bias
+ * comes from ShiftedBias::Write instead of PrepareBias reading B again.
+ */
+
+#include "types.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace intgemm {
+
+struct ShiftedBias {
+  // Sum of each column of the quantized B.
+  std::vector<int32_t> sums;
+
+  // output[c] = sums[c] * unquant_mult + bias[c], which is what PrepareBias
+  // with callbacks::UnquantizeAndAddBiasAndWrite(unquant_mult, bias, output)
+  // writes.  unquant_mult is -alpha * alpha / 127 as for PrepareBias.  bias
+  // may be output.
+  void Write(const float *bias, float unquant_mult, float *output) const {
+    for (std::size_t c = 0; c < sums.size(); ++c) {
+      output[c] = static_cast<float>(sums[c]) * unquant_mult + bias[c];
+    }
+  }
+
+  // Sums of the columns SelectColumnsB took from [cols_begin, cols_end).
+  ShiftedBias Select(const Index *cols_begin, const Index *cols_end) const {
+    ShiftedBias selected;
+    selected.sums.reserve(cols_end - cols_begin);
+    for (const Index *c = cols_begin; c != cols_end; ++c) {
+      selected.sums.push_back(sums[*c]);
+    }
+    return selected;
+  }
+};
+
+} // namespace intgemm
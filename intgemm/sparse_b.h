@@ -0,0 +1,46 @@
+#pragma once
+/* Block sparse prepared B for Int8::MultiplySparse.
+ *
+ * Prepared B is a sequence of strips of 8 columns, each a sequence of tiles
+ * of 8 registers: 8 columns by a register's worth of the shared dimension.
+ * SparseB keeps only the tiles with a nonzero value.  The tiles of a strip
+ * that are kept are grouped into runs of consecutive tiles, so a pruned
+ * model costs a lookup per run rather than per tile and whole zero blocks of
+ * B are never read.
+ */
+
+#include "aligned.h"
+#include "types.h"
+
+#include <vector>
+
+namespace intgemm {
+
+struct SparseB {
+  // Shape of B before preparing: rows is the shared dimension.
+  Index rows = 0;
+  Index cols = 0;
+  // Rows of the shared dimension in a tile, the register width in bytes.
+  Index tile_rows = 0;
+
+  // The tiles kept, strip by strip, in the order Int8::PrepareB writes them.
+  AlignedVector<int8_t> tiles;
+
+  // Strip s has runs [strip_runs[s], strip_runs[s + 1]) and its first tile
+  // is tile number strip_tiles[s] in tiles.  Both have cols / 8 + 1 entries.
+  std::vector<Index> strip_runs;
+  std::vector<Index> strip_tiles;
+
+  // Run i starts at tile run_begin[i] down its strip and covers
+  // run_length[i] tiles.
+  std::vector<Index> run_begin;
+  std::vector<Index> run_length;
+
+  // Fraction of tiles kept.
+  float Density() const {
+    if (strip_tiles.empty()) return 0.0f;
+    return static_cast<float>(strip_tiles.back()) / (static_cast<float>(rows / tile_rows) * (cols / 8));
+  }
+};
+
+} // namespace intgemm
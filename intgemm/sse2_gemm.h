@@ -41,6 +41,12 @@ class QuantizeTile16 {
     }
 };
 
+// 8 bytes of B sign extended to 16 bits for INTGEMM_MULTIPLY_MIXED.
+INTGEMM_SSE2 static inline __m128i ExtendInt8(const uint64_t *b) {
+  __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(b));
+  return _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8);
+}
+
 // This should be pure SSE2 (and below).
 struct Kernels16 {
   typedef int16_t Integer;
@@ -74,6 +80,7 @@ struct Kernels16 {
     SelectColumnsOfB((const __m128i*)input, (__m128i*)output, rows * 2, cols_begin, cols_end);
   }
   INTGEMM_MULTIPLY16(__m128i, INTGEMM_SSE2, CPUType::SSE2)
+  INTGEMM_MULTIPLY_MIXED(__m128i, uint64_t, INTGEMM_SSE2, CPUType::SSE2, 1, MultiplyStrip, ExtendInt8)
 
   constexpr static const char *const kName = "16-bit SSE2";
 
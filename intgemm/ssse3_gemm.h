@@ -107,8 +107,13 @@ struct Kernels8 {
 
  private:
   INTGEMM_QUANTIZE_THREAD(INTGEMM_SSSE3)
+  INTGEMM_QUANTIZE_ROWS_THREAD(INTGEMM_SSSE3)
+  INTGEMM_QUANTIZE_SCALED_THREAD(INTGEMM_SSSE3)
  public:
   INTGEMM_QUANTIZE(INTGEMM_SSSE3)
+  INTGEMM_QUANTIZE_ROWS(INTGEMM_SSSE3)
+  INTGEMM_QUANTIZE_SCALED(INTGEMM_SSSE3)
+  INTGEMM_QUANTIZE_SERIAL(INTGEMM_SSSE3)
 
   // Version with unsigned int + 127
   // Currently A is prepared by quantization but this could theoretically change.
@@ -1,6 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
 #include "intrinsics.h"
 
 #ifdef _OPENMP
@@ -11,6 +17,14 @@ namespace intgemm {
 
 /* Horizontal max and sums.  TODO make a template argument? */
 
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+INTGEMM_NEON static inline float MaxFloat32(float32x4_t a) {
+  return vmaxvq_f32(a);
+}
+INTGEMM_NEON static inline float AddFloat32(float32x4_t a) {
+  return vaddvq_f32(a);
+}
+#else
 INTGEMM_SSE2 static inline float MaxFloat32(__m128 a) {
   // Fold to just using the first 64 bits.
   __m128 second_half = _mm_shuffle_ps(a, a, 3 * 4 + 2);
@@ -31,6 +45,7 @@ INTGEMM_SSE2 static inline float AddFloat32(__m128 a) {
   // This casting compiles to nothing.
   return *reinterpret_cast<float*>(&a);
 }
+#endif
 
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 INTGEMM_AVX2 static inline float MaxFloat32(__m256 a) {
@@ -57,11 +72,42 @@ INTGEMM_AVX512F static inline float AddFloat32(__m512 a) {
 
 constexpr int32_t kFloatAbsoluteMask = 0x7fffffff;
 
+/* HistogramAbsolute's bins of |x|.  Each power of two from
+ * 2^kHistogramMinExponent up to 2^kHistogramMaxExponent is cut into
+ * 2^kHistogramMantissaBits bins by the leading bits of the mantissa, so a bin
+ * is at most 1/32 of its values wide and no range is needed up front.
+ * Smaller values, including zero, count in the first bin; larger ones,
+ * infinity and NaN in the last.
+ */
+constexpr int kHistogramMantissaBits = 5;
+constexpr int kHistogramMinExponent = -64;
+constexpr int kHistogramMaxExponent = 64;
+constexpr Index kHistogramBins = (kHistogramMaxExponent - kHistogramMinExponent) << kHistogramMantissaBits;
+// The float bits, shifted right by 23 - kHistogramMantissaBits, of the first bin.
+constexpr int32_t kHistogramBias = (127 + kHistogramMinExponent) << kHistogramMantissaBits;
+// Bits of the floats |x| is clamped to so the bin is in range.
+constexpr int32_t kHistogramLowest = (127 + kHistogramMinExponent) << 23;
+constexpr int32_t kHistogramHighest = ((127 + kHistogramMaxExponent) << 23) - 1;
+
+// The bin of |value|, as the kernels compute it a register at a time.
+static inline Index HistogramBin(float value) {
+  int32_t bits;
+  std::memcpy(&bits, &value, sizeof(float));
+  bits = std::min(std::max(bits & kFloatAbsoluteMask, kHistogramLowest), kHistogramHighest);
+  return (bits >> (23 - kHistogramMantissaBits)) - kHistogramBias;
+}
+
 } // namespace intgemm
 
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+#define INTGEMM_THIS_IS_NEON
+#include "stats.inl"
+#undef INTGEMM_THIS_IS_NEON
+#else
 #define INTGEMM_THIS_IS_SSE2
 #include "stats.inl"
 #undef INTGEMM_THIS_IS_SSE2
+#endif
 
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 #define INTGEMM_THIS_IS_AVX2
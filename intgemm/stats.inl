@@ -8,6 +8,9 @@
 #elif defined(INTGEMM_THIS_IS_SSE2)
 #define INTGEMM_ARCH SSE2
 #define INTGEMM_TARGET INTGEMM_SSE2
+#elif defined(INTGEMM_THIS_IS_NEON)
+#define INTGEMM_ARCH NEON
+#define INTGEMM_TARGET INTGEMM_NEON
 #else
 #error Included with unexpected architecture
 #endif
@@ -60,13 +63,50 @@ INTGEMM_TARGET static inline float MaxAbsolute(const float *begin_float, const f
   return ret;
 }
 
+/* Count |x| of an array of floats into the kHistogramBins counts, adding to
+ * them.  Any alignment.  Each thread counts into its own bins and they are
+ * summed at the end.  Do not call this function directly; it's a subroutine of
+ * AbsHistogram::Add.
+ */
+INTGEMM_TARGET static inline void HistogramAbsolute(const float *begin, const float *end, uint64_t *counts) {
+  const std::ptrdiff_t lanes = sizeof(FRegister) / sizeof(float);
+  const std::ptrdiff_t registers = (end - begin) / lanes;
+#pragma omp parallel num_threads(std::max<int>(1, std::min<int>(omp_get_max_threads(), (end - begin) / 65536)))
+  {
+    std::vector<uint64_t> local(kHistogramBins);
+    const FRegister abs_mask = cast_ps(set1_epi32<Register>(kFloatAbsoluteMask));
+    const FRegister lowest = cast_ps(set1_epi32<Register>(kHistogramLowest));
+    const FRegister highest = cast_ps(set1_epi32<Register>(kHistogramHighest));
+    const Register bias = set1_epi32<Register>(kHistogramBias);
+#pragma omp for
+    for (std::ptrdiff_t r = 0; r < registers; ++r) {
+      // min_ps returns highest for NaN so it counts in the last bin.
+      FRegister value = max_ps(min_ps(and_ps(abs_mask, loadu_ps<FRegister>(begin + r * lanes)), highest), lowest);
+      Register bins = sub_epi32(srli_epi32<23 - kHistogramMantissaBits>(cast_si(value)), bias);
+      int32_t index[sizeof(Register) / sizeof(int32_t)];
+      std::memcpy(index, &bins, sizeof(Register));
+      for (std::ptrdiff_t j = 0; j < lanes; ++j) {
+        ++local[index[j]];
+      }
+    }
+#pragma omp critical
+    for (Index b = 0; b < kHistogramBins; ++b) {
+      counts[b] += local[b];
+    }
+  }
+  for (const float *i = begin + registers * lanes; i < end; ++i) {
+    ++counts[HistogramBin(*i)];
+  }
+}
+
 /* Computes the euclidean norm and returns the mean and the standard deviation. Optionally it can be the mean and standard deviation in absolute terms. */
 INTGEMM_TARGET static inline MeanStd VectorMeanStd(const float *begin_float, const float *end_float, bool absolute) {
   assert(end_float > begin_float);
-  assert((end_float - begin_float) % (sizeof(FRegister) / sizeof(float)) == 0);
+  assert(reinterpret_cast<uintptr_t>(begin_float) % sizeof(FRegister) == 0);
   size_t num_items = end_float - begin_float;
+  const float *end_reg = end_float - num_items % (sizeof(FRegister) / sizeof(float));
   const FRegister *begin = reinterpret_cast<const FRegister*>(begin_float);
-  const FRegister *end = reinterpret_cast<const FRegister*>(end_float);
+  const FRegister *end = reinterpret_cast<const FRegister*>(end_reg);
   FRegister squares = set1_ps<FRegister>(0);
   FRegister sums = set1_ps<FRegister>(0);
   if (absolute) {
@@ -85,6 +125,12 @@ INTGEMM_TARGET static inline MeanStd VectorMeanStd(const float *begin_float, con
   }
   float squares_sum = AddFloat32(squares);
   float normal_sums = AddFloat32(sums);
+  // Overhang, as in MaxAbsolute.
+  for (const float *i = end_reg; i < end_float; ++i) {
+    const float value = absolute ? std::fabs(*i) : *i;
+    squares_sum += value * value;
+    normal_sums += value;
+  }
   MeanStd ret;
   ret.mean = normal_sums/num_items;
   ret.stddev = std::sqrt((squares_sum/num_items) - (ret.mean*ret.mean));
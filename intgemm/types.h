@@ -1,11 +1,16 @@
 #pragma once
 #include "intgemm/intgemm_config.h"
 
+#include <cstdint>
 #include <exception>
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+#include <arm_neon.h>
+#else
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 #include <immintrin.h>
 #endif
 #include <emmintrin.h>
+#endif
 
 // clang-cl bug doesn't include these headers when pretending to be MSVC
 // https://github.com/llvm/llvm-project/blob/e9a294449575a1e1a0daca470f64914695dc9adc/clang/lib/Headers/immintrin.h#L69-L72
@@ -17,6 +22,7 @@
 #include <avx512dqintrin.h>
 #include <avx512bwintrin.h>
 #include <avx512vnniintrin.h>
+#include <avxvnniintrin.h>
 #endif
 
 #if (defined(_MSC_VER) && !defined(__clang__)) || defined(__INTEL_COMPILER)
@@ -40,19 +46,41 @@
   #define INTGEMM_SSE2
   #define INTGEMM_SSSE3
   #define INTGEMM_AVX2
+  #define INTGEMM_AVXVNNI
   #define INTGEMM_AVX512F
   #define INTGEMM_AVX512BW
   #define INTGEMM_AVX512DQ
   #define INTGEMM_AVX512VNNI
+  #define INTGEMM_AMX
+  #define INTGEMM_NEON
+  #define INTGEMM_NEON_DOTPROD
+  #define INTGEMM_FLATTEN
+  #define INTGEMM_PREFETCH(address) _mm_prefetch(reinterpret_cast<const char*>(address), _MM_HINT_T0)
 #else
   /* gcc and clang take lists of all the flavors */
   #define INTGEMM_SSE2 __attribute__ ((target ("sse2")))
   #define INTGEMM_SSSE3 __attribute__ ((target ("ssse3")))
   #define INTGEMM_AVX2 __attribute__ ((target ("avx2")))
+  #define INTGEMM_AVXVNNI __attribute__ ((target ("avx2,avxvnni")))
   #define INTGEMM_AVX512F __attribute__ ((target ("avx512f")))
   #define INTGEMM_AVX512BW __attribute__ ((target ("avx512f,avx512bw,avx512dq")))
   #define INTGEMM_AVX512DQ __attribute__ ((target ("avx512f,avx512bw,avx512dq")))
   #define INTGEMM_AVX512VNNI __attribute__ ((target ("avx512f,avx512bw,avx512dq,avx512vnni")))
+  #define INTGEMM_AMX __attribute__ ((target ("avx512f,avx512bw,avx512dq,avx512vnni,amx-tile,amx-int8")))
+  /* Advanced SIMD is part of the aarch64 baseline.  The dot product
+   * instructions are optional before Armv8.4 and gcc and clang spell the
+   * target differently. */
+  #define INTGEMM_NEON
+  #if defined(__clang__)
+    #define INTGEMM_NEON_DOTPROD __attribute__ ((target ("dotprod")))
+  #else
+    #define INTGEMM_NEON_DOTPROD __attribute__ ((target ("+dotprod")))
+  #endif
+  /* Inline everything a function calls so compile-time shapes propagate into
+   * the kernels' loops. */
+  #define INTGEMM_FLATTEN __attribute__ ((flatten))
+  /* Hint that address will be read soon. */
+  #define INTGEMM_PREFETCH(address) __builtin_prefetch(address)
 #endif
 namespace intgemm {
 
@@ -71,23 +99,66 @@ class UnsupportedCPU : public std::exception {
 typedef unsigned int Index;
 
 // If you want to detect the CPU and dispatch yourself, here's what to use:
+// Ordered by preference.  AVXVNNI is AVX2 plus 256-bit VNNI (Alder Lake and
+// later client parts); CPUs with AVX512 need not have it, so a higher type does
+// not imply AVXVNNI can run.  See AVXVNNIAvailable.  NEON and NEONDOTPROD are
+// the aarch64 types; a build has either the x86 types or these.  WASM is
+// native SIMD128 in a WebAssembly build, which also runs the SSE2 and SSSE3
+// code through emscripten's emulation.
 enum class CPUType {
   UNSUPPORTED = 0,
   SSE2 = 1,
   SSSE3 = 2,
   AVX2 = 3,
-  AVX512BW = 4,
-  AVX512VNNI = 5
+  AVXVNNI = 4,
+  AVX512BW = 5,
+  AVX512VNNI = 6,
+  AMX = 7,
+  NEON = 8,
+  NEONDOTPROD = 9,
+  SIMD128 = 10
 };
 
-// Running CPU type.  This is defined in intgemm.cc (as the dispatcher).
+// Running CPU type.  This is defined in intgemm.cc (as the dispatcher) and
+// set during static initialization, so code that may run before then, such
+// as another static initializer, should call GetCPUID() instead.  intgemm
+// itself only calls GetCPUID().
 extern const CPUType kCPU;
 
+// Running CPU type, detected on the first call.
+CPUType GetCPUID();
+
 struct MeanStd {
   float mean;
   float stddev;
 };
 
+// What a quantize with a fused scale, like Int8::QuantizeScaled, maps to 127.
+enum class ScaleStatistic {
+  // The largest absolute value, so nothing saturates.
+  MaxAbsolute,
+  // The mean absolute value plus stddevs standard deviations of it, which
+  // saturates outliers, as with GetVectorMeanStd(begin, end, true).
+  MeanStd
+};
+
+// 16-bit floats, held as their bits so overloads can tell the formats apart.
+// BFloat16 is the top half of a float and Half is IEEE binary16.  intgemm
+// only converts them to and from float; see float16.h.
+struct BFloat16 {
+  uint16_t bits;
+};
+
+struct Half {
+  uint16_t bits;
+};
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AMX
+namespace AMX {
+typedef __m512i Register;
+typedef __m512 FRegister;
+} // namespace AMX
+#endif
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX512VNNI
 namespace AVX512VNNI {
 typedef __m512i Register;
@@ -100,12 +171,30 @@ typedef __m512i Register;
 typedef __m512 FRegister;
 } // namespace AVX512BW
 #endif
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVXVNNI
+namespace AVXVNNI {
+typedef __m256i Register;
+typedef __m256 FRegister;
+} // namespace AVXVNNI
+#endif
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 namespace AVX2 {
 typedef __m256i Register;
 typedef __m256 FRegister;
 } // namespace AVX2
 #endif
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+namespace NEON {
+typedef int32x4_t Register;
+typedef float32x4_t FRegister;
+} // namespace NEON
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON_DOTPROD
+namespace NEONDOTPROD {
+typedef int32x4_t Register;
+typedef float32x4_t FRegister;
+} // namespace NEONDOTPROD
+#endif
+#else
 namespace SSSE3 {
 typedef __m128i Register;
 typedef __m128 FRegister;
@@ -114,5 +203,13 @@ namespace SSE2 {
 typedef __m128i Register;
 typedef __m128 FRegister;
 } // namespace SSE2
+#ifdef WASM
+// emscripten's __m128i is the same vector type as v128_t.
+namespace SIMD128 {
+typedef __m128i Register;
+typedef __m128 FRegister;
+} // namespace SIMD128
+#endif
+#endif
 
 } // namespace intgemm
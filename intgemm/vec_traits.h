@@ -8,6 +8,13 @@ namespace intgemm {
  * Vector traits
  */
 template <CPUType CPUType_, typename ElemType_> struct vector_s;
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+template <> struct vector_s<CPUType::NEON, int8_t> { using type = int8x16_t; };
+template <> struct vector_s<CPUType::NEON, int16_t> { using type = int16x8_t; };
+template <> struct vector_s<CPUType::NEON, int> { using type = int32x4_t; };
+template <> struct vector_s<CPUType::NEON, float> { using type = float32x4_t; };
+template <> struct vector_s<CPUType::NEON, double> { using type = float64x2_t; };
+#else
 template <> struct vector_s<CPUType::SSE2, int8_t> { using type = __m128i; };
 template <> struct vector_s<CPUType::SSE2, int16_t> { using type = __m128i; };
 template <> struct vector_s<CPUType::SSE2, int> { using type = __m128i; };
@@ -18,6 +25,7 @@ template <> struct vector_s<CPUType::SSSE3, int16_t> { using type = __m128i; };
 template <> struct vector_s<CPUType::SSSE3, int> { using type = __m128i; };
 template <> struct vector_s<CPUType::SSSE3, float> { using type = __m128; };
 template <> struct vector_s<CPUType::SSSE3, double> { using type = __m128d; };
+#endif
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 template <> struct vector_s<CPUType::AVX2, int8_t> { using type = __m256i; };
 template <> struct vector_s<CPUType::AVX2, int16_t> { using type = __m256i; };
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "intgemm/intgemm_config.h"
+
+#ifdef WASM
+#include "ssse3_gemm.h"
+#include "types.h"
+
+#include <wasm_simd128.h>
+
+namespace intgemm {
+namespace SIMD128 {
+
+/* emscripten lowers maddubs_epi16 and sign_epi8 to long scalarized sequences,
+ * so the SSSE3 8-bit multiply is slow in a browser.  These kernels use SIMD128
+ * directly.  Prepared B is the same as SSSE3 so only the multiplies change.
+ * They are marked INTGEMM_SSSE3 so the shared SSE2/SSSE3 helpers inline.
+ *
+ * With INTGEMM_WASM_RELAXED_SIMD the dot products use
+ * i32x4.relaxed_dot_i8x16_i7x16_add.  Its second operand must be 7-bit, which
+ * |a| is for quantized values, so the sign of a moves onto b as in maddubs.
+ * The result is then exact and the same on every engine.
+ */
+
+// Sum of 16 products of a and b added into the 4 lanes of sum.  Quantization
+// keeps both in [-127, 127] so two 16-bit products add without overflow.
+INTGEMM_SSSE3 static inline Register Dot8(Register sum, Register a, Register b) {
+#ifdef INTGEMM_WASM_RELAXED_SIMD
+  Register negative = wasm_i8x16_lt(a, wasm_i8x16_splat(0));
+  Register b_signed = wasm_i8x16_sub(wasm_v128_xor(b, negative), negative);
+  return wasm_i32x4_relaxed_dot_i8x16_i7x16_add(b_signed, wasm_i8x16_abs(a), sum);
+#else
+  Register products = wasm_i16x8_add(wasm_i16x8_extmul_low_i8x16(a, b), wasm_i16x8_extmul_high_i8x16(a, b));
+  return wasm_i32x4_add(sum, wasm_i32x4_extadd_pairwise_i16x8(products));
+#endif
+}
+
+// Sum of each 32-bit group of signed bytes in b, for the column sums of B.
+INTGEMM_SSSE3 static inline Register Sum8(Register sum, Register b) {
+  return wasm_i32x4_add(sum, wasm_i32x4_extadd_pairwise_i16x8(wasm_i16x8_extadd_pairwise_i8x16(b)));
+}
+
+struct Kernels8 : public SSSE3::Kernels8 {
+  static const Index kMultiplyRows = 2;
+
+  // Multiply kRows consecutive rows of A (A_stride registers apart) by an
+  // 8-column strip of B over count registers of the shared dimension.
+  template <Index kRows>
+  INTGEMM_SSSE3 static inline void MultiplyStrip(const Register *A, Index A_stride, const Register *B, Index count, INTGEMM_MULTIPLY_TOTAL(Register) *totals) {
+    const Register zeros = wasm_i32x4_splat(0);
+    Register sums[kRows][8];
+    for (Index r = 0; r < kRows; ++r) {
+      for (Index c = 0; c < 8; ++c) {
+        sums[r][c] = zeros;
+      }
+    }
+    for (Index k = 0; k < count; ++k, B += 8) {
+      for (Index r = 0; r < kRows; ++r) {
+        Register a = A[r * A_stride + k];
+        for (Index c = 0; c < 8; ++c) {
+          sums[r][c] = Dot8(sums[r][c], a, B[c]);
+        }
+      }
+    }
+    for (Index r = 0; r < kRows; ++r) {
+      Register pack0123 = Pack0123(sums[r][0], sums[r][1], sums[r][2], sums[r][3]);
+      Register pack4567 = Pack0123(sums[r][4], sums[r][5], sums[r][6], sums[r][7]);
+      totals[r] = PermuteSummer(pack0123, pack4567);
+    }
+  }
+
+  // A is unsigned, up to 254.  SIMD128 has no unsigned by signed byte multiply
+  // so widen both to 16 bits and use i32x4.dot_i16x8_s.  Relaxed SIMD splits a
+  // into its low 7 bits and top bit, both valid 7-bit operands.
+  template <Index kRows>
+  INTGEMM_SSSE3 static inline void Multiply8ShiftStrip(const Register *A, Index A_stride, const Register *B, Index count, INTGEMM_MULTIPLY_TOTAL(Register) *totals) {
+    const Register zeros = wasm_i32x4_splat(0);
+    Register sums[kRows][8];
+#ifdef INTGEMM_WASM_RELAXED_SIMD
+    Register sums_top[kRows][8];
+#endif
+    for (Index r = 0; r < kRows; ++r) {
+      for (Index c = 0; c < 8; ++c) {
+        sums[r][c] = zeros;
+#ifdef INTGEMM_WASM_RELAXED_SIMD
+        sums_top[r][c] = zeros;
+#endif
+      }
+    }
+    for (Index k = 0; k < count; ++k, B += 8) {
+      for (Index r = 0; r < kRows; ++r) {
+        Register a = A[r * A_stride + k];
+#ifdef INTGEMM_WASM_RELAXED_SIMD
+        Register a_low = wasm_v128_and(a, wasm_i8x16_splat(0x7f));
+        Register a_top = wasm_u8x16_shr(a, 7);
+        for (Index c = 0; c < 8; ++c) {
+          sums[r][c] = wasm_i32x4_relaxed_dot_i8x16_i7x16_add(B[c], a_low, sums[r][c]);
+          sums_top[r][c] = wasm_i32x4_relaxed_dot_i8x16_i7x16_add(B[c], a_top, sums_top[r][c]);
+        }
+#else
+        Register a_low = wasm_u16x8_extend_low_u8x16(a);
+        Register a_high = wasm_u16x8_extend_high_u8x16(a);
+        for (Index c = 0; c < 8; ++c) {
+          Register low = wasm_i32x4_dot_i16x8(a_low, wasm_i16x8_extend_low_i8x16(B[c]));
+          Register high = wasm_i32x4_dot_i16x8(a_high, wasm_i16x8_extend_high_i8x16(B[c]));
+          sums[r][c] = wasm_i32x4_add(sums[r][c], wasm_i32x4_add(low, high));
+        }
+#endif
+      }
+    }
+    for (Index r = 0; r < kRows; ++r) {
+#ifdef INTGEMM_WASM_RELAXED_SIMD
+      for (Index c = 0; c < 8; ++c) {
+        sums[r][c] = wasm_i32x4_add(sums[r][c], wasm_i32x4_shl(sums_top[r][c], 7));
+      }
+#endif
+      Register pack0123 = Pack0123(sums[r][0], sums[r][1], sums[r][2], sums[r][3]);
+      Register pack4567 = Pack0123(sums[r][4], sums[r][5], sums[r][6], sums[r][7]);
+      totals[r] = PermuteSummer(pack0123, pack4567);
+    }
+  }
+
+  INTGEMM_MULTIPLY_BLOCKED(int8_t, int8_t, Register, INTGEMM_SSSE3, CPUType::SSE2, MultiplyRows, MultiplyStrip)
+
+  template <typename Callback>
+  INTGEMM_SSSE3 static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    MultiplyRows<kMultiplyRows, Callback>(A, B, A_rows, width, B_cols, callback);
+  }
+
+  template <typename Callback>
+  INTGEMM_SSSE3 static void Multiply(const int8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) {
+    MultiplyRows<kMultiplyRows, Callback>(A, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end);
+  }
+
+  INTGEMM_MULTIPLY_STRIDED(int8_t, int8_t, INTGEMM_SSSE3, MultiplyRows, kMultiplyRows)
+  INTGEMM_MULTIPLY_FIXED(int8_t, int8_t, INTGEMM_SSSE3, MultiplyRows, kMultiplyRows)
+
+  INTGEMM_MULTIPLY_FLOAT_A(int8_t, int8_t, Register, INTGEMM_SSSE3, CPUType::SSE2, MultiplyFloatA, MultiplyRows, kMultiplyRows)
+  INTGEMM_MULTIPLY_NT(Register, INTGEMM_SSSE3, CPUType::SSE2, MultiplyNT, MultiplyRows, kMultiplyRows)
+
+  INTGEMM_MULTIPLY4(Register, INTGEMM_SSSE3, CPUType::SSE2, kMultiplyRows, MultiplyStrip, UnpackInt4)
+  INTGEMM_MULTIPLY_SPARSE(Register, INTGEMM_SSSE3, CPUType::SSE2, kMultiplyRows, MultiplyStrip)
+  INTGEMM_MULTIPLY_COLUMNS(Register, INTGEMM_SSSE3, CPUType::SSE2, kMultiplyRows, MultiplyStrip)
+  INTGEMM_MULTIPLY_SPLIT_K(Register, INTGEMM_SSSE3, CPUType::SSE2, MultiplyRows, kMultiplyRows)
+
+  INTGEMM_MULTIPLY_BLOCKED(uint8_t, int8_t, Register, INTGEMM_SSSE3, CPUType::SSE2, Multiply8ShiftRows, Multiply8ShiftStrip)
+
+  template <typename Callback>
+  INTGEMM_SSSE3 static void Multiply8Shift(const uint8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback) {
+    Multiply8ShiftRows<kMultiplyRows, Callback>(A, B, A_rows, width, B_cols, callback);
+  }
+
+  template <typename Callback>
+  INTGEMM_SSSE3 static void Multiply8Shift(const uint8_t *A, const int8_t *B, Index A_rows, Index width, Index B_cols, Callback callback, Index A_row_begin, Index A_row_end, Index B_col_begin, Index B_col_end) {
+    Multiply8ShiftRows<kMultiplyRows, Callback>(A, B, A_rows, width, B_cols, callback, A_row_begin, A_row_end, B_col_begin, B_col_end);
+  }
+
+  INTGEMM_MULTIPLY_FLOAT_A(uint8_t, int8_t, Register, INTGEMM_SSSE3, CPUType::SSE2, Multiply8ShiftFloatA, Multiply8ShiftRows, kMultiplyRows)
+
+  template <typename Callback>
+  INTGEMM_SSSE3 static void PrepareBias(const int8_t *B, Index width, Index B_cols, Callback callback) {
+    assert(width % sizeof(Register) == 0);
+    assert(B_cols % 8 == 0);
+    assert(reinterpret_cast<uintptr_t>(B) % sizeof(Register) == 0);
+    const Index simd_width = width / sizeof(Register);
+    auto callback_impl = callbacks::CallbackImpl<CPUType::SSE2, Callback>(callback);
+    INTGEMM_OMP_FOR
+    for (Index B0_colidx = 0; B0_colidx < B_cols; B0_colidx += 8) {
+      const Register *B_live = reinterpret_cast<const Register*>(B) + B0_colidx * simd_width;
+      Register sums[8];
+      for (Index c = 0; c < 8; ++c) {
+        sums[c] = wasm_i32x4_splat(0);
+      }
+      for (Index k = 0; k < simd_width; ++k, B_live += 8) {
+        for (Index c = 0; c < 8; ++c) {
+          sums[c] = Sum8(sums[c], B_live[c]);
+        }
+      }
+      Register pack0123 = Pack0123(sums[0], sums[1], sums[2], sums[3]);
+      Register pack4567 = Pack0123(sums[4], sums[5], sums[6], sums[7]);
+      RunCallback(callback_impl, PermuteSummer(pack0123, pack4567), 0, B0_colidx, 1, B_cols);
+    }
+  }
+
+#ifdef INTGEMM_WASM_RELAXED_SIMD
+  constexpr static const char *const kName = "8-bit WASM relaxed SIMD";
+#else
+  constexpr static const char *const kName = "8-bit WASM SIMD128";
+#endif
+
+  static const CPUType kUses = CPUType::SIMD128;
+};
+
+} // namespace SIMD128
+} // namespace intgemm
+
+#endif
@@ -0,0 +1,87 @@
+#pragma once
+/* Scratch memory reused from one layer call to the next.
+ *
+ * A layer typically needs a prepared A and a C for each call.  Allocating
+ * them as AlignedVectors every time costs allocator calls and page faults;
+ * instead Allocate them from a Workspace and Reset it once the call's
+ * outputs are consumed.  Allocation bumps a pointer through a block.  When a
+ * call needs more than the block holds another block is added, and Reset
+ * replaces the blocks with one big enough for everything the largest call
+ * took, so from then on calls don't allocate at all.
+ *
+ * A Workspace is not thread safe; ThreadLocal gives each thread its own.
+ */
+
+#include "aligned.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace intgemm {
+
+class Workspace {
+  public:
+    // Every allocation starts on a cache line.
+    static const std::size_t kAlign = 64;
+
+    Workspace() : used_(0), in_use_(0), high_water_(0) {}
+
+    // Start with room for bytes so the first call doesn't allocate either.
+    explicit Workspace(std::size_t bytes) : Workspace() {
+      blocks_.emplace_back(RoundUp(bytes));
+    }
+
+    // Uninitialized space for count T, valid until Reset.
+    template <class T> T *Allocate(std::size_t count) {
+      const std::size_t bytes = RoundUp(count * sizeof(T));
+      if (blocks_.empty() || used_ + bytes > blocks_.back().size()) {
+        // Grow geometrically so a call that outgrows the block adds few more.
+        const std::size_t last = blocks_.empty() ? 0 : blocks_.back().size();
+        blocks_.emplace_back(std::max(bytes, 2 * last));
+        used_ = 0;
+      }
+      T *ret = reinterpret_cast<T*>(blocks_.back().begin() + used_);
+      used_ += bytes;
+      in_use_ += bytes;
+      return ret;
+    }
+
+    // Free everything allocated since the last Reset for reuse.
+    void Reset() {
+      high_water_ = std::max(high_water_, in_use_);
+      if (blocks_.size() > 1) {
+        blocks_.clear();
+        blocks_.emplace_back(high_water_);
+      }
+      used_ = 0;
+      in_use_ = 0;
+    }
+
+    // Bytes held, whether allocated or not.
+    std::size_t Capacity() const {
+      std::size_t ret = 0;
+      for (const AlignedVector<char> &block : blocks_) ret += block.size();
+      return ret;
+    }
+
+    // This thread's Workspace, kept for the life of the thread.
+    static Workspace &ThreadLocal() {
+      static thread_local Workspace workspace;
+      return workspace;
+    }
+
+  private:
+    static std::size_t RoundUp(std::size_t bytes) {
+      return (bytes + kAlign - 1) / kAlign * kAlign;
+    }
+
+    std::vector<AlignedVector<char> > blocks_;
+    // Bytes taken from the last block.
+    std::size_t used_;
+    // Bytes allocated since Reset, and the most for any call.
+    std::size_t in_use_;
+    std::size_t high_water_;
+};
+
+} // namespace intgemm
@@ -280,6 +280,23 @@ template <class Routine> void TestMultiplyShiftInt(Index A_rows, Index width, In
 
 
 // Bias
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+TEST_CASE("PrepareBias NEON", "[Add127]") {
+	if (kCPU < CPUType::NEON) return;
+	TestPrepareBias<NEON::Kernels8>(256,256);
+	TestPrepareBias<NEON::Kernels8>(2048,256);
+	TestPrepareBias<NEON::Kernels8>(512,512);
+}
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON_DOTPROD
+TEST_CASE("PrepareBias NEONDOTPROD", "[Add127]") {
+	if (kCPU < CPUType::NEONDOTPROD) return;
+	TestPrepareBias<NEONDOTPROD::Kernels8>(256,256);
+	TestPrepareBias<NEONDOTPROD::Kernels8>(2048,256);
+	TestPrepareBias<NEONDOTPROD::Kernels8>(512,512);
+}
+#endif
+#else
 TEST_CASE("PrepareBias SSSE3", "[Add127]") {
 	if (kCPU < CPUType::SSSE3) return;
 	TestPrepareBias<SSSE3::Kernels8>(256,256);
@@ -287,6 +304,16 @@ TEST_CASE("PrepareBias SSSE3", "[Add127]") {
 	TestPrepareBias<SSSE3::Kernels8>(512,512);
 }
 
+#ifdef WASM
+TEST_CASE("PrepareBias SIMD128", "[Add127]") {
+	if (kCPU < CPUType::SIMD128) return;
+	TestPrepareBias<SIMD128::Kernels8>(256,256);
+	TestPrepareBias<SIMD128::Kernels8>(2048,256);
+	TestPrepareBias<SIMD128::Kernels8>(512,512);
+}
+#endif
+#endif
+
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 TEST_CASE("PrepareBias AVX2", "[Add127]") {
 	if (kCPU < CPUType::AVX2) return;
@@ -296,6 +323,15 @@ TEST_CASE("PrepareBias AVX2", "[Add127]") {
 }
 #endif
 
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVXVNNI
+TEST_CASE("PrepareBias AVXVNNI", "[Add127]") {
+	if (!AVXVNNIAvailable()) return;
+	TestPrepareBias<AVXVNNI::Kernels8>(256,256);
+	TestPrepareBias<AVXVNNI::Kernels8>(2048,256);
+	TestPrepareBias<AVXVNNI::Kernels8>(512,512);
+}
+#endif
+
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
 TEST_CASE("PrepareBias AVX512F", "[Add127]") {
 	if (kCPU < CPUType::AVX512BW) return;
@@ -305,7 +341,35 @@ TEST_CASE("PrepareBias AVX512F", "[Add127]") {
 }
 #endif
 
+#ifdef INTGEMM_COMPILER_SUPPORTS_AMX
+TEST_CASE("PrepareBias AMX", "[Add127]") {
+	if (kCPU < CPUType::AMX) return;
+	TestPrepareBias<AMX::Kernels8>(256,256);
+	TestPrepareBias<AMX::Kernels8>(2048,256);
+	TestPrepareBias<AMX::Kernels8>(512,512);
+}
+#endif
+
 //A
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+TEST_CASE("PrepareA NEON", "[Add127]") {
+	if (kCPU < CPUType::NEON) return;
+	TestPrepareA<NEON::Kernels8>(64,64);
+	TestPrepareA<NEON::Kernels8>(256,256);
+	TestPrepareA<NEON::Kernels8>(512,512);
+  TestPrepareA<NEON::Kernels8>(2048,256);
+}
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON_DOTPROD
+TEST_CASE("PrepareA NEONDOTPROD", "[Add127]") {
+	if (kCPU < CPUType::NEONDOTPROD) return;
+	TestPrepareA<NEONDOTPROD::Kernels8>(64,64);
+	TestPrepareA<NEONDOTPROD::Kernels8>(256,256);
+	TestPrepareA<NEONDOTPROD::Kernels8>(512,512);
+  TestPrepareA<NEONDOTPROD::Kernels8>(2048,256);
+}
+#endif
+#else
 TEST_CASE("PrepareA SSSE3", "[Add127]") {
 	if (kCPU < CPUType::SSSE3) return;
 	TestPrepareA<SSSE3::Kernels8>(64,64);
@@ -313,6 +377,7 @@ TEST_CASE("PrepareA SSSE3", "[Add127]") {
 	TestPrepareA<SSSE3::Kernels8>(512,512);
   TestPrepareA<SSSE3::Kernels8>(2048,256);
 }
+#endif
 
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 TEST_CASE("PrepareA AVX2", "[Add127]") {
@@ -336,6 +401,31 @@ TEST_CASE("PrepareA AVX512F", "[Add127]") {
 
 // Multiply
 
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+TEST_CASE ("Multiply NEON 8bit Shift with bias", "[Add127]") {
+  if (kCPU < CPUType::NEON) return;
+  TestMultiplyBiasNew<NEON::Kernels8>(1, 64, 8, 0.0001f, 0.05f, 0.03f, 0.001f);
+  TestMultiplyBiasNew<NEON::Kernels8>(8, 256, 256, 0.0001f, 0.22f, 0.06f, 0.001f);
+  TestMultiplyBiasNew<NEON::Kernels8>(8, 2048, 256, 0.0001f, 0.61f, 0.17f, 0.001f);
+  TestMultiplyBiasNew<NEON::Kernels8>(320, 256, 256, 0.0001f, 0.27f, 0.06f, 0.001f);
+  TestMultiplyBiasNew<NEON::Kernels8>(472, 256, 256, 0.0001f, 0.33f, 0.06f, 0.001f);
+  TestMultiplyBiasNew<NEON::Kernels8>(248, 256, 256, 0.0001f, 0.27f, 0.06f, 0.001f);
+  TestMultiplyBiasNew<NEON::Kernels8>(200, 256, 256, 0.0001f, 0.28f, 0.06f, 0.001f);
+}
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON_DOTPROD
+TEST_CASE ("Multiply NEONDOTPROD 8bit Shift with bias", "[Add127]") {
+  if (kCPU < CPUType::NEONDOTPROD) return;
+  TestMultiplyBiasNew<NEONDOTPROD::Kernels8>(1, 64, 8, 0.0001f, 0.05f, 0.03f, 0.001f);
+  TestMultiplyBiasNew<NEONDOTPROD::Kernels8>(8, 256, 256, 0.0001f, 0.22f, 0.06f, 0.001f);
+  TestMultiplyBiasNew<NEONDOTPROD::Kernels8>(8, 2048, 256, 0.0001f, 0.61f, 0.17f, 0.001f);
+  TestMultiplyBiasNew<NEONDOTPROD::Kernels8>(320, 256, 256, 0.0001f, 0.27f, 0.06f, 0.001f);
+  TestMultiplyBiasNew<NEONDOTPROD::Kernels8>(472, 256, 256, 0.0001f, 0.33f, 0.06f, 0.001f);
+  TestMultiplyBiasNew<NEONDOTPROD::Kernels8>(248, 256, 256, 0.0001f, 0.27f, 0.06f, 0.001f);
+  TestMultiplyBiasNew<NEONDOTPROD::Kernels8>(200, 256, 256, 0.0001f, 0.28f, 0.06f, 0.001f);
+}
+#endif
+#else
 TEST_CASE ("Multiply SSSE3 8bit Shift with bias", "[Add127]") {
   if (kCPU < CPUType::SSSE3) return;
   TestMultiplyBiasNew<SSSE3::Kernels8>(1, 64, 8, 0.11f, 0.1f, 0.06f, 0.05f);
@@ -347,6 +437,20 @@ TEST_CASE ("Multiply SSSE3 8bit Shift with bias", "[Add127]") {
   TestMultiplyBiasNew<SSSE3::Kernels8>(200, 256, 256, 0.55f, 0.74f, 0.17f, 0.16f);
 }
 
+#ifdef WASM
+TEST_CASE ("Multiply SIMD128 8bit Shift with bias", "[Add127]") {
+  if (kCPU < CPUType::SIMD128) return;
+  TestMultiplyBiasNew<SIMD128::Kernels8>(1, 64, 8, 0.0001f, 0.05f, 0.03f, 0.001f);
+  TestMultiplyBiasNew<SIMD128::Kernels8>(8, 256, 256, 0.0001f, 0.22f, 0.06f, 0.001f);
+  TestMultiplyBiasNew<SIMD128::Kernels8>(8, 2048, 256, 0.0001f, 0.61f, 0.17f, 0.001f);
+  TestMultiplyBiasNew<SIMD128::Kernels8>(320, 256, 256, 0.0001f, 0.27f, 0.06f, 0.001f);
+  TestMultiplyBiasNew<SIMD128::Kernels8>(472, 256, 256, 0.0001f, 0.33f, 0.06f, 0.001f);
+  TestMultiplyBiasNew<SIMD128::Kernels8>(248, 256, 256, 0.0001f, 0.27f, 0.06f, 0.001f);
+  TestMultiplyBiasNew<SIMD128::Kernels8>(200, 256, 256, 0.0001f, 0.28f, 0.06f, 0.001f);
+}
+#endif
+#endif
+
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 TEST_CASE ("Multiply AVX2 8bit Shift with bias", "[Add127]") {
   if (kCPU < CPUType::AVX2) return;
@@ -360,6 +464,19 @@ TEST_CASE ("Multiply AVX2 8bit Shift with bias", "[Add127]") {
 }
 #endif
 
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVXVNNI
+TEST_CASE ("Multiply AVXVNNI 8bit Shift with bias", "[Add127]") {
+  if (!AVXVNNIAvailable()) return;
+  TestMultiplyBiasNew<AVXVNNI::Kernels8>(1, 64, 8, 0.0001f, 0.05f, 0.03f, 0.001f);
+  TestMultiplyBiasNew<AVXVNNI::Kernels8>(8, 256, 256, 0.0001f, 0.22f, 0.06f, 0.001f);
+  TestMultiplyBiasNew<AVXVNNI::Kernels8>(8, 2048, 256, 0.0001f, 0.61f, 0.17f, 0.001f);
+  TestMultiplyBiasNew<AVXVNNI::Kernels8>(320, 256, 256, 0.0001f, 0.27f, 0.06f, 0.001f);
+  TestMultiplyBiasNew<AVXVNNI::Kernels8>(472, 256, 256, 0.0001f, 0.33f, 0.06f, 0.001f);
+  TestMultiplyBiasNew<AVXVNNI::Kernels8>(248, 256, 256, 0.0001f, 0.27f, 0.06f, 0.001f);
+  TestMultiplyBiasNew<AVXVNNI::Kernels8>(200, 256, 256, 0.0001f, 0.28f, 0.06f, 0.001f);
+}
+#endif
+
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
 TEST_CASE ("Multiply AVX512F 8bit Shift with bias", "[Add127]") {
   if (kCPU < CPUType::AVX512BW) return;
@@ -386,7 +503,45 @@ TEST_CASE ("Multiply AVX512F 8bit Shift with bias", "[Add127]") {
   }
 #endif
 
+#ifdef INTGEMM_COMPILER_SUPPORTS_AMX
+  TEST_CASE ("Multiply AMX 8bit Shift with bias", "[Add127]") {
+    if (kCPU < CPUType::AMX) return;
+    TestMultiplyBiasNew<AMX::Kernels8>(1, 64, 8, 0.0001f, 0.05f, 0.03f, 0.001f);
+    TestMultiplyBiasNew<AMX::Kernels8>(8, 256, 256, 0.0001f, 0.22f, 0.06f, 0.001f);
+    TestMultiplyBiasNew<AMX::Kernels8>(8, 2048, 256, 0.0001f, 0.61f, 0.17f, 0.001f);
+    TestMultiplyBiasNew<AMX::Kernels8>(320, 256, 256, 0.0001f, 0.27f, 0.06f, 0.001f);
+    TestMultiplyBiasNew<AMX::Kernels8>(472, 256, 256, 0.0001f, 0.33f, 0.06f, 0.001f);
+    TestMultiplyBiasNew<AMX::Kernels8>(248, 256, 256, 0.0001f, 0.27f, 0.06f, 0.001f);
+    TestMultiplyBiasNew<AMX::Kernels8>(200, 256, 256, 0.0001f, 0.28f, 0.06f, 0.001f);
+  }
+#endif
+
 //Multiply old vs new
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+TEST_CASE ("Multiply NEON 8bit Shift vs nonshift", "[Add127]") {
+  if (kCPU < CPUType::NEON) return;
+  TestMultiplyShiftNonShift<NEON::Kernels8>(1, 64, 8, 0.00001f, 0.05f, 0.03f, 0.00001f);
+  TestMultiplyShiftNonShift<NEON::Kernels8>(8, 256, 256, 0.00001f, 0.22f, 0.06f, 0.00001f);
+  TestMultiplyShiftNonShift<NEON::Kernels8>(8, 2048, 256, 0.0001f, 0.61f, 0.17f, 0.0001f);
+  TestMultiplyShiftNonShift<NEON::Kernels8>(320, 256, 256, 0.00001f, 0.27f, 0.06f, 0.00001f);
+  TestMultiplyShiftNonShift<NEON::Kernels8>(472, 256, 256, 0.00001f, 0.33f, 0.06f, 0.00001f);
+  TestMultiplyShiftNonShift<NEON::Kernels8>(248, 256, 256, 0.00001f, 0.27f, 0.06f, 0.00001f);
+  TestMultiplyShiftNonShift<NEON::Kernels8>(200, 256, 256, 0.00001f, 0.28f, 0.06f, 0.00001f);
+}
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON_DOTPROD
+TEST_CASE ("Multiply NEONDOTPROD 8bit Shift vs nonshift", "[Add127]") {
+  if (kCPU < CPUType::NEONDOTPROD) return;
+  TestMultiplyShiftNonShift<NEONDOTPROD::Kernels8>(1, 64, 8, 0.00001f, 0.05f, 0.03f, 0.00001f);
+  TestMultiplyShiftNonShift<NEONDOTPROD::Kernels8>(8, 256, 256, 0.00001f, 0.22f, 0.06f, 0.00001f);
+  TestMultiplyShiftNonShift<NEONDOTPROD::Kernels8>(8, 2048, 256, 0.0001f, 0.61f, 0.17f, 0.0001f);
+  TestMultiplyShiftNonShift<NEONDOTPROD::Kernels8>(320, 256, 256, 0.00001f, 0.27f, 0.06f, 0.00001f);
+  TestMultiplyShiftNonShift<NEONDOTPROD::Kernels8>(472, 256, 256, 0.00001f, 0.33f, 0.06f, 0.00001f);
+  TestMultiplyShiftNonShift<NEONDOTPROD::Kernels8>(248, 256, 256, 0.00001f, 0.27f, 0.06f, 0.00001f);
+  TestMultiplyShiftNonShift<NEONDOTPROD::Kernels8>(200, 256, 256, 0.00001f, 0.28f, 0.06f, 0.00001f);
+}
+#endif
+#else
 TEST_CASE ("Multiply SSSE3 8bit Shift vs nonshift", "[Add127]") {
   if (kCPU < CPUType::SSSE3) return;
   TestMultiplyShiftNonShift<SSSE3::Kernels8>(1, 64, 8, 0.00001f, 0.1f, 0.06f, 0.00001f);
@@ -398,6 +553,20 @@ TEST_CASE ("Multiply SSSE3 8bit Shift vs nonshift", "[Add127]") {
   TestMultiplyShiftNonShift<SSSE3::Kernels8>(200, 256, 256, 1, 0.74f, 0.17f, 0.006f);
 }
 
+#ifdef WASM
+TEST_CASE ("Multiply SIMD128 8bit Shift vs nonshift", "[Add127]") {
+  if (kCPU < CPUType::SIMD128) return;
+  TestMultiplyShiftNonShift<SIMD128::Kernels8>(1, 64, 8, 0.00001f, 0.05f, 0.03f, 0.00001f);
+  TestMultiplyShiftNonShift<SIMD128::Kernels8>(8, 256, 256, 0.00001f, 0.22f, 0.06f, 0.00001f);
+  TestMultiplyShiftNonShift<SIMD128::Kernels8>(8, 2048, 256, 0.0001f, 0.61f, 0.17f, 0.0001f);
+  TestMultiplyShiftNonShift<SIMD128::Kernels8>(320, 256, 256, 0.00001f, 0.27f, 0.06f, 0.00001f);
+  TestMultiplyShiftNonShift<SIMD128::Kernels8>(472, 256, 256, 0.00001f, 0.33f, 0.06f, 0.00001f);
+  TestMultiplyShiftNonShift<SIMD128::Kernels8>(248, 256, 256, 0.00001f, 0.27f, 0.06f, 0.00001f);
+  TestMultiplyShiftNonShift<SIMD128::Kernels8>(200, 256, 256, 0.00001f, 0.28f, 0.06f, 0.00001f);
+}
+#endif
+#endif
+
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 TEST_CASE ("Multiply AVX2 8bit Shift vs nonshift", "[Add127]") {
   if (kCPU < CPUType::AVX2) return;
@@ -411,6 +580,19 @@ TEST_CASE ("Multiply AVX2 8bit Shift vs nonshift", "[Add127]") {
 }
 #endif
 
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVXVNNI
+TEST_CASE ("Multiply AVXVNNI 8bit Shift vs nonshift", "[Add127]") {
+  if (!AVXVNNIAvailable()) return;
+  TestMultiplyShiftNonShift<AVXVNNI::Kernels8>(1, 64, 8, 0.00001f, 0.05f, 0.03f, 0.00001f);
+  TestMultiplyShiftNonShift<AVXVNNI::Kernels8>(8, 256, 256, 0.00001f, 0.22f, 0.06f, 0.00001f);
+  TestMultiplyShiftNonShift<AVXVNNI::Kernels8>(8, 2048, 256, 0.0001f, 0.61f, 0.17f, 0.0001f);
+  TestMultiplyShiftNonShift<AVXVNNI::Kernels8>(320, 256, 256, 0.00001f, 0.27f, 0.06f, 0.00001f);
+  TestMultiplyShiftNonShift<AVXVNNI::Kernels8>(472, 256, 256, 0.00001f, 0.33f, 0.06f, 0.00001f);
+  TestMultiplyShiftNonShift<AVXVNNI::Kernels8>(248, 256, 256, 0.00001f, 0.27f, 0.06f, 0.00001f);
+  TestMultiplyShiftNonShift<AVXVNNI::Kernels8>(200, 256, 256, 0.00001f, 0.28f, 0.06f, 0.00001f);
+}
+#endif
+
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
 TEST_CASE ("Multiply AVX512F 8bit Shift vs nonshift", "[Add127]") {
   if (kCPU < CPUType::AVX512BW) return;
@@ -437,7 +619,45 @@ TEST_CASE ("Multiply AVX512F 8bit Shift vs nonshift", "[Add127]") {
   }
 #endif
 
+#ifdef INTGEMM_COMPILER_SUPPORTS_AMX
+  TEST_CASE ("Multiply AMX 8bit Shift vs nonshift", "[Add127]") {
+    if (kCPU < CPUType::AMX) return;
+    TestMultiplyShiftNonShift<AMX::Kernels8>(1, 64, 8, 0.00001f, 0.05f, 0.03f, 0.00001f);
+    TestMultiplyShiftNonShift<AMX::Kernels8>(8, 256, 256, 0.00001f, 0.22f, 0.06f, 0.00001f);
+    TestMultiplyShiftNonShift<AMX::Kernels8>(8, 2048, 256, 0.0001f, 0.61f, 0.17f, 0.0001f);
+    TestMultiplyShiftNonShift<AMX::Kernels8>(320, 256, 256, 0.00001f, 0.27f, 0.06f, 0.00001f);
+    TestMultiplyShiftNonShift<AMX::Kernels8>(472, 256, 256, 0.00001f, 0.33f, 0.06f, 0.00001f);
+    TestMultiplyShiftNonShift<AMX::Kernels8>(248, 256, 256, 0.00001f, 0.27f, 0.06f, 0.00001f);
+    TestMultiplyShiftNonShift<AMX::Kernels8>(200, 256, 256, 0.00001f, 0.28f, 0.06f, 0.00001f);
+  }
+#endif
+
 //Multiply Shift vs int shift implementation
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+TEST_CASE ("Multiply NEON 8bit Shift vs Int", "[Add127]") {
+  if (kCPU < CPUType::NEON) return;
+  TestMultiplyShiftInt<NEON::Kernels8>(1, 64, 8, 0.0001f, 0.05f, 0.03f, 0.0001f);
+  TestMultiplyShiftInt<NEON::Kernels8>(8, 256, 256, 0.0001f, 0.22f, 0.06f, 0.0001f);
+  TestMultiplyShiftInt<NEON::Kernels8>(8, 2048, 256, 0.0001f, 0.61f, 0.17f, 0.0001f);
+  TestMultiplyShiftInt<NEON::Kernels8>(320, 256, 256, 0.0001f, 0.27f, 0.06f, 0.0001f);
+  TestMultiplyShiftInt<NEON::Kernels8>(472, 256, 256, 0.0001f, 0.33f, 0.06f, 0.0001f);
+  TestMultiplyShiftInt<NEON::Kernels8>(248, 256, 256, 0.0001f, 0.27f, 0.06f, 0.0001f);
+  TestMultiplyShiftInt<NEON::Kernels8>(200, 256, 256, 0.0001f, 0.28f, 0.06f, 0.0001f);
+}
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON_DOTPROD
+TEST_CASE ("Multiply NEONDOTPROD 8bit Shift vs Int", "[Add127]") {
+  if (kCPU < CPUType::NEONDOTPROD) return;
+  TestMultiplyShiftInt<NEONDOTPROD::Kernels8>(1, 64, 8, 0.0001f, 0.05f, 0.03f, 0.0001f);
+  TestMultiplyShiftInt<NEONDOTPROD::Kernels8>(8, 256, 256, 0.0001f, 0.22f, 0.06f, 0.0001f);
+  TestMultiplyShiftInt<NEONDOTPROD::Kernels8>(8, 2048, 256, 0.0001f, 0.61f, 0.17f, 0.0001f);
+  TestMultiplyShiftInt<NEONDOTPROD::Kernels8>(320, 256, 256, 0.0001f, 0.27f, 0.06f, 0.0001f);
+  TestMultiplyShiftInt<NEONDOTPROD::Kernels8>(472, 256, 256, 0.0001f, 0.33f, 0.06f, 0.0001f);
+  TestMultiplyShiftInt<NEONDOTPROD::Kernels8>(248, 256, 256, 0.0001f, 0.27f, 0.06f, 0.0001f);
+  TestMultiplyShiftInt<NEONDOTPROD::Kernels8>(200, 256, 256, 0.0001f, 0.28f, 0.06f, 0.0001f);
+}
+#endif
+#else
 TEST_CASE ("Multiply SSSE3 8bit Shift vs Int", "[Add127]") {
   if (kCPU < CPUType::SSSE3) return;
   TestMultiplyShiftInt<SSSE3::Kernels8>(1, 64, 8, 0.0001f, 0.1f, 0.06f, 0.0001f);
@@ -449,6 +669,20 @@ TEST_CASE ("Multiply SSSE3 8bit Shift vs Int", "[Add127]") {
   TestMultiplyShiftInt<SSSE3::Kernels8>(200, 256, 256, 0.0001f, 0.74f, 0.17f, 0.0001f);
 }
 
+#ifdef WASM
+TEST_CASE ("Multiply SIMD128 8bit Shift vs Int", "[Add127]") {
+  if (kCPU < CPUType::SIMD128) return;
+  TestMultiplyShiftInt<SIMD128::Kernels8>(1, 64, 8, 0.0001f, 0.05f, 0.03f, 0.0001f);
+  TestMultiplyShiftInt<SIMD128::Kernels8>(8, 256, 256, 0.0001f, 0.22f, 0.06f, 0.0001f);
+  TestMultiplyShiftInt<SIMD128::Kernels8>(8, 2048, 256, 0.0001f, 0.61f, 0.17f, 0.0001f);
+  TestMultiplyShiftInt<SIMD128::Kernels8>(320, 256, 256, 0.0001f, 0.27f, 0.06f, 0.0001f);
+  TestMultiplyShiftInt<SIMD128::Kernels8>(472, 256, 256, 0.0001f, 0.33f, 0.06f, 0.0001f);
+  TestMultiplyShiftInt<SIMD128::Kernels8>(248, 256, 256, 0.0001f, 0.27f, 0.06f, 0.0001f);
+  TestMultiplyShiftInt<SIMD128::Kernels8>(200, 256, 256, 0.0001f, 0.28f, 0.06f, 0.0001f);
+}
+#endif
+#endif
+
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 TEST_CASE ("Multiply AVX2 8bit Shift vs Int", "[Add127]") {
   if (kCPU < CPUType::AVX2) return;
@@ -0,0 +1,126 @@
+#include "test.h"
+#include "../intgemm/aligned.h"
+#include "../intgemm/autotune.h"
+#include "../intgemm/callbacks.h"
+#include "../intgemm/intgemm.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace intgemm {
+namespace {
+
+TEST_CASE("Tuned multiply matches Multiply", "[autotune]") {
+  if (kCPU < CPUType::SSSE3) return;
+  const TuneShape shapes[] = {{1, 64, 8}, {5, 256, 64}, {33, 128, 16}};
+  for (const TuneShape &shape : shapes) {
+    RandomMultiply<Int8> data(shape.A_rows, shape.width, shape.B_cols);
+    const AlignedVector<int8_t> &A_prep = data.A_prep, &B_prep = data.B_prep;
+    AlignedVector<float> expected(shape.A_rows * shape.B_cols), actual(shape.A_rows * shape.B_cols);
+    const float unquant_mult = data.unquant_mult;
+    Int8::Multiply(A_prep.begin(), B_prep.begin(), shape.A_rows, shape.width, shape.B_cols, callbacks::UnquantizeAndWrite(unquant_mult, expected.begin()));
+    Int8::MultiplyTuned(A_prep.begin(), B_prep.begin(), shape.A_rows, shape.width, shape.B_cols, callbacks::UnquantizeAndWrite(unquant_mult, actual.begin()));
+    CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(float)));
+
+    TuneChoice choice;
+    REQUIRE(TuneCache::Global().Find("Int8", shape, choice));
+    CHECK(choice.cpu == kCPU);
+    TuneChoice again = Int8::Tune(shape.A_rows, shape.width, shape.B_cols);
+    CHECK(again.cpu == choice.cpu);
+    CHECK(again.rows == choice.rows);
+
+    std::fill(actual.begin(), actual.end(), 0.0f);
+    auto function = Int8::MultiplyTunedFunction<callbacks::UnquantizeAndWrite>(shape.A_rows, shape.width, shape.B_cols);
+    function(A_prep.begin(), B_prep.begin(), shape.A_rows, shape.width, shape.B_cols, callbacks::UnquantizeAndWrite(unquant_mult, actual.begin()));
+    CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(float)));
+  }
+}
+
+TEST_CASE("Tuned multiply matches Multiply when products saturate", "[autotune]") {
+  if (kCPU < CPUType::SSSE3) return;
+  const TuneShape shape = {4, 256, 16};
+  // Quantizes to 127 everywhere, so 16-bit sums of pairs of products saturate.
+  AlignedVector<float> A(shape.A_rows * shape.width), B(shape.width * shape.B_cols);
+  std::fill(A.begin(), A.end(), 1.0f);
+  std::fill(B.begin(), B.end(), 1.0f);
+  AlignedVector<int8_t> A_prep(A.size()), B_prep(B.size());
+  Int8::PrepareA(A.begin(), A_prep.begin(), 127.0f, shape.A_rows, shape.width);
+  Int8::PrepareB(B.begin(), B_prep.begin(), 127.0f, shape.width, shape.B_cols);
+  AlignedVector<int32_t> expected(shape.A_rows * shape.B_cols), actual(shape.A_rows * shape.B_cols);
+  Int8::Multiply(A_prep.begin(), B_prep.begin(), shape.A_rows, shape.width, shape.B_cols, callbacks::Write<int32_t>(expected.begin()));
+
+  auto check = [&]() {
+    std::fill(actual.begin(), actual.end(), 0);
+    Int8::MultiplyTuned(A_prep.begin(), B_prep.begin(), shape.A_rows, shape.width, shape.B_cols, callbacks::Write<int32_t>(actual.begin()));
+    return !std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(int32_t));
+  };
+
+  // Every blocking of Multiply's kernel gives the same C.
+  TuneCache::Global().Clear();
+  CHECK(Int8::Tune(shape.A_rows, shape.width, shape.B_cols).cpu == kCPU);
+  CHECK(check());
+  if (kCPU != CPUType::AMX) {
+    for (Index rows : {1, 2, 4}) {
+      INFO("rows " << rows);
+      TuneCache::Global().Insert("Int8", shape, TuneChoice{kCPU, rows});
+      CHECK(check());
+    }
+  }
+
+  // A choice of another kernel, e.g. from a tuning file, is only taken when
+  // tuning across kernels, and then C differs.
+  if (kCPU == CPUType::AVX512VNNI) {
+    REQUIRE(Int8::CountSaturated(A_prep.begin(), B_prep.begin(), shape.A_rows, shape.width, shape.B_cols, CPUType::AVX512BW) > 0);
+    TuneCache::Global().Insert("Int8", shape, TuneChoice{CPUType::AVX512BW, 1});
+    CHECK(Int8::Tune(shape.A_rows, shape.width, shape.B_cols).cpu == kCPU);
+    CHECK(check());
+    SetTuneAcrossKernels(true);
+    TuneCache::Global().Insert("Int8", shape, TuneChoice{CPUType::AVX512BW, 1});
+    CHECK(Int8::Tune(shape.A_rows, shape.width, shape.B_cols).cpu == CPUType::AVX512BW);
+    CHECK(!check());
+    SetTuneAcrossKernels(false);
+  }
+  TuneCache::Global().Clear();
+}
+
+TEST_CASE("TuneCache saves and loads", "[autotune]") {
+  const std::string path = "autotune_test.tuning";
+  std::remove(path.c_str());
+  {
+    TuneCache cache(path);
+    CHECK(cache.Size() == 0);
+    cache.Insert("Int8", TuneShape{4, 512, 256}, TuneChoice{kCPU, 2});
+    cache.Insert("Int8", TuneShape{1, 64, 8}, TuneChoice{kCPU, 1});
+  }
+  // Appended as they were inserted.
+  TuneCache loaded(path);
+  CHECK(loaded.Size() == 2);
+  TuneChoice choice;
+  REQUIRE(loaded.Find("Int8", TuneShape{4, 512, 256}, choice));
+  CHECK(choice.cpu == kCPU);
+  CHECK(choice.rows == 2);
+  CHECK(!loaded.Find("Int8", TuneShape{4, 512, 248}, choice));
+  CHECK(!loaded.Find("Int16", TuneShape{1, 64, 8}, choice));
+
+  // Save rewrites the file; lines tuned on another tier are skipped.
+  REQUIRE(loaded.Save(path.c_str()));
+  {
+    std::ofstream out(path.c_str(), std::ios::app);
+    out << "Int8 " << (static_cast<int>(kCPU) + 1) << " 8 64 8 " << static_cast<int>(kCPU) << " 4\n";
+    out << "garbage\n";
+  }
+  TuneCache reloaded;
+  REQUIRE(reloaded.Load(path.c_str()));
+  CHECK(reloaded.Size() == 2);
+  CHECK(!reloaded.Find("Int8", TuneShape{8, 64, 8}, choice));
+  reloaded.Clear();
+  CHECK(reloaded.Size() == 0);
+  CHECK(!reloaded.Load("autotune_test.missing"));
+  std::remove(path.c_str());
+}
+
+} // namespace
+} // namespace intgemm
@@ -0,0 +1,148 @@
+#include "test.h"
+#include "../intgemm/aligned.h"
+#include "../intgemm/calibrate.h"
+#include "../intgemm/intgemm.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace intgemm {
+namespace {
+
+TEST_CASE("Histogram bins", "[calibrate]") {
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> mantissa(1.0f, 2.0f);
+  std::uniform_int_distribution<int> exponent(kHistogramMinExponent, kHistogramMaxExponent - 1);
+  for (int i = 0; i < 10000; ++i) {
+    const float value = std::ldexp(mantissa(gen), exponent(gen)) * (i & 1 ? -1.0f : 1.0f);
+    const Index bin = HistogramBin(value);
+    REQUIRE(bin < kHistogramBins);
+    CHECK(AbsHistogram::Edge(bin) <= std::fabs(value));
+    CHECK(std::fabs(value) < AbsHistogram::Edge(bin + 1));
+  }
+  CHECK(HistogramBin(0.0f) == 0);
+  CHECK(HistogramBin(-0.0f) == 0);
+  CHECK(HistogramBin(1e-30f) == 0);
+  CHECK(HistogramBin(1e30f) == kHistogramBins - 1);
+  CHECK(HistogramBin(-std::numeric_limits<float>::infinity()) == kHistogramBins - 1);
+  CHECK(HistogramBin(std::numeric_limits<float>::quiet_NaN()) == kHistogramBins - 1);
+  CHECK(HistogramBin(1.0f) == static_cast<Index>(-kHistogramMinExponent) << kHistogramMantissaBits);
+}
+
+void CompareHistogram(void (*Backend)(const float *, const float *, uint64_t *), const float *begin, const float *end) {
+  std::vector<uint64_t> expected(kHistogramBins), test(kHistogramBins, 1);
+  for (const float *i = begin; i < end; ++i) {
+    ++expected[HistogramBin(*i)];
+  }
+  for (uint64_t &e : expected) ++e;
+  Backend(begin, end, test.data());
+  CHECK_MESSAGE(test == expected, "length " << (end - begin));
+}
+
+template <void (*Backend)(const float *, const float *, uint64_t *)> void TestHistogramAbsolute() {
+  std::mt19937 gen;
+  std::normal_distribution<float> dist(0.0f, 4.0f);
+  AlignedVector<float> test(200003);
+  for (auto &it : test) it = dist(gen);
+  test[1] = 0.0f;
+  test[2] = std::numeric_limits<float>::quiet_NaN();
+  test[3] = -std::numeric_limits<float>::infinity();
+  test[5] = 1e-30f;
+  for (std::size_t offset = 0; offset < 4; ++offset) {
+    for (std::size_t len = 0; len < 70; ++len) {
+      CompareHistogram(Backend, test.begin() + offset, test.begin() + offset + len);
+    }
+  }
+  // Long enough to split over threads.
+  CompareHistogram(Backend, test.begin() + 1, test.end());
+}
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+TEST_CASE("HistogramAbsolute NEON", "[calibrate]") {
+  if (kCPU < CPUType::NEON) return;
+  TestHistogramAbsolute<NEON::HistogramAbsolute>();
+}
+#else
+TEST_CASE("HistogramAbsolute SSE2", "[calibrate]") {
+  if (kCPU < CPUType::SSE2) return;
+  TestHistogramAbsolute<SSE2::HistogramAbsolute>();
+}
+#endif
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
+TEST_CASE("HistogramAbsolute AVX2", "[calibrate]") {
+  if (kCPU < CPUType::AVX2) return;
+  TestHistogramAbsolute<AVX2::HistogramAbsolute>();
+}
+#endif
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+TEST_CASE("HistogramAbsolute AVX512BW", "[calibrate]") {
+  if (kCPU < CPUType::AVX512BW) return;
+  TestHistogramAbsolute<AVX512BW::HistogramAbsolute>();
+}
+#endif
+
+TEST_CASE("AbsHistogram merge and percentile", "[calibrate]") {
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::vector<float> values(100000);
+  for (float &v : values) v = dist(gen);
+  AbsHistogram whole, first, second;
+  whole.Add(values.data(), values.data() + values.size());
+  first.Add(values.data(), values.data() + 30001);
+  second.Add(values.data() + 30001, values.data() + values.size());
+  first += second;
+  CHECK(first.Total() == values.size());
+  CHECK(first.Counts() == whole.Counts());
+
+  CHECK(whole.Percentile(0.5) == Approx(0.5f).epsilon(0.01));
+  CHECK(whole.Percentile(0.9) == Approx(0.9f).epsilon(0.01));
+  CHECK(whole.Percentile(1.0) >= 0.9999f);
+  CHECK(whole.Percentile(1.0) <= 1.04f);
+  CHECK(AbsHistogram().Percentile(0.5) == 0.0f);
+}
+
+// Mean squared error of quantizing and unquantizing values with quant_mult.
+double QuantizationError(const std::vector<float> &values, float quant_mult) {
+  double error = 0.0;
+  for (float v : values) {
+    const float quantized = std::max(-127.0f, std::min(127.0f, std::nearbyint(v * quant_mult)));
+    const double diff = quantized / quant_mult - v;
+    error += diff * diff;
+  }
+  return error / values.size();
+}
+
+TEST_CASE("AbsHistogram thresholds", "[calibrate]") {
+  std::mt19937 gen;
+  std::normal_distribution<float> dist(0.0f, 1.0f);
+  std::vector<float> values(200000);
+  for (float &v : values) v = dist(gen);
+  // Outliers that waste most of the range of 127 / MaxAbsolute.
+  values[10] = 100.0f;
+  values[20] = -80.0f;
+  AbsHistogram histogram;
+  histogram.Add(values.data(), values.data() + values.size());
+
+  // MSEThreshold keeps the outliers, but closer than MaxAbsolute does: the
+  // sweep below has the same minimum.
+  const float mse = histogram.MSEThreshold();
+  const double mse_error = QuantizationError(values, AbsHistogram::QuantMult(mse));
+  CHECK(mse < 100.0f);
+  for (float threshold = 1.0f; threshold <= 128.0f; threshold *= 1.125f) {
+    CHECK(mse_error <= QuantizationError(values, AbsHistogram::QuantMult(threshold)) * 1.01);
+  }
+  // KL clips them, so most values keep their precision.
+  const float kl = histogram.KLThreshold();
+  CHECK(kl > 2.5f);
+  CHECK(kl < 10.0f);
+  const std::vector<float> inliers(values.begin() + 21, values.end());
+  CHECK(QuantizationError(inliers, AbsHistogram::QuantMult(kl)) < QuantizationError(inliers, 127.0f / 100.0f) / 100);
+}
+
+} // namespace
+} // namespace intgemm
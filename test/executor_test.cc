@@ -0,0 +1,204 @@
+#include "test.h"
+#include "../intgemm/aligned.h"
+#include "../intgemm/callbacks.h"
+#include "../intgemm/executor.h"
+#include "../intgemm/intgemm.h"
+#include "../intgemm/partition.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace intgemm {
+namespace {
+
+void CheckCovers(Executor &executor, Index count) {
+  std::vector<int> hits(count, 0);
+  executor.ParallelFor(count, [&](Index begin, Index end) {
+    CHECK(begin < end);
+    CHECK(end <= count);
+    for (Index i = begin; i < end; ++i) ++hits[i];
+  });
+  for (Index i = 0; i < count; ++i) {
+    CHECK(hits[i] == 1);
+  }
+}
+
+TEST_CASE("ThreadPool covers range", "[executor]") {
+  ThreadPool pool(4);
+  CHECK(pool.Threads() == 4);
+  CheckCovers(pool, 0);
+  CheckCovers(pool, 1);
+  CheckCovers(pool, 3);
+  // Back to back calls catch workers that miss or repeat a generation.
+  for (int i = 0; i < 200; ++i) {
+    CheckCovers(pool, 97);
+  }
+}
+
+TEST_CASE("ThreadPool dynamic schedule covers range", "[executor]") {
+  const Schedule before = GetSchedule();
+  SetSchedule(Schedule::Dynamic);
+  ThreadPool pool(4);
+  CheckCovers(pool, 1);
+  CheckCovers(pool, 3);
+  for (int i = 0; i < 200; ++i) {
+    CheckCovers(pool, 97);
+  }
+  SetSchedule(before);
+}
+
+TEST_CASE("ThreadPool single thread", "[executor]") {
+  ThreadPool pool(1, std::vector<int>{0});
+  CHECK(pool.Threads() == 1);
+  CheckCovers(pool, 10);
+}
+
+TEST_CASE("FunctionExecutor", "[executor]") {
+  Index calls = 0;
+  // Stand-in for an application's parallel_for: two halves, serially.
+  FunctionExecutor executor([&](Index count, const Executor::Task &task) {
+    ++calls;
+    task(0, count / 2);
+    task(count / 2, count);
+  }, 2);
+  CHECK(executor.Threads() == 2);
+  CheckCovers(executor, 16);
+  CHECK(calls == 1);
+}
+
+TEST_CASE("AsyncPool covers range", "[executor]") {
+  AsyncPool pool(3);
+  CHECK(pool.Threads() == 3);
+  CheckCovers(pool, 0);
+  CheckCovers(pool, 1);
+  for (int i = 0; i < 200; ++i) {
+    CheckCovers(pool, 97);
+  }
+  // From several threads at once.
+  std::vector<std::thread> callers;
+  for (int t = 0; t < 4; ++t) {
+    callers.emplace_back([&pool] {
+      for (int i = 0; i < 50; ++i) {
+        std::vector<std::atomic<int> > hits(31);
+        for (auto &hit : hits) hit = 0;
+        pool.ParallelFor(31, [&hits](Index begin, Index end) {
+          for (Index j = begin; j < end; ++j) ++hits[j];
+        });
+        for (auto &hit : hits) {
+          if (hit != 1) CHECK(hit == 1);
+        }
+      }
+    });
+  }
+  for (std::thread &caller : callers) caller.join();
+}
+
+TEST_CASE("AsyncPool submit", "[executor]") {
+  AsyncPool pool(2);
+  std::atomic<int> done(0);
+  std::vector<std::atomic<int> > hits(1000);
+  for (auto &hit : hits) hit = 0;
+  std::vector<AsyncPool::Handle> handles;
+  for (Index i = 0; i < 10; ++i) {
+    handles.push_back(pool.Submit(100, [&hits, i](Index begin, Index end) {
+      for (Index j = begin; j < end; ++j) ++hits[i * 100 + j];
+    }, [&done] { ++done; }));
+  }
+  for (const AsyncPool::Handle &handle : handles) {
+    handle.Wait();
+    CHECK(handle.Ready());
+  }
+  CHECK(done == 10);
+  for (auto &hit : hits) CHECK(hit == 1);
+  CHECK(AsyncPool::Handle().Ready());
+  CHECK(pool.Submit(0, [](Index, Index) {}, [&done] { ++done; }).Ready());
+  CHECK(done == 11);
+}
+
+TEST_CASE("AsyncPool nested on one thread", "[executor]") {
+  // Work on the only thread waits for a ParallelFor it submits, so it has to
+  // run the tasks itself.
+  AsyncPool pool(1);
+  Index sum = 0;
+  pool.Submit([&] {
+    pool.ParallelFor(10, [&](Index begin, Index end) {
+      for (Index i = begin; i < end; ++i) sum += i;
+    });
+  }).Wait();
+  CHECK(sum == 45);
+}
+
+template <class Routine> void TestExecutorMultiply(Index A_rows, Index width, Index B_cols) {
+  using Integer = typename Routine::Integer;
+  RandomMultiply<Routine> data(A_rows, width, B_cols, (sizeof(Integer) == 2) ? 1024.0f : 64.0f);
+  const float unquant_mult = data.unquant_mult;
+
+  AlignedVector<float> expected(A_rows * B_cols), actual(A_rows * B_cols);
+  Routine::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(unquant_mult, expected.begin()));
+  ThreadPool pool(3);
+  Routine::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(unquant_mult, actual.begin()), pool);
+  // Same kernel, same per-tile arithmetic: results are identical.
+  CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(float)));
+
+  // So is any schedule, with OpenMP or the pool.
+  const Schedule before = GetSchedule();
+  SetSchedule(Schedule::Dynamic);
+  std::fill(actual.begin(), actual.end(), 0.0f);
+  Routine::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(unquant_mult, actual.begin()));
+  CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(float)));
+  std::fill(actual.begin(), actual.end(), 0.0f);
+  Routine::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(unquant_mult, actual.begin()), pool);
+  CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(float)));
+  SetSchedule(before);
+}
+
+TEST_CASE("Multiply asynchronously", "[executor]") {
+  if (kCPU < CPUType::SSSE3) return;
+  const Index kCount = 6, A_rows = 40, width = 256, B_cols = 200;
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::vector<AlignedVector<int8_t> > A_prep, B_prep;
+  std::vector<AlignedVector<float> > expected, actual;
+  for (Index i = 0; i < kCount; ++i) {
+    AlignedVector<float> A(A_rows * width), B(width * B_cols);
+    for (auto &it : A) it = dist(gen);
+    for (auto &it : B) it = dist(gen);
+    A_prep.emplace_back(A.size());
+    B_prep.emplace_back(B.size());
+    Int8::PrepareA(A.begin(), A_prep.back().begin(), 64.0f, A_rows, width);
+    Int8::PrepareB(B.begin(), B_prep.back().begin(), 64.0f, width, B_cols);
+    expected.emplace_back(A_rows * B_cols);
+    actual.emplace_back(A_rows * B_cols);
+    Int8::Multiply(A_prep.back().begin(), B_prep.back().begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(1.0f / 4096.0f, expected.back().begin()));
+  }
+  AsyncPool pool(3);
+  std::atomic<int> done(0);
+  std::vector<AsyncPool::Handle> handles;
+  for (Index i = 0; i < kCount; ++i) {
+    handles.push_back(Int8::MultiplyAsync(A_prep[i].begin(), B_prep[i].begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(1.0f / 4096.0f, actual[i].begin()), pool, [&done] { ++done; }));
+  }
+  for (Index i = 0; i < kCount; ++i) {
+    handles[i].Wait();
+    CHECK(!std::memcmp(expected[i].begin(), actual[i].begin(), expected[i].size() * sizeof(float)));
+  }
+  CHECK(done == kCount);
+}
+
+TEST_CASE("Multiply with Executor", "[executor]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestExecutorMultiply<Int8>(1, 64, 8);
+  TestExecutorMultiply<Int8>(40, 256, 200);
+  TestExecutorMultiply<Int8Shift>(40, 256, 200);
+  TestExecutorMultiply<Int16>(40, 256, 200);
+  // Narrow B so the pool splits rows of A as well.
+  TestExecutorMultiply<Int8>(300, 256, 16);
+  TestExecutorMultiply<Int8Shift>(300, 256, 16);
+  TestExecutorMultiply<Int16>(300, 256, 16);
+}
+
+} // namespace
+} // namespace intgemm
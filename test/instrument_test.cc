@@ -0,0 +1,148 @@
+#include "test.h"
+#include "../intgemm/aligned.h"
+#include "../intgemm/callbacks.h"
+#include "../intgemm/executor.h"
+#include "../intgemm/instrument.h"
+#include "../intgemm/intgemm.h"
+
+#include <cstring>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace intgemm {
+namespace {
+
+// Records of thread, or of every thread for thread < 0.
+std::vector<CallRecord> RecordsOf(long thread) {
+  std::vector<CallRecord> ret;
+  for (const CallRecord &r : InstrumentRecords()) {
+    if (thread < 0 || r.thread == static_cast<uint32_t>(thread)) ret.push_back(r);
+  }
+  return ret;
+}
+
+// The thread number InstrumentScope gives the calling thread.
+long ThisThread() {
+  ClearInstrumentRecords();
+  { InstrumentScope scope(Event::Multiply, "probe", "test", 0, 0, 0, NextInstrumentCall()); }
+  return static_cast<long>(InstrumentRecords().back().thread);
+}
+
+TEST_CASE("InstrumentScope records", "[instrument]") {
+  const long thread = ThisThread();
+  ClearInstrumentRecords();
+  CHECK(RecordsOf(thread).empty());
+  const uint64_t call = NextInstrumentCall();
+  { InstrumentScope scope(Event::PrepareB, "first", "backend", 3, 4, 5, call); }
+  { InstrumentScope scope(Event::Quantize, "second", "backend", 6, 0, 0, call + 1); }
+  std::vector<CallRecord> records = RecordsOf(thread);
+  REQUIRE(records.size() == 2);
+  CHECK(records[0].event == Event::PrepareB);
+  CHECK(!strcmp(records[0].name, "first"));
+  CHECK(!strcmp(records[0].backend, "backend"));
+  CHECK(records[0].dims[0] == 3);
+  CHECK(records[0].dims[1] == 4);
+  CHECK(records[0].dims[2] == 5);
+  CHECK(records[0].call == call);
+  CHECK(records[1].call == call + 1);
+  CHECK(records[0].begin_ns + records[0].duration_ns <= records[1].begin_ns);
+
+  // Another thread gets its own ring and number, and its records outlive it.
+  std::thread other([call] {
+    InstrumentScope scope(Event::Multiply, "other", "backend", 1, 2, 3, call);
+  });
+  other.join();
+  records = RecordsOf(-1);
+  REQUIRE(records.size() == 3);
+  std::set<uint32_t> threads;
+  for (const CallRecord &r : records) threads.insert(r.thread);
+  CHECK(threads.size() == 2);
+
+  std::stringstream csv;
+  WriteInstrumentCSV(csv);
+  std::string line;
+  std::size_t lines = 0;
+  while (std::getline(csv, line)) ++lines;
+  CHECK(lines == 4);
+}
+
+TEST_CASE("Instrument ring keeps the newest", "[instrument]") {
+  const long thread = ThisThread();
+  ClearInstrumentRecords();
+  const uint64_t first = NextInstrumentCall();
+  for (std::size_t i = 0; i < kInstrumentRingSize + 10; ++i) {
+    InstrumentScope scope(Event::Quantize, "loop", "test", static_cast<Index>(i), 0, 0, first + i);
+  }
+  const std::vector<CallRecord> records = RecordsOf(thread);
+  REQUIRE(records.size() == kInstrumentRingSize);
+  for (std::size_t i = 0; i < records.size(); ++i) {
+    CHECK(records[i].dims[0] == i + 10);
+  }
+}
+
+void Recorded(float *out, Index rows, float scale, Index cols) {
+  *out = rows * scale + cols;
+}
+
+TEST_CASE("InstrumentedDispatch records Index arguments", "[instrument]") {
+  const long thread = ThisThread();
+  ClearInstrumentRecords();
+  static const char *const kBackend = "test";
+  void (*wrapped)(float *, Index, float, Index) = InstrumentedDispatch<0, void (*)(float *, Index, float, Index)>::Wrap(Event::PrepareB, "Recorded", &kBackend, &Recorded);
+  float out;
+  wrapped(&out, 3, 2.0f, 4);
+  CHECK(out == 10.0f);
+  const std::vector<CallRecord> records = RecordsOf(thread);
+  REQUIRE(records.size() == 1);
+  CHECK(records[0].event == Event::PrepareB);
+  CHECK(!strcmp(records[0].name, "Recorded"));
+  CHECK(!strcmp(records[0].backend, "test"));
+  CHECK(records[0].dims[0] == 3);
+  CHECK(records[0].dims[1] == 4);
+  CHECK(records[0].dims[2] == 0);
+}
+
+TEST_CASE("Instrumented multiply", "[instrument]") {
+  if (kCPU < CPUType::SSSE3 || !InstrumentCompiled()) return;
+  const Index A_rows = 8, width = 128, B_cols = 64;
+  AlignedVector<float> A(A_rows * width), B(width * B_cols), C(A_rows * B_cols);
+  for (std::size_t i = 0; i < A.size(); ++i) A[i] = static_cast<float>(i % 7) - 3.0f;
+  for (std::size_t i = 0; i < B.size(); ++i) B[i] = static_cast<float>(i % 5) - 2.0f;
+  AlignedVector<int8_t> A_prepared(A.size()), B_prepared(B.size());
+  ClearInstrumentRecords();
+  Int8::PrepareA(A.begin(), A_prepared.begin(), 1.0f, A_rows, width);
+  Int8::PrepareB(B.begin(), B_prepared.begin(), 1.0f, width, B_cols);
+  Int8::Multiply(A_prepared.begin(), B_prepared.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(1.0f, C.begin()));
+  ThreadPool pool(3);
+  Int8::Multiply(A_prepared.begin(), B_prepared.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(1.0f, C.begin()), pool);
+
+  std::size_t quantizes = 0, prepares = 0;
+  std::set<uint64_t> calls;
+  for (const CallRecord &r : RecordsOf(-1)) {
+    CHECK(!strcmp(r.backend, Int8::kName));
+    if (r.event == Event::Quantize) {
+      ++quantizes;
+      CHECK(!strcmp(r.name, "Int8::Quantize"));
+      CHECK(r.dims[0] == A_rows * width);
+    } else if (r.event == Event::PrepareB) {
+      ++prepares;
+      CHECK(!strcmp(r.name, "Int8::PrepareB"));
+      CHECK(r.dims[0] == width);
+      CHECK(r.dims[1] == B_cols);
+    } else {
+      CHECK(!strcmp(r.name, "Multiply"));
+      CHECK(r.dims[0] == A_rows);
+      CHECK(r.dims[1] == width);
+      CHECK(r.dims[2] == B_cols);
+      calls.insert(r.call);
+    }
+  }
+  CHECK(quantizes == 1);
+  CHECK(prepares == 1);
+  CHECK(calls.size() == 2);
+}
+
+} // namespace
+} // namespace intgemm
@@ -0,0 +1,47 @@
+#include "../test.h"
+#include "../../intgemm/aligned.h"
+#include "../../intgemm/kernels.h"
+
+#include <cmath>
+#include <cstddef>
+
+namespace intgemm {
+
+float silu_ref(float x) {
+  return x / (1 + std::exp(-x));
+}
+
+template <CPUType CPUType_>
+void kernel_silu_test() {
+  if (kCPU < CPUType_)
+    return;
+
+  using vec_t = vector_t<CPUType_, float>;
+  constexpr static std::size_t VECTOR_LENGTH = sizeof(vec_t) / sizeof(float);
+
+  AlignedVector<float> input(VECTOR_LENGTH);
+  AlignedVector<float> output(VECTOR_LENGTH);
+
+  // From -8 to 8, past where the approximations saturate.
+  for (std::size_t i = 0; i < VECTOR_LENGTH; ++i)
+    input[i] = -8.f + 16.f * i / (VECTOR_LENGTH - 1);
+
+  *output.template as<vec_t>() = kernels::silu(*input.template as<vec_t>());
+  for (std::size_t i = 0; i < output.size(); ++i)
+    CHECK_EPS(output[i], silu_ref(input[i]), 0.001f * (1 + std::fabs(input[i])));
+}
+
+template INTGEMM_SSE2 void kernel_silu_test<CPUType::SSE2>();
+KERNEL_TEST_CASE("silu SSE2") { return kernel_silu_test<CPUType::SSE2>(); }
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
+template INTGEMM_AVX2 void kernel_silu_test<CPUType::AVX2>();
+KERNEL_TEST_CASE("silu AVX2") { return kernel_silu_test<CPUType::AVX2>(); }
+#endif
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+template INTGEMM_AVX512BW void kernel_silu_test<CPUType::AVX512BW>();
+KERNEL_TEST_CASE("silu AVX512BW") { return kernel_silu_test<CPUType::AVX512BW>(); }
+#endif
+
+}
@@ -2,8 +2,10 @@
 #include "../../intgemm/aligned.h"
 #include "../../intgemm/kernels.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <numeric>
+#include <type_traits>
 
 namespace intgemm {
 
@@ -23,6 +25,11 @@ void kernel_write_test() {
   kernels::write(*input.template as<vec_t>(), output.begin(), 0);
   for (std::size_t i = 0; i < VECTOR_LENGTH; ++i)
     CHECK(output[i] == ElemType_(i));
+
+  AlignedVector<ElemType_> streamed(VECTOR_LENGTH);
+  kernels::write_stream(*input.template as<vec_t>(), streamed.begin(), 0);
+  for (std::size_t i = 0; i < VECTOR_LENGTH; ++i)
+    CHECK(streamed[i] == ElemType_(i));
 }
 
 template INTGEMM_SSE2 void kernel_write_test<CPUType::SSE2, int8_t>();
@@ -62,4 +69,47 @@ KERNEL_TEST_CASE("write/float AVX512BW") { return kernel_write_test<CPUType::AVX
 KERNEL_TEST_CASE("write/double AVX512BW") { return kernel_write_test<CPUType::AVX512BW, double>(); }
 #endif
 
+template <CPUType CPUType_, typename OutputType_>
+void kernel_write_quantized_test() {
+  if (kCPU < CPUType_)
+    return;
+
+  using vec_t = vector_t<CPUType_, int>;
+  constexpr static std::size_t VECTOR_LENGTH = sizeof(vec_t) / sizeof(int);
+  const int offset = std::is_same<OutputType_, uint8_t>::value ? 127 : 0;
+
+  AlignedVector<int> input(VECTOR_LENGTH);
+  AlignedVector<OutputType_> output(2 * VECTOR_LENGTH);
+  std::fill(output.begin(), output.end(), OutputType_(5));
+
+  const int values[] = {-100000, -128, -127, -1, 0, 1, 127, 128, 100000, 3, -3, 50, -50, 300, -300, 126};
+  std::copy(values, values + VECTOR_LENGTH, input.begin());
+
+  kernels::write_quantized(*input.template as<vec_t>(), output.begin(), 0);
+  for (std::size_t i = 0; i < VECTOR_LENGTH; ++i)
+    CHECK(int(output[i]) == std::min(127, std::max(-127, input[i])) + offset);
+  // Only one byte per lane is written.
+  for (std::size_t i = VECTOR_LENGTH; i < output.size(); ++i)
+    CHECK(output[i] == OutputType_(5));
+}
+
+template INTGEMM_SSE2 void kernel_write_quantized_test<CPUType::SSE2, int8_t>();
+template INTGEMM_SSE2 void kernel_write_quantized_test<CPUType::SSE2, uint8_t>();
+KERNEL_TEST_CASE("write_quantized/int8 SSE2") { return kernel_write_quantized_test<CPUType::SSE2, int8_t>(); }
+KERNEL_TEST_CASE("write_quantized/uint8 SSE2") { return kernel_write_quantized_test<CPUType::SSE2, uint8_t>(); }
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
+template INTGEMM_AVX2 void kernel_write_quantized_test<CPUType::AVX2, int8_t>();
+template INTGEMM_AVX2 void kernel_write_quantized_test<CPUType::AVX2, uint8_t>();
+KERNEL_TEST_CASE("write_quantized/int8 AVX2") { return kernel_write_quantized_test<CPUType::AVX2, int8_t>(); }
+KERNEL_TEST_CASE("write_quantized/uint8 AVX2") { return kernel_write_quantized_test<CPUType::AVX2, uint8_t>(); }
+#endif
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+template INTGEMM_AVX512BW void kernel_write_quantized_test<CPUType::AVX512BW, int8_t>();
+template INTGEMM_AVX512BW void kernel_write_quantized_test<CPUType::AVX512BW, uint8_t>();
+KERNEL_TEST_CASE("write_quantized/int8 AVX512BW") { return kernel_write_quantized_test<CPUType::AVX512BW, int8_t>(); }
+KERNEL_TEST_CASE("write_quantized/uint8 AVX512BW") { return kernel_write_quantized_test<CPUType::AVX512BW, uint8_t>(); }
+#endif
+
 }
@@ -1,9 +1,12 @@
 #include "test.h"
 #include "../intgemm/aligned.h"
 #include "../intgemm/callbacks.h"
+#include "../intgemm/executor.h"
+#include "../intgemm/fixed_shapes.h"
 #include "../intgemm/interleave.h"
 #include "../intgemm/intgemm.h"
 #include "../intgemm/multiply.h"
+#include "../intgemm/prefetch.h"
 #include "../intgemm/stats.h"
 
 #include <algorithm>
@@ -12,14 +15,22 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <numeric>
 #include <random>
 
+#if defined(_OPENMP) && defined(__linux__)
+#include <dirent.h>
+#include <omp.h>
+#endif
+
 namespace intgemm {
 
+#ifndef INTGEMM_COMPILER_SUPPORTS_NEON
 #ifndef __INTEL_COMPILER
 INTGEMM_SSE2
 #endif
@@ -61,6 +72,7 @@ TEST_CASE("Transpose 8", "[transpose]") {
     CHECK_MESSAGE(ref[i] == input[i], "8-bit transpose failure at " << i << ": " << (int16_t)ref[i] << " != " << (int16_t)input[i]);
   }
 }
+#endif
 
 template <class Routine> void TestPrepare(Index rows = 32, Index cols = 16) {
   std::mt19937 gen;
@@ -98,6 +110,47 @@ TEST_CASE("Prepare AVX512", "[prepare]") {
 }
 #endif
 
+#ifdef INTGEMM_COMPILER_SUPPORTS_AMX
+// AMX stores 4 consecutive rows of each column together, so it has its own
+// reference instead of Rearragement.  All three ways of preparing B agree.
+void TestPrepareAMX(Index rows, Index cols) {
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-129.0, 129.0);
+  AlignedVector<float> input(rows * cols);
+  for (auto& it : input) {
+    it = dist(gen);
+  }
+  AlignedVector<int8_t> test(input.size());
+  AMX::Kernels8::PrepareB(input.begin(), test.begin(), 1, rows, cols);
+
+  AlignedVector<int8_t> quantized(input.size());
+  AMX::Kernels8::Quantize(input.begin(), quantized.begin(), 1, static_cast<Index>(input.size()));
+  AlignedVector<int8_t> reference(input.size());
+  for (Index r = 0; r < rows; ++r) {
+    for (Index c = 0; c < cols; ++c) {
+      reference[(c / 8) * 8 * rows + (r / 4) * 32 + (c % 8) * 4 + r % 4] = quantized[r * cols + c];
+    }
+  }
+  CHECK_MESSAGE(memcmp(reference.begin(), test.begin(), test.size()) == 0, "AMX PrepareB mismatch");
+
+  AlignedVector<float> input_transposed(input.size());
+  references::Transpose(input.begin(), input_transposed.begin(), rows, cols);
+  AlignedVector<int8_t> quantized_transposed(input.size());
+  references::Transpose(quantized.begin(), quantized_transposed.begin(), rows, cols);
+  AlignedVector<int8_t> from_transposed(input.size());
+  AMX::Kernels8::PrepareBTransposed(input_transposed.begin(), from_transposed.begin(), 1, rows, cols);
+  CHECK_MESSAGE(memcmp(reference.begin(), from_transposed.begin(), test.size()) == 0, "AMX PrepareBTransposed mismatch");
+  AMX::Kernels8::PrepareBQuantizedTransposed(quantized_transposed.begin(), from_transposed.begin(), rows, cols);
+  CHECK_MESSAGE(memcmp(reference.begin(), from_transposed.begin(), test.size()) == 0, "AMX PrepareBQuantizedTransposed mismatch");
+}
+
+TEST_CASE("Prepare AMX", "[prepare]") {
+  if (kCPU < CPUType::AMX) return;
+  TestPrepareAMX(64, 8);
+  TestPrepareAMX(256, 40);
+}
+#endif
+
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 TEST_CASE("Prepare AVX2", "[prepare]") {
   if (kCPU < CPUType::AVX2) return;
@@ -106,6 +159,45 @@ TEST_CASE("Prepare AVX2", "[prepare]") {
 }
 #endif
 
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+// NEON has no x86 transpose to compare against in prepare_b_transposed.cc, so
+// check the transposed entry points produce the same layout as PrepareB.
+template <class Routine> void TestPrepareTransposedNEON(Index rows, Index cols) {
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-129.0, 129.0);
+  AlignedVector<float> input(rows * cols);
+  for (auto& it : input) {
+    it = dist(gen);
+  }
+  using Integer = typename Routine::Integer;
+  AlignedVector<Integer> reference(input.size());
+  Routine::PrepareB(input.begin(), reference.begin(), 1, rows, cols);
+
+  AlignedVector<float> input_transposed(input.size());
+  references::Transpose(input.begin(), input_transposed.begin(), rows, cols);
+  AlignedVector<Integer> test(input.size());
+  Routine::PrepareBTransposed(input_transposed.begin(), test.begin(), 1, rows, cols);
+  CHECK_MESSAGE(memcmp(reference.begin(), test.begin(), test.size() * sizeof(Integer)) == 0, Routine::kName << " PrepareBTransposed mismatch");
+
+  AlignedVector<Integer> quantized(input.size());
+  Routine::Quantize(input.begin(), quantized.begin(), 1, static_cast<Index>(input.size()));
+  AlignedVector<Integer> quantized_transposed(input.size());
+  references::Transpose(quantized.begin(), quantized_transposed.begin(), rows, cols);
+  Routine::PrepareBQuantizedTransposed(quantized_transposed.begin(), test.begin(), rows, cols);
+  CHECK_MESSAGE(memcmp(reference.begin(), test.begin(), test.size() * sizeof(Integer)) == 0, Routine::kName << " PrepareBQuantizedTransposed mismatch");
+}
+
+TEST_CASE("Prepare NEON", "[prepare]") {
+  if (kCPU < CPUType::NEON) return;
+  TestPrepare<NEON::Kernels8>(16, 8);
+  TestPrepare<NEON::Kernels8>(32, 16);
+  TestPrepare<NEON::Kernels8>(32, 32);
+  TestPrepare<NEON::Kernels16>(8, 8);
+  TestPrepare<NEON::Kernels16>(32, 32);
+  TestPrepareTransposedNEON<NEON::Kernels8>(64, 16);
+  TestPrepareTransposedNEON<NEON::Kernels16>(64, 16);
+}
+#else
 TEST_CASE("Prepare SSSE3", "[prepare]") {
   if (kCPU < CPUType::SSSE3) return;
   TestPrepare<SSSE3::Kernels8>(16, 8);
@@ -118,6 +210,7 @@ TEST_CASE("Prepare SSE2", "[prepare]") {
   TestPrepare<SSE2::Kernels16>(8, 8);
   TestPrepare<SSE2::Kernels16>(32, 32);
 }
+#endif
 
 template <class Routine> void TestSelectColumnsB(Index rows = 64, Index cols = 16) {
   std::mt19937 gen;
@@ -163,6 +256,14 @@ TEST_CASE("SelectColumnsB AVX512", "[select]") {
 }
 #endif
 
+#ifdef INTGEMM_COMPILER_SUPPORTS_AMX
+TEST_CASE("SelectColumnsB AMX", "[select]") {
+  if (kCPU < CPUType::AMX) return;
+  TestSelectColumnsB<AMX::Kernels8>();
+  TestSelectColumnsB<AMX::Kernels8>(256, 256);
+}
+#endif
+
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
 TEST_CASE("SelectColumnsB AVX2", "[select]") {
   if (kCPU < CPUType::AVX2) return;
@@ -171,6 +272,15 @@ TEST_CASE("SelectColumnsB AVX2", "[select]") {
 }
 #endif
 
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+TEST_CASE("SelectColumnsB NEON", "[select]") {
+  if (kCPU < CPUType::NEON) return;
+  TestSelectColumnsB<NEON::Kernels8>();
+  TestSelectColumnsB<NEON::Kernels8>(256, 256);
+  TestSelectColumnsB<NEON::Kernels16>();
+  TestSelectColumnsB<NEON::Kernels16>(256, 256);
+}
+#else
 TEST_CASE("SelectColumnsB SSSE3", "[select]") {
   if (kCPU < CPUType::SSSE3) return;
   TestSelectColumnsB<SSSE3::Kernels8>();
@@ -182,6 +292,71 @@ TEST_CASE("SelectColumnsB SSE2", "[select]") {
   TestSelectColumnsB<SSE2::Kernels16>();
   TestSelectColumnsB<SSE2::Kernels16>(256, 256);
 }
+#endif
+
+TEST_CASE("Gather rows", "[gather]") {
+  if (kCPU < CPUType::SSE2) return;
+  std::mt19937 gen;
+  std::uniform_int_distribution<int> byte(-127, 127);
+  std::uniform_real_distribution<float> scale(0.001f, 0.1f);
+  std::uniform_int_distribution<Index> id(0, 49);
+  for (Index width : {Index(1), Index(16), Index(70), Index(256)}) {
+    std::vector<int8_t> table(50 * width);
+    for (int8_t &v : table) v = static_cast<int8_t>(byte(gen));
+    std::vector<float> row_scales(50);
+    for (float &s : row_scales) s = scale(gen);
+    std::vector<Index> ids(300);
+    for (Index &i : ids) i = id(gen);
+
+    std::vector<float> unquantized(ids.size() * width), per_row(ids.size() * width);
+    std::vector<int8_t> quantized(ids.size() * width);
+    Int8::GatherRowsUnquantize(table.data(), width, ids.data(), ids.data() + ids.size(), 0.03f, unquantized.data());
+    Int8::GatherRowsUnquantize(table.data(), width, ids.data(), ids.data() + ids.size(), row_scales.data(), per_row.data());
+    Int8::GatherRowsQuantize(table.data(), width, ids.data(), ids.data() + ids.size(), 0.03f, 70.0f, quantized.data());
+    for (Index r = 0; r < ids.size(); ++r) {
+      for (Index k = 0; k < width; ++k) {
+        const int8_t value = table[ids[r] * width + k];
+        const float requantized = std::max(-127.0f, std::min(127.0f, std::nearbyint(value * (0.03f * 70.0f))));
+        if (unquantized[r * width + k] != value * 0.03f || per_row[r * width + k] != value * row_scales[ids[r]] || quantized[r * width + k] != requantized) {
+          CHECK(unquantized[r * width + k] == value * 0.03f);
+          CHECK(per_row[r * width + k] == value * row_scales[ids[r]]);
+          CHECK(quantized[r * width + k] == requantized);
+          FAIL("width " << width << " row " << r << " column " << k);
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("Gather columns of prepared B", "[gather]") {
+  if (kCPU < CPUType::SSSE3) return;
+  const Index rows = 256, cols = 48;
+  std::mt19937 gen;
+  std::uniform_int_distribution<int> byte(-127, 127);
+  // Integers so PrepareB with multiplier 1 keeps them exactly.
+  AlignedVector<float> B(rows * cols);
+  for (auto &v : B) v = static_cast<float>(byte(gen));
+  AlignedVector<int8_t> prepared(rows * cols);
+  Int8::PrepareB(B.begin(), prepared.begin(), 1.0f, rows, cols);
+  std::vector<float> col_scales(cols);
+  for (Index c = 0; c < cols; ++c) col_scales[c] = 0.5f + c;
+  const Index ids[] = {3, 47, 0, 8, 3, 15, 16, 31};
+  const Index count = sizeof(ids) / sizeof(Index);
+
+  std::vector<float> unquantized(count * rows), per_col(count * rows);
+  std::vector<int8_t> quantized(count * rows);
+  Int8::GatherPreparedBUnquantize(prepared.begin(), rows, ids, ids + count, 0.25f, unquantized.data());
+  Int8::GatherPreparedBUnquantize(prepared.begin(), rows, ids, ids + count, col_scales.data(), per_col.data());
+  Int8::GatherPreparedBQuantize(prepared.begin(), rows, ids, ids + count, 0.25f, 2.0f, quantized.data());
+  for (Index r = 0; r < count; ++r) {
+    for (Index k = 0; k < rows; ++k) {
+      const float value = B[k * cols + ids[r]];
+      CHECK(unquantized[r * rows + k] == value * 0.25f);
+      CHECK(per_col[r * rows + k] == value * col_scales[ids[r]]);
+      CHECK(quantized[r * rows + k] == std::nearbyint(value * 0.5f));
+    }
+  }
+}
 
 template <class Register> void TestMax() {
   Register r = set1_ps<Register>(-2.0);
@@ -193,7 +368,11 @@ template <class Register> void TestMax() {
 }
 
 TEST_CASE("Max", "[max]") {
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+  TestMax<float32x4_t>();
+#else
   TestMax<__m128>();
+#endif
 }
 
 void CompareMaxAbs(const float *begin, const float *end, float test, std::size_t offset) {
@@ -223,10 +402,17 @@ template <float (*Backend) (const float *, const float *)> void TestMaxAbsolute(
   }
 }
 
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+TEST_CASE("MaxAbsolute NEON", "[max]") {
+  if (kCPU < CPUType::NEON) return;
+  TestMaxAbsolute<NEON::MaxAbsolute>();
+}
+#else
 TEST_CASE("MaxAbsolute SSE2", "[max]") {
   if (kCPU < CPUType::SSE2) return;
   TestMaxAbsolute<SSE2::MaxAbsolute>();
 }
+#endif
 
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 TEST_CASE("MaxAbsolute AVX2", "[max]") {
@@ -242,6 +428,111 @@ TEST_CASE("MaxAbsolute AVX512BW", "[max]") {
 }
 #endif
 
+struct ElementwiseBackend {
+  void (*exp)(const float *, float *, Index);
+  void (*sigmoid)(const float *, float *, Index);
+  void (*tanh)(const float *, float *, Index);
+  void (*relu)(const float *, float *, Index);
+  void (*silu)(const float *, float *, Index);
+  void (*gelu)(const float *, float *, Index);
+  void (*upcast8to16)(const int8_t *, int16_t *, Index);
+  void (*downcast16to8)(const int16_t *, int8_t *, Index);
+};
+
+// Unaligned arrays of every length up to a few registers and one long enough
+// to split over threads, against scalar references with the kernels' error.
+void TestElementwise(const ElementwiseBackend &backend) {
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-8.0f, 8.0f);
+  const Index kLong = 3 * kElementwiseGrain + 5;
+  std::vector<float> input(kLong + 1), output(kLong + 1);
+  for (float &v : input) v = dist(gen);
+  struct {
+    void (*function)(const float *, float *, Index);
+    double (*reference)(double);
+  } const cases[] = {
+    {backend.exp, [](double x) { return std::exp(x); }},
+    {backend.sigmoid, [](double x) { return 1.0 / (1.0 + std::exp(-x)); }},
+    {backend.tanh, [](double x) { return std::tanh(x); }},
+    {backend.relu, [](double x) { return std::max(x, 0.0); }},
+    {backend.silu, [](double x) { return x / (1.0 + std::exp(-x)); }},
+    {backend.gelu, [](double x) { return 0.5 * x * (1.0 + std::tanh(0.7978845608028654 * (x + 0.044715 * x * x * x))); }},
+  };
+  for (const auto &c : cases) {
+    for (Index size : {Index(0), Index(1), Index(3), Index(4), Index(7), Index(16), Index(17), Index(33), Index(70), kLong}) {
+      std::fill(output.begin(), output.end(), -1.0f);
+      c.function(input.data() + 1, output.data() + 1, size);
+      CHECK(output[0] == -1.0f);
+      for (Index i = 1; i <= size; ++i) {
+        const double expected = c.reference(input[i]);
+        if (std::fabs(output[i] - expected) > 1e-3 * std::max(1.0, std::fabs(expected))) {
+          CHECK_MESSAGE(output[i] == Approx(expected), "size " << size << " index " << i << " input " << input[i]);
+          break;
+        }
+      }
+      if (size + 1 < output.size()) CHECK(output[size + 1] == -1.0f);
+    }
+    // In place.
+    std::vector<float> in_place(input.begin(), input.begin() + 37);
+    c.function(in_place.data(), in_place.data(), 37);
+    c.function(input.data(), output.data(), 37);
+    CHECK(std::equal(in_place.begin(), in_place.end(), output.begin()));
+  }
+
+  std::vector<int8_t> bytes(kLong + 1), narrowed(kLong + 1);
+  std::vector<int16_t> words(kLong + 1), wide(kLong + 1);
+  for (Index i = 0; i < bytes.size(); ++i) {
+    bytes[i] = static_cast<int8_t>(i * 37);
+    words[i] = static_cast<int16_t>(i * 1237);
+  }
+  for (Index size : {Index(0), Index(5), Index(16), Index(31), Index(64), Index(100), kLong}) {
+    backend.upcast8to16(bytes.data() + 1, wide.data() + 1, size);
+    backend.downcast16to8(words.data() + 1, narrowed.data() + 1, size);
+    for (Index i = 1; i <= size; ++i) {
+      if (wide[i] != bytes[i] || narrowed[i] != std::min<int16_t>(127, std::max<int16_t>(-128, words[i]))) {
+        CHECK(wide[i] == bytes[i]);
+        CHECK(narrowed[i] == std::min<int16_t>(127, std::max<int16_t>(-128, words[i])));
+        break;
+      }
+    }
+  }
+}
+
+#define INTGEMM_ELEMENTWISE_BACKEND(Arch) ElementwiseBackend{Arch::Exp, Arch::Sigmoid, Arch::Tanh, Arch::Relu, Arch::Silu, Arch::Gelu, Arch::Upcast8to16, Arch::Downcast16to8}
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+TEST_CASE("Elementwise NEON", "[elementwise]") {
+  if (kCPU < CPUType::NEON) return;
+  TestElementwise(INTGEMM_ELEMENTWISE_BACKEND(NEON));
+}
+#else
+TEST_CASE("Elementwise SSE2", "[elementwise]") {
+  if (kCPU < CPUType::SSE2) return;
+  TestElementwise(INTGEMM_ELEMENTWISE_BACKEND(SSE2));
+}
+#endif
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
+TEST_CASE("Elementwise AVX2", "[elementwise]") {
+  if (kCPU < CPUType::AVX2) return;
+  TestElementwise(INTGEMM_ELEMENTWISE_BACKEND(AVX2));
+}
+#endif
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+TEST_CASE("Elementwise AVX512BW", "[elementwise]") {
+  if (kCPU < CPUType::AVX512BW) return;
+  TestElementwise(INTGEMM_ELEMENTWISE_BACKEND(AVX512BW));
+}
+#endif
+
+TEST_CASE("Elementwise dispatched", "[elementwise]") {
+  if (kCPU < CPUType::SSE2) return;
+  TestElementwise(ElementwiseBackend{Exp, Sigmoid, Tanh, Relu, Silu, Gelu, Upcast8to16, Downcast16to8});
+}
+
+#undef INTGEMM_ELEMENTWISE_BACKEND
+
 // Based on https://arxiv.org/abs/1705.01991
 
 // Copyright (c) 2017 Microsoft Corporation
@@ -470,6 +761,120 @@ template <class Routine> void TestMultiplyBiasRelu(Index A_rows, Index width, In
    int_tolerance, float_tolerance, MSE_float_tolerance, MSE_int_tolerance);
 }
 
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+TEST_CASE ("Multiply NEON 16bit", "[multiply]") {
+  if (kCPU < CPUType::NEON) return;
+  TestMultiply<NEON::Kernels16>(8, 256, 256, .1f, 1, 0.01f);
+  TestMultiply<NEON::Kernels16>(8, 2048, 256, .1f, 1, 0.02f);
+  TestMultiply<NEON::Kernels16>(320, 256, 256, .1f, 1, 0.01f);
+  TestMultiply<NEON::Kernels16>(472, 256, 256, .1f, 1, 0.01f);
+  TestMultiply<NEON::Kernels16>(248, 256, 256, .1f, 1, 0.01f);
+  TestMultiply<NEON::Kernels16>(200, 256, 256, .1f, 1, 0.01f);
+  TestMultiply<NEON::Kernels16>(1, 256, 256, .1f, 1, 0.01f);
+  TestMultiply<NEON::Kernels16>(40, 4160, 64, .1f, 1, 0.02f);
+}
+
+TEST_CASE ("Multiply NEON 16bit with relu", "[multiply_relu]") {
+  if (kCPU < CPUType::NEON) return;
+  TestMultiplyRelu<NEON::Kernels16>(8, 256, 256, .1f, 1, 0.01f);
+  TestMultiplyRelu<NEON::Kernels16>(8, 2048, 256, .1f, 1, 0.02f);
+  TestMultiplyRelu<NEON::Kernels16>(320, 256, 256, .1f, 1, 0.01f);
+  TestMultiplyRelu<NEON::Kernels16>(200, 256, 256, .1f, 1, 0.01f);
+}
+
+TEST_CASE ("Multiply NEON 16bit with bias", "[biased_multiply]") {
+  if (kCPU < CPUType::NEON) return;
+  TestMultiplyBias<NEON::Kernels16>(8, 256, 256, .1f, 1, 0.01f);
+  TestMultiplyBias<NEON::Kernels16>(8, 2048, 256, .1f, 1, 0.02f);
+  TestMultiplyBias<NEON::Kernels16>(320, 256, 256, .1f, 1, 0.01f);
+  TestMultiplyBias<NEON::Kernels16>(200, 256, 256, .1f, 1, 0.01f);
+}
+
+TEST_CASE ("Multiply NEON 16bit with bias and relu", "[biased_multiply_relu]") {
+  if (kCPU < CPUType::NEON) return;
+  TestMultiplyBiasRelu<NEON::Kernels16>(8, 256, 256, .1f, 1, 0.01f);
+  TestMultiplyBiasRelu<NEON::Kernels16>(8, 2048, 256, .1f, 1, 0.02f);
+  TestMultiplyBiasRelu<NEON::Kernels16>(320, 256, 256, .1f, 1, 0.01f);
+  TestMultiplyBiasRelu<NEON::Kernels16>(200, 256, 256, .1f, 1, 0.01f);
+}
+
+// Neither widening multiply nor sdot saturates, so 8-bit NEON is as exact as VNNI.
+TEST_CASE ("Multiply NEON 8bit", "[multiply]") {
+  if (kCPU < CPUType::NEON) return;
+  TestMultiply<NEON::Kernels8>(8, 256, 256, 0, 0.25f, 0.062f);
+  TestMultiply<NEON::Kernels8>(8, 2048, 256, 0, 0.55f, 0.25f);
+  TestMultiply<NEON::Kernels8>(320, 256, 256, 0, 0.26f, 0.059f);
+  TestMultiply<NEON::Kernels8>(472, 256, 256, 0, 0.29f, 0.059f);
+  TestMultiply<NEON::Kernels8>(248, 256, 256, 0, 0.29f, 0.059f);
+  TestMultiply<NEON::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+  TestMultiply<NEON::Kernels8>(1, 256, 256, 0, 0.25f, 0.062f);
+  TestMultiply<NEON::Kernels8>(7, 256, 256, 0, 0.25f, 0.062f);
+  TestMultiply<NEON::Kernels8>(40, 4160, 64, 0, 0.77f, 0.25f);
+}
+
+TEST_CASE ("Multiply NEON 8bit with relu", "[multiply_relu]") {
+  if (kCPU < CPUType::NEON) return;
+  TestMultiplyRelu<NEON::Kernels8>(8, 256, 256, 0, 0.25f, 0.062f);
+  TestMultiplyRelu<NEON::Kernels8>(8, 2048, 256, 0, 0.55f, 0.25f);
+  TestMultiplyRelu<NEON::Kernels8>(320, 256, 256, 0, 0.26f, 0.059f);
+  TestMultiplyRelu<NEON::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+}
+
+TEST_CASE ("Multiply NEON 8bit with bias", "[biased_multiply]") {
+  if (kCPU < CPUType::NEON) return;
+  TestMultiplyBias<NEON::Kernels8>(8, 256, 256, 0, 0.25f, 0.062f);
+  TestMultiplyBias<NEON::Kernels8>(8, 2048, 256, 0, 0.55f, 0.25f);
+  TestMultiplyBias<NEON::Kernels8>(320, 256, 256, 0, 0.26f, 0.059f);
+  TestMultiplyBias<NEON::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+}
+
+TEST_CASE ("Multiply NEON 8bit with bias and relu", "[biased_multiply_relu]") {
+  if (kCPU < CPUType::NEON) return;
+  TestMultiplyBiasRelu<NEON::Kernels8>(8, 256, 256, 0, 0.25f, 0.062f);
+  TestMultiplyBiasRelu<NEON::Kernels8>(8, 2048, 256, 0, 0.55f, 0.25f);
+  TestMultiplyBiasRelu<NEON::Kernels8>(320, 256, 256, 0, 0.26f, 0.059f);
+  TestMultiplyBiasRelu<NEON::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+}
+
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON_DOTPROD
+TEST_CASE ("Multiply NEONDOTPROD 8bit", "[multiply]") {
+  if (kCPU < CPUType::NEONDOTPROD) return;
+  TestMultiply<NEONDOTPROD::Kernels8>(8, 256, 256, 0, 0.25f, 0.062f);
+  TestMultiply<NEONDOTPROD::Kernels8>(8, 2048, 256, 0, 0.55f, 0.25f);
+  TestMultiply<NEONDOTPROD::Kernels8>(320, 256, 256, 0, 0.26f, 0.059f);
+  TestMultiply<NEONDOTPROD::Kernels8>(472, 256, 256, 0, 0.29f, 0.059f);
+  TestMultiply<NEONDOTPROD::Kernels8>(248, 256, 256, 0, 0.29f, 0.059f);
+  TestMultiply<NEONDOTPROD::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+  TestMultiply<NEONDOTPROD::Kernels8>(1, 256, 256, 0, 0.25f, 0.062f);
+  TestMultiply<NEONDOTPROD::Kernels8>(7, 256, 256, 0, 0.25f, 0.062f);
+  TestMultiply<NEONDOTPROD::Kernels8>(40, 4160, 64, 0, 0.77f, 0.25f);
+}
+
+TEST_CASE ("Multiply NEONDOTPROD 8bit with relu", "[multiply_relu]") {
+  if (kCPU < CPUType::NEONDOTPROD) return;
+  TestMultiplyRelu<NEONDOTPROD::Kernels8>(8, 256, 256, 0, 0.25f, 0.062f);
+  TestMultiplyRelu<NEONDOTPROD::Kernels8>(8, 2048, 256, 0, 0.55f, 0.25f);
+  TestMultiplyRelu<NEONDOTPROD::Kernels8>(320, 256, 256, 0, 0.26f, 0.059f);
+  TestMultiplyRelu<NEONDOTPROD::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+}
+
+TEST_CASE ("Multiply NEONDOTPROD 8bit with bias", "[biased_multiply]") {
+  if (kCPU < CPUType::NEONDOTPROD) return;
+  TestMultiplyBias<NEONDOTPROD::Kernels8>(8, 256, 256, 0, 0.25f, 0.062f);
+  TestMultiplyBias<NEONDOTPROD::Kernels8>(8, 2048, 256, 0, 0.55f, 0.25f);
+  TestMultiplyBias<NEONDOTPROD::Kernels8>(320, 256, 256, 0, 0.26f, 0.059f);
+  TestMultiplyBias<NEONDOTPROD::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+}
+
+TEST_CASE ("Multiply NEONDOTPROD 8bit with bias and relu", "[biased_multiply_relu]") {
+  if (kCPU < CPUType::NEONDOTPROD) return;
+  TestMultiplyBiasRelu<NEONDOTPROD::Kernels8>(8, 256, 256, 0, 0.25f, 0.062f);
+  TestMultiplyBiasRelu<NEONDOTPROD::Kernels8>(8, 2048, 256, 0, 0.55f, 0.25f);
+  TestMultiplyBiasRelu<NEONDOTPROD::Kernels8>(320, 256, 256, 0, 0.26f, 0.059f);
+  TestMultiplyBiasRelu<NEONDOTPROD::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+}
+#endif
+#else
 TEST_CASE ("Multiply SSE2 16bit", "[multiply]") {
   if (kCPU < CPUType::SSE2) return;
   TestMultiply<SSE2::Kernels16>(8, 256, 256, .1f, 1, 0.01f);
@@ -478,6 +883,7 @@ TEST_CASE ("Multiply SSE2 16bit", "[multiply]") {
   TestMultiply<SSE2::Kernels16>(472, 256, 256, .1f, 1, 0.01f);
   TestMultiply<SSE2::Kernels16>(248, 256, 256, .1f, 1, 0.01f);
   TestMultiply<SSE2::Kernels16>(200, 256, 256, .1f, 1, 0.01f);
+  TestMultiply<SSE2::Kernels16>(40, 4160, 64, .1f, 1, 0.02f);
 }
 
 TEST_CASE ("Multiply SSE2 16bit with relu", "[multiply_relu]") {
@@ -518,6 +924,7 @@ TEST_CASE ("Multiply SSSE3 8bit", "[multiply]") {
   TestMultiply<SSSE3::Kernels8>(472, 256, 256, 2.1f, 2.1f, 0.1f, 0.011f);
   TestMultiply<SSSE3::Kernels8>(248, 256, 256, 1.7f, 1.7f, 0.1f, 0.012f);
   TestMultiply<SSSE3::Kernels8>(200, 256, 256, 1.8f, 1.9f, 0.1f, 0.011f);
+  TestMultiply<SSSE3::Kernels8>(40, 4160, 64, 26, 26, 6.2f, 6.2f);
 }
 
 TEST_CASE ("Multiply SSSE3 8bit with relu", "[multiply_relu]") {
@@ -550,6 +957,47 @@ TEST_CASE ("Multiply SSSE3 8bit with bias and relu", "[biased_multiply_relu]") {
   TestMultiplyBiasRelu<SSSE3::Kernels8>(200, 256, 256, 1.8f, 1.9f, 0.1f, 0.011f);
 }
 
+#ifdef WASM
+// The SIMD128 kernels widen before adding, so they are as exact as VNNI.
+TEST_CASE ("Multiply SIMD128 8bit", "[multiply]") {
+  if (kCPU < CPUType::SIMD128) return;
+  TestMultiply<SIMD128::Kernels8>(8, 256, 256, 0, 0.25f, 0.062f);
+  TestMultiply<SIMD128::Kernels8>(8, 2048, 256, 0, 0.55f, 0.25f);
+  TestMultiply<SIMD128::Kernels8>(320, 256, 256, 0, 0.26f, 0.059f);
+  TestMultiply<SIMD128::Kernels8>(472, 256, 256, 0, 0.29f, 0.059f);
+  TestMultiply<SIMD128::Kernels8>(248, 256, 256, 0, 0.29f, 0.059f);
+  TestMultiply<SIMD128::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+  TestMultiply<SIMD128::Kernels8>(1, 256, 256, 0, 0.25f, 0.062f);
+  TestMultiply<SIMD128::Kernels8>(7, 256, 256, 0, 0.25f, 0.062f);
+  TestMultiply<SIMD128::Kernels8>(40, 4160, 64, 0, 0.77f, 0.25f);
+}
+
+TEST_CASE ("Multiply SIMD128 8bit with relu", "[multiply_relu]") {
+  if (kCPU < CPUType::SIMD128) return;
+  TestMultiplyRelu<SIMD128::Kernels8>(8, 256, 256, 0, 0.25f, 0.062f);
+  TestMultiplyRelu<SIMD128::Kernels8>(8, 2048, 256, 0, 0.55f, 0.25f);
+  TestMultiplyRelu<SIMD128::Kernels8>(320, 256, 256, 0, 0.26f, 0.059f);
+  TestMultiplyRelu<SIMD128::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+}
+
+TEST_CASE ("Multiply SIMD128 8bit with bias", "[biased_multiply]") {
+  if (kCPU < CPUType::SIMD128) return;
+  TestMultiplyBias<SIMD128::Kernels8>(8, 256, 256, 0, 0.25f, 0.062f);
+  TestMultiplyBias<SIMD128::Kernels8>(8, 2048, 256, 0, 0.55f, 0.25f);
+  TestMultiplyBias<SIMD128::Kernels8>(320, 256, 256, 0, 0.26f, 0.059f);
+  TestMultiplyBias<SIMD128::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+}
+
+TEST_CASE ("Multiply SIMD128 8bit with bias and relu", "[biased_multiply_relu]") {
+  if (kCPU < CPUType::SIMD128) return;
+  TestMultiplyBiasRelu<SIMD128::Kernels8>(8, 256, 256, 0, 0.25f, 0.062f);
+  TestMultiplyBiasRelu<SIMD128::Kernels8>(8, 2048, 256, 0, 0.55f, 0.25f);
+  TestMultiplyBiasRelu<SIMD128::Kernels8>(320, 256, 256, 0, 0.26f, 0.059f);
+  TestMultiplyBiasRelu<SIMD128::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+}
+#endif
+#endif
+
 
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
 TEST_CASE ("Multiply AVX2 8bit", "[multiply]") {
@@ -560,6 +1008,7 @@ TEST_CASE ("Multiply AVX2 8bit", "[multiply]") {
   TestMultiply<AVX2::Kernels8>(472, 256, 256, .1f, 1, 0.1f);
   TestMultiply<AVX2::Kernels8>(248, 256, 256, .1f, 1, 0.1f);
   TestMultiply<AVX2::Kernels8>(200, 256, 256, .1f, 1, 0.1f);
+  TestMultiply<AVX2::Kernels8>(40, 4160, 64, 13, 13, 2.6f, 2.6f);
 }
 
 TEST_CASE ("Multiply AVX2 8bit with relu", "[multiply_relu]") {
@@ -592,6 +1041,52 @@ TEST_CASE ("Multiply AVX2 8bit with bias and relu", "[biased_multiply_relu]") {
   TestMultiplyBiasRelu<AVX2::Kernels8>(200, 256, 256, .1f, 1, 0.1f);
 }
 
+  #ifdef INTGEMM_COMPILER_SUPPORTS_AVXVNNI
+  TEST_CASE ("Multiply AVXVNNI 8bit", "[multiply]") {
+    if (!AVXVNNIAvailable()) return;
+    TestMultiply<AVXVNNI::Kernels8>(8, 256, 256, 0, 0.25f, 0.062f);
+    TestMultiply<AVXVNNI::Kernels8>(8, 2048, 256, 0, 0.55f, 0.25f);
+    TestMultiply<AVXVNNI::Kernels8>(320, 256, 256, 0, 0.26f, 0.059f);
+    TestMultiply<AVXVNNI::Kernels8>(472, 256, 256, 0, 0.29f, 0.059f);
+    TestMultiply<AVXVNNI::Kernels8>(248, 256, 256, 0, 0.29f, 0.059f);
+    TestMultiply<AVXVNNI::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+    // Odd row counts exercise the rows left over after register blocking.
+    TestMultiply<AVXVNNI::Kernels8>(1, 256, 256, 0, 0.25f, 0.062f);
+    TestMultiply<AVXVNNI::Kernels8>(7, 256, 256, 0, 0.25f, 0.062f);
+    TestMultiply<AVXVNNI::Kernels8>(40, 4160, 64, 0, 0.77f, 0.25f);
+  }
+
+  TEST_CASE ("Multiply AVXVNNI 8bit with relu", "[multiply_relu]") {
+    if (!AVXVNNIAvailable()) return;
+    TestMultiplyRelu<AVXVNNI::Kernels8>(8, 256, 256, 0, 0.25f, 0.062f);
+    TestMultiplyRelu<AVXVNNI::Kernels8>(8, 2048, 256, 0, 0.55f, 0.25f);
+    TestMultiplyRelu<AVXVNNI::Kernels8>(320, 256, 256, 0, 0.26f, 0.059f);
+    TestMultiplyRelu<AVXVNNI::Kernels8>(472, 256, 256, 0, 0.29f, 0.059f);
+    TestMultiplyRelu<AVXVNNI::Kernels8>(248, 256, 256, 0, 0.29f, 0.059f);
+    TestMultiplyRelu<AVXVNNI::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+  }
+
+  TEST_CASE ("Multiply AVXVNNI 8bit with bias", "[biased_multiply]") {
+    if (!AVXVNNIAvailable()) return;
+    TestMultiplyBias<AVXVNNI::Kernels8>(8, 256, 256, 0, 0.25f, 0.062f);
+    TestMultiplyBias<AVXVNNI::Kernels8>(8, 2048, 256, 0, 0.55f, 0.25f);
+    TestMultiplyBias<AVXVNNI::Kernels8>(320, 256, 256, 0, 0.26f, 0.059f);
+    TestMultiplyBias<AVXVNNI::Kernels8>(472, 256, 256, 0, 0.29f, 0.059f);
+    TestMultiplyBias<AVXVNNI::Kernels8>(248, 256, 256, 0, 0.29f, 0.059f);
+    TestMultiplyBias<AVXVNNI::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+  }
+
+  TEST_CASE ("Multiply AVXVNNI 8bit with bias and relu", "[biased_multiply_relu]") {
+    if (!AVXVNNIAvailable()) return;
+    TestMultiplyBiasRelu<AVXVNNI::Kernels8>(8, 256, 256, 0, 0.25f, 0.062f);
+    TestMultiplyBiasRelu<AVXVNNI::Kernels8>(8, 2048, 256, 0, 0.55f, 0.25f);
+    TestMultiplyBiasRelu<AVXVNNI::Kernels8>(320, 256, 256, 0, 0.26f, 0.059f);
+    TestMultiplyBiasRelu<AVXVNNI::Kernels8>(472, 256, 256, 0, 0.29f, 0.059f);
+    TestMultiplyBiasRelu<AVXVNNI::Kernels8>(248, 256, 256, 0, 0.29f, 0.059f);
+    TestMultiplyBiasRelu<AVXVNNI::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+  }
+  #endif
+
 TEST_CASE ("Multiply AVX2 16bit", "[multiply]") {
   if (kCPU < CPUType::AVX2) return;
   TestMultiply<AVX2::Kernels16>(8, 256, 256, .1f, 1, 0.01f);
@@ -600,6 +1095,7 @@ TEST_CASE ("Multiply AVX2 16bit", "[multiply]") {
   TestMultiply<AVX2::Kernels16>(472, 256, 256, .1f, 1, 0.01f);
   TestMultiply<AVX2::Kernels16>(248, 256, 256, .1f, 1, 0.01f);
   TestMultiply<AVX2::Kernels16>(200, 256, 256, .1f, 1, 0.01f);
+  TestMultiply<AVX2::Kernels16>(40, 4160, 64, .1f, 1, 0.02f);
 }
 
 TEST_CASE ("Multiply AVX2 16bit with relu", "[multiply_relu]") {
@@ -642,6 +1138,10 @@ TEST_CASE ("Multiply AVX2 16bit with bias and relu", "[biased_multiply_relu]") {
     TestMultiply<AVX512BW::Kernels8>(472, 256, 256, 0, 0.29f, 0.059f);
     TestMultiply<AVX512BW::Kernels8>(248, 256, 256, 0, 0.29f, 0.059f);
     TestMultiply<AVX512BW::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+    // Odd row counts exercise the rows left over after register blocking.
+    TestMultiply<AVX512BW::Kernels8>(1, 256, 256, 0, 0.25f, 0.062f);
+    TestMultiply<AVX512BW::Kernels8>(7, 256, 256, 0, 0.25f, 0.062f);
+    TestMultiply<AVX512BW::Kernels8>(40, 4160, 64, 4.2f, 4.3f, 0.53f, 0.48f);
   }
 
   TEST_CASE ("Multiply AVX512 8bit with relu", "[multiply_relu]") {
@@ -683,6 +1183,10 @@ TEST_CASE ("Multiply AVX2 16bit with bias and relu", "[biased_multiply_relu]") {
       TestMultiply<AVX512VNNI::Kernels8>(472, 256, 256, 0, 0.29f, 0.059f);
       TestMultiply<AVX512VNNI::Kernels8>(248, 256, 256, 0, 0.29f, 0.059f);
       TestMultiply<AVX512VNNI::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+      // Odd row counts exercise the rows left over after register blocking.
+      TestMultiply<AVX512VNNI::Kernels8>(1, 256, 256, 0, 0.25f, 0.062f);
+      TestMultiply<AVX512VNNI::Kernels8>(7, 256, 256, 0, 0.25f, 0.062f);
+      TestMultiply<AVX512VNNI::Kernels8>(40, 4160, 64, 0, 0.77f, 0.25f);
     }
 
     TEST_CASE ("Multiply AVX512VNNI 8bit with relu", "[multiply_relu]") {
@@ -716,6 +1220,54 @@ TEST_CASE ("Multiply AVX2 16bit with bias and relu", "[biased_multiply_relu]") {
     }
   #endif
 
+  #ifdef INTGEMM_COMPILER_SUPPORTS_AMX
+    TEST_CASE ("Multiply AMX 8bit", "[multiply]") {
+      if (kCPU < CPUType::AMX) return;
+      TestMultiply<AMX::Kernels8>(8, 256, 256, 0, 0.25f, 0.062f);
+      TestMultiply<AMX::Kernels8>(8, 2048, 256, 0, 0.55f, 0.25f);
+      TestMultiply<AMX::Kernels8>(320, 256, 256, 0, 0.26f, 0.059f);
+      TestMultiply<AMX::Kernels8>(472, 256, 256, 0, 0.29f, 0.059f);
+      TestMultiply<AMX::Kernels8>(248, 256, 256, 0, 0.29f, 0.059f);
+      TestMultiply<AMX::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+      // Partial tiles: fewer than 16 rows, 16 to 32 rows and a lone strip.
+      TestMultiply<AMX::Kernels8>(1, 256, 256, 0, 0.25f, 0.062f);
+      TestMultiply<AMX::Kernels8>(7, 256, 256, 0, 0.25f, 0.062f);
+      TestMultiply<AMX::Kernels8>(17, 256, 264, 0, 0.25f, 0.062f);
+      TestMultiply<AMX::Kernels8>(33, 64, 8, 0, 0.25f, 0.062f);
+      TestMultiply<AMX::Kernels8>(40, 4160, 64, 0, 0.77f, 0.25f);
+    }
+
+    TEST_CASE ("Multiply AMX 8bit with relu", "[multiply_relu]") {
+      if (kCPU < CPUType::AMX) return;
+      TestMultiplyRelu<AMX::Kernels8>(8, 256, 256, 0, 0.25f, 0.062f);
+      TestMultiplyRelu<AMX::Kernels8>(8, 2048, 256, 0, 0.55f, 0.25f);
+      TestMultiplyRelu<AMX::Kernels8>(320, 256, 256, 0, 0.26f, 0.059f);
+      TestMultiplyRelu<AMX::Kernels8>(472, 256, 256, 0, 0.29f, 0.059f);
+      TestMultiplyRelu<AMX::Kernels8>(248, 256, 256, 0, 0.29f, 0.059f);
+      TestMultiplyRelu<AMX::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+    }
+
+    TEST_CASE ("Multiply AMX 8bit with bias", "[biased_multiply]") {
+      if (kCPU < CPUType::AMX) return;
+      TestMultiplyBias<AMX::Kernels8>(8, 256, 256, 0, 0.25f, 0.062f);
+      TestMultiplyBias<AMX::Kernels8>(8, 2048, 256, 0, 0.55f, 0.25f);
+      TestMultiplyBias<AMX::Kernels8>(320, 256, 256, 0, 0.26f, 0.059f);
+      TestMultiplyBias<AMX::Kernels8>(472, 256, 256, 0, 0.29f, 0.059f);
+      TestMultiplyBias<AMX::Kernels8>(248, 256, 256, 0, 0.29f, 0.059f);
+      TestMultiplyBias<AMX::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+    }
+
+    TEST_CASE ("Multiply AMX 8bit with bias and relu", "[biased_multiply_relu]") {
+      if (kCPU < CPUType::AMX) return;
+      TestMultiplyBiasRelu<AMX::Kernels8>(8, 256, 256, 0, 0.25f, 0.062f);
+      TestMultiplyBiasRelu<AMX::Kernels8>(8, 2048, 256, 0, 0.55f, 0.25f);
+      TestMultiplyBiasRelu<AMX::Kernels8>(320, 256, 256, 0, 0.26f, 0.059f);
+      TestMultiplyBiasRelu<AMX::Kernels8>(472, 256, 256, 0, 0.29f, 0.059f);
+      TestMultiplyBiasRelu<AMX::Kernels8>(248, 256, 256, 0, 0.29f, 0.059f);
+      TestMultiplyBiasRelu<AMX::Kernels8>(200, 256, 256, 0, 0.28f, 0.06f);
+    }
+  #endif
+
   TEST_CASE ("Multiply AVX512 16bit", "[multiply]") {
     if (kCPU < CPUType::AVX512BW) return;
     TestMultiply<AVX512BW::Kernels16>(8, 256, 256, .1f, 1, 0.01f);
@@ -724,6 +1276,7 @@ TEST_CASE ("Multiply AVX2 16bit with bias and relu", "[biased_multiply_relu]") {
     TestMultiply<AVX512BW::Kernels16>(472, 256, 256, .1f, 1, 0.01f);
     TestMultiply<AVX512BW::Kernels16>(248, 256, 256, .1f, 1, 0.01f);
     TestMultiply<AVX512BW::Kernels16>(200, 256, 256, .1f, 1, 0.01f);
+    TestMultiply<AVX512BW::Kernels16>(40, 4160, 64, .1f, 1, 0.02f);
   }
 
   TEST_CASE ("Multiply AVX512 16bit with relu", "[multiply_relu]") {
@@ -756,6 +1309,1452 @@ TEST_CASE ("Multiply AVX2 16bit with bias and relu", "[biased_multiply_relu]") {
     TestMultiplyBiasRelu<AVX512BW::Kernels16>(248, 256, 256, .1f, 1, 0.01f);
     TestMultiplyBiasRelu<AVX512BW::Kernels16>(200, 256, 256, .1f, 1, 0.01f);
   }
+
+  #ifdef INTGEMM_COMPILER_SUPPORTS_AVX512VNNI
+    TEST_CASE ("Multiply AVX512VNNI 16bit", "[multiply]") {
+      if (kCPU < CPUType::AVX512VNNI) return;
+      TestMultiply<AVX512VNNI::Kernels16>(8, 256, 256, .1f, 1, 0.01f);
+      TestMultiply<AVX512VNNI::Kernels16>(8, 2048, 256, .1f, 1, 0.011f);
+      TestMultiply<AVX512VNNI::Kernels16>(320, 256, 256, .1f, 1, 0.01f);
+      TestMultiply<AVX512VNNI::Kernels16>(472, 256, 256, .1f, 1, 0.01f);
+      TestMultiply<AVX512VNNI::Kernels16>(248, 256, 256, .1f, 1, 0.01f);
+      TestMultiply<AVX512VNNI::Kernels16>(200, 256, 256, .1f, 1, 0.01f);
+      // Odd row counts exercise the rows left over after register blocking.
+      TestMultiply<AVX512VNNI::Kernels16>(1, 256, 256, .1f, 1, 0.01f);
+      TestMultiply<AVX512VNNI::Kernels16>(7, 256, 256, .1f, 1, 0.01f);
+      TestMultiply<AVX512VNNI::Kernels16>(40, 4160, 64, .1f, 1, 0.02f);
+    }
+
+    TEST_CASE ("Multiply AVX512VNNI 16bit with relu", "[multiply_relu]") {
+      if (kCPU < CPUType::AVX512VNNI) return;
+      TestMultiplyRelu<AVX512VNNI::Kernels16>(8, 256, 256, .1f, 1, 0.01f);
+      TestMultiplyRelu<AVX512VNNI::Kernels16>(8, 2048, 256, .1f, 1, 0.011f);
+      TestMultiplyRelu<AVX512VNNI::Kernels16>(320, 256, 256, .1f, 1, 0.01f);
+      TestMultiplyRelu<AVX512VNNI::Kernels16>(472, 256, 256, .1f, 1, 0.01f);
+      TestMultiplyRelu<AVX512VNNI::Kernels16>(248, 256, 256, .1f, 1, 0.01f);
+      TestMultiplyRelu<AVX512VNNI::Kernels16>(200, 256, 256, .1f, 1, 0.01f);
+    }
+
+    TEST_CASE ("Multiply AVX512VNNI 16bit with bias", "[biased_multiply]") {
+      if (kCPU < CPUType::AVX512VNNI) return;
+      TestMultiplyBias<AVX512VNNI::Kernels16>(8, 256, 256, .1f, 1, 0.01f);
+      TestMultiplyBias<AVX512VNNI::Kernels16>(8, 2048, 256, .1f, 1, 0.011f);
+      TestMultiplyBias<AVX512VNNI::Kernels16>(320, 256, 256, .1f, 1, 0.01f);
+      TestMultiplyBias<AVX512VNNI::Kernels16>(472, 256, 256, .1f, 1, 0.01f);
+      TestMultiplyBias<AVX512VNNI::Kernels16>(248, 256, 256, .1f, 1, 0.01f);
+      TestMultiplyBias<AVX512VNNI::Kernels16>(200, 256, 256, .1f, 1, 0.01f);
+    }
+
+    TEST_CASE ("Multiply AVX512VNNI 16bit with bias and relu", "[biased_multiply_relu]") {
+      if (kCPU < CPUType::AVX512VNNI) return;
+      TestMultiplyBiasRelu<AVX512VNNI::Kernels16>(8, 256, 256, .1f, 1, 0.01f);
+      TestMultiplyBiasRelu<AVX512VNNI::Kernels16>(8, 2048, 256, .1f, 1, 0.011f);
+      TestMultiplyBiasRelu<AVX512VNNI::Kernels16>(320, 256, 256, .1f, 1, 0.01f);
+      TestMultiplyBiasRelu<AVX512VNNI::Kernels16>(472, 256, 256, .1f, 1, 0.01f);
+      TestMultiplyBiasRelu<AVX512VNNI::Kernels16>(248, 256, 256, .1f, 1, 0.01f);
+      TestMultiplyBiasRelu<AVX512VNNI::Kernels16>(200, 256, 256, .1f, 1, 0.01f);
+    }
+  #endif
 #endif
 
+// MultiplyFloatA quantizes A with the same routine as PrepareA and runs the
+// same kernels, so the output matches exactly.
+template <class Routine> void TestMultiplyFloatA(Index A_rows, Index width, Index B_cols) {
+  RandomMultiply<Routine> data(A_rows, width, B_cols);
+
+  AlignedVector<float> expected(A_rows * B_cols), actual(A_rows * B_cols);
+  Routine::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(data.unquant_mult, expected.begin()));
+  Routine::MultiplyFloatA(data.A.begin(), data.quant_mult, data.B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(data.unquant_mult, actual.begin()));
+  CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(float)));
+
+  std::fill(actual.begin(), actual.end(), 0.0f);
+  ThreadPool pool(3);
+  Routine::MultiplyFloatA(data.A.begin(), data.quant_mult, data.B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(data.unquant_mult, actual.begin()), pool);
+  CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(float)));
+}
+
+TEST_CASE ("MultiplyFloatA 8bit", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplyFloatA<Int8>(1, 64, 8);
+  TestMultiplyFloatA<Int8>(33, 256, 64);
+  TestMultiplyFloatA<Int8>(70, 512, 200);
+  TestMultiplyFloatA<Int8Shift>(1, 64, 8);
+  TestMultiplyFloatA<Int8Shift>(33, 256, 64);
+  TestMultiplyFloatA<Int8Shift>(70, 512, 200);
+}
+
+#if defined(_OPENMP) && defined(__linux__)
+// Threads in this process.
+std::size_t ProcessThreads() {
+  std::size_t count = 0;
+  DIR *dir = opendir("/proc/self/task");
+  if (!dir) return 0;
+  while (struct dirent *entry = readdir(dir)) {
+    if (entry->d_name[0] != '.') ++count;
+  }
+  closedir(dir);
+  return count;
+}
+
+// Each executor thread quantizes its blocks of A itself: an OpenMP region
+// there would make every worker the master of a team of its own.
+TEST_CASE ("MultiplyFloatA on an executor starts no OpenMP teams", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  // Teams of at least 4 so a nested region would show, even on one core.
+  const int threads = omp_get_max_threads();
+  omp_set_num_threads(std::max(threads, 4));
+  const Index A_rows = 128, width = 256, B_cols = 256;
+  AlignedVector<float> A(A_rows * width), B(width * B_cols), C(A_rows * B_cols);
+  for (std::size_t i = 0; i < A.size(); ++i) A[i] = static_cast<float>(i % 7) - 3.0f;
+  for (std::size_t i = 0; i < B.size(); ++i) B[i] = static_cast<float>(i % 5) - 2.0f;
+  AlignedVector<int8_t> B_prep(B.size());
+  Int8::PrepareB(B.begin(), B_prep.begin(), 1.0f, width, B_cols);
+  ThreadPool pool(4);
+  const std::size_t before = ProcessThreads();
+  for (int i = 0; i < 4; ++i) {
+    Int8::MultiplyFloatA(A.begin(), 1.0f, B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(1.0f, C.begin()), pool);
+    Int8Shift::MultiplyFloatA(A.begin(), 1.0f, B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(1.0f, C.begin()), pool);
+  }
+  CHECK(ProcessThreads() == before);
+  omp_set_num_threads(threads);
+}
+#endif
+
+// PrepareARows then UnquantizeRowsAndWrite is the same as quantizing and
+// multiplying each row on its own with its scale.
+TEST_CASE ("Multiply 8bit with row scales", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  const Index A_rows = 9, width = 256, B_cols = 64;
+  AlignedVector<float> A(A_rows * width), B(width * B_cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (Index r = 0; r < A_rows; ++r) {
+    for (Index c = 0; c < width; ++c) A[r * width + c] = dist(gen) * static_cast<float>(r + 1);
+  }
+  for (auto &it : B) it = dist(gen);
+  const float B_quant_mult = 64.0f;
+  AlignedVector<int8_t> A_prep(A.size()), B_prep(B.size());
+  AlignedVector<float> scales(A_rows);
+  Int8::PrepareARows(A.begin(), A_prep.begin(), scales.begin(), A_rows, width);
+  Int8::PrepareB(B.begin(), B_prep.begin(), B_quant_mult, width, B_cols);
+
+  AlignedVector<float> actual(A_rows * B_cols), expected(A_rows * B_cols);
+  Int8::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeRowsAndWrite(scales.begin(), 1.0f / B_quant_mult, actual.begin()));
+
+  AlignedVector<int8_t> row_prep(width);
+  for (Index r = 0; r < A_rows; ++r) {
+    Int8::PrepareA(A.begin() + r * width, row_prep.begin(), 1.0f / scales[r], 1, width);
+    CHECK(!std::memcmp(row_prep.begin(), A_prep.begin() + r * width, width));
+    Int8::Multiply(A_prep.begin() + r * width, B_prep.begin(), 1, width, B_cols, callbacks::UnquantizeAndWrite(scales[r] * (1.0f / B_quant_mult), expected.begin() + r * B_cols));
+  }
+  CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(float)));
+}
+
+// Columns of B with very different magnitudes each get their own multiplier.
+template <class Routine> void TestColumnScales(bool transposed) {
+  using Integer = typename Routine::Integer;
+  const Index A_rows = 5, width = 256, B_cols = 32;
+  // 64 as elsewhere keeps 8-bit pairs from saturating without VNNI.
+  const float limit = (sizeof(Integer) == 1) ? 64.0f : 1024.0f, A_quant_mult = limit;
+  AlignedVector<float> A(A_rows * width), B(width * B_cols), B_transposed(width * B_cols);
+  AlignedVector<float> quant_mults(B_cols), column_mults(B_cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (auto &it : A) it = dist(gen);
+  for (Index c = 0; c < B_cols; ++c) {
+    const float magnitude = std::ldexp(1.0f, static_cast<int>(c % 11) - 5);
+    for (Index r = 0; r < width; ++r) {
+      B[r * B_cols + c] = B_transposed[c * width + r] = dist(gen) * magnitude;
+    }
+    quant_mults[c] = limit / magnitude;
+    column_mults[c] = 1.0f / quant_mults[c];
+  }
+  AlignedVector<Integer> A_prep(A.size()), B_prep(B.size());
+  Routine::PrepareA(A.begin(), A_prep.begin(), A_quant_mult, A_rows, width);
+  if (transposed) {
+    Routine::PrepareBTransposedColumns(B_transposed.begin(), B_prep.begin(), quant_mults.begin(), width, B_cols);
+  } else {
+    Routine::PrepareBColumns(B.begin(), B_prep.begin(), quant_mults.begin(), width, B_cols);
+  }
+
+  AlignedVector<int32_t> ints(A_rows * B_cols);
+  AlignedVector<float> C(A_rows * B_cols);
+  Routine::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::Write<int32_t>(ints.begin()));
+  Routine::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeColumnsAndWrite(1.0f / A_quant_mult, column_mults.begin(), C.begin()));
+
+  AlignedVector<float> ref(A_rows * B_cols);
+  references::Multiply(A.begin(), B.begin(), ref.begin(), A_rows, width, B_cols, [&](double sum, const callbacks::OutputBufferInfo&) {
+    return static_cast<float>(sum);
+  });
+  for (Index r = 0; r < A_rows; ++r) {
+    for (Index c = 0; c < B_cols; ++c) {
+      const Index i = r * B_cols + c;
+      CHECK(C[i] == static_cast<float>(ints[i]) * ((1.0f / A_quant_mult) * column_mults[c]));
+      // Error relative to the column's own scale.  One multiplier for all of
+      // B would leave the small columns with a few levels and miss this by far.
+      CHECK(std::fabs(C[i] - ref[i]) * quant_mults[c] < 0.1f * width);
+    }
+  }
+}
+
+// Int8Shift's bias correction takes the column scales too.
+TEST_CASE ("Multiply 8bit shift with column scales", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  const Index A_rows = 5, width = 256, B_cols = 32;
+  const float A_quant_mult = 64.0f;
+  AlignedVector<float> A(A_rows * width), B(width * B_cols), bias(B_cols), quant_mults(B_cols), column_mults(B_cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (auto &it : A) it = dist(gen);
+  for (auto &it : B) it = dist(gen);
+  for (Index c = 0; c < B_cols; ++c) {
+    quant_mults[c] = 64.0f / static_cast<float>(c % 4 + 1);
+    column_mults[c] = 1.0f / quant_mults[c];
+    bias[c] = dist(gen);
+  }
+  AlignedVector<int8_t> A_prep(A.size()), A_shift(A.size()), B_prep(B.size());
+  Int8::PrepareA(A.begin(), A_prep.begin(), A_quant_mult, A_rows, width);
+  Int8Shift::PrepareA(A.begin(), A_shift.begin(), A_quant_mult, A_rows, width);
+  Int8Shift::PrepareBColumns(B.begin(), B_prep.begin(), quant_mults.begin(), width, B_cols);
+
+  AlignedVector<float> expected(A_rows * B_cols), actual(A_rows * B_cols), shifted_bias(B_cols);
+  std::copy(bias.begin(), bias.end(), shifted_bias.begin());
+  Int8::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeColumnsAndAddBiasAndWrite(1.0f / A_quant_mult, column_mults.begin(), bias.begin(), expected.begin()));
+  Int8Shift::PrepareBias(B_prep.begin(), width, B_cols, callbacks::UnquantizeColumnsAndAddBiasAndWrite(-127.0f / A_quant_mult, column_mults.begin(), shifted_bias.begin(), shifted_bias.begin()));
+  Int8Shift::Multiply(A_shift.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeColumnsAndAddBiasAndWrite(1.0f / A_quant_mult, column_mults.begin(), shifted_bias.begin(), actual.begin()));
+  for (Index i = 0; i < expected.size(); ++i) {
+    // Same integers, so only float rounding in the bias differs.
+    CHECK(actual[i] == Approx(expected[i]).margin(1e-4));
+  }
+}
+
+TEST_CASE ("Multiply with column scales", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestColumnScales<Int8>(false);
+  TestColumnScales<Int8>(true);
+  TestColumnScales<Int16>(false);
+  TestColumnScales<Int16>(true);
+}
+
+// Int4 is Int8 with B clamped to [-7, 7], so the output matches Int8 on that B.
+void TestMultiply4(Index A_rows, Index width, Index B_cols) {
+  AlignedVector<float> A(A_rows * width), B(width * B_cols), B_clamped(width * B_cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (auto &it : A) it = dist(gen);
+  // Some values beyond 7 / quant_mult check the clamping.
+  const float A_quant_mult = 64.0f, B_quant_mult = 6.0f;
+  for (Index i = 0; i < B.size(); ++i) {
+    B[i] = dist(gen) * 1.5f;
+    B_clamped[i] = std::max(-7.0f, std::min(7.0f, B[i] * B_quant_mult));
+  }
+  AlignedVector<int8_t> A_prep(A.size()), B_prep(B.size()), B_prep4(B.size() / 2);
+  Int8::PrepareA(A.begin(), A_prep.begin(), A_quant_mult, A_rows, width);
+  Int8::PrepareB(B_clamped.begin(), B_prep.begin(), 1.0f, width, B_cols);
+  Int4::PrepareB(B.begin(), B_prep4.begin(), B_quant_mult, width, B_cols);
+
+  const float unquant_mult = 1.0f / (A_quant_mult * B_quant_mult);
+  AlignedVector<float> expected(A_rows * B_cols), actual(A_rows * B_cols);
+  Int8::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(unquant_mult, expected.begin()));
+  Int4::Multiply(A_prep.begin(), B_prep4.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(unquant_mult, actual.begin()));
+  CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(float)));
+
+  std::fill(actual.begin(), actual.end(), 0.0f);
+  ThreadPool pool(3);
+  Int4::Multiply(A_prep.begin(), B_prep4.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(unquant_mult, actual.begin()), pool);
+  CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(float)));
+}
+
+// B pruned in blocks of 64 rows by 8 columns, which is whole tiles for every
+// register width.  Strip 0 is all zero and strip 1 is dense.
+void TestMultiplySparse(Index A_rows, Index width, Index B_cols) {
+  AlignedVector<float> A(A_rows * width), B(width * B_cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::bernoulli_distribution pruned(0.6);
+  for (auto &it : A) it = dist(gen);
+  Index kept = 0;
+  for (Index block = 0; block < width / 64; ++block) {
+    for (Index strip = 0; strip < B_cols / 8; ++strip) {
+      const bool zero = strip == 0 || (strip != 1 && pruned(gen));
+      kept += !zero;
+      for (Index r = block * 64; r < (block + 1) * 64; ++r) {
+        for (Index c = strip * 8; c < (strip + 1) * 8; ++c) {
+          B[r * B_cols + c] = zero ? 0.0f : dist(gen);
+        }
+      }
+    }
+  }
+  // Without VNNI the kernels saturate in 16 bits per call, and sparse B cuts
+  // the calls differently, so keep the values small enough not to.
+  const float quant_mult = 8.0f, unquant_mult = 1.0f / (quant_mult * quant_mult);
+  AlignedVector<int8_t> A_prep(A.size()), B_prep(B.size());
+  Int8::PrepareA(A.begin(), A_prep.begin(), quant_mult, A_rows, width);
+  Int8::PrepareB(B.begin(), B_prep.begin(), quant_mult, width, B_cols);
+  SparseB B_sparse;
+  Int8::PrepareBSparse(B.begin(), B_sparse, quant_mult, width, B_cols);
+  CHECK(B_sparse.Density() == Approx(static_cast<float>(kept) / ((width / 64) * (B_cols / 8))));
+
+  AlignedVector<float> expected(A_rows * B_cols), actual(A_rows * B_cols);
+  Int8::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(unquant_mult, expected.begin()));
+  Int8::MultiplySparse(A_prep.begin(), B_sparse, A_rows, callbacks::UnquantizeAndWrite(unquant_mult, actual.begin()));
+  CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(float)));
+
+  std::fill(actual.begin(), actual.end(), 1.0f);
+  ThreadPool pool(3);
+  Int8::MultiplySparse(A_prep.begin(), B_sparse, A_rows, callbacks::UnquantizeAndWrite(unquant_mult, actual.begin()), pool);
+  CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(float)));
+}
+
+// MultiplyColumns against SelectColumnsB then Multiply, with the selection
+// checked against PrepareB of the same columns in float space.
+void TestMultiplyColumns(Index A_rows, Index width, Index B_cols, Index selected) {
+  RandomMultiply<Int8> data(A_rows, width, B_cols);
+  std::vector<Index> cols(selected);
+  std::uniform_int_distribution<Index> col_dist(0, B_cols - 1);
+  for (auto &it : cols) it = col_dist(data.gen);
+  AlignedVector<int8_t> B_selected(width * selected), B_ref(width * selected);
+  Int8::SelectColumnsB(data.B_prep.begin(), B_selected.begin(), width, cols.data(), cols.data() + selected);
+
+  AlignedVector<float> B_float_selected(width * selected);
+  for (Index r = 0; r < width; ++r) {
+    for (Index c = 0; c < selected; ++c) {
+      B_float_selected[r * selected + c] = data.B[r * B_cols + cols[c]];
+    }
+  }
+  Int8::PrepareB(B_float_selected.begin(), B_ref.begin(), data.quant_mult, width, selected);
+  CHECK(!std::memcmp(B_ref.begin(), B_selected.begin(), B_ref.size()));
+
+  AlignedVector<float> expected(A_rows * selected), actual(A_rows * selected);
+  Int8::Multiply(data.A_prep.begin(), B_selected.begin(), A_rows, width, selected, callbacks::UnquantizeAndWrite(data.unquant_mult, expected.begin()));
+  Int8::MultiplyColumns(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, cols.data(), cols.data() + selected, callbacks::UnquantizeAndWrite(data.unquant_mult, actual.begin()));
+  CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(float)));
+
+  std::fill(actual.begin(), actual.end(), 1.0f);
+  ThreadPool pool(3);
+  Int8::MultiplyColumns(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, cols.data(), cols.data() + selected, callbacks::UnquantizeAndWrite(data.unquant_mult, actual.begin()), pool);
+  CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(float)));
+}
+
+// PrepareBStream and PrepareBRows against PrepareB of all of B at once.
+template <class Routine> void TestPrepareBStream(Index rows, Index cols, Index chunk_rows) {
+  using Integer = typename Routine::Integer;
+  AlignedVector<float> B(rows * cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (auto &it : B) it = dist(gen);
+  AlignedVector<Integer> expected(B.size()), actual(B.size());
+  Routine::PrepareB(B.begin(), expected.begin(), 64.0f, rows, cols);
+  Index reads = 0;
+  Routine::PrepareBStream([&](float *to, Index begin, Index end) {
+    std::copy(B.begin() + begin * cols, B.begin() + end * cols, to);
+    ++reads;
+  }, actual.begin(), 64.0f, rows, cols, chunk_rows);
+  CHECK(reads == (rows + chunk_rows - 1) / chunk_rows);
+  CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(Integer)));
+}
+
+// PrepareBQuantizedTransposedInPlace against PrepareBQuantizedTransposed.
+void TestPrepareBQuantizedTransposedInPlace(Index inner, Index B_cols) {
+  AlignedVector<float> B_transposed(inner * B_cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (auto &it : B_transposed) it = dist(gen);
+  AlignedVector<int8_t> quantized(B_transposed.size()), expected(B_transposed.size());
+  Int8::Quantize(B_transposed.begin(), quantized.begin(), 64.0f, static_cast<Index>(B_transposed.size()));
+  Int8::PrepareBQuantizedTransposed(quantized.begin(), expected.begin(), inner, B_cols);
+  Int8::PrepareBQuantizedTransposedInPlace(quantized.begin(), inner, B_cols);
+  CHECK(!std::memcmp(expected.begin(), quantized.begin(), expected.size()));
+}
+
+// The Write callbacks with Store::Stream against normal stores, including C
+// as a block of a wider matrix whose rows aren't vector aligned.
+void TestMultiplyStream(Index A_rows, Index width, Index B_cols, Index ldc) {
+  RandomMultiply<Int8> data(A_rows, width, B_cols);
+  AlignedVector<float> expected(A_rows * ldc), actual(A_rows * ldc);
+  auto check = [&](std::function<void(float *, callbacks::Store)> multiply) {
+    std::fill(expected.begin(), expected.end(), 0.0f);
+    std::fill(actual.begin(), actual.end(), 0.0f);
+    multiply(expected.begin(), callbacks::Store::Normal);
+    multiply(actual.begin(), callbacks::Store::Stream);
+    CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(float)));
+  };
+  check([&](float *C, callbacks::Store store) {
+    Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::Strided(ldc, callbacks::UnquantizeAndWrite(data.unquant_mult, C, store)));
+  });
+  check([&](float *C, callbacks::Store store) {
+    Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::Strided(ldc, callbacks::UnquantizeAndWriteRelu(data.unquant_mult, C, store)));
+  });
+  check([&](float *C, callbacks::Store store) {
+    Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::Strided(ldc, callbacks::UnquantizeAndAddBiasAndWrite(data.unquant_mult, data.bias.begin(), C, store)));
+  });
+  check([&](float *C, callbacks::Store store) {
+    ThreadPool pool(3);
+    Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::Strided(ldc, callbacks::UnquantizeAndAddBiasAndWriteRelu(data.unquant_mult, data.bias.begin(), C, store)), pool);
+  });
+}
+
+// Softmax and log softmax of C from the fused callbacks and their finishers,
+// against the same on the logits.
+void TestMultiplySoftmax(Index A_rows, Index width, Index B_cols) {
+  RandomMultiply<Int8> data(A_rows, width, B_cols, 64.0f, 8.0f);
+
+  AlignedVector<float> logits(A_rows * B_cols), expected(A_rows * B_cols), expected_log(A_rows * B_cols);
+  Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndWrite(data.unquant_mult, data.bias.begin(), logits.begin()));
+  for (Index r = 0; r < A_rows; ++r) {
+    const float *row = logits.begin() + r * B_cols;
+    const float max = *std::max_element(row, row + B_cols);
+    double sum = 0.0;
+    for (Index c = 0; c < B_cols; ++c) sum += std::exp(static_cast<double>(row[c] - max));
+    for (Index c = 0; c < B_cols; ++c) {
+      expected[r * B_cols + c] = static_cast<float>(std::exp(static_cast<double>(row[c] - max)) / sum);
+      expected_log[r * B_cols + c] = static_cast<float>(row[c] - max - std::log(sum));
+    }
+  }
+
+  AlignedVector<float> actual(A_rows * B_cols), stats(A_rows * B_cols / 4);
+  ThreadPool pool(3);
+  for (int run = 0; run < 2; ++run) {
+    std::fill(actual.begin(), actual.end(), 1.0f);
+    auto softmax = callbacks::UnquantizeAndAddBiasAndSoftmax(data.unquant_mult, data.bias.begin(), actual.begin(), stats.begin());
+    if (run) {
+      Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, softmax, pool);
+    } else {
+      Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, softmax);
+    }
+    if (run) {
+      FinishSoftmax(actual.begin(), stats.begin(), A_rows, B_cols, pool);
+    } else {
+      FinishSoftmax(actual.begin(), stats.begin(), A_rows, B_cols);
+    }
+    for (Index i = 0; i < actual.size(); ++i) {
+      CHECK_EPS(actual[i], expected[i], 1e-5f + 1e-3f * expected[i]);
+    }
+
+    std::fill(actual.begin(), actual.end(), 1.0f);
+    auto log_softmax = callbacks::UnquantizeAndAddBiasAndLogSoftmax(data.unquant_mult, data.bias.begin(), actual.begin(), stats.begin());
+    if (run) {
+      Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, log_softmax, pool);
+    } else {
+      Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, log_softmax);
+    }
+    if (run) {
+      FinishLogSoftmax(actual.begin(), stats.begin(), A_rows, B_cols, pool);
+    } else {
+      FinishLogSoftmax(actual.begin(), stats.begin(), A_rows, B_cols);
+    }
+    for (Index i = 0; i < actual.size(); ++i) {
+      CHECK_EPS(actual[i], expected_log[i], 1e-3f);
+    }
+  }
+}
+
+TEST_CASE ("Multiply 8bit softmax", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplySoftmax(1, 64, 8);
+  TestMultiplySoftmax(33, 256, 64);
+  TestMultiplySoftmax(70, 1024, 200);
+  TestMultiplySoftmax(40, 256, 520);
+}
+
+// Top k of each row from the fused callback against sorting the logits.
+void TestMultiplyTopK(Index A_rows, Index width, Index B_cols, Index k) {
+  RandomMultiply<Int8> data(A_rows, width, B_cols);
+
+  AlignedVector<float> logits(A_rows * B_cols);
+  Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndWrite(data.unquant_mult, data.bias.begin(), logits.begin()));
+  std::vector<Index> expected(A_rows * k), order(B_cols);
+  for (Index r = 0; r < A_rows; ++r) {
+    const float *row = logits.begin() + r * B_cols;
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [row](Index a, Index b) { return row[a] > row[b]; });
+    std::copy(order.begin(), order.begin() + k, expected.begin() + r * k);
+  }
+
+  std::vector<float> scores(A_rows * k);
+  std::vector<Index> indices(A_rows * k);
+  ThreadPool pool(3);
+  for (int run = 0; run < 2; ++run) {
+    auto top_k = callbacks::UnquantizeAndAddBiasAndTopK(data.unquant_mult, data.bias.begin(), k, scores.data(), indices.data(), A_rows);
+    if (run) {
+      Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, top_k, pool);
+    } else {
+      Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, top_k);
+    }
+    CHECK(indices == expected);
+    for (Index i = 0; i < scores.size(); ++i) {
+      CHECK(scores[i] == logits[(i / k) * B_cols + expected[i]]);
+    }
+  }
+}
+
+TEST_CASE ("Multiply 8bit top k", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplyTopK(1, 64, 8, 1);
+  TestMultiplyTopK(1, 64, 8, 8);
+  TestMultiplyTopK(33, 256, 64, 4);
+  TestMultiplyTopK(70, 1024, 200, 16);
+}
+
+// The activation callbacks against the activation of UnquantizeAndAddBiasAndWrite.
+template <class Callback, class Reference> void TestMultiplyActivation(Index A_rows, Index width, Index B_cols, Reference reference) {
+  RandomMultiply<Int8> data(A_rows, width, B_cols, 64.0f, 4.0f);
+
+  AlignedVector<float> logits(A_rows * B_cols), actual(A_rows * B_cols);
+  Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndWrite(data.unquant_mult, data.bias.begin(), logits.begin()));
+  Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, Callback(data.unquant_mult, data.bias.begin(), actual.begin()));
+  for (Index i = 0; i < actual.size(); ++i) {
+    CHECK_EPS(actual[i], reference(logits[i]), 0.001f * (1 + std::fabs(logits[i])));
+  }
+}
+
+TEST_CASE ("Multiply 8bit with bias and activations", "[biased_multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  auto gelu = [](float x) { return 0.5f * x * (1 + std::tanh(0.7978845608f * (x + 0.044715f * x * x * x))); };
+  auto silu = [](float x) { return x / (1 + std::exp(-x)); };
+  auto sigmoid = [](float x) { return 1 / (1 + std::exp(-x)); };
+  auto tanh = [](float x) { return std::tanh(x); };
+  TestMultiplyActivation<callbacks::UnquantizeAndAddBiasAndWriteGelu>(8, 256, 64, gelu);
+  TestMultiplyActivation<callbacks::UnquantizeAndAddBiasAndWriteSilu>(8, 256, 64, silu);
+  TestMultiplyActivation<callbacks::UnquantizeAndAddBiasAndWriteSigmoid>(8, 256, 64, sigmoid);
+  TestMultiplyActivation<callbacks::UnquantizeAndAddBiasAndWriteTanh>(8, 256, 64, tanh);
+  TestMultiplyActivation<callbacks::UnquantizeAndAddBiasAndWriteGelu>(33, 1024, 200, gelu);
+}
+
+// Requantizing in the callback matches writing floats then PrepareA.
+template <class Routine, callbacks::Activation kActivation, class FloatCallback> void TestMultiplyRequantize(Index A_rows, Index width, Index B_cols) {
+  typedef typename std::conditional<std::is_same<Routine, Int8Shift>::value, uint8_t, int8_t>::type Output;
+  RandomMultiply<Int8> data(A_rows, width, B_cols);
+  const float next_quant_mult = 20.0f;
+
+  AlignedVector<float> C(A_rows * B_cols);
+  Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, FloatCallback(data.unquant_mult, data.bias.begin(), C.begin()));
+  AlignedVector<int8_t> expected(C.size());
+  AlignedVector<Output> actual(C.size());
+  Routine::PrepareA(C.begin(), expected.begin(), next_quant_mult, A_rows, B_cols);
+  Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAddBiasActivateAndQuantize<Output, kActivation>(data.unquant_mult, data.bias.begin(), next_quant_mult, actual.begin()));
+  CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size()));
+}
+
+TEST_CASE ("Multiply 8bit requantize", "[biased_multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  using callbacks::Activation;
+  TestMultiplyRequantize<Int8, Activation::None, callbacks::UnquantizeAndAddBiasAndWrite>(8, 256, 64);
+  TestMultiplyRequantize<Int8, Activation::Relu, callbacks::UnquantizeAndAddBiasAndWriteRelu>(33, 256, 128);
+  TestMultiplyRequantize<Int8, Activation::Gelu, callbacks::UnquantizeAndAddBiasAndWriteGelu>(33, 512, 128);
+  TestMultiplyRequantize<Int8Shift, Activation::None, callbacks::UnquantizeAndAddBiasAndWrite>(8, 256, 64);
+  TestMultiplyRequantize<Int8Shift, Activation::Tanh, callbacks::UnquantizeAndAddBiasAndWriteTanh>(33, 512, 128);
+}
+
+// Residual add and row statistics against UnquantizeAndAddBiasAndWrite, then
+// LayerNorm against normalizing directly.
+void TestMultiplyResidual(Index A_rows, Index width, Index B_cols) {
+  RandomMultiply<Int8> data(A_rows, width, B_cols);
+  AlignedVector<float> residual(A_rows * B_cols), gamma(B_cols), beta(B_cols);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (auto &it : residual) it = 3.0f + dist(data.gen);
+  for (auto &it : gamma) it = 1.0f + dist(data.gen);
+  for (auto &it : beta) it = dist(data.gen);
+
+  AlignedVector<float> expected(A_rows * B_cols), normalized(A_rows * B_cols);
+  Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndWrite(data.unquant_mult, data.bias.begin(), expected.begin()));
+  std::vector<double> expected_stats(2 * A_rows);
+  for (Index r = 0; r < A_rows; ++r) {
+    for (Index c = 0; c < B_cols; ++c) {
+      float &value = expected[r * B_cols + c];
+      value += residual[r * B_cols + c];
+      expected_stats[2 * r] += value;
+      expected_stats[2 * r + 1] += static_cast<double>(value) * value;
+    }
+    const double mean = expected_stats[2 * r] / B_cols;
+    const double stddev = std::sqrt(expected_stats[2 * r + 1] / B_cols - mean * mean + 1e-5);
+    for (Index c = 0; c < B_cols; ++c) {
+      normalized[r * B_cols + c] = static_cast<float>((expected[r * B_cols + c] - mean) / stddev * gamma[c] + beta[c]);
+    }
+  }
+
+  AlignedVector<float> actual(A_rows * B_cols);
+  std::vector<double> stats(2 * A_rows);
+  ThreadPool pool(3);
+  for (int run = 0; run < 2; ++run) {
+    auto residual_add = callbacks::UnquantizeAndAddBiasAndResidualAndWrite(data.unquant_mult, data.bias.begin(), residual.begin(), actual.begin(), stats.data(), A_rows);
+    if (run) {
+      Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, residual_add, pool);
+    } else {
+      Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, residual_add);
+    }
+    CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(float)));
+    for (Index i = 0; i < stats.size(); ++i) {
+      CHECK(stats[i] == Approx(expected_stats[i]).epsilon(1e-5));
+    }
+    LayerNorm(actual.begin(), stats.data(), gamma.begin(), beta.begin(), A_rows, B_cols);
+    for (Index i = 0; i < actual.size(); ++i) {
+      CHECK_EPS(actual[i], normalized[i], 1e-3f);
+    }
+  }
+}
+
+TEST_CASE ("Multiply 8bit with residual and row stats", "[biased_multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplyResidual(1, 64, 8);
+  TestMultiplyResidual(33, 256, 64);
+  TestMultiplyResidual(70, 1024, 200);
+}
+
+// A block of columns of a wider A multiplied into a block of columns of a
+// wider C, against copying the block of A out and writing C compact.
+template <class Routine> void TestMultiplyStrided(Index A_rows, Index width, Index B_cols) {
+  typedef typename Routine::Integer Integer;
+  const Index lda = width + 128, A_offset = 64, ldc = B_cols + 16, C_offset = 8;
+  AlignedVector<float> A(A_rows * lda), B(width * B_cols), bias(B_cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (auto &it : A) it = dist(gen);
+  for (auto &it : B) it = dist(gen);
+  for (auto &it : bias) it = dist(gen);
+  const float quant_mult = 64.0f, unquant_mult = 1.0f / (quant_mult * quant_mult);
+  AlignedVector<Integer> A_prep(A.size()), A_block(A_rows * width), B_prep(B.size());
+  Routine::PrepareA(A.begin(), A_prep.begin(), quant_mult, A_rows, lda);
+  for (Index r = 0; r < A_rows; ++r) {
+    std::copy(A_prep.begin() + r * lda + A_offset, A_prep.begin() + r * lda + A_offset + width, A_block.begin() + r * width);
+  }
+  Routine::PrepareB(B.begin(), B_prep.begin(), quant_mult, width, B_cols);
+
+  AlignedVector<float> expected(A_rows * B_cols);
+  Routine::Multiply(A_block.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndWrite(unquant_mult, bias.begin(), expected.begin()));
+
+  AlignedVector<float> C(A_rows * ldc);
+  ThreadPool pool(3);
+  for (int run = 0; run < 2; ++run) {
+    std::fill(C.begin(), C.end(), -1.0f);
+    auto callback = callbacks::Strided(ldc, callbacks::UnquantizeAndAddBiasAndWrite(unquant_mult, bias.begin(), C.begin() + C_offset));
+    if (run) {
+      Routine::Multiply(A_prep.begin() + A_offset, lda, B_prep.begin(), A_rows, width, B_cols, callback, pool);
+    } else {
+      Routine::Multiply(A_prep.begin() + A_offset, lda, B_prep.begin(), A_rows, width, B_cols, callback);
+    }
+    for (Index r = 0; r < A_rows; ++r) {
+      for (Index c = 0; c < ldc; ++c) {
+        const bool inside = c >= C_offset && c < C_offset + B_cols;
+        CHECK(C[r * ldc + c] == (inside ? expected[r * B_cols + c - C_offset] : -1.0f));
+      }
+    }
+  }
+}
+
+TEST_CASE ("Multiply strided", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplyStrided<Int8>(1, 64, 8);
+  TestMultiplyStrided<Int8>(35, 256, 64);
+  TestMultiplyStrided<Int8>(70, 1024, 200);
+  TestMultiplyStrided<Int16>(1, 64, 8);
+  TestMultiplyStrided<Int16>(35, 256, 64);
+}
+
+// Any shape with the Padded functions against padding by hand then Multiply.
+void TestMultiplyPadded(Index A_rows, Index width, Index B_cols) {
+  const Index padded_width = Int8::PaddedWidth(width), padded_cols = Int8::PaddedCols(B_cols);
+  AlignedVector<float> A(A_rows * width), B(width * B_cols), bias(padded_cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (auto &it : A) it = dist(gen);
+  for (auto &it : B) it = dist(gen);
+  for (auto &it : bias) it = dist(gen);
+  AlignedVector<float> A_padded(A_rows * padded_width), B_padded(padded_width * padded_cols);
+  std::fill(A_padded.begin(), A_padded.end(), 0.0f);
+  std::fill(B_padded.begin(), B_padded.end(), 0.0f);
+  for (Index r = 0; r < A_rows; ++r) {
+    std::copy(A.begin() + r * width, A.begin() + (r + 1) * width, A_padded.begin() + r * padded_width);
+  }
+  for (Index r = 0; r < width; ++r) {
+    std::copy(B.begin() + r * B_cols, B.begin() + (r + 1) * B_cols, B_padded.begin() + r * padded_cols);
+  }
+  const float quant_mult = 64.0f, unquant_mult = 1.0f / (quant_mult * quant_mult);
+
+  AlignedVector<int8_t> A_prep(A_padded.size()), B_prep(B_padded.size());
+  Int8::PrepareA(A_padded.begin(), A_prep.begin(), quant_mult, A_rows, padded_width);
+  Int8::PrepareB(B_padded.begin(), B_prep.begin(), quant_mult, padded_width, padded_cols);
+  AlignedVector<float> expected(A_rows * padded_cols);
+  Int8::Multiply(A_prep.begin(), B_prep.begin(), A_rows, padded_width, padded_cols, callbacks::UnquantizeAndAddBiasAndWrite(unquant_mult, bias.begin(), expected.begin()));
+
+  AlignedVector<int8_t> A_test(A_padded.size()), B_test(B_padded.size());
+  Int8::PrepareAPadded(A.begin(), A_test.begin(), quant_mult, A_rows, width);
+  Int8::PrepareBPadded(B.begin(), B_test.begin(), quant_mult, width, B_cols);
+  CHECK(!std::memcmp(A_prep.begin(), A_test.begin(), A_prep.size()));
+  CHECK(!std::memcmp(B_prep.begin(), B_test.begin(), B_prep.size()));
+
+  // C is exactly A_rows * B_cols, followed by values that must stay put.
+  AlignedVector<float> C(A_rows * B_cols + 8);
+  ThreadPool pool(3);
+  for (int run = 0; run < 2; ++run) {
+    std::fill(C.begin(), C.end(), -1.0f);
+    auto callback = callbacks::UnquantizeAndAddBiasAndWrite(unquant_mult, bias.begin(), C.begin());
+    if (run) {
+      Int8::MultiplyPadded(A_test.begin(), B_test.begin(), A_rows, width, B_cols, callback, pool);
+    } else {
+      Int8::MultiplyPadded(A_test.begin(), B_test.begin(), A_rows, width, B_cols, callback);
+    }
+    for (Index r = 0; r < A_rows; ++r) {
+      for (Index c = 0; c < B_cols; ++c) {
+        CHECK(C[r * B_cols + c] == expected[r * padded_cols + c]);
+      }
+    }
+    for (Index i = A_rows * B_cols; i < C.size(); ++i) {
+      CHECK(C[i] == -1.0f);
+    }
+  }
+}
+
+TEST_CASE ("Multiply 8bit padded", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplyPadded(1, 64, 8);
+  TestMultiplyPadded(1, 100, 3);
+  TestMultiplyPadded(33, 1000, 203);
+  TestMultiplyPadded(70, 130, 13);
+}
+
+// MultiplyFixed and the function it resolves to against Multiply.
+template <Index kWidth, Index kBCols> void TestMultiplyFixed(Index A_rows) {
+  RandomMultiply<Int8> data(A_rows, kWidth, kBCols);
+
+  AlignedVector<float> expected(A_rows * kBCols), actual(A_rows * kBCols);
+  Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, kWidth, kBCols, callbacks::UnquantizeAndAddBiasAndWrite(data.unquant_mult, data.bias.begin(), expected.begin()));
+  Int8::MultiplyFixed<kWidth, kBCols>(data.A_prep.begin(), data.B_prep.begin(), A_rows, callbacks::UnquantizeAndAddBiasAndWrite(data.unquant_mult, data.bias.begin(), actual.begin()));
+  CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(float)));
+
+  std::fill(actual.begin(), actual.end(), 0.0f);
+  auto function = Int8::MultiplyFixedFunction<kWidth, kBCols, callbacks::UnquantizeAndAddBiasAndWrite>();
+  function(data.A_prep.begin(), data.B_prep.begin(), A_rows, callbacks::UnquantizeAndAddBiasAndWrite(data.unquant_mult, data.bias.begin(), actual.begin()));
+  CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(float)));
+}
+
+TEST_CASE ("Multiply 8bit fixed shape", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplyFixed<64, 8>(1);
+  TestMultiplyFixed<512, 512>(1);
+  TestMultiplyFixed<256, 24>(35);
+}
+
+// Shapes listed in FixedShapes run their MultiplyFixed kernel; others fall back.
+template <class ModelShapes> void TestFixedShapes(Index A_rows, Index width, Index B_cols) {
+  RandomMultiply<Int8> data(A_rows, width, B_cols);
+
+  AlignedVector<float> expected(A_rows * B_cols), actual(A_rows * B_cols);
+  Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndWrite(data.unquant_mult, data.bias.begin(), expected.begin()));
+  ModelShapes::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndWrite(data.unquant_mult, data.bias.begin(), actual.begin()));
+  CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(float)));
+}
+
+TEST_CASE ("Multiply 8bit fixed shapes lookup", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  typedef callbacks::UnquantizeAndAddBiasAndWrite Callback;
+  typedef FixedShapes<Callback, FixedShape<64, 8>, FixedShape<256, 24>, FixedShape<512, 512> > ModelShapes;
+  CHECK(ModelShapes::Find(64, 8) == (Int8::MultiplyFixedFunction<64, 8, Callback>()));
+  CHECK(ModelShapes::Find(256, 24) == (Int8::MultiplyFixedFunction<256, 24, Callback>()));
+  CHECK(ModelShapes::Find(512, 512) == (Int8::MultiplyFixedFunction<512, 512, Callback>()));
+  CHECK(ModelShapes::Find(256, 8) == nullptr);
+  CHECK(ModelShapes::Find(24, 256) == nullptr);
+  TestFixedShapes<ModelShapes>(1, 64, 8);
+  TestFixedShapes<ModelShapes>(35, 256, 24);
+  TestFixedShapes<ModelShapes>(3, 512, 512);
+  // Listed but big enough for Int8::Multiply's threads.
+  TestFixedShapes<ModelShapes>(ModelShapes::kThreadedWork / (512 * 512) + 3, 512, 512);
+  // Not listed.
+  TestFixedShapes<ModelShapes>(5, 128, 16);
+}
+
+// A batch of multiplies against running each with Multiply.
+void TestMultiplyBatched(Index batch, Index A_rows, Index width, Index B_cols) {
+  const std::size_t A_size = A_rows * width, B_size = width * B_cols, C_size = A_rows * B_cols;
+  AlignedVector<float> A(batch * A_size), B(batch * B_size), bias(B_cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (auto &it : A) it = dist(gen);
+  for (auto &it : B) it = dist(gen);
+  for (auto &it : bias) it = dist(gen);
+  const float quant_mult = 64.0f, unquant_mult = 1.0f / (quant_mult * quant_mult);
+  AlignedVector<int8_t> A_prep(A.size()), B_prep(B.size());
+  Int8::PrepareA(A.begin(), A_prep.begin(), quant_mult, batch * A_rows, width);
+  for (Index i = 0; i < batch; ++i) {
+    Int8::PrepareB(B.begin() + i * B_size, B_prep.begin() + i * B_size, quant_mult, width, B_cols);
+  }
+
+  AlignedVector<float> expected(batch * C_size), actual(batch * C_size);
+  std::vector<const int8_t*> A_items, B_items;
+  std::vector<callbacks::UnquantizeAndAddBiasAndWrite> items;
+  for (Index i = 0; i < batch; ++i) {
+    Int8::Multiply(A_prep.begin() + i * A_size, B_prep.begin() + i * B_size, A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndWrite(unquant_mult, bias.begin(), expected.begin() + i * C_size));
+    A_items.push_back(A_prep.begin() + i * A_size);
+    B_items.push_back(B_prep.begin() + i * B_size);
+    items.push_back(callbacks::UnquantizeAndAddBiasAndWrite(unquant_mult, bias.begin(), actual.begin() + i * C_size));
+  }
+
+  ThreadPool pool(3);
+  for (int run = 0; run < 4; ++run) {
+    std::fill(actual.begin(), actual.end(), -1.0f);
+    switch (run) {
+      case 0:
+        Int8::MultiplyBatched(A_items.data(), B_items.data(), A_rows, width, B_cols, items.data(), batch);
+        break;
+      case 1:
+        Int8::MultiplyBatched(A_items.data(), B_items.data(), A_rows, width, B_cols, items.data(), batch, pool);
+        break;
+      case 2:
+        Int8::MultiplyBatched(A_prep.begin(), A_size, B_prep.begin(), B_size, A_rows, width, B_cols, items.data(), batch);
+        break;
+      default:
+        Int8::MultiplyBatched(A_prep.begin(), A_size, B_prep.begin(), B_size, A_rows, width, B_cols, items.data(), batch, pool);
+    }
+    CHECK(!std::memcmp(expected.begin(), actual.begin(), expected.size() * sizeof(float)));
+  }
+}
+
+TEST_CASE ("Multiply 8bit batched", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplyBatched(1, 1, 64, 8);
+  TestMultiplyBatched(2, 33, 256, 64);
+  TestMultiplyBatched(16, 5, 64, 16);
+}
+
+// One A by several Bs against multiplying by each with Multiply.
+void TestMultiplyMulti(Index A_rows, Index width, const std::vector<Index> &B_cols) {
+  const Index count = static_cast<Index>(B_cols.size());
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  AlignedVector<float> A(A_rows * width);
+  for (auto &it : A) it = dist(gen);
+  const float quant_mult = 64.0f, unquant_mult = 1.0f / (quant_mult * quant_mult);
+  AlignedVector<int8_t> A_prep(A.size());
+  Int8::PrepareA(A.begin(), A_prep.begin(), quant_mult, A_rows, width);
+
+  std::vector<AlignedVector<int8_t>> B_prep;
+  std::vector<AlignedVector<float>> bias, expected, actual;
+  std::vector<const int8_t*> B_items;
+  std::vector<callbacks::UnquantizeAndAddBiasAndWrite> items;
+  for (Index i = 0; i < count; ++i) {
+    AlignedVector<float> B(width * B_cols[i]);
+    for (auto &it : B) it = dist(gen);
+    B_prep.emplace_back(B.size());
+    Int8::PrepareB(B.begin(), B_prep.back().begin(), quant_mult, width, B_cols[i]);
+    bias.emplace_back(B_cols[i]);
+    for (auto &it : bias.back()) it = dist(gen);
+    expected.emplace_back(A_rows * B_cols[i]);
+    actual.emplace_back(A_rows * B_cols[i]);
+    Int8::Multiply(A_prep.begin(), B_prep.back().begin(), A_rows, width, B_cols[i], callbacks::UnquantizeAndAddBiasAndWrite(unquant_mult, bias.back().begin(), expected.back().begin()));
+  }
+  for (Index i = 0; i < count; ++i) {
+    B_items.push_back(B_prep[i].begin());
+    items.push_back(callbacks::UnquantizeAndAddBiasAndWrite(unquant_mult, bias[i].begin(), actual[i].begin()));
+  }
+
+  ThreadPool pool(3);
+  for (int run = 0; run < 2; ++run) {
+    for (auto &C : actual) std::fill(C.begin(), C.end(), -1.0f);
+    if (run) {
+      Int8::MultiplyMulti(A_prep.begin(), B_items.data(), B_cols.data(), A_rows, width, items.data(), count, pool);
+    } else {
+      Int8::MultiplyMulti(A_prep.begin(), B_items.data(), B_cols.data(), A_rows, width, items.data(), count);
+    }
+    for (Index i = 0; i < count; ++i) {
+      CHECK(!std::memcmp(expected[i].begin(), actual[i].begin(), expected[i].size() * sizeof(float)));
+    }
+  }
+}
+
+TEST_CASE ("Multiply 8bit multiple B", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplyMulti(1, 64, {8});
+  TestMultiplyMulti(33, 256, {64, 64, 64});
+  TestMultiplyMulti(70, 512, {16, 200, 8});
+}
+
+// silu(A * gate) * (A * up) from one MultiplyMulti, in place and not.
+void TestMultiplyGatedSilu(Index A_rows, Index width, Index B_cols) {
+  AlignedVector<float> A(A_rows * width), gate(width * B_cols), up(width * B_cols), gate_bias(B_cols), up_bias(B_cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f), bias_dist(-4.0f, 4.0f);
+  for (auto &it : A) it = dist(gen);
+  for (auto &it : gate) it = dist(gen);
+  for (auto &it : up) it = dist(gen);
+  for (auto &it : gate_bias) it = bias_dist(gen);
+  for (auto &it : up_bias) it = bias_dist(gen);
+  const float quant_mult = 64.0f, unquant_mult = 1.0f / (quant_mult * quant_mult);
+  AlignedVector<int8_t> A_prep(A.size()), gate_prep(gate.size()), up_prep(up.size());
+  Int8::PrepareA(A.begin(), A_prep.begin(), quant_mult, A_rows, width);
+  Int8::PrepareB(gate.begin(), gate_prep.begin(), quant_mult, width, B_cols);
+  Int8::PrepareB(up.begin(), up_prep.begin(), quant_mult, width, B_cols);
+
+  AlignedVector<float> gate_out(A_rows * B_cols), up_out(A_rows * B_cols), actual(A_rows * B_cols);
+  Int8::Multiply(A_prep.begin(), gate_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndWrite(unquant_mult, gate_bias.begin(), gate_out.begin()));
+  Int8::Multiply(A_prep.begin(), up_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndWrite(unquant_mult, up_bias.begin(), up_out.begin()));
+
+  const int8_t *B_items[2] = {gate_prep.begin(), up_prep.begin()};
+  const Index B_cols_items[2] = {B_cols, B_cols};
+  for (int in_place = 0; in_place < 2; ++in_place) {
+    AlignedVector<float> scratch(A_rows * B_cols);
+    float *gate_addr = in_place ? actual.begin() : scratch.begin();
+    const callbacks::UnquantizeAndAddBiasAndMultiplySilu items[2] = {
+      callbacks::UnquantizeAndAddBiasAndMultiplySilu(unquant_mult, gate_bias.begin(), nullptr, gate_addr),
+      callbacks::UnquantizeAndAddBiasAndMultiplySilu(unquant_mult, up_bias.begin(), gate_addr, actual.begin())};
+    Int8::MultiplyMulti(A_prep.begin(), B_items, B_cols_items, A_rows, width, items, 2);
+    for (Index i = 0; i < actual.size(); ++i) {
+      const float expected = gate_out[i] / (1 + std::exp(-gate_out[i])) * up_out[i];
+      CHECK_EPS(actual[i], expected, 0.001f * (1 + std::fabs(expected)));
+    }
+  }
+}
+
+TEST_CASE ("Multiply 8bit gated SiLU", "[biased_multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplyGatedSilu(8, 256, 64);
+  TestMultiplyGatedSilu(33, 1024, 200);
+}
+
+// An LSTM or GRU step from one multiply against the gates written by
+// UnquantizeAndAddBiasAndWrite and activated with std::exp and std::tanh,
+// with the cell and hidden state updated in place and not.
+float TestSigmoid(float x) { return 1.0f / (1.0f + std::exp(-x)); }
+
+void TestRecurrentCell(Index gates, Index A_rows, Index width, Index hidden) {
+  const Index cols = gates * hidden;
+  RandomMultiply<Int8> data(A_rows, width, cols, 64.0f, 2.0f);
+  AlignedVector<float> input(A_rows * cols), state(A_rows * hidden), cell(A_rows * hidden);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f), bias_dist(-2.0f, 2.0f);
+  for (auto &it : input) it = bias_dist(data.gen);
+  for (auto &it : cell) it = bias_dist(data.gen);
+  for (auto &it : state) it = dist(data.gen);
+
+  AlignedVector<float> raw(A_rows * cols);
+  Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, cols, callbacks::UnquantizeAndAddBiasAndWrite(data.unquant_mult, data.bias.begin(), raw.begin()));
+  std::vector<float> expected_cell(A_rows * hidden), expected_hidden(A_rows * hidden);
+  for (Index r = 0; r < A_rows; ++r) {
+    for (Index u = 0; u < hidden; ++u) {
+      const Index unit = r * hidden + u;
+      auto gate = [&](Index g) { return r * cols + callbacks::RecurrentGateColumn(gates, g, u); };
+      if (gates == 4) {
+        const float i = TestSigmoid(raw[gate(0)] + input[gate(0)]), f = TestSigmoid(raw[gate(1)] + input[gate(1)]);
+        const float g = std::tanh(raw[gate(2)] + input[gate(2)]), o = TestSigmoid(raw[gate(3)] + input[gate(3)]);
+        expected_cell[unit] = f * cell[unit] + i * g;
+        expected_hidden[unit] = o * std::tanh(expected_cell[unit]);
+      } else {
+        const float reset = TestSigmoid(raw[gate(0)] + input[gate(0)]), update = TestSigmoid(raw[gate(1)] + input[gate(1)]);
+        const float n = std::tanh(input[gate(2)] + reset * raw[gate(2)]);
+        expected_hidden[unit] = n + update * (state[unit] - n);
+      }
+    }
+  }
+
+  callbacks::RecurrentScratch scratch(A_rows, cols);
+  ThreadPool pool(3);
+  for (int in_place = 0; in_place < 2; ++in_place) {
+    AlignedVector<float> cell_copy(cell.size()), hidden_copy(state.size()), cell_out(cell.size()), hidden_out(state.size());
+    std::copy(cell.begin(), cell.end(), cell_copy.begin());
+    std::copy(state.begin(), state.end(), hidden_copy.begin());
+    float *cell_output = in_place ? cell_copy.begin() : cell_out.begin();
+    float *hidden_output = in_place && gates == 3 ? hidden_copy.begin() : hidden_out.begin();
+    if (gates == 4) {
+      auto lstm = callbacks::UnquantizeAndLSTMCell(data.unquant_mult, data.bias.begin(), input.begin(), cell_copy.begin(), cell_output, hidden_output, scratch);
+      if (in_place) {
+        Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, cols, lstm, pool);
+      } else {
+        Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, cols, lstm);
+      }
+    } else {
+      Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, cols, callbacks::UnquantizeAndGRUCell(data.unquant_mult, data.bias.begin(), input.begin(), hidden_copy.begin(), hidden_output, scratch));
+    }
+    for (Index i = 0; i < expected_hidden.size(); ++i) {
+      if (gates == 4) CHECK_EPS(cell_output[i], expected_cell[i], 1e-3f);
+      CHECK_EPS(hidden_output[i], expected_hidden[i], 1e-3f);
+    }
+  }
+}
+
+TEST_CASE ("Multiply 8bit LSTM cell", "[biased_multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestRecurrentCell(4, 1, 64, 8);
+  TestRecurrentCell(4, 5, 256, 64);
+  TestRecurrentCell(4, 33, 512, 200);
+}
+
+TEST_CASE ("Multiply 8bit GRU cell", "[biased_multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestRecurrentCell(3, 1, 64, 8);
+  TestRecurrentCell(3, 5, 256, 64);
+  TestRecurrentCell(3, 33, 512, 200);
+}
+
+// A * B^T straight from quantized B against PrepareBQuantizedTransposed of B
+// padded with zero rows then Multiply.
+void TestMultiplyNT(Index A_rows, Index width, Index B_rows) {
+  const Index padded_rows = (B_rows + 7) / 8 * 8;
+  // B, B_rows x width, is the first B_rows * width floats of data.B.
+  RandomMultiply<Int8> data(A_rows, width, padded_rows);
+  AlignedVector<int8_t> B_quant(padded_rows * width), B_prep(padded_rows * width);
+  std::fill(B_quant.begin(), B_quant.end(), 0);
+  Int8::Quantize(data.B.begin(), B_quant.begin(), data.quant_mult, B_rows * width);
+  Int8::PrepareBQuantizedTransposed(B_quant.begin(), B_prep.begin(), width, padded_rows);
+
+  AlignedVector<float> expected(A_rows * padded_rows), actual(A_rows * B_rows);
+  Int8::Multiply(data.A_prep.begin(), B_prep.begin(), A_rows, width, padded_rows, callbacks::UnquantizeAndAddBiasAndWrite(data.unquant_mult, data.bias.begin(), expected.begin()));
+  ThreadPool pool(3);
+  for (int run = 0; run < 2; ++run) {
+    std::fill(actual.begin(), actual.end(), -1.0f);
+    if (run) {
+      Int8::MultiplyNT(data.A_prep.begin(), B_quant.begin(), A_rows, width, B_rows, callbacks::UnquantizeAndAddBiasAndWrite(data.unquant_mult, data.bias.begin(), actual.begin()), pool);
+    } else {
+      Int8::MultiplyNT(data.A_prep.begin(), B_quant.begin(), A_rows, width, B_rows, callbacks::UnquantizeAndAddBiasAndWrite(data.unquant_mult, data.bias.begin(), actual.begin()));
+    }
+    for (Index r = 0; r < A_rows; ++r) {
+      CHECK(!std::memcmp(expected.begin() + r * padded_rows, actual.begin() + r * B_rows, B_rows * sizeof(float)));
+    }
+  }
+}
+
+TEST_CASE ("Multiply 8bit unprepared transposed B", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplyNT(1, 64, 8);
+  TestMultiplyNT(1, 128, 37);
+  TestMultiplyNT(33, 256, 64);
+  TestMultiplyNT(70, 4096, 100);
+}
+
+// Columns appended a few at a time against preparing all of them at once,
+// after every append.
+void TestMultiplyAppendable(Index A_rows, Index width, Index capacity, const std::vector<Index> &appends) {
+  Index total = 0;
+  for (Index count : appends) total += count;
+  const Index padded = (total + 7) / 8 * 8;
+  RandomMultiply<Int8> data(A_rows, width, padded);
+  // The columns to append are data.B read as padded x width.
+  const float *B_transposed = data.B.begin();
+
+  AppendableB B(width, capacity);
+  ThreadPool pool(3);
+  for (Index count : appends) {
+    Int8::PrepareBAppendColumns(B_transposed + B.cols * width, B, data.quant_mult, count);
+    const Index cols = B.cols, cols_padded = (cols + 7) / 8 * 8;
+    REQUIRE(B.capacity >= cols);
+
+    AlignedVector<float> zeroed(cols_padded * width);
+    std::fill(zeroed.begin(), zeroed.end(), 0.0f);
+    std::copy(B_transposed, B_transposed + cols * width, zeroed.begin());
+    AlignedVector<int8_t> B_prep(zeroed.size());
+    Int8::PrepareBTransposed(zeroed.begin(), B_prep.begin(), data.quant_mult, width, cols_padded);
+    AlignedVector<float> expected(A_rows * cols_padded), actual(A_rows * cols);
+    Int8::Multiply(data.A_prep.begin(), B_prep.begin(), A_rows, width, cols_padded, callbacks::UnquantizeAndAddBiasAndWrite(data.unquant_mult, data.bias.begin(), expected.begin()));
+    for (int run = 0; run < 2; ++run) {
+      std::fill(actual.begin(), actual.end(), -1.0f);
+      if (run) {
+        Int8::MultiplyAppendable(data.A_prep.begin(), B, A_rows, callbacks::UnquantizeAndAddBiasAndWrite(data.unquant_mult, data.bias.begin(), actual.begin()), pool);
+      } else {
+        Int8::MultiplyAppendable(data.A_prep.begin(), B, A_rows, callbacks::UnquantizeAndAddBiasAndWrite(data.unquant_mult, data.bias.begin(), actual.begin()));
+      }
+      for (Index r = 0; r < A_rows; ++r) {
+        CHECK(!std::memcmp(expected.begin() + r * cols_padded, actual.begin() + r * cols, cols * sizeof(float)));
+      }
+    }
+  }
+}
+
+TEST_CASE ("Multiply 8bit appendable B", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplyAppendable(1, 64, 8, {1, 1, 1, 5, 1});
+  TestMultiplyAppendable(5, 256, 0, {3, 8, 1, 13});
+  TestMultiplyAppendable(33, 512, 64, {17, 1, 30, 16});
+}
+
+TEST_CASE ("Multiply 8bit sparse", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplySparse(1, 64, 16);
+  TestMultiplySparse(33, 256, 64);
+  TestMultiplySparse(70, 4096, 200);
+}
+
+TEST_CASE ("Multiply 8bit selected columns", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplyColumns(1, 64, 16, 8);
+  TestMultiplyColumns(33, 256, 64, 24);
+  TestMultiplyColumns(70, 4096, 512, 136);
+}
+
+// Column sums from Int8Shift::PrepareB give the same bias as PrepareBias,
+// for all of B and for columns picked by SelectColumnsB.
+void TestShiftedBias(Index rows, Index cols, Index selected) {
+  AlignedVector<float> B(rows * cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (auto &it : B) it = dist(gen);
+  AlignedVector<float> bias(cols);
+  for (auto &it : bias) it = dist(gen);
+  const float quant_mult = 64.0f, unquant_mult = -1.0f / quant_mult;
+
+  AlignedVector<int8_t> plain(B.size()), prepared(B.size());
+  Int8Shift::PrepareB(B.begin(), plain.begin(), quant_mult, rows, cols);
+  ShiftedBias sums;
+  Int8Shift::PrepareB(B.begin(), prepared.begin(), quant_mult, rows, cols, sums);
+  REQUIRE(sums.sums.size() == cols);
+  CHECK(!std::memcmp(plain.begin(), prepared.begin(), B.size()));
+
+  AlignedVector<float> expected(cols), got(cols);
+  std::copy(bias.begin(), bias.end(), expected.begin());
+  Int8Shift::PrepareBias(plain.begin(), rows, cols, callbacks::UnquantizeAndAddBiasAndWrite(unquant_mult, expected.begin(), expected.begin()));
+  sums.Write(bias.begin(), unquant_mult, got.begin());
+  for (Index c = 0; c < cols; ++c) {
+    INFO("Column " << c);
+    CHECK_EPS(got[c], expected[c], 1e-5f);
+  }
+
+  std::vector<Index> columns(selected);
+  std::uniform_int_distribution<Index> pick(0, cols - 1);
+  for (auto &it : columns) it = pick(gen);
+  AlignedVector<int8_t> picked(rows * selected);
+  ShiftedBias picked_sums;
+  Int8Shift::SelectColumnsB(prepared.begin(), picked.begin(), rows, columns.data(), columns.data() + selected, sums, picked_sums);
+  AlignedVector<float> picked_bias(selected), picked_expected(selected), picked_got(selected);
+  for (Index i = 0; i < selected; ++i) picked_bias[i] = picked_expected[i] = bias[columns[i]];
+  Int8Shift::PrepareBias(picked.begin(), rows, selected, callbacks::UnquantizeAndAddBiasAndWrite(unquant_mult, picked_expected.begin(), picked_expected.begin()));
+  picked_sums.Write(picked_bias.begin(), unquant_mult, picked_got.begin());
+  for (Index i = 0; i < selected; ++i) {
+    INFO("Selected " << i << " column " << columns[i]);
+    CHECK_EPS(picked_got[i], picked_expected[i], 1e-5f);
+  }
+}
+
+TEST_CASE ("PrepareB 8bit shift with column sums", "[prepare]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestShiftedBias(64, 8, 8);
+  TestShiftedBias(256, 64, 16);
+  TestShiftedBias(1024, 136, 40);
+}
+
+// 16-bit A times 8-bit B against the integer product of A and B quantized by
+// Int16 and Int8.  The sums are small enough to be exact in float.
+void TestMultiplyMixed(Index A_rows, Index width, Index B_cols) {
+  AlignedVector<float> A(A_rows * width), B(width * B_cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (auto &it : A) it = dist(gen);
+  for (auto &it : B) it = dist(gen);
+  const float A_quant_mult = 1024.0f, B_quant_mult = 127.0f;
+  AlignedVector<int16_t> A_prep(A.size()), B_quant(B.size());
+  AlignedVector<int8_t> B_prep(B.size());
+  Int16By8::PrepareA(A.begin(), A_prep.begin(), A_quant_mult, A_rows, width);
+  Int16By8::PrepareB(B.begin(), B_prep.begin(), B_quant_mult, width, B_cols);
+  // |B| * B_quant_mult is at most 127 so Int16 quantizes as Int8 would.
+  Int16::Quantize(B.begin(), B_quant.begin(), B_quant_mult, static_cast<Index>(B.size()));
+
+  AlignedVector<float> expected(A_rows * B_cols), actual(A_rows * B_cols);
+  for (Index r = 0; r < A_rows; ++r) {
+    for (Index c = 0; c < B_cols; ++c) {
+      int64_t sum = 0;
+      for (Index k = 0; k < width; ++k) {
+        sum += static_cast<int32_t>(A_prep[r * width + k]) * B_quant[k * B_cols + c];
+      }
+      expected[r * B_cols + c] = static_cast<float>(sum);
+    }
+  }
+  ThreadPool pool(3);
+  for (int run = 0; run < 2; ++run) {
+    std::fill(actual.begin(), actual.end(), -1.0f);
+    if (run) {
+      Int16By8::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(1.0f, actual.begin()), pool);
+    } else {
+      Int16By8::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(1.0f, actual.begin()));
+    }
+    CHECK(!std::memcmp(expected.begin(), actual.begin(), actual.size() * sizeof(float)));
+  }
+}
+
+TEST_CASE ("Multiply 16x8bit", "[multiply]") {
+  if (kCPU < CPUType::SSE2) return;
+  TestMultiplyMixed(1, 32, 8);
+  TestMultiplyMixed(33, 96, 64);
+  TestMultiplyMixed(70, 128, 200);
+}
+
+// CountSaturated against how many outputs of Multiply differ from the exact
+// product.  Large quant_mults make the 16-bit sums overflow now and then.
+void TestCountSaturated(Index A_rows, Index width, Index B_cols) {
+  RandomMultiply<Int8> data(A_rows, width, B_cols, 127.0f);
+  AlignedVector<int8_t> B_quant(data.B.size());
+  Int8::Quantize(data.B.begin(), B_quant.begin(), data.quant_mult, static_cast<Index>(data.B.size()));
+  AlignedVector<float> C(A_rows * B_cols);
+  Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(1.0f, C.begin()));
+  Index differ = 0;
+  for (Index r = 0; r < A_rows; ++r) {
+    for (Index c = 0; c < B_cols; ++c) {
+      int32_t sum = 0;
+      for (Index k = 0; k < width; ++k) {
+        sum += static_cast<int32_t>(data.A_prep[r * width + k]) * B_quant[k * B_cols + c];
+      }
+      if (C[r * B_cols + c] != static_cast<float>(sum)) ++differ;
+    }
+  }
+  INFO("Outputs changed by saturation " << differ);
+  CHECK(Int8::CountSaturated(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols) == differ);
+  CHECK(Int8::CountSaturated(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, CPUType::AVX512VNNI) == 0);
+}
+
+TEST_CASE ("Multiply 8bit saturation count", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestCountSaturated(1, 64, 8);
+  TestCountSaturated(9, 512, 64);
+  TestCountSaturated(33, 4096, 16);
+}
+
+// MultiplySplitK against Multiply, which it matches exactly, with OpenMP and
+// a pool.  Then the accumulating callbacks adding the multiplies of two
+// halves of the shared dimension.
+void TestMultiplySplitK(Index A_rows, Index width, Index B_cols) {
+  RandomMultiply<Int8> data(A_rows, width, B_cols);
+
+  AlignedVector<float> expected(A_rows * B_cols), actual(A_rows * B_cols);
+  Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndWrite(data.unquant_mult, data.bias.begin(), expected.begin()));
+  ThreadPool pool(5);
+  for (int run = 0; run < 2; ++run) {
+    std::fill(actual.begin(), actual.end(), -1.0f);
+    if (run) {
+      Int8::MultiplySplitK(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndWrite(data.unquant_mult, data.bias.begin(), actual.begin()), pool);
+    } else {
+      Int8::MultiplySplitK(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndWrite(data.unquant_mult, data.bias.begin(), actual.begin()));
+    }
+    CHECK(!std::memcmp(expected.begin(), actual.begin(), actual.size() * sizeof(float)));
+  }
+
+  // Each half of the shared dimension as its own multiply.
+  const Index half = width / 2;
+  AlignedVector<int8_t> A_low(A_rows * half), A_high(A_rows * half), B_low(half * B_cols), B_high(half * B_cols);
+  for (Index r = 0; r < A_rows; ++r) {
+    std::memcpy(A_low.begin() + r * half, data.A_prep.begin() + r * width, half);
+    std::memcpy(A_high.begin() + r * half, data.A_prep.begin() + r * width + half, half);
+  }
+  Int8::PrepareB(data.B.begin(), B_low.begin(), data.quant_mult, half, B_cols);
+  Int8::PrepareB(data.B.begin() + half * B_cols, B_high.begin(), data.quant_mult, half, B_cols);
+  AlignedVector<int32_t> low(A_rows * B_cols), high(A_rows * B_cols), sums(A_rows * B_cols);
+  Int8::Multiply(A_low.begin(), B_low.begin(), A_rows, half, B_cols, callbacks::Write<int32_t>(low.begin()));
+  Int8::Multiply(A_high.begin(), B_high.begin(), A_rows, half, B_cols, callbacks::Write<int32_t>(high.begin()));
+  std::copy(low.begin(), low.end(), sums.begin());
+  Int8::Multiply(A_high.begin(), B_high.begin(), A_rows, half, B_cols, callbacks::AddAndWrite(sums.begin()));
+  // beta 0 ignores what C held, then beta 0.5 halves it before adding.
+  std::fill(actual.begin(), actual.end(), std::numeric_limits<float>::quiet_NaN());
+  Int8::Multiply(A_low.begin(), B_low.begin(), A_rows, half, B_cols, callbacks::UnquantizeAndAccumulate(data.unquant_mult, 0.0f, actual.begin()));
+  Int8::Multiply(A_high.begin(), B_high.begin(), A_rows, half, B_cols, callbacks::UnquantizeAndAccumulate(data.unquant_mult, 0.5f, actual.begin()));
+  for (Index i = 0; i < A_rows * B_cols; ++i) {
+    CHECK(sums[i] == low[i] + high[i]);
+    CHECK(actual[i] == Approx(0.5f * low[i] * data.unquant_mult + high[i] * data.unquant_mult));
+  }
+}
+
+TEST_CASE ("Multiply 8bit split K", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplySplitK(1, 128, 8);
+  TestMultiplySplitK(1, 8192, 16);
+  TestMultiplySplitK(3, 6144 + 128, 24);
+  TestMultiplySplitK(40, 4096, 8);
+}
+
+float FromBits(uint32_t bits) {
+  float ret;
+  std::memcpy(&ret, &bits, sizeof(float));
+  return ret;
+}
+
+TEST_CASE ("Float16 conversions", "[float16]") {
+  CHECK(ToFloat(Half{0x3c00}) == 1.0f);
+  CHECK(ToFloat(Half{0x0001}) == std::ldexp(1.0f, -24));
+  CHECK(ToFloat(Half{0x7bff}) == 65504.0f);
+  CHECK(ToFloat(Half{0xfc00}) == -std::numeric_limits<float>::infinity());
+  CHECK(std::isnan(ToFloat(Half{0x7e00})));
+  CHECK(ToFloat(BFloat16{0xbf80}) == -1.0f);
+  // Ties round to even, in normals and denormals.
+  CHECK(ToBFloat16(FromBits(0x3f808000)).bits == 0x3f80);
+  CHECK(ToBFloat16(FromBits(0x3f818000)).bits == 0x3f82);
+  CHECK(ToBFloat16(FromBits(0x3f808001)).bits == 0x3f81);
+  CHECK(ToBFloat16(FromBits(0x7f7fffff)).bits == 0x7f80);
+  CHECK(ToBFloat16(FromBits(0x7f800001)).bits == 0x7fc0);
+  CHECK(ToHalf(1.0f + std::ldexp(1.0f, -11)).bits == 0x3c00);
+  CHECK(ToHalf(1.0f + 3 * std::ldexp(1.0f, -11)).bits == 0x3c02);
+  CHECK(ToHalf(std::ldexp(1.0f, -25)).bits == 0x0000);
+  CHECK(ToHalf(std::ldexp(3.0f, -25)).bits == 0x0002);
+  CHECK(ToHalf(-std::ldexp(1.0f, -26)).bits == 0x8000);
+  CHECK(ToHalf(65519.0f).bits == 0x7bff);
+  CHECK(ToHalf(65520.0f).bits == 0x7c00);
+  CHECK(ToHalf(std::numeric_limits<float>::quiet_NaN()).bits == 0x7e00);
+  // Every half survives the round trip.
+  for (uint32_t bits = 0; bits < 0x10000; ++bits) {
+    const Half value{static_cast<uint16_t>(bits)};
+    if ((bits & 0x7fff) > 0x7c00) continue;
+    CHECK(ToHalf(ToFloat(value)).bits == bits);
+  }
+  std::vector<Half> halves(1000);
+  for (std::size_t i = 0; i < halves.size(); ++i) halves[i].bits = static_cast<uint16_t>(i * 31 | (i & 1) << 15);
+  const float expected = ToFloat(std::max_element(halves.begin(), halves.end(), [](Half a, Half b) {
+    return std::fabs(ToFloat(a)) < std::fabs(ToFloat(b));
+  })[0]);
+  CHECK(MaxAbsoluteFloat16(halves.data(), halves.data() + halves.size()) == std::fabs(expected));
+}
+
+// Every 16-bit pattern converted by a register matches ToFloat.
+template <class Float16> void TestConvertToFloat(void (*convert)(const Float16 *, float *, Index)) {
+  std::vector<Float16> input(0x10000 + 3);
+  for (std::size_t i = 0; i < input.size(); ++i) input[i].bits = static_cast<uint16_t>(i);
+  AlignedVector<float> output(input.size());
+  convert(input.data(), output.begin(), static_cast<Index>(input.size()));
+  for (std::size_t i = 0; i < input.size(); ++i) {
+    const float expected = ToFloat(input[i]);
+    if (std::isnan(expected)) {
+      CHECK(std::isnan(output[i]));
+    } else {
+      CHECK(!std::memcmp(&expected, &output[i], sizeof(float)));
+    }
+  }
+}
+
+TEST_CASE ("Float16 to float registers", "[float16]") {
+#ifdef INTGEMM_COMPILER_SUPPORTS_NEON
+  TestConvertToFloat(NEON::ConvertToFloat<BFloat16>);
+  TestConvertToFloat(NEON::ConvertToFloat<Half>);
+#else
+  if (kCPU < CPUType::SSE2) return;
+  TestConvertToFloat(SSE2::ConvertToFloat<BFloat16>);
+  TestConvertToFloat(SSE2::ConvertToFloat<Half>);
+#endif
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
+  if (kCPU < CPUType::AVX2) return;
+  TestConvertToFloat(AVX2::ConvertToFloat<BFloat16>);
+  TestConvertToFloat(AVX2::ConvertToFloat<Half>);
+#endif
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+  if (kCPU < CPUType::AVX512BW) return;
+  TestConvertToFloat(AVX512BW::ConvertToFloat<BFloat16>);
+  TestConvertToFloat(AVX512BW::ConvertToFloat<Half>);
+#endif
+}
+
+// 16-bit input quantizes and prepares as its floats do, and the 16-bit
+// callbacks write the float callbacks' results rounded by ToBFloat16 or ToHalf.
+template <class Float16> void TestMultiplyFloat16(Float16 (*round)(float), Index A_rows, Index width, Index B_cols, float unquant_mult) {
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  std::vector<Float16> A(A_rows * width), B(width * B_cols);
+  for (auto &it : A) it = round(dist(gen));
+  for (auto &it : B) it = round(dist(gen));
+  AlignedVector<float> A_float(A.size()), B_float(B.size()), bias(B_cols);
+  for (std::size_t i = 0; i < A.size(); ++i) A_float[i] = ToFloat(A[i]);
+  for (std::size_t i = 0; i < B.size(); ++i) B_float[i] = ToFloat(B[i]);
+  for (auto &it : bias) it = dist(gen) * unquant_mult * 1000.0f;
+  const float quant_mult = 64.0f;
+
+  AlignedVector<int8_t> A_prep(A.size()), A_expected(A.size()), B_prep(B.size()), B_expected(B.size());
+  Int8::PrepareA(A.data(), A_prep.begin(), quant_mult, A_rows, width);
+  Int8::PrepareA(A_float.begin(), A_expected.begin(), quant_mult, A_rows, width);
+  CHECK(!std::memcmp(A_prep.begin(), A_expected.begin(), A.size()));
+  Int8::PrepareBFloat16(B.data(), B_prep.begin(), quant_mult, width, B_cols);
+  Int8::PrepareB(B_float.begin(), B_expected.begin(), quant_mult, width, B_cols);
+  CHECK(!std::memcmp(B_prep.begin(), B_expected.begin(), B.size()));
+  AlignedVector<uint8_t> A_shifted(A.size()), A_shifted_expected(A.size());
+  Int8::QuantizeUFloat16(A.data(), A_shifted.begin(), quant_mult, A_rows * width);
+  Int8::QuantizeU(A_float.begin(), A_shifted_expected.begin(), quant_mult, A_rows * width);
+  CHECK(!std::memcmp(A_shifted.begin(), A_shifted_expected.begin(), A.size()));
+
+  AlignedVector<float> C_float(A_rows * B_cols);
+  std::vector<Float16> C(A_rows * B_cols);
+  Int8::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(unquant_mult, C_float.begin()));
+  Int8::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWriteFloat16<Float16>(unquant_mult, C.data()));
+  for (std::size_t i = 0; i < C.size(); ++i) {
+    CHECK(C[i].bits == round(C_float[i]).bits);
+  }
+  Int8::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndWrite(unquant_mult, bias.begin(), C_float.begin()));
+  Int8::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndWriteFloat16<Float16>(unquant_mult, bias.begin(), C.data()));
+  for (std::size_t i = 0; i < C.size(); ++i) {
+    CHECK(C[i].bits == round(C_float[i]).bits);
+  }
+}
+
+TEST_CASE ("Multiply 8bit float16", "[multiply][float16]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplyFloat16(ToBFloat16, 5, 128, 16, 1.0f / 4096.0f);
+  TestMultiplyFloat16(ToBFloat16, 17, 4096 + 64, 24, 1e-30f);
+  // Underflow to denormals and overflow to infinity.
+  TestMultiplyFloat16(ToHalf, 5, 128, 16, 1.0f / 4096.0f);
+  TestMultiplyFloat16(ToHalf, 17, 4096 + 64, 24, 1e-9f);
+  TestMultiplyFloat16(ToHalf, 3, 256, 8, 1000.0f);
+}
+
+TEST_CASE ("PrepareB streaming and in place", "[prepare]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestPrepareBStream<Int8>(64, 8, 64);
+  TestPrepareBStream<Int8>(320, 136, 128);
+  TestPrepareBStream<Int8>(1024, 64, 256);
+  TestPrepareBStream<Int16>(96, 16, 32);
+  TestPrepareBStream<Int16>(288, 72, 256);
+  TestPrepareBQuantizedTransposedInPlace(64, 8);
+  TestPrepareBQuantizedTransposedInPlace(256, 264);
+  TestPrepareBQuantizedTransposedInPlace(128, 1024);
+}
+
+// A single row of A takes the GEMV path.  It must match the same row
+// multiplied as part of a taller A, which goes panel by panel.
+template <class Backend> void TestMultiplyGEMV(Index width, Index B_cols) {
+  using Integer = typename Backend::Integer;
+  const Index A_rows = 3;
+  RandomMultiply<Backend> data(A_rows, width, B_cols, sizeof(Integer) == 1 ? 64.0f : 1024.0f);
+  AlignedVector<int> expected(A_rows * B_cols), actual(B_cols);
+  Backend::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::Write<int>(expected.begin()));
+  for (Index r = 0; r < A_rows; ++r) {
+    Backend::Multiply(data.A_prep.begin() + r * width, data.B_prep.begin(), 1, width, B_cols, callbacks::Write<int>(actual.begin()));
+    CHECK(!std::memcmp(expected.begin() + r * B_cols, actual.begin(), B_cols * sizeof(int)));
+  }
+}
+
+TEST_CASE ("Multiply GEMV", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplyGEMV<Int8>(64, 8);
+  TestMultiplyGEMV<Int8>(4096, 64);
+  TestMultiplyGEMV<Int8Shift>(4096, 64);
+  TestMultiplyGEMV<Int16>(64, 8);
+  TestMultiplyGEMV<Int16>(4096, 64);
+}
+
+// Prefetching must not change results, including for the last strip and the
+// rows left over from register blocking.
+TEST_CASE ("Multiply prefetch distances", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  const Index A_rows = 35, width = 2560, B_cols = 48;
+  // Both draw the same A and B.
+  RandomMultiply<Int8> data8(A_rows, width, B_cols);
+  RandomMultiply<Int16> data16(A_rows, width, B_cols, 1024.0f);
+  const int8_t *A8 = data8.A_prep.begin(), *B8 = data8.B_prep.begin();
+  const int16_t *A16 = data16.A_prep.begin(), *B16 = data16.B_prep.begin();
+  AlignedVector<int> expected8(A_rows * B_cols), expected16(A_rows * B_cols), actual(A_rows * B_cols);
+  SetPrefetchDistance(0);
+  Int8::Multiply(A8, B8, A_rows, width, B_cols, callbacks::Write<int>(expected8.begin()));
+  Int16::Multiply(A16, B16, A_rows, width, B_cols, callbacks::Write<int>(expected16.begin()));
+  const Index kDistances[] = {64, 1000, 1 << 20};
+  for (Index distance : kDistances) {
+    SetPrefetchDistance(distance);
+    CHECK(PrefetchDistance(64) == distance);
+    Int8::Multiply(A8, B8, A_rows, width, B_cols, callbacks::Write<int>(actual.begin()));
+    CHECK(!std::memcmp(expected8.begin(), actual.begin(), actual.size() * sizeof(int)));
+    Int16::Multiply(A16, B16, A_rows, width, B_cols, callbacks::Write<int>(actual.begin()));
+    CHECK(!std::memcmp(expected16.begin(), actual.begin(), actual.size() * sizeof(int)));
+  }
+  ResetPrefetchDistance();
+  CHECK(PrefetchDistance(16) < PrefetchDistance(64));
+}
+
+TEST_CASE ("Multiply 8bit streaming stores", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiplyStream(1, 64, 8, 8);
+  TestMultiplyStream(33, 256, 64, 64);
+  TestMultiplyStream(9, 128, 32, 44);
+}
+
+TEST_CASE ("Multiply 4bit", "[multiply]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestMultiply4(1, 64, 8);
+  TestMultiply4(33, 256, 64);
+  TestMultiply4(70, 2048, 200);
+}
+
 } // namespace intgemm
@@ -0,0 +1,155 @@
+#include "test.h"
+#include "../intgemm/aligned.h"
+#include "../intgemm/executor.h"
+#include "../intgemm/intgemm.h"
+#include "../intgemm/numa.h"
+#include "../intgemm/sharded_b.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace intgemm {
+namespace {
+
+// Memory under every policy holds what is written to it and survives a move.
+void CheckPolicy(Pages pages, Placement placement, std::size_t size) {
+  MemoryPolicy policy;
+  policy.pages = pages;
+  policy.placement = placement;
+  policy.node = NumaNodes().front();
+  AlignedVector<uint32_t> vec(size, policy);
+  CHECK(vec.size() == size);
+  CHECK(reinterpret_cast<uintptr_t>(vec.begin()) % 64 == 0);
+  for (std::size_t i = 0; i < size; ++i) vec[i] = static_cast<uint32_t>(i * 7);
+  AlignedVector<uint32_t> moved(std::move(vec));
+  CHECK(vec.size() == 0);
+  for (std::size_t i = 0; i < size; ++i) {
+    if (moved[i] != i * 7) {
+      CHECK(moved[i] == i * 7);
+      break;
+    }
+  }
+  AlignedVector<uint32_t> other(16);
+  other = std::move(moved);
+  CHECK(other.size() == size);
+  CHECK(other[size - 1] == (size - 1) * 7);
+}
+
+TEST_CASE("AlignedVector memory policies", "[numa]") {
+  const Pages pages[] = {Pages::Small, Pages::Transparent, Pages::Huge2MB};
+  const Placement placements[] = {Placement::FirstTouch, Placement::Interleave, Placement::Node};
+  for (Pages page : pages) {
+    for (Placement placement : placements) {
+      CheckPolicy(page, placement, 1);
+      CheckPolicy(page, placement, 3 << 18);
+    }
+  }
+}
+
+// Huge page policies start on a 2 MB boundary, as transparent huge pages need,
+// whether or not MAP_HUGETLB succeeds.
+TEST_CASE("AllocatePages alignment", "[numa]") {
+#if defined(__linux__)
+  const std::size_t huge = std::size_t(2) << 20;
+  const Pages pages[] = {Pages::Transparent, Pages::Huge2MB, Pages::Huge1GB};
+  for (Pages page : pages) {
+    for (std::size_t bytes : {std::size_t(1), huge, 3 * huge + 5}) {
+      MemoryPolicy policy;
+      policy.pages = page;
+      std::size_t mapped;
+      char *mem = static_cast<char*>(AllocatePages(bytes, policy, mapped));
+      INFO("pages " << static_cast<int>(page) << " bytes " << bytes);
+      CHECK(reinterpret_cast<std::uintptr_t>(mem) % huge == 0);
+      CHECK(mapped % huge == 0);
+      CHECK(mapped >= bytes);
+      mem[0] = 1;
+      mem[bytes - 1] = 2;
+      FreePages(mem, mapped);
+    }
+  }
+#endif
+}
+
+TEST_CASE("NUMA topology", "[numa]") {
+  std::vector<int> nodes = NumaNodes();
+  REQUIRE(!nodes.empty());
+  CHECK(std::is_sorted(nodes.begin(), nodes.end()));
+  CHECK(std::find(nodes.begin(), nodes.end(), CurrentNode()) != nodes.end());
+#if defined(__linux__)
+  CHECK(!NodeCPUs(nodes.front()).empty());
+#endif
+}
+
+TEST_CASE("Core types", "[numa]") {
+  const std::vector<int> performance = CoreTypeCPUs(CoreType::Performance);
+  const std::vector<int> efficient = CoreTypeCPUs(CoreType::Efficient);
+  CHECK(std::is_sorted(performance.begin(), performance.end()));
+  CHECK(std::is_sorted(efficient.begin(), efficient.end()));
+  for (int cpu : performance) {
+    CHECK(std::find(efficient.begin(), efficient.end(), cpu) == efficient.end());
+  }
+}
+
+TEST_CASE("Replicated B multiplies like B", "[numa]") {
+  if (kCPU < CPUType::SSSE3) return;
+  const Index A_rows = 5, width = 256, B_cols = 64;
+  RandomMultiply<Int8> data(A_rows, width, B_cols);
+  Replicated<int8_t> replicated(data.B_prep.begin(), data.B_prep.size());
+  REQUIRE(replicated.Nodes() == NumaNodes());
+
+  AlignedVector<float> expected(A_rows * B_cols), actual(A_rows * B_cols);
+  Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(1.0f / 4096.0f, expected.begin()));
+  for (int node : replicated.Nodes()) {
+    std::vector<int> cpus = NodeCPUs(node);
+    ThreadPool pool(std::max<std::size_t>(cpus.size(), 1), cpus);
+    std::fill(actual.begin(), actual.end(), 0.0f);
+    Int8::Multiply(data.A_prep.begin(), replicated.ForNode(node), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(1.0f / 4096.0f, actual.begin()), pool);
+    CHECK(std::equal(expected.begin(), expected.end(), actual.begin()));
+  }
+  CHECK(!std::memcmp(replicated.Local(), data.B_prep.begin(), data.B_prep.size()));
+}
+
+TEST_CASE("Shard columns", "[numa]") {
+  const std::size_t counts[] = {1, 2, 3, 7};
+  for (std::size_t shards : counts) {
+    Index previous = 0;
+    for (std::size_t i = 0; i < shards; ++i) {
+      Index begin, end;
+      ShardColumns(72, shards, i, begin, end);
+      CHECK(begin == previous);
+      CHECK(begin % 8 == 0);
+      CHECK(end - begin <= (72 / 8 + shards - 1) / shards * 8);
+      previous = end;
+    }
+    CHECK(previous == 72);
+  }
+}
+
+// Shards on the same node still multiply like B, including an empty shard.
+void CheckSharded(Index B_cols, std::size_t shards) {
+  const Index A_rows = 5, width = 256;
+  RandomMultiply<Int8> data(A_rows, width, B_cols);
+  const std::vector<int> nodes(shards, NumaNodes().front());
+  ShardedB<int8_t> sharded(data.B_prep.begin(), width, B_cols, Pages::Transparent, nodes);
+  REQUIRE(sharded.Shards() == shards);
+  CHECK(sharded.ColumnBegin(0) == 0);
+  CHECK(sharded.ColumnEnd(shards - 1) == B_cols);
+
+  AlignedVector<float> expected(A_rows * B_cols), actual(A_rows * B_cols);
+  Int8::Multiply(data.A_prep.begin(), data.B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndAddBiasAndWrite(1.0f / 4096.0f, data.bias.begin(), expected.begin()));
+  NodePools pools(nodes);
+  std::fill(actual.begin(), actual.end(), 0.0f);
+  MultiplySharded<Int8>(data.A_prep.begin(), sharded, A_rows, callbacks::UnquantizeAndAddBiasAndWrite(1.0f / 4096.0f, data.bias.begin(), actual.begin()), pools);
+  CHECK(std::equal(expected.begin(), expected.end(), actual.begin()));
+}
+
+TEST_CASE("Sharded B multiplies like B", "[numa]") {
+  if (kCPU < CPUType::SSSE3) return;
+  CheckSharded(72, 3);
+  CheckSharded(16, 3);
+  CheckSharded(64, NumaNodes().size());
+}
+
+} // namespace
+} // namespace intgemm
@@ -0,0 +1,123 @@
+#include "test.h"
+#include "../intgemm/partition.h"
+
+#include <vector>
+
+namespace intgemm {
+namespace {
+
+// Every output row x 8-column strip is in exactly one task.
+void CheckCovers(Index A_rows, Index B_cols, std::size_t threads) {
+  Partition partition = ChoosePartition(A_rows, B_cols, threads);
+  INFO("A_rows " << A_rows << " B_cols " << B_cols << " threads " << threads);
+  CHECK(partition.Tasks() >= 1);
+  CHECK(partition.Tasks() <= (threads ? threads : 1));
+  std::vector<int> hits(A_rows * (B_cols / 8), 0);
+  for (Index task = 0; task < partition.Tasks(); ++task) {
+    Index row_begin, row_end, col_begin, col_end;
+    partition.Task(task, row_begin, row_end, col_begin, col_end);
+    CHECK(row_begin <= row_end);
+    CHECK(row_end <= A_rows);
+    CHECK(col_begin % 8 == 0);
+    CHECK(col_end % 8 == 0);
+    CHECK(col_end <= B_cols);
+    for (Index row = row_begin; row < row_end; ++row) {
+      for (Index col = col_begin; col < col_end; col += 8) {
+        ++hits[row * (B_cols / 8) + col / 8];
+      }
+    }
+  }
+  for (int hit : hits) {
+    CHECK(hit == 1);
+  }
+}
+
+TEST_CASE("Partition single thread", "[partition]") {
+  Partition partition = ChoosePartition(1024, 1024, 1);
+  CHECK(partition.row_parts == 1);
+  CHECK(partition.col_parts == 1);
+}
+
+TEST_CASE("Partition wide B splits columns", "[partition]") {
+  Partition partition = ChoosePartition(8, 2048, 8);
+  CHECK(partition.row_parts == 1);
+  CHECK(partition.col_parts == 8);
+}
+
+TEST_CASE("Partition narrow B splits rows", "[partition]") {
+  // 8 strips of B for 32 threads.
+  Partition partition = ChoosePartition(1024, 64, 32);
+  CHECK(partition.col_parts == 8);
+  CHECK(partition.row_parts == 4);
+  // One strip: rows only.
+  partition = ChoosePartition(1024, 8, 16);
+  CHECK(partition.col_parts == 1);
+  CHECK(partition.row_parts == 16);
+  // Not enough rows to go around.
+  partition = ChoosePartition(16, 8, 16);
+  CHECK(partition.row_parts == 2);
+}
+
+TEST_CASE("Partition covers output", "[partition]") {
+  const Index rows[] = {0, 1, 7, 8, 9, 100, 257};
+  const Index cols[] = {8, 16, 64, 256, 264};
+  const std::size_t threads[] = {0, 1, 2, 3, 7, 16, 64};
+  for (Index r : rows) {
+    for (Index c : cols) {
+      for (std::size_t t : threads) {
+        CheckCovers(r, c, t);
+      }
+    }
+  }
+}
+
+TEST_CASE("Partition batch shares threads", "[partition]") {
+  // Each of 4 multiplies gets 4 of 16 threads.
+  CHECK(ChooseBatchPartition(4, 1024, 64, 16).Tasks() == 4);
+  // At least as many multiplies as threads: one task each.
+  CHECK(ChooseBatchPartition(16, 1024, 64, 8).Tasks() == 1);
+  CHECK(ChooseBatchPartition(1, 8, 2048, 8).col_parts == 8);
+}
+
+TEST_CASE("Partition split K", "[partition]") {
+  // One row by 2 strips on 8 threads: 4 slices of 2 tasks each.
+  SplitKPartition split = ChooseSplitK(1, 8192, 16, 2048, 8);
+  CHECK(split.k_parts == 4);
+  CHECK(split.partition.Tasks() == 2);
+  // Slices cover width at multiples of k_unit and every task has one tile.
+  Index covered = 0;
+  for (Index task = 0; task < split.Tasks(); task += split.partition.Tasks()) {
+    Index k_begin, k_end, row_begin, row_end, col_begin, col_end;
+    split.Task(task, k_begin, k_end, row_begin, row_end, col_begin, col_end);
+    CHECK(k_begin == covered);
+    CHECK(k_begin % 2048 == 0);
+    CHECK(k_end > k_begin);
+    covered = k_end;
+  }
+  CHECK(covered == 8192);
+  // No more slices than units of width, and the remainder goes last.
+  split = ChooseSplitK(1, 5000, 8, 2048, 16);
+  CHECK(split.k_parts == 2);
+  Index k_begin, k_end, row_begin, row_end, col_begin, col_end;
+  split.Task(split.Tasks() - 1, k_begin, k_end, row_begin, row_end, col_begin, col_end);
+  CHECK(k_begin == 2048);
+  CHECK(k_end == 5000);
+  // Output enough to go around: not split.
+  CHECK(ChooseSplitK(1024, 8192, 1024, 2048, 8).k_parts == 1);
+}
+
+TEST_CASE("Partition dynamic schedule", "[partition]") {
+  const Schedule before = GetSchedule();
+  SetSchedule(Schedule::Static);
+  CHECK(ScheduleTasks(8) == 8);
+  SetSchedule(Schedule::Dynamic);
+  CHECK(GetSchedule() == Schedule::Dynamic);
+  CHECK(ScheduleTasks(8) == 8 * kDynamicTasksPerThread);
+  // Wide B: split finer than the threads.
+  CHECK(ChoosePartition(8, 2048, ScheduleTasks(8)).Tasks() == 8 * kDynamicTasksPerThread);
+  CheckCovers(100, 264, ScheduleTasks(7));
+  SetSchedule(before);
+}
+
+} // namespace
+} // namespace intgemm
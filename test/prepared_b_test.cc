@@ -0,0 +1,142 @@
+#include "test.h"
+#include "../intgemm/aligned.h"
+#include "../intgemm/intgemm.h"
+#include "../intgemm/prepared_b.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+namespace intgemm {
+namespace {
+
+template <class Integer> void Fill(AlignedVector<Integer> &values) {
+  std::mt19937 gen;
+  std::uniform_int_distribution<int> dist(-127, 127);
+  for (Integer &value : values) value = static_cast<Integer>(dist(gen));
+}
+
+// Prepared B of shape (rows, cols) for every group, made by relaying out the
+// transposed values with group = rows: one whole column per run.
+template <class Integer> void PrepareReference(const AlignedVector<Integer> &transposed, Index group, Integer *output, Index rows, Index cols) {
+  RelayoutPreparedB(transposed.begin(), rows, output, group, sizeof(Integer), rows, cols);
+}
+
+TEST_CASE("PreparedB groups", "[prepared_b]") {
+  CHECK(PreparedBGroup(CPUType::SSE2, 1) == 0);
+  CHECK(PreparedBGroup(CPUType::SSE2, 2) == 8);
+  CHECK(PreparedBGroup(CPUType::SSSE3, 1) == 16);
+  CHECK(PreparedBGroup(CPUType::AVXVNNI, 1) == 32);
+  CHECK(PreparedBGroup(CPUType::AVX512VNNI, 2) == 32);
+  CHECK(PreparedBGroup(CPUType::AMX, 1) == 4);
+  CHECK(PreparedBGroup(CPUType::AMX, 2) == 32);
+  CHECK(PreparedBGroup(CPUType::NEONDOTPROD, 1) == 16);
+}
+
+#ifndef INTGEMM_COMPILER_SUPPORTS_NEON
+// The description at the top of prepared_b.h agrees with the kernels.
+template <class Kernels> void TestLayout(CPUType cpu) {
+  typedef typename Kernels::Integer Integer;
+  const Index rows = 128, cols = 24;
+  AlignedVector<Integer> transposed(rows * cols), expected(rows * cols), actual(rows * cols);
+  Fill(transposed);
+  Kernels::PrepareBQuantizedTransposed(transposed.begin(), expected.begin(), rows, cols);
+  PrepareReference(transposed, PreparedBGroup(cpu, sizeof(Integer)), actual.begin(), rows, cols);
+  CHECK(!std::memcmp(expected.begin(), actual.begin(), rows * cols * sizeof(Integer)));
+}
+
+TEST_CASE("PreparedB layout matches kernels", "[prepared_b]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestLayout<SSE2::Kernels16>(CPUType::SSE2);
+  TestLayout<SSSE3::Kernels8>(CPUType::SSSE3);
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
+  if (kCPU < CPUType::AVX2) return;
+  TestLayout<AVX2::Kernels8>(CPUType::AVX2);
+  TestLayout<AVX2::Kernels16>(CPUType::AVX2);
+#endif
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+  if (kCPU < CPUType::AVX512BW) return;
+  TestLayout<AVX512BW::Kernels8>(CPUType::AVX512BW);
+  TestLayout<AVX512BW::Kernels16>(CPUType::AVX512BW);
+#endif
+#ifdef INTGEMM_COMPILER_SUPPORTS_AMX
+  if (kCPU < CPUType::AMX) return;
+  TestLayout<AMX::Kernels8>(CPUType::AMX);
+#endif
+}
+#endif
+
+// Write B as prepared on written_cpu, read it back here and compare with
+// preparing B on this CPU.
+template <class Routine> void TestRoundTrip(CPUType written_cpu, const char *file) {
+  typedef typename Routine::Integer Integer;
+  const Index rows = 256, cols = 32;
+  AlignedVector<float> B(rows * cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (float &value : B) value = dist(gen);
+  AlignedVector<Integer> prepared(rows * cols), written(rows * cols);
+  Routine::PrepareB(B.begin(), prepared.begin(), 64.0f, rows, cols);
+  const Index here = PreparedBGroup(kCPU, sizeof(Integer)), there = PreparedBGroup(written_cpu, sizeof(Integer));
+  RelayoutPreparedB(prepared.begin(), here, written.begin(), there, sizeof(Integer), rows, cols);
+  {
+    std::ofstream out(file, std::ios::binary);
+    WritePreparedB(out, "first", written.begin(), rows, cols, 64.0f, written_cpu);
+    WritePreparedB(out, "second", prepared.begin(), rows, cols / 2, 32.0f);
+  }
+  {
+    PreparedBFile loaded(file);
+    REQUIRE(loaded.size() == 2);
+    const PreparedB *first = loaded.Find("first");
+    REQUIRE(first);
+    CHECK(first->cpu == written_cpu);
+    CHECK(first->element_bytes == sizeof(Integer));
+    CHECK(first->rows == rows);
+    CHECK(first->cols == cols);
+    CHECK(first->quant_mult == 64.0f);
+    CHECK(first->mapped == (here == there));
+    CHECK(reinterpret_cast<uintptr_t>(first->data) % kPreparedBAlign == 0);
+    CHECK(!std::memcmp(first->as<Integer>(), prepared.begin(), rows * cols * sizeof(Integer)));
+
+    const PreparedB &second = loaded[1];
+    CHECK(second.name == "second");
+    CHECK(second.cols == cols / 2);
+    CHECK(second.quant_mult == 32.0f);
+    CHECK(second.mapped);
+    CHECK(!std::memcmp(second.as<Integer>(), prepared.begin(), rows * cols / 2 * sizeof(Integer)));
+    CHECK(!loaded.Find("third"));
+  }
+  std::remove(file);
+}
+
+TEST_CASE("PreparedB round trip 8bit", "[prepared_b]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestRoundTrip<Int8>(kCPU, "prepared_b_test_8bit.bin");
+  // A 16-byte layout is re-laid out unless that's what this CPU uses.
+  TestRoundTrip<Int8>(CPUType::SSSE3, "prepared_b_test_8bit_ssse3.bin");
+  TestRoundTrip<Int8>(CPUType::AVX512BW, "prepared_b_test_8bit_avx512bw.bin");
+  TestRoundTrip<Int8>(CPUType::AMX, "prepared_b_test_8bit_amx.bin");
+}
+
+TEST_CASE("PreparedB round trip 16bit", "[prepared_b]") {
+  if (kCPU < CPUType::SSE2) return;
+  TestRoundTrip<Int16>(kCPU, "prepared_b_test_16bit.bin");
+  TestRoundTrip<Int16>(CPUType::SSE2, "prepared_b_test_16bit_sse2.bin");
+  TestRoundTrip<Int16>(CPUType::AVX2, "prepared_b_test_16bit_avx2.bin");
+}
+
+TEST_CASE("PreparedB rejects other files", "[prepared_b]") {
+  const char *file = "prepared_b_test_bad.bin";
+  {
+    std::ofstream out(file, std::ios::binary);
+    const char garbage[100] = "this is not prepared B";
+    out.write(garbage, sizeof(garbage));
+  }
+  CHECK_THROWS_AS(PreparedBFile(file), PreparedBError);
+  CHECK_THROWS_AS(PreparedBFile("prepared_b_test_missing.bin"), PreparedBError);
+  std::remove(file);
+}
+
+} // namespace
+} // namespace intgemm
@@ -2,13 +2,16 @@
 #include "../intgemm/aligned.h"
 #include "../intgemm/avx2_gemm.h"
 #include "../intgemm/avx512_gemm.h"
+#include "../intgemm/intgemm.h"
 #include "../intgemm/sse2_gemm.h"
 #include "../intgemm/ssse3_gemm.h"
 #include "../intgemm/stats.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <iostream>
+#include <random>
 
 namespace intgemm {
 namespace {
@@ -118,6 +121,160 @@ template <class Backend> void TestMany(std::size_t grow) {
   }
 }
 
+// Each row should come out as Quantize with that row's multiplier.
+template <class Backend> void TestQuantizeRows(Index rows, Index cols) {
+  AlignedVector<float> input(rows * cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (Index r = 0; r < rows; ++r) {
+    // Rows of very different magnitude, and a row of zeros.
+    const float magnitude = (r == 1) ? 0.0f : std::ldexp(1.0f, static_cast<int>(r % 9) - 4);
+    for (Index c = 0; c < cols; ++c) input[r * cols + c] = dist(gen) * magnitude;
+  }
+  AlignedVector<int8_t> expected(rows * cols), actual(rows * cols);
+  AlignedVector<float> scales(rows);
+  Backend::QuantizeRows(input.begin(), actual.begin(), scales.begin(), rows, cols);
+  for (Index r = 0; r < rows; ++r) {
+    float max_abs = 0.0f;
+    for (Index c = 0; c < cols; ++c) max_abs = std::max(max_abs, std::fabs(input[r * cols + c]));
+    CHECK(scales[r] == max_abs / 127.0f);
+    Backend::Quantize(input.begin() + r * cols, expected.begin() + r * cols, max_abs > 0.0f ? 127.0f / max_abs : 1.0f, cols);
+  }
+  CHECK(!std::memcmp(expected.begin(), actual.begin(), rows * cols));
+}
+
+TEST_CASE ("Quantize rows", "[quantize]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestQuantizeRows<SSSE3::Kernels8>(1, 64);
+  TestQuantizeRows<SSSE3::Kernels8>(19, 320);
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
+  if (kCPU < CPUType::AVX2) return;
+  TestQuantizeRows<AVX2::Kernels8>(1, 64);
+  TestQuantizeRows<AVX2::Kernels8>(19, 320);
+#endif
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+  if (kCPU < CPUType::AVX512BW) return;
+  TestQuantizeRows<AVX512BW::Kernels8>(1, 64);
+  TestQuantizeRows<AVX512BW::Kernels8>(19, 320);
+#endif
+}
+
+// The threshold ScaleStatistic maps to 127, in double.
+double ScaledThresholdRef(const float *input, std::size_t size, ScaleStatistic statistic, float stddevs) {
+  double max_abs = 0.0, sum = 0.0, squares = 0.0;
+  for (std::size_t i = 0; i < size; ++i) {
+    const double value = std::fabs(input[i]);
+    max_abs = std::max(max_abs, value);
+    sum += value;
+    squares += value * value;
+  }
+  if (statistic == ScaleStatistic::MaxAbsolute || !size) return max_abs;
+  const double mean = sum / size;
+  return mean + stddevs * std::sqrt(squares / size - mean * mean);
+}
+
+// QuantizeScaled and QuantizeUScaled should be Quantize and QuantizeU with
+// 127 / the statistic of the whole input.
+template <class Backend> void TestQuantizeScaled(std::size_t size, ScaleStatistic statistic, float stddevs) {
+  AlignedVector<float> input(size);
+  std::mt19937 gen;
+  std::normal_distribution<float> dist(0.0f, 2.0f);
+  for (auto &it : input) it = dist(gen);
+  // An outlier for MeanStd to saturate.
+  if (size > 10) input[size / 3] = 100.0f;
+  const double threshold = ScaledThresholdRef(input.begin(), size, statistic, stddevs);
+
+  AlignedVector<int8_t> expected(size), actual(size);
+  const float scale = Backend::QuantizeScaled(input.begin(), actual.begin(), static_cast<Index>(size), statistic, stddevs);
+  CHECK_MESSAGE(std::fabs(scale - threshold / 127.0) <= 1e-5 * threshold, "Size " << size << " scale " << scale << " expected " << threshold / 127.0);
+  // Quantize takes the same multiplier from the returned scale.
+  const float quant_mult = scale > 0.0f ? 1.0f / scale : 1.0f;
+  if (statistic == ScaleStatistic::MaxAbsolute) {
+    CHECK(scale == static_cast<float>(threshold) / 127.0f);
+    Backend::Quantize(input.begin(), expected.begin(), size ? 127.0f / static_cast<float>(threshold) : 1.0f, static_cast<Index>(size));
+    CHECK(!std::memcmp(expected.begin(), actual.begin(), size));
+  } else {
+    Backend::Quantize(input.begin(), expected.begin(), quant_mult, static_cast<Index>(size));
+    std::size_t off = 0;
+    for (std::size_t i = 0; i < size; ++i) off += std::abs(expected[i] - actual[i]) > 1;
+    CHECK_MESSAGE(!off, "Size " << size << ": " << off << " off by more than 1");
+    if (size > 10) CHECK(actual[size / 3] == 127);
+  }
+
+  // The unsigned version is 127 more, with the same scale.
+  AlignedVector<uint8_t> unsigned_actual(size);
+  CHECK(Backend::QuantizeUScaled(input.begin(), unsigned_actual.begin(), static_cast<Index>(size), statistic, stddevs) == scale);
+  std::size_t unsigned_off = 0;
+  for (std::size_t i = 0; i < size; ++i) unsigned_off += static_cast<int>(unsigned_actual[i]) != actual[i] + 127;
+  CHECK(!unsigned_off);
+}
+
+template <class Backend> void TestQuantizeScaledAll() {
+  const std::size_t sizes[] = {0, 5, 64, 1000, 19 * 320, 70001};
+  for (std::size_t size : sizes) {
+    TestQuantizeScaled<Backend>(size, ScaleStatistic::MaxAbsolute, 0.0f);
+    TestQuantizeScaled<Backend>(size, ScaleStatistic::MeanStd, 3.0f);
+  }
+  // Each row as QuantizeScaled of that row.
+  const Index rows = 7, cols = 320;
+  AlignedVector<float> input(rows * cols);
+  std::mt19937 gen;
+  std::normal_distribution<float> dist(0.0f, 1.0f);
+  for (Index i = 0; i < rows * cols; ++i) input[i] = dist(gen) * static_cast<float>(i / cols + 1);
+  AlignedVector<int8_t> expected(cols), actual(rows * cols);
+  AlignedVector<float> scales(rows);
+  Backend::QuantizeRowsScaled(input.begin(), actual.begin(), scales.begin(), rows, cols, ScaleStatistic::MeanStd, 2.0f);
+  for (Index r = 0; r < rows; ++r) {
+    const float scale = Backend::QuantizeScaled(input.begin() + r * cols, expected.begin(), cols, ScaleStatistic::MeanStd, 2.0f);
+    CHECK(std::fabs(scales[r] - scale) <= 1e-5f * scale);
+    Index off = 0;
+    for (Index c = 0; c < cols; ++c) off += std::abs(expected[c] - actual[r * cols + c]) > 1;
+    CHECK(!off);
+  }
+}
+
+TEST_CASE ("Quantize scaled", "[quantize]") {
+  if (kCPU < CPUType::SSSE3) return;
+  TestQuantizeScaledAll<SSSE3::Kernels8>();
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
+  if (kCPU < CPUType::AVX2) return;
+  TestQuantizeScaledAll<AVX2::Kernels8>();
+#endif
+#ifdef INTGEMM_COMPILER_SUPPORTS_AVX512BW
+  if (kCPU < CPUType::AVX512BW) return;
+  TestQuantizeScaledAll<AVX512BW::Kernels8>();
+#endif
+}
+
+// Dispatched during static initialization, before intgemm.cc's own
+// initializers run when this file is linked ahead of the library.
+const float kStaticMaxAbsolute = [] {
+  alignas(64) float values[16];
+  for (int i = 0; i < 16; ++i) values[i] = static_cast<float>(i % 5) - 2.5f;
+  values[7] = -3.0f;
+  return MaxAbsolute(values, values + 16);
+}();
+
+// Int8::Multiply's dispatch pointer is a static member of a class template,
+// instantiated in the library, so its initialization is unordered.
+const float kStaticMultiply = [] {
+  if (GetCPUID() < CPUType::SSSE3) return 128.0f;
+  const Index A_rows = 1, width = 64, B_cols = 8;
+  AlignedVector<float> A(A_rows * width), B(width * B_cols), C(A_rows * B_cols);
+  std::fill(A.begin(), A.end(), 1.0f);
+  std::fill(B.begin(), B.end(), 2.0f);
+  AlignedVector<int8_t> A_prep(A.size()), B_prep(B.size());
+  Int8::PrepareA(A.begin(), A_prep.begin(), 1.0f, A_rows, width);
+  Int8::PrepareB(B.begin(), B_prep.begin(), 1.0f, width, B_cols);
+  Int8::Multiply(A_prep.begin(), B_prep.begin(), A_rows, width, B_cols, callbacks::UnquantizeAndWrite(1.0f, C.begin()));
+  return *std::min_element(C.begin(), C.end());
+}();
+
+TEST_CASE ("Dispatch from a static initializer", "[quantize]") {
+  CHECK(kStaticMaxAbsolute == 3.0f);
+  CHECK(kStaticMultiply == 128.0f);
+}
+
 TEST_CASE ("Quantize SSE2", "[quantize]") {
   if (kCPU < CPUType::SSE2) return;
   TestMany<SSE2::Kernels16>(8);
@@ -157,6 +314,8 @@ TEST_CASE("QuantizeStd SSSE3", "[VectorMeanStd]") {
   testVectorMeanStd<SSE2::VectorMeanStd>(81920, true);
   testVectorMeanStd<SSE2::VectorMeanStd>(120832);
   testVectorMeanStd<SSE2::VectorMeanStd>(120832, true);
+  testVectorMeanStd<SSE2::VectorMeanStd>(1003);
+  testVectorMeanStd<SSE2::VectorMeanStd>(1003, true);
 }
 
 #ifdef INTGEMM_COMPILER_SUPPORTS_AVX2
@@ -174,6 +333,8 @@ TEST_CASE("QuantizeStd AVX2", "[VectorMeanStd]") {
   testVectorMeanStd<AVX2::VectorMeanStd>(81920, true);
   testVectorMeanStd<AVX2::VectorMeanStd>(120832);
   testVectorMeanStd<AVX2::VectorMeanStd>(120832, true);
+  testVectorMeanStd<AVX2::VectorMeanStd>(1003);
+  testVectorMeanStd<AVX2::VectorMeanStd>(1003, true);
 }
 #endif
 
@@ -192,6 +353,8 @@ TEST_CASE("QuantizeStd AVX512BW", "[VectorMeanStd]") {
   testVectorMeanStd<AVX512BW::VectorMeanStd>(81920, true);
   testVectorMeanStd<AVX512BW::VectorMeanStd>(120832);
   testVectorMeanStd<AVX512BW::VectorMeanStd>(120832, true);
+  testVectorMeanStd<AVX512BW::VectorMeanStd>(1003);
+  testVectorMeanStd<AVX512BW::VectorMeanStd>(1003, true);
 }
 #endif
 
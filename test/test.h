@@ -10,6 +10,7 @@
 #include <sstream>
 #include <iostream>
 #include <iomanip>
+#include <random>
 
 #define CHECK_MESSAGE(cond, msg) do { INFO(msg); CHECK(cond); } while(0)
 #define CHECK_FALSE_MESSAGE(cond, msg) do { INFO(msg); CHECK_FALSE(cond); } while(0)
@@ -48,6 +49,31 @@ void CompareMSE(const float *float_ref, const float *int_ref, const float *int_t
                 std::size_t size, std::string test_info, float int_tolerance,
                 float float_tolerance, float MSE_float_tolerance, float MSE_int_tolerance);
 
+/* The usual multiply test operands: A, A_rows x width, and B, width x B_cols,
+ * uniform in [-1, 1), then bias, B_cols uniform in [-bias_range, bias_range),
+ * drawn in that order from gen, with A and B prepared by Routine at
+ * quant_mult.  Draw anything else the test needs from gen afterwards.
+ */
+template <class Routine> struct RandomMultiply {
+  typedef typename Routine::Integer Integer;
+
+  RandomMultiply(Index A_rows, Index width, Index B_cols, float quant_mult = 64.0f, float bias_range = 1.0f)
+    : A(A_rows * width), B(width * B_cols), bias(B_cols), A_prep(A.size()), B_prep(B.size()),
+      quant_mult(quant_mult), unquant_mult(1.0f / (quant_mult * quant_mult)) {
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f), bias_dist(-bias_range, bias_range);
+    for (auto &it : A) it = dist(gen);
+    for (auto &it : B) it = dist(gen);
+    for (auto &it : bias) it = bias_dist(gen);
+    Routine::PrepareA(A.begin(), A_prep.begin(), quant_mult, A_rows, width);
+    Routine::PrepareB(B.begin(), B_prep.begin(), quant_mult, width, B_cols);
+  }
+
+  std::mt19937 gen;
+  AlignedVector<float> A, B, bias;
+  AlignedVector<Integer> A_prep, B_prep;
+  const float quant_mult, unquant_mult;
+};
+
 template <typename Type>
 std::string PrintMatrix(const Type *mem, Index rows, Index cols) {
   std::ostringstream out;
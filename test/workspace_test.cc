@@ -0,0 +1,84 @@
+#include "test.h"
+#include "../intgemm/aligned.h"
+#include "../intgemm/callbacks.h"
+#include "../intgemm/intgemm.h"
+#include "../intgemm/workspace.h"
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <thread>
+
+namespace intgemm {
+namespace {
+
+TEST_CASE("Workspace allocations are aligned and distinct", "[workspace]") {
+  Workspace workspace;
+  CHECK(workspace.Capacity() == 0);
+  char *a = workspace.Allocate<char>(1);
+  float *b = workspace.Allocate<float>(100);
+  int16_t *c = workspace.Allocate<int16_t>(1000);
+  CHECK(reinterpret_cast<uintptr_t>(a) % Workspace::kAlign == 0);
+  CHECK(reinterpret_cast<uintptr_t>(b) % Workspace::kAlign == 0);
+  CHECK(reinterpret_cast<uintptr_t>(c) % Workspace::kAlign == 0);
+  // Each survives writes to the others.
+  *a = 7;
+  std::fill(b, b + 100, 1.5f);
+  std::fill(c, c + 1000, int16_t(-3));
+  CHECK(*a == 7);
+  CHECK(b[99] == 1.5f);
+  CHECK(c[0] == -3);
+}
+
+TEST_CASE("Workspace stops allocating after Reset", "[workspace]") {
+  Workspace workspace(128);
+  CHECK(workspace.Capacity() == 128);
+  for (int call = 0; call < 3; ++call) {
+    workspace.Allocate<float>(1000);
+    workspace.Allocate<int8_t>(5000);
+    workspace.Allocate<int8_t>(3);
+    workspace.Reset();
+  }
+  const std::size_t capacity = workspace.Capacity();
+  CHECK(capacity >= 4000 + 5000);
+  int8_t *first = workspace.Allocate<int8_t>(1);
+  workspace.Reset();
+  for (int call = 0; call < 3; ++call) {
+    CHECK(workspace.Allocate<int8_t>(1) == first);
+    workspace.Allocate<float>(1000);
+    workspace.Allocate<int8_t>(5000);
+    workspace.Reset();
+    CHECK(workspace.Capacity() == capacity);
+  }
+}
+
+TEST_CASE("Workspace ThreadLocal is per thread", "[workspace]") {
+  Workspace *mine = &Workspace::ThreadLocal();
+  CHECK(&Workspace::ThreadLocal() == mine);
+  Workspace *theirs = nullptr;
+  std::thread([&theirs] { theirs = &Workspace::ThreadLocal(); }).join();
+  CHECK(theirs != mine);
+}
+
+TEST_CASE("PrepareA into a Workspace", "[workspace]") {
+  if (kCPU < CPUType::SSSE3) return;
+  const Index rows = 3, cols = 128;
+  AlignedVector<float> input(rows * cols);
+  std::mt19937 gen;
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+  for (auto &it : input) it = dist(gen);
+  AlignedVector<int8_t> expected(input.size());
+  AlignedVector<int16_t> expected16(input.size());
+  Int8::PrepareA(input.begin(), expected.begin(), 64.0f, rows, cols);
+  Int16::PrepareA(input.begin(), expected16.begin(), 64.0f, rows, cols);
+  Workspace workspace;
+  const int8_t *actual = Int8::PrepareA(input.begin(), 64.0f, rows, cols, workspace);
+  const int16_t *actual16 = Int16::PrepareA(input.begin(), 64.0f, rows, cols, workspace);
+  CHECK(!std::memcmp(expected.begin(), actual, expected.size()));
+  CHECK(!std::memcmp(expected16.begin(), actual16, expected16.size() * sizeof(int16_t)));
+  Int8Shift::PrepareA(input.begin(), expected.begin(), 64.0f, rows, cols);
+  CHECK(!std::memcmp(expected.begin(), Int8Shift::PrepareA(input.begin(), 64.0f, rows, cols, workspace), expected.size()));
+}
+
+} // namespace
+} // namespace intgemm